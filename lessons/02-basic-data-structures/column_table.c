@@ -0,0 +1,1159 @@
+/*
+ * column_table.c - Columnar tables of GArrays, with vectorised kernels
+ *
+ * See column_table.h for the API. Each implementation provides the
+ * kernels for raw arrays, gathered in a ColumnOps table chosen on first
+ * use as in simd_text.c. Min/max kernels fold into the values they are
+ * given and filters take the row number of their first element, so the
+ * same kernel serves a whole column, a peeled prologue and a chunk.
+ *
+ * The AVX2 and AVX-512 code is compiled with target attributes and
+ * selected with __builtin_cpu_supports(). NEON is part of every AArch64
+ * CPU; it has no gather instruction, so gathers stay scalar there.
+ *
+ * The parallel reductions cut a column into CHUNK_BYTES pieces. The
+ * calling thread and up to one pool thread per other processor take
+ * chunks from a shared counter, each chunk's result goes in its own
+ * slot, and the slots are combined in order at the end.
+ */
+
+#include "column_table.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_AVX2 1
+#define HAVE_AVX512 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define HAVE_NEON 1
+#endif
+
+#define ALIGN 64                     /* Vector loads start at a cache line */
+#define CHUNK_BYTES (256 * 1024)     /* Fits the L2 of anything current */
+#define PARALLEL_MIN_CHUNKS 4
+
+typedef struct {
+    ColumnImpl impl;
+    const gchar *name;
+    gdouble (*sum_f64)(const gdouble *v, gsize n);
+    gint64 (*sum_i32)(const gint32 *v, gsize n);
+    void (*min_max_f64)(const gdouble *v, gsize n, gdouble *min, gdouble *max);
+    void (*min_max_i32)(const gint32 *v, gsize n, gint32 *min, gint32 *max);
+    gsize (*filter_f64)(const gdouble *v, gsize n, gdouble lo, gdouble hi, guint32 row, guint32 *out);
+    gsize (*filter_i32)(const gint32 *v, gsize n, gint32 lo, gint32 hi, guint32 row, guint32 *out);
+    void (*gather_f64)(const gdouble *v, const guint32 *indices, gsize n, gdouble *out);
+    void (*gather_i32)(const gint32 *v, const guint32 *indices, gsize n, gint32 *out);
+} ColumnOps;
+
+typedef struct {
+    gchar *name;
+    ColumnType type;
+    GArray *array;
+} Column;
+
+struct _ColumnTable {
+    GPtrArray *columns;
+    guint n_rows;
+};
+
+static const gsize type_sizes[] = {
+    [COLUMN_TYPE_INT32] = sizeof(gint32),
+    [COLUMN_TYPE_INT64] = sizeof(gint64),
+    [COLUMN_TYPE_FLOAT] = sizeof(gfloat),
+    [COLUMN_TYPE_DOUBLE] = sizeof(gdouble)
+};
+
+/* Elements before @v's first ALIGN boundary, at most @n */
+static inline gsize peel(gconstpointer v, gsize element_size, gsize n)
+{
+    gsize misalign = (guintptr)v & (ALIGN - 1);
+
+    return MIN(misalign ? (ALIGN - misalign) / element_size : 0, n);
+}
+
+/* ============================================================
+ * Scalar
+ * ============================================================ */
+
+static gdouble sum_f64_scalar(const gdouble *v, gsize n)
+{
+    gdouble sum = 0;
+
+    for (gsize i = 0; i < n; i++) {
+        sum += v[i];
+    }
+    return sum;
+}
+
+static gint64 sum_i32_scalar(const gint32 *v, gsize n)
+{
+    gint64 sum = 0;
+
+    for (gsize i = 0; i < n; i++) {
+        sum += v[i];
+    }
+    return sum;
+}
+
+static void min_max_f64_scalar(const gdouble *v, gsize n, gdouble *min, gdouble *max)
+{
+    for (gsize i = 0; i < n; i++) {
+        /* Both comparisons are false for NaN */
+        if (v[i] < *min) {
+            *min = v[i];
+        }
+        if (v[i] > *max) {
+            *max = v[i];
+        }
+    }
+}
+
+static void min_max_i32_scalar(const gint32 *v, gsize n, gint32 *min, gint32 *max)
+{
+    for (gsize i = 0; i < n; i++) {
+        *min = MIN(*min, v[i]);
+        *max = MAX(*max, v[i]);
+    }
+}
+
+static gsize filter_f64_scalar(const gdouble *v, gsize n, gdouble lo, gdouble hi,
+                               guint32 row, guint32 *out)
+{
+    gsize k = 0;
+
+    for (gsize i = 0; i < n; i++) {
+        if (v[i] >= lo && v[i] < hi) {
+            out[k++] = row + i;
+        }
+    }
+    return k;
+}
+
+static gsize filter_i32_scalar(const gint32 *v, gsize n, gint32 lo, gint32 hi,
+                               guint32 row, guint32 *out)
+{
+    gsize k = 0;
+
+    for (gsize i = 0; i < n; i++) {
+        if (v[i] >= lo && v[i] < hi) {
+            out[k++] = row + i;
+        }
+    }
+    return k;
+}
+
+static void gather_f64_scalar(const gdouble *v, const guint32 *indices, gsize n, gdouble *out)
+{
+    for (gsize i = 0; i < n; i++) {
+        out[i] = v[indices[i]];
+    }
+}
+
+static void gather_i32_scalar(const gint32 *v, const guint32 *indices, gsize n, gint32 *out)
+{
+    for (gsize i = 0; i < n; i++) {
+        out[i] = v[indices[i]];
+    }
+}
+
+static const ColumnOps scalar_ops = {
+    COLUMN_IMPL_SCALAR, "scalar",
+    sum_f64_scalar, sum_i32_scalar, min_max_f64_scalar, min_max_i32_scalar,
+    filter_f64_scalar, filter_i32_scalar, gather_f64_scalar, gather_i32_scalar
+};
+
+/* ============================================================
+ * AVX2
+ * ============================================================ */
+
+#ifdef HAVE_AVX2
+
+TARGET_AVX2 static gdouble sum_f64_avx2(const gdouble *v, gsize n)
+{
+    gsize i = peel(v, sizeof(gdouble), n);
+    gdouble head = sum_f64_scalar(v, i);
+    __m256d a0 = _mm256_setzero_pd(), a1 = a0, a2 = a0, a3 = a0;
+    gdouble lanes[4];
+
+    /* Four accumulators hide the latency of the adds */
+    for (; i + 16 <= n; i += 16) {
+        a0 = _mm256_add_pd(a0, _mm256_load_pd(v + i));
+        a1 = _mm256_add_pd(a1, _mm256_load_pd(v + i + 4));
+        a2 = _mm256_add_pd(a2, _mm256_load_pd(v + i + 8));
+        a3 = _mm256_add_pd(a3, _mm256_load_pd(v + i + 12));
+    }
+    for (; i + 4 <= n; i += 4) {
+        a0 = _mm256_add_pd(a0, _mm256_load_pd(v + i));
+    }
+    _mm256_storeu_pd(lanes, _mm256_add_pd(_mm256_add_pd(a0, a1), _mm256_add_pd(a2, a3)));
+    return head + (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + sum_f64_scalar(v + i, n - i);
+}
+
+TARGET_AVX2 static gint64 sum_i32_avx2(const gint32 *v, gsize n)
+{
+    gsize i = peel(v, sizeof(gint32), n);
+    gint64 head = sum_i32_scalar(v, i);
+    __m256i a0 = _mm256_setzero_si256(), a1 = a0;
+    gint64 lanes[4];
+
+    /* Widen each half to 64 bits, so the sum can't overflow */
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_load_si256((const __m256i *)(v + i));
+
+        a0 = _mm256_add_epi64(a0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)));
+        a1 = _mm256_add_epi64(a1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)));
+    }
+    _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(a0, a1));
+    return head + lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_i32_scalar(v + i, n - i);
+}
+
+TARGET_AVX2 static void min_max_f64_avx2(const gdouble *v, gsize n, gdouble *min, gdouble *max)
+{
+    gsize i = peel(v, sizeof(gdouble), n);
+    __m256d lo, hi;
+    gdouble lanes[8];
+
+    min_max_f64_scalar(v, i, min, max);
+    lo = _mm256_set1_pd(*min);
+    hi = _mm256_set1_pd(*max);
+
+    /* min/max return their second operand if either is NaN, so NaNs
+     * never reach the accumulators */
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_load_pd(v + i);
+
+        lo = _mm256_min_pd(x, lo);
+        hi = _mm256_max_pd(x, hi);
+    }
+    _mm256_storeu_pd(lanes, lo);
+    _mm256_storeu_pd(lanes + 4, hi);
+    for (guint l = 0; l < 4; l++) {
+        *min = MIN(*min, lanes[l]);
+        *max = MAX(*max, lanes[4 + l]);
+    }
+    min_max_f64_scalar(v + i, n - i, min, max);
+}
+
+TARGET_AVX2 static void min_max_i32_avx2(const gint32 *v, gsize n, gint32 *min, gint32 *max)
+{
+    gsize i = peel(v, sizeof(gint32), n);
+    __m256i lo, hi;
+    gint32 lanes[16];
+
+    min_max_i32_scalar(v, i, min, max);
+    lo = _mm256_set1_epi32(*min);
+    hi = _mm256_set1_epi32(*max);
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_load_si256((const __m256i *)(v + i));
+
+        lo = _mm256_min_epi32(lo, x);
+        hi = _mm256_max_epi32(hi, x);
+    }
+    _mm256_storeu_si256((__m256i *)lanes, lo);
+    _mm256_storeu_si256((__m256i *)(lanes + 8), hi);
+    for (guint l = 0; l < 8; l++) {
+        *min = MIN(*min, lanes[l]);
+        *max = MAX(*max, lanes[8 + l]);
+    }
+    min_max_i32_scalar(v + i, n - i, min, max);
+}
+
+TARGET_AVX2 static gsize filter_f64_avx2(const gdouble *v, gsize n, gdouble lo, gdouble hi,
+                                         guint32 row, guint32 *out)
+{
+    gsize i = peel(v, sizeof(gdouble), n);
+    gsize k = filter_f64_scalar(v, i, lo, hi, row, out);
+    const __m256d vlo = _mm256_set1_pd(lo);
+    const __m256d vhi = _mm256_set1_pd(hi);
+
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_load_pd(v + i);
+        guint mask = _mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(x, vlo, _CMP_GE_OQ),
+                                                      _mm256_cmp_pd(x, vhi, _CMP_LT_OQ)));
+
+        for (; mask; mask &= mask - 1) {
+            out[k++] = row + i + __builtin_ctz(mask);
+        }
+    }
+    return k + filter_f64_scalar(v + i, n - i, lo, hi, row + i, out + k);
+}
+
+TARGET_AVX2 static gsize filter_i32_avx2(const gint32 *v, gsize n, gint32 lo, gint32 hi,
+                                         guint32 row, guint32 *out)
+{
+    gsize i = peel(v, sizeof(gint32), n);
+    gsize k = filter_i32_scalar(v, i, lo, hi, row, out);
+    const __m256i vlo = _mm256_set1_epi32(lo);
+    const __m256i vhi = _mm256_set1_epi32(hi);
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_load_si256((const __m256i *)(v + i));
+        /* x >= lo is !(lo > x) */
+        __m256i in = _mm256_andnot_si256(_mm256_cmpgt_epi32(vlo, x), _mm256_cmpgt_epi32(vhi, x));
+        guint mask = _mm256_movemask_ps(_mm256_castsi256_ps(in));
+
+        for (; mask; mask &= mask - 1) {
+            out[k++] = row + i + __builtin_ctz(mask);
+        }
+    }
+    return k + filter_i32_scalar(v + i, n - i, lo, hi, row + i, out + k);
+}
+
+TARGET_AVX2 static void gather_f64_avx2(const gdouble *v, const guint32 *indices, gsize n, gdouble *out)
+{
+    gsize i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i index = _mm_loadu_si128((const __m128i *)(indices + i));
+
+        _mm256_storeu_pd(out + i, _mm256_i32gather_pd(v, index, sizeof(gdouble)));
+    }
+    gather_f64_scalar(v, indices + i, n - i, out + i);
+}
+
+TARGET_AVX2 static void gather_i32_avx2(const gint32 *v, const guint32 *indices, gsize n, gint32 *out)
+{
+    gsize i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i index = _mm256_loadu_si256((const __m256i *)(indices + i));
+
+        _mm256_storeu_si256((__m256i *)(out + i),
+                            _mm256_i32gather_epi32((const int *)v, index, sizeof(gint32)));
+    }
+    gather_i32_scalar(v, indices + i, n - i, out + i);
+}
+
+static const ColumnOps avx2_ops = {
+    COLUMN_IMPL_AVX2, "avx2",
+    sum_f64_avx2, sum_i32_avx2, min_max_f64_avx2, min_max_i32_avx2,
+    filter_f64_avx2, filter_i32_avx2, gather_f64_avx2, gather_i32_avx2
+};
+
+#endif /* HAVE_AVX2 */
+
+/* ============================================================
+ * AVX-512
+ * ============================================================ */
+
+#ifdef HAVE_AVX512
+
+TARGET_AVX512 static gdouble sum_f64_avx512(const gdouble *v, gsize n)
+{
+    gsize i = peel(v, sizeof(gdouble), n);
+    gdouble head = sum_f64_scalar(v, i);
+    __m512d a0 = _mm512_setzero_pd(), a1 = a0, a2 = a0, a3 = a0;
+
+    for (; i + 32 <= n; i += 32) {
+        a0 = _mm512_add_pd(a0, _mm512_load_pd(v + i));
+        a1 = _mm512_add_pd(a1, _mm512_load_pd(v + i + 8));
+        a2 = _mm512_add_pd(a2, _mm512_load_pd(v + i + 16));
+        a3 = _mm512_add_pd(a3, _mm512_load_pd(v + i + 24));
+    }
+    for (; i + 8 <= n; i += 8) {
+        a0 = _mm512_add_pd(a0, _mm512_load_pd(v + i));
+    }
+    a0 = _mm512_add_pd(_mm512_add_pd(a0, a1), _mm512_add_pd(a2, a3));
+    return head + _mm512_reduce_add_pd(a0) + sum_f64_scalar(v + i, n - i);
+}
+
+TARGET_AVX512 static gint64 sum_i32_avx512(const gint32 *v, gsize n)
+{
+    gsize i = peel(v, sizeof(gint32), n);
+    gint64 head = sum_i32_scalar(v, i);
+    __m512i a0 = _mm512_setzero_si512(), a1 = a0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m512i x = _mm512_load_si512(v + i);
+
+        a0 = _mm512_add_epi64(a0, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(x)));
+        a1 = _mm512_add_epi64(a1, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(x, 1)));
+    }
+    return head + _mm512_reduce_add_epi64(_mm512_add_epi64(a0, a1)) + sum_i32_scalar(v + i, n - i);
+}
+
+TARGET_AVX512 static void min_max_f64_avx512(const gdouble *v, gsize n, gdouble *min, gdouble *max)
+{
+    gsize i = peel(v, sizeof(gdouble), n);
+    __m512d lo, hi;
+
+    min_max_f64_scalar(v, i, min, max);
+    lo = _mm512_set1_pd(*min);
+    hi = _mm512_set1_pd(*max);
+    for (; i + 8 <= n; i += 8) {
+        __m512d x = _mm512_load_pd(v + i);
+
+        lo = _mm512_min_pd(x, lo);
+        hi = _mm512_max_pd(x, hi);
+    }
+    *min = _mm512_reduce_min_pd(lo);
+    *max = _mm512_reduce_max_pd(hi);
+    min_max_f64_scalar(v + i, n - i, min, max);
+}
+
+TARGET_AVX512 static void min_max_i32_avx512(const gint32 *v, gsize n, gint32 *min, gint32 *max)
+{
+    gsize i = peel(v, sizeof(gint32), n);
+    __m512i lo, hi;
+
+    min_max_i32_scalar(v, i, min, max);
+    lo = _mm512_set1_epi32(*min);
+    hi = _mm512_set1_epi32(*max);
+    for (; i + 16 <= n; i += 16) {
+        __m512i x = _mm512_load_si512(v + i);
+
+        lo = _mm512_min_epi32(lo, x);
+        hi = _mm512_max_epi32(hi, x);
+    }
+    *min = _mm512_reduce_min_epi32(lo);
+    *max = _mm512_reduce_max_epi32(hi);
+    min_max_i32_scalar(v + i, n - i, min, max);
+}
+
+/* Matching row numbers are written with one compressing store */
+TARGET_AVX512 static gsize filter_f64_avx512(const gdouble *v, gsize n, gdouble lo, gdouble hi,
+                                             guint32 row, guint32 *out)
+{
+    gsize i = peel(v, sizeof(gdouble), n);
+    gsize k = filter_f64_scalar(v, i, lo, hi, row, out);
+    const __m512d vlo = _mm512_set1_pd(lo);
+    const __m512d vhi = _mm512_set1_pd(hi);
+    const __m512i iota = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+    for (; i + 8 <= n; i += 8) {
+        __m512d x = _mm512_load_pd(v + i);
+        __mmask8 mask = _mm512_mask_cmp_pd_mask(_mm512_cmp_pd_mask(x, vlo, _CMP_GE_OQ),
+                                                x, vhi, _CMP_LT_OQ);
+        __m512i rows = _mm512_add_epi32(_mm512_set1_epi32(row + i), iota);
+
+        /* Lanes 8-15 are never selected */
+        _mm512_mask_compressstoreu_epi32(out + k, (__mmask16)mask, rows);
+        k += __builtin_popcount(mask);
+    }
+    return k + filter_f64_scalar(v + i, n - i, lo, hi, row + i, out + k);
+}
+
+TARGET_AVX512 static gsize filter_i32_avx512(const gint32 *v, gsize n, gint32 lo, gint32 hi,
+                                             guint32 row, guint32 *out)
+{
+    gsize i = peel(v, sizeof(gint32), n);
+    gsize k = filter_i32_scalar(v, i, lo, hi, row, out);
+    const __m512i vlo = _mm512_set1_epi32(lo);
+    const __m512i vhi = _mm512_set1_epi32(hi);
+    const __m512i iota = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+    for (; i + 16 <= n; i += 16) {
+        __m512i x = _mm512_load_si512(v + i);
+        __mmask16 mask = _mm512_mask_cmplt_epi32_mask(_mm512_cmpge_epi32_mask(x, vlo), x, vhi);
+
+        _mm512_mask_compressstoreu_epi32(out + k, mask,
+                                         _mm512_add_epi32(_mm512_set1_epi32(row + i), iota));
+        k += __builtin_popcount(mask);
+    }
+    return k + filter_i32_scalar(v + i, n - i, lo, hi, row + i, out + k);
+}
+
+TARGET_AVX512 static void gather_f64_avx512(const gdouble *v, const guint32 *indices, gsize n, gdouble *out)
+{
+    gsize i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i index = _mm256_loadu_si256((const __m256i *)(indices + i));
+
+        _mm512_storeu_pd(out + i, _mm512_i32gather_pd(index, v, sizeof(gdouble)));
+    }
+    gather_f64_scalar(v, indices + i, n - i, out + i);
+}
+
+TARGET_AVX512 static void gather_i32_avx512(const gint32 *v, const guint32 *indices, gsize n, gint32 *out)
+{
+    gsize i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m512i index = _mm512_loadu_si512(indices + i);
+
+        _mm512_storeu_si512(out + i, _mm512_i32gather_epi32(index, v, sizeof(gint32)));
+    }
+    gather_i32_scalar(v, indices + i, n - i, out + i);
+}
+
+static const ColumnOps avx512_ops = {
+    COLUMN_IMPL_AVX512, "avx512",
+    sum_f64_avx512, sum_i32_avx512, min_max_f64_avx512, min_max_i32_avx512,
+    filter_f64_avx512, filter_i32_avx512, gather_f64_avx512, gather_i32_avx512
+};
+
+#endif /* HAVE_AVX512 */
+
+/* ============================================================
+ * NEON
+ * ============================================================ */
+
+#ifdef HAVE_NEON
+
+static gdouble sum_f64_neon(const gdouble *v, gsize n)
+{
+    gsize i = peel(v, sizeof(gdouble), n);
+    gdouble head = sum_f64_scalar(v, i);
+    float64x2_t a0 = vdupq_n_f64(0), a1 = a0, a2 = a0, a3 = a0;
+
+    for (; i + 8 <= n; i += 8) {
+        a0 = vaddq_f64(a0, vld1q_f64(v + i));
+        a1 = vaddq_f64(a1, vld1q_f64(v + i + 2));
+        a2 = vaddq_f64(a2, vld1q_f64(v + i + 4));
+        a3 = vaddq_f64(a3, vld1q_f64(v + i + 6));
+    }
+    for (; i + 2 <= n; i += 2) {
+        a0 = vaddq_f64(a0, vld1q_f64(v + i));
+    }
+    a0 = vaddq_f64(vaddq_f64(a0, a1), vaddq_f64(a2, a3));
+    return head + vaddvq_f64(a0) + sum_f64_scalar(v + i, n - i);
+}
+
+static gint64 sum_i32_neon(const gint32 *v, gsize n)
+{
+    gsize i = peel(v, sizeof(gint32), n);
+    gint64 head = sum_i32_scalar(v, i);
+    int64x2_t a0 = vdupq_n_s64(0), a1 = a0;
+
+    /* Pairwise add-and-widen into 64-bit lanes */
+    for (; i + 8 <= n; i += 8) {
+        a0 = vpadalq_s32(a0, vld1q_s32(v + i));
+        a1 = vpadalq_s32(a1, vld1q_s32(v + i + 4));
+    }
+    return head + vaddvq_s64(vaddq_s64(a0, a1)) + sum_i32_scalar(v + i, n - i);
+}
+
+static void min_max_f64_neon(const gdouble *v, gsize n, gdouble *min, gdouble *max)
+{
+    gsize i = peel(v, sizeof(gdouble), n);
+    float64x2_t lo, hi;
+
+    min_max_f64_scalar(v, i, min, max);
+    lo = vdupq_n_f64(*min);
+    hi = vdupq_n_f64(*max);
+
+    /* The "nm" forms return the number when one operand is NaN */
+    for (; i + 2 <= n; i += 2) {
+        float64x2_t x = vld1q_f64(v + i);
+
+        lo = vminnmq_f64(lo, x);
+        hi = vmaxnmq_f64(hi, x);
+    }
+    *min = vminnmvq_f64(lo);
+    *max = vmaxnmvq_f64(hi);
+    min_max_f64_scalar(v + i, n - i, min, max);
+}
+
+static void min_max_i32_neon(const gint32 *v, gsize n, gint32 *min, gint32 *max)
+{
+    gsize i = peel(v, sizeof(gint32), n);
+    int32x4_t lo, hi;
+
+    min_max_i32_scalar(v, i, min, max);
+    lo = vdupq_n_s32(*min);
+    hi = vdupq_n_s32(*max);
+    for (; i + 4 <= n; i += 4) {
+        int32x4_t x = vld1q_s32(v + i);
+
+        lo = vminq_s32(lo, x);
+        hi = vmaxq_s32(hi, x);
+    }
+    *min = vminvq_s32(lo);
+    *max = vmaxvq_s32(hi);
+    min_max_i32_scalar(v + i, n - i, min, max);
+}
+
+static gsize filter_f64_neon(const gdouble *v, gsize n, gdouble lo, gdouble hi,
+                             guint32 row, guint32 *out)
+{
+    gsize i = peel(v, sizeof(gdouble), n);
+    gsize k = filter_f64_scalar(v, i, lo, hi, row, out);
+    const float64x2_t vlo = vdupq_n_f64(lo);
+    const float64x2_t vhi = vdupq_n_f64(hi);
+
+    for (; i + 2 <= n; i += 2) {
+        float64x2_t x = vld1q_f64(v + i);
+        uint64x2_t in = vandq_u64(vcgeq_f64(x, vlo), vcltq_f64(x, vhi));
+
+        if (vgetq_lane_u64(in, 0)) {
+            out[k++] = row + i;
+        }
+        if (vgetq_lane_u64(in, 1)) {
+            out[k++] = row + i + 1;
+        }
+    }
+    return k + filter_f64_scalar(v + i, n - i, lo, hi, row + i, out + k);
+}
+
+static gsize filter_i32_neon(const gint32 *v, gsize n, gint32 lo, gint32 hi,
+                             guint32 row, guint32 *out)
+{
+    static const guint32 lane_bits[4] = { 1, 2, 4, 8 };
+    gsize i = peel(v, sizeof(gint32), n);
+    gsize k = filter_i32_scalar(v, i, lo, hi, row, out);
+    const int32x4_t vlo = vdupq_n_s32(lo);
+    const int32x4_t vhi = vdupq_n_s32(hi);
+    const uint32x4_t bits = vld1q_u32(lane_bits);
+
+    for (; i + 4 <= n; i += 4) {
+        int32x4_t x = vld1q_s32(v + i);
+        uint32x4_t in = vandq_u32(vcgeq_s32(x, vlo), vcltq_s32(x, vhi));
+        guint mask = vaddvq_u32(vandq_u32(in, bits));
+
+        for (; mask; mask &= mask - 1) {
+            out[k++] = row + i + __builtin_ctz(mask);
+        }
+    }
+    return k + filter_i32_scalar(v + i, n - i, lo, hi, row + i, out + k);
+}
+
+static const ColumnOps neon_ops = {
+    COLUMN_IMPL_NEON, "neon",
+    sum_f64_neon, sum_i32_neon, min_max_f64_neon, min_max_i32_neon,
+    filter_f64_neon, filter_i32_neon, gather_f64_scalar, gather_i32_scalar
+};
+
+#endif /* HAVE_NEON */
+
+/* ============================================================
+ * Dispatch
+ * ============================================================ */
+
+static const ColumnOps *current_ops;
+
+static const ColumnOps *find_ops(ColumnImpl impl)
+{
+#if defined(HAVE_AVX2) || defined(HAVE_AVX512)
+    __builtin_cpu_init();
+#endif
+#ifdef HAVE_AVX512
+    if ((impl == COLUMN_IMPL_AVX512 || impl == COLUMN_IMPL_AUTO) &&
+        __builtin_cpu_supports("avx512f")) {
+        return &avx512_ops;
+    }
+#endif
+#ifdef HAVE_AVX2
+    if ((impl == COLUMN_IMPL_AVX2 || impl == COLUMN_IMPL_AUTO) &&
+        __builtin_cpu_supports("avx2")) {
+        return &avx2_ops;
+    }
+#endif
+#ifdef HAVE_NEON
+    if (impl == COLUMN_IMPL_NEON || impl == COLUMN_IMPL_AUTO) {
+        return &neon_ops;
+    }
+#endif
+    if (impl == COLUMN_IMPL_SCALAR || impl == COLUMN_IMPL_AUTO) {
+        return &scalar_ops;
+    }
+    return NULL;
+}
+
+static inline const ColumnOps *get_ops(void)
+{
+    const ColumnOps *ops = g_atomic_pointer_get(&current_ops);
+
+    /* Racing first calls pick the same table, so no lock is needed */
+    if (G_UNLIKELY(ops == NULL)) {
+        ops = find_ops(COLUMN_IMPL_AUTO);
+        g_atomic_pointer_set(&current_ops, ops);
+    }
+    return ops;
+}
+
+gboolean column_set_impl(ColumnImpl impl)
+{
+    const ColumnOps *ops = find_ops(impl);
+
+    if (ops == NULL) {
+        return FALSE;
+    }
+    g_atomic_pointer_set(&current_ops, ops);
+    return TRUE;
+}
+
+const gchar *column_get_impl_name(void)
+{
+    return get_ops()->name;
+}
+
+/* ============================================================
+ * Tables
+ * ============================================================ */
+
+static void column_free(gpointer data)
+{
+    Column *column = data;
+
+    g_array_unref(column->array);
+    g_free(column->name);
+    g_free(column);
+}
+
+static Column *get_column(ColumnTable *table, guint index)
+{
+    g_return_val_if_fail(index < table->columns->len, NULL);
+
+    return g_ptr_array_index(table->columns, index);
+}
+
+ColumnTable *column_table_new(void)
+{
+    ColumnTable *table = g_new0(ColumnTable, 1);
+
+    table->columns = g_ptr_array_new_with_free_func(column_free);
+    return table;
+}
+
+void column_table_free(ColumnTable *table)
+{
+    if (table == NULL) {
+        return;
+    }
+    g_ptr_array_unref(table->columns);
+    g_free(table);
+}
+
+guint column_table_add_column(ColumnTable *table, const gchar *name, ColumnType type)
+{
+    Column *column;
+
+    g_return_val_if_fail(table != NULL, G_MAXUINT);
+    g_return_val_if_fail(name != NULL, G_MAXUINT);
+    g_return_val_if_fail(type <= COLUMN_TYPE_DOUBLE, G_MAXUINT);
+    g_return_val_if_fail(column_table_lookup(table, name) < 0, G_MAXUINT);
+
+    column = g_new0(Column, 1);
+    column->name = g_strdup(name);
+    column->type = type;
+    column->array = g_array_sized_new(FALSE, TRUE, type_sizes[type], table->n_rows);
+    g_array_set_size(column->array, table->n_rows);
+    g_ptr_array_add(table->columns, column);
+    return table->columns->len - 1;
+}
+
+gint column_table_lookup(ColumnTable *table, const gchar *name)
+{
+    g_return_val_if_fail(table != NULL, -1);
+    g_return_val_if_fail(name != NULL, -1);
+
+    for (guint i = 0; i < table->columns->len; i++) {
+        Column *column = g_ptr_array_index(table->columns, i);
+
+        if (strcmp(column->name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+guint column_table_get_n_columns(ColumnTable *table)
+{
+    return table->columns->len;
+}
+
+guint column_table_get_n_rows(ColumnTable *table)
+{
+    return table->n_rows;
+}
+
+ColumnType column_table_get_type(ColumnTable *table, guint column)
+{
+    Column *c = get_column(table, column);
+
+    return c ? c->type : COLUMN_TYPE_INT32;
+}
+
+GArray *column_table_get_column(ColumnTable *table, guint column)
+{
+    Column *c = get_column(table, column);
+
+    return c ? c->array : NULL;
+}
+
+void column_table_set_n_rows(ColumnTable *table, guint n_rows)
+{
+    g_return_if_fail(table != NULL);
+
+    for (guint i = 0; i < table->columns->len; i++) {
+        Column *column = g_ptr_array_index(table->columns, i);
+
+        g_array_set_size(column->array, n_rows);
+    }
+    table->n_rows = n_rows;
+}
+
+void column_table_append_structs(ColumnTable *table, gconstpointer structs,
+                                 guint n_structs, gsize struct_size, const gssize *offsets)
+{
+    guint first = table->n_rows;
+
+    g_return_if_fail(structs != NULL || n_structs == 0);
+    g_return_if_fail(offsets != NULL);
+
+    /* Every offset is checked before the table grows, so a bad one
+     * leaves it as it was rather than with rows of zeroes */
+    for (guint c = 0; c < table->columns->len; c++) {
+        Column *column = g_ptr_array_index(table->columns, c);
+
+        g_return_if_fail(offsets[c] < 0 ||
+                         (gsize)offsets[c] + type_sizes[column->type] <= struct_size);
+    }
+
+    column_table_set_n_rows(table, first + n_structs);
+
+    /* One column at a time: each pass writes one array sequentially */
+    for (guint c = 0; c < table->columns->len; c++) {
+        Column *column = g_ptr_array_index(table->columns, c);
+        const guint8 *src;
+        guint8 *dest;
+
+        if (offsets[c] < 0) {
+            continue;
+        }
+
+        src = (const guint8 *)structs + offsets[c];
+        dest = (guint8 *)column->array->data + (gsize)first * type_sizes[column->type];
+
+        if (type_sizes[column->type] == 8) {
+            for (guint i = 0; i < n_structs; i++, src += struct_size, dest += 8) {
+                memcpy(dest, src, 8);
+            }
+        } else {
+            for (guint i = 0; i < n_structs; i++, src += struct_size, dest += 4) {
+                memcpy(dest, src, 4);
+            }
+        }
+    }
+}
+
+/* ============================================================
+ * Kernels
+ * ============================================================ */
+
+#define CHECK_COLUMN(column, type, val) G_STMT_START {                        \
+    g_return_val_if_fail((column) != NULL, val);                             \
+    g_return_val_if_fail(g_array_get_element_size((GArray *)(column)) == sizeof(type), val); \
+} G_STMT_END
+
+gdouble column_sum_f64(const GArray *column)
+{
+    CHECK_COLUMN(column, gdouble, 0);
+
+    return get_ops()->sum_f64((const gdouble *)column->data, column->len);
+}
+
+gint64 column_sum_i32(const GArray *column)
+{
+    CHECK_COLUMN(column, gint32, 0);
+
+    return get_ops()->sum_i32((const gint32 *)column->data, column->len);
+}
+
+gboolean column_min_max_f64(const GArray *column, gdouble *min, gdouble *max)
+{
+    gdouble lo = INFINITY, hi = -INFINITY;
+
+    CHECK_COLUMN(column, gdouble, FALSE);
+
+    if (column->len == 0) {
+        return FALSE;
+    }
+    get_ops()->min_max_f64((const gdouble *)column->data, column->len, &lo, &hi);
+    *min = lo;
+    *max = hi;
+    return TRUE;
+}
+
+gboolean column_min_max_i32(const GArray *column, gint32 *min, gint32 *max)
+{
+    gint32 lo = G_MAXINT32, hi = G_MININT32;
+
+    CHECK_COLUMN(column, gint32, FALSE);
+
+    if (column->len == 0) {
+        return FALSE;
+    }
+    get_ops()->min_max_i32((const gint32 *)column->data, column->len, &lo, &hi);
+    *min = lo;
+    *max = hi;
+    return TRUE;
+}
+
+/* Room for every row to match, then trimmed to the real count */
+guint column_filter_range_f64(const GArray *column, gdouble lo, gdouble hi, GArray *indices)
+{
+    guint first;
+    gsize n;
+
+    CHECK_COLUMN(column, gdouble, 0);
+    CHECK_COLUMN(indices, guint32, 0);
+
+    first = indices->len;
+    g_array_set_size(indices, first + column->len);
+    n = get_ops()->filter_f64((const gdouble *)column->data, column->len, lo, hi, 0,
+                              &g_array_index(indices, guint32, first));
+    g_array_set_size(indices, first + n);
+    return n;
+}
+
+guint column_filter_range_i32(const GArray *column, gint32 lo, gint32 hi, GArray *indices)
+{
+    guint first;
+    gsize n;
+
+    CHECK_COLUMN(column, gint32, 0);
+    CHECK_COLUMN(indices, guint32, 0);
+
+    first = indices->len;
+    g_array_set_size(indices, first + column->len);
+    n = get_ops()->filter_i32((const gint32 *)column->data, column->len, lo, hi, 0,
+                              &g_array_index(indices, guint32, first));
+    g_array_set_size(indices, first + n);
+    return n;
+}
+
+void column_gather_f64(const GArray *column, const GArray *indices, GArray *out)
+{
+    guint first;
+
+    g_return_if_fail(column != NULL && indices != NULL && out != NULL);
+    g_return_if_fail(g_array_get_element_size((GArray *)column) == sizeof(gdouble));
+    g_return_if_fail(g_array_get_element_size((GArray *)indices) == sizeof(guint32));
+    g_return_if_fail(g_array_get_element_size(out) == sizeof(gdouble));
+
+    first = out->len;
+    g_array_set_size(out, first + indices->len);
+    get_ops()->gather_f64((const gdouble *)column->data, (const guint32 *)indices->data,
+                          indices->len, &g_array_index(out, gdouble, first));
+}
+
+void column_gather_i32(const GArray *column, const GArray *indices, GArray *out)
+{
+    guint first;
+
+    g_return_if_fail(column != NULL && indices != NULL && out != NULL);
+    g_return_if_fail(g_array_get_element_size((GArray *)column) == sizeof(gint32));
+    g_return_if_fail(g_array_get_element_size((GArray *)indices) == sizeof(guint32));
+    g_return_if_fail(g_array_get_element_size(out) == sizeof(gint32));
+
+    first = out->len;
+    g_array_set_size(out, first + indices->len);
+    get_ops()->gather_i32((const gint32 *)column->data, (const guint32 *)indices->data,
+                          indices->len, &g_array_index(out, gint32, first));
+}
+
+/* ============================================================
+ * Parallel reductions
+ * ============================================================ */
+
+typedef enum {
+    REDUCE_SUM_F64,
+    REDUCE_SUM_I32,
+    REDUCE_MIN_MAX_F64,
+    REDUCE_MIN_MAX_I32
+} ReduceKind;
+
+typedef union {
+    gdouble sum_f64;
+    gint64 sum_i32;
+    struct { gdouble min, max; } range_f64;
+    struct { gint32 min, max; } range_i32;
+} ChunkResult;
+
+typedef struct {
+    const ColumnOps *ops;
+    ReduceKind kind;
+    const guint8 *data;
+    gsize element_size;
+    gsize n;
+    gsize chunk_elements;
+    guint n_chunks;
+    ChunkResult *results;
+    gint next_chunk;                 /* Atomic */
+
+    GMutex lock;
+    GCond done;
+    guint running;                   /* Pool threads not finished */
+} Reduction;
+
+static void reduce_chunk(Reduction *r, guint c)
+{
+    gsize start = (gsize)c * r->chunk_elements;
+    gsize n = MIN(r->chunk_elements, r->n - start);
+    gconstpointer v = r->data + start * r->element_size;
+    ChunkResult *result = &r->results[c];
+
+    switch (r->kind) {
+    case REDUCE_SUM_F64:
+        result->sum_f64 = r->ops->sum_f64(v, n);
+        break;
+    case REDUCE_SUM_I32:
+        result->sum_i32 = r->ops->sum_i32(v, n);
+        break;
+    case REDUCE_MIN_MAX_F64:
+        result->range_f64.min = INFINITY;
+        result->range_f64.max = -INFINITY;
+        r->ops->min_max_f64(v, n, &result->range_f64.min, &result->range_f64.max);
+        break;
+    case REDUCE_MIN_MAX_I32:
+        result->range_i32.min = G_MAXINT32;
+        result->range_i32.max = G_MININT32;
+        r->ops->min_max_i32(v, n, &result->range_i32.min, &result->range_i32.max);
+        break;
+    }
+}
+
+static void reduce_chunks(Reduction *r)
+{
+    guint c;
+
+    while ((c = (guint)g_atomic_int_add(&r->next_chunk, 1)) < r->n_chunks) {
+        reduce_chunk(r, c);
+    }
+}
+
+static void reduce_worker(gpointer data, gpointer user_data)
+{
+    Reduction *r = data;
+
+    reduce_chunks(r);
+
+    g_mutex_lock(&r->lock);
+    if (--r->running == 0) {
+        g_cond_signal(&r->done);
+    }
+    g_mutex_unlock(&r->lock);
+}
+
+static GThreadPool *get_pool(void)
+{
+    static gsize initialized = 0;
+    static GThreadPool *pool = NULL;
+
+    if (g_once_init_enter(&initialized)) {
+        pool = g_thread_pool_new(reduce_worker, NULL, MAX(g_get_num_processors() - 1, 1),
+                                 FALSE, NULL);
+        g_once_init_leave(&initialized, 1);
+    }
+    return pool;
+}
+
+/* Fills r->results, one per chunk */
+static void reduce(Reduction *r, ReduceKind kind, const GArray *column)
+{
+    guint helpers;
+
+    r->ops = get_ops();
+    r->kind = kind;
+    r->data = (const guint8 *)column->data;
+    r->element_size = g_array_get_element_size((GArray *)column);
+    r->n = column->len;
+    r->chunk_elements = CHUNK_BYTES / r->element_size;
+    r->n_chunks = (r->n + r->chunk_elements - 1) / r->chunk_elements;
+    r->results = g_new(ChunkResult, r->n_chunks);
+    r->next_chunk = 0;
+    r->running = 0;
+
+    helpers = (r->n_chunks >= PARALLEL_MIN_CHUNKS)
+        ? MIN(g_get_num_processors() - 1, r->n_chunks - 1) : 0;
+    if (helpers == 0) {
+        reduce_chunks(r);
+        return;
+    }
+
+    g_mutex_init(&r->lock);
+    g_cond_init(&r->done);
+    r->running = helpers;
+    for (guint i = 0; i < helpers; i++) {
+        g_thread_pool_push(get_pool(), r, NULL);
+    }
+
+    reduce_chunks(r);
+
+    g_mutex_lock(&r->lock);
+    while (r->running > 0) {
+        g_cond_wait(&r->done, &r->lock);
+    }
+    g_mutex_unlock(&r->lock);
+    g_cond_clear(&r->done);
+    g_mutex_clear(&r->lock);
+}
+
+gdouble column_sum_f64_parallel(const GArray *column)
+{
+    Reduction r;
+    gdouble sum = 0;
+
+    CHECK_COLUMN(column, gdouble, 0);
+
+    reduce(&r, REDUCE_SUM_F64, column);
+    for (guint c = 0; c < r.n_chunks; c++) {
+        sum += r.results[c].sum_f64;
+    }
+    g_free(r.results);
+    return sum;
+}
+
+gint64 column_sum_i32_parallel(const GArray *column)
+{
+    Reduction r;
+    gint64 sum = 0;
+
+    CHECK_COLUMN(column, gint32, 0);
+
+    reduce(&r, REDUCE_SUM_I32, column);
+    for (guint c = 0; c < r.n_chunks; c++) {
+        sum += r.results[c].sum_i32;
+    }
+    g_free(r.results);
+    return sum;
+}
+
+gboolean column_min_max_f64_parallel(const GArray *column, gdouble *min, gdouble *max)
+{
+    Reduction r;
+    gdouble lo = INFINITY, hi = -INFINITY;
+
+    CHECK_COLUMN(column, gdouble, FALSE);
+
+    if (column->len == 0) {
+        return FALSE;
+    }
+    reduce(&r, REDUCE_MIN_MAX_F64, column);
+    for (guint c = 0; c < r.n_chunks; c++) {
+        lo = MIN(lo, r.results[c].range_f64.min);
+        hi = MAX(hi, r.results[c].range_f64.max);
+    }
+    g_free(r.results);
+    *min = lo;
+    *max = hi;
+    return TRUE;
+}
+
+gboolean column_min_max_i32_parallel(const GArray *column, gint32 *min, gint32 *max)
+{
+    Reduction r;
+    gint32 lo = G_MAXINT32, hi = G_MININT32;
+
+    CHECK_COLUMN(column, gint32, FALSE);
+
+    if (column->len == 0) {
+        return FALSE;
+    }
+    reduce(&r, REDUCE_MIN_MAX_I32, column);
+    for (guint c = 0; c < r.n_chunks; c++) {
+        lo = MIN(lo, r.results[c].range_i32.min);
+        hi = MAX(hi, r.results[c].range_i32.max);
+    }
+    g_free(r.results);
+    *min = lo;
+    *max = hi;
+    return TRUE;
+}
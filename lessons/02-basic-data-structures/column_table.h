@@ -0,0 +1,120 @@
+/*
+ * column_table.h - Columnar (structure-of-arrays) tables of GArrays,
+ * with vectorised kernels
+ *
+ * array_example.c keeps records in one GArray of structs. Summing one
+ * field of such an array reads every byte of every struct: with a
+ * 32-byte record and an 8-byte field, three quarters of each cache line
+ * is wasted, and the loop can't be vectorised. A ColumnTable keeps each
+ * field in a GArray of its own:
+ *
+ *   - columns are typed (int32, int64, float, double) and all have the
+ *     table's row count; each one is a plain GArray, so g_array_index()
+ *     and the rest still work on it
+ *   - column_table_append_structs() converts an array of structs, given
+ *     the G_STRUCT_OFFSET() of each column's field
+ *   - sum, min/max, range filter and gather kernels for double and
+ *     int32 columns, 4-16 elements per instruction
+ *   - _parallel() variants split arrays larger than L2 into L2-sized
+ *     chunks and reduce them on a shared thread pool
+ *
+ * GArray storage is only malloc()-aligned. The vector kernels handle
+ * elements one at a time up to the first 64-byte boundary and use
+ * aligned loads from there, so the main loop never splits a cache line.
+ *
+ * The implementation is chosen at run time as in simd_text.h: AVX-512
+ * or AVX2 when the CPU has it, NEON on AArch64, otherwise scalar code.
+ * column_set_impl() forces one, to compare them.
+ *
+ * Vector sums add in a different order from a loop, so double results
+ * can differ from one in the last bits. The parallel variants add their
+ * chunks in order, so they don't depend on the number of threads.
+ */
+
+#ifndef COLUMN_TABLE_H
+#define COLUMN_TABLE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+    COLUMN_TYPE_INT32,
+    COLUMN_TYPE_INT64,
+    COLUMN_TYPE_FLOAT,
+    COLUMN_TYPE_DOUBLE
+} ColumnType;
+
+typedef enum {
+    COLUMN_IMPL_AUTO,            /* Best the CPU supports */
+    COLUMN_IMPL_SCALAR,
+    COLUMN_IMPL_AVX2,
+    COLUMN_IMPL_AVX512,
+    COLUMN_IMPL_NEON
+} ColumnImpl;
+
+typedef struct _ColumnTable ColumnTable;
+
+ColumnTable *column_table_new(void);
+void column_table_free(ColumnTable *table);
+
+/* Returns the column's index. @name must be unique; a column added to
+ * a table with rows starts as zeros. */
+guint column_table_add_column(ColumnTable *table, const gchar *name, ColumnType type);
+
+/* Index of the column called @name, or -1 */
+gint column_table_lookup(ColumnTable *table, const gchar *name);
+
+guint column_table_get_n_columns(ColumnTable *table);
+guint column_table_get_n_rows(ColumnTable *table);
+ColumnType column_table_get_type(ColumnTable *table, guint column);
+
+/* The column itself. Modify elements freely, but leave its length to
+ * the table. */
+GArray *column_table_get_column(ColumnTable *table, guint column);
+
+/* Resizes every column; new rows are zero */
+void column_table_set_n_rows(ColumnTable *table, guint n_rows);
+
+/* Appends @n_structs records of @struct_size bytes from @structs (a
+ * GArray's ->data, say). @offsets has one G_STRUCT_OFFSET() per column,
+ * or -1 to leave that column zero. */
+void column_table_append_structs(ColumnTable *table, gconstpointer structs,
+                                 guint n_structs, gsize struct_size, const gssize *offsets);
+
+/* Returns FALSE if the CPU or build lacks @impl */
+gboolean column_set_impl(ColumnImpl impl);
+const gchar *column_get_impl_name(void);
+
+/* Kernels take a column of the matching type (any GArray of gdouble or
+ * gint32 works). Int32 sums are 64-bit, so they can't overflow. */
+gdouble column_sum_f64(const GArray *column);
+gint64 column_sum_i32(const GArray *column);
+
+/* FALSE if @column is empty. NaNs are skipped; a column of only NaNs
+ * gives +inf and -inf. */
+gboolean column_min_max_f64(const GArray *column, gdouble *min, gdouble *max);
+gboolean column_min_max_i32(const GArray *column, gint32 *min, gint32 *max);
+
+/* Appends to @indices (a GArray of guint32) the row of every element
+ * with @lo <= value < @hi, in order, and returns how many. NaN never
+ * matches. */
+guint column_filter_range_f64(const GArray *column, gdouble lo, gdouble hi, GArray *indices);
+guint column_filter_range_i32(const GArray *column, gint32 lo, gint32 hi, GArray *indices);
+
+/* Appends column[indices[i]] to @out (of the column's type) for each
+ * index, e.g. to fetch another column of the rows a filter picked.
+ * Indices aren't checked, and must be below G_MAXINT32. */
+void column_gather_f64(const GArray *column, const GArray *indices, GArray *out);
+void column_gather_i32(const GArray *column, const GArray *indices, GArray *out);
+
+/* As above, on every processor for columns larger than a few L2-sized
+ * chunks, and on the calling thread otherwise */
+gdouble column_sum_f64_parallel(const GArray *column);
+gint64 column_sum_i32_parallel(const GArray *column);
+gboolean column_min_max_f64_parallel(const GArray *column, gdouble *min, gdouble *max);
+gboolean column_min_max_i32_parallel(const GArray *column, gint32 *min, gint32 *max);
+
+G_END_DECLS
+
+#endif /* COLUMN_TABLE_H */
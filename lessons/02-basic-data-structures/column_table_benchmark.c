@@ -0,0 +1,348 @@
+/*
+ * column_table_benchmark.c - A GArray of structs vs a ColumnTable
+ *
+ * The same sensor samples stored two ways: as a GArray of 32-byte
+ * Sample structs, the layout array_example.c uses, and as a ColumnTable
+ * with one GArray per field. Each time is per row:
+ *   - sum:         the value field (double) and the sensor field (int32)
+ *   - min/max:     the value field
+ *   - filter:      rows with 100 <= value < 200 (10% of them)
+ *   - gather:      the weight of each filtered row
+ *   - parallel:    sum and min/max on every processor
+ *
+ * The struct loops read fields with g_array_index(). Every column row
+ * runs once per implementation the CPU supports. Two sizes: one whose
+ * value column fits in L2, and a large one that streams from memory,
+ * which is where parallel chunking pays.
+ *
+ * Usage: ./column_table_benchmark [million-rows] [--bench-...]   (default 4)
+ */
+
+#include "bench.h"
+#include "column_table.h"
+
+#define SMALL_ROWS 16384
+
+typedef struct {
+    gint64 timestamp;
+    gint32 sensor;
+    gint32 status;
+    gdouble value;
+    gdouble weight;
+} Sample;
+
+enum { COL_TIMESTAMP, COL_SENSOR, COL_STATUS, COL_VALUE, COL_WEIGHT };
+
+typedef struct {
+    GArray *samples;             /* Of Sample */
+    ColumnTable *table;
+    GArray *value;               /* Columns of table */
+    GArray *sensor;
+    GArray *weight;
+    GArray *indices;             /* Filter output, kept filled for gather */
+    GArray *gathered;
+    gdouble baseline_ns;
+} Workload;
+
+static void workload_init(Workload *w, guint n_rows)
+{
+    static const gssize offsets[] = {
+        G_STRUCT_OFFSET(Sample, timestamp), G_STRUCT_OFFSET(Sample, sensor),
+        G_STRUCT_OFFSET(Sample, status), G_STRUCT_OFFSET(Sample, value),
+        G_STRUCT_OFFSET(Sample, weight)
+    };
+    GRand *rand = g_rand_new_with_seed(42);
+
+    w->samples = g_array_sized_new(FALSE, FALSE, sizeof(Sample), n_rows);
+    for (guint i = 0; i < n_rows; i++) {
+        Sample sample = {
+            .timestamp = 1700000000000000 + (gint64)i * 1000,
+            .sensor = g_rand_int_range(rand, 0, 4096),
+            .status = g_rand_int_range(rand, 0, 4),
+            .value = g_rand_double_range(rand, 0, 1000),
+            .weight = g_rand_double(rand)
+        };
+        g_array_append_val(w->samples, sample);
+    }
+    g_rand_free(rand);
+
+    w->table = column_table_new();
+    column_table_add_column(w->table, "timestamp", COLUMN_TYPE_INT64);
+    column_table_add_column(w->table, "sensor", COLUMN_TYPE_INT32);
+    column_table_add_column(w->table, "status", COLUMN_TYPE_INT32);
+    column_table_add_column(w->table, "value", COLUMN_TYPE_DOUBLE);
+    column_table_add_column(w->table, "weight", COLUMN_TYPE_DOUBLE);
+    column_table_append_structs(w->table, w->samples->data, n_rows, sizeof(Sample), offsets);
+
+    w->value = column_table_get_column(w->table, COL_VALUE);
+    w->sensor = column_table_get_column(w->table, COL_SENSOR);
+    w->weight = column_table_get_column(w->table, COL_WEIGHT);
+    w->indices = g_array_sized_new(FALSE, FALSE, sizeof(guint32), n_rows);
+    w->gathered = g_array_sized_new(FALSE, FALSE, sizeof(gdouble), n_rows);
+    column_filter_range_f64(w->value, 100, 200, w->indices);
+}
+
+static void workload_clear(Workload *w)
+{
+    g_array_unref(w->gathered);
+    g_array_unref(w->indices);
+    column_table_free(w->table);
+    g_array_unref(w->samples);
+}
+
+/* ============================================================
+ * GArray of structs
+ * ============================================================ */
+
+static void aos_sum_value_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        gdouble sum = 0;
+
+        for (guint i = 0; i < w->samples->len; i++) {
+            sum += g_array_index(w->samples, Sample, i).value;
+        }
+        bench_do_not_optimize(sum);
+    }
+}
+
+static void aos_sum_sensor_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        gint64 sum = 0;
+
+        for (guint i = 0; i < w->samples->len; i++) {
+            sum += g_array_index(w->samples, Sample, i).sensor;
+        }
+        bench_do_not_optimize(sum);
+    }
+}
+
+static void aos_min_max_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        gdouble min = G_MAXDOUBLE, max = -G_MAXDOUBLE;
+
+        for (guint i = 0; i < w->samples->len; i++) {
+            gdouble value = g_array_index(w->samples, Sample, i).value;
+
+            min = MIN(min, value);
+            max = MAX(max, value);
+        }
+        bench_do_not_optimize(min);
+        bench_do_not_optimize(max);
+    }
+}
+
+static void aos_filter_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+    GArray *indices = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+    for (guint64 it = 0; it < iterations; it++) {
+        g_array_set_size(indices, 0);
+        for (guint i = 0; i < w->samples->len; i++) {
+            gdouble value = g_array_index(w->samples, Sample, i).value;
+
+            if (value >= 100 && value < 200) {
+                g_array_append_val(indices, i);
+            }
+        }
+        bench_clobber();
+    }
+    g_array_unref(indices);
+}
+
+static void aos_gather_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        g_array_set_size(w->gathered, 0);
+        for (guint i = 0; i < w->indices->len; i++) {
+            guint32 row = g_array_index(w->indices, guint32, i);
+
+            g_array_append_val(w->gathered, g_array_index(w->samples, Sample, row).weight);
+        }
+        bench_clobber();
+    }
+}
+
+/* ============================================================
+ * ColumnTable
+ * ============================================================ */
+
+static void col_sum_value_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        bench_do_not_optimize(column_sum_f64(w->value));
+    }
+}
+
+static void col_sum_sensor_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        bench_do_not_optimize(column_sum_i32(w->sensor));
+    }
+}
+
+static void col_min_max_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+    gdouble min, max;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        column_min_max_f64(w->value, &min, &max);
+        bench_do_not_optimize(min);
+        bench_do_not_optimize(max);
+    }
+}
+
+static void col_filter_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+    GArray *indices = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+    for (guint64 it = 0; it < iterations; it++) {
+        g_array_set_size(indices, 0);
+        column_filter_range_f64(w->value, 100, 200, indices);
+        bench_clobber();
+    }
+    g_array_unref(indices);
+}
+
+static void col_gather_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        g_array_set_size(w->gathered, 0);
+        column_gather_f64(w->weight, w->indices, w->gathered);
+        bench_clobber();
+    }
+}
+
+static void col_parallel_sum_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        bench_do_not_optimize(column_sum_f64_parallel(w->value));
+    }
+}
+
+static void col_parallel_min_max_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+    gdouble min, max;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        column_min_max_f64_parallel(w->value, &min, &max);
+        bench_do_not_optimize(min);
+        bench_do_not_optimize(max);
+    }
+}
+
+/* ============================================================
+ * Driver
+ * ============================================================ */
+
+/* One operation is one row (one gathered row for gathers) */
+static void report(Bench *bench, Workload *w, const gchar *name, guint64 rows, BenchFunc func)
+{
+    const BenchResult *result = bench_run_ops(bench, name, rows, func, w);
+
+    if (w->baseline_ns > 0) {
+        g_print("  %-28s %12.1fx vs g_array_index\n", "", w->baseline_ns / result->median_ns);
+    }
+}
+
+static void run_pair(Bench *bench, Workload *w, const gchar *label, const gchar *op,
+                     guint64 rows, BenchFunc aos_func, BenchFunc col_func)
+{
+    static const ColumnImpl impls[] = {
+        COLUMN_IMPL_SCALAR, COLUMN_IMPL_AVX2, COLUMN_IMPL_AVX512, COLUMN_IMPL_NEON
+    };
+    gchar *name = g_strdup_printf("%s %s structs", label, op);
+
+    w->baseline_ns = 0;
+    w->baseline_ns = bench_run_ops(bench, name, rows, aos_func, w)->median_ns;
+    g_free(name);
+
+    for (guint i = 0; i < G_N_ELEMENTS(impls); i++) {
+        if (column_set_impl(impls[i])) {
+            name = g_strdup_printf("%s %s %s", label, op, column_get_impl_name());
+            report(bench, w, name, rows, col_func);
+            g_free(name);
+        }
+    }
+    column_set_impl(COLUMN_IMPL_AUTO);
+}
+
+static void run_suite(Bench *bench, guint n_rows, const gchar *label, gboolean parallel)
+{
+    Workload w = { 0 };
+    gchar *name;
+
+    workload_init(&w, n_rows);
+    g_print("\n%s: %u rows, %.1f MB as structs, %.1f MB per double column\n", label, n_rows,
+            n_rows * sizeof(Sample) / 1e6, n_rows * sizeof(gdouble) / 1e6);
+
+    run_pair(bench, &w, label, "sum value", n_rows, aos_sum_value_bench, col_sum_value_bench);
+    run_pair(bench, &w, label, "sum sensor", n_rows, aos_sum_sensor_bench, col_sum_sensor_bench);
+    run_pair(bench, &w, label, "min/max", n_rows, aos_min_max_bench, col_min_max_bench);
+    run_pair(bench, &w, label, "filter", n_rows, aos_filter_bench, col_filter_bench);
+    run_pair(bench, &w, label, "gather", w.indices->len, aos_gather_bench, col_gather_bench);
+
+    if (parallel) {
+        name = g_strdup_printf("%s sum value structs", label);
+        w.baseline_ns = 0;
+        w.baseline_ns = bench_run_ops(bench, name, n_rows, aos_sum_value_bench, &w)->median_ns;
+        g_free(name);
+        name = g_strdup_printf("%s sum value parallel", label);
+        report(bench, &w, name, n_rows, col_parallel_sum_bench);
+        g_free(name);
+        name = g_strdup_printf("%s min/max parallel", label);
+        report(bench, &w, name, n_rows, col_parallel_min_max_bench);
+        g_free(name);
+    }
+
+    workload_clear(&w);
+}
+
+int main(int argc, char *argv[])
+{
+    Bench *bench = bench_new("column_table_benchmark", &argc, &argv);
+    guint million = (argc > 1) ? (guint)g_ascii_strtoull(argv[1], NULL, 10) : 4;
+
+    if (million == 0 || million > 2000) {
+        g_printerr("Usage: %s [million-rows] [--bench-...]\n", argv[0]);
+        return 1;
+    }
+
+    g_print("=== GArray of structs vs ColumnTable (best implementation: %s, %u threads) ===\n",
+            column_get_impl_name(), g_get_num_processors());
+
+    run_suite(bench, SMALL_ROWS, "l2", FALSE);
+    run_suite(bench, million * 1000000, "large", TRUE);
+
+    g_print("\n=== Key Points ===\n");
+    g_print("1. A struct array drags every field through the cache to read one\n");
+    g_print("2. One GArray per field is dense, so each cache line is all useful data\n");
+    g_print("3. Dense columns vectorise: 4-16 values per instruction\n");
+    g_print("4. Filters produce row numbers; gathers fetch other columns for them\n");
+    g_print("5. Past L2 a single core is memory-bound; chunking across cores adds bandwidth\n");
+
+    bench_free(bench);
+    return 0;
+}
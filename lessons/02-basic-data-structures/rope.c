@@ -0,0 +1,567 @@
+/*
+ * rope.c - Chunked string builder for very large outputs
+ *
+ * See rope.h for the API. Bytes are only ever written past a block's
+ * fill level, so a piece's bytes never change once written and blocks
+ * can be shared freely. Only the rope that allocated a block (its tail)
+ * writes into it. It may extend its last piece in place only while that
+ * piece ends exactly at the block's fill level.
+ */
+
+#include "rope.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/* Appends smaller than this are copied rather than shared */
+#define MIN_SHARED_BYTES 1024
+
+typedef struct {
+    gint ref_count;
+    gsize size;
+    gsize used;                      /* Fill level; bytes below it are immutable */
+    GBytes *bytes;                   /* Set for adopted GBytes */
+    gchar *data;
+} RopeBlock;
+
+typedef struct {
+    RopeBlock *block;
+    gsize offset;
+    gsize len;
+} RopePiece;
+
+struct _Rope {
+    GArray *pieces;                  /* RopePiece, in order */
+    gsize len;
+    RopeBlock *tail;                 /* Where new bytes are written; may be NULL */
+    gsize block_size;
+};
+
+/* ============================================================
+ * Blocks
+ * ============================================================ */
+
+static RopeBlock *block_new(gsize size)
+{
+    RopeBlock *block = g_malloc(sizeof(RopeBlock) + size);
+
+    block->ref_count = 1;
+    block->size = size;
+    block->used = 0;
+    block->bytes = NULL;
+    block->data = (gchar *)(block + 1);
+    return block;
+}
+
+static RopeBlock *block_new_for_bytes(GBytes *bytes)
+{
+    RopeBlock *block = g_new(RopeBlock, 1);
+    gsize size;
+
+    block->ref_count = 1;
+    block->bytes = g_bytes_ref(bytes);
+    block->data = (gchar *)g_bytes_get_data(bytes, &size);
+    block->size = block->used = size;
+    return block;
+}
+
+static inline RopeBlock *block_ref(RopeBlock *block)
+{
+    g_atomic_int_inc(&block->ref_count);
+    return block;
+}
+
+static void block_unref(RopeBlock *block)
+{
+    if (block && g_atomic_int_dec_and_test(&block->ref_count)) {
+        if (block->bytes) {
+            g_bytes_unref(block->bytes);
+        }
+        g_free(block);
+    }
+}
+
+static void piece_clear(gpointer data)
+{
+    block_unref(((RopePiece *)data)->block);
+}
+
+static inline RopePiece *piece_at(Rope *rope, guint i)
+{
+    return &g_array_index(rope->pieces, RopePiece, i);
+}
+
+/* ============================================================
+ * Pieces
+ * ============================================================ */
+
+/* Index of the piece that starts at @pos, splitting one if @pos falls
+ * inside it. rope->pieces->len if @pos is the end. */
+static guint split_at(Rope *rope, gsize pos)
+{
+    gsize start = 0;
+
+    for (guint i = 0; i < rope->pieces->len; i++) {
+        RopePiece *piece = piece_at(rope, i);
+
+        if (pos == start) {
+            return i;
+        }
+        if (pos < start + piece->len) {
+            RopePiece right = {
+                block_ref(piece->block),
+                piece->offset + (pos - start),
+                piece->len - (pos - start)
+            };
+
+            piece->len = pos - start;
+            g_array_insert_val(rope->pieces, i + 1, right);
+            return i + 1;
+        }
+        start += piece->len;
+    }
+    return rope->pieces->len;
+}
+
+/* Make sure the tail has @min_room free bytes */
+static RopeBlock *ensure_room(Rope *rope, gsize min_room)
+{
+    RopeBlock *tail = rope->tail;
+
+    if (tail == NULL || tail->size - tail->used < min_room) {
+        block_unref(tail);
+        tail = rope->tail = block_new(MAX(rope->block_size, min_room));
+    }
+    return tail;
+}
+
+/* Record @n bytes just written at the tail's fill level as text before
+ * piece @index. Returns the index after it. */
+static guint commit(Rope *rope, guint index, gsize n)
+{
+    RopeBlock *tail = rope->tail;
+    RopePiece *prev = (index > 0) ? piece_at(rope, index - 1) : NULL;
+
+    if (n == 0) {
+        return index;            /* No empty pieces */
+    }
+
+    if (prev && prev->block == tail && prev->offset + prev->len == tail->used) {
+        prev->len += n;
+    } else {
+        RopePiece piece = { block_ref(tail), tail->used, n };
+        g_array_insert_val(rope->pieces, index, piece);
+        index++;
+    }
+
+    tail->used += n;
+    rope->len += n;
+    return index;
+}
+
+static void store(Rope *rope, guint index, const gchar *data, gsize len)
+{
+    while (len > 0) {
+        RopeBlock *tail = ensure_room(rope, 1);
+        gsize n = MIN(len, tail->size - tail->used);
+
+        /* Don't split one large write over a nearly full block */
+        if (n < len && n < rope->block_size / 8) {
+            tail = ensure_room(rope, MIN(len, rope->block_size));
+            n = MIN(len, tail->size - tail->used);
+        }
+
+        memcpy(tail->data + tail->used, data, n);
+        index = commit(rope, index, n);
+        data += n;
+        len -= n;
+    }
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+Rope *rope_new(void)
+{
+    return rope_sized_new(0);
+}
+
+Rope *rope_sized_new(gsize block_size)
+{
+    Rope *rope = g_new0(Rope, 1);
+
+    rope->pieces = g_array_new(FALSE, FALSE, sizeof(RopePiece));
+    g_array_set_clear_func(rope->pieces, piece_clear);
+    rope->block_size = block_size ? block_size : ROPE_DEFAULT_BLOCK_SIZE;
+    return rope;
+}
+
+void rope_free(Rope *rope)
+{
+    g_array_unref(rope->pieces);
+    block_unref(rope->tail);
+    g_free(rope);
+}
+
+Rope *rope_copy(Rope *rope)
+{
+    return rope_slice(rope, 0, rope->len);
+}
+
+Rope *rope_slice(Rope *rope, gsize start, gsize len)
+{
+    Rope *slice = rope_sized_new(rope->block_size);
+    gsize end, pos = 0;
+
+    g_return_val_if_fail(start <= rope->len, slice);
+    end = start + MIN(len, rope->len - start);
+
+    for (guint i = 0; i < rope->pieces->len && pos < end; i++) {
+        RopePiece *piece = piece_at(rope, i);
+        gsize piece_end = pos + piece->len;
+
+        if (piece_end > start) {
+            gsize from = MAX(pos, start), to = MIN(piece_end, end);
+            RopePiece part = { block_ref(piece->block), piece->offset + (from - pos), to - from };
+
+            g_array_append_val(slice->pieces, part);
+            slice->len += part.len;
+        }
+        pos = piece_end;
+    }
+    return slice;
+}
+
+gsize rope_length(Rope *rope)
+{
+    return rope->len;
+}
+
+guint rope_get_n_pieces(Rope *rope)
+{
+    return rope->pieces->len;
+}
+
+void rope_append(Rope *rope, const gchar *str)
+{
+    rope_append_len(rope, str, strlen(str));
+}
+
+void rope_append_len(Rope *rope, const gchar *data, gsize len)
+{
+    RopeBlock *tail = rope->tail;
+    guint n = rope->pieces->len;
+
+    /* Fast path: extend the last piece in place */
+    if (tail && n > 0 && len <= tail->size - tail->used) {
+        RopePiece *last = piece_at(rope, n - 1);
+
+        if (last->block == tail && last->offset + last->len == tail->used) {
+            memcpy(tail->data + tail->used, data, len);
+            tail->used += len;
+            last->len += len;
+            rope->len += len;
+            return;
+        }
+    }
+
+    store(rope, n, data, len);
+}
+
+void rope_append_c(Rope *rope, gchar c)
+{
+    rope_append_len(rope, &c, 1);
+}
+
+void rope_append_vprintf(Rope *rope, const gchar *format, va_list args)
+{
+    RopeBlock *tail = ensure_room(rope, 1);
+    gsize room = tail->size - tail->used;
+    va_list copy;
+    gint len;
+
+    /* Format straight into the free space; the NUL lands in free space
+     * too and isn't counted */
+    va_copy(copy, args);
+    len = vsnprintf(tail->data + tail->used, room, format, copy);
+    va_end(copy);
+    g_return_if_fail(len >= 0);
+
+    if (len == 0) {
+        return;
+    }
+
+    if ((gsize)len >= room) {
+        tail = ensure_room(rope, (gsize)len + 1);
+        va_copy(copy, args);
+        vsnprintf(tail->data + tail->used, (gsize)len + 1, format, copy);
+        va_end(copy);
+    }
+
+    commit(rope, rope->pieces->len, len);
+}
+
+void rope_append_printf(Rope *rope, const gchar *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    rope_append_vprintf(rope, format, args);
+    va_end(args);
+}
+
+void rope_append_bytes(Rope *rope, GBytes *bytes)
+{
+    gsize len;
+    const gchar *data = g_bytes_get_data(bytes, &len);
+
+    if (len < MIN_SHARED_BYTES) {
+        rope_append_len(rope, data, len);
+        return;
+    }
+
+    RopePiece piece = { block_new_for_bytes(bytes), 0, len };
+    g_array_append_val(rope->pieces, piece);
+    rope->len += len;
+}
+
+void rope_append_rope(Rope *rope, Rope *other)
+{
+    guint n = other->pieces->len;
+
+    /* Read the count first: @other may be @rope */
+    for (guint i = 0; i < n; i++) {
+        RopePiece piece = *piece_at(other, i);
+
+        block_ref(piece.block);
+        g_array_append_val(rope->pieces, piece);
+        rope->len += piece.len;
+    }
+}
+
+void rope_insert(Rope *rope, gsize pos, const gchar *str)
+{
+    rope_insert_len(rope, pos, str, strlen(str));
+}
+
+void rope_insert_len(Rope *rope, gsize pos, const gchar *data, gsize len)
+{
+    g_return_if_fail(pos <= rope->len);
+
+    if (pos == rope->len) {
+        rope_append_len(rope, data, len);
+        return;
+    }
+    store(rope, split_at(rope, pos), data, len);
+}
+
+void rope_prepend(Rope *rope, const gchar *str)
+{
+    rope_insert(rope, 0, str);
+}
+
+void rope_erase(Rope *rope, gsize pos, gsize len)
+{
+    g_return_if_fail(pos <= rope->len);
+
+    len = MIN(len, rope->len - pos);
+    if (len == 0) {
+        return;
+    }
+
+    guint first = split_at(rope, pos);
+    guint last = split_at(rope, pos + len);
+
+    g_array_remove_range(rope->pieces, first, last - first);
+    rope->len -= len;
+}
+
+gsize rope_copy_out(Rope *rope, gsize pos, gchar *dest, gsize len)
+{
+    gsize start = 0, copied = 0;
+
+    for (guint i = 0; i < rope->pieces->len && copied < len; i++) {
+        RopePiece *piece = piece_at(rope, i);
+
+        if (start + piece->len > pos) {
+            gsize skip = (pos > start) ? pos - start : 0;
+            gsize n = MIN(piece->len - skip, len - copied);
+
+            memcpy(dest + copied, piece->block->data + piece->offset + skip, n);
+            copied += n;
+        }
+        start += piece->len;
+    }
+    return copied;
+}
+
+gchar *rope_flatten(Rope *rope, gsize *len)
+{
+    gchar *str = g_malloc(rope->len + 1);
+
+    rope_copy_out(rope, 0, str, rope->len);
+    str[rope->len] = '\0';
+    if (len) {
+        *len = rope->len;
+    }
+    return str;
+}
+
+gboolean rope_foreach_chunk(Rope *rope, RopeChunkFunc func, gpointer user_data)
+{
+    for (guint i = 0; i < rope->pieces->len; i++) {
+        RopePiece *piece = piece_at(rope, i);
+
+        if (!func(piece->block->data + piece->offset, piece->len, user_data)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* ============================================================
+ * Gathered output
+ * ============================================================ */
+
+gboolean rope_write_fd(Rope *rope, gint fd, GError **error)
+{
+    struct iovec iov[MIN(IOV_MAX, 1024)];
+    guint next = 0;
+    gsize skip = 0;                  /* Bytes of piece @next already written */
+
+    for (;;) {
+        guint n = 0;
+
+        /* An empty piece would make writev() return 0 with nothing left */
+        while (next < rope->pieces->len && piece_at(rope, next)->len == skip) {
+            next++;
+            skip = 0;
+        }
+        if (next == rope->pieces->len) {
+            break;
+        }
+
+        for (guint i = next; i < rope->pieces->len && n < G_N_ELEMENTS(iov); i++) {
+            RopePiece *piece = piece_at(rope, i);
+            gsize offset = (i == next) ? skip : 0;
+
+            if (piece->len == offset) {
+                continue;
+            }
+            iov[n].iov_base = piece->block->data + piece->offset + offset;
+            iov[n].iov_len = piece->len - offset;
+            n++;
+        }
+
+        gssize written = writev(fd, iov, n);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            gint saved_errno = errno;
+            g_set_error(error, G_IO_ERROR, g_io_error_from_errno(saved_errno),
+                        "writev: %s", g_strerror(saved_errno));
+            return FALSE;
+        }
+
+        /* Advance past what was written, possibly mid-piece */
+        while (written > 0) {
+            gsize remaining = piece_at(rope, next)->len - skip;
+
+            if ((gsize)written >= remaining) {
+                written -= remaining;
+                next++;
+                skip = 0;
+            } else {
+                skip += written;
+                written = 0;
+            }
+        }
+    }
+    return TRUE;
+}
+
+static GOutputVector *make_vectors(Rope *rope)
+{
+    GOutputVector *vectors = g_new(GOutputVector, MAX(rope->pieces->len, 1));
+
+    for (guint i = 0; i < rope->pieces->len; i++) {
+        RopePiece *piece = piece_at(rope, i);
+
+        vectors[i].buffer = piece->block->data + piece->offset;
+        vectors[i].size = piece->len;
+    }
+    return vectors;
+}
+
+gboolean rope_write_to_stream(Rope *rope, GOutputStream *stream,
+                              GCancellable *cancellable, GError **error)
+{
+    GOutputVector *vectors = make_vectors(rope);
+    gboolean ok = g_output_stream_writev_all(stream, vectors, rope->pieces->len,
+                                             NULL, cancellable, error);
+
+    g_free(vectors);
+    return ok;
+}
+
+typedef struct {
+    Rope *copy;
+    GOutputVector *vectors;
+} WriteData;
+
+static void write_data_free(gpointer user_data)
+{
+    WriteData *data = user_data;
+
+    rope_free(data->copy);
+    g_free(data->vectors);
+    g_free(data);
+}
+
+static void on_writev_done(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+    GTask *task = user_data;
+    GError *error = NULL;
+
+    if (g_output_stream_writev_all_finish(G_OUTPUT_STREAM(source), result, NULL, &error)) {
+        g_task_return_boolean(task, TRUE);
+    } else {
+        g_task_return_error(task, error);
+    }
+    g_object_unref(task);
+}
+
+void rope_write_to_stream_async(Rope *rope, GOutputStream *stream, gint io_priority,
+                                GCancellable *cancellable,
+                                GAsyncReadyCallback callback, gpointer user_data)
+{
+    GTask *task = g_task_new(stream, cancellable, callback, user_data);
+    WriteData *data = g_new0(WriteData, 1);
+
+    g_task_set_source_tag(task, rope_write_to_stream_async);
+
+    /* The copy pins the blocks; the vectors belong to the write */
+    data->copy = rope_copy(rope);
+    data->vectors = make_vectors(data->copy);
+    g_task_set_task_data(task, data, write_data_free);
+
+    g_output_stream_writev_all_async(stream, data->vectors, data->copy->pieces->len,
+                                     io_priority, cancellable, on_writev_done, task);
+}
+
+gboolean rope_write_to_stream_finish(GOutputStream *stream, GAsyncResult *result,
+                                     GError **error)
+{
+    g_return_val_if_fail(g_task_is_valid(result, stream), FALSE);
+    return g_task_propagate_boolean(G_TASK(result), error);
+}
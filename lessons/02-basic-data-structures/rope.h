@@ -0,0 +1,95 @@
+/*
+ * rope.h - Chunked string builder for very large outputs
+ *
+ * A GString keeps its contents in one buffer. Growing it past a few
+ * hundred MB means reallocating and copying everything written so far,
+ * and g_string_insert()/prepend() move the whole tail. A Rope instead
+ * keeps a list of pieces, each a (block, offset, length) view into a
+ * reference-counted, write-once block:
+ *
+ *   - appends copy into the newest block and extend the last piece, so
+ *     they never move earlier bytes (O(1) amortised)
+ *   - insert and erase split at most two pieces and shift the piece
+ *     array, not the text: O(pieces) rather than O(bytes)
+ *   - slices, copies and rope_append_rope() share blocks instead of
+ *     copying bytes, and rope_append_bytes() adopts a GBytes
+ *   - rope_append_printf() formats straight into block memory, with no
+ *     temporary string
+ *   - rope_write_fd() and rope_write_to_stream() hand the pieces to
+ *     writev() or g_output_stream_writev_all() as they are, without
+ *     flattening them first
+ *
+ * A Rope is not thread-safe, but blocks are shared with atomic reference
+ * counts: a copy or slice may be handed to another thread.
+ */
+
+#ifndef ROPE_H
+#define ROPE_H
+
+#include <gio/gio.h>
+#include <stdarg.h>
+
+G_BEGIN_DECLS
+
+typedef struct _Rope Rope;
+
+#define ROPE_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+/* Return FALSE to stop */
+typedef gboolean (*RopeChunkFunc)(const gchar *data, gsize len, gpointer user_data);
+
+Rope *rope_new(void);
+/* @block_size 0 selects ROPE_DEFAULT_BLOCK_SIZE */
+Rope *rope_sized_new(gsize block_size);
+void rope_free(Rope *rope);
+
+/* O(pieces): the copy shares every block */
+Rope *rope_copy(Rope *rope);
+Rope *rope_slice(Rope *rope, gsize start, gsize len);
+
+gsize rope_length(Rope *rope);
+guint rope_get_n_pieces(Rope *rope);
+
+void rope_append(Rope *rope, const gchar *str);
+void rope_append_len(Rope *rope, const gchar *data, gsize len);
+void rope_append_c(Rope *rope, gchar c);
+void rope_append_printf(Rope *rope, const gchar *format, ...) G_GNUC_PRINTF(2, 3);
+void rope_append_vprintf(Rope *rope, const gchar *format, va_list args);
+
+/* Zero-copy for large @bytes (small ones are copied) */
+void rope_append_bytes(Rope *rope, GBytes *bytes);
+/* Shares @other's blocks; @other is unchanged */
+void rope_append_rope(Rope *rope, Rope *other);
+
+/* @pos may be rope_length() to append */
+void rope_insert(Rope *rope, gsize pos, const gchar *str);
+void rope_insert_len(Rope *rope, gsize pos, const gchar *data, gsize len);
+void rope_prepend(Rope *rope, const gchar *str);
+void rope_erase(Rope *rope, gsize pos, gsize len);
+
+/* Copy up to @len bytes from @pos into @dest; returns the number copied */
+gsize rope_copy_out(Rope *rope, gsize pos, gchar *dest, gsize len);
+/* One NUL-terminated buffer; free with g_free() */
+gchar *rope_flatten(Rope *rope, gsize *len);
+
+/* Visit the pieces in order, without copying */
+gboolean rope_foreach_chunk(Rope *rope, RopeChunkFunc func, gpointer user_data);
+
+/* writev() every piece to @fd, retrying short writes */
+gboolean rope_write_fd(Rope *rope, gint fd, GError **error);
+
+/* Gathered writes through g_output_stream_writev_all(). This works for
+ * any GOutputStream, including lesson 9's IoUringOutputStream. The
+ * async version writes a copy, so @rope may be changed or freed as soon
+ * as it returns. */
+gboolean rope_write_to_stream(Rope *rope, GOutputStream *stream,
+                              GCancellable *cancellable, GError **error);
+void rope_write_to_stream_async(Rope *rope, GOutputStream *stream, gint io_priority,
+                                GCancellable *cancellable,
+                                GAsyncReadyCallback callback, gpointer user_data);
+gboolean rope_write_to_stream_finish(GOutputStream *stream, GAsyncResult *result,
+                                     GError **error);
+
+G_END_DECLS
+
+#endif /* ROPE_H */
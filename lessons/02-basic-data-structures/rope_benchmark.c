@@ -0,0 +1,202 @@
+/*
+ * rope_benchmark.c - GString vs Rope for large outputs
+ *
+ * Times per line of output:
+ *   - append:   building a large output from 100-byte lines
+ *   - printf:   the same with append_printf() and a few fields per line
+ *   - prepend:  adding 100-byte lines at the front
+ *   - write:    flushing the finished output to /dev/null; GString with
+ *               one write(), Rope with writev() over its pieces
+ *
+ * Usage: ./rope_benchmark [output-mb] [--bench-...]   (default 64)
+ */
+
+#include "bench.h"
+#include "rope.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LINE_LEN 100
+#define PREPEND_LINES 5000
+
+typedef struct {
+    gsize lines;
+    gchar line[LINE_LEN + 1];
+    gint fd;
+    GString *string;
+    Rope *rope;
+} Workload;
+
+static void gstring_append_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        GString *str = g_string_new(NULL);
+
+        for (gsize i = 0; i < w->lines; i++) {
+            g_string_append_len(str, w->line, LINE_LEN);
+        }
+        g_string_free(str, TRUE);
+    }
+}
+
+static void rope_append_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        Rope *rope = rope_new();
+
+        for (gsize i = 0; i < w->lines; i++) {
+            rope_append_len(rope, w->line, LINE_LEN);
+        }
+        rope_free(rope);
+    }
+}
+
+static void gstring_printf_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        GString *str = g_string_new(NULL);
+
+        for (gsize i = 0; i < w->lines; i++) {
+            g_string_append_printf(str, "%" G_GSIZE_FORMAT ",%s,%.3f\n", i, "name", i * 0.5);
+        }
+        g_string_free(str, TRUE);
+    }
+}
+
+static void rope_printf_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        Rope *rope = rope_new();
+
+        for (gsize i = 0; i < w->lines; i++) {
+            rope_append_printf(rope, "%" G_GSIZE_FORMAT ",%s,%.3f\n", i, "name", i * 0.5);
+        }
+        rope_free(rope);
+    }
+}
+
+static void gstring_prepend_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        GString *str = g_string_new(NULL);
+
+        for (gsize i = 0; i < PREPEND_LINES; i++) {
+            g_string_prepend_len(str, w->line, LINE_LEN);
+        }
+        g_string_free(str, TRUE);
+    }
+}
+
+static void rope_prepend_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        Rope *rope = rope_new();
+
+        for (gsize i = 0; i < PREPEND_LINES; i++) {
+            rope_insert_len(rope, 0, w->line, LINE_LEN);
+        }
+        rope_free(rope);
+    }
+}
+
+static void gstring_write_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        gsize done = 0;
+
+        while (done < w->string->len) {
+            gssize n = write(w->fd, w->string->str + done, w->string->len - done);
+            if (n <= 0) {
+                break;
+            }
+            done += n;
+        }
+    }
+}
+
+static void rope_write_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        rope_write_fd(w->rope, w->fd, NULL);
+    }
+}
+
+static void run_pair(Bench *bench, Workload *w, const gchar *op, guint64 ops,
+                     BenchFunc gstring_func, BenchFunc rope_func)
+{
+    gchar *name;
+
+    name = g_strdup_printf("%s GString", op);
+    bench_run_ops(bench, name, ops, gstring_func, w);
+    g_free(name);
+
+    name = g_strdup_printf("%s Rope", op);
+    bench_run_ops(bench, name, ops, rope_func, w);
+    g_free(name);
+}
+
+int main(int argc, char *argv[])
+{
+    Bench *bench = bench_new("rope_benchmark", &argc, &argv);
+    gsize output_mb = (argc > 1) ? g_ascii_strtoull(argv[1], NULL, 10) : 64;
+    Workload w = { 0 };
+
+    if (output_mb == 0) {
+        g_printerr("Usage: %s [output-mb] [--bench-...]\n", argv[0]);
+        return 1;
+    }
+
+    w.lines = output_mb * 1024 * 1024 / LINE_LEN;
+    memset(w.line, 'x', LINE_LEN - 1);
+    w.line[LINE_LEN - 1] = '\n';
+
+    g_print("=== GString vs Rope (%" G_GSIZE_FORMAT " MB of output) ===\n\n", output_mb);
+
+    run_pair(bench, &w, "append", w.lines, gstring_append_bench, rope_append_bench);
+    run_pair(bench, &w, "printf", w.lines, gstring_printf_bench, rope_printf_bench);
+    run_pair(bench, &w, "prepend", PREPEND_LINES, gstring_prepend_bench, rope_prepend_bench);
+
+    w.fd = open("/dev/null", O_WRONLY);
+    if (w.fd >= 0) {
+        w.string = g_string_new(NULL);
+        w.rope = rope_new();
+        for (gsize i = 0; i < w.lines; i++) {
+            g_string_append_len(w.string, w.line, LINE_LEN);
+            rope_append_len(w.rope, w.line, LINE_LEN);
+        }
+        g_print("  (Rope output is %u pieces)\n", rope_get_n_pieces(w.rope));
+
+        run_pair(bench, &w, "write", w.lines, gstring_write_bench, rope_write_bench);
+
+        g_string_free(w.string, TRUE);
+        rope_free(w.rope);
+        close(w.fd);
+    }
+
+    g_print("\n=== Key Points ===\n");
+    g_print("1. GString's doubling copies the output again each time it grows\n");
+    g_print("2. Rope appends touch only the newest block\n");
+    g_print("3. Prepending to a GString moves the whole string; a Rope adds a piece\n");
+    g_print("4. writev() over 64 KiB pieces costs about the same as one big write()\n");
+
+    bench_free(bench);
+    return 0;
+}
@@ -0,0 +1,647 @@
+/*
+ * simd_text.c - Vectorised UTF-8 validation and text scanning
+ *
+ * See simd_text.h for the API. Each implementation provides four
+ * kernels, gathered in a SimdTextOps table chosen on first use:
+ *   - validate: index of the first invalid sequence, or len
+ *   - find_set / split: built on one primitive, a 64-bit mask of the
+ *     bytes in a 64-byte block that belong to the set, so a block with
+ *     several delimiters costs one scan instead of one call each
+ *   - fold: ASCII case folding
+ *
+ * The AVX2 code is compiled with target attributes and selected with
+ * __builtin_cpu_supports(), so the binary still runs on CPUs without
+ * AVX2. NEON is part of every AArch64 CPU and needs no check.
+ */
+
+#include "simd_text.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_AVX2 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define HAVE_NEON 1
+#endif
+
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+typedef guint64 (*MaskFunc)(const guint8 *block, const SimdTextSet *set);
+
+typedef struct {
+    SimdTextImpl impl;
+    const gchar *name;
+    gsize (*validate)(const guint8 *str, gsize len);
+    const guint8 *(*find_set)(const guint8 *str, gsize len, const SimdTextSet *set);
+    gsize (*split)(const guint8 *str, gsize len, const SimdTextSet *set, gboolean lines,
+                   SimdTextSpan *spans, gsize max_spans, gsize *consumed);
+    void (*fold)(guint8 *dest, const guint8 *src, gsize len, guint8 first);
+} SimdTextOps;
+
+/* ============================================================
+ * Shared pieces
+ * ============================================================ */
+
+/* Validate one sequence at a time. g_utf8_validate_len() rules: no
+ * overlong forms, surrogates, code points above U+10FFFF or NULs. */
+static gsize validate_scalar(const guint8 *s, gsize len)
+{
+    gsize i = 0;
+
+    while (i < len) {
+        /* Eight ASCII bytes at a time, stopping at any NUL */
+        while (len - i >= 8) {
+            guint64 word;
+            memcpy(&word, s + i, 8);
+            if (((word | ((word - 0x0101010101010101ull) & ~word)) & 0x8080808080808080ull) != 0) {
+                break;
+            }
+            i += 8;
+        }
+        if (i == len) {
+            break;
+        }
+
+        guint8 c = s[i];
+        guint32 cp, min;
+        gsize n;
+
+        if (c < 0x80) {
+            if (c == 0) {
+                return i;
+            }
+            i++;
+            continue;
+        } else if ((c & 0xe0) == 0xc0) {
+            n = 1, cp = c & 0x1f, min = 0x80;
+        } else if ((c & 0xf0) == 0xe0) {
+            n = 2, cp = c & 0x0f, min = 0x800;
+        } else if ((c & 0xf8) == 0xf0) {
+            n = 3, cp = c & 0x07, min = 0x10000;
+        } else {
+            return i;
+        }
+
+        if (len - i <= n) {
+            return i;
+        }
+        for (gsize k = 1; k <= n; k++) {
+            if ((s[i + k] & 0xc0) != 0x80) {
+                return i;
+            }
+            cp = (cp << 6) | (s[i + k] & 0x3f);
+        }
+        if (cp < min || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)) {
+            return i;
+        }
+        i += n + 1;
+    }
+    return len;
+}
+
+/* A vector kernel found an error in the block at @block, or stopped
+ * there for lack of a full block. Everything before it is valid apart
+ * from, possibly, a sequence that starts in the last 3 bytes, so
+ * back up to that sequence's lead byte and finish one byte at a time. */
+static gsize validate_finish(const guint8 *s, gsize len, gsize block)
+{
+    gsize start = block;
+
+    for (gsize back = 1; back <= 3 && back <= block; back++) {
+        if ((s[block - back] & 0xc0) != 0x80) {
+            if (s[block - back] >= 0xc0) {
+                start = block - back;
+            }
+            break;
+        }
+    }
+    return start + validate_scalar(s + start, len - start);
+}
+
+static inline gboolean set_contains(const SimdTextSet *set, guint8 c)
+{
+    return (set->bitmap[c >> 3] >> (c & 7)) & 1;
+}
+
+/* Mask for the last, partial block: pad a copy and drop the padding */
+static ALWAYS_INLINE guint64 tail_mask(const guint8 *block, gsize n, const SimdTextSet *set,
+                                       MaskFunc mask64)
+{
+    guint8 buf[64] = { 0 };
+
+    memcpy(buf, block, n);
+    return mask64(buf, set) & ((G_GUINT64_CONSTANT(1) << n) - 1);
+}
+
+static ALWAYS_INLINE const guint8 *find_set_generic(const guint8 *s, gsize len,
+                                                    const SimdTextSet *set, MaskFunc mask64)
+{
+    for (gsize block = 0; block < len; block += 64) {
+        gsize n = len - block;
+        guint64 m = (n >= 64) ? mask64(s + block, set) : tail_mask(s + block, n, set, mask64);
+
+        if (m) {
+            return s + block + __builtin_ctzll(m);
+        }
+    }
+    return NULL;
+}
+
+static inline void emit(const guint8 *s, gsize start, gsize end, gboolean lines, SimdTextSpan *span)
+{
+    if (lines && end > start && s[end - 1] == '\r') {
+        end--;
+    }
+    span->data = (const gchar *)s + start;
+    span->len = end - start;
+}
+
+static ALWAYS_INLINE gsize split_generic(const guint8 *s, gsize len, const SimdTextSet *set,
+                                         gboolean lines, SimdTextSpan *spans, gsize max_spans,
+                                         gsize *consumed, MaskFunc mask64)
+{
+    gsize count = 0, start = 0;
+
+    for (gsize block = 0; block < len && count < max_spans; block += 64) {
+        gsize n = len - block;
+        guint64 m = (n >= 64) ? mask64(s + block, set) : tail_mask(s + block, n, set, mask64);
+
+        /* One span per set bit, lowest first */
+        while (m) {
+            gsize pos = block + __builtin_ctzll(m);
+
+            m &= m - 1;
+            emit(s, start, pos, lines, &spans[count++]);
+            start = pos + 1;
+            if (count == max_spans) {
+                goto out;
+            }
+        }
+    }
+
+    /* The rest, unless it is an empty final line */
+    if (count < max_spans && (lines ? start < len : len > 0)) {
+        emit(s, start, len, lines, &spans[count++]);
+        start = len;
+    }
+
+out:
+    if (consumed) {
+        *consumed = start;
+    }
+    return count;
+}
+
+/* ============================================================
+ * Scalar
+ * ============================================================ */
+
+static guint64 mask64_scalar(const guint8 *block, const SimdTextSet *set)
+{
+    guint64 m = 0;
+
+    for (guint i = 0; i < 64; i++) {
+        m |= (guint64)set_contains(set, block[i]) << i;
+    }
+    return m;
+}
+
+static const guint8 *find_set_scalar(const guint8 *s, gsize len, const SimdTextSet *set)
+{
+    for (gsize i = 0; i < len; i++) {
+        if (set_contains(set, s[i])) {
+            return s + i;
+        }
+    }
+    return NULL;
+}
+
+static gsize split_scalar(const guint8 *s, gsize len, const SimdTextSet *set, gboolean lines,
+                          SimdTextSpan *spans, gsize max_spans, gsize *consumed)
+{
+    return split_generic(s, len, set, lines, spans, max_spans, consumed, mask64_scalar);
+}
+
+/* Branch-free, so the compiler is free to vectorise it */
+static void fold_scalar(guint8 *dest, const guint8 *src, gsize len, guint8 first)
+{
+    for (gsize i = 0; i < len; i++) {
+        guint8 c = src[i];
+        dest[i] = c ^ ((guint8)(c - first) < 26 ? 0x20 : 0);
+    }
+}
+
+static const SimdTextOps scalar_ops = {
+    SIMD_TEXT_IMPL_SCALAR, "scalar", validate_scalar, find_set_scalar, split_scalar, fold_scalar
+};
+
+/* ============================================================
+ * UTF-8 lookup tables (Keiser & Lemire)
+ *
+ * Each error class gets a bit. For every byte, three 16-entry tables
+ * indexed by the high nibble of the previous byte, its low nibble and
+ * the high nibble of this byte give the classes that pair could be
+ * in; their AND is non-zero only for an invalid pair.
+ * ============================================================ */
+
+#define TOO_SHORT       (1 << 0)     /* 11______ 0_______ or 11______ 11______ */
+#define TOO_LONG        (1 << 1)     /* 0_______ 10______ */
+#define OVERLONG_3      (1 << 2)     /* 11100000 100_____ */
+#define TOO_LARGE       (1 << 3)     /* 11110100 1001____ and above */
+#define SURROGATE       (1 << 4)     /* 11101101 101_____ */
+#define OVERLONG_2      (1 << 5)     /* 1100000_ 10______ */
+#define TOO_LARGE_1000  (1 << 6)     /* 11110101 1000____ and above */
+#define OVERLONG_4      (1 << 6)     /* 11110000 1000____ */
+#define TWO_CONTS       (1 << 7)     /* 10______ 10______ (allowed after 3- and 4-byte leads) */
+#define CARRY           (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+static const guint8 byte_1_high[16] = {
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,          /* 0_______ */
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,      /* 10______ */
+    TOO_SHORT | OVERLONG_2,                          /* 1100____ */
+    TOO_SHORT,                                       /* 1101____ */
+    TOO_SHORT | OVERLONG_3 | SURROGATE,              /* 1110____ */
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4  /* 1111____ */
+};
+
+static const guint8 byte_1_low[16] = {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,    /* ____0000 */
+    CARRY | OVERLONG_2,                              /* ____0001 */
+    CARRY,                                           /* ____001_ */
+    CARRY,
+    CARRY | TOO_LARGE,                               /* ____0100 */
+    CARRY | TOO_LARGE | TOO_LARGE_1000,              /* ____0101 and up */
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,  /* ____1101 */
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000
+};
+
+static const guint8 byte_2_high[16] = {
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,      /* 0_______ */
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,  /* 1000____ */
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,                   /* 1001____ */
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,                    /* 101_____ */
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT       /* 11______ */
+};
+
+/* Anything above these in the last three bytes of a block starts a
+ * sequence that continues into the next one */
+static const guint8 incomplete_max[32] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    0xf0 - 1, 0xe0 - 1, 0xc0 - 1
+};
+
+/* ============================================================
+ * AVX2
+ * ============================================================ */
+
+#ifdef HAVE_AVX2
+
+TARGET_AVX2 static inline __m256i load_table_avx2(const guint8 *table)
+{
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)table));
+}
+
+/* The 32 bytes ending @n bytes into @input, the rest taken from @prev */
+#define PREV_AVX2(input, prev, n) \
+    _mm256_alignr_epi8((input), _mm256_permute2x128_si256((prev), (input), 0x21), 16 - (n))
+
+TARGET_AVX2 static gsize validate_avx2(const guint8 *s, gsize len)
+{
+    const __m256i b1h = load_table_avx2(byte_1_high);
+    const __m256i b1l = load_table_avx2(byte_1_low);
+    const __m256i b2h = load_table_avx2(byte_2_high);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i max = _mm256_loadu_si256((const __m256i *)incomplete_max);
+    __m256i prev_input = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+    gsize block;
+
+    for (block = 0; block + 32 <= len; block += 32) {
+        __m256i input = _mm256_loadu_si256((const __m256i *)(s + block));
+        __m256i error = _mm256_cmpeq_epi8(input, _mm256_setzero_si256());
+
+        if (_mm256_movemask_epi8(input) == 0) {
+            /* All ASCII: only an unfinished sequence from before can fail */
+            error = _mm256_or_si256(error, prev_incomplete);
+            prev_incomplete = _mm256_setzero_si256();
+        } else {
+            __m256i prev1 = PREV_AVX2(input, prev_input, 1);
+            __m256i special = _mm256_and_si256(
+                _mm256_and_si256(
+                    _mm256_shuffle_epi8(b1h, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+                    _mm256_shuffle_epi8(b1l, _mm256_and_si256(prev1, nibble))),
+                _mm256_shuffle_epi8(b2h, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+
+            /* Bytes 2 and 3 after a 3- or 4-byte lead must be continuations,
+             * which is exactly where special has TWO_CONTS (0x80) set */
+            __m256i third = _mm256_subs_epu8(PREV_AVX2(input, prev_input, 2), _mm256_set1_epi8(0xe0 - 0x80));
+            __m256i fourth = _mm256_subs_epu8(PREV_AVX2(input, prev_input, 3), _mm256_set1_epi8(0xf0 - 0x80));
+            __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+
+            error = _mm256_or_si256(error, _mm256_xor_si256(must23, special));
+            prev_incomplete = _mm256_subs_epu8(input, max);
+        }
+
+        if (!_mm256_testz_si256(error, error)) {
+            return validate_finish(s, len, block);
+        }
+        prev_input = input;
+    }
+    return validate_finish(s, len, block);
+}
+
+TARGET_AVX2 static inline guint32 mask32_avx2(const guint8 *p, __m256i lo_table, __m256i hi_table)
+{
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i hit = _mm256_and_si256(
+        _mm256_shuffle_epi8(lo_table, _mm256_and_si256(v, nibble)),
+        _mm256_shuffle_epi8(hi_table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+
+    return ~(guint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hit, _mm256_setzero_si256()));
+}
+
+TARGET_AVX2 static inline guint64 mask64_avx2(const guint8 *block, const SimdTextSet *set)
+{
+    __m256i lo_table = load_table_avx2(set->lo);
+    __m256i hi_table = load_table_avx2(set->hi);
+
+    return mask32_avx2(block, lo_table, hi_table) |
+           ((guint64)mask32_avx2(block + 32, lo_table, hi_table) << 32);
+}
+
+TARGET_AVX2 static const guint8 *find_set_avx2(const guint8 *s, gsize len, const SimdTextSet *set)
+{
+    return find_set_generic(s, len, set, mask64_avx2);
+}
+
+TARGET_AVX2 static gsize split_avx2(const guint8 *s, gsize len, const SimdTextSet *set,
+                                    gboolean lines, SimdTextSpan *spans, gsize max_spans,
+                                    gsize *consumed)
+{
+    return split_generic(s, len, set, lines, spans, max_spans, consumed, mask64_avx2);
+}
+
+TARGET_AVX2 static void fold_avx2(guint8 *dest, const guint8 *src, gsize len, guint8 first)
+{
+    /* Shift the letters to -128..-103 so one signed compare finds them */
+    const __m256i shift = _mm256_set1_epi8((char)(0x80 - first));
+    const __m256i limit = _mm256_set1_epi8(-128 + 26);
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    gsize i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i letter = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, shift));
+
+        _mm256_storeu_si256((__m256i *)(dest + i), _mm256_xor_si256(v, _mm256_and_si256(letter, flip)));
+    }
+    fold_scalar(dest + i, src + i, len - i, first);
+}
+
+static const SimdTextOps avx2_ops = {
+    SIMD_TEXT_IMPL_AVX2, "avx2", validate_avx2, find_set_avx2, split_avx2, fold_avx2
+};
+
+#endif /* HAVE_AVX2 */
+
+/* ============================================================
+ * NEON
+ * ============================================================ */
+
+#ifdef HAVE_NEON
+
+static gsize validate_neon(const guint8 *s, gsize len)
+{
+    const uint8x16_t b1h = vld1q_u8(byte_1_high);
+    const uint8x16_t b1l = vld1q_u8(byte_1_low);
+    const uint8x16_t b2h = vld1q_u8(byte_2_high);
+    const uint8x16_t nibble = vdupq_n_u8(0x0f);
+    const uint8x16_t max = vld1q_u8(incomplete_max + 16);
+    uint8x16_t prev_input = vdupq_n_u8(0);
+    uint8x16_t prev_incomplete = vdupq_n_u8(0);
+    gsize block;
+
+    for (block = 0; block + 16 <= len; block += 16) {
+        uint8x16_t input = vld1q_u8(s + block);
+        uint8x16_t error = vceqq_u8(input, vdupq_n_u8(0));
+
+        if (vmaxvq_u8(input) < 0x80) {
+            error = vorrq_u8(error, prev_incomplete);
+            prev_incomplete = vdupq_n_u8(0);
+        } else {
+            uint8x16_t prev1 = vextq_u8(prev_input, input, 15);
+            uint8x16_t special = vandq_u8(
+                vandq_u8(vqtbl1q_u8(b1h, vshrq_n_u8(prev1, 4)), vqtbl1q_u8(b1l, vandq_u8(prev1, nibble))),
+                vqtbl1q_u8(b2h, vshrq_n_u8(input, 4)));
+            uint8x16_t third = vqsubq_u8(vextq_u8(prev_input, input, 14), vdupq_n_u8(0xe0 - 0x80));
+            uint8x16_t fourth = vqsubq_u8(vextq_u8(prev_input, input, 13), vdupq_n_u8(0xf0 - 0x80));
+            uint8x16_t must23 = vandq_u8(vorrq_u8(third, fourth), vdupq_n_u8(0x80));
+
+            error = vorrq_u8(error, veorq_u8(must23, special));
+            prev_incomplete = vqsubq_u8(input, max);
+        }
+
+        if (vmaxvq_u8(error) != 0) {
+            return validate_finish(s, len, block);
+        }
+        prev_input = input;
+    }
+    return validate_finish(s, len, block);
+}
+
+static inline uint8x16_t match16_neon(const guint8 *p, uint8x16_t lo_table, uint8x16_t hi_table)
+{
+    uint8x16_t v = vld1q_u8(p);
+    uint8x16_t hit = vandq_u8(vqtbl1q_u8(lo_table, vandq_u8(v, vdupq_n_u8(0x0f))),
+                              vqtbl1q_u8(hi_table, vshrq_n_u8(v, 4)));
+    return vtstq_u8(hit, hit);
+}
+
+static inline guint64 mask64_neon(const guint8 *block, const SimdTextSet *set)
+{
+    static const guint8 bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    const uint8x16_t weight = vld1q_u8(bits);
+    uint8x16_t lo_table = vld1q_u8(set->lo);
+    uint8x16_t hi_table = vld1q_u8(set->hi);
+
+    /* Weight each matching byte by its bit, then add neighbours together
+     * until each byte holds the mask of 8 input bytes */
+    uint8x16_t m0 = vandq_u8(match16_neon(block, lo_table, hi_table), weight);
+    uint8x16_t m1 = vandq_u8(match16_neon(block + 16, lo_table, hi_table), weight);
+    uint8x16_t m2 = vandq_u8(match16_neon(block + 32, lo_table, hi_table), weight);
+    uint8x16_t m3 = vandq_u8(match16_neon(block + 48, lo_table, hi_table), weight);
+    uint8x16_t sum = vpaddq_u8(vpaddq_u8(m0, m1), vpaddq_u8(m2, m3));
+
+    sum = vpaddq_u8(sum, sum);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+}
+
+static const guint8 *find_set_neon(const guint8 *s, gsize len, const SimdTextSet *set)
+{
+    return find_set_generic(s, len, set, mask64_neon);
+}
+
+static gsize split_neon(const guint8 *s, gsize len, const SimdTextSet *set, gboolean lines,
+                        SimdTextSpan *spans, gsize max_spans, gsize *consumed)
+{
+    return split_generic(s, len, set, lines, spans, max_spans, consumed, mask64_neon);
+}
+
+static void fold_neon(guint8 *dest, const guint8 *src, gsize len, guint8 first)
+{
+    const uint8x16_t base = vdupq_n_u8(first);
+    const uint8x16_t flip = vdupq_n_u8(0x20);
+    gsize i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        uint8x16_t letter = vcltq_u8(vsubq_u8(v, base), vdupq_n_u8(26));
+
+        vst1q_u8(dest + i, veorq_u8(v, vandq_u8(letter, flip)));
+    }
+    fold_scalar(dest + i, src + i, len - i, first);
+}
+
+static const SimdTextOps neon_ops = {
+    SIMD_TEXT_IMPL_NEON, "neon", validate_neon, find_set_neon, split_neon, fold_neon
+};
+
+#endif /* HAVE_NEON */
+
+/* ============================================================
+ * Dispatch
+ * ============================================================ */
+
+static const SimdTextOps *current_ops;
+
+static const SimdTextOps *find_ops(SimdTextImpl impl)
+{
+#ifdef HAVE_AVX2
+    if (impl == SIMD_TEXT_IMPL_AVX2 || impl == SIMD_TEXT_IMPL_AUTO) {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return &avx2_ops;
+        }
+    }
+#endif
+#ifdef HAVE_NEON
+    if (impl == SIMD_TEXT_IMPL_NEON || impl == SIMD_TEXT_IMPL_AUTO) {
+        return &neon_ops;
+    }
+#endif
+    if (impl == SIMD_TEXT_IMPL_SCALAR || impl == SIMD_TEXT_IMPL_AUTO) {
+        return &scalar_ops;
+    }
+    return NULL;
+}
+
+static inline const SimdTextOps *get_ops(void)
+{
+    const SimdTextOps *ops = g_atomic_pointer_get(&current_ops);
+
+    /* Racing first calls pick the same table, so no lock is needed */
+    if (G_UNLIKELY(ops == NULL)) {
+        ops = find_ops(SIMD_TEXT_IMPL_AUTO);
+        g_atomic_pointer_set(&current_ops, ops);
+    }
+    return ops;
+}
+
+gboolean simd_text_set_impl(SimdTextImpl impl)
+{
+    const SimdTextOps *ops = find_ops(impl);
+
+    if (ops == NULL) {
+        return FALSE;
+    }
+    g_atomic_pointer_set(&current_ops, ops);
+    return TRUE;
+}
+
+const gchar *simd_text_get_impl_name(void)
+{
+    return get_ops()->name;
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+gboolean simd_text_utf8_validate(const gchar *str, gsize len, const gchar **end)
+{
+    gsize valid = get_ops()->validate((const guint8 *)str, len);
+
+    if (end) {
+        *end = str + valid;
+    }
+    return valid == len;
+}
+
+gboolean simd_text_set_init(SimdTextSet *set, const gchar *chars)
+{
+    memset(set, 0, sizeof(*set));
+
+    for (const guint8 *c = (const guint8 *)chars; *c; c++) {
+        if (*c >= 0x80) {
+            memset(set, 0, sizeof(*set));
+            return FALSE;
+        }
+        set->lo[*c & 0x0f] |= 1 << (*c >> 4);
+        set->bitmap[*c >> 3] |= 1 << (*c & 7);
+    }
+    /* High nibbles 8-15 get no bit, so bytes >= 0x80 never match */
+    for (guint h = 0; h < 8; h++) {
+        set->hi[h] = 1 << h;
+    }
+    return TRUE;
+}
+
+const gchar *simd_text_find_set(const gchar *str, gsize len, const SimdTextSet *set)
+{
+    return (const gchar *)get_ops()->find_set((const guint8 *)str, len, set);
+}
+
+gsize simd_text_split_lines(const gchar *str, gsize len,
+                            SimdTextSpan *spans, gsize max_spans, gsize *consumed)
+{
+    /* simd_text_set_init(&newline, "\n"), worked out by hand */
+    static const SimdTextSet newline = {
+        .lo = { ['\n' & 0x0f] = 1 << ('\n' >> 4) },
+        .hi = { 1, 2, 4, 8, 16, 32, 64, 128 },
+        .bitmap = { ['\n' >> 3] = 1 << ('\n' & 7) }
+    };
+
+    return get_ops()->split((const guint8 *)str, len, &newline, TRUE, spans, max_spans, consumed);
+}
+
+gsize simd_text_split_set(const gchar *str, gsize len, const SimdTextSet *delims,
+                          SimdTextSpan *spans, gsize max_spans, gsize *consumed)
+{
+    return get_ops()->split((const guint8 *)str, len, delims, FALSE, spans, max_spans, consumed);
+}
+
+void simd_text_ascii_down(gchar *dest, const gchar *src, gsize len)
+{
+    get_ops()->fold((guint8 *)dest, (const guint8 *)src, len, 'A');
+}
+
+void simd_text_ascii_up(gchar *dest, const gchar *src, gsize len)
+{
+    get_ops()->fold((guint8 *)dest, (const guint8 *)src, len, 'a');
+}
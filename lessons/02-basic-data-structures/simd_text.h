@@ -0,0 +1,86 @@
+/*
+ * simd_text.h - Vectorised UTF-8 validation and text scanning
+ *
+ * g_utf8_validate(), g_strsplit() and g_ascii_strdown() look at one byte
+ * at a time. These functions do the same jobs 32 or 64 bytes at a time:
+ *
+ *   - simd_text_utf8_validate() checks UTF-8 with the lookup-table method
+ *     of Keiser and Lemire ("Validating UTF-8 In Less Than One Instruction
+ *     Per Byte"): three table lookups per block classify every pair of
+ *     adjacent bytes, plus a check that continuations follow 3- and
+ *     4-byte leads
+ *   - simd_text_find_set() finds the first byte from a set of up to 256
+ *     ASCII characters with two nibble-table lookups per block
+ *   - simd_text_split_lines() and simd_text_split_set() turn a buffer
+ *     into spans in a caller-owned array, without allocating or copying
+ *     tokens
+ *   - simd_text_ascii_down()/up() fold ASCII case, in place if wanted
+ *
+ * The implementation is chosen at run time: AVX2 when the CPU has it,
+ * NEON on AArch64, otherwise portable scalar code.
+ * simd_text_set_impl() forces one, to compare them.
+ *
+ * Results match GLib: simd_text_utf8_validate() accepts exactly what
+ * g_utf8_validate_len() accepts, including rejecting NUL bytes.
+ */
+
+#ifndef SIMD_TEXT_H
+#define SIMD_TEXT_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+    SIMD_TEXT_IMPL_AUTO,         /* Best the CPU supports */
+    SIMD_TEXT_IMPL_SCALAR,
+    SIMD_TEXT_IMPL_AVX2,
+    SIMD_TEXT_IMPL_NEON
+} SimdTextImpl;
+
+/* Returns FALSE if the CPU or build lacks @impl */
+gboolean simd_text_set_impl(SimdTextImpl impl);
+const gchar *simd_text_get_impl_name(void);
+
+/* Same contract as g_utf8_validate_len(): on failure @end (if not NULL)
+ * points at the first byte of the first invalid sequence */
+gboolean simd_text_utf8_validate(const gchar *str, gsize len, const gchar **end);
+
+/* A set of bytes to search for */
+typedef struct {
+    guint8 lo[16];               /* Per low nibble: bit n set if (n << 4 | low) is in the set */
+    guint8 hi[16];               /* Per high nibble: its bit for lo[], 0 above 0x7f */
+    guint8 bitmap[32];           /* For the scalar code */
+} SimdTextSet;
+
+/* @chars must be ASCII; returns FALSE otherwise */
+gboolean simd_text_set_init(SimdTextSet *set, const gchar *chars);
+
+/* First byte of @str in @set, or NULL (like a length-bounded strpbrk()) */
+const gchar *simd_text_find_set(const gchar *str, gsize len, const SimdTextSet *set);
+
+/* A view into the input; no NUL terminator */
+typedef struct {
+    const gchar *data;
+    gsize len;
+} SimdTextSpan;
+
+/* Split at '\n', dropping a '\r' before it. Fills at most @max_spans
+ * and returns how many; @consumed (if not NULL) is the number of input
+ * bytes covered, so a full array can be continued from str + consumed.
+ * Text after the last newline is one more line. */
+gsize simd_text_split_lines(const gchar *str, gsize len,
+                            SimdTextSpan *spans, gsize max_spans, gsize *consumed);
+
+/* Split at any byte in @delims, like g_strsplit_set(): adjacent
+ * delimiters give empty spans, and @len bytes give delimiters + 1 spans */
+gsize simd_text_split_set(const gchar *str, gsize len, const SimdTextSet *delims,
+                          SimdTextSpan *spans, gsize max_spans, gsize *consumed);
+
+/* Fold 'A'-'Z' / 'a'-'z' only; @dest may be @src */
+void simd_text_ascii_down(gchar *dest, const gchar *src, gsize len);
+void simd_text_ascii_up(gchar *dest, const gchar *src, gsize len);
+
+G_END_DECLS
+
+#endif /* SIMD_TEXT_H */
@@ -0,0 +1,304 @@
+/*
+ * simd_text_benchmark.c - simd_text vs the GLib string functions
+ *
+ * Throughput in GB/s over a large buffer of ASCII log lines and over
+ * mixed-script UTF-8 text:
+ *   - validate:    g_utf8_validate_len() vs simd_text_utf8_validate()
+ *   - find:        strcspn() vs simd_text_find_set() for a byte that only
+ *                  occurs at the end
+ *   - lines:       g_strsplit(buf, "\n") vs simd_text_split_lines() into
+ *                  a reused span array
+ *   - split set:   g_strsplit_set(buf, ",;\n") vs simd_text_split_set()
+ *   - fold:        g_ascii_strdown() vs simd_text_ascii_down()
+ *
+ * Every simd_text row runs once per implementation the CPU supports,
+ * so the scalar fallback is measured too.
+ *
+ * Usage: ./simd_text_benchmark [buffer-mb] [--bench-...]   (default 16)
+ */
+
+#include "bench.h"
+#include "simd_text.h"
+
+#include <string.h>
+
+#define SPAN_BATCH 4096
+
+typedef struct {
+    gchar *text;                 /* NUL-terminated */
+    gsize len;
+    gchar *out;
+    SimdTextSet delims;
+    SimdTextSet rare;
+    SimdTextSpan spans[SPAN_BATCH];
+} Workload;
+
+/* ============================================================
+ * Inputs
+ * ============================================================ */
+
+static void fill_ascii(Workload *w)
+{
+    GString *text = g_string_sized_new(w->len + 128);
+    guint i = 0;
+
+    while (text->len < w->len) {
+        g_string_append_printf(text, "2024-05-01T12:%02u:%02u INFO Worker-%u handled GET /api/items/%u,status=200;bytes=%u\n",
+                               i / 60 % 60, i % 60, i % 16, i * 7919 % 100000, i * 31 % 65536);
+        i++;
+    }
+    g_string_truncate(text, w->len);
+    w->text = g_string_free(text, FALSE);
+}
+
+static void fill_utf8(Workload *w)
+{
+    static const gchar *words[] = {
+        "hello", "naïve", "café", "Grüße", "Ελληνικά", "русский", "日本語", "中文",
+        "한국어", "עברית", "العربية", "emoji😀", "🚀rocket", "plain", "ascii", "text"
+    };
+    GString *text = g_string_sized_new(w->len + 128);
+    guint32 state = 2463534242u;
+
+    while (text->len < w->len) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        g_string_append(text, words[state % G_N_ELEMENTS(words)]);
+        g_string_append_c(text, (state >> 8) % 12 == 0 ? '\n' : ' ');
+    }
+
+    /* Cut at a character boundary and end with ASCII, which
+     * run_suite() overwrites */
+    gsize len = w->len - 1;
+    while ((text->str[len] & 0xc0) == 0x80) {
+        len--;
+    }
+    g_string_truncate(text, len);
+    g_string_append_c(text, ' ');
+    w->len = text->len;
+    w->text = g_string_free(text, FALSE);
+}
+
+/* ============================================================
+ * GLib and libc
+ * ============================================================ */
+
+static void glib_validate_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        bench_do_not_optimize(g_utf8_validate_len(w->text, w->len, NULL));
+    }
+}
+
+static void libc_find_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        bench_do_not_optimize(strcspn(w->text, "#"));
+    }
+}
+
+static void glib_lines_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        g_strfreev(g_strsplit(w->text, "\n", -1));
+    }
+}
+
+static void glib_split_set_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        g_strfreev(g_strsplit_set(w->text, ",;\n", -1));
+    }
+}
+
+static void glib_fold_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        g_free(g_ascii_strdown(w->text, w->len));
+    }
+}
+
+/* ============================================================
+ * simd_text
+ * ============================================================ */
+
+static void simd_validate_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        bench_do_not_optimize(simd_text_utf8_validate(w->text, w->len, NULL));
+    }
+}
+
+static void simd_find_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        bench_do_not_optimize(simd_text_find_set(w->text, w->len, &w->rare));
+    }
+}
+
+static void simd_lines_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        gsize done = 0, consumed;
+
+        while (done < w->len) {
+            simd_text_split_lines(w->text + done, w->len - done, w->spans, SPAN_BATCH, &consumed);
+            bench_clobber();
+            done += consumed;
+        }
+    }
+}
+
+static void simd_split_set_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        gsize done = 0, consumed;
+
+        while (done < w->len) {
+            simd_text_split_set(w->text + done, w->len - done, &w->delims, w->spans, SPAN_BATCH, &consumed);
+            bench_clobber();
+            done += consumed;
+        }
+    }
+}
+
+static void simd_fold_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        simd_text_ascii_down(w->out, w->text, w->len);
+        bench_clobber();
+    }
+}
+
+/* ============================================================
+ * Driver
+ * ============================================================ */
+
+static void report(Bench *bench, Workload *w, const gchar *name, BenchFunc func)
+{
+    /* One operation is one KiB, so median_ns / 1024 is ns per byte */
+    const BenchResult *result = bench_run_ops(bench, name, w->len / 1024, func, w);
+
+    g_print("  %-28s %12.2f GB/s\n", "", 1024.0 / result->median_ns);
+}
+
+static void run_simd(Bench *bench, Workload *w, const gchar *op, BenchFunc func)
+{
+    static const SimdTextImpl impls[] = {
+        SIMD_TEXT_IMPL_SCALAR, SIMD_TEXT_IMPL_AVX2, SIMD_TEXT_IMPL_NEON
+    };
+
+    for (guint i = 0; i < G_N_ELEMENTS(impls); i++) {
+        if (simd_text_set_impl(impls[i])) {
+            gchar *name = g_strdup_printf("%s %s", op, simd_text_get_impl_name());
+            report(bench, w, name, func);
+            g_free(name);
+        }
+    }
+    simd_text_set_impl(SIMD_TEXT_IMPL_AUTO);
+}
+
+static void run_suite(Bench *bench, Workload *w, const gchar *label)
+{
+    gchar *name;
+
+    g_print("\n%s, %" G_GSIZE_FORMAT " MB:\n", label, w->len >> 20);
+
+    name = g_strdup_printf("%s validate GLib", label);
+    report(bench, w, name, glib_validate_bench);
+    g_free(name);
+    name = g_strdup_printf("%s validate", label);
+    run_simd(bench, w, name, simd_validate_bench);
+    g_free(name);
+
+    /* The byte strcspn() and find_set() look for is the last one */
+    w->text[w->len - 1] = '#';
+    name = g_strdup_printf("%s find strcspn", label);
+    report(bench, w, name, libc_find_bench);
+    g_free(name);
+    name = g_strdup_printf("%s find", label);
+    run_simd(bench, w, name, simd_find_bench);
+    g_free(name);
+    w->text[w->len - 1] = ' ';
+
+    name = g_strdup_printf("%s lines GLib", label);
+    report(bench, w, name, glib_lines_bench);
+    g_free(name);
+    name = g_strdup_printf("%s lines", label);
+    run_simd(bench, w, name, simd_lines_bench);
+    g_free(name);
+
+    name = g_strdup_printf("%s split set GLib", label);
+    report(bench, w, name, glib_split_set_bench);
+    g_free(name);
+    name = g_strdup_printf("%s split set", label);
+    run_simd(bench, w, name, simd_split_set_bench);
+    g_free(name);
+
+    name = g_strdup_printf("%s fold GLib", label);
+    report(bench, w, name, glib_fold_bench);
+    g_free(name);
+    name = g_strdup_printf("%s fold", label);
+    run_simd(bench, w, name, simd_fold_bench);
+    g_free(name);
+}
+
+int main(int argc, char *argv[])
+{
+    Bench *bench = bench_new("simd_text_benchmark", &argc, &argv);
+    gsize buffer_mb = (argc > 1) ? g_ascii_strtoull(argv[1], NULL, 10) : 16;
+    Workload w = { 0 };
+
+    if (buffer_mb == 0) {
+        g_printerr("Usage: %s [buffer-mb] [--bench-...]\n", argv[0]);
+        return 1;
+    }
+
+    simd_text_set_init(&w.delims, ",;\n");
+    simd_text_set_init(&w.rare, "#");
+
+    g_print("=== simd_text vs GLib (best implementation: %s) ===\n", simd_text_get_impl_name());
+
+    w.len = buffer_mb << 20;
+    w.out = g_malloc(w.len);
+    fill_ascii(&w);
+    run_suite(bench, &w, "ascii");
+    g_free(w.text);
+
+    w.len = buffer_mb << 20;
+    fill_utf8(&w);
+    run_suite(bench, &w, "utf8");
+    g_free(w.text);
+    g_free(w.out);
+
+    g_print("\n=== Key Points ===\n");
+    g_print("1. GLib walks strings a byte at a time; vector code checks 32-64 bytes per step\n");
+    g_print("2. UTF-8 validation is three table lookups per block, not a branch per byte\n");
+    g_print("3. One 64-bit match mask per block yields every delimiter without rescanning\n");
+    g_print("4. Spans into the input replace one allocation and copy per token\n");
+    g_print("5. Dispatch happens once at run time, so one binary suits every CPU\n");
+
+    bench_free(bench);
+    return 0;
+}
@@ -0,0 +1,211 @@
+/*
+ * idle_scheduler.c - Time-sliced background work as a single GSource
+ *
+ * The source is ready (ready time 0) while it has tasks and asleep (-1)
+ * otherwise, so an empty scheduler adds nothing to poll(). A dispatch
+ * takes the task at the head of the queue, runs one batch of it, puts
+ * it back at the tail and repeats until the budget is gone.
+ *
+ * The batch size is CHECK_US divided by the task's cost per call, an
+ * exponential moving average of what the previous batches measured.
+ * g_get_monotonic_time() only has microsecond resolution, so a batch
+ * that finished within the same microsecond is counted as taking one:
+ * cheap tasks are overestimated at first and their batches grow over a
+ * few rounds instead of overshooting the slice.
+ */
+
+#include "idle_scheduler.h"
+
+#define DEFAULT_BUDGET_US 2000
+#define MAX_BATCH 4096
+
+typedef struct {
+    GSourceFunc func;
+    gpointer user_data;
+    GDestroyNotify notify;
+    gdouble cost_ns;                   /* Per call; 0 until first measured */
+} IdleTask;
+
+struct _IdleScheduler {
+    GSource source;
+    gint64 budget_us;
+    GQueue tasks;                      /* Of IdleTask, next to run at the head */
+    GPtrArray *yield_to;               /* Sources whose deadline ends a slice */
+    guint64 dispatches;
+    guint64 calls;
+    guint64 yields;
+    gint64 busy_us;
+};
+
+static void idle_task_free(IdleTask *task)
+{
+    if (task->notify) {
+        task->notify(task->user_data);
+    }
+    g_free(task);
+}
+
+static guint batch_size(IdleTask *task, gint64 remaining_us)
+{
+    gint64 slice_us = MIN(remaining_us, IDLE_SCHEDULER_CHECK_US);
+
+    if (task->cost_ns <= 0) {
+        return 1;
+    }
+    return (guint)CLAMP(slice_us * 1000.0 / task->cost_ns, 1, MAX_BATCH);
+}
+
+static void update_cost(IdleTask *task, gint64 elapsed_us, guint calls)
+{
+    gdouble sample = MAX(elapsed_us, 1) * 1000.0 / calls;
+
+    task->cost_ns = (task->cost_ns <= 0) ? sample : 0.75 * task->cost_ns + 0.25 * sample;
+}
+
+static gboolean should_yield(IdleScheduler *self, gint64 now)
+{
+    for (guint i = 0; i < self->yield_to->len; ) {
+        GSource *source = g_ptr_array_index(self->yield_to, i);
+
+        if (g_source_is_destroyed(source)) {
+            g_ptr_array_remove_index_fast(self->yield_to, i);
+            continue;
+        }
+
+        gint64 ready_time = g_source_get_ready_time(source);
+
+        if (ready_time >= 0 && ready_time <= now) {
+            return TRUE;
+        }
+        i++;
+    }
+    return FALSE;
+}
+
+/* ============================================================
+ * GSource
+ * ============================================================ */
+
+static gboolean idle_scheduler_dispatch(GSource *source,
+                                        GSourceFunc callback,
+                                        gpointer user_data)
+{
+    IdleScheduler *self = (IdleScheduler *)source;
+    gint64 start = g_get_monotonic_time();
+    gint64 end = start + self->budget_us;
+    gint64 now = start;
+
+    self->dispatches++;
+
+    while (!g_queue_is_empty(&self->tasks)) {
+        /* Off the queue while it runs, so it may add tasks */
+        IdleTask *task = g_queue_pop_head(&self->tasks);
+        guint batch = batch_size(task, end - now);
+        gboolean again = G_SOURCE_CONTINUE;
+        guint calls = 0;
+
+        while (calls < batch && again) {
+            again = task->func(task->user_data);
+            calls++;
+        }
+
+        gint64 after = g_get_monotonic_time();
+
+        update_cost(task, after - now, calls);
+        self->calls += calls;
+        now = after;
+
+        if (again) {
+            g_queue_push_tail(&self->tasks, task);
+        } else {
+            idle_task_free(task);
+        }
+
+        if (now >= end) {
+            break;
+        }
+        if (should_yield(self, now)) {
+            self->yields++;
+            break;
+        }
+    }
+
+    self->busy_us += now - start;
+    g_source_set_ready_time(source, g_queue_is_empty(&self->tasks) ? -1 : 0);
+    return G_SOURCE_CONTINUE;
+}
+
+static void idle_scheduler_finalize(GSource *source)
+{
+    IdleScheduler *self = (IdleScheduler *)source;
+
+    g_queue_clear_full(&self->tasks, (GDestroyNotify)idle_task_free);
+    g_ptr_array_unref(self->yield_to);
+}
+
+static GSourceFuncs idle_scheduler_funcs = {
+    NULL,
+    NULL,
+    idle_scheduler_dispatch,
+    idle_scheduler_finalize,
+    NULL, /* closure_callback */
+    NULL  /* closure_marshal */
+};
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+IdleScheduler *idle_scheduler_new(guint budget_us)
+{
+    IdleScheduler *self = (IdleScheduler *)g_source_new(&idle_scheduler_funcs,
+                                                        sizeof(IdleScheduler));
+
+    g_source_set_name((GSource *)self, "IdleScheduler");
+    g_source_set_priority((GSource *)self, G_PRIORITY_DEFAULT_IDLE);
+    self->budget_us = budget_us ? budget_us : DEFAULT_BUDGET_US;
+    g_queue_init(&self->tasks);
+    self->yield_to = g_ptr_array_new_with_free_func((GDestroyNotify)g_source_unref);
+
+    return self;
+}
+
+void idle_scheduler_add(IdleScheduler *scheduler,
+                        GSourceFunc func,
+                        gpointer user_data,
+                        GDestroyNotify notify)
+{
+    IdleTask *task;
+
+    g_return_if_fail(scheduler != NULL);
+    g_return_if_fail(func != NULL);
+
+    task = g_new0(IdleTask, 1);
+    task->func = func;
+    task->user_data = user_data;
+    task->notify = notify;
+    g_queue_push_tail(&scheduler->tasks, task);
+
+    g_source_set_ready_time((GSource *)scheduler, 0);
+}
+
+void idle_scheduler_yield_to(IdleScheduler *scheduler, GSource *source)
+{
+    g_return_if_fail(scheduler != NULL);
+    g_return_if_fail(source != NULL);
+
+    g_ptr_array_add(scheduler->yield_to, g_source_ref(source));
+}
+
+guint idle_scheduler_get_n_tasks(IdleScheduler *scheduler)
+{
+    return g_queue_get_length(&scheduler->tasks);
+}
+
+void idle_scheduler_get_stats(IdleScheduler *scheduler, IdleSchedulerStats *stats)
+{
+    stats->dispatches = scheduler->dispatches;
+    stats->calls = scheduler->calls;
+    stats->yields = scheduler->yields;
+    stats->busy_us = scheduler->busy_us;
+}
@@ -0,0 +1,62 @@
+/*
+ * idle_scheduler.h - Time-sliced background work as a single GSource
+ *
+ * A g_idle_add() callback that handles one work item per call pays a
+ * whole main-loop iteration (prepare, poll, check, dispatch) per item.
+ * An IdleScheduler runs any number of idle tasks from one source:
+ *
+ *   - each dispatch calls tasks round-robin until a time budget
+ *     (2 ms by default) is spent, then goes back to the loop
+ *   - per task, the cost of one call is measured as it runs, and calls
+ *     are made in batches sized to about IDLE_SCHEDULER_CHECK_US of
+ *     work, so the clock is read once per batch rather than per call
+ *   - between batches the scheduler yields early if a source it was
+ *     told about with idle_scheduler_yield_to() has come due
+ *
+ * Tasks are GSourceFuncs, as for g_idle_add(): each call does one item
+ * and returns G_SOURCE_REMOVE when the task is finished. The scheduler
+ * is a GSource at G_PRIORITY_DEFAULT_IDLE: attach it with
+ * g_source_attach((GSource *)scheduler, context).
+ */
+
+#ifndef IDLE_SCHEDULER_H
+#define IDLE_SCHEDULER_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define IDLE_SCHEDULER_CHECK_US 50
+
+typedef struct _IdleScheduler IdleScheduler;
+
+typedef struct {
+    guint64 dispatches;
+    guint64 calls;             /* Task calls across all dispatches */
+    guint64 yields;            /* Slices cut short for a due source */
+    gint64 busy_us;            /* Time spent in task calls */
+} IdleSchedulerStats;
+
+/* A @budget_us of 0 means 2000 */
+IdleScheduler *idle_scheduler_new(guint budget_us);
+
+/* Call @func(@user_data) repeatedly until it returns G_SOURCE_REMOVE,
+ * then @notify(@user_data) */
+void idle_scheduler_add(IdleScheduler *scheduler,
+                        GSourceFunc func,
+                        gpointer user_data,
+                        GDestroyNotify notify);
+
+/* End the current slice as soon as @source's ready time has passed.
+ * GLib timeouts keep their deadline in the ready time, so this covers
+ * them as well as custom sources that use g_source_set_ready_time().
+ * Holds a reference until @source is destroyed. */
+void idle_scheduler_yield_to(IdleScheduler *scheduler, GSource *source);
+
+guint idle_scheduler_get_n_tasks(IdleScheduler *scheduler);
+
+void idle_scheduler_get_stats(IdleScheduler *scheduler, IdleSchedulerStats *stats);
+
+G_END_DECLS
+
+#endif /* IDLE_SCHEDULER_H */
@@ -0,0 +1,149 @@
+/*
+ * idle_scheduler_benchmark.c - One item per idle dispatch vs time slices
+ *
+ * Small work items (a few hundred ns each) are processed in the
+ * background while a G_PRIORITY_HIGH timeout ticks every TIMER_MS:
+ *   - g_idle_add(), one item per call, as process_work() in
+ *     idle_example.c does
+ *   - an IdleScheduler with a 0.5, 2 and 8 ms budget per dispatch
+ *   - the 8 ms budget again, told to yield to the timer
+ *
+ * bench_run() times each per item; one iteration is one item. The timer
+ * ticks throughout, and afterwards the items per dispatch and how late
+ * the timer fired are printed: the timer cannot run until the idle
+ * dispatch in progress returns.
+ *
+ * Usage: ./idle_scheduler_benchmark [--bench-...]
+ */
+
+#include "bench.h"
+#include "idle_scheduler.h"
+
+#define TIMER_MS 5
+#define ITEM_SPIN 200
+
+typedef struct {
+    const gchar *name;
+    guint budget_us;                 /* 0 = g_idle_add() */
+    gboolean yield;
+
+    GMainLoop *loop;
+    IdleScheduler *scheduler;
+    guint64 remaining;
+    guint64 items;                   /* Across every bench_run() call */
+    guint64 dispatches;
+    guint ticks;
+    gint64 total_late_us;
+    gint64 worst_late_us;
+} Mode;
+
+static gboolean process_item(gpointer user_data)
+{
+    Mode *mode = user_data;
+
+    /* Stand-in for one unit of background work */
+    for (volatile guint i = 0; i < ITEM_SPIN; i++);
+
+    if (--mode->remaining == 0) {
+        g_main_loop_quit(mode->loop);
+        return G_SOURCE_REMOVE;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean on_tick(gpointer user_data)
+{
+    Mode *mode = user_data;
+    gint64 late = g_get_monotonic_time() - g_source_get_ready_time(g_main_current_source());
+
+    mode->ticks++;
+    mode->total_late_us += late;
+    mode->worst_late_us = MAX(mode->worst_late_us, late);
+    return G_SOURCE_CONTINUE;
+}
+
+static void items_bench(guint64 iterations, gpointer user_data)
+{
+    Mode *mode = user_data;
+
+    mode->remaining = iterations;
+    mode->items += iterations;
+    if (mode->scheduler) {
+        idle_scheduler_add(mode->scheduler, process_item, mode, NULL);
+    } else {
+        g_idle_add(process_item, mode);
+    }
+    g_main_loop_run(mode->loop);
+}
+
+static void run_mode(Bench *bench, Mode *mode)
+{
+    GSource *timer = g_timeout_source_new(TIMER_MS);
+
+    mode->loop = g_main_loop_new(NULL, FALSE);
+    g_source_set_priority(timer, G_PRIORITY_HIGH);
+    g_source_set_callback(timer, on_tick, mode, NULL);
+    g_source_attach(timer, NULL);
+
+    if (mode->budget_us > 0) {
+        mode->scheduler = idle_scheduler_new(mode->budget_us);
+        if (mode->yield) {
+            idle_scheduler_yield_to(mode->scheduler, timer);
+        }
+        g_source_attach((GSource *)mode->scheduler, NULL);
+    }
+
+    bench_run(bench, mode->name, items_bench, mode);
+
+    mode->dispatches = mode->items;
+    if (mode->scheduler) {
+        IdleSchedulerStats stats;
+
+        idle_scheduler_get_stats(mode->scheduler, &stats);
+        mode->dispatches = stats.dispatches;
+        g_source_destroy((GSource *)mode->scheduler);
+        g_source_unref((GSource *)mode->scheduler);
+    }
+    g_source_destroy(timer);
+    g_source_unref(timer);
+    g_main_loop_unref(mode->loop);
+}
+
+int main(int argc, char *argv[])
+{
+    Bench *bench = bench_new("idle_scheduler_benchmark", &argc, &argv);
+    Mode modes[] = {
+        { .name = "g_idle_add, 1 item/dispatch" },
+        { .name = "scheduler, 0.5 ms budget", .budget_us = 500 },
+        { .name = "scheduler, 2 ms budget", .budget_us = 2000 },
+        { .name = "scheduler, 8 ms budget", .budget_us = 8000 },
+        { .name = "scheduler, 8 ms + yield", .budget_us = 8000, .yield = TRUE },
+    };
+
+    g_print("=== Idle Scheduler Benchmark ===\n\n");
+    g_print("Background items, G_PRIORITY_HIGH timer every %d ms (time per item)\n", TIMER_MS);
+
+    for (guint m = 0; m < G_N_ELEMENTS(modes); m++) {
+        run_mode(bench, &modes[m]);
+    }
+
+    g_print("\n%-28s %14s %10s %10s\n", "Mode", "Items/dispatch", "Late avg", "Late max");
+    for (guint m = 0; m < G_N_ELEMENTS(modes); m++) {
+        Mode *mode = &modes[m];
+
+        g_print("%-28s %14.1f %10.2f %10.2f\n", mode->name,
+                (gdouble)mode->items / MAX(mode->dispatches, 1),
+                mode->ticks ? mode->total_late_us / 1000.0 / mode->ticks : 0.0,
+                mode->worst_late_us / 1000.0);
+    }
+    g_print("(lateness in ms)\n");
+
+    g_print("\n=== Key Takeaways ===\n");
+    g_print("- One item per idle dispatch pays a full loop iteration per item\n");
+    g_print("- A time budget amortises that iteration over thousands of items\n");
+    g_print("- The budget is also the worst delay a higher-priority timer sees\n");
+    g_print("- Yielding to a due source keeps a long budget without the delay\n");
+
+    bench_free(bench);
+    return 0;
+}
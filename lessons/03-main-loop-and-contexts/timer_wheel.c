@@ -0,0 +1,371 @@
+/*
+ * timer_wheel.c - Hierarchical timer wheel as a single GSource
+ *
+ * Time is counted in ticks since the wheel was created. A timer whose
+ * expiry tick first differs from the wheel's current tick in 6-bit digit
+ * L lives in slot (digit L of its expiry) of level L. That digit is
+ * always ahead of the current tick's digit L, so no slot ever holds
+ * timers from two rotations. When the current tick reaches the slot's
+ * start (digit L equal, lower digits zero) the slot is emptied and its
+ * timers are placed again; they land in a lower level, or fire.
+ *
+ * The next interesting tick is the first occupied slot after the
+ * current digit in the lowest non-empty level, which the occupancy
+ * masks give in one count-trailing-zeros per level. Idle stretches are
+ * skipped in one step rather than walked tick by tick.
+ */
+
+#include "timer_wheel.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#define LEVELS 8
+#define SLOT_BITS 6
+#define SLOTS (1 << SLOT_BITS)
+#define SLOT_MASK (SLOTS - 1)
+#define MAX_TICK ((G_GUINT64_CONSTANT(1) << (LEVELS * SLOT_BITS)) - 1)
+
+#define SLOT_NONE G_MAXUINT32          /* Not armed */
+#define SLOT_DUE (G_MAXUINT32 - 1)     /* On the list dispatch is firing */
+#define TICK_NONE G_MAXUINT64
+
+struct _TimerWheel {
+    GSource source;
+    GPollFD poll_fd;                   /* The timerfd */
+    gint64 base_time;                  /* Monotonic time of tick 0 */
+    gint64 tick_us;
+    guint64 slack_ticks;
+    guint64 now;                       /* Last tick processed */
+    guint64 armed;                     /* Tick the timerfd is set for */
+    gboolean rearm;                    /* The next deadline may have moved */
+    guint n_timers;
+    guint64 masks[LEVELS];             /* Bit s set while slots[l][s] is non-empty */
+    TimerWheelTimer *slots[LEVELS][SLOTS];
+    TimerWheelTimer *due;
+};
+
+/* ============================================================
+ * Slots
+ * ============================================================ */
+
+static TimerWheelTimer **list_head(TimerWheel *wheel, guint32 slot)
+{
+    if (slot == SLOT_DUE) {
+        return &wheel->due;
+    }
+    return &wheel->slots[slot / SLOTS][slot % SLOTS];
+}
+
+static void link_timer(TimerWheel *wheel, TimerWheelTimer *timer, guint32 slot)
+{
+    TimerWheelTimer **head = list_head(wheel, slot);
+
+    timer->prev = NULL;
+    timer->next = *head;
+    if (*head) {
+        (*head)->prev = timer;
+    }
+    *head = timer;
+    timer->slot = slot;
+
+    if (slot != SLOT_DUE) {
+        wheel->masks[slot / SLOTS] |= G_GUINT64_CONSTANT(1) << (slot % SLOTS);
+    }
+}
+
+static void unlink_timer(TimerWheel *wheel, TimerWheelTimer *timer)
+{
+    TimerWheelTimer **head = list_head(wheel, timer->slot);
+
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        *head = timer->next;
+    }
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    }
+
+    if (*head == NULL && timer->slot != SLOT_DUE) {
+        wheel->masks[timer->slot / SLOTS] &= ~(G_GUINT64_CONSTANT(1) << (timer->slot % SLOTS));
+    }
+    timer->slot = SLOT_NONE;
+}
+
+/* @timer->expires must be after wheel->now */
+static void place_timer(TimerWheel *wheel, TimerWheelTimer *timer)
+{
+    guint level = (63 - __builtin_clzll(timer->expires ^ wheel->now)) / SLOT_BITS;
+    guint slot = (timer->expires >> (level * SLOT_BITS)) & SLOT_MASK;
+
+    link_timer(wheel, timer, level * SLOTS + slot);
+}
+
+/* The next tick at which a slot fires or cascades, or TICK_NONE */
+static guint64 next_tick(TimerWheel *wheel)
+{
+    for (guint level = 0; level < LEVELS; level++) {
+        guint shift = level * SLOT_BITS;
+        guint digit = (wheel->now >> shift) & SLOT_MASK;
+        guint64 later = (digit == SLOT_MASK) ? 0 : wheel->masks[level] & (~G_GUINT64_CONSTANT(0) << (digit + 1));
+
+        if (later) {
+            /* Higher digits stay those of now, lower ones are zero */
+            guint64 upper = wheel->now >> (shift + SLOT_BITS) << (shift + SLOT_BITS);
+            return upper | ((guint64)__builtin_ctzll(later) << shift);
+        }
+    }
+    return TICK_NONE;
+}
+
+/* Move the wheel to @target, collecting everything due on wheel->due */
+static void advance(TimerWheel *wheel, guint64 target)
+{
+    while (wheel->now < target) {
+        guint64 tick = next_tick(wheel);
+
+        if (tick > target) {
+            wheel->now = target;
+            return;
+        }
+        wheel->now = tick;
+
+        /* Highest level first, so cascaded timers are placed before the
+         * lower slots they might land in are emptied */
+        for (gint level = LEVELS - 1; level >= 0; level--) {
+            guint shift = level * SLOT_BITS;
+            guint slot = (tick >> shift) & SLOT_MASK;
+            TimerWheelTimer *timer, *next;
+
+            if ((tick & ((G_GUINT64_CONSTANT(1) << shift) - 1)) != 0 ||
+                (timer = wheel->slots[level][slot]) == NULL) {
+                continue;
+            }
+
+            wheel->slots[level][slot] = NULL;
+            wheel->masks[level] &= ~(G_GUINT64_CONSTANT(1) << slot);
+            for (; timer; timer = next) {
+                next = timer->next;
+                if (timer->expires <= tick) {
+                    link_timer(wheel, timer, SLOT_DUE);
+                } else {
+                    place_timer(wheel, timer);
+                }
+            }
+        }
+    }
+}
+
+static guint64 current_tick(TimerWheel *wheel)
+{
+    return (g_get_monotonic_time() - wheel->base_time) / wheel->tick_us;
+}
+
+/* g_get_monotonic_time() is CLOCK_MONOTONIC, so deadlines map straight
+ * onto an absolute timerfd */
+static void arm_timerfd(TimerWheel *wheel, guint64 tick)
+{
+    struct itimerspec spec;
+
+    if (tick == wheel->armed) {
+        return;
+    }
+
+    memset(&spec, 0, sizeof(spec));
+    if (tick != TICK_NONE) {
+        gint64 when = wheel->base_time + (gint64)tick * wheel->tick_us;
+
+        spec.it_value.tv_sec = when / G_USEC_PER_SEC;
+        spec.it_value.tv_nsec = (when % G_USEC_PER_SEC) * 1000;
+    }
+
+    if (timerfd_settime(wheel->poll_fd.fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+        g_warning("timerfd_settime failed: %s", g_strerror(errno));
+        return;
+    }
+    wheel->armed = tick;
+}
+
+/* ============================================================
+ * GSource
+ * ============================================================ */
+
+static gboolean timer_wheel_prepare(GSource *source, gint *timeout)
+{
+    TimerWheel *wheel = (TimerWheel *)source;
+
+    /* One timerfd_settime() per iteration at most, however many timers
+     * were added since the last one */
+    if (wheel->rearm) {
+        wheel->rearm = FALSE;
+        arm_timerfd(wheel, next_tick(wheel));
+    }
+
+    /* The timerfd wakes poll(); the context needs no timeout from us */
+    *timeout = -1;
+    return FALSE;
+}
+
+static gboolean timer_wheel_check(GSource *source)
+{
+    TimerWheel *wheel = (TimerWheel *)source;
+
+    return (wheel->poll_fd.revents & G_IO_IN) != 0;
+}
+
+static gboolean timer_wheel_dispatch(GSource *source,
+                                     GSourceFunc callback,
+                                     gpointer user_data)
+{
+    TimerWheel *wheel = (TimerWheel *)source;
+    guint64 expirations;
+
+    /* Clear the timerfd, which is now disarmed; the wheel itself knows
+     * what is due */
+    if (read(wheel->poll_fd.fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+        g_warning("timerfd read failed: %s", g_strerror(errno));
+    }
+    wheel->armed = TICK_NONE;
+    wheel->rearm = TRUE;
+
+    advance(wheel, current_tick(wheel));
+
+    /* Callbacks may arm, re-arm or cancel any timer, including others
+     * on this list */
+    while (wheel->due) {
+        TimerWheelTimer *timer = wheel->due;
+
+        unlink_timer(wheel, timer);
+        wheel->n_timers--;
+        timer->func(wheel, timer, timer->user_data);
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void disarm_list(TimerWheelTimer *timer)
+{
+    for (; timer; timer = timer->next) {
+        timer->slot = SLOT_NONE;
+    }
+}
+
+static void timer_wheel_finalize(GSource *source)
+{
+    TimerWheel *wheel = (TimerWheel *)source;
+
+    for (guint level = 0; level < LEVELS; level++) {
+        for (guint slot = 0; slot < SLOTS; slot++) {
+            disarm_list(wheel->slots[level][slot]);
+        }
+    }
+    disarm_list(wheel->due);
+    close(wheel->poll_fd.fd);
+}
+
+static GSourceFuncs timer_wheel_funcs = {
+    timer_wheel_prepare,
+    timer_wheel_check,
+    timer_wheel_dispatch,
+    timer_wheel_finalize,
+    NULL, /* closure_callback */
+    NULL  /* closure_marshal */
+};
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+TimerWheel *timer_wheel_new(guint tick_ms, guint slack_ms, GError **error)
+{
+    gint fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (fd < 0) {
+        gint saved_errno = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                    "timerfd_create failed: %s", g_strerror(saved_errno));
+        return NULL;
+    }
+
+    TimerWheel *wheel = (TimerWheel *)g_source_new(&timer_wheel_funcs, sizeof(TimerWheel));
+
+    g_source_set_name((GSource *)wheel, "TimerWheel");
+    wheel->tick_us = (gint64)MAX(tick_ms, 1) * 1000;
+    wheel->slack_ticks = MAX((slack_ms * G_GUINT64_CONSTANT(1000)) / wheel->tick_us, 1);
+    wheel->base_time = g_get_monotonic_time();
+    wheel->armed = TICK_NONE;
+
+    wheel->poll_fd.fd = fd;
+    wheel->poll_fd.events = G_IO_IN;
+    g_source_add_poll((GSource *)wheel, &wheel->poll_fd);
+
+    return wheel;
+}
+
+void timer_wheel_timer_init(TimerWheelTimer *timer,
+                            TimerWheelFunc func,
+                            gpointer user_data)
+{
+    memset(timer, 0, sizeof(*timer));
+    timer->slot = SLOT_NONE;
+    timer->func = func;
+    timer->user_data = user_data;
+}
+
+void timer_wheel_add(TimerWheel *wheel, TimerWheelTimer *timer, guint timeout_ms)
+{
+    g_return_if_fail(timer->func != NULL);
+
+    /* An empty wheel has nothing to cascade, so catch up with the clock
+     * rather than waking for slot boundaries that have already passed */
+    if (wheel->n_timers == 0) {
+        wheel->now = MAX(wheel->now, current_tick(wheel));
+    }
+
+    /* Round up, so a timer never fires early */
+    gint64 deadline = g_get_monotonic_time() - wheel->base_time + (gint64)timeout_ms * 1000;
+    guint64 expires = (deadline + wheel->tick_us - 1) / wheel->tick_us;
+
+    /* Slack aligns deadlines on a coarser grid; timers that share a
+     * grid point fire in the same dispatch */
+    expires = (expires + wheel->slack_ticks - 1) / wheel->slack_ticks * wheel->slack_ticks;
+    expires = CLAMP(expires, wheel->now + 1, MAX_TICK);
+
+    if (timer->slot != SLOT_NONE) {
+        unlink_timer(wheel, timer);
+    } else {
+        wheel->n_timers++;
+    }
+    timer->expires = expires;
+    place_timer(wheel, timer);
+
+    if (expires < wheel->armed) {
+        wheel->rearm = TRUE;
+    }
+}
+
+gboolean timer_wheel_cancel(TimerWheel *wheel, TimerWheelTimer *timer)
+{
+    if (timer->slot == SLOT_NONE) {
+        return FALSE;
+    }
+
+    /* The timerfd is left alone: waking early for nothing is cheaper
+     * than a syscall per cancel */
+    unlink_timer(wheel, timer);
+    wheel->n_timers--;
+    return TRUE;
+}
+
+gboolean timer_wheel_timer_is_armed(const TimerWheelTimer *timer)
+{
+    return timer->slot != SLOT_NONE;
+}
+
+guint timer_wheel_get_n_timers(TimerWheel *wheel)
+{
+    return wheel->n_timers;
+}
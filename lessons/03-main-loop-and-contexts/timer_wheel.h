@@ -0,0 +1,75 @@
+/*
+ * timer_wheel.h - Hierarchical timer wheel as a single GSource
+ *
+ * Every g_timeout_add() is its own GSource, and GMainContext visits
+ * every source in every iteration to find the next deadline. With a few
+ * hundred thousand idle timers (one per connection) that bookkeeping
+ * dominates the loop. A TimerWheel is one source holding any number of
+ * timers:
+ *
+ *   - 8 levels of 64 slots; a timer sits in the level of the highest
+ *     6-bit digit where its expiry tick differs from the wheel's current
+ *     tick, and drops a level each time that digit comes round
+ *   - add, cancel and re-arm are O(1): link or unlink from a slot list
+ *     and set or clear a bit in the level's occupancy mask
+ *   - the next deadline is found from the 8 masks, not the timers, and
+ *     wakes the loop through a timerfd, so the context's own timeout
+ *     handling does no per-timer work
+ *   - slack rounds expiry up to a multiple of slack_ms, so timers due
+ *     close together fire in one dispatch, the way g_timeout_add_seconds()
+ *     does for whole seconds
+ *
+ * Timers are caller-owned structs (embed one per connection), so arming
+ * one never allocates. Timers fire at most tick_ms + slack_ms late and
+ * never early. The wheel is a GSource: attach it with
+ * g_source_attach((GSource *)wheel, context) and drop it with
+ * g_source_unref(); timers still armed then are disarmed, not fired.
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TimerWheel TimerWheel;
+typedef struct _TimerWheelTimer TimerWheelTimer;
+
+/* Called with the timer already disarmed; it may re-arm it or free it */
+typedef void (*TimerWheelFunc)(TimerWheel *wheel,
+                               TimerWheelTimer *timer,
+                               gpointer user_data);
+
+/* All fields are private */
+struct _TimerWheelTimer {
+    TimerWheelTimer *next;
+    TimerWheelTimer *prev;
+    guint64 expires;           /* In ticks since the wheel was created */
+    guint32 slot;              /* level * 64 + slot, or disarmed / firing */
+    TimerWheelFunc func;
+    gpointer user_data;
+};
+
+/* A @tick_ms of 0 means 1 ms; a @slack_ms of 0 means none. Fails only
+ * if no timerfd can be created. */
+TimerWheel *timer_wheel_new(guint tick_ms, guint slack_ms, GError **error);
+
+/* Before the first add */
+void timer_wheel_timer_init(TimerWheelTimer *timer,
+                            TimerWheelFunc func,
+                            gpointer user_data);
+
+/* Arm @timer to fire in @timeout_ms, moving it if already armed */
+void timer_wheel_add(TimerWheel *wheel, TimerWheelTimer *timer, guint timeout_ms);
+
+/* Returns FALSE if @timer was not armed */
+gboolean timer_wheel_cancel(TimerWheel *wheel, TimerWheelTimer *timer);
+
+gboolean timer_wheel_timer_is_armed(const TimerWheelTimer *timer);
+
+guint timer_wheel_get_n_timers(TimerWheel *wheel);
+
+G_END_DECLS
+
+#endif /* TIMER_WHEEL_H */
@@ -0,0 +1,290 @@
+/*
+ * timer_wheel_benchmark.c - One GSource per timer vs a TimerWheel
+ *
+ * For 1k to 200k idle timers (60-120 s, so none fire while measured):
+ *   - iteration: one non-blocking g_main_context_iteration(), which is
+ *     what every wakeup of a busy loop pays before doing real work
+ *   - re-arm:    push one random timer's deadline back, as a server does
+ *                on every request - g_source_destroy() + a new
+ *                g_timeout_source_new() vs timer_wheel_add()
+ *
+ * Then 20k timers due within half a second run to completion, counting
+ * loop wakeups and the worst lateness with and without slack.
+ *
+ * Usage: ./timer_wheel_benchmark [max-timers] [--bench-...]   (default 200000)
+ */
+
+#include "bench.h"
+#include "timer_wheel.h"
+
+#define EXPIRY_TIMERS 20000
+#define EXPIRY_SPREAD_MS 500
+
+typedef struct {
+    GMainContext *context;
+    guint n;
+    GSource **sources;          /* GLib timeouts */
+    TimerWheel *wheel;
+    TimerWheelTimer *timers;    /* Wheel timers */
+    guint32 rng;
+} Workload;
+
+static guint long_timeout(guint i)
+{
+    return 60000 + (i * 7919) % 60000;
+}
+
+static guint next_index(Workload *w)
+{
+    w->rng ^= w->rng << 13;
+    w->rng ^= w->rng >> 17;
+    w->rng ^= w->rng << 5;
+    return w->rng % w->n;
+}
+
+static gboolean never_called(gpointer user_data)
+{
+    g_error("A benchmark timeout fired");
+    return G_SOURCE_REMOVE;
+}
+
+static void wheel_never_called(TimerWheel *wheel, TimerWheelTimer *timer, gpointer user_data)
+{
+    g_error("A benchmark timer fired");
+}
+
+/* ============================================================
+ * One GSource per timer
+ * ============================================================ */
+
+static GSource *attach_timeout(Workload *w, guint timeout_ms)
+{
+    GSource *source = g_timeout_source_new(timeout_ms);
+
+    g_source_set_callback(source, never_called, NULL, NULL);
+    g_source_attach(source, w->context);
+    return source;
+}
+
+static void glib_setup(Workload *w)
+{
+    w->sources = g_new(GSource *, w->n);
+    for (guint i = 0; i < w->n; i++) {
+        w->sources[i] = attach_timeout(w, long_timeout(i));
+    }
+}
+
+static void glib_teardown(Workload *w)
+{
+    for (guint i = 0; i < w->n; i++) {
+        g_source_destroy(w->sources[i]);
+        g_source_unref(w->sources[i]);
+    }
+    g_clear_pointer(&w->sources, g_free);
+}
+
+static void glib_rearm_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        guint i = next_index(w);
+
+        g_source_destroy(w->sources[i]);
+        g_source_unref(w->sources[i]);
+        w->sources[i] = attach_timeout(w, long_timeout(i));
+    }
+}
+
+/* ============================================================
+ * TimerWheel
+ * ============================================================ */
+
+static void wheel_setup(Workload *w)
+{
+    w->wheel = timer_wheel_new(0, 0, NULL);
+    g_source_attach((GSource *)w->wheel, w->context);
+
+    w->timers = g_new(TimerWheelTimer, w->n);
+    for (guint i = 0; i < w->n; i++) {
+        timer_wheel_timer_init(&w->timers[i], wheel_never_called, NULL);
+        timer_wheel_add(w->wheel, &w->timers[i], long_timeout(i));
+    }
+}
+
+static void wheel_teardown(Workload *w)
+{
+    g_source_destroy((GSource *)w->wheel);
+    g_source_unref((GSource *)w->wheel);
+    w->wheel = NULL;
+    g_clear_pointer(&w->timers, g_free);
+}
+
+static void wheel_rearm_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        guint i = next_index(w);
+
+        timer_wheel_add(w->wheel, &w->timers[i], long_timeout(i));
+    }
+}
+
+static void iteration_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        g_main_context_iteration(w->context, FALSE);
+    }
+}
+
+/* ============================================================
+ * Expiry
+ * ============================================================ */
+
+typedef struct {
+    GMainContext *context;
+    guint remaining;
+    gint64 worst_late_us;
+} ExpiryRun;
+
+typedef struct {
+    ExpiryRun *run;
+    gint64 deadline;
+    TimerWheelTimer timer;
+} ExpiryTimer;
+
+static void note_fired(ExpiryTimer *timer)
+{
+    gint64 late = g_get_monotonic_time() - timer->deadline;
+
+    timer->run->worst_late_us = MAX(timer->run->worst_late_us, late);
+    timer->run->remaining--;
+}
+
+static gboolean on_glib_expired(gpointer user_data)
+{
+    note_fired(user_data);
+    return G_SOURCE_REMOVE;
+}
+
+static void on_wheel_expired(TimerWheel *wheel, TimerWheelTimer *timer, gpointer user_data)
+{
+    note_fired(user_data);
+}
+
+/* @slack_ms < 0 means one g_timeout_source_new() per timer */
+static void run_expiry(const gchar *name, gint slack_ms)
+{
+    ExpiryRun run = { g_main_context_new(), EXPIRY_TIMERS, 0 };
+    ExpiryTimer *timers = g_new0(ExpiryTimer, EXPIRY_TIMERS);
+    TimerWheel *wheel = NULL;
+    guint wakeups = 0;
+
+    if (slack_ms >= 0) {
+        wheel = timer_wheel_new(0, slack_ms, NULL);
+        g_source_attach((GSource *)wheel, run.context);
+    }
+
+    for (guint i = 0; i < EXPIRY_TIMERS; i++) {
+        guint timeout_ms = (i * 7919) % EXPIRY_SPREAD_MS;
+
+        timers[i].run = &run;
+        timers[i].deadline = g_get_monotonic_time() + timeout_ms * G_TIME_SPAN_MILLISECOND;
+        if (wheel) {
+            timer_wheel_timer_init(&timers[i].timer, on_wheel_expired, &timers[i]);
+            timer_wheel_add(wheel, &timers[i].timer, timeout_ms);
+        } else {
+            GSource *source = g_timeout_source_new(timeout_ms);
+
+            g_source_set_callback(source, on_glib_expired, &timers[i], NULL);
+            g_source_attach(source, run.context);
+            g_source_unref(source);
+        }
+    }
+
+    while (run.remaining > 0) {
+        g_main_context_iteration(run.context, TRUE);
+        wakeups++;
+    }
+
+    g_print("  %-30s %6u wakeups   worst %6.1f ms late\n",
+            name, wakeups, run.worst_late_us / 1000.0);
+
+    if (wheel) {
+        g_source_destroy((GSource *)wheel);
+        g_source_unref((GSource *)wheel);
+    }
+    g_main_context_unref(run.context);
+    g_free(timers);
+}
+
+/* ============================================================
+ * Driver
+ * ============================================================ */
+
+int main(int argc, char *argv[])
+{
+    Bench *bench = bench_new("timer_wheel_benchmark", &argc, &argv);
+    guint max_timers = (argc > 1) ? (guint)g_ascii_strtoull(argv[1], NULL, 10) : 200000;
+    static const guint sizes[] = { 1000, 10000, 100000, 200000 };
+    GError *error = NULL;
+    TimerWheel *probe = timer_wheel_new(0, 0, &error);
+
+    if (max_timers == 0) {
+        g_printerr("Usage: %s [max-timers] [--bench-...]\n", argv[0]);
+        return 1;
+    }
+    if (probe == NULL) {
+        g_printerr("Failed to create timer wheel: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+    g_source_unref((GSource *)probe);
+
+    g_print("=== Timer wheel vs one GSource per timer ===\n");
+
+    for (guint s = 0; s < G_N_ELEMENTS(sizes) && sizes[s] <= max_timers; s++) {
+        Workload w = { g_main_context_new(), sizes[s], NULL, NULL, NULL, 2463534242u };
+        gchar *name;
+
+        g_print("\n%u timers:\n", w.n);
+
+        glib_setup(&w);
+        name = g_strdup_printf("iteration g_timeout %u", w.n);
+        bench_run(bench, name, iteration_bench, &w);
+        g_free(name);
+        name = g_strdup_printf("re-arm g_timeout %u", w.n);
+        bench_run(bench, name, glib_rearm_bench, &w);
+        g_free(name);
+        glib_teardown(&w);
+
+        wheel_setup(&w);
+        name = g_strdup_printf("iteration wheel %u", w.n);
+        bench_run(bench, name, iteration_bench, &w);
+        g_free(name);
+        name = g_strdup_printf("re-arm wheel %u", w.n);
+        bench_run(bench, name, wheel_rearm_bench, &w);
+        g_free(name);
+        wheel_teardown(&w);
+
+        g_main_context_unref(w.context);
+    }
+
+    g_print("\n%u timers due within %u ms:\n", EXPIRY_TIMERS, EXPIRY_SPREAD_MS);
+    run_expiry("g_timeout_add", -1);
+    run_expiry("wheel, no slack", 0);
+    run_expiry("wheel, 10 ms slack", 10);
+    run_expiry("wheel, 50 ms slack", 50);
+
+    g_print("\n=== Key Takeaways ===\n");
+    g_print("- GMainContext looks at every source in every iteration: cost grows with timers\n");
+    g_print("- The wheel is one source whose next deadline comes from 8 bitmasks, not a scan\n");
+    g_print("- Re-arming a wheel timer relinks it; a GLib timeout is destroyed and recreated\n");
+    g_print("- Slack trades a bounded delay for fewer wakeups, like g_timeout_add_seconds()\n");
+
+    bench_free(bench);
+    return 0;
+}
@@ -3,9 +3,13 @@
  * 
  * GAsyncQueue is a thread-safe queue for passing data between threads.
  * Perfect for producer-consumer patterns without manual locking.
+ *
+ * The last example does the same hand-off through MpmcRing, a bounded
+ * lock-free ring, for when the queue's mutex becomes the bottleneck.
  */
 
 #include <glib.h>
+#include "mpmc_ring.h"
 
 typedef struct {
     gint task_id;
@@ -122,6 +126,35 @@ static gpointer trylock_consumer(gpointer user_data)
     return NULL;
 }
 
+/* Ring consumer: MpmcRing never blocks, so back off while it's empty */
+static gpointer ring_consumer_thread(gpointer user_data)
+{
+    MpmcRing *ring = (MpmcRing *)user_data;
+    gpointer item;
+    gint processed = 0;
+    
+    while (TRUE) {
+        if (!mpmc_ring_try_pop(ring, &item)) {
+            g_thread_yield();
+            continue;
+        }
+        
+        /* NULL means terminate */
+        if (item == NULL) {
+            break;
+        }
+        
+        Task *task = item;
+        g_print("[RingConsumer %p] Processing task %d\n",
+                (void *)g_thread_self(), task->task_id);
+        processed++;
+    }
+    
+    g_print("[RingConsumer %p] Finished after %d tasks\n",
+            (void *)g_thread_self(), processed);
+    return NULL;
+}
+
 int main(void)
 {
     g_print("=== GLib GAsyncQueue Example ===\n\n");
@@ -188,6 +221,38 @@ int main(void)
     /* Clean up queue */
     g_async_queue_unref(queue);
     
+    /* Example 4: Lock-free ring */
+    g_print("\n5. Lock-free MpmcRing hand-off:\n\n");
+    
+    /* Tasks live in an array: pushing a pointer allocates nothing */
+    Task ring_tasks[10];
+    MpmcRing *ring = mpmc_ring_new(16);
+    
+    GThread *ring_consumer1 = g_thread_new("ring-consumer1",
+                                           ring_consumer_thread, ring);
+    GThread *ring_consumer2 = g_thread_new("ring-consumer2",
+                                           ring_consumer_thread, ring);
+    
+    for (gint i = 0; i < 10; i++) {
+        ring_tasks[i].task_id = i + 200;
+        ring_tasks[i].description = NULL;
+        
+        /* Bounded: spin if the consumers fall a full ring behind */
+        while (!mpmc_ring_try_push(ring, &ring_tasks[i])) {
+            g_thread_yield();
+        }
+    }
+    while (!mpmc_ring_try_push(ring, NULL)) {
+        g_thread_yield();
+    }
+    while (!mpmc_ring_try_push(ring, NULL)) {
+        g_thread_yield();
+    }
+    
+    g_thread_join(ring_consumer1);
+    g_thread_join(ring_consumer2);
+    mpmc_ring_free(ring);
+    
     g_print("\n=== Key Points ===\n");
     g_print("- GAsyncQueue is thread-safe, no manual locking needed\n");
     g_print("- g_async_queue_pop() blocks until data available\n");
@@ -195,6 +260,7 @@ int main(void)
     g_print("- g_async_queue_timeout_pop() waits with timeout\n");
     g_print("- Perfect for producer-consumer patterns\n");
     g_print("- Can have multiple producers and consumers\n");
+    g_print("- MpmcRing trades blocking pops for a lock-free, allocation-free hand-off\n");
     
     return 0;
 }
@@ -4,27 +4,35 @@
  * Demonstrates how to properly use GMainContext across threads,
  * including pushing context as thread-default and scheduling
  * callbacks from worker threads to main thread.
+ *
+ * Worker updates go through an MpmcRingSource rather than one
+ * g_idle_add() per update: workers push into a lock-free ring and the
+ * main loop wakes once per batch.
  */
 
 #include <glib.h>
+#include "mpmc_ring.h"
 
 static GMainLoop *main_loop = NULL;
+static MpmcRingSource *updates = NULL;
 static gint work_counter = 0;
 
-/* Idle callback executed in main thread */
-static gboolean update_from_worker(gpointer user_data)
+/* Batch callback executed in main thread */
+static gboolean update_from_worker(gpointer *items, guint n_items, gpointer user_data)
 {
-    gint worker_id = GPOINTER_TO_INT(user_data);
-    
-    g_print("[Main Thread] Update from worker %d (counter: %d)\n", 
-            worker_id, ++work_counter);
+    for (guint i = 0; i < n_items; i++) {
+        gint worker_id = GPOINTER_TO_INT(items[i]);
+        
+        g_print("[Main Thread] Update from worker %d (counter: %d, batch of %u)\n", 
+                worker_id, ++work_counter, n_items);
+    }
     
     if (work_counter >= 10) {
         g_print("[Main Thread] All work done, stopping loop\n");
         g_main_loop_quit(main_loop);
     }
     
-    return FALSE;  /* One-shot */
+    return G_SOURCE_CONTINUE;
 }
 
 /* Worker thread that schedules callbacks in main thread */
@@ -40,9 +48,12 @@ static gpointer worker_thread(gpointer user_data)
         /* Simulate work */
         g_usleep(500000);  /* 500ms */
         
-        /* Schedule update in main thread using g_idle_add */
-        /* This is thread-safe and adds to default context */
-        g_idle_add(update_from_worker, GINT_TO_POINTER(worker_id));
+        /* Queue update for the main thread. Unlike g_idle_add() this
+         * allocates nothing, and only the first update since the last
+         * dispatch wakes the main context. */
+        if (!mpmc_ring_source_push(updates, GINT_TO_POINTER(worker_id))) {
+            g_printerr("[Worker %d] Update ring full, dropping update\n", worker_id);
+        }
     }
     
     g_print("[Worker %d] Finished\n", worker_id);
@@ -119,6 +130,12 @@ int main(void)
     /* Create main loop for main thread */
     main_loop = g_main_loop_new(NULL, FALSE);
     
+    /* Ring-backed source on the default context for worker updates */
+    updates = mpmc_ring_source_new(256, NULL);
+    g_source_set_callback((GSource *)updates, (GSourceFunc)update_from_worker,
+                          NULL, NULL);
+    g_source_attach((GSource *)updates, NULL);
+    
     /* Example 1: Workers scheduling callbacks in main thread */
     g_print("1. Starting worker threads that update main thread:\n\n");
     
@@ -135,6 +152,15 @@ int main(void)
     g_thread_join(worker1);
     g_thread_join(worker2);
     
+    MpmcRingSourceStats stats;
+    mpmc_ring_source_get_stats(updates, &stats);
+    g_print("\n[Main Thread] %" G_GUINT64_FORMAT " updates in %" G_GUINT64_FORMAT
+            " dispatches (%" G_GUINT64_FORMAT " wakeups)\n",
+            stats.items, stats.dispatches, stats.wakeups);
+    
+    g_source_destroy((GSource *)updates);
+    g_source_unref((GSource *)updates);
+    
     g_print("\n2. Thread with own context:\n\n");
     
     /* Example 2: Thread with its own context */
@@ -148,7 +174,8 @@ int main(void)
     
     g_print("\n=== Key Points ===\n");
     g_print("- Use g_idle_add() to schedule callbacks from worker to main thread\n");
-    g_print("- g_idle_add() is thread-safe for default context\n");
+    g_print("- g_idle_add() is thread-safe but allocates a source per call\n");
+    g_print("- A ring-backed source wakes the context once per batch of updates\n");
     g_print("- Each thread can have its own GMainContext\n");
     g_print("- Use g_main_context_push_thread_default() for thread-local context\n");
     g_print("- Context pushed is used by g_idle_add() called from that thread\n");
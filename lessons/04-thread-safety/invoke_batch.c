@@ -0,0 +1,208 @@
+/*
+ * invoke_batch.c - Batched cross-thread calls into a GMainContext
+ *
+ * See invoke_batch.h for the API. Pending closures form a singly linked
+ * stack: a push is a CAS on its head, and the dispatch swaps the head
+ * for NULL and reverses what it got. Pushes can't suffer from ABA, as
+ * the only pop takes everything.
+ *
+ * As in MpmcRingSource, the wakeup is g_source_set_ready_time(), which
+ * is safe from any thread. The push that finds the stack empty makes it;
+ * the dispatch clears the ready time before taking the stack, so a push
+ * that lands after that finds it empty again and wakes the context for
+ * the next batch.
+ *
+ * Batches are kept in a hash table keyed by context, which holds a
+ * reference on each. A context can't tell us it is going away, but it
+ * destroys its sources when it does, so a destroyed batch in the table
+ * is replaced when next asked for.
+ */
+
+#include "invoke_batch.h"
+
+struct _InvokeBatch {
+    GSource source;
+    InvokeClosure *head;             /* Atomic */
+    guint64 wakeups;                 /* Atomic */
+    guint64 dispatches;
+    guint64 closures;
+};
+
+typedef struct {
+    InvokeClosure closure;
+    InvokeFunc func;
+    gpointer user_data;
+} InvokeCall;
+
+G_LOCK_DEFINE_STATIC(batches);
+static GHashTable *batches;          /* GMainContext * -> InvokeBatch * */
+
+static void run_call(InvokeClosure *closure)
+{
+    InvokeCall *call = (InvokeCall *)closure;
+
+    call->func(call->user_data);
+    g_free(call);
+}
+
+/* Newest first, as pushed; returns oldest first */
+static InvokeClosure *reverse(InvokeClosure *list)
+{
+    InvokeClosure *reversed = NULL;
+
+    while (list) {
+        InvokeClosure *next = list->next;
+
+        list->next = reversed;
+        reversed = list;
+        list = next;
+    }
+    return reversed;
+}
+
+/* ============================================================
+ * GSource
+ * ============================================================ */
+
+static gboolean invoke_batch_dispatch(GSource *source,
+                                      GSourceFunc callback,
+                                      gpointer user_data)
+{
+    InvokeBatch *batch = (InvokeBatch *)source;
+    InvokeClosure *closure;
+
+    g_source_set_ready_time(source, -1);
+    closure = reverse(__atomic_exchange_n(&batch->head, NULL, __ATOMIC_ACQUIRE));
+
+    if (closure == NULL) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    batch->dispatches++;
+    while (closure) {
+        InvokeClosure *next = closure->next;
+
+        batch->closures++;
+        closure->func(closure);
+        closure = next;
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void invoke_batch_finalize(GSource *source)
+{
+    InvokeBatch *batch = (InvokeBatch *)source;
+    InvokeClosure *closure = __atomic_exchange_n(&batch->head, NULL, __ATOMIC_ACQUIRE);
+
+    while (closure) {
+        InvokeClosure *next = closure->next;
+
+        if (closure->func == run_call) {
+            g_free(closure);
+        }
+        closure = next;
+    }
+}
+
+static GSourceFuncs invoke_batch_funcs = {
+    NULL,
+    NULL,
+    invoke_batch_dispatch,
+    invoke_batch_finalize,
+    NULL,  /* closure_callback */
+    NULL   /* closure_marshal */
+};
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+InvokeBatch *invoke_batch_get(GMainContext *context)
+{
+    GSource *source;
+
+    if (context == NULL) {
+        context = g_main_context_default();
+    }
+
+    G_LOCK(batches);
+    if (batches == NULL) {
+        batches = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                        NULL, (GDestroyNotify)g_source_unref);
+    }
+
+    source = g_hash_table_lookup(batches, context);
+    if (source == NULL || g_source_is_destroyed(source)) {
+        source = g_source_new(&invoke_batch_funcs, sizeof(InvokeBatch));
+        g_source_set_name(source, "InvokeBatch");
+        g_source_attach(source, context);
+        /* The table's reference; drops the destroyed batch's, if any */
+        g_hash_table_replace(batches, context, source);
+    }
+    g_source_ref(source);
+    G_UNLOCK(batches);
+
+    return (InvokeBatch *)source;
+}
+
+void invoke_batch_unref(InvokeBatch *batch)
+{
+    g_source_unref((GSource *)batch);
+}
+
+void invoke_closure_init(InvokeClosure *closure, InvokeClosureFunc func)
+{
+    closure->func = func;
+    closure->next = NULL;
+}
+
+gboolean invoke_batch_post(InvokeBatch *batch, InvokeClosure *closure)
+{
+    InvokeClosure *head;
+
+    g_return_val_if_fail(batch != NULL, FALSE);
+    g_return_val_if_fail(closure != NULL && closure->func != NULL, FALSE);
+
+    if (g_source_is_destroyed((GSource *)batch)) {
+        return FALSE;
+    }
+
+    head = __atomic_load_n(&batch->head, __ATOMIC_RELAXED);
+    do {
+        closure->next = head;
+    } while (!__atomic_compare_exchange_n(&batch->head, &head, closure, TRUE,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    if (head == NULL) {
+        __atomic_fetch_add(&batch->wakeups, 1, __ATOMIC_RELAXED);
+        g_source_set_ready_time((GSource *)batch, 0);
+    }
+
+    return TRUE;
+}
+
+gboolean invoke_batch_invoke(InvokeBatch *batch, InvokeFunc func, gpointer user_data)
+{
+    InvokeCall *call;
+
+    g_return_val_if_fail(func != NULL, FALSE);
+
+    call = g_new(InvokeCall, 1);
+    invoke_closure_init(&call->closure, run_call);
+    call->func = func;
+    call->user_data = user_data;
+
+    if (!invoke_batch_post(batch, &call->closure)) {
+        g_free(call);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void invoke_batch_get_stats(InvokeBatch *batch, InvokeBatchStats *stats)
+{
+    stats->wakeups = __atomic_load_n(&batch->wakeups, __ATOMIC_RELAXED);
+    stats->dispatches = batch->dispatches;
+    stats->closures = batch->closures;
+}
@@ -0,0 +1,74 @@
+/*
+ * invoke_batch.h - Batched cross-thread calls into a GMainContext
+ *
+ * g_idle_add() and g_main_context_invoke() from another thread allocate
+ * a GSource per call, take the context's lock to attach it and wake the
+ * loop, which then dispatches each source on its own. MpmcRingSource
+ * (mpmc_ring.h) batches plain pointers into a fixed-size ring. An
+ * InvokeBatch does the same for closures, with no size limit:
+ *
+ *   - invoke_batch_get() returns the context's one InvokeBatch source,
+ *     creating and attaching it on first use
+ *   - callers push onto a lock-free list (a Treiber stack) with one CAS.
+ *     Only a push that finds the list empty wakes the context, and takes
+ *     its lock to do so, so each batch costs exactly one wakeup
+ *   - the dispatch takes the whole list with one exchange, reverses it
+ *     and runs every closure in push order, so calls from one thread run
+ *     in the order that thread made them
+ *   - invoke_batch_post() takes an embedded InvokeClosure and allocates
+ *     nothing; invoke_batch_invoke() wraps a function and pointer
+ *
+ * Unlike g_main_context_invoke(), a call from the owning thread is queued
+ * too, behind the calls already waiting, rather than run on the spot.
+ */
+
+#ifndef INVOKE_BATCH_H
+#define INVOKE_BATCH_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _InvokeBatch InvokeBatch;
+typedef struct _InvokeClosure InvokeClosure;
+
+/* Runs on the context's thread. @closure is the callee's from here on:
+ * it may be freed or posted again. */
+typedef void (*InvokeClosureFunc)(InvokeClosure *closure);
+
+/* Embed one in whatever is being handed over. All fields are private. */
+struct _InvokeClosure {
+    InvokeClosureFunc func;
+    InvokeClosure *next;
+};
+
+typedef void (*InvokeFunc)(gpointer user_data);
+
+typedef struct {
+    guint64 wakeups;           /* Pushes that found the list empty */
+    guint64 dispatches;        /* Batches run */
+    guint64 closures;          /* Closures run */
+} InvokeBatchStats;
+
+/* The batch for @context (NULL = the global default), with a new
+ * reference. Every call for one context returns the same batch. It stays
+ * attached until the context is destroyed, whoever holds references. */
+InvokeBatch *invoke_batch_get(GMainContext *context);
+void invoke_batch_unref(InvokeBatch *batch);
+
+void invoke_closure_init(InvokeClosure *closure, InvokeClosureFunc func);
+
+/* Thread-safe. Returns FALSE, and doesn't take @closure, if the context
+ * has been destroyed. Closures still queued then are dropped; those of
+ * invoke_batch_invoke() are freed. */
+gboolean invoke_batch_post(InvokeBatch *batch, InvokeClosure *closure);
+
+/* Thread-safe. Calls func(@user_data) on the context's thread. */
+gboolean invoke_batch_invoke(InvokeBatch *batch, InvokeFunc func, gpointer user_data);
+
+/* Call from the owning context's thread */
+void invoke_batch_get_stats(InvokeBatch *batch, InvokeBatchStats *stats);
+
+G_END_DECLS
+
+#endif /* INVOKE_BATCH_H */
@@ -0,0 +1,369 @@
+/*
+ * invoke_batch_benchmark.c - g_idle_add() vs g_main_context_invoke() vs
+ * InvokeBatch, from many threads at a fixed rate
+ *
+ * [workers] threads (default 16) send messages to the main thread's
+ * context at a combined [rate] per second (default 1,000,000) for one
+ * second, as context_threading.c's workers do with their updates. Each
+ * message is a preallocated struct carrying its send time, delivered by:
+ *   - g_idle_add(): one GSource per message
+ *   - g_main_context_invoke(): the same, as the caller doesn't own the
+ *     context
+ *   - invoke_batch_invoke(): a small allocation per message, one source
+ *   - invoke_batch_post(): the InvokeClosure embedded in the message
+ *
+ * Reported: messages delivered per second until the last one ran, the
+ * main thread's CPU time, how many dispatches delivered them, and the
+ * latency from send to run, and how many messages ran after a later one
+ * from the same sender.
+ *
+ * Then the same four with no rate limit, as bench_run_ops() cases: each
+ * worker sends as fast as it can and the time per message is until the
+ * main thread has run the last one. The fixed-rate table is kept as it
+ * is, since a latency distribution at a given load is what it measures.
+ *
+ * Usage: ./invoke_batch_benchmark [rate] [workers] [--bench-...]
+ */
+
+#include "bench.h"
+#include "invoke_batch.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef enum {
+    METHOD_IDLE_ADD,
+    METHOD_INVOKE,
+    METHOD_BATCH_INVOKE,
+    METHOD_BATCH_POST
+} Method;
+
+static const gchar *method_names[] = {
+    "g_idle_add", "g_main_context_invoke", "invoke_batch_invoke", "invoke_batch_post"
+};
+
+typedef struct _Run Run;
+
+typedef struct {
+    InvokeClosure closure;
+    Run *run;
+    guint worker;
+    guint seq;
+    gint64 sent_at;
+} Message;
+
+typedef struct {
+    Run *run;
+    Message *messages;
+} Worker;
+
+struct _Run {
+    Method method;
+    guint rate;                      /* 0 for as fast as they can */
+    guint n_workers;
+    guint per_worker;
+    InvokeBatch *batch;
+    InvokeBatchStats before;         /* The batch is shared by every run */
+    gint64 start;
+
+    /* Main thread only */
+    guint delivered;
+    guint64 dispatches;
+    guint reordered;                 /* Arrived after a later one from its sender */
+    guint *next_seq;
+    gint64 *latencies;               /* NULL if not kept */
+};
+
+static void deliver(Message *message)
+{
+    Run *run = message->run;
+
+    if (message->seq < run->next_seq[message->worker]) {
+        run->reordered++;
+    } else {
+        run->next_seq[message->worker] = message->seq + 1;
+    }
+    if (run->latencies) {
+        run->latencies[run->delivered] = g_get_monotonic_time() - message->sent_at;
+    }
+    run->delivered++;
+}
+
+static gboolean on_idle(gpointer data)
+{
+    Message *message = data;
+
+    message->run->dispatches++;
+    deliver(message);
+    return G_SOURCE_REMOVE;
+}
+
+static void on_invoke(gpointer data)
+{
+    deliver(data);
+}
+
+static void on_post(InvokeClosure *closure)
+{
+    deliver((Message *)closure);
+}
+
+static void send_message(Run *run, Message *message)
+{
+    message->sent_at = g_get_monotonic_time();
+
+    switch (run->method) {
+    case METHOD_IDLE_ADD:
+        g_idle_add(on_idle, message);
+        break;
+    case METHOD_INVOKE:
+        g_main_context_invoke(NULL, on_idle, message);
+        break;
+    case METHOD_BATCH_INVOKE:
+        invoke_batch_invoke(run->batch, on_invoke, message);
+        break;
+    case METHOD_BATCH_POST:
+        invoke_batch_post(run->batch, &message->closure);
+        break;
+    }
+}
+
+/* Sends whatever is due by now, then sleeps a little: each worker keeps
+ * to rate / n_workers per second on average. With no rate it sends
+ * everything at once. */
+static gpointer worker_thread(gpointer data)
+{
+    Worker *worker = data;
+    Run *run = worker->run;
+    guint sent = 0;
+
+    if (run->rate == 0) {
+        while (sent < run->per_worker) {
+            send_message(run, &worker->messages[sent++]);
+        }
+        return NULL;
+    }
+
+    while (sent < run->per_worker) {
+        gint64 elapsed = g_get_monotonic_time() - run->start;
+        guint64 due = (guint64)elapsed * run->rate / run->n_workers / G_TIME_SPAN_SECOND;
+
+        while (sent < run->per_worker && sent < due) {
+            send_message(run, &worker->messages[sent++]);
+        }
+        g_usleep(20);
+    }
+    return NULL;
+}
+
+static gdouble thread_cpu_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static gint compare_int64(gconstpointer a, gconstpointer b)
+{
+    gint64 x = *(const gint64 *)a, y = *(const gint64 *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void fixed_rate(Method method, guint rate, guint n_workers)
+{
+    Run run = { 0 };
+    Worker *workers = g_new0(Worker, n_workers);
+    GThread **threads = g_new(GThread *, n_workers);
+    guint total;
+    gdouble cpu, seconds;
+
+    run.method = method;
+    run.rate = rate;
+    run.n_workers = n_workers;
+    run.per_worker = rate / n_workers;
+    run.next_seq = g_new0(guint, n_workers);
+    total = run.per_worker * n_workers;
+    run.latencies = g_new(gint64, total);
+    if (method == METHOD_BATCH_INVOKE || method == METHOD_BATCH_POST) {
+        run.batch = invoke_batch_get(NULL);
+        invoke_batch_get_stats(run.batch, &run.before);
+    }
+
+    for (guint w = 0; w < n_workers; w++) {
+        workers[w].run = &run;
+        workers[w].messages = g_new(Message, run.per_worker);
+        for (guint i = 0; i < run.per_worker; i++) {
+            Message *message = &workers[w].messages[i];
+
+            invoke_closure_init(&message->closure, on_post);
+            message->run = &run;
+            message->worker = w;
+            message->seq = i;
+        }
+    }
+
+    /* This thread owns the default context for the whole run, so the
+     * workers' g_main_context_invoke() calls can't run in place */
+    g_main_context_acquire(NULL);
+    cpu = thread_cpu_seconds();
+    run.start = g_get_monotonic_time();
+    for (guint w = 0; w < n_workers; w++) {
+        threads[w] = g_thread_new("sender", worker_thread, &workers[w]);
+    }
+
+    while (run.delivered < total) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    seconds = (g_get_monotonic_time() - run.start) / (gdouble)G_TIME_SPAN_SECOND;
+    cpu = thread_cpu_seconds() - cpu;
+    g_main_context_release(NULL);
+
+    for (guint w = 0; w < n_workers; w++) {
+        g_thread_join(threads[w]);
+        g_free(workers[w].messages);
+    }
+
+    if (run.batch) {
+        InvokeBatchStats stats;
+
+        invoke_batch_get_stats(run.batch, &stats);
+        run.dispatches = stats.dispatches - run.before.dispatches;
+        invoke_batch_unref(run.batch);
+    }
+
+    qsort(run.latencies, total, sizeof(gint64), compare_int64);
+    g_print("%-22s %12.0f %9.1f%% %12" G_GUINT64_FORMAT " %9" G_GINT64_FORMAT
+            " %9" G_GINT64_FORMAT " %10u\n",
+            method_names[method], total / seconds, cpu / seconds * 100, run.dispatches,
+            run.latencies[total / 2], run.latencies[(guint64)total * 99 / 100],
+            run.reordered);
+
+    g_free(run.latencies);
+    g_free(run.next_seq);
+    g_free(threads);
+    g_free(workers);
+}
+
+/* ============================================================
+ * Saturation: no rate limit, as bench_run_ops() cases
+ * ============================================================ */
+
+typedef struct {
+    Run run;
+    Worker *workers;
+    GThread **threads;
+    guint capacity;                  /* Messages allocated per worker */
+} Saturation;
+
+/* Each worker sends iterations messages; the time stops when the main
+ * thread has run them all. The messages are reused, growing only while
+ * bench.h calibrates. */
+static void saturation_bench(guint64 iterations, gpointer user_data)
+{
+    Saturation *sat = user_data;
+    Run *run = &sat->run;
+
+    if (iterations > sat->capacity) {
+        for (guint w = 0; w < run->n_workers; w++) {
+            Worker *worker = &sat->workers[w];
+
+            worker->messages = g_renew(Message, worker->messages, iterations);
+            for (guint i = sat->capacity; i < iterations; i++) {
+                Message *message = &worker->messages[i];
+
+                invoke_closure_init(&message->closure, on_post);
+                message->run = run;
+                message->worker = w;
+                message->seq = i;
+            }
+        }
+        sat->capacity = (guint)iterations;
+    }
+
+    run->per_worker = (guint)iterations;
+    run->delivered = 0;
+    memset(run->next_seq, 0, run->n_workers * sizeof(guint));
+
+    g_main_context_acquire(NULL);
+    for (guint w = 0; w < run->n_workers; w++) {
+        sat->threads[w] = g_thread_new("sender", worker_thread, &sat->workers[w]);
+    }
+    while (run->delivered < iterations * run->n_workers) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    g_main_context_release(NULL);
+
+    for (guint w = 0; w < run->n_workers; w++) {
+        g_thread_join(sat->threads[w]);
+    }
+}
+
+static void saturation(Bench *bench, Method method, guint n_workers)
+{
+    Saturation sat = {
+        .run = { .method = method, .n_workers = n_workers, .next_seq = g_new0(guint, n_workers) },
+        .workers = g_new0(Worker, n_workers),
+        .threads = g_new(GThread *, n_workers),
+    };
+    gchar *name = g_strdup_printf("%s x%u", method_names[method], n_workers);
+
+    if (method == METHOD_BATCH_INVOKE || method == METHOD_BATCH_POST) {
+        sat.run.batch = invoke_batch_get(NULL);
+    }
+    for (guint w = 0; w < n_workers; w++) {
+        sat.workers[w].run = &sat.run;
+    }
+
+    bench_run_ops(bench, name, n_workers, saturation_bench, &sat);
+    if (sat.run.reordered > 0) {
+        g_error("%s: %u messages ran after a later one from their sender",
+                method_names[method], sat.run.reordered);
+    }
+
+    g_clear_pointer(&sat.run.batch, invoke_batch_unref);
+    for (guint w = 0; w < n_workers; w++) {
+        g_free(sat.workers[w].messages);
+    }
+    g_free(name);
+    g_free(sat.threads);
+    g_free(sat.workers);
+    g_free(sat.run.next_seq);
+}
+
+int main(int argc, char *argv[])
+{
+    Bench *bench = bench_new("invoke_batch_benchmark", &argc, &argv);
+    guint rate = (argc > 1) ? (guint)g_ascii_strtoull(argv[1], NULL, 10) : 1000000;
+    guint n_workers = (argc > 2) ? (guint)g_ascii_strtoull(argv[2], NULL, 10) : 16;
+
+    n_workers = CLAMP(n_workers, 1, 256);
+    rate = MAX(rate, n_workers);
+
+    g_print("=== Invoke Batch Benchmark ===\n\n");
+    g_print("%u workers sending %u messages/s for 1 s to the main thread\n\n",
+            n_workers, rate);
+    g_print("%-22s %12s %10s %12s %9s %9s %10s\n",
+            "method", "delivered/s", "loop CPU", "dispatches", "p50 us", "p99 us", "reordered");
+
+    for (Method method = METHOD_IDLE_ADD; method <= METHOD_BATCH_POST; method++) {
+        fixed_rate(method, rate, n_workers);
+    }
+
+    g_print("\nNo rate limit, time per message delivered:\n");
+    for (Method method = METHOD_IDLE_ADD; method <= METHOD_BATCH_POST; method++) {
+        saturation(bench, method, n_workers);
+    }
+
+    g_print("\n=== Key Points ===\n");
+    g_print("- Each g_idle_add() or g_main_context_invoke() is a source to allocate, attach and dispatch\n");
+    g_print("- Past some rate the loop falls behind and latency is the length of the backlog\n");
+    g_print("- One batch source per context: a push is one CAS, a batch is one wakeup\n");
+    g_print("- Reversing the stack at dispatch keeps each sender's messages in order\n");
+    g_print("- Embedding the closure in the message removes the last allocation\n");
+
+    bench_free(bench);
+    return 0;
+}
@@ -0,0 +1,258 @@
+/*
+ * mpmc_ring.c - Bounded lock-free MPMC ring and a GSource that drains it
+ *
+ * See mpmc_ring.h for the API. Slot i starts with seq = i. A producer
+ * claiming position pos waits for seq == pos, writes the data and
+ * publishes seq = pos + 1; the consumer of pos waits for seq == pos + 1
+ * and hands the slot to the next lap with seq = pos + capacity.
+ *
+ * The source wakes its context with g_source_set_ready_time(), which is
+ * safe from any thread. An atomic "armed" flag makes sure only the first
+ * push after a dispatch pays for that.
+ */
+
+#include "mpmc_ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_LINE 64
+
+typedef struct {
+    guint64 seq;
+    gpointer data;
+} __attribute__((aligned(CACHE_LINE))) RingSlot;
+
+struct _MpmcRing {
+    RingSlot *slots;
+    guint64 mask;
+    guint64 head __attribute__((aligned(CACHE_LINE)));   /* Next push */
+    guint64 tail __attribute__((aligned(CACHE_LINE)));   /* Next pop */
+};
+
+struct _MpmcRingSource {
+    GSource source;
+    MpmcRing *ring;
+    GDestroyNotify item_free;
+    gpointer *batch;                 /* Dispatch scratch, one ring's worth */
+    gint armed;                      /* Wakeup already requested */
+    guint64 wakeups;
+    guint64 dispatches;
+    guint64 items;
+};
+
+static gpointer aligned_alloc0(gsize size)
+{
+    void *mem;
+
+    if (posix_memalign(&mem, CACHE_LINE, size) != 0) {
+        g_error("mpmc_ring: out of memory");
+    }
+    memset(mem, 0, size);
+    return mem;
+}
+
+/* ============================================================
+ * Ring
+ * ============================================================ */
+
+MpmcRing *mpmc_ring_new(guint capacity)
+{
+    MpmcRing *ring = aligned_alloc0(sizeof(MpmcRing));
+    guint64 size = 2;
+
+    while (size < capacity) {
+        size *= 2;
+    }
+
+    ring->slots = aligned_alloc0(size * sizeof(RingSlot));
+    ring->mask = size - 1;
+    for (guint64 i = 0; i < size; i++) {
+        ring->slots[i].seq = i;
+    }
+
+    return ring;
+}
+
+void mpmc_ring_free(MpmcRing *ring)
+{
+    free(ring->slots);
+    free(ring);
+}
+
+gboolean mpmc_ring_try_push(MpmcRing *ring, gpointer data)
+{
+    guint64 pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    RingSlot *slot;
+
+    for (;;) {
+        slot = &ring->slots[pos & ring->mask];
+        guint64 seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        gint64 diff = (gint64)(seq - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, TRUE,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return FALSE;   /* Full: the consumer of the previous lap is behind */
+        } else {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->data = data;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+gboolean mpmc_ring_try_pop(MpmcRing *ring, gpointer *data)
+{
+    guint64 pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    RingSlot *slot;
+
+    for (;;) {
+        slot = &ring->slots[pos & ring->mask];
+        guint64 seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        gint64 diff = (gint64)(seq - (pos + 1));
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1, TRUE,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return FALSE;   /* Empty */
+        } else {
+            pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    *data = slot->data;
+    __atomic_store_n(&slot->seq, pos + ring->mask + 1, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+guint mpmc_ring_get_capacity(MpmcRing *ring)
+{
+    return (guint)(ring->mask + 1);
+}
+
+guint mpmc_ring_length(MpmcRing *ring)
+{
+    guint64 tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    guint64 head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    /* Loads aren't atomic together; clamp a torn snapshot */
+    return (head > tail) ? (guint)MIN(head - tail, ring->mask + 1) : 0;
+}
+
+/* ============================================================
+ * GSource adapter
+ * ============================================================ */
+
+static gboolean mpmc_ring_source_dispatch(GSource *source,
+                                          GSourceFunc callback,
+                                          gpointer user_data)
+{
+    MpmcRingSource *ring_source = (MpmcRingSource *)source;
+    MpmcRingSourceFunc func = (MpmcRingSourceFunc)callback;
+    guint capacity = mpmc_ring_get_capacity(ring_source->ring);
+    guint n_items = 0;
+
+    g_source_set_ready_time(source, -1);
+    /* Disarm before draining: a push that lands after this point re-arms
+     * and gets its own dispatch, one that landed before is drained now */
+    g_atomic_int_set(&ring_source->armed, 0);
+    /* Store-load: the disarm must be visible before the ring is read, or
+     * a producer can see armed == 1 while we see an empty ring and its
+     * item sits there until the next push. Pairs with the fence in
+     * mpmc_ring_source_push(). */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    while (n_items < capacity &&
+           mpmc_ring_try_pop(ring_source->ring, &ring_source->batch[n_items])) {
+        n_items++;
+    }
+
+    if (n_items == capacity) {
+        /* Producers may have kept up with us; come back next iteration */
+        g_source_set_ready_time(source, 0);
+    }
+
+    if (n_items == 0) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    ring_source->dispatches++;
+    ring_source->items += n_items;
+
+    if (func == NULL) {
+        g_warning("MpmcRingSource dispatched without a callback");
+        return G_SOURCE_REMOVE;
+    }
+
+    return func(ring_source->batch, n_items, user_data);
+}
+
+static void mpmc_ring_source_finalize(GSource *source)
+{
+    MpmcRingSource *ring_source = (MpmcRingSource *)source;
+    gpointer data;
+
+    while (mpmc_ring_try_pop(ring_source->ring, &data)) {
+        if (ring_source->item_free) {
+            ring_source->item_free(data);
+        }
+    }
+
+    g_free(ring_source->batch);
+    mpmc_ring_free(ring_source->ring);
+}
+
+static GSourceFuncs mpmc_ring_source_funcs = {
+    NULL,
+    NULL,
+    mpmc_ring_source_dispatch,
+    mpmc_ring_source_finalize,
+    NULL,
+    NULL
+};
+
+MpmcRingSource *mpmc_ring_source_new(guint capacity, GDestroyNotify item_free)
+{
+    GSource *source = g_source_new(&mpmc_ring_source_funcs, sizeof(MpmcRingSource));
+    MpmcRingSource *ring_source = (MpmcRingSource *)source;
+
+    g_source_set_name(source, "MpmcRingSource");
+    ring_source->ring = mpmc_ring_new(capacity);
+    ring_source->item_free = item_free;
+    ring_source->batch = g_new(gpointer, mpmc_ring_get_capacity(ring_source->ring));
+
+    return ring_source;
+}
+
+gboolean mpmc_ring_source_push(MpmcRingSource *source, gpointer data)
+{
+    if (!mpmc_ring_try_push(source->ring, data)) {
+        return FALSE;
+    }
+
+    /* The item must be visible before armed is read; see the dispatch */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (g_atomic_int_get(&source->armed) == 0 &&
+        g_atomic_int_compare_and_exchange(&source->armed, 0, 1)) {
+        __atomic_fetch_add(&source->wakeups, 1, __ATOMIC_RELAXED);
+        g_source_set_ready_time((GSource *)source, 0);
+    }
+
+    return TRUE;
+}
+
+void mpmc_ring_source_get_stats(MpmcRingSource *source, MpmcRingSourceStats *stats)
+{
+    stats->wakeups = __atomic_load_n(&source->wakeups, __ATOMIC_RELAXED);
+    stats->dispatches = source->dispatches;
+    stats->items = source->items;
+}
@@ -0,0 +1,716 @@
+/*
+ * par_sort.c - Parallel sorting of GArrays and GPtrArrays on a WsPool
+ *
+ * See par_sort.h for the API. The pieces:
+ *
+ *   - A Job is one phase of a sort: an array of Tasks, the first run by
+ *     the caller and the rest pushed onto the pool, then a countdown the
+ *     caller waits on. Tasks are preallocated, so pushing one allocates
+ *     nothing.
+ *   - Merge sort: a power of two of chunks, at least CHUNKS_PER_THREAD
+ *     per thread, sorted by the kernel; then log2(chunks) rounds of
+ *     pairwise merges between the array and the scratch buffer. Every
+ *     merge is cut into pieces of about one chunk's length; a piece
+ *     finds where its slice of the output starts in each input by binary
+ *     search (the "merge path"), so pieces are independent.
+ *   - Radix sort: the array is cut into one block per thread. Each block
+ *     first counts its digits for every pass at once; the totals tell
+ *     which passes can be skipped. For each pass the caller turns the
+ *     per-block counts into output offsets and each block is scattered;
+ *     after the first scatter blocks recount, as their elements have
+ *     changed (a lone block never needs to). Keys are transformed as
+ *     they are read so that unsigned order is the right order: the sign
+ *     bit flipped for signed integers, and for floats all bits of
+ *     negatives.
+ */
+
+#include "par_sort.h"
+#include "ws_pool.h"
+
+/* Below these sizes the calling thread sorts alone */
+#define MIN_PARALLEL_MERGE 32768
+#define MIN_PARALLEL_RADIX 65536
+#define MIN_CHUNK 8192
+#define CHUNKS_PER_THREAD 4
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+typedef enum {
+    KIND_U32, KIND_I32, KIND_F32,
+    KIND_U64, KIND_I64, KIND_F64,
+    KIND_PAIR                        /* KeyPair: a ParSortKeyFunc result */
+} KeyKind;
+
+typedef struct {
+    guint64 key;
+    gpointer item;
+} KeyPair;
+
+typedef enum {
+    TASK_SORT,
+    TASK_MERGE,
+    TASK_COUNT_ALL,
+    TASK_HISTOGRAM,
+    TASK_SCATTER,
+    TASK_UNPAIR
+} TaskKind;
+
+typedef struct _Job Job;
+
+typedef struct {
+    Job *job;
+    TaskKind kind;
+    guint index;                     /* Radix block */
+    gsize start, end;                /* Elements; for a merge, of the output */
+    const guint8 *a, *b;             /* Merge inputs */
+    gsize na, nb;
+    guint8 *out;
+} Task;
+
+struct _Job {
+    gsize size;
+    guint8 *src, *dst;
+
+    /* Merge sort */
+    const ParSortKernel *kernel;
+    gpointer ctx;
+    gboolean to_scratch;             /* Sorted chunks get copied to dst */
+
+    /* Radix sort */
+    KeyKind kind;
+    guint pass;
+    gsize *counts;                   /* RADIX_BUCKETS per block and pass */
+    gpointer *items;                 /* TASK_UNPAIR output */
+
+    gint pending;                    /* Protected by lock */
+    GMutex lock;
+    GCond cond;
+};
+
+struct _ParSorter {
+    WsPool *pool;                    /* NULL for one thread */
+    guint n_threads;
+};
+
+typedef struct {
+    GCompareDataFunc func;
+    gpointer user_data;
+    gsize size;
+} CompareCtx;
+
+/* ============================================================
+ * Jobs
+ * ============================================================ */
+
+static void job_init(Job *job, gsize size, gpointer src, gpointer dst)
+{
+    memset(job, 0, sizeof(Job));
+    job->size = size;
+    job->src = src;
+    job->dst = dst;
+    g_mutex_init(&job->lock);
+    g_cond_init(&job->cond);
+}
+
+static void job_clear(Job *job)
+{
+    g_mutex_clear(&job->lock);
+    g_cond_clear(&job->cond);
+}
+
+static void task_run(Task *task);
+
+/* Under the lock, so the caller can't see the count reach zero and free
+ * the job before the last task is done with it. Tasks are thousands of
+ * elements each, so the lock is taken rarely. */
+static void task_done(Job *job)
+{
+    g_mutex_lock(&job->lock);
+    if (--job->pending == 0) {
+        g_cond_signal(&job->cond);
+    }
+    g_mutex_unlock(&job->lock);
+}
+
+static void pool_func(gpointer data, gpointer user_data)
+{
+    Task *task = data;
+
+    task_run(task);
+    task_done(task->job);
+}
+
+/* Runs @tasks[0] on the calling thread and the rest on the pool, and
+ * returns when all of them have finished */
+static void job_run(ParSorter *sorter, Job *job, Task *tasks, guint n_tasks)
+{
+    if (n_tasks == 0) {
+        return;
+    }
+
+    job->pending = n_tasks;
+    for (guint i = 1; i < n_tasks; i++) {
+        ws_pool_push(sorter->pool, &tasks[i], NULL);
+    }
+    pool_func(&tasks[0], NULL);
+
+    g_mutex_lock(&job->lock);
+    while (job->pending > 0) {
+        g_cond_wait(&job->cond, &job->lock);
+    }
+    g_mutex_unlock(&job->lock);
+}
+
+/* ============================================================
+ * Merge sort
+ * ============================================================ */
+
+/* How many of the first @k elements of the merge of @a and @b come from
+ * @a, with ties going to @a */
+static gsize merge_path(const Job *job, const guint8 *a, gsize na,
+                        const guint8 *b, gsize nb, gsize k)
+{
+    gsize lo = (k > nb) ? k - nb : 0;
+    gsize hi = MIN(k, na);
+
+    while (lo < hi) {
+        gsize i = lo + (hi - lo) / 2;
+        gsize j = k - i;
+
+        /* b[j - 1] >= a[i]: a[i] belongs before b[j - 1], so take more of a */
+        if (!job->kernel->less(b + (j - 1) * job->size, a + i * job->size, job->ctx)) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+static void merge_piece(Task *task)
+{
+    const Job *job = task->job;
+    gsize i0 = merge_path(job, task->a, task->na, task->b, task->nb, task->start);
+    gsize i1 = merge_path(job, task->a, task->na, task->b, task->nb, task->end);
+    gsize j0 = task->start - i0, j1 = task->end - i1;
+
+    job->kernel->merge(task->a + i0 * job->size, i1 - i0,
+                       task->b + j0 * job->size, j1 - j0,
+                       task->out + task->start * job->size, job->ctx);
+}
+
+static void sort_chunk(Task *task)
+{
+    const Job *job = task->job;
+    gsize offset = task->start * job->size;
+    gsize len = task->end - task->start;
+
+    job->kernel->sort(job->src + offset, len, job->dst + offset, job->ctx);
+    if (job->to_scratch) {
+        memcpy(job->dst + offset, job->src + offset, len * job->size);
+    }
+}
+
+void par_sort_run(ParSorter *sorter, gpointer base, gsize n, gsize size,
+                  const ParSortKernel *kernel, gpointer ctx)
+{
+    guint n_chunks = 1, rounds = 0, n_tasks;
+    gsize *bounds, piece;
+    guint8 *scratch;
+    Task *tasks;
+    Job job;
+
+    g_return_if_fail(kernel != NULL);
+
+    if (n < 2) {
+        return;
+    }
+
+    scratch = g_malloc(n * size);
+    if (sorter == NULL || sorter->n_threads == 1 || n < MIN_PARALLEL_MERGE) {
+        kernel->sort(base, n, scratch, ctx);
+        g_free(scratch);
+        return;
+    }
+
+    while (n_chunks < sorter->n_threads * CHUNKS_PER_THREAD && n / (n_chunks * 2) >= MIN_CHUNK) {
+        n_chunks *= 2;
+        rounds++;
+    }
+    bounds = g_new(gsize, n_chunks + 1);
+    for (guint c = 0; c <= n_chunks; c++) {
+        bounds[c] = (gsize)((guint64)n * c / n_chunks);
+    }
+    piece = (n + n_chunks - 1) / n_chunks;
+    /* A merge of L elements makes ceil(L / piece) pieces: at most one
+     * more per merge than chunks */
+    tasks = g_new0(Task, n_chunks * 2);
+
+    /* The last round must write into @base */
+    job_init(&job, size, base, scratch);
+    job.kernel = kernel;
+    job.ctx = ctx;
+    job.to_scratch = (rounds % 2 == 1);
+    for (guint c = 0; c < n_chunks; c++) {
+        tasks[c].job = &job;
+        tasks[c].kind = TASK_SORT;
+        tasks[c].start = bounds[c];
+        tasks[c].end = bounds[c + 1];
+    }
+    job_run(sorter, &job, tasks, n_chunks);
+
+    if (job.to_scratch) {
+        job.src = scratch;
+        job.dst = base;
+    }
+
+    for (guint width = 1; width < n_chunks; width *= 2) {
+        n_tasks = 0;
+        for (guint c = 0; c < n_chunks; c += 2 * width) {
+            gsize lo = bounds[c], mid = bounds[c + width], hi = bounds[c + 2 * width];
+
+            for (gsize k = 0; k < hi - lo; k += piece) {
+                Task *task = &tasks[n_tasks++];
+
+                task->job = &job;
+                task->kind = TASK_MERGE;
+                task->a = job.src + lo * size;
+                task->na = mid - lo;
+                task->b = job.src + mid * size;
+                task->nb = hi - mid;
+                task->out = job.dst + lo * size;
+                task->start = k;
+                task->end = MIN(k + piece, hi - lo);
+            }
+        }
+        job_run(sorter, &job, tasks, n_tasks);
+
+        guint8 *tmp = job.src;
+        job.src = job.dst;
+        job.dst = tmp;
+    }
+
+    job_clear(&job);
+    g_free(tasks);
+    g_free(bounds);
+    g_free(scratch);
+}
+
+/* ============================================================
+ * Comparator kernel
+ * ============================================================ */
+
+static void compare_sort(gpointer base, gsize n, gpointer scratch, gpointer ctx)
+{
+    CompareCtx *compare = ctx;
+
+#if GLIB_CHECK_VERSION(2, 82, 0)
+    g_sort_array(base, n, compare->size, compare->func, compare->user_data);
+#else
+    g_qsort_with_data(base, (gint)n, compare->size, compare->func, compare->user_data);
+#endif
+}
+
+static void compare_merge(gconstpointer a, gsize na, gconstpointer b, gsize nb,
+                          gpointer out, gpointer ctx)
+{
+    CompareCtx *compare = ctx;
+    const guint8 *pa = a, *pb = b;
+    const guint8 *a_end = pa + na * compare->size, *b_end = pb + nb * compare->size;
+    guint8 *po = out;
+
+    while (pa < a_end && pb < b_end) {
+        if (compare->func(pb, pa, compare->user_data) < 0) {
+            memcpy(po, pb, compare->size);
+            pb += compare->size;
+        } else {
+            memcpy(po, pa, compare->size);
+            pa += compare->size;
+        }
+        po += compare->size;
+    }
+    memcpy(po, pa, a_end - pa);
+    memcpy(po + (a_end - pa), pb, b_end - pb);
+}
+
+static gboolean compare_less(gconstpointer a, gconstpointer b, gpointer ctx)
+{
+    CompareCtx *compare = ctx;
+
+    return compare->func(a, b, compare->user_data) < 0;
+}
+
+static const ParSortKernel compare_kernel = {
+    compare_sort,
+    compare_merge,
+    compare_less
+};
+
+/* GCompareFunc takes no user data; calling one with an extra argument
+ * is what g_array_sort() does too */
+void par_sort_array(ParSorter *sorter, GArray *array, GCompareFunc compare_func)
+{
+    par_sort_array_with_data(sorter, array, (GCompareDataFunc)compare_func, NULL);
+}
+
+void par_sort_array_with_data(ParSorter *sorter, GArray *array,
+                              GCompareDataFunc compare_func, gpointer user_data)
+{
+    CompareCtx compare = { compare_func, user_data, 0 };
+
+    g_return_if_fail(array != NULL);
+    g_return_if_fail(compare_func != NULL);
+
+    compare.size = g_array_get_element_size(array);
+    par_sort_run(sorter, array->data, array->len, compare.size, &compare_kernel, &compare);
+}
+
+void par_sort_ptr_array(ParSorter *sorter, GPtrArray *array, GCompareFunc compare_func)
+{
+    par_sort_ptr_array_with_data(sorter, array, (GCompareDataFunc)compare_func, NULL);
+}
+
+void par_sort_ptr_array_with_data(ParSorter *sorter, GPtrArray *array,
+                                  GCompareDataFunc compare_func, gpointer user_data)
+{
+    CompareCtx compare = { compare_func, user_data, sizeof(gpointer) };
+
+    g_return_if_fail(array != NULL);
+    g_return_if_fail(compare_func != NULL);
+
+    par_sort_run(sorter, array->pdata, array->len, sizeof(gpointer), &compare_kernel, &compare);
+}
+
+/* ============================================================
+ * Radix sort
+ * ============================================================ */
+
+static const gsize kind_sizes[] = { 4, 4, 4, 8, 8, 8, sizeof(KeyPair) };
+
+/* Always inlined into a loop with a constant @kind, so each KeyKind gets
+ * its own loop with no switch in it */
+static inline __attribute__((always_inline)) guint64 radix_key(const guint8 *p, KeyKind kind)
+{
+    guint32 x32;
+    guint64 x64;
+
+    switch (kind) {
+    case KIND_U32:
+    case KIND_I32:
+    case KIND_F32:
+        memcpy(&x32, p, sizeof(x32));
+        if (kind == KIND_I32) {
+            x32 ^= 0x80000000u;
+        } else if (kind == KIND_F32) {
+            x32 ^= -(x32 >> 31) | 0x80000000u;
+        }
+        return x32;
+    case KIND_U64:
+    case KIND_I64:
+    case KIND_F64:
+        memcpy(&x64, p, sizeof(x64));
+        if (kind == KIND_I64) {
+            x64 ^= G_GUINT64_CONSTANT(0x8000000000000000);
+        } else if (kind == KIND_F64) {
+            x64 ^= -(x64 >> 63) | G_GUINT64_CONSTANT(0x8000000000000000);
+        }
+        return x64;
+    case KIND_PAIR:
+    default:
+        return ((const KeyPair *)p)->key;
+    }
+}
+
+static inline __attribute__((always_inline)) guint radix_passes(KeyKind kind)
+{
+    return (kind <= KIND_F32) ? 32 / RADIX_BITS : 64 / RADIX_BITS;
+}
+
+static inline __attribute__((always_inline)) gsize *
+radix_counts(const Job *job, guint block, guint pass)
+{
+    return job->counts + ((gsize)block * radix_passes(job->kind) + pass) * RADIX_BUCKETS;
+}
+
+static inline __attribute__((always_inline)) guint radix_digit(guint64 key, guint pass)
+{
+    return (key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1);
+}
+
+/* The block's digits for every pass in one read. The totals over all
+ * blocks stay right for the whole sort; a block's own counts only until
+ * the first scatter moves elements between blocks. */
+static inline __attribute__((always_inline)) void
+radix_count_all(Task *task, KeyKind kind)
+{
+    const Job *job = task->job;
+    gsize *counts = radix_counts(job, task->index, 0);
+    const gsize size = kind_sizes[kind];
+    const guint n_passes = radix_passes(kind);
+
+    memset(counts, 0, n_passes * RADIX_BUCKETS * sizeof(gsize));
+    for (gsize i = task->start; i < task->end; i++) {
+        guint64 key = radix_key(job->src + i * size, kind);
+
+        for (guint pass = 0; pass < n_passes; pass++) {
+            counts[pass * RADIX_BUCKETS + radix_digit(key, pass)]++;
+        }
+    }
+}
+
+static inline __attribute__((always_inline)) void
+radix_count(Task *task, KeyKind kind)
+{
+    const Job *job = task->job;
+    gsize *counts = radix_counts(job, task->index, job->pass);
+    const gsize size = kind_sizes[kind];
+
+    memset(counts, 0, RADIX_BUCKETS * sizeof(gsize));
+    for (gsize i = task->start; i < task->end; i++) {
+        counts[radix_digit(radix_key(job->src + i * size, kind), job->pass)]++;
+    }
+}
+
+static inline __attribute__((always_inline)) void
+radix_scatter(Task *task, KeyKind kind)
+{
+    const Job *job = task->job;
+    gsize *offsets = radix_counts(job, task->index, job->pass);
+    const gsize size = kind_sizes[kind];
+
+    for (gsize i = task->start; i < task->end; i++) {
+        const guint8 *p = job->src + i * size;
+        guint digit = radix_digit(radix_key(p, kind), job->pass);
+
+        memcpy(job->dst + offsets[digit]++ * size, p, size);
+    }
+}
+
+#define RADIX_DISPATCH(func, task)                                  \
+    G_STMT_START {                                                  \
+        switch ((task)->job->kind) {                                \
+        case KIND_U32: func(task, KIND_U32); break;                 \
+        case KIND_I32: func(task, KIND_I32); break;                 \
+        case KIND_F32: func(task, KIND_F32); break;                 \
+        case KIND_U64: func(task, KIND_U64); break;                 \
+        case KIND_I64: func(task, KIND_I64); break;                 \
+        case KIND_F64: func(task, KIND_F64); break;                 \
+        case KIND_PAIR: func(task, KIND_PAIR); break;               \
+        }                                                           \
+    } G_STMT_END
+
+static void unpair(Task *task)
+{
+    const KeyPair *pairs = (const KeyPair *)task->job->src;
+
+    for (gsize i = task->start; i < task->end; i++) {
+        task->job->items[i] = pairs[i].item;
+    }
+}
+
+/* Sorts @n elements at @base, of @kind, using @scratch. Returns where
+ * the sorted elements ended up: passes that need no moving are skipped,
+ * so that may be either. */
+static guint8 *radix_run(ParSorter *sorter, KeyKind kind, guint8 *base,
+                         guint8 *scratch, gsize n, gpointer *items)
+{
+    guint n_blocks = 1;
+    gboolean moved = FALSE;
+    Task *tasks;
+    Job job;
+
+    if (sorter != NULL && n >= MIN_PARALLEL_RADIX) {
+        n_blocks = sorter->n_threads;
+    }
+
+    job_init(&job, kind_sizes[kind], base, scratch);
+    job.kind = kind;
+    job.counts = g_new(gsize, (gsize)n_blocks * radix_passes(kind) * RADIX_BUCKETS);
+    job.items = items;
+    tasks = g_new0(Task, n_blocks);
+    for (guint b = 0; b < n_blocks; b++) {
+        tasks[b].job = &job;
+        tasks[b].kind = TASK_COUNT_ALL;
+        tasks[b].index = b;
+        tasks[b].start = (gsize)((guint64)n * b / n_blocks);
+        tasks[b].end = (gsize)((guint64)n * (b + 1) / n_blocks);
+    }
+    job_run(sorter, &job, tasks, n_blocks);
+
+    for (job.pass = 0; job.pass < radix_passes(kind); job.pass++) {
+        gboolean trivial = FALSE;
+        gsize position = 0;
+
+        /* Every key has the same digit: nothing would move */
+        for (guint d = 0; d < RADIX_BUCKETS && !trivial; d++) {
+            gsize total = 0;
+
+            for (guint b = 0; b < n_blocks; b++) {
+                total += radix_counts(&job, b, job.pass)[d];
+            }
+            trivial = (total == n);
+        }
+        if (trivial) {
+            continue;
+        }
+
+        if (moved && n_blocks > 1) {
+            for (guint b = 0; b < n_blocks; b++) {
+                tasks[b].kind = TASK_HISTOGRAM;
+            }
+            job_run(sorter, &job, tasks, n_blocks);
+        }
+
+        /* Exclusive prefix sum in (digit, block) order: each block's
+         * elements with a digit go after the previous blocks' */
+        for (guint d = 0; d < RADIX_BUCKETS; d++) {
+            for (guint b = 0; b < n_blocks; b++) {
+                gsize *count = &radix_counts(&job, b, job.pass)[d];
+                gsize c = *count;
+
+                *count = position;
+                position += c;
+            }
+        }
+
+        for (guint b = 0; b < n_blocks; b++) {
+            tasks[b].kind = TASK_SCATTER;
+        }
+        job_run(sorter, &job, tasks, n_blocks);
+        moved = TRUE;
+
+        guint8 *tmp = job.src;
+        job.src = job.dst;
+        job.dst = tmp;
+    }
+
+    if (items != NULL) {
+        for (guint b = 0; b < n_blocks; b++) {
+            tasks[b].kind = TASK_UNPAIR;
+        }
+        job_run(sorter, &job, tasks, n_blocks);
+    }
+
+    base = job.src;
+    job_clear(&job);
+    g_free(job.counts);
+    g_free(tasks);
+    return base;
+}
+
+void par_radix_sort_array(ParSorter *sorter, GArray *array, ParSortKey key)
+{
+    static const KeyKind kinds[] = {
+        KIND_U32, KIND_I32, KIND_F32, KIND_U64, KIND_I64, KIND_F64
+    };
+    KeyKind kind;
+    guint8 *scratch, *sorted;
+    gsize bytes;
+
+    g_return_if_fail(array != NULL);
+    g_return_if_fail(key <= PAR_SORT_KEY_DOUBLE);
+
+    kind = kinds[key];
+    g_return_if_fail(g_array_get_element_size(array) == kind_sizes[kind]);
+
+    if (array->len < 2) {
+        return;
+    }
+
+    bytes = (gsize)array->len * kind_sizes[kind];
+    scratch = g_malloc(bytes);
+    sorted = radix_run(sorter, kind, (guint8 *)array->data, scratch, array->len, NULL);
+    if (sorted != (guint8 *)array->data) {
+        memcpy(array->data, sorted, bytes);
+    }
+    g_free(scratch);
+}
+
+void par_radix_sort_ptr_array(ParSorter *sorter, GPtrArray *array, ParSortKeyFunc key_func)
+{
+    KeyPair *pairs, *scratch;
+
+    g_return_if_fail(array != NULL);
+    g_return_if_fail(key_func != NULL);
+
+    if (array->len < 2) {
+        return;
+    }
+
+    /* One call per item, then the pairs are sorted and the pointers
+     * written back in order */
+    pairs = g_new(KeyPair, array->len);
+    scratch = g_new(KeyPair, array->len);
+    for (guint i = 0; i < array->len; i++) {
+        pairs[i].key = key_func(array->pdata[i]);
+        pairs[i].item = array->pdata[i];
+    }
+    radix_run(sorter, KIND_PAIR, (guint8 *)pairs, (guint8 *)scratch, array->len, array->pdata);
+    g_free(scratch);
+    g_free(pairs);
+}
+
+/* ============================================================
+ * Tasks
+ * ============================================================ */
+
+static void task_run(Task *task)
+{
+    switch (task->kind) {
+    case TASK_SORT:
+        sort_chunk(task);
+        break;
+    case TASK_MERGE:
+        merge_piece(task);
+        break;
+    case TASK_COUNT_ALL:
+        RADIX_DISPATCH(radix_count_all, task);
+        break;
+    case TASK_HISTOGRAM:
+        RADIX_DISPATCH(radix_count, task);
+        break;
+    case TASK_SCATTER:
+        RADIX_DISPATCH(radix_scatter, task);
+        break;
+    case TASK_UNPAIR:
+        unpair(task);
+        break;
+    }
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+ParSorter *par_sorter_new(gint n_threads, GError **error)
+{
+    ParSorter *sorter = g_new0(ParSorter, 1);
+
+    sorter->n_threads = (n_threads > 0) ? (guint)n_threads : g_get_num_processors();
+    if (sorter->n_threads > 1) {
+        sorter->pool = ws_pool_new(pool_func, NULL, sorter->n_threads - 1, error);
+        if (sorter->pool == NULL) {
+            g_free(sorter);
+            return NULL;
+        }
+    }
+    return sorter;
+}
+
+void par_sorter_free(ParSorter *sorter)
+{
+    if (sorter == NULL) {
+        return;
+    }
+    if (sorter->pool != NULL) {
+        ws_pool_free(sorter->pool, FALSE, TRUE);
+    }
+    g_free(sorter);
+}
+
+guint par_sorter_get_num_threads(ParSorter *sorter)
+{
+    g_return_val_if_fail(sorter != NULL, 0);
+
+    return sorter->n_threads;
+}
@@ -0,0 +1,101 @@
+/*
+ * par_sort.h - Parallel sorting of GArrays and GPtrArrays on a WsPool
+ *
+ * g_array_sort(), g_ptr_array_sort() and g_queue_sort() run on one
+ * thread and call the comparator through a function pointer for every
+ * comparison. A ParSorter spreads a sort over a work-stealing pool
+ * (ws_pool.h):
+ *
+ *   - par_sort_array() and friends take the same comparators as GLib.
+ *     The array is cut into a few chunks per thread, each sorted with
+ *     g_qsort_with_data() as g_array_sort() does, and the sorted runs are
+ *     merged pairwise. Each merge is split into equal pieces by binary
+ *     search on the merge path, so the last merges, of a few huge runs,
+ *     still keep every thread busy
+ *   - par_sort_template.h generates the same sort for one element type
+ *     with the comparison written out as an expression, so the compiler
+ *     inlines it: no indirect call per comparison
+ *   - par_radix_sort_array() sorts integer and float keys with an LSD
+ *     radix sort, 8 bits per pass: each thread counts the digits of its
+ *     block, then scatters it. Passes whose digit is the same for every
+ *     key are skipped. par_radix_sort_ptr_array() does the same for the
+ *     pointers in a GPtrArray, by a 64-bit key taken from each once
+ *
+ * Every sort is stable, like g_array_sort(). They need a scratch buffer
+ * as large as the array. The calling thread takes part, so a sorter for
+ * N threads has N - 1 workers; don't sort from a task of its own pool.
+ */
+
+#ifndef PAR_SORT_H
+#define PAR_SORT_H
+
+#include <glib.h>
+#include <string.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ParSorter ParSorter;
+
+typedef enum {
+    PAR_SORT_KEY_UINT32,
+    PAR_SORT_KEY_INT32,
+    PAR_SORT_KEY_FLOAT,
+    PAR_SORT_KEY_UINT64,
+    PAR_SORT_KEY_INT64,
+    PAR_SORT_KEY_DOUBLE
+} ParSortKey;
+
+/* The order of items is that of the returned keys, as unsigned numbers.
+ * par_sort_key_int64() and par_sort_key_double() map other keys. */
+typedef guint64 (*ParSortKeyFunc)(gconstpointer item);
+
+/* Everything the merge sort needs to know about the elements; see
+ * par_sort_template.h for a generated one */
+typedef struct {
+    /* Sort @n elements at @base; @scratch has room for @n more */
+    void (*sort)(gpointer base, gsize n, gpointer scratch, gpointer ctx);
+    /* Merge sorted @a and @b into @out, taking from @a on ties */
+    void (*merge)(gconstpointer a, gsize na, gconstpointer b, gsize nb,
+                  gpointer out, gpointer ctx);
+    gboolean (*less)(gconstpointer a, gconstpointer b, gpointer ctx);
+} ParSortKernel;
+
+/* @n_threads counts the calling thread; -1 = one per processor, and 1
+ * sorts on the calling thread alone */
+ParSorter *par_sorter_new(gint n_threads, GError **error);
+void par_sorter_free(ParSorter *sorter);
+guint par_sorter_get_num_threads(ParSorter *sorter);
+
+/* As g_array_sort(), g_ptr_array_sort() and their _with_data() forms */
+void par_sort_array(ParSorter *sorter, GArray *array, GCompareFunc compare_func);
+void par_sort_array_with_data(ParSorter *sorter, GArray *array,
+                              GCompareDataFunc compare_func, gpointer user_data);
+void par_sort_ptr_array(ParSorter *sorter, GPtrArray *array, GCompareFunc compare_func);
+void par_sort_ptr_array_with_data(ParSorter *sorter, GPtrArray *array,
+                                  GCompareDataFunc compare_func, gpointer user_data);
+
+/* @array's elements must be of @key's type. Floats sort as numbers, with
+ * -0 before +0 and NaNs first or last by their sign bit. */
+void par_radix_sort_array(ParSorter *sorter, GArray *array, ParSortKey key);
+void par_radix_sort_ptr_array(ParSorter *sorter, GPtrArray *array, ParSortKeyFunc key_func);
+
+/* Sorts @n elements of @size bytes at @base with @kernel */
+void par_sort_run(ParSorter *sorter, gpointer base, gsize n, gsize size,
+                  const ParSortKernel *kernel, gpointer ctx);
+
+static inline guint64 par_sort_key_int64(gint64 value)
+{
+    return (guint64)value ^ G_GUINT64_CONSTANT(0x8000000000000000);
+}
+
+static inline guint64 par_sort_key_double(gdouble value)
+{
+    guint64 bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    return bits ^ (-(bits >> 63) | G_GUINT64_CONSTANT(0x8000000000000000));
+}
+
+G_END_DECLS
+
+#endif /* PAR_SORT_H */
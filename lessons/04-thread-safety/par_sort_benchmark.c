@@ -0,0 +1,265 @@
+/*
+ * par_sort_benchmark.c - g_array_sort() vs parallel merge and radix sorts
+ *
+ * For random doubles in a GArray of each size, the time per element
+ * taken by g_array_sort(), then for 1, 2, 4, ... threads and
+ * [max-threads] itself:
+ *   - par_sort_array(): the same comparator, parallel merge sort
+ *   - inlined: the par_sort_template.h sort, no comparator calls
+ *   - par_radix_sort_array() with PAR_SORT_KEY_DOUBLE
+ *
+ * Then the same for a GPtrArray of records sorted by a 64-bit key,
+ * against g_ptr_array_sort(). Each is a bench_run_ops() where one
+ * iteration copies the unsorted input back and sorts it, and the last
+ * result of each is checked.
+ *
+ * Usage: ./par_sort_benchmark [millions] [max-threads] [--bench-...]
+ *        (default 1 million as the largest size, one thread per processor)
+ */
+
+#include "bench.h"
+#include "par_sort.h"
+
+#include <stdlib.h>
+
+typedef struct {
+    guint64 key;
+    guint32 payload[6];
+} Record;
+
+#define PAR_SORT_NAME sort_doubles
+#define PAR_SORT_TYPE gdouble
+#define PAR_SORT_LESS(a, b) (*(a) < *(b))
+#include "par_sort_template.h"
+
+#define PAR_SORT_NAME sort_records
+#define PAR_SORT_TYPE Record *
+#define PAR_SORT_LESS(a, b) ((*(a))->key < (*(b))->key)
+#include "par_sort_template.h"
+
+typedef enum {
+    METHOD_COMPARATOR,
+    METHOD_INLINED,
+    METHOD_RADIX,
+    METHOD_GLIB
+} Method;
+
+static const gchar *method_names[] = { "comparator", "inlined", "radix", "GLib" };
+
+typedef struct {
+    ParSorter *sorter;               /* NULL for METHOD_GLIB */
+    Method method;
+    const gdouble *input;
+    GArray *array;
+    Record *records;
+    GPtrArray *ptr_array;
+} SortRun;
+
+static gint compare_double(gconstpointer a, gconstpointer b)
+{
+    gdouble x = *(const gdouble *)a, y = *(const gdouble *)b;
+
+    return (x > y) - (x < y);
+}
+
+static gint compare_record(gconstpointer a, gconstpointer b)
+{
+    guint64 x = (*(Record *const *)a)->key, y = (*(Record *const *)b)->key;
+
+    return (x > y) - (x < y);
+}
+
+static guint64 record_key(gconstpointer item)
+{
+    return ((const Record *)item)->key;
+}
+
+static void check_doubles(const GArray *array)
+{
+    for (guint i = 1; i < array->len; i++) {
+        if (g_array_index(array, gdouble, i - 1) > g_array_index(array, gdouble, i)) {
+            g_error("doubles not sorted at %u", i);
+        }
+    }
+}
+
+static void check_records(const GPtrArray *array)
+{
+    for (guint i = 1; i < array->len; i++) {
+        const Record *a = array->pdata[i - 1], *b = array->pdata[i];
+
+        /* Stable: equal keys keep their original (address) order */
+        if (a->key > b->key || (a->key == b->key && a > b)) {
+            g_error("records not sorted at %u", i);
+        }
+    }
+}
+
+static void doubles_bench(guint64 iterations, gpointer user_data)
+{
+    SortRun *run = user_data;
+    GArray *array = run->array;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        memcpy(array->data, run->input, array->len * sizeof(gdouble));
+        switch (run->method) {
+        case METHOD_COMPARATOR:
+            par_sort_array(run->sorter, array, compare_double);
+            break;
+        case METHOD_INLINED:
+            sort_doubles(run->sorter, (gdouble *)array->data, array->len);
+            break;
+        case METHOD_RADIX:
+            par_radix_sort_array(run->sorter, array, PAR_SORT_KEY_DOUBLE);
+            break;
+        case METHOD_GLIB:
+            g_array_sort(array, compare_double);
+            break;
+        }
+    }
+}
+
+static void records_bench(guint64 iterations, gpointer user_data)
+{
+    SortRun *run = user_data;
+    GPtrArray *array = run->ptr_array;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        for (guint i = 0; i < array->len; i++) {
+            array->pdata[i] = &run->records[i];
+        }
+        switch (run->method) {
+        case METHOD_COMPARATOR:
+            par_sort_ptr_array(run->sorter, array, compare_record);
+            break;
+        case METHOD_INLINED:
+            sort_records(run->sorter, (Record **)array->pdata, array->len);
+            break;
+        case METHOD_RADIX:
+            par_radix_sort_ptr_array(run->sorter, array, record_key);
+            break;
+        case METHOD_GLIB:
+            g_ptr_array_sort(array, compare_record);
+            break;
+        }
+    }
+}
+
+/* The median ns per element; the sorted result is checked */
+static gdouble time_sort(Bench *bench, const gchar *what, SortRun *run, guint n_threads)
+{
+    gboolean doubles = run->array != NULL;
+    guint n = doubles ? run->array->len : run->ptr_array->len;
+    gchar *name = (run->method == METHOD_GLIB)
+        ? g_strdup_printf("%s %u %s", what, n, method_names[run->method])
+        : g_strdup_printf("%s %u %s %u", what, n, method_names[run->method], n_threads);
+    const BenchResult *result = bench_run_ops(bench, name, n, doubles ? doubles_bench : records_bench,
+                                              run);
+
+    if (doubles) {
+        check_doubles(run->array);
+    } else {
+        check_records(run->ptr_array);
+    }
+    g_free(name);
+    return result->median_ns;
+}
+
+/* 1, 2, 4, ... and then @max_threads itself, e.g. 1, 2, 4, 6 */
+static guint next_thread_count(guint t, guint max_threads)
+{
+    if (t == max_threads) {
+        return max_threads + 1;
+    }
+    return MIN(t * 2, max_threads);
+}
+
+/* GLib's sort, then every method at each thread count, with the
+ * speedups over GLib */
+static void bench_sorts(Bench *bench, const gchar *what, SortRun *run, guint max_threads)
+{
+    gdouble baseline;
+
+    run->method = METHOD_GLIB;
+    baseline = time_sort(bench, what, run, 1);
+
+    for (guint t = 1; t <= max_threads; t = next_thread_count(t, max_threads)) {
+        gdouble ns[METHOD_GLIB];
+
+        run->sorter = par_sorter_new(t, NULL);
+        for (Method m = METHOD_COMPARATOR; m < METHOD_GLIB; m++) {
+            run->method = m;
+            ns[m] = time_sort(bench, what, run, t);
+        }
+        g_print("  %u threads vs GLib: comparator %.1fx, inlined %.1fx, radix %.1fx\n",
+                t, baseline / ns[0], baseline / ns[1], baseline / ns[2]);
+        g_clear_pointer(&run->sorter, par_sorter_free);
+    }
+}
+
+static void bench_doubles(Bench *bench, guint n, guint max_threads)
+{
+    gdouble *input = g_new(gdouble, n);
+    SortRun run = { .input = input, .array = g_array_sized_new(FALSE, FALSE, sizeof(gdouble), n) };
+
+    g_array_set_size(run.array, n);
+    for (guint i = 0; i < n; i++) {
+        input[i] = g_random_double_range(-1e6, 1e6);
+    }
+
+    g_print("\n%u doubles:\n", n);
+    bench_sorts(bench, "doubles", &run, max_threads);
+
+    g_array_free(run.array, TRUE);
+    g_free(input);
+}
+
+static void bench_records(Bench *bench, guint n, guint max_threads)
+{
+    SortRun run = { .records = g_new0(Record, n), .ptr_array = g_ptr_array_sized_new(n) };
+
+    g_ptr_array_set_size(run.ptr_array, n);
+    for (guint i = 0; i < n; i++) {
+        /* Plenty of duplicates, so stability gets checked */
+        run.records[i].key = g_random_int_range(0, n / 4 + 1);
+    }
+
+    g_print("\n%u records by key:\n", n);
+    bench_sorts(bench, "records", &run, max_threads);
+
+    g_ptr_array_free(run.ptr_array, TRUE);
+    g_free(run.records);
+}
+
+int main(int argc, char *argv[])
+{
+    Bench *bench = bench_new("par_sort_benchmark", &argc, &argv);
+    guint largest = (argc > 1) ? (guint)g_ascii_strtoull(argv[1], NULL, 10) : 1;
+    guint max_threads = (argc > 2) ? (guint)g_ascii_strtoull(argv[2], NULL, 10)
+                                   : g_get_num_processors();
+    guint n;
+
+    largest = CLAMP(largest, 1, 200) * 1000000;
+    max_threads = CLAMP(max_threads, 1, 64);
+
+    g_print("=== Parallel Sort Benchmark ===\n\n");
+    g_print("Sort time per element (%u processors)\n", g_get_num_processors());
+
+    for (n = 100000; n <= largest; n *= 10) {
+        bench_doubles(bench, n, max_threads);
+    }
+    if (n / 10 != largest) {
+        bench_doubles(bench, largest, max_threads);
+    }
+    bench_records(bench, MIN(largest, 1000000), max_threads);
+
+    g_print("\n=== Key Points ===\n");
+    g_print("- Sorting chunks in parallel is easy; the last merges are the bottleneck\n");
+    g_print("- Splitting each merge along the merge path keeps every thread busy to the end\n");
+    g_print("- An inlined comparison beats a comparator call even on one thread\n");
+    g_print("- Radix sort does a fixed number of passes and no comparisons at all\n");
+    g_print("- Sorting pointers by key touches each record once, not log n times\n");
+
+    bench_free(bench);
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * par_sort_template.h - A parallel merge sort for one element type
+ *
+ * Define the name, the element type and a "less than" expression over
+ * two const pointers to elements, then include this file:
+ *
+ *   #define PAR_SORT_NAME sort_samples
+ *   #define PAR_SORT_TYPE Sample
+ *   #define PAR_SORT_LESS(a, b) ((a)->key < (b)->key)
+ *   #include "par_sort_template.h"
+ *
+ * That defines
+ *
+ *   static void sort_samples(ParSorter *sorter, Sample *base, gsize n);
+ *
+ * which sorts like par_sort_array() but with PAR_SORT_LESS compiled
+ * into the insertion sort and the merges. For a GArray pass
+ * (Sample *)array->data and array->len; for a GPtrArray of Sample
+ * pointers use Sample * as the type, (*a)->key in the comparison and
+ * pass ->pdata. The file may be included any number of times.
+ */
+
+#include "par_sort.h"
+
+#if !defined(PAR_SORT_NAME) || !defined(PAR_SORT_TYPE) || !defined(PAR_SORT_LESS)
+#error "Define PAR_SORT_NAME, PAR_SORT_TYPE and PAR_SORT_LESS before including par_sort_template.h"
+#endif
+
+#define PAR_SORT_PASTE_(name, suffix) name##_##suffix
+#define PAR_SORT_PASTE(name, suffix) PAR_SORT_PASTE_(name, suffix)
+#define PAR_SORT_FN(suffix) PAR_SORT_PASTE(PAR_SORT_NAME, suffix)
+
+/* So that a pointer type works in declarations like "const T *a, *b" */
+typedef PAR_SORT_TYPE PAR_SORT_FN(type);
+
+/* Runs this short are sorted by insertion before merging */
+#ifndef PAR_SORT_INSERTION_RUN
+#define PAR_SORT_INSERTION_RUN 24
+#endif
+
+static void PAR_SORT_FN(insertion)(PAR_SORT_FN(type) *v, gsize n)
+{
+    for (gsize i = 1; i < n; i++) {
+        PAR_SORT_FN(type) x = v[i];
+        gsize j = i;
+
+        while (j > 0 && PAR_SORT_LESS(&x, &v[j - 1])) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+}
+
+static void PAR_SORT_FN(merge_runs)(const PAR_SORT_FN(type) *a, gsize na,
+                                    const PAR_SORT_FN(type) *b, gsize nb, PAR_SORT_FN(type) *out)
+{
+    const PAR_SORT_FN(type) *a_end = a + na, *b_end = b + nb;
+
+    while (a < a_end && b < b_end) {
+        *out++ = PAR_SORT_LESS(b, a) ? *b++ : *a++;
+    }
+    while (a < a_end) {
+        *out++ = *a++;
+    }
+    while (b < b_end) {
+        *out++ = *b++;
+    }
+}
+
+/* Bottom-up merge sort, bouncing between @base and @scratch */
+static void PAR_SORT_FN(kernel_sort)(gpointer base, gsize n, gpointer scratch, gpointer ctx)
+{
+    PAR_SORT_FN(type) *src = base, *dst = scratch, *tmp;
+
+    for (gsize i = 0; i < n; i += PAR_SORT_INSERTION_RUN) {
+        PAR_SORT_FN(insertion)(src + i, MIN(PAR_SORT_INSERTION_RUN, n - i));
+    }
+
+    for (gsize width = PAR_SORT_INSERTION_RUN; width < n; width *= 2) {
+        for (gsize lo = 0; lo < n; lo += 2 * width) {
+            gsize mid = MIN(lo + width, n), hi = MIN(lo + 2 * width, n);
+
+            PAR_SORT_FN(merge_runs)(src + lo, mid - lo, src + mid, hi - mid, dst + lo);
+        }
+        tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != base) {
+        memcpy(base, src, n * sizeof(PAR_SORT_FN(type)));
+    }
+}
+
+static void PAR_SORT_FN(kernel_merge)(gconstpointer a, gsize na, gconstpointer b, gsize nb,
+                                      gpointer out, gpointer ctx)
+{
+    PAR_SORT_FN(merge_runs)(a, na, b, nb, out);
+}
+
+static gboolean PAR_SORT_FN(kernel_less)(gconstpointer a, gconstpointer b, gpointer ctx)
+{
+    return PAR_SORT_LESS((const PAR_SORT_FN(type) *)a, (const PAR_SORT_FN(type) *)b);
+}
+
+static const ParSortKernel PAR_SORT_FN(kernel) = {
+    PAR_SORT_FN(kernel_sort),
+    PAR_SORT_FN(kernel_merge),
+    PAR_SORT_FN(kernel_less)
+};
+
+G_GNUC_UNUSED static void PAR_SORT_NAME(ParSorter *sorter, PAR_SORT_FN(type) *base, gsize n)
+{
+    par_sort_run(sorter, base, n, sizeof(PAR_SORT_FN(type)), &PAR_SORT_FN(kernel), NULL);
+}
+
+#undef PAR_SORT_FN
+#undef PAR_SORT_NAME
+#undef PAR_SORT_TYPE
+#undef PAR_SORT_LESS
@@ -0,0 +1,488 @@
+/*
+ * reactor_pool.c - One GMainContext per core, with source placement
+ *
+ * See reactor_pool.h for the API. The pieces:
+ *
+ *   - Each reactor owns a GMainContext, a GMainLoop and a thread that
+ *     pushes the context as thread-default and runs the loop. The
+ *     thread is pinned with pthread_setaffinity_np() when asked to.
+ *   - Posts go through an MpmcRingSource attached to the reactor's
+ *     context, spilling into a mutex-protected intrusive list only if
+ *     the ring is full (the same split as ws_pool.c's injector). A
+ *     reactor-owned "drain" post makes sure a spilled post is never
+ *     stranded when nothing else is queued behind it.
+ *   - Load is the number of live sources the pool placed. Placed sources
+ *     get a dispose function; since GSourceDisposeFunc has no user data,
+ *     a small locked table maps each placed source to its reactor.
+ *   - Utilisation comes from a GPollFunc wrapper: time inside g_poll()
+ *     is idle, time between one poll returning and the next starting is
+ *     busy. GPollFunc has no user data either, so the wrapper finds its
+ *     reactor through a GPrivate set by the reactor thread.
+ */
+
+#define _GNU_SOURCE
+
+#include "reactor_pool.h"
+#include "mpmc_ring.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_LINE 64
+#define POST_RING_SIZE 4096
+
+struct _Reactor {
+    ReactorPool *pool;
+    guint index;
+    gint cpu;
+    GMainContext *context;
+    GMainLoop *loop;
+    GThread *thread;
+    MpmcRingSource *posts;
+    ReactorPost stop;
+    ReactorPost drain;
+    gint drain_queued;
+
+    /* Written by the reactor thread, read by reactor_get_stats() */
+    gint64 last_wake;
+    gint64 busy_us;
+    gint64 idle_us;
+    guint64 iterations;
+    guint64 n_posts;
+
+    gint n_sources __attribute__((aligned(CACHE_LINE)));
+
+    GMutex overflow_lock __attribute__((aligned(CACHE_LINE)));
+    ReactorPost *overflow_head;
+    ReactorPost *overflow_tail;
+    gint overflow_len;
+} __attribute__((aligned(CACHE_LINE)));
+
+struct _ReactorPool {
+    Reactor *reactors;
+    guint n_reactors;
+    ReactorPlacement placement;
+    guint next __attribute__((aligned(CACHE_LINE)));   /* Round-robin cursor */
+};
+
+typedef struct {
+    ReactorPost post;
+    ReactorFunc func;
+    gpointer user_data;
+} InvokePost;
+
+static GPrivate current_reactor;
+
+/* Placed source -> Reactor, for the dispose function */
+G_LOCK_DEFINE_STATIC(placed);
+static GHashTable *placed_sources = NULL;
+
+static gpointer aligned_alloc0(gsize size)
+{
+    void *mem;
+
+    if (posix_memalign(&mem, CACHE_LINE, size) != 0) {
+        g_error("reactor_pool: out of memory");
+    }
+    memset(mem, 0, size);
+    return mem;
+}
+
+/* ============================================================
+ * Posts
+ * ============================================================ */
+
+static void drain_overflow(Reactor *self)
+{
+    ReactorPost *post;
+
+    if (g_atomic_int_get(&self->overflow_len) == 0) {
+        return;
+    }
+
+    g_mutex_lock(&self->overflow_lock);
+    post = self->overflow_head;
+    self->overflow_head = self->overflow_tail = NULL;
+    g_atomic_int_set(&self->overflow_len, 0);
+    g_mutex_unlock(&self->overflow_lock);
+
+    while (post) {
+        ReactorPost *next = post->next;
+
+        __atomic_store_n(&self->n_posts, self->n_posts + 1, __ATOMIC_RELAXED);
+        post->func(self, post);
+        post = next;
+    }
+}
+
+static void on_drain(Reactor *self, ReactorPost *post)
+{
+    /* Clear first: a spill after this point queues the drain again */
+    g_atomic_int_set(&self->drain_queued, 0);
+    drain_overflow(self);
+}
+
+static void on_stop(Reactor *self, ReactorPost *post)
+{
+    g_main_loop_quit(self->loop);
+}
+
+static gboolean on_posts(gpointer *items, guint n_items, gpointer user_data)
+{
+    Reactor *self = user_data;
+
+    __atomic_store_n(&self->n_posts, self->n_posts + n_items, __ATOMIC_RELAXED);
+    for (guint i = 0; i < n_items; i++) {
+        ReactorPost *post = items[i];
+
+        post->func(self, post);
+    }
+
+    /* Anything spilled while the ring was full */
+    drain_overflow(self);
+    return G_SOURCE_CONTINUE;
+}
+
+void reactor_post_init(ReactorPost *post, ReactorPostFunc func)
+{
+    post->func = func;
+    post->next = NULL;
+}
+
+void reactor_post(Reactor *reactor, ReactorPost *post)
+{
+    g_return_if_fail(reactor != NULL);
+    g_return_if_fail(post != NULL && post->func != NULL);
+
+    if (mpmc_ring_source_push(reactor->posts, post)) {
+        return;
+    }
+
+    post->next = NULL;
+    g_mutex_lock(&reactor->overflow_lock);
+    if (reactor->overflow_tail) {
+        reactor->overflow_tail->next = post;
+    } else {
+        reactor->overflow_head = post;
+    }
+    reactor->overflow_tail = post;
+    g_atomic_int_inc(&reactor->overflow_len);
+    g_mutex_unlock(&reactor->overflow_lock);
+
+    /* The ring may have drained since our push failed. Queue the drain
+     * post; if the ring is still full, the batch in it is dispatched
+     * after our spill and on_posts() drains the overflow anyway. */
+    if (g_atomic_int_compare_and_exchange(&reactor->drain_queued, 0, 1) &&
+        !mpmc_ring_source_push(reactor->posts, &reactor->drain)) {
+        g_atomic_int_set(&reactor->drain_queued, 0);
+    }
+}
+
+static void run_invoke(Reactor *reactor, ReactorPost *post)
+{
+    InvokePost *invoke = (InvokePost *)post;
+
+    invoke->func(invoke->user_data);
+    g_free(invoke);
+}
+
+void reactor_invoke(Reactor *reactor, ReactorFunc func, gpointer user_data)
+{
+    InvokePost *invoke;
+
+    g_return_if_fail(func != NULL);
+
+    invoke = g_new(InvokePost, 1);
+    reactor_post_init(&invoke->post, run_invoke);
+    invoke->func = func;
+    invoke->user_data = user_data;
+    reactor_post(reactor, &invoke->post);
+}
+
+/* ============================================================
+ * Placement
+ * ============================================================ */
+
+static void on_placed_source_dispose(GSource *source)
+{
+    Reactor *reactor;
+
+    G_LOCK(placed);
+    reactor = placed_sources ? g_hash_table_lookup(placed_sources, source) : NULL;
+    if (reactor) {
+        g_hash_table_remove(placed_sources, source);
+        g_atomic_int_add(&reactor->n_sources, -1);
+    }
+    G_UNLOCK(placed);
+}
+
+static gboolean placed_on_pool(gpointer key, gpointer value, gpointer user_data)
+{
+    return ((Reactor *)value)->pool == user_data;
+}
+
+void reactor_attach(Reactor *reactor, GSource *source)
+{
+    g_return_if_fail(reactor != NULL);
+    g_return_if_fail(source != NULL);
+
+    G_LOCK(placed);
+    if (placed_sources == NULL) {
+        placed_sources = g_hash_table_new(NULL, NULL);
+    }
+    g_hash_table_insert(placed_sources, source, reactor);
+    G_UNLOCK(placed);
+
+    g_atomic_int_inc(&reactor->n_sources);
+    g_source_set_dispose_function(source, on_placed_source_dispose);
+    g_source_attach(source, reactor->context);
+}
+
+Reactor *reactor_pool_choose(ReactorPool *pool)
+{
+    guint start;
+
+    g_return_val_if_fail(pool != NULL, NULL);
+
+    start = (guint)g_atomic_int_add((gint *)&pool->next, 1) % pool->n_reactors;
+    if (pool->placement == REACTOR_PLACEMENT_ROUND_ROBIN) {
+        return &pool->reactors[start];
+    }
+
+    /* Least loaded, scanning from the cursor so ties still rotate */
+    Reactor *best = &pool->reactors[start];
+    gint best_load = g_atomic_int_get(&best->n_sources);
+
+    for (guint i = 1; i < pool->n_reactors && best_load > 0; i++) {
+        Reactor *reactor = &pool->reactors[(start + i) % pool->n_reactors];
+        gint load = g_atomic_int_get(&reactor->n_sources);
+
+        if (load < best_load) {
+            best = reactor;
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+Reactor *reactor_pool_attach(ReactorPool *pool, GSource *source)
+{
+    Reactor *reactor = reactor_pool_choose(pool);
+
+    g_return_val_if_fail(reactor != NULL, NULL);
+
+    reactor_attach(reactor, source);
+    return reactor;
+}
+
+/* ============================================================
+ * Reactor threads
+ * ============================================================ */
+
+static gint reactor_poll(GPollFD *fds, guint nfds, gint timeout)
+{
+    Reactor *self = g_private_get(&current_reactor);
+    gint64 start, end;
+    gint ret;
+
+    if (self == NULL) {
+        return g_poll(fds, nfds, timeout);
+    }
+
+    start = g_get_monotonic_time();
+    ret = g_poll(fds, nfds, timeout);
+    end = g_get_monotonic_time();
+
+    __atomic_store_n(&self->busy_us, self->busy_us + (start - self->last_wake), __ATOMIC_RELAXED);
+    __atomic_store_n(&self->idle_us, self->idle_us + (end - start), __ATOMIC_RELAXED);
+    __atomic_store_n(&self->iterations, self->iterations + 1, __ATOMIC_RELAXED);
+    self->last_wake = end;
+
+    return ret;
+}
+
+/* The @index-th CPU this process may run on, wrapping around */
+static gint nth_allowed_cpu(guint index)
+{
+    cpu_set_t allowed;
+    gint count;
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 ||
+        (count = CPU_COUNT(&allowed)) == 0) {
+        return -1;
+    }
+
+    guint want = index % (guint)count;
+
+    for (gint cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed) && want-- == 0) {
+            return cpu;
+        }
+    }
+    return -1;
+}
+
+static void pin_to_cpu(Reactor *self)
+{
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(self->cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        g_warning("reactor %u: could not pin to CPU %d", self->index, self->cpu);
+        g_atomic_int_set(&self->cpu, -1);
+    }
+}
+
+static gpointer reactor_main(gpointer data)
+{
+    Reactor *self = data;
+
+    if (self->cpu >= 0) {
+        pin_to_cpu(self);
+    }
+
+    g_private_set(&current_reactor, self);
+    g_main_context_push_thread_default(self->context);
+    self->last_wake = g_get_monotonic_time();
+
+    g_main_loop_run(self->loop);
+
+    g_main_context_pop_thread_default(self->context);
+    g_private_set(&current_reactor, NULL);
+    return NULL;
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+static void reactor_init(ReactorPool *pool, Reactor *reactor, guint index, gboolean pin_threads)
+{
+    reactor->pool = pool;
+    reactor->index = index;
+    reactor->cpu = pin_threads ? nth_allowed_cpu(index) : -1;
+    reactor->context = g_main_context_new();
+    reactor->loop = g_main_loop_new(reactor->context, FALSE);
+    g_main_context_set_poll_func(reactor->context, reactor_poll);
+
+    reactor_post_init(&reactor->stop, on_stop);
+    reactor_post_init(&reactor->drain, on_drain);
+    g_mutex_init(&reactor->overflow_lock);
+
+    reactor->posts = mpmc_ring_source_new(POST_RING_SIZE, NULL);
+    g_source_set_callback((GSource *)reactor->posts, (GSourceFunc)on_posts, reactor, NULL);
+    g_source_attach((GSource *)reactor->posts, reactor->context);
+}
+
+static void reactor_clear(Reactor *reactor)
+{
+    g_source_destroy((GSource *)reactor->posts);
+    g_source_unref((GSource *)reactor->posts);
+    g_main_loop_unref(reactor->loop);
+    g_main_context_unref(reactor->context);
+    g_mutex_clear(&reactor->overflow_lock);
+}
+
+ReactorPool *reactor_pool_new(gint n_reactors,
+                              ReactorPlacement placement,
+                              gboolean pin_threads,
+                              GError **error)
+{
+    ReactorPool *pool = aligned_alloc0(sizeof(ReactorPool));
+
+    pool->n_reactors = (n_reactors > 0) ? (guint)n_reactors : g_get_num_processors();
+    pool->placement = placement;
+    pool->reactors = aligned_alloc0(pool->n_reactors * sizeof(Reactor));
+
+    for (guint i = 0; i < pool->n_reactors; i++) {
+        reactor_init(pool, &pool->reactors[i], i, pin_threads);
+    }
+
+    for (guint i = 0; i < pool->n_reactors; i++) {
+        Reactor *reactor = &pool->reactors[i];
+        gchar *name = g_strdup_printf("reactor-%u", i);
+
+        reactor->thread = g_thread_try_new(name, reactor_main, reactor, error);
+        g_free(name);
+
+        if (reactor->thread == NULL) {
+            for (guint j = i; j < pool->n_reactors; j++) {
+                reactor_clear(&pool->reactors[j]);
+            }
+            /* Stop the reactors that did start */
+            pool->n_reactors = i;
+            reactor_pool_free(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+void reactor_pool_free(ReactorPool *pool)
+{
+    g_return_if_fail(pool != NULL);
+
+    /* Quit from inside each loop: a g_main_loop_quit() from here could
+     * land before the thread has entered g_main_loop_run() */
+    for (guint i = 0; i < pool->n_reactors; i++) {
+        reactor_post(&pool->reactors[i], &pool->reactors[i].stop);
+    }
+    for (guint i = 0; i < pool->n_reactors; i++) {
+        g_thread_join(pool->reactors[i].thread);
+    }
+
+    /* Sources the caller still holds outlive their reactor's count */
+    G_LOCK(placed);
+    if (placed_sources) {
+        g_hash_table_foreach_remove(placed_sources, placed_on_pool, pool);
+    }
+    G_UNLOCK(placed);
+
+    for (guint i = 0; i < pool->n_reactors; i++) {
+        reactor_clear(&pool->reactors[i]);
+    }
+    free(pool->reactors);
+    free(pool);
+}
+
+guint reactor_pool_get_n_reactors(ReactorPool *pool)
+{
+    return pool->n_reactors;
+}
+
+Reactor *reactor_pool_get_reactor(ReactorPool *pool, guint index)
+{
+    g_return_val_if_fail(index < pool->n_reactors, NULL);
+
+    return &pool->reactors[index];
+}
+
+Reactor *reactor_pool_get_current(void)
+{
+    return g_private_get(&current_reactor);
+}
+
+GMainContext *reactor_get_context(Reactor *reactor)
+{
+    return reactor->context;
+}
+
+guint reactor_get_index(Reactor *reactor)
+{
+    return reactor->index;
+}
+
+void reactor_get_stats(Reactor *reactor, ReactorStats *stats)
+{
+    stats->index = reactor->index;
+    stats->cpu = g_atomic_int_get(&reactor->cpu);
+    stats->n_sources = (guint)MAX(g_atomic_int_get(&reactor->n_sources), 0);
+    stats->iterations = __atomic_load_n(&reactor->iterations, __ATOMIC_RELAXED);
+    stats->posts = __atomic_load_n(&reactor->n_posts, __ATOMIC_RELAXED);
+    stats->busy_us = __atomic_load_n(&reactor->busy_us, __ATOMIC_RELAXED);
+    stats->idle_us = __atomic_load_n(&reactor->idle_us, __ATOMIC_RELAXED);
+}
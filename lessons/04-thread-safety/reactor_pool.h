@@ -0,0 +1,107 @@
+/*
+ * reactor_pool.h - One GMainContext per core, with source placement
+ *
+ * context_threading.c runs one context on one owner thread, and
+ * multiple_contexts.c (lesson 3) iterates two by hand. A ReactorPool
+ * starts N threads, each optionally pinned to its own CPU, each running
+ * its own GMainContext as its thread-default context - so GIO async
+ * calls made from a reactor's callbacks complete on that reactor.
+ *
+ *   - placement: reactor_pool_attach() puts a new source (a listening
+ *     socket's accepted connection, a timer, ...) on the next reactor
+ *     round-robin, or on the one with the fewest live sources
+ *   - posting: reactor_post() hands an intrusive ReactorPost to a
+ *     reactor through its MpmcRingSource (mpmc_ring.h). Nothing is
+ *     allocated, and a burst of posts costs the target one wakeup
+ *   - utilisation: each reactor times how long it spends blocked in
+ *     poll() versus running callbacks
+ */
+
+#ifndef REACTOR_POOL_H
+#define REACTOR_POOL_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ReactorPool ReactorPool;
+typedef struct _Reactor Reactor;
+typedef struct _ReactorPost ReactorPost;
+
+typedef enum {
+    REACTOR_PLACEMENT_ROUND_ROBIN,
+    REACTOR_PLACEMENT_LEAST_LOADED   /* Fewest sources still alive */
+} ReactorPlacement;
+
+/* Runs on @reactor's thread. @post is the callee's from here on: it may
+ * be freed or posted again. */
+typedef void (*ReactorPostFunc)(Reactor *reactor, ReactorPost *post);
+
+/* Embed one in whatever is being handed over. All fields are private. */
+struct _ReactorPost {
+    ReactorPostFunc func;
+    ReactorPost *next;
+};
+
+typedef void (*ReactorFunc)(gpointer user_data);
+
+typedef struct {
+    guint index;
+    gint cpu;                  /* Pinned CPU, -1 if not pinned */
+    guint n_sources;           /* Live sources placed on this reactor */
+    guint64 iterations;        /* Calls to poll() */
+    guint64 posts;             /* Posts delivered */
+    gint64 busy_us;            /* Time outside poll(), up to the last poll */
+    gint64 idle_us;            /* Time blocked in poll() */
+} ReactorStats;
+
+/* @n_reactors -1 = one per processor. With @pin_threads, reactor i is
+ * bound to the i-th CPU the process may run on (wrapping around). */
+ReactorPool *reactor_pool_new(gint n_reactors,
+                              ReactorPlacement placement,
+                              gboolean pin_threads,
+                              GError **error);
+
+/* Stops every reactor and joins its thread. Sources still attached are
+ * destroyed with their context; pending posts are dropped. Don't post to
+ * the pool once this has been called. */
+void reactor_pool_free(ReactorPool *pool);
+
+guint reactor_pool_get_n_reactors(ReactorPool *pool);
+Reactor *reactor_pool_get_reactor(ReactorPool *pool, guint index);
+
+/* The reactor the calling thread runs, or NULL */
+Reactor *reactor_pool_get_current(void);
+
+/* Pick a reactor by the pool's placement policy, e.g. to post it a new
+ * connection that then creates its own sources there */
+Reactor *reactor_pool_choose(ReactorPool *pool);
+
+/* Attach @source to the chosen reactor's context and return that
+ * reactor. The caller keeps its reference. Sources placed by the pool
+ * (here or with reactor_attach()) get a dispose function that keeps the
+ * load count; don't set one of your own. */
+Reactor *reactor_pool_attach(ReactorPool *pool, GSource *source);
+void reactor_attach(Reactor *reactor, GSource *source);
+
+GMainContext *reactor_get_context(Reactor *reactor);
+guint reactor_get_index(Reactor *reactor);
+
+void reactor_post_init(ReactorPost *post, ReactorPostFunc func);
+
+/* Thread-safe and never blocks. Posts from one thread run in order
+ * unless the target's ring is full, when they spill onto a
+ * mutex-protected overflow list that is run after the ring's batch. */
+void reactor_post(Reactor *reactor, ReactorPost *post);
+
+/* Like g_main_context_invoke() but always queued, never run inline.
+ * Allocates one small struct instead of a GSource. */
+void reactor_invoke(Reactor *reactor, ReactorFunc func, gpointer user_data);
+
+/* Any thread. Counters are cumulative: utilisation over an interval is
+ * the busy_us delta over the busy_us + idle_us delta. */
+void reactor_get_stats(Reactor *reactor, ReactorStats *stats);
+
+G_END_DECLS
+
+#endif /* REACTOR_POOL_H */
@@ -0,0 +1,411 @@
+/*
+ * reactor_pool_benchmark.c - Cross-thread posting and reactor scaling
+ *
+ * 1. Throughput: 1, 2 and 4 producer threads send messages round-robin
+ *    to every reactor, via
+ *      - g_main_context_invoke(): one idle GSource per message
+ *      - reactor_invoke(): one small g_new'd struct per message
+ *      - reactor_post(): preallocated, intrusive, nothing allocated
+ *    timed with bench_run_ops(): one iteration is one message from
+ *    each producer, so the time is per message delivered
+ * 2. Latency: one message bounced between reactors 0 and 1, with
+ *    g_main_context_invoke() and with reactor_post(), timed per hop
+ * 3. Scaling: CONNECTIONS timeouts, each ticking every millisecond and
+ *    burning TICK_WORK_US of CPU per tick (about 3 cores of demand),
+ *    placed least-loaded on 1, 2, 4, ... reactors. Ticks/s and the
+ *    per-reactor utilisation the pool reports, sampled over one second:
+ *    what is measured is the load the reactors keep up with, not a time
+ *    per operation, so this part does not go through bench.h.
+ *
+ * Usage: ./reactor_pool_benchmark [max-reactors] [--bench-...]   (default: processors)
+ */
+
+#include "bench.h"
+#include "reactor_pool.h"
+
+#define MAX_PRODUCERS 4
+#define CONNECTIONS 64
+#define TICK_WORK_US 50
+
+typedef struct {
+    GMutex lock;
+    GCond cond;
+    gint remaining;
+    gboolean finished;               /* Under lock, so the waiter can't free us early */
+} Done;
+
+static void done_init(Done *done, gint count)
+{
+    g_mutex_init(&done->lock);
+    g_cond_init(&done->cond);
+    done->remaining = count;
+    done->finished = FALSE;
+}
+
+static void done_one(Done *done)
+{
+    if (g_atomic_int_dec_and_test(&done->remaining)) {
+        g_mutex_lock(&done->lock);
+        done->finished = TRUE;
+        g_cond_signal(&done->cond);
+        g_mutex_unlock(&done->lock);
+    }
+}
+
+static void done_wait(Done *done)
+{
+    g_mutex_lock(&done->lock);
+    while (!done->finished) {
+        g_cond_wait(&done->cond, &done->lock);
+    }
+    g_mutex_unlock(&done->lock);
+    g_mutex_clear(&done->lock);
+    g_cond_clear(&done->cond);
+}
+
+/* ============================================================
+ * Throughput
+ * ============================================================ */
+
+typedef enum {
+    VIA_GLIB_INVOKE,
+    VIA_REACTOR_INVOKE,
+    VIA_REACTOR_POST
+} Via;
+
+typedef struct {
+    ReactorPost post;
+    Done *done;
+} Message;
+
+typedef struct {
+    ReactorPool *pool;
+    Via via;
+    guint first;                     /* Reactor for the first message */
+    guint64 n_messages;
+    Message *messages;               /* For VIA_REACTOR_POST */
+    Done *done;
+} Producer;
+
+typedef struct {
+    ReactorPool *pool;
+    Via via;
+    guint n_producers;
+    Done done;
+    Message *messages;               /* Reused by every call; grown while calibrating */
+    guint64 n_allocated;
+} Throughput;
+
+static gboolean on_glib_message(gpointer user_data)
+{
+    done_one(user_data);
+    return G_SOURCE_REMOVE;
+}
+
+static void on_invoked_message(gpointer user_data)
+{
+    done_one(user_data);
+}
+
+static void on_posted_message(Reactor *reactor, ReactorPost *post)
+{
+    done_one(((Message *)post)->done);
+}
+
+static gpointer producer_main(gpointer data)
+{
+    Producer *p = data;
+    guint n_reactors = reactor_pool_get_n_reactors(p->pool);
+
+    for (guint64 i = 0; i < p->n_messages; i++) {
+        Reactor *reactor = reactor_pool_get_reactor(p->pool, (p->first + i) % n_reactors);
+
+        switch (p->via) {
+        case VIA_GLIB_INVOKE:
+            g_main_context_invoke(reactor_get_context(reactor), on_glib_message, p->done);
+            break;
+        case VIA_REACTOR_INVOKE:
+            reactor_invoke(reactor, on_invoked_message, p->done);
+            break;
+        case VIA_REACTOR_POST:
+            reactor_post(reactor, &p->messages[i].post);
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* Until a reactor's loop owns its context, g_main_context_invoke() from
+ * another thread may acquire it and run the callback inline */
+static void wait_until_running(ReactorPool *pool)
+{
+    guint n_reactors = reactor_pool_get_n_reactors(pool);
+    Message *messages = g_new(Message, n_reactors);
+    Done done;
+
+    done_init(&done, (gint)n_reactors);
+    for (guint i = 0; i < n_reactors; i++) {
+        reactor_post_init(&messages[i].post, on_posted_message);
+        messages[i].done = &done;
+        reactor_post(reactor_pool_get_reactor(pool, i), &messages[i].post);
+    }
+    done_wait(&done);
+    g_free(messages);
+}
+
+/* Every message has been delivered by the time this returns, so the
+ * next call can post them again */
+static void throughput_bench(guint64 iterations, gpointer user_data)
+{
+    Throughput *t = user_data;
+    Producer producers[MAX_PRODUCERS];
+    GThread *threads[MAX_PRODUCERS];
+    guint64 total = iterations * t->n_producers;
+
+    if (t->via == VIA_REACTOR_POST && t->n_allocated < total) {
+        g_free(t->messages);
+        t->messages = g_new(Message, total);
+        t->n_allocated = total;
+        for (guint64 m = 0; m < total; m++) {
+            reactor_post_init(&t->messages[m].post, on_posted_message);
+            t->messages[m].done = &t->done;
+        }
+    }
+    done_init(&t->done, (gint)total);
+
+    for (guint i = 0; i < t->n_producers; i++) {
+        Producer *p = &producers[i];
+
+        p->pool = t->pool;
+        p->via = t->via;
+        p->first = i;
+        p->n_messages = iterations;
+        p->done = &t->done;
+        p->messages = t->messages ? t->messages + i * iterations : NULL;
+        threads[i] = g_thread_new("producer", producer_main, p);
+    }
+    done_wait(&t->done);
+
+    for (guint i = 0; i < t->n_producers; i++) {
+        g_thread_join(threads[i]);
+    }
+}
+
+/* ============================================================
+ * Latency
+ * ============================================================ */
+
+typedef struct {
+    ReactorPost post;
+    ReactorPool *pool;
+    gboolean glib;
+    guint64 hops;
+    guint64 target;
+    Done done;
+} Ball;
+
+static Reactor *other_reactor(Ball *ball, Reactor *reactor)
+{
+    return reactor_pool_get_reactor(ball->pool, reactor_get_index(reactor) == 0 ? 1 : 0);
+}
+
+static void on_ball_posted(Reactor *reactor, ReactorPost *post)
+{
+    Ball *ball = (Ball *)post;
+
+    if (++ball->hops == ball->target) {
+        done_one(&ball->done);
+    } else {
+        reactor_post(other_reactor(ball, reactor), post);
+    }
+}
+
+static gboolean on_ball_invoked(gpointer user_data)
+{
+    Ball *ball = user_data;
+
+    if (++ball->hops == ball->target) {
+        done_one(&ball->done);
+    } else {
+        Reactor *next = other_reactor(ball, reactor_pool_get_current());
+
+        g_main_context_invoke(reactor_get_context(next), on_ball_invoked, ball);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+/* One iteration is one hop */
+static void ping_pong_bench(guint64 iterations, gpointer user_data)
+{
+    Ball *ball = user_data;
+    Reactor *first = reactor_pool_get_reactor(ball->pool, 0);
+
+    ball->hops = 0;
+    ball->target = iterations;
+    done_init(&ball->done, 1);
+    reactor_post_init(&ball->post, on_ball_posted);
+
+    if (ball->glib) {
+        g_main_context_invoke(reactor_get_context(first), on_ball_invoked, ball);
+    } else {
+        reactor_post(first, &ball->post);
+    }
+    done_wait(&ball->done);
+}
+
+/* ============================================================
+ * Scaling
+ * ============================================================ */
+
+typedef struct {
+    guint64 ticks;
+} Connection;
+
+static gboolean on_tick(gpointer user_data)
+{
+    Connection *conn = user_data;
+    gint64 end = g_get_monotonic_time() + TICK_WORK_US;
+
+    while (g_get_monotonic_time() < end) {
+        /* Stand-in for parsing a request */
+    }
+    __atomic_store_n(&conn->ticks, conn->ticks + 1, __ATOMIC_RELAXED);
+    return G_SOURCE_CONTINUE;
+}
+
+static guint64 total_ticks(Connection *conns)
+{
+    guint64 total = 0;
+
+    for (guint i = 0; i < CONNECTIONS; i++) {
+        total += __atomic_load_n(&conns[i].ticks, __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+static void run_scaling(guint n_reactors)
+{
+    GError *error = NULL;
+    ReactorPool *pool = reactor_pool_new((gint)n_reactors, REACTOR_PLACEMENT_LEAST_LOADED,
+                                         TRUE, &error);
+    Connection *conns = g_new0(Connection, CONNECTIONS);
+    ReactorStats *before = g_new(ReactorStats, n_reactors);
+    gdouble sum_util = 0, max_util = 0;
+
+    if (pool == NULL) {
+        g_printerr("[Error] %s\n", error->message);
+        g_error_free(error);
+        return;
+    }
+
+    for (guint i = 0; i < CONNECTIONS; i++) {
+        GSource *source = g_timeout_source_new(1);
+
+        g_source_set_callback(source, on_tick, &conns[i], NULL);
+        reactor_pool_attach(pool, source);
+        g_source_unref(source);
+    }
+
+    g_usleep(G_USEC_PER_SEC / 5);    /* Warm up */
+    for (guint r = 0; r < n_reactors; r++) {
+        reactor_get_stats(reactor_pool_get_reactor(pool, r), &before[r]);
+    }
+    guint64 ticks = total_ticks(conns);
+    gint64 start = g_get_monotonic_time();
+
+    g_usleep(G_USEC_PER_SEC);
+
+    ticks = total_ticks(conns) - ticks;
+    gdouble seconds = (g_get_monotonic_time() - start) / (gdouble)G_TIME_SPAN_SECOND;
+
+    for (guint r = 0; r < n_reactors; r++) {
+        ReactorStats after;
+
+        reactor_get_stats(reactor_pool_get_reactor(pool, r), &after);
+
+        gint64 busy = after.busy_us - before[r].busy_us;
+        gint64 idle = after.idle_us - before[r].idle_us;
+        gdouble util = (busy + idle > 0) ? (gdouble)busy / (busy + idle) : 0.0;
+
+        sum_util += util;
+        max_util = MAX(max_util, util);
+    }
+
+    guint per_reactor = CONNECTIONS / n_reactors;
+
+    g_print("%-9u %12.0f %10.0f%% %9.0f%% %12u\n",
+            n_reactors, ticks / seconds, 100.0 * sum_util / n_reactors, 100.0 * max_util,
+            per_reactor);
+
+    reactor_pool_free(pool);
+    g_free(before);
+    g_free(conns);
+}
+
+/* ============================================================
+ * Driver
+ * ============================================================ */
+
+int main(int argc, char *argv[])
+{
+    Bench *bench = bench_new("reactor_pool_benchmark", &argc, &argv);
+    guint max_reactors = (argc > 1) ? (guint)g_ascii_strtoull(argv[1], NULL, 10)
+                                    : g_get_num_processors();
+    GError *error = NULL;
+    static const guint producer_counts[] = { 1, 2, MAX_PRODUCERS };
+    static const gchar *via_names[] = { "context_invoke", "reactor_invoke", "reactor_post" };
+
+    max_reactors = CLAMP(max_reactors, 2, CONNECTIONS);
+
+    ReactorPool *pool = reactor_pool_new(MIN(max_reactors, 4), REACTOR_PLACEMENT_ROUND_ROBIN,
+                                         TRUE, &error);
+
+    if (pool == NULL) {
+        g_printerr("Failed to start reactors: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+    wait_until_running(pool);
+
+    g_print("=== Reactor Pool Benchmark ===\n\n");
+    g_print("Posting to %u reactors, time per message (%u processors)\n",
+            reactor_pool_get_n_reactors(pool), g_get_num_processors());
+
+    for (guint i = 0; i < G_N_ELEMENTS(producer_counts); i++) {
+        for (Via via = VIA_GLIB_INVOKE; via <= VIA_REACTOR_POST; via++) {
+            Throughput t = { .pool = pool, .via = via, .n_producers = producer_counts[i] };
+            gchar *name = g_strdup_printf("%s, %u producers", via_names[via], t.n_producers);
+
+            bench_run_ops(bench, name, t.n_producers, throughput_bench, &t);
+            g_free(name);
+            g_free(t.messages);
+        }
+    }
+
+    g_print("\nPing-pong between two reactors, time per hop\n");
+    for (gint glib = 1; glib >= 0; glib--) {
+        Ball ball = { .pool = pool, .glib = glib };
+
+        bench_run(bench, glib ? "ping-pong context_invoke" : "ping-pong reactor_post",
+                  ping_pong_bench, &ball);
+    }
+
+    reactor_pool_free(pool);
+
+    g_print("\n%d connections, 1 ms ticks, %d us of work each\n", CONNECTIONS, TICK_WORK_US);
+    g_print("%-9s %12s %11s %10s %12s\n",
+            "Reactors", "Ticks/s", "Mean util", "Max util", "Conns each");
+    for (guint n = 1; n <= max_reactors; n *= 2) {
+        run_scaling(n);
+    }
+
+    g_print("\n=== Key Points ===\n");
+    g_print("- g_main_context_invoke() from another thread allocates and attaches a GSource\n");
+    g_print("- A post is one CAS into the target's ring; a burst costs one wakeup\n");
+    g_print("- Each reactor's thread-default context keeps GIO callbacks on that core\n");
+    g_print("- Utilisation is time outside poll(): near 100%% means the reactor is the bottleneck\n");
+    g_print("- Once demand exceeds one core, adding reactors raises ticks/s until it is met\n");
+
+    bench_free(bench);
+    return 0;
+}
@@ -0,0 +1,577 @@
+/*
+ * ws_pool.c - Work-stealing thread pool
+ *
+ * See ws_pool.h for the API. The pieces:
+ *
+ *   - Per-worker Chase-Lev deque (Le et al., "Correct and Efficient
+ *     Work-Stealing for Weak Memory Models"). The owner pushes and takes
+ *     at the bottom without locks; thieves CAS the top. The buffer grows
+ *     by doubling, and old buffers are kept until the pool is freed
+ *     because a thief may still be reading one.
+ *   - An MpmcRing (mpmc_ring.h) as the injection queue for tasks from
+ *     outside the pool, spilling into a mutex-protected
+ *     GQueue only if the ring is full. A worker that dequeues from it
+ *     moves a small batch onto its own deque so the others can steal.
+ *   - Parking: a worker that finds nothing after a short spin announces
+ *     itself idle, re-checks every queue, then sleeps on a GCond. Pushers
+ *     only touch the lock when someone is idle.
+ */
+
+#include "ws_pool.h"
+#include "mpmc_ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_LINE 64
+#define DEQUE_INITIAL_SIZE 256
+#define INJECTOR_SIZE 8192
+#define INJECT_BATCH 16
+#define SPIN_ROUNDS 32
+
+enum {
+    RUNNING,
+    SHUTDOWN_DRAIN,
+    SHUTDOWN_IMMEDIATE
+};
+
+enum {
+    STEAL_EMPTY,
+    STEAL_OK,
+    STEAL_ABORT     /* Lost a race with another thief or the owner */
+};
+
+typedef struct {
+    gint64 mask;
+    gpointer slots[];
+} DequeBuffer;
+
+typedef struct {
+    gint64 top __attribute__((aligned(CACHE_LINE)));
+    gint64 bottom __attribute__((aligned(CACHE_LINE)));
+    DequeBuffer *buffer;
+    GPtrArray *retired;
+} WsDeque;
+
+typedef struct {
+    WsPool *pool;
+    GThread *thread;
+    guint32 rng;
+    WsDeque deque;
+} __attribute__((aligned(CACHE_LINE))) WsWorker;
+
+struct _WsPool {
+    GFunc func;
+    gpointer user_data;
+    WsWorker *workers;
+    guint n_workers;
+
+    MpmcRing *injector;
+
+    GMutex overflow_lock __attribute__((aligned(CACHE_LINE)));
+    GQueue overflow;
+    gint overflow_len;
+
+    GMutex park_lock;
+    GCond park_cond;
+    guint wakeups;                   /* Protected by park_lock */
+    gint n_idle;
+
+    gint unprocessed;
+    guint64 steals;
+    gint state;
+    gint ref_count;
+};
+
+static GPrivate current_worker;
+
+static gpointer aligned_alloc0(gsize size)
+{
+    void *mem;
+
+    if (posix_memalign(&mem, CACHE_LINE, size) != 0) {
+        g_error("ws_pool: out of memory");
+    }
+    memset(mem, 0, size);
+    return mem;
+}
+
+/* ============================================================
+ * Chase-Lev deque
+ * ============================================================ */
+
+static DequeBuffer *deque_buffer_new(gint64 size)
+{
+    DequeBuffer *buffer = g_malloc(sizeof(DequeBuffer) + size * sizeof(gpointer));
+    buffer->mask = size - 1;
+    return buffer;
+}
+
+static void deque_init(WsDeque *deque)
+{
+    deque->top = 0;
+    deque->bottom = 0;
+    deque->buffer = deque_buffer_new(DEQUE_INITIAL_SIZE);
+    deque->retired = g_ptr_array_new_with_free_func(g_free);
+}
+
+static void deque_clear(WsDeque *deque)
+{
+    g_free(deque->buffer);
+    g_ptr_array_free(deque->retired, TRUE);
+}
+
+static DequeBuffer *deque_grow(WsDeque *deque, DequeBuffer *old,
+                               gint64 bottom, gint64 top)
+{
+    DequeBuffer *buffer = deque_buffer_new((old->mask + 1) * 2);
+
+    for (gint64 i = top; i < bottom; i++) {
+        buffer->slots[i & buffer->mask] =
+            __atomic_load_n(&old->slots[i & old->mask], __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n(&deque->buffer, buffer, __ATOMIC_RELEASE);
+    g_ptr_array_add(deque->retired, old);
+    return buffer;
+}
+
+/* Owner only */
+static void deque_push(WsDeque *deque, gpointer task)
+{
+    gint64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    gint64 top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    DequeBuffer *buffer = __atomic_load_n(&deque->buffer, __ATOMIC_RELAXED);
+
+    if (bottom - top > buffer->mask) {
+        buffer = deque_grow(deque, buffer, bottom, top);
+    }
+
+    __atomic_store_n(&buffer->slots[bottom & buffer->mask], task, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+}
+
+/* Owner only: LIFO end */
+static gpointer deque_take(WsDeque *deque)
+{
+    gint64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    DequeBuffer *buffer = __atomic_load_n(&deque->buffer, __ATOMIC_RELAXED);
+    gint64 top;
+    gpointer task = NULL;
+
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    if (top <= bottom) {
+        task = __atomic_load_n(&buffer->slots[bottom & buffer->mask], __ATOMIC_RELAXED);
+        if (top == bottom) {
+            /* Last item: race the thieves for it */
+            if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, FALSE,
+                                             __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+                task = NULL;
+            }
+            __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        }
+    } else {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+
+    return task;
+}
+
+/* Any thread: FIFO end */
+static gint deque_steal(WsDeque *deque, gpointer *task)
+{
+    gint64 top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    gint64 bottom;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+
+    if (top >= bottom) {
+        return STEAL_EMPTY;
+    }
+
+    DequeBuffer *buffer = __atomic_load_n(&deque->buffer, __ATOMIC_ACQUIRE);
+    *task = __atomic_load_n(&buffer->slots[top & buffer->mask], __ATOMIC_RELAXED);
+
+    if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, FALSE,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return STEAL_ABORT;
+    }
+
+    return STEAL_OK;
+}
+
+static inline gboolean deque_is_empty(WsDeque *deque)
+{
+    return __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE) <=
+           __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+}
+
+/* ============================================================
+ * Injection queue
+ * ============================================================ */
+
+static gpointer inject_try_pop(WsPool *pool)
+{
+    gpointer task;
+
+    return mpmc_ring_try_pop(pool->injector, &task) ? task : NULL;
+}
+
+static void inject_push(WsPool *pool, gpointer task)
+{
+    if (mpmc_ring_try_push(pool->injector, task)) {
+        return;
+    }
+
+    g_mutex_lock(&pool->overflow_lock);
+    g_queue_push_tail(&pool->overflow, task);
+    g_atomic_int_inc(&pool->overflow_len);
+    g_mutex_unlock(&pool->overflow_lock);
+}
+
+static gpointer inject_pop(WsPool *pool)
+{
+    gpointer task = inject_try_pop(pool);
+
+    if (task == NULL && g_atomic_int_get(&pool->overflow_len) > 0) {
+        g_mutex_lock(&pool->overflow_lock);
+        task = g_queue_pop_head(&pool->overflow);
+        if (task) {
+            g_atomic_int_add(&pool->overflow_len, -1);
+        }
+        g_mutex_unlock(&pool->overflow_lock);
+    }
+
+    return task;
+}
+
+static gboolean inject_is_empty(WsPool *pool)
+{
+    return mpmc_ring_length(pool->injector) == 0 &&
+           g_atomic_int_get(&pool->overflow_len) == 0;
+}
+
+/* ============================================================
+ * Scheduling
+ * ============================================================ */
+
+static gboolean pool_has_work(WsPool *pool)
+{
+    if (!inject_is_empty(pool)) {
+        return TRUE;
+    }
+
+    for (guint i = 0; i < pool->n_workers; i++) {
+        if (!deque_is_empty(&pool->workers[i].deque)) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static void wake_one(WsPool *pool)
+{
+    /* Pairs with the n_idle increment in park(): either the parker sees
+     * the new task on its re-check or we see it idle */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (g_atomic_int_get(&pool->n_idle) == 0) {
+        return;
+    }
+
+    g_mutex_lock(&pool->park_lock);
+    if (pool->wakeups < (guint)g_atomic_int_get(&pool->n_idle)) {
+        pool->wakeups++;
+        g_cond_signal(&pool->park_cond);
+    }
+    g_mutex_unlock(&pool->park_lock);
+}
+
+/* Returns FALSE when the worker should exit */
+static gboolean park(WsPool *pool)
+{
+    g_atomic_int_inc(&pool->n_idle);
+    /* Store-load, pairing with the fence in wake_one(): without it the
+     * increment can still be in our store buffer when we look for work,
+     * so a submitter reads n_idle == 0 and skips the wakeup while we see
+     * no task and sleep, stranding it */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (pool_has_work(pool)) {
+        g_atomic_int_add(&pool->n_idle, -1);
+        return TRUE;
+    }
+
+    g_mutex_lock(&pool->park_lock);
+    while (pool->wakeups == 0 && g_atomic_int_get(&pool->state) == RUNNING) {
+        g_cond_wait(&pool->park_cond, &pool->park_lock);
+    }
+    if (pool->wakeups > 0) {
+        pool->wakeups--;
+    }
+    g_mutex_unlock(&pool->park_lock);
+
+    g_atomic_int_add(&pool->n_idle, -1);
+
+    switch (g_atomic_int_get(&pool->state)) {
+    case RUNNING:
+        return TRUE;
+    case SHUTDOWN_DRAIN:
+        return pool_has_work(pool);
+    default:
+        return FALSE;
+    }
+}
+
+static gpointer steal_any(WsWorker *self)
+{
+    WsPool *pool = self->pool;
+    guint n = pool->n_workers;
+    guint start;
+
+    /* xorshift32: pick a random first victim to spread thieves out */
+    self->rng ^= self->rng << 13;
+    self->rng ^= self->rng >> 17;
+    self->rng ^= self->rng << 5;
+    start = self->rng % n;
+
+    for (guint i = 0; i < n; i++) {
+        WsWorker *victim = &pool->workers[(start + i) % n];
+        gpointer task;
+        gint result;
+
+        if (victim == self) {
+            continue;
+        }
+
+        do {
+            result = deque_steal(&victim->deque, &task);
+        } while (result == STEAL_ABORT);
+
+        if (result == STEAL_OK) {
+            __atomic_fetch_add(&pool->steals, 1, __ATOMIC_RELAXED);
+            return task;
+        }
+    }
+
+    return NULL;
+}
+
+static gpointer find_task(WsWorker *self)
+{
+    WsPool *pool = self->pool;
+    gpointer task = deque_take(&self->deque);
+
+    if (task) {
+        return task;
+    }
+
+    task = inject_pop(pool);
+    if (task) {
+        /* Take a batch so the injector isn't hit once per task; the
+         * extras can be stolen by idle workers */
+        guint moved = 0;
+        gpointer extra;
+
+        while (moved < INJECT_BATCH - 1 && (extra = inject_try_pop(pool)) != NULL) {
+            deque_push(&self->deque, extra);
+            moved++;
+        }
+        if (moved > 0) {
+            wake_one(pool);
+        }
+        return task;
+    }
+
+    return steal_any(self);
+}
+
+static void pool_unref(WsPool *pool)
+{
+    if (!g_atomic_int_dec_and_test(&pool->ref_count)) {
+        return;
+    }
+
+    for (guint i = 0; i < pool->n_workers; i++) {
+        deque_clear(&pool->workers[i].deque);
+    }
+    g_queue_clear(&pool->overflow);
+    g_mutex_clear(&pool->overflow_lock);
+    g_mutex_clear(&pool->park_lock);
+    g_cond_clear(&pool->park_cond);
+    mpmc_ring_free(pool->injector);
+    free(pool->workers);
+    free(pool);
+}
+
+static gpointer worker_main(gpointer data)
+{
+    WsWorker *self = (WsWorker *)data;
+    WsPool *pool = self->pool;
+
+    g_private_set(&current_worker, self);
+
+    for (;;) {
+        gpointer task = NULL;
+
+        for (guint spin = 0; spin < SPIN_ROUNDS && task == NULL; spin++) {
+            if (g_atomic_int_get(&pool->state) == SHUTDOWN_IMMEDIATE) {
+                goto out;
+            }
+            task = find_task(self);
+        }
+
+        if (task) {
+            g_atomic_int_add(&pool->unprocessed, -1);
+            pool->func(task, pool->user_data);
+            continue;
+        }
+
+        if (!park(pool)) {
+            break;
+        }
+    }
+
+out:
+    g_private_set(&current_worker, NULL);
+    pool_unref(pool);
+    return NULL;
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+WsPool *ws_pool_new(GFunc func,
+                    gpointer user_data,
+                    gint max_threads,
+                    GError **error)
+{
+    WsPool *pool;
+    guint n_workers;
+
+    g_return_val_if_fail(func != NULL, NULL);
+
+    n_workers = (max_threads > 0) ? (guint)max_threads : g_get_num_processors();
+
+    pool = aligned_alloc0(sizeof(WsPool));
+    pool->func = func;
+    pool->user_data = user_data;
+    pool->n_workers = n_workers;
+    pool->workers = aligned_alloc0(n_workers * sizeof(WsWorker));
+
+    pool->injector = mpmc_ring_new(INJECTOR_SIZE);
+
+    g_mutex_init(&pool->overflow_lock);
+    g_queue_init(&pool->overflow);
+    g_mutex_init(&pool->park_lock);
+    g_cond_init(&pool->park_cond);
+    pool->state = RUNNING;
+    /* One reference for the caller, one per worker */
+    pool->ref_count = 1;
+
+    for (guint i = 0; i < n_workers; i++) {
+        WsWorker *worker = &pool->workers[i];
+
+        worker->pool = pool;
+        worker->rng = 0x9E3779B9u * (i + 1);
+        deque_init(&worker->deque);
+    }
+
+    for (guint i = 0; i < n_workers; i++) {
+        WsWorker *worker = &pool->workers[i];
+        gchar *name = g_strdup_printf("ws-worker-%u", i);
+
+        g_atomic_int_inc(&pool->ref_count);
+        worker->thread = g_thread_try_new(name, worker_main, worker, error);
+        g_free(name);
+
+        if (worker->thread == NULL) {
+            g_atomic_int_add(&pool->ref_count, -1);
+            for (guint j = i; j < n_workers; j++) {
+                deque_clear(&pool->workers[j].deque);
+            }
+            /* Shut down the workers that did start; this drops our ref */
+            pool->n_workers = i;
+            ws_pool_free(pool, TRUE, TRUE);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+gboolean ws_pool_push(WsPool *pool, gpointer data, GError **error)
+{
+    WsWorker *worker;
+
+    g_return_val_if_fail(pool != NULL, FALSE);
+    g_return_val_if_fail(data != NULL, FALSE);
+
+    worker = g_private_get(&current_worker);
+    if (worker && worker->pool != pool) {
+        worker = NULL;
+    }
+
+    /* While draining, tasks may still spawn subtasks: they land on the
+     * worker's own deque, which it empties before exiting */
+    gint state = g_atomic_int_get(&pool->state);
+    if (state == SHUTDOWN_IMMEDIATE || (state == SHUTDOWN_DRAIN && worker == NULL)) {
+        g_set_error(error, G_THREAD_ERROR, G_THREAD_ERROR_AGAIN,
+                    "Work-stealing pool is shutting down");
+        return FALSE;
+    }
+
+    g_atomic_int_inc(&pool->unprocessed);
+
+    if (worker) {
+        deque_push(&worker->deque, data);
+    } else {
+        inject_push(pool, data);
+    }
+
+    wake_one(pool);
+    return TRUE;
+}
+
+void ws_pool_free(WsPool *pool, gboolean immediate, gboolean wait_)
+{
+    guint n_workers = pool->n_workers;
+
+    g_atomic_int_set(&pool->state, immediate ? SHUTDOWN_IMMEDIATE : SHUTDOWN_DRAIN);
+
+    g_mutex_lock(&pool->park_lock);
+    g_cond_broadcast(&pool->park_cond);
+    g_mutex_unlock(&pool->park_lock);
+
+    for (guint i = 0; i < n_workers; i++) {
+        if (wait_) {
+            g_thread_join(pool->workers[i].thread);
+        } else {
+            g_thread_unref(pool->workers[i].thread);
+        }
+    }
+
+    /* Without wait_, the last worker to exit frees the pool */
+    pool_unref(pool);
+}
+
+guint ws_pool_get_num_threads(WsPool *pool)
+{
+    return pool->n_workers;
+}
+
+guint ws_pool_unprocessed(WsPool *pool)
+{
+    return (guint)MAX(g_atomic_int_get(&pool->unprocessed), 0);
+}
+
+guint64 ws_pool_get_steals(WsPool *pool)
+{
+    return __atomic_load_n(&pool->steals, __ATOMIC_RELAXED);
+}
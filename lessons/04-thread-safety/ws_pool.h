@@ -0,0 +1,53 @@
+/*
+ * ws_pool.h - Work-stealing thread pool
+ *
+ * A drop-in alternative to GThreadPool for many small tasks. Each worker
+ * owns a Chase-Lev deque: tasks pushed from inside a task go onto the
+ * pushing worker's deque (LIFO, cache-warm), and idle workers steal from
+ * the other end of someone else's. Tasks pushed from outside the pool go
+ * through a lock-free global injection queue. Workers that find nothing
+ * to run park on a condition variable and are woken only when work
+ * arrives, so an idle pool costs no CPU.
+ *
+ * Like GThreadPool, a task is just the data pointer handed to the pool's
+ * GFunc: pushing a task allocates nothing.
+ */
+
+#ifndef WS_POOL_H
+#define WS_POOL_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _WsPool WsPool;
+
+/* @max_threads -1 = one worker per processor. Workers start immediately,
+ * like an exclusive GThreadPool. */
+WsPool *ws_pool_new(GFunc func,
+                    gpointer user_data,
+                    gint max_threads,
+                    GError **error);
+
+/* Queue @data for func(data, user_data). From a worker of this pool it is
+ * pushed onto that worker's own deque; from any other thread onto the
+ * injection queue. Once ws_pool_free() has been called only running tasks
+ * may still push (and only if @immediate was FALSE). */
+gboolean ws_pool_push(WsPool *pool, gpointer data, GError **error);
+
+/* Same semantics as g_thread_pool_free(): with @immediate FALSE all queued
+ * tasks still run; with @wait_ TRUE the call returns only after the
+ * workers have exited, otherwise the last worker frees the pool. */
+void ws_pool_free(WsPool *pool, gboolean immediate, gboolean wait_);
+
+guint ws_pool_get_num_threads(WsPool *pool);
+
+/* Tasks queued but not yet started */
+guint ws_pool_unprocessed(WsPool *pool);
+
+/* Total successful steals, for tuning/benchmarks */
+guint64 ws_pool_get_steals(WsPool *pool);
+
+G_END_DECLS
+
+#endif /* WS_POOL_H */
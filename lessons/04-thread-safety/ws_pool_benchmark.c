@@ -0,0 +1,235 @@
+/*
+ * ws_pool_benchmark.c - Scaling of GAsyncQueue vs GThreadPool vs WsPool
+ *
+ * For 1, 2, 4, ... workers and [max-threads] itself, the main thread
+ * pushes a batch of tasks and waits until every task has run, timed per
+ * task with bench_run_ops() (one iteration is one batch) for:
+ *   - the async_queue.c pattern: consumers popping a shared GAsyncQueue,
+ *     each task a g_new'd struct with a g_strdup'd description
+ *   - GThreadPool (one shared queue inside, but no per-task allocation)
+ *   - WsPool (per-worker deques, lock-free injector)
+ *
+ * Task sizes:
+ *   tiny    ~50 ns of work: queue overhead dominates
+ *   medium  ~20 us of work: should scale with cores for all three
+ *   skewed  tiny tasks, but 1% are 1000x heavier
+ *
+ * Each batch starts and stops its workers, as the pools are sized per
+ * thread count. WsPool's steals per batch are printed after each load.
+ *
+ * Usage: ./ws_pool_benchmark [max-threads] [--bench-...]   (default 64)
+ */
+
+#include "bench.h"
+#include "ws_pool.h"
+
+typedef struct {
+    const gchar *name;
+    guint n_tasks;
+    guint light;                     /* Iterations per ordinary task */
+    guint heavy_every;               /* Every Nth task is heavy; 0 = none */
+    guint heavy;
+} Workload;
+
+static const Workload workloads[] = {
+    { "tiny",    100000,    50, 0,      0 },
+    { "medium",    5000, 20000, 0,      0 },
+    { "skewed",  100000,    50, 100, 50000 },
+};
+
+static volatile guint32 sink;
+
+/* A dependent multiply-add chain: ~1 ns per iteration */
+static void burn(guint iterations)
+{
+    guint32 x = iterations;
+
+    for (guint i = 0; i < iterations; i++) {
+        x = x * 1664525u + 1013904223u;
+    }
+    if (x == 0) {
+        sink = x;
+    }
+}
+
+static guint task_iterations(const Workload *load, guint i)
+{
+    return (load->heavy_every && i % load->heavy_every == 0) ? load->heavy : load->light;
+}
+
+typedef struct {
+    const Workload *load;
+    const guint *items;              /* Iterations per task, for the pools */
+    guint n_threads;
+    guint64 batches;                 /* WsPool only */
+    guint64 steals;
+} Run;
+
+/* ============================================================
+ * Baseline: GAsyncQueue producer/consumer as in async_queue.c
+ * ============================================================ */
+
+typedef struct {
+    guint iterations;
+    gchar *description;
+} BenchTask;
+
+static gpointer consumer_thread(gpointer user_data)
+{
+    GAsyncQueue *queue = (GAsyncQueue *)user_data;
+    BenchTask *task;
+
+    while ((task = g_async_queue_pop(queue)) != GINT_TO_POINTER(1)) {
+        burn(task->iterations);
+        g_free(task->description);
+        g_free(task);
+    }
+    return NULL;
+}
+
+static void run_async_queue(const Workload *load, guint n_threads)
+{
+    GAsyncQueue *queue = g_async_queue_new();
+    GThread **threads = g_new(GThread *, n_threads);
+
+    for (guint t = 0; t < n_threads; t++) {
+        threads[t] = g_thread_new("consumer", consumer_thread, queue);
+    }
+
+    for (guint i = 0; i < load->n_tasks; i++) {
+        BenchTask *task = g_new(BenchTask, 1);
+        task->iterations = task_iterations(load, i);
+        task->description = g_strdup("Bench task");
+        g_async_queue_push(queue, task);
+    }
+
+    /* One sentinel per consumer */
+    for (guint t = 0; t < n_threads; t++) {
+        g_async_queue_push(queue, GINT_TO_POINTER(1));
+    }
+    for (guint t = 0; t < n_threads; t++) {
+        g_thread_join(threads[t]);
+    }
+
+    g_async_queue_unref(queue);
+    g_free(threads);
+}
+
+static void async_queue_bench(guint64 iterations, gpointer user_data)
+{
+    Run *run = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        run_async_queue(run->load, run->n_threads);
+    }
+}
+
+/* ============================================================
+ * GThreadPool and WsPool
+ * ============================================================ */
+
+/* Both pools hand the data pointer straight to the worker, so a task is a
+ * pointer into a preallocated iteration-count array */
+static void pool_func(gpointer data, gpointer user_data)
+{
+    burn(*(guint *)data);
+}
+
+static void thread_pool_bench(guint64 iterations, gpointer user_data)
+{
+    Run *run = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        GThreadPool *pool = g_thread_pool_new(pool_func, NULL, run->n_threads, TRUE, NULL);
+
+        for (guint i = 0; i < run->load->n_tasks; i++) {
+            g_thread_pool_push(pool, (gpointer)&run->items[i], NULL);
+        }
+        g_thread_pool_free(pool, FALSE, TRUE);
+    }
+}
+
+static void ws_pool_bench(guint64 iterations, gpointer user_data)
+{
+    Run *run = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        WsPool *pool = ws_pool_new(pool_func, NULL, run->n_threads, NULL);
+
+        for (guint i = 0; i < run->load->n_tasks; i++) {
+            ws_pool_push(pool, (gpointer)&run->items[i], NULL);
+        }
+        /* Once nothing is queued no more steals can happen */
+        while (ws_pool_unprocessed(pool) > 0) {
+            g_usleep(50);
+        }
+        run->steals += ws_pool_get_steals(pool);
+        run->batches++;
+        ws_pool_free(pool, FALSE, TRUE);
+    }
+}
+
+static void bench_threads(Bench *bench, const gchar *impl, guint n_threads, BenchFunc func, Run *run)
+{
+    gchar *name = g_strdup_printf("%s %s %u", run->load->name, impl, n_threads);
+
+    run->n_threads = n_threads;
+    bench_run_ops(bench, name, run->load->n_tasks, func, run);
+    g_free(name);
+}
+
+/* 1, 2, 4, ... and then @max_threads itself, e.g. 1, 2, 4, 6 */
+static guint next_thread_count(guint n, guint max_threads)
+{
+    if (n == max_threads) {
+        return max_threads + 1;
+    }
+    return MIN(n * 2, max_threads);
+}
+
+int main(int argc, char *argv[])
+{
+    Bench *bench = bench_new("ws_pool_benchmark", &argc, &argv);
+    guint max_threads = (argc > 1) ? (guint)g_ascii_strtoull(argv[1], NULL, 10) : 64;
+
+    max_threads = CLAMP(max_threads, 1, 64);
+
+    g_print("=== Work-Stealing Pool Benchmark ===\n\n");
+    g_print("Time per task (%u processors)\n", g_get_num_processors());
+
+    for (guint w = 0; w < G_N_ELEMENTS(workloads); w++) {
+        const Workload *load = &workloads[w];
+        guint *items = g_new(guint, load->n_tasks);
+
+        for (guint i = 0; i < load->n_tasks; i++) {
+            items[i] = task_iterations(load, i);
+        }
+
+        g_print("\n%s (%u tasks per batch)\n", load->name, load->n_tasks);
+
+        GString *steals = g_string_new("  WsPool steals per batch:");
+
+        for (guint n = 1; n <= max_threads; n = next_thread_count(n, max_threads)) {
+            Run run = { load, items, n, 0, 0 };
+
+            bench_threads(bench, "GAsyncQueue", n, async_queue_bench, &run);
+            bench_threads(bench, "GThreadPool", n, thread_pool_bench, &run);
+            bench_threads(bench, "WsPool", n, ws_pool_bench, &run);
+            g_string_append_printf(steals, "  %u: %.0f", n, (gdouble)run.steals / MAX(run.batches, 1));
+        }
+        g_print("%s\n", steals->str);
+
+        g_string_free(steals, TRUE);
+        g_free(items);
+    }
+
+    g_print("\n=== Key Points ===\n");
+    g_print("- A single GAsyncQueue is one mutex every producer and consumer contends on\n");
+    g_print("- Per-worker deques keep the common path lock-free and cache-local\n");
+    g_print("- Idle workers steal from the far end of a busy worker's deque\n");
+    g_print("- Skewed loads are where stealing pays: heavy tasks don't strand their neighbours\n");
+    g_print("- Parked workers cost no CPU; pushers only signal when someone is idle\n");
+
+    bench_free(bench);
+    return 0;
+}
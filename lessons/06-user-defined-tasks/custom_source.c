@@ -3,46 +3,23 @@
  * 
  * Demonstrates how to create a custom event source that integrates
  * with the GLib main loop. This example creates a counter source that
- * fires after a specified number of iterations.
+ * fires after a specified number of events, and a source that runs on
+ * every iteration until it is done.
+ *
+ * Both are built on SignalledSource (signalled_source.h), whose
+ * prepare and check only load a ready flag: the loop sleeps until a
+ * source is signalled instead of polling each one on every iteration.
  */
 
-#include <glib.h>
+#include "signalled_source.h"
 
-/* Custom source structure */
+/* Custom source structure: a SignalledSource comes first */
 typedef struct {
-    GSource parent;
-    gint counter;
+    SignalledSource parent;
+    gint counter;                    /* Atomic: incremented from any thread */
     gint trigger_value;
 } CounterSource;
 
-/* Prepare function - called before polling
- * Returns TRUE if source is ready to dispatch */
-static gboolean counter_prepare(GSource *source, gint *timeout)
-{
-    CounterSource *counter = (CounterSource *)source;
-    
-    /* No timeout needed - we check immediately */
-    *timeout = -1;
-    
-    /* Ready if counter reached trigger value */
-    return counter->counter >= counter->trigger_value;
-}
-
-/* Check function - called after polling
- * Returns TRUE if source should be dispatched */
-static gboolean counter_check(GSource *source)
-{
-    CounterSource *counter = (CounterSource *)source;
-    
-    /* Increment counter on each check */
-    counter->counter++;
-    
-    g_print("[Counter Source] Check called, counter = %d/%d\n",
-            counter->counter, counter->trigger_value);
-    
-    return counter->counter >= counter->trigger_value;
-}
-
 /* Dispatch function - called when source is ready
  * Invokes the callback */
 static gboolean counter_dispatch(GSource *source,
@@ -51,7 +28,8 @@ static gboolean counter_dispatch(GSource *source,
 {
     CounterSource *counter = (CounterSource *)source;
     
-    g_print("[Counter Source] Dispatched at counter = %d\n", counter->counter);
+    g_print("[Counter Source] Dispatched at counter = %d\n",
+            g_atomic_int_get(&counter->counter));
     
     if (callback) {
         return callback(user_data);
@@ -66,20 +44,16 @@ static void counter_finalize(GSource *source)
     g_print("[Counter Source] Finalized\n");
 }
 
-/* Source function table */
-static GSourceFuncs counter_funcs = {
-    counter_prepare,
-    counter_check,
+/* Source function table: prepare and check come from SignalledSource */
+static const SignalledSourceFuncs counter_funcs = {
     counter_dispatch,
-    counter_finalize,
-    NULL,  /* closure_callback */
-    NULL   /* closure_marshal */
+    counter_finalize
 };
 
 /* Create a new counter source */
 static GSource *counter_source_new(gint trigger_value)
 {
-    GSource *source = g_source_new(&counter_funcs, sizeof(CounterSource));
+    GSource *source = signalled_source_new(&counter_funcs, sizeof(CounterSource));
     CounterSource *counter = (CounterSource *)source;
     
     counter->counter = 0;
@@ -88,6 +62,21 @@ static GSource *counter_source_new(gint trigger_value)
     return source;
 }
 
+/* Count one event; the source becomes ready when the count reaches
+ * the trigger value. Safe from any thread. */
+static void counter_source_increment(GSource *source)
+{
+    CounterSource *counter = (CounterSource *)source;
+    gint value = g_atomic_int_add(&counter->counter, 1) + 1;
+    
+    g_print("[Counter Source] Event counted, counter = %d/%d\n",
+            value, counter->trigger_value);
+    
+    if (value == counter->trigger_value) {
+        signalled_source_signal(source);
+    }
+}
+
 /* Callback for counter source */
 static gboolean counter_callback(gpointer user_data)
 {
@@ -96,63 +85,50 @@ static gboolean counter_callback(gpointer user_data)
     return FALSE;  /* Remove source */
 }
 
-/* Simple custom source that's always ready */
+/* Simple custom source that's ready on every iteration until done */
 typedef struct {
-    GSource parent;
+    SignalledSource parent;
     gint call_count;
     gint max_calls;
 } SimpleSource;
 
-static gboolean simple_prepare(GSource *source, gint *timeout)
-{
-    *timeout = 0;  /* Don't wait */
-    return TRUE;   /* Always ready */
-}
-
-static gboolean simple_check(GSource *source)
-{
-    return TRUE;  /* Always ready */
-}
-
 static gboolean simple_dispatch(GSource *source,
                                 GSourceFunc callback,
                                 gpointer user_data)
 {
     SimpleSource *simple = (SimpleSource *)source;
+    gboolean continue_source = simple->call_count + 1 < simple->max_calls;
+    
     simple->call_count++;
     
     g_print("[Simple Source] Dispatch #%d\n", simple->call_count);
     
-    if (callback) {
-        gboolean continue_source = callback(user_data);
-        
-        /* Stop after max calls */
-        if (simple->call_count >= simple->max_calls) {
-            return FALSE;
-        }
-        
-        return continue_source;
+    if (callback && !callback(user_data)) {
+        continue_source = FALSE;
+    }
+    
+    /* Ready again next iteration; we are on the loop's own thread, so
+     * no wakeup is needed */
+    if (continue_source) {
+        signalled_source_mark_ready(source);
     }
     
-    return simple->call_count < simple->max_calls;
+    return continue_source;
 }
 
-static GSourceFuncs simple_funcs = {
-    simple_prepare,
-    simple_check,
+static const SignalledSourceFuncs simple_funcs = {
     simple_dispatch,
-    NULL,  /* finalize */
-    NULL,  /* closure_callback */
-    NULL   /* closure_marshal */
+    NULL   /* finalize */
 };
 
 static GSource *simple_source_new(gint max_calls)
 {
-    GSource *source = g_source_new(&simple_funcs, sizeof(SimpleSource));
+    GSource *source = signalled_source_new(&simple_funcs, sizeof(SimpleSource));
     SimpleSource *simple = (SimpleSource *)source;
     
     simple->call_count = 0;
     simple->max_calls = max_calls;
+    signalled_source_mark_ready(source);   /* Not attached yet: no wakeup */
     
     return source;
 }
@@ -167,13 +143,32 @@ static gboolean simple_callback(gpointer user_data)
     return (call_num < 5);  /* Continue for 5 calls */
 }
 
+/* Counts an event on each counter source every 100 ms, from another
+ * thread, as a worker reporting progress would */
+static gpointer event_thread(gpointer data)
+{
+    GSource **counters = data;
+    
+    for (gint i = 0; i < 10; i++) {
+        g_usleep(100 * G_TIME_SPAN_MILLISECOND);
+        for (gint c = 0; counters[c]; c++) {
+            counter_source_increment(counters[c]);
+        }
+    }
+    
+    for (gint c = 0; counters[c]; c++) {
+        g_source_unref(counters[c]);
+    }
+    return NULL;
+}
+
 int main(void)
 {
     g_print("=== Custom GSource Example ===\n\n");
     
     GMainLoop *loop = g_main_loop_new(NULL, FALSE);
     
-    /* Example 1: Counter source that triggers after N iterations */
+    /* Example 1: Counter source that triggers after N events */
     g_print("1. Creating counter source (triggers at 5):\n");
     GSource *counter1 = counter_source_new(5);
     g_source_set_callback(counter1, counter_callback, GINT_TO_POINTER(1), NULL);
@@ -195,19 +190,25 @@ int main(void)
     g_source_attach(simple, NULL);
     g_source_unref(simple);
     
+    /* Events arrive from another thread, which keeps its own refs */
+    GSource *counters[] = { g_source_ref(counter1), g_source_ref(counter2), NULL };
+    GThread *events = g_thread_new("events", event_thread, counters);
+    
     /* Add a timeout to stop the loop */
     g_timeout_add(2000, (GSourceFunc)g_main_loop_quit, loop);
     
     g_print("3. Running main loop...\n\n");
     g_main_loop_run(loop);
+    g_thread_join(events);
     
     g_print("\n=== Key Points ===\n");
     g_print("- Custom sources integrate with main loop\n");
-    g_print("- Implement prepare, check, dispatch functions\n");
-    g_print("- prepare() returns TRUE if ready to dispatch immediately\n");
-    g_print("- check() returns TRUE if ready after polling\n");
-    g_print("- dispatch() calls the callback function\n");
+    g_print("- SignalledSource supplies prepare() and check(): a ready flag, nothing more\n");
+    g_print("- signalled_source_signal() sets the flag and wakes the loop, from any thread\n");
+    g_print("- signalled_source_mark_ready() sets it from the loop's own thread\n");
+    g_print("- dispatch() runs only once signalled, then calls the callback function\n");
     g_print("- finalize() cleans up when source is destroyed\n");
+    g_print("- The loop sleeps until a source is signalled instead of polling for work\n");
     
     g_main_loop_unref(loop);
     
@@ -0,0 +1,366 @@
+/*
+ * executor.c - Named thread pools for GTask, with latency histograms
+ *
+ * See executor.h for the API. An executor is a mutex, a condition
+ * variable and three GQueues. A queued job embeds its own GList link,
+ * so queueing allocates only the job itself. Pushers signal the cond
+ * when a worker is idle. Otherwise a growable executor starts another
+ * thread, and a fixed one leaves the job for the next free worker.
+ *
+ * Growable executors' threads retire after IDLE_TIMEOUT_US without
+ * work, down to one. Threads are not joined individually: the last one
+ * to exit says so on the cond, which is what executor_free() waits for.
+ */
+
+#include "executor.h"
+
+#include <errno.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define N_LANES 3
+#define IDLE_TIMEOUT_US (10 * G_TIME_SPAN_SECOND)
+#define IO_MAX_THREADS 64
+
+typedef struct {
+    GList link;                      /* link.data points back at the job */
+    GTask *task;
+    GTaskThreadFunc func;
+    gint64 queued_at;
+} Job;
+
+struct _Executor {
+    gchar *name;
+    guint max_threads;
+    gboolean growable;
+    gint nice;
+
+    GMutex lock;
+    GCond cond;
+    GQueue lanes[N_LANES];
+    guint n_threads;
+    guint n_idle;
+    gboolean shutdown;
+
+    guint64 completed;
+    guint64 wait_us[EXECUTOR_HISTOGRAM_BUCKETS];
+    guint64 run_us[EXECUTOR_HISTOGRAM_BUCKETS];
+};
+
+G_LOCK_DEFINE_STATIC(registry);
+static GHashTable *registry = NULL;
+
+static guint lane_for_priority(gint priority)
+{
+    if (priority < G_PRIORITY_DEFAULT) {
+        return 0;
+    }
+    return (priority <= G_PRIORITY_HIGH_IDLE) ? 1 : 2;
+}
+
+static guint histogram_bucket(gint64 us)
+{
+    if (us <= 0) {
+        return 0;
+    }
+    return MIN(64 - __builtin_clzll((guint64)us), EXECUTOR_HISTOGRAM_BUCKETS - 1);
+}
+
+static void record(guint64 *histogram, gint64 us)
+{
+    __atomic_fetch_add(&histogram[histogram_bucket(us)], 1, __ATOMIC_RELAXED);
+}
+
+/* ============================================================
+ * Workers
+ * ============================================================ */
+
+static Job *pop_job(Executor *ex)
+{
+    for (guint i = 0; i < N_LANES; i++) {
+        GList *link = g_queue_pop_head_link(&ex->lanes[i]);
+
+        if (link) {
+            return link->data;
+        }
+    }
+    return NULL;
+}
+
+/* Called with the lock held */
+static guint queued_jobs(Executor *ex)
+{
+    guint queued = 0;
+
+    for (guint i = 0; i < N_LANES; i++) {
+        queued += ex->lanes[i].length;
+    }
+    return queued;
+}
+
+static void run_job(Executor *ex, Job *job)
+{
+    gint64 start = g_get_monotonic_time();
+
+    record(ex->wait_us, start - job->queued_at);
+    job->func(job->task,
+              g_task_get_source_object(job->task),
+              g_task_get_task_data(job->task),
+              g_task_get_cancellable(job->task));
+    record(ex->run_us, g_get_monotonic_time() - start);
+    __atomic_fetch_add(&ex->completed, 1, __ATOMIC_RELAXED);
+
+    g_object_unref(job->task);
+    g_free(job);
+}
+
+static gpointer executor_worker(gpointer data)
+{
+    Executor *ex = data;
+
+    if (ex->nice != 0 && setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), ex->nice) != 0) {
+        g_warning("executor %s: setpriority(%d) failed: %s",
+                  ex->name, ex->nice, g_strerror(errno));
+    }
+
+    g_mutex_lock(&ex->lock);
+    for (;;) {
+        Job *job = pop_job(ex);
+
+        if (job) {
+            g_mutex_unlock(&ex->lock);
+            run_job(ex, job);
+            g_mutex_lock(&ex->lock);
+            continue;
+        }
+        if (ex->shutdown) {
+            break;
+        }
+
+        ex->n_idle++;
+        if (ex->growable && ex->n_threads > 1) {
+            gint64 deadline = g_get_monotonic_time() + IDLE_TIMEOUT_US;
+            gboolean signalled = g_cond_wait_until(&ex->cond, &ex->lock, deadline);
+
+            ex->n_idle--;
+            if (!signalled && ex->n_threads > 1 && queued_jobs(ex) == 0) {
+                break;      /* Retire */
+            }
+        } else {
+            g_cond_wait(&ex->cond, &ex->lock);
+            ex->n_idle--;
+        }
+    }
+
+    if (--ex->n_threads == 0) {
+        g_cond_broadcast(&ex->cond);
+    }
+    g_mutex_unlock(&ex->lock);
+    return NULL;
+}
+
+/* Called with the lock held */
+static gboolean spawn_worker(Executor *ex, GError **error)
+{
+    gchar *name = g_strdup_printf("%s-%u", ex->name, ex->n_threads);
+    GThread *thread = g_thread_try_new(name, executor_worker, ex, error);
+
+    g_free(name);
+    if (thread == NULL) {
+        return FALSE;
+    }
+    ex->n_threads++;
+    g_thread_unref(thread);
+    return TRUE;
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+Executor *executor_new(const gchar *name,
+                       guint max_threads,
+                       gboolean growable,
+                       gint nice,
+                       GError **error)
+{
+    Executor *ex;
+
+    g_return_val_if_fail(name != NULL, NULL);
+
+    ex = g_new0(Executor, 1);
+    ex->name = g_strdup(name);
+    ex->max_threads = max_threads ? max_threads : g_get_num_processors();
+    ex->growable = growable;
+    ex->nice = nice;
+    g_mutex_init(&ex->lock);
+    g_cond_init(&ex->cond);
+    for (guint i = 0; i < N_LANES; i++) {
+        g_queue_init(&ex->lanes[i]);
+    }
+
+    G_LOCK(registry);
+    if (registry == NULL) {
+        registry = g_hash_table_new(g_str_hash, g_str_equal);
+    }
+    if (g_hash_table_contains(registry, name)) {
+        G_UNLOCK(registry);
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_EXISTS,
+                    "An executor named '%s' already exists", name);
+        executor_free(ex);
+        return NULL;
+    }
+    g_hash_table_insert(registry, ex->name, ex);
+    G_UNLOCK(registry);
+
+    g_mutex_lock(&ex->lock);
+    guint initial = growable ? 1 : ex->max_threads;
+
+    while (ex->n_threads < initial) {
+        if (!spawn_worker(ex, error)) {
+            g_mutex_unlock(&ex->lock);
+            executor_free(ex);
+            return NULL;
+        }
+    }
+    g_mutex_unlock(&ex->lock);
+
+    return ex;
+}
+
+void executor_free(Executor *executor)
+{
+    g_return_if_fail(executor != NULL);
+
+    G_LOCK(registry);
+    if (registry && g_hash_table_lookup(registry, executor->name) == executor) {
+        g_hash_table_remove(registry, executor->name);
+    }
+    G_UNLOCK(registry);
+
+    /* Workers drain every lane before they see shutdown */
+    g_mutex_lock(&executor->lock);
+    executor->shutdown = TRUE;
+    g_cond_broadcast(&executor->cond);
+    while (executor->n_threads > 0) {
+        g_cond_wait(&executor->cond, &executor->lock);
+    }
+    g_mutex_unlock(&executor->lock);
+
+    g_mutex_clear(&executor->lock);
+    g_cond_clear(&executor->cond);
+    g_free(executor->name);
+    g_free(executor);
+}
+
+Executor *executor_get_cpu(void)
+{
+    static gsize once = 0;
+    static Executor *cpu = NULL;
+
+    if (g_once_init_enter(&once)) {
+        /* Fails only if the name is taken: share the registered one */
+        cpu = executor_new("cpu", 0, FALSE, 0, NULL);
+        if (cpu == NULL) {
+            cpu = executor_lookup("cpu");
+        }
+        g_once_init_leave(&once, 1);
+    }
+    return cpu;
+}
+
+Executor *executor_get_io(void)
+{
+    static gsize once = 0;
+    static Executor *io = NULL;
+
+    if (g_once_init_enter(&once)) {
+        io = executor_new("io", IO_MAX_THREADS, TRUE, 0, NULL);
+        if (io == NULL) {
+            io = executor_lookup("io");
+        }
+        g_once_init_leave(&once, 1);
+    }
+    return io;
+}
+
+Executor *executor_lookup(const gchar *name)
+{
+    Executor *ex;
+
+    G_LOCK(registry);
+    ex = registry ? g_hash_table_lookup(registry, name) : NULL;
+    G_UNLOCK(registry);
+    return ex;
+}
+
+const gchar *executor_get_name(Executor *executor)
+{
+    return executor->name;
+}
+
+void executor_run_task(Executor *executor, GTask *task, GTaskThreadFunc func)
+{
+    Job *job;
+
+    g_return_if_fail(executor != NULL);
+    g_return_if_fail(G_IS_TASK(task));
+    g_return_if_fail(func != NULL);
+
+    job = g_new(Job, 1);
+    job->link.data = job;
+    job->link.prev = job->link.next = NULL;
+    job->task = g_object_ref(task);
+    job->func = func;
+    job->queued_at = g_get_monotonic_time();
+
+    g_mutex_lock(&executor->lock);
+    g_queue_push_tail_link(&executor->lanes[lane_for_priority(g_task_get_priority(task))],
+                           &job->link);
+    if (executor->n_idle > 0) {
+        g_cond_signal(&executor->cond);
+    }
+    /* A signalled worker counts as idle until it wakes and pops, so in a
+     * burst compare the backlog with the idle count, not the count with 0 */
+    if (executor->growable && executor->n_threads < executor->max_threads &&
+        queued_jobs(executor) > executor->n_idle) {
+        /* On failure the job still runs once a thread frees up */
+        spawn_worker(executor, NULL);
+    }
+    g_mutex_unlock(&executor->lock);
+}
+
+void executor_get_stats(Executor *executor, ExecutorStats *stats)
+{
+    g_mutex_lock(&executor->lock);
+    stats->n_threads = executor->n_threads;
+    stats->queued = queued_jobs(executor);
+    g_mutex_unlock(&executor->lock);
+
+    stats->completed = __atomic_load_n(&executor->completed, __ATOMIC_RELAXED);
+    for (guint b = 0; b < EXECUTOR_HISTOGRAM_BUCKETS; b++) {
+        stats->wait_us[b] = __atomic_load_n(&executor->wait_us[b], __ATOMIC_RELAXED);
+        stats->run_us[b] = __atomic_load_n(&executor->run_us[b], __ATOMIC_RELAXED);
+    }
+}
+
+gint64 executor_histogram_quantile(const guint64 *histogram, gdouble fraction)
+{
+    guint64 total = 0, seen = 0;
+
+    for (guint b = 0; b < EXECUTOR_HISTOGRAM_BUCKETS; b++) {
+        total += histogram[b];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    for (guint b = 0; b < EXECUTOR_HISTOGRAM_BUCKETS; b++) {
+        seen += histogram[b];
+        if (seen >= fraction * total) {
+            return (gint64)1 << b;          /* Bucket b ends at 2^b us */
+        }
+    }
+    return (gint64)1 << (EXECUTOR_HISTOGRAM_BUCKETS - 1);
+}
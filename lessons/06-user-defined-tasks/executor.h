@@ -0,0 +1,80 @@
+/*
+ * executor.h - Named thread pools for GTask, with latency histograms
+ *
+ * g_task_run_in_thread() sends every task to one GIO-wide pool. It is
+ * FIFO and it grows slowly once saturated, so a burst of slow blocking
+ * work (file I/O, DNS) queues ahead of short latency-critical tasks. An
+ * Executor is a pool of its own:
+ *
+ *   - fixed (threads started up front, e.g. one per core for CPU work)
+ *     or growable (a thread is added whenever a task arrives and none is
+ *     idle, up to max_threads, and idle ones retire; for blocking I/O)
+ *   - three FIFO lanes picked by g_task_get_priority(): below
+ *     G_PRIORITY_DEFAULT, up to G_PRIORITY_HIGH_IDLE, and the rest.
+ *     Workers always take from the most urgent non-empty lane
+ *   - an optional nice value applied to the pool's threads
+ *   - log2 histograms of queue wait and run time, per executor
+ *
+ * executor_run_task() is the g_task_run_in_thread() of a *_async()
+ * function: the task function, its arguments and the way results get
+ * back to the caller are unchanged. g_task_set_return_on_cancel() is
+ * not supported.
+ */
+
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define EXECUTOR_HISTOGRAM_BUCKETS 32
+
+typedef struct _Executor Executor;
+
+typedef struct {
+    guint n_threads;           /* Currently alive */
+    guint queued;              /* Waiting for a thread */
+    guint64 completed;
+    /* Bucket 0 is < 1 us; bucket b >= 1 counts [2^(b-1), 2^b) us */
+    guint64 wait_us[EXECUTOR_HISTOGRAM_BUCKETS];
+    guint64 run_us[EXECUTOR_HISTOGRAM_BUCKETS];
+} ExecutorStats;
+
+/* @max_threads 0 = one per processor. A fixed executor starts all its
+ * threads now; a @growable one starts them as work arrives. @nice is
+ * passed to setpriority() for each thread; 0 leaves them alone.
+ * @name must be unique: the executor is registered under it. */
+Executor *executor_new(const gchar *name,
+                       guint max_threads,
+                       gboolean growable,
+                       gint nice,
+                       GError **error);
+
+/* Waits for queued and running tasks to finish */
+void executor_free(Executor *executor);
+
+/* Shared defaults, created on first use: "cpu" is fixed at one thread
+ * per processor, "io" grows to 64 threads. If an executor of that name
+ * was registered first, that one is returned instead. */
+Executor *executor_get_cpu(void);
+Executor *executor_get_io(void);
+
+/* An executor by name, or NULL */
+Executor *executor_lookup(const gchar *name);
+
+const gchar *executor_get_name(Executor *executor);
+
+/* Like g_task_run_in_thread(task, func), on @executor. Takes a
+ * reference on @task until @func returns. */
+void executor_run_task(Executor *executor, GTask *task, GTaskThreadFunc func);
+
+void executor_get_stats(Executor *executor, ExecutorStats *stats);
+
+/* Upper bound, in us, of the bucket holding the @fraction quantile of
+ * @histogram (e.g. 0.99), or 0 if it is empty */
+gint64 executor_histogram_quantile(const guint64 *histogram, gdouble fraction);
+
+G_END_DECLS
+
+#endif /* EXECUTOR_H */
@@ -0,0 +1,119 @@
+/*
+ * signalled_source.c - A GSource base that costs nothing until signalled
+ *
+ * See signalled_source.h for the API. The two paths to a dispatch are
+ * independent: the ready flag, seen by prepare/check after a wakeup,
+ * and the ready time, which GLib handles itself. Each has its own
+ * "already pending" flag, and dispatch clears both before calling out.
+ */
+
+#include "signalled_source.h"
+
+static gboolean signalled_prepare(GSource *source, gint *timeout)
+{
+    *timeout = -1;
+    return g_atomic_int_get(&((SignalledSource *)source)->ready);
+}
+
+static gboolean signalled_check(GSource *source)
+{
+    return g_atomic_int_get(&((SignalledSource *)source)->ready);
+}
+
+static gboolean signalled_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+    SignalledSource *self = (SignalledSource *)source;
+
+    /* Clear before calling out: a signal from now on dispatches again.
+     * The ready time is reset whatever armed says, as a signaller that
+     * won the CAS may set it just after a dispatch via the ready flag
+     * cleared armed; left alone, that deadline would dispatch every
+     * iteration. Reset before disarming, so a signal in between is
+     * folded into this dispatch rather than armed with no deadline. */
+    if (g_source_get_ready_time(source) != -1) {
+        g_source_set_ready_time(source, -1);
+    }
+    g_atomic_int_set(&self->armed, 0);
+    g_atomic_int_set(&self->ready, 0);
+
+    if (self->funcs && self->funcs->dispatch) {
+        return self->funcs->dispatch(source, callback, user_data);
+    }
+    if (callback) {
+        return callback(user_data);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static void signalled_finalize(GSource *source)
+{
+    SignalledSource *self = (SignalledSource *)source;
+
+    if (self->funcs && self->funcs->finalize) {
+        self->funcs->finalize(source);
+    }
+}
+
+static GSourceFuncs signalled_funcs = {
+    signalled_prepare,
+    signalled_check,
+    signalled_dispatch,
+    signalled_finalize,
+    NULL,  /* closure_callback */
+    NULL   /* closure_marshal */
+};
+
+GSource *signalled_source_new(const SignalledSourceFuncs *funcs, guint struct_size)
+{
+    GSource *source;
+
+    g_return_val_if_fail(struct_size >= sizeof(SignalledSource), NULL);
+
+    source = g_source_new(&signalled_funcs, struct_size);
+    ((SignalledSource *)source)->funcs = funcs;
+    g_source_set_name(source, "SignalledSource");
+    return source;
+}
+
+void signalled_source_set_coalesce(GSource *source, guint window_us)
+{
+    g_return_if_fail(source != NULL);
+
+    ((SignalledSource *)source)->coalesce_us = window_us;
+}
+
+void signalled_source_signal(GSource *source)
+{
+    SignalledSource *self = (SignalledSource *)source;
+    GMainContext *context;
+
+    g_return_if_fail(source != NULL);
+
+    if (g_source_is_destroyed(source)) {
+        return;
+    }
+
+    if (self->coalesce_us > 0) {
+        /* Thread-safe, and wakes the context itself */
+        if (g_atomic_int_get(&self->armed) == 0 &&
+            g_atomic_int_compare_and_exchange(&self->armed, 0, 1)) {
+            g_source_set_ready_time(source, g_get_monotonic_time() + self->coalesce_us);
+        }
+        return;
+    }
+
+    if (g_atomic_int_get(&self->ready) == 0 &&
+        g_atomic_int_compare_and_exchange(&self->ready, 0, 1)) {
+        context = g_source_get_context(source);
+        if (context) {
+            g_main_context_wakeup(context);
+        }
+    }
+}
+
+void signalled_source_mark_ready(GSource *source)
+{
+    g_return_if_fail(source != NULL);
+
+    g_atomic_int_set(&((SignalledSource *)source)->ready, 1);
+}
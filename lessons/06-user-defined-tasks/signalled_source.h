@@ -0,0 +1,66 @@
+/*
+ * signalled_source.h - A GSource base that costs nothing until signalled
+ *
+ * counter_prepare()/counter_check() in the original custom_source.c did
+ * their work on every loop iteration, and simple_prepare() returned TRUE
+ * unconditionally, so the loop never slept. A SignalledSource is only
+ * ready when something says so:
+ *
+ *   - prepare and check are one atomic load of a ready flag; the source
+ *     adds no timeout and no file descriptor, so an idle context sleeps
+ *     in poll indefinitely
+ *   - signalled_source_signal() may be called from any thread: it sets
+ *     the flag and wakes the context with g_main_context_wakeup(), and
+ *     any further signals before the dispatch are a single atomic
+ *     load each
+ *   - with a coalescing window, the first signal instead sets the ready
+ *     time to the end of the window, with g_source_set_ready_time();
+ *     everything signalled within the window is one dispatch
+ *   - signalled_source_mark_ready() is for the thread iterating the
+ *     context, which needs no wakeup: one store
+ *
+ * The flag is cleared just before dispatch, so a signal racing with the
+ * dispatch is never lost: it causes one more.
+ *
+ * Subtypes put a SignalledSource first in their struct, like GSource
+ * itself, and pass their dispatch and finalize in SignalledSourceFuncs.
+ */
+
+#ifndef SIGNALLED_SOURCE_H
+#define SIGNALLED_SOURCE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct {
+    /* NULL calls the callback, if any, and keeps the source */
+    gboolean (*dispatch)(GSource *source, GSourceFunc callback, gpointer user_data);
+    void (*finalize)(GSource *source);
+} SignalledSourceFuncs;
+
+typedef struct {
+    GSource parent;
+    gint ready;                      /* Atomic */
+    gint armed;                      /* Atomic: ready time set for the window */
+    gint64 coalesce_us;
+    const SignalledSourceFuncs *funcs;
+} SignalledSource;
+
+/* Like g_source_new(): @struct_size includes the SignalledSource.
+ * @funcs (may be NULL) must outlive the source. */
+GSource *signalled_source_new(const SignalledSourceFuncs *funcs, guint struct_size);
+
+/* Dispatch at most once per @window_us after the first signal; 0 (the
+ * default) dispatches on the next iteration. Set before signalling. */
+void signalled_source_set_coalesce(GSource *source, guint window_us);
+
+/* Thread-safe. The source must be attached; it may be destroyed. */
+void signalled_source_signal(GSource *source);
+
+/* Only from the thread iterating the source's context */
+void signalled_source_mark_ready(GSource *source);
+
+G_END_DECLS
+
+#endif /* SIGNALLED_SOURCE_H */
@@ -0,0 +1,202 @@
+/*
+ * signalled_source_benchmark.c - Idle CPU and wakeup latency of custom sources
+ *
+ * A thread iterates a private context holding N sources, each waiting
+ * for an event flag set by another thread. Three ways to notice it:
+ *
+ *   - spin: prepare() returns the flag with a 0 timeout, as
+ *     simple_prepare() did; the loop never sleeps
+ *   - poll 1 ms: prepare() returns the flag with a 1 ms timeout, the
+ *     usual fix; the loop wakes 1000 times a second to look
+ *   - signalled: a SignalledSource; the signalling thread wakes the loop
+ *
+ * For each, with the loop idle for IDLE_MS, the CPU time the process
+ * used; then, as a bench.h case, the round trip from setting a flag to
+ * seeing it dispatched. Rounds follow each other directly, so the loop
+ * has usually just gone back to poll() when the next flag is set.
+ *
+ * Usage: ./signalled_source_benchmark [--bench-...]
+ */
+
+#include "bench.h"
+#include "signalled_source.h"
+
+#include <time.h>
+
+#define IDLE_MS 500
+
+typedef enum {
+    MODE_SPIN,
+    MODE_POLL,
+    MODE_SIGNALLED
+} Mode;
+
+static const gchar *mode_names[] = { "spin", "poll 1 ms", "signalled" };
+
+typedef struct _Run Run;
+
+typedef struct {
+    SignalledSource parent;          /* Only a GSource in the polling modes */
+    gint flag;                       /* Atomic */
+    Run *run;
+} EventSource;
+
+struct _Run {
+    Mode mode;
+    GMainContext *context;
+    gint quit;                       /* Atomic */
+    gint dispatched;                 /* Atomic */
+    EventSource **sources;
+    guint n_sources;
+};
+
+static gboolean poll_prepare(GSource *source, gint *timeout)
+{
+    EventSource *event = (EventSource *)source;
+
+    *timeout = (event->run->mode == MODE_SPIN) ? 0 : 1;
+    return g_atomic_int_get(&event->flag);
+}
+
+static gboolean poll_check(GSource *source)
+{
+    return g_atomic_int_get(&((EventSource *)source)->flag);
+}
+
+static void record_dispatch(EventSource *event)
+{
+    g_atomic_int_set(&event->flag, 0);
+    g_atomic_int_set(&event->run->dispatched, 1);
+}
+
+static gboolean poll_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+    record_dispatch((EventSource *)source);
+    return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs poll_funcs = {
+    poll_prepare,
+    poll_check,
+    poll_dispatch,
+    NULL,  /* finalize */
+    NULL,  /* closure_callback */
+    NULL   /* closure_marshal */
+};
+
+static gboolean signalled_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+    record_dispatch((EventSource *)source);
+    return G_SOURCE_CONTINUE;
+}
+
+static const SignalledSourceFuncs event_funcs = {
+    signalled_dispatch,
+    NULL   /* finalize */
+};
+
+static gpointer loop_thread(gpointer data)
+{
+    Run *run = data;
+
+    g_main_context_push_thread_default(run->context);
+    while (!g_atomic_int_get(&run->quit)) {
+        g_main_context_iteration(run->context, TRUE);
+    }
+    g_main_context_pop_thread_default(run->context);
+    return NULL;
+}
+
+static gdouble cpu_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* One flag set per iteration, each waited for until dispatched */
+static void round_trip_bench(guint64 iterations, gpointer user_data)
+{
+    Run *run = user_data;
+
+    for (guint64 i = 0; i < iterations; i++) {
+        EventSource *event = run->sources[i % run->n_sources];
+
+        g_atomic_int_set(&run->dispatched, 0);
+        g_atomic_int_set(&event->flag, 1);
+        if (run->mode == MODE_SIGNALLED) {
+            signalled_source_signal((GSource *)event);
+        }
+        while (!g_atomic_int_get(&run->dispatched)) {
+            g_thread_yield();
+        }
+    }
+}
+
+static void run_mode(Bench *bench, Mode mode, guint n_sources)
+{
+    Run run = { .mode = mode, .context = g_main_context_new(), .n_sources = n_sources };
+    GThread *thread;
+    gchar *name;
+    gdouble cpu;
+
+    run.sources = g_new(EventSource *, n_sources);
+    for (guint i = 0; i < n_sources; i++) {
+        GSource *source = (mode == MODE_SIGNALLED)
+            ? signalled_source_new(&event_funcs, sizeof(EventSource))
+            : g_source_new(&poll_funcs, sizeof(EventSource));
+
+        run.sources[i] = (EventSource *)source;
+        run.sources[i]->run = &run;
+        g_source_attach(source, run.context);
+    }
+    thread = g_thread_new("loop", loop_thread, &run);
+
+    /* Idle: nobody signals anything */
+    g_usleep(50 * G_TIME_SPAN_MILLISECOND);
+    cpu = cpu_seconds();
+    g_usleep(IDLE_MS * G_TIME_SPAN_MILLISECOND);
+    cpu = cpu_seconds() - cpu;
+    g_print("  %-10s %8u %10.1f%%\n", mode_names[mode], n_sources, cpu * 1000 / IDLE_MS * 100);
+
+    name = g_strdup_printf("%s %u", mode_names[mode], n_sources);
+    bench_run(bench, name, round_trip_bench, &run);
+    g_free(name);
+
+    g_atomic_int_set(&run.quit, 1);
+    g_main_context_wakeup(run.context);
+    g_thread_join(thread);
+
+    for (guint i = 0; i < n_sources; i++) {
+        g_source_destroy((GSource *)run.sources[i]);
+        g_source_unref((GSource *)run.sources[i]);
+    }
+    g_main_context_unref(run.context);
+    g_free(run.sources);
+}
+
+int main(int argc, char *argv[])
+{
+    static const guint counts[] = { 1, 64, 1024 };
+    Bench *bench = bench_new("signalled_source_benchmark", &argc, &argv);
+
+    g_print("=== Signalled Source Benchmark ===\n\n");
+    g_print("Idle CPU over %d ms, then the time from signal to dispatch\n", IDLE_MS);
+    g_print("  %-10s %8s %11s\n", "mode", "sources", "idle CPU");
+
+    for (guint c = 0; c < G_N_ELEMENTS(counts); c++) {
+        for (Mode mode = MODE_SPIN; mode <= MODE_SIGNALLED; mode++) {
+            run_mode(bench, mode, counts[c]);
+        }
+    }
+
+    g_print("\n=== Key Points ===\n");
+    g_print("- A source that is always ready keeps a whole core busy doing nothing\n");
+    g_print("- A polling timeout trades idle CPU against latency; both grow with sources\n");
+    g_print("- A signalled source costs nothing idle and wakes up as fast as poll returns\n");
+    g_print("- prepare/check run for every source on every iteration: keep them to a load\n");
+
+    bench_free(bench);
+    return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * deadline.c - Deadlines for GTasks, backed by a timer wheel
+ *
+ * See deadline.h for the API. An armed deadline holds a reference to
+ * itself and one to its wheel; both are dropped when it expires or when
+ * its last hold is released, whichever comes first. Holds are only
+ * touched from the wheel's thread, like the wheel itself, so releasing
+ * one can cancel the timer directly. References are atomic and may be
+ * dropped anywhere, which is what lets a GTask finalized on a worker
+ * thread carry one.
+ */
+
+#include "deadline.h"
+
+G_DEFINE_QUARK(deadline-task, deadline_task)
+
+/* Drops what an armed deadline holds */
+static void disarmed(Deadline *deadline)
+{
+    g_source_unref((GSource *)deadline->wheel);
+    deadline->wheel = NULL;
+    deadline_unref(deadline);
+}
+
+static void on_expired(TimerWheel *wheel, TimerWheelTimer *timer, gpointer user_data)
+{
+    Deadline *deadline = user_data;
+
+    __atomic_store_n(&deadline->expired, TRUE, __ATOMIC_RELAXED);
+    if (deadline->cancellable) {
+        g_cancellable_cancel(deadline->cancellable);
+    }
+    disarmed(deadline);
+}
+
+Deadline *deadline_new(TimerWheel *wheel, guint timeout_ms, GCancellable *cancellable)
+{
+    Deadline *deadline;
+
+    g_return_val_if_fail(wheel != NULL, NULL);
+
+    deadline = g_new0(Deadline, 1);
+    deadline->ref_count = 2;         /* The caller's and the timer's */
+    deadline->holds = 1;
+    deadline->expires_us = g_get_monotonic_time() + (gint64)timeout_ms * 1000;
+    deadline->wheel = (TimerWheel *)g_source_ref((GSource *)wheel);
+    deadline->cancellable = cancellable ? g_object_ref(cancellable) : NULL;
+
+    timer_wheel_timer_init(&deadline->timer, on_expired, deadline);
+    timer_wheel_add(wheel, &deadline->timer, timeout_ms);
+
+    return deadline;
+}
+
+Deadline *deadline_new_child(Deadline *parent, guint timeout_ms)
+{
+    g_return_val_if_fail(parent != NULL, NULL);
+    g_return_val_if_fail(parent->holds > 0, NULL);
+
+    /* An expired parent has no wheel left, and needs none */
+    if (deadline_check(parent) ||
+        parent->expires_us <= g_get_monotonic_time() + (gint64)timeout_ms * 1000) {
+        parent->holds++;
+        return deadline_ref(parent);
+    }
+    return deadline_new(parent->wheel, timeout_ms, NULL);
+}
+
+void deadline_release(Deadline *deadline)
+{
+    g_return_if_fail(deadline != NULL);
+    g_return_if_fail(deadline->holds > 0);
+
+    if (--deadline->holds == 0 && deadline->wheel &&
+        timer_wheel_cancel(deadline->wheel, &deadline->timer)) {
+        disarmed(deadline);
+    }
+    deadline_unref(deadline);
+}
+
+Deadline *deadline_ref(Deadline *deadline)
+{
+    g_return_val_if_fail(deadline != NULL, NULL);
+
+    g_atomic_int_inc(&deadline->ref_count);
+    return deadline;
+}
+
+void deadline_unref(Deadline *deadline)
+{
+    g_return_if_fail(deadline != NULL);
+
+    if (g_atomic_int_dec_and_test(&deadline->ref_count)) {
+        g_clear_object(&deadline->cancellable);
+        g_free(deadline);
+    }
+}
+
+gint64 deadline_get_remaining_us(const Deadline *deadline)
+{
+    if (deadline == NULL) {
+        return G_MAXINT64;
+    }
+    if (deadline_check(deadline)) {
+        return 0;
+    }
+    return MAX(deadline->expires_us - g_get_monotonic_time(), 0);
+}
+
+void deadline_attach(GTask *task, Deadline *deadline)
+{
+    g_return_if_fail(G_IS_TASK(task));
+
+    g_object_set_qdata_full(G_OBJECT(task), deadline_task_quark(),
+                            deadline ? deadline_ref(deadline) : NULL,
+                            (GDestroyNotify)deadline_unref);
+}
+
+Deadline *deadline_from_task(GTask *task)
+{
+    g_return_val_if_fail(G_IS_TASK(task), NULL);
+
+    return g_object_get_qdata(G_OBJECT(task), deadline_task_quark());
+}
+
+void deadline_return_expired(GTask *task)
+{
+    g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_TIMED_OUT, "Deadline exceeded");
+}
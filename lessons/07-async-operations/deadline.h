@@ -0,0 +1,92 @@
+/*
+ * deadline.h - Deadlines for GTasks, backed by a timer wheel
+ *
+ * async_timeout.c gives each operation its own GCancellable and its own
+ * g_timeout_add() source. The task function polls
+ * g_cancellable_is_cancelled() between sleeps, and on completion the
+ * source is removed again. At 100k requests in flight that is 100k
+ * GSources visited in every main-loop iteration, plus a "cancelled"
+ * signal emission for each one that expires. A Deadline is instead:
+ *
+ *   - a timer on a TimerWheel (lessons/03-main-loop-and-contexts), one
+ *     wheel source per context however many deadlines are armed
+ *   - an expired flag that deadline_check() reads with one atomic load,
+ *     so workers can test it in a tight loop without taking a lock
+ *   - attached to a GTask with deadline_attach(). A child task gets
+ *     its parent's deadline the same way, or a tighter one from
+ *     deadline_new_child(), which never expires after the parent's
+ *   - optionally tied to a GCancellable, cancelled only on expiry, for
+ *     blocking GIO calls that can't poll a flag
+ *
+ * The flag is set by the wheel, so it can be up to the wheel's tick
+ * plus slack late; deadline_get_remaining_us() reads the clock instead.
+ *
+ * deadline_new(), deadline_new_child() and deadline_release() must be
+ * called in the thread running the wheel's context. Every other
+ * function may be called from any thread.
+ */
+
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <gio/gio.h>
+
+#include "timer_wheel.h"
+
+G_BEGIN_DECLS
+
+typedef struct _Deadline Deadline;
+
+/* All fields are private; they are visible for deadline_check() */
+struct _Deadline {
+    gint expired;                    /* Atomic */
+    gint ref_count;                  /* Atomic */
+    guint holds;                     /* Wheel thread only */
+    gint64 expires_us;               /* Monotonic time */
+    TimerWheel *wheel;               /* Referenced while armed */
+    TimerWheelTimer timer;
+    GCancellable *cancellable;
+};
+
+/* A deadline @timeout_ms from now on @wheel, which must be attached to
+ * a context. @cancellable, if not NULL, is cancelled when it expires.
+ * The caller holds it until deadline_release(). */
+Deadline *deadline_new(TimerWheel *wheel, guint timeout_ms, GCancellable *cancellable);
+
+/* The sooner of @parent and @timeout_ms from now. When that is @parent,
+ * @parent itself is returned with another hold, so no timer is added.
+ * Release the result either way. */
+Deadline *deadline_new_child(Deadline *parent, guint timeout_ms);
+
+/* Ends the caller's interest in @deadline, e.g. once the request it
+ * bounds has completed. After the last hold is released an unexpired
+ * deadline is disarmed; it never fires. Drops a reference too. */
+void deadline_release(Deadline *deadline);
+
+/* References keep the memory alive for deadline_check() and friends.
+ * They don't keep the deadline armed. */
+Deadline *deadline_ref(Deadline *deadline);
+void deadline_unref(Deadline *deadline);
+
+/* TRUE once the wheel has expired @deadline. NULL never expires. */
+static inline gboolean deadline_check(const Deadline *deadline)
+{
+    return deadline != NULL && __atomic_load_n(&deadline->expired, __ATOMIC_RELAXED);
+}
+
+/* Time left by the clock, 0 once expired, G_MAXINT64 for NULL */
+gint64 deadline_get_remaining_us(const Deadline *deadline);
+
+/* Gives @task a reference to @deadline, replacing any it had */
+void deadline_attach(GTask *task, Deadline *deadline);
+
+/* @task's deadline or NULL. Takes GObject's qdata lock, so fetch it
+ * once per task function, not inside the loop. */
+Deadline *deadline_from_task(GTask *task);
+
+/* g_task_return_new_error() with G_IO_ERROR_TIMED_OUT */
+void deadline_return_expired(GTask *task);
+
+G_END_DECLS
+
+#endif /* DEADLINE_H */
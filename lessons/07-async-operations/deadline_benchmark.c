@@ -0,0 +1,239 @@
+/*
+ * deadline_benchmark.c - Per-request timeout sources vs wheel deadlines
+ *
+ * N requests (default 20000) are started at once, each a GTask run with
+ * g_task_run_in_thread() whose function spins in short steps, checking
+ * for timeout between steps. Timeouts are either
+ *   - a GCancellable and a g_timeout_add() per request, cancelled from
+ *     the timeout callback and removed on completion, as
+ *     run_with_timeout() in async_timeout.c does
+ *   - a Deadline on one TimerWheel, checked with deadline_check()
+ *
+ * Two scenarios: a long timeout that no request hits, so the cost is
+ * arming and disarming; and a short one that expires while most
+ * requests are still queued, so the cost is firing. Each is a
+ * bench_run_ops() case where one iteration starts all N and waits for
+ * the last to finish, reported per request.
+ *
+ * Usage: ./deadline_benchmark [requests] [--bench-...]
+ */
+
+#include "bench.h"
+#include "deadline.h"
+
+#define LONG_TIMEOUT_MS 10000
+#define SHORT_TIMEOUT_MS 20
+#define WORK_STEPS 20
+#define STEP_SPIN 500
+#define WHEEL_SLACK_MS 5
+
+typedef enum {
+    MODE_TIMEOUT_SOURCE,
+    MODE_DEADLINE
+} Mode;
+
+/* Bench names: the long timeout, then the short one */
+static const gchar *mode_names[][2] = {
+    { "g_timeout_add long", "g_timeout_add short" },
+    { "deadline long", "deadline short" }
+};
+
+typedef struct {
+    GMainLoop *loop;
+    TimerWheel *wheel;
+    Mode mode;
+    guint n;
+    guint timeout_ms;
+    guint steps;                     /* Per request; G_MAXUINT = until timed out */
+    guint remaining;
+    guint64 requests;                /* Over every iteration */
+    guint64 timed_out;
+} Run;
+
+typedef struct {
+    Run *run;
+    GCancellable *cancellable;       /* MODE_TIMEOUT_SOURCE */
+    guint timeout_id;
+    Deadline *deadline;              /* MODE_DEADLINE */
+} Request;
+
+static void spin(void)
+{
+    for (volatile guint i = 0; i < STEP_SPIN; i++);
+}
+
+static void cancellable_work(GTask *task, gpointer source_object, gpointer task_data,
+                             GCancellable *cancellable)
+{
+    Request *request = task_data;
+
+    for (guint i = 0; i < request->run->steps; i++) {
+        if (g_cancellable_is_cancelled(cancellable)) {
+            g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_TIMED_OUT, "Timed out");
+            return;
+        }
+        spin();
+    }
+    g_task_return_boolean(task, TRUE);
+}
+
+static void deadline_work(GTask *task, gpointer source_object, gpointer task_data,
+                          GCancellable *cancellable)
+{
+    Request *request = task_data;
+    Deadline *deadline = deadline_from_task(task);
+
+    for (guint i = 0; i < request->run->steps; i++) {
+        if (deadline_check(deadline)) {
+            deadline_return_expired(task);
+            return;
+        }
+        spin();
+    }
+    g_task_return_boolean(task, TRUE);
+}
+
+static gboolean on_timeout(gpointer user_data)
+{
+    Request *request = user_data;
+
+    request->timeout_id = 0;
+    g_cancellable_cancel(request->cancellable);
+    return G_SOURCE_REMOVE;
+}
+
+static void on_done(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+    Request *request = user_data;
+    Run *run = request->run;
+    GError *error = NULL;
+
+    if (!g_task_propagate_boolean(G_TASK(result), &error)) {
+        run->timed_out++;
+        g_error_free(error);
+    }
+
+    if (request->timeout_id != 0) {
+        g_source_remove(request->timeout_id);
+    }
+    g_clear_object(&request->cancellable);
+    if (request->deadline) {
+        deadline_release(request->deadline);
+    }
+    g_free(request);
+
+    if (--run->remaining == 0) {
+        g_main_loop_quit(run->loop);
+    }
+}
+
+static void submit(Run *run)
+{
+    Request *request = g_new0(Request, 1);
+    GTask *task;
+
+    request->run = run;
+
+    if (run->mode == MODE_TIMEOUT_SOURCE) {
+        request->cancellable = g_cancellable_new();
+        request->timeout_id = g_timeout_add(run->timeout_ms, on_timeout, request);
+        task = g_task_new(NULL, request->cancellable, on_done, request);
+        g_task_set_task_data(task, request, NULL);
+        g_task_run_in_thread(task, cancellable_work);
+    } else {
+        request->deadline = deadline_new(run->wheel, run->timeout_ms, NULL);
+        task = g_task_new(NULL, NULL, on_done, request);
+        g_task_set_task_data(task, request, NULL);
+        deadline_attach(task, request->deadline);
+        g_task_run_in_thread(task, deadline_work);
+    }
+    g_object_unref(task);
+}
+
+static void requests_bench(guint64 iterations, gpointer user_data)
+{
+    Run *run = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        run->remaining = run->n;
+        for (guint i = 0; i < run->n; i++) {
+            submit(run);
+        }
+        g_main_loop_run(run->loop);
+        run->requests += run->n;
+    }
+}
+
+/* The fraction of requests that timed out */
+static gdouble run_mode(Bench *bench, const gchar *name, Mode mode, TimerWheel *wheel,
+                        guint n, guint timeout_ms, guint steps)
+{
+    Run run = {
+        .loop = g_main_loop_new(NULL, FALSE),
+        .wheel = wheel,
+        .mode = mode,
+        .n = n,
+        .timeout_ms = timeout_ms,
+        .steps = steps,
+    };
+
+    bench_run_ops(bench, name, n, requests_bench, &run);
+    g_main_loop_unref(run.loop);
+    return (gdouble)run.timed_out / run.requests;
+}
+
+int main(int argc, char *argv[])
+{
+    Bench *bench = bench_new("deadline_benchmark", &argc, &argv);
+    guint n = (argc > 1) ? (guint)g_ascii_strtoull(argv[1], NULL, 10) : 20000;
+    GError *error = NULL;
+    TimerWheel *wheel;
+    gdouble timed_out;
+
+    if (n == 0) {
+        g_printerr("Usage: %s [requests]\n", argv[0]);
+        bench_free(bench);
+        return 1;
+    }
+
+    wheel = timer_wheel_new(1, WHEEL_SLACK_MS, &error);
+    if (wheel == NULL) {
+        g_printerr("Failed to create timer wheel: %s\n", error->message);
+        g_error_free(error);
+        bench_free(bench);
+        return 1;
+    }
+    g_source_attach((GSource *)wheel, NULL);
+
+    g_print("=== Deadline Benchmark (%u requests) ===\n", n);
+
+    g_print("\n%d ms timeout, %d work steps (none time out), per request:\n",
+            LONG_TIMEOUT_MS, WORK_STEPS);
+    for (Mode mode = MODE_TIMEOUT_SOURCE; mode <= MODE_DEADLINE; mode++) {
+        timed_out = run_mode(bench, mode_names[mode][0], mode, wheel, n, LONG_TIMEOUT_MS, WORK_STEPS);
+        if (timed_out > 0) {
+            g_error("%s: %.1f%% of requests hit a %d ms timeout",
+                    mode_names[mode][0], timed_out * 100, LONG_TIMEOUT_MS);
+        }
+    }
+
+    g_print("\n%d ms timeout, work until timed out, per request:\n", SHORT_TIMEOUT_MS);
+    for (Mode mode = MODE_TIMEOUT_SOURCE; mode <= MODE_DEADLINE; mode++) {
+        timed_out = run_mode(bench, mode_names[mode][1], mode, wheel, n, SHORT_TIMEOUT_MS, G_MAXUINT);
+        if (timed_out < 1) {
+            g_error("%s: only %.1f%% of requests timed out", mode_names[mode][1], timed_out * 100);
+        }
+    }
+
+    g_source_destroy((GSource *)wheel);
+    g_source_unref((GSource *)wheel);
+
+    g_print("\n=== Key Points ===\n");
+    g_print("- Every g_timeout_add() is a GSource the main loop visits each iteration\n");
+    g_print("- A timer wheel is one source, and arming or disarming a deadline is O(1)\n");
+    g_print("- deadline_check() is one atomic load: cheap enough for a worker's inner loop\n");
+    g_print("- An expiring deadline sets a flag instead of emitting \"cancelled\"\n");
+
+    bench_free(bench);
+    return 0;
+}
@@ -0,0 +1,513 @@
+/*
+ * task_group.c - Bounded parallel fan-out / fan-in over many work items
+ *
+ * See task_group.h for the API. Each item index is pushed onto a
+ * GThreadPool whose max_threads is the group's parallelism, so nothing
+ * is allocated per item beyond the pool's queue node. A worker stores
+ * the result in a preallocated slot and appends the index to a
+ * mutex-protected pending list. Only the append that finds the list
+ * empty wakes the caller's context (through the ready time of a small
+ * GSource), and that dispatch takes the whole list as one batch.
+ *
+ * Items skipped because of cancellation go through the same path, so
+ * the group is finished exactly when every index has been delivered.
+ * The thread pool is freed (and waited for) before the group returns,
+ * so no worker touches the group after completion.
+ */
+
+#include "task_group.h"
+
+typedef struct {
+    GSource source;
+    TaskGroup *group;
+} NotifySource;
+
+struct _TaskGroup {
+    guint max_parallel;
+    GDestroyNotify result_free;
+    GPtrArray *items;
+    gpointer *results;
+
+    TaskGroupFunc func;
+    gpointer user_data;
+    TaskGroupBatchFunc batch_func;
+    gpointer batch_data;
+
+    GTask *task;                     /* Set while running */
+    GThreadPool *pool;
+    GCancellable *cancellable;       /* Internal; cancelled by the caller's */
+    GCancellable *outer;
+    gulong outer_handler;
+    GSource *notify;
+
+    GMutex lock;
+    GArray *pending;                 /* Of guint, protected by lock */
+    GError *error;                   /* First failure, protected by lock */
+
+    /* Owning context only */
+    GArray *delivering;
+    GArray *batch;                   /* Of TaskGroupResult */
+    guint n_delivered;
+    guint n_batches;
+};
+
+static void finish(TaskGroup *group);
+
+/* ============================================================
+ * Workers
+ * ============================================================ */
+
+static void run_item(gpointer data, gpointer user_data)
+{
+    TaskGroup *group = user_data;
+    guint index = GPOINTER_TO_UINT(data) - 1;
+    GError *error = NULL;
+    gboolean first_error = FALSE;
+    gboolean wake;
+
+    if (!g_cancellable_is_cancelled(group->cancellable)) {
+        group->results[index] = group->func(g_ptr_array_index(group->items, index),
+                                            group->user_data, group->cancellable, &error);
+    }
+
+    g_mutex_lock(&group->lock);
+    if (error) {
+        if (group->error == NULL) {
+            group->error = g_steal_pointer(&error);
+            first_error = TRUE;
+        }
+        if (group->results[index] && group->result_free) {
+            group->result_free(group->results[index]);
+        }
+        group->results[index] = NULL;
+    }
+    g_array_append_val(group->pending, index);
+    wake = group->pending->len == 1;
+    g_mutex_unlock(&group->lock);
+
+    g_clear_error(&error);
+    if (first_error) {
+        g_cancellable_cancel(group->cancellable);
+    }
+    if (wake) {
+        g_source_set_ready_time(group->notify, 0);
+    }
+}
+
+/* ============================================================
+ * Delivery
+ * ============================================================ */
+
+static gboolean notify_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+    TaskGroup *group = ((NotifySource *)source)->group;
+    GArray *ready;
+
+    /* Before taking the list: an append after this re-arms us */
+    g_source_set_ready_time(source, -1);
+
+    g_mutex_lock(&group->lock);
+    ready = group->pending;
+    group->pending = group->delivering;
+    group->delivering = ready;
+    g_mutex_unlock(&group->lock);
+
+    if (ready->len == 0) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    group->n_batches++;
+    if (group->batch_func) {
+        g_array_set_size(group->batch, ready->len);
+        for (guint i = 0; i < ready->len; i++) {
+            TaskGroupResult *r = &g_array_index(group->batch, TaskGroupResult, i);
+
+            r->index = g_array_index(ready, guint, i);
+            r->item = g_ptr_array_index(group->items, r->index);
+            r->result = group->results[r->index];
+        }
+        group->batch_func(group, (const TaskGroupResult *)group->batch->data, ready->len,
+                          group->batch_data);
+    }
+
+    group->n_delivered += ready->len;
+    g_array_set_size(ready, 0);
+
+    if (group->n_delivered == group->items->len) {
+        finish(group);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs notify_funcs = {
+    NULL,
+    NULL,
+    notify_dispatch,
+    NULL,
+    NULL, /* closure_callback */
+    NULL  /* closure_marshal */
+};
+
+static void on_outer_cancelled(GCancellable *outer, gpointer user_data)
+{
+    g_cancellable_cancel(((TaskGroup *)user_data)->cancellable);
+}
+
+static void free_results(TaskGroup *group)
+{
+    if (group->results == NULL) {
+        return;
+    }
+    if (group->result_free) {
+        for (guint i = 0; i < group->items->len; i++) {
+            if (group->results[i]) {
+                group->result_free(group->results[i]);
+            }
+        }
+    }
+    g_clear_pointer(&group->results, g_free);
+}
+
+static void finish(TaskGroup *group)
+{
+    GTask *task = g_steal_pointer(&group->task);
+    GError *error;
+
+    if (group->pool) {
+        /* Every item has been delivered, so this only joins idle threads */
+        g_thread_pool_free(group->pool, FALSE, TRUE);
+        group->pool = NULL;
+    }
+    if (group->notify) {
+        g_source_destroy(group->notify);
+        g_clear_pointer(&group->notify, g_source_unref);
+    }
+    if (group->outer_handler) {
+        g_cancellable_disconnect(group->outer, group->outer_handler);
+        group->outer_handler = 0;
+    }
+    g_clear_object(&group->outer);
+    g_clear_object(&group->cancellable);
+
+    error = g_steal_pointer(&group->error);
+    if (error) {
+        g_task_return_error(task, error);
+    } else if (!g_task_return_error_if_cancelled(task)) {
+        GPtrArray *results = g_ptr_array_new_full(group->items->len, group->result_free);
+
+        for (guint i = 0; i < group->items->len; i++) {
+            g_ptr_array_add(results, group->results[i]);
+        }
+        g_clear_pointer(&group->results, g_free);
+        g_task_return_pointer(task, results, (GDestroyNotify)g_ptr_array_unref);
+    }
+    g_object_unref(task);
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+TaskGroup *task_group_new(guint max_parallel, GDestroyNotify result_free)
+{
+    TaskGroup *group = g_new0(TaskGroup, 1);
+
+    group->max_parallel = max_parallel ? max_parallel : g_get_num_processors();
+    group->result_free = result_free;
+    group->items = g_ptr_array_new();
+    g_mutex_init(&group->lock);
+    group->pending = g_array_new(FALSE, FALSE, sizeof(guint));
+    group->delivering = g_array_new(FALSE, FALSE, sizeof(guint));
+    group->batch = g_array_new(FALSE, FALSE, sizeof(TaskGroupResult));
+
+    return group;
+}
+
+void task_group_free(TaskGroup *group)
+{
+    g_return_if_fail(group != NULL);
+    g_return_if_fail(group->task == NULL);
+
+    free_results(group);
+    g_ptr_array_unref(group->items);
+    g_mutex_clear(&group->lock);
+    g_array_unref(group->pending);
+    g_array_unref(group->delivering);
+    g_array_unref(group->batch);
+    g_free(group);
+}
+
+void task_group_add(TaskGroup *group, gpointer item)
+{
+    g_return_if_fail(group != NULL);
+    g_return_if_fail(group->task == NULL);
+
+    g_ptr_array_add(group->items, item);
+}
+
+void task_group_set_batch_func(TaskGroup *group,
+                               TaskGroupBatchFunc func,
+                               gpointer user_data)
+{
+    g_return_if_fail(group != NULL);
+    g_return_if_fail(group->task == NULL);
+
+    group->batch_func = func;
+    group->batch_data = user_data;
+}
+
+guint task_group_get_n_items(TaskGroup *group)
+{
+    return group->items->len;
+}
+
+guint task_group_get_n_batches(TaskGroup *group)
+{
+    return group->n_batches;
+}
+
+void task_group_run_async(TaskGroup *group,
+                          TaskGroupFunc func,
+                          gpointer user_data,
+                          GCancellable *cancellable,
+                          GAsyncReadyCallback callback,
+                          gpointer callback_data)
+{
+    GMainContext *context;
+
+    g_return_if_fail(group != NULL);
+    g_return_if_fail(group->task == NULL);
+    g_return_if_fail(func != NULL);
+
+    free_results(group);
+    group->task = g_task_new(NULL, cancellable, callback, callback_data);
+    g_task_set_source_tag(group->task, task_group_run_async);
+    group->func = func;
+    group->user_data = user_data;
+    group->results = g_new0(gpointer, group->items->len);
+    group->n_delivered = 0;
+    group->n_batches = 0;
+
+    group->cancellable = g_cancellable_new();
+    if (cancellable) {
+        group->outer = g_object_ref(cancellable);
+        /* Runs at once if @cancellable is already cancelled */
+        group->outer_handler = g_cancellable_connect(cancellable, G_CALLBACK(on_outer_cancelled),
+                                                     group, NULL);
+    }
+
+    if (group->items->len == 0) {
+        finish(group);
+        return;
+    }
+
+    context = g_main_context_ref_thread_default();
+    group->notify = g_source_new(&notify_funcs, sizeof(NotifySource));
+    ((NotifySource *)group->notify)->group = group;
+    g_source_set_name(group->notify, "TaskGroup");
+    g_source_attach(group->notify, context);
+    g_main_context_unref(context);
+
+    /* Non-exclusive pools share idle threads, so this never fails */
+    group->pool = g_thread_pool_new(run_item, group, (gint)group->max_parallel, FALSE, NULL);
+    for (guint i = 0; i < group->items->len; i++) {
+        g_thread_pool_push(group->pool, GUINT_TO_POINTER(i + 1), NULL);
+    }
+}
+
+GPtrArray *task_group_run_finish(TaskGroup *group,
+                                 GAsyncResult *result,
+                                 GError **error)
+{
+    g_return_val_if_fail(g_task_is_valid(result, NULL), NULL);
+    g_return_val_if_fail(g_task_get_source_tag(G_TASK(result)) == task_group_run_async, NULL);
+
+    return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+/* ============================================================
+ * Map
+ * ============================================================ */
+
+static void on_map_done(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+    GTask *task = user_data;
+    GError *error = NULL;
+    GPtrArray *results = task_group_run_finish(g_task_get_task_data(task), result, &error);
+
+    if (results) {
+        g_task_return_pointer(task, results, (GDestroyNotify)g_ptr_array_unref);
+    } else {
+        g_task_return_error(task, error);
+    }
+    g_object_unref(task);
+}
+
+void task_group_map_async(GPtrArray *items,
+                          TaskGroupFunc func,
+                          gpointer user_data,
+                          guint max_parallel,
+                          GDestroyNotify result_free,
+                          GCancellable *cancellable,
+                          GAsyncReadyCallback callback,
+                          gpointer callback_data)
+{
+    TaskGroup *group;
+    GTask *task;
+
+    g_return_if_fail(items != NULL);
+    g_return_if_fail(func != NULL);
+
+    group = task_group_new(max_parallel, result_free);
+    for (guint i = 0; i < items->len; i++) {
+        task_group_add(group, g_ptr_array_index(items, i));
+    }
+
+    task = g_task_new(NULL, cancellable, callback, callback_data);
+    g_task_set_source_tag(task, task_group_map_async);
+    g_task_set_task_data(task, group, (GDestroyNotify)task_group_free);
+    task_group_run_async(group, func, user_data, cancellable, on_map_done, task);
+}
+
+GPtrArray *task_group_map_finish(GAsyncResult *result, GError **error)
+{
+    g_return_val_if_fail(g_task_is_valid(result, NULL), NULL);
+    g_return_val_if_fail(g_task_get_source_tag(G_TASK(result)) == task_group_map_async, NULL);
+
+    return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+/* ============================================================
+ * Map-reduce
+ * ============================================================ */
+
+typedef struct _MapReduce MapReduce;
+
+typedef struct {
+    MapReduce *mr;
+    guint start;
+    guint end;
+} Chunk;
+
+struct _MapReduce {
+    GPtrArray *items;
+    TaskGroupFunc map;
+    TaskGroupReduceFunc reduce;
+    gpointer user_data;
+    GDestroyNotify value_free;
+    Chunk *chunks;
+    TaskGroup *group;
+};
+
+static void map_reduce_free(MapReduce *mr)
+{
+    task_group_free(mr->group);
+    g_free(mr->chunks);
+    g_free(mr);
+}
+
+/* Worker: map and fold one chunk */
+static gpointer reduce_chunk(gpointer item, gpointer user_data,
+                             GCancellable *cancellable, GError **error)
+{
+    Chunk *chunk = item;
+    MapReduce *mr = user_data;
+    gpointer acc = NULL;
+
+    for (guint i = chunk->start; i < chunk->end; i++) {
+        GError *local_error = NULL;
+        gpointer value;
+
+        if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+            break;
+        }
+        value = mr->map(g_ptr_array_index(mr->items, i), mr->user_data, cancellable, &local_error);
+        if (local_error) {
+            g_propagate_error(error, local_error);
+            break;
+        }
+        acc = (i == chunk->start) ? value : mr->reduce(acc, value, mr->user_data);
+    }
+
+    if (error && *error && acc && mr->value_free) {
+        mr->value_free(acc);
+        acc = NULL;
+    }
+    return acc;
+}
+
+/* Fold the per-chunk partials, in order, in the caller's context */
+static void on_map_reduce_done(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+    GTask *task = user_data;
+    MapReduce *mr = g_task_get_task_data(task);
+    GError *error = NULL;
+    GPtrArray *partials = task_group_run_finish(mr->group, result, &error);
+    gpointer acc = NULL;
+
+    if (partials == NULL) {
+        g_task_return_error(task, error);
+        g_object_unref(task);
+        return;
+    }
+
+    g_ptr_array_set_free_func(partials, NULL);
+    for (guint i = 0; i < partials->len; i++) {
+        gpointer partial = g_ptr_array_index(partials, i);
+
+        acc = (i == 0) ? partial : mr->reduce(acc, partial, mr->user_data);
+    }
+    g_ptr_array_unref(partials);
+
+    g_task_return_pointer(task, acc, mr->value_free);
+    g_object_unref(task);
+}
+
+void task_group_map_reduce_async(GPtrArray *items,
+                                 TaskGroupFunc map,
+                                 TaskGroupReduceFunc reduce,
+                                 gpointer user_data,
+                                 guint max_parallel,
+                                 GDestroyNotify value_free,
+                                 GCancellable *cancellable,
+                                 GAsyncReadyCallback callback,
+                                 gpointer callback_data)
+{
+    MapReduce *mr;
+    GTask *task;
+    guint n_chunks;
+
+    g_return_if_fail(items != NULL);
+    g_return_if_fail(map != NULL && reduce != NULL);
+
+    mr = g_new0(MapReduce, 1);
+    mr->items = items;
+    mr->map = map;
+    mr->reduce = reduce;
+    mr->user_data = user_data;
+    mr->value_free = value_free;
+    mr->group = task_group_new(max_parallel, value_free);
+
+    /* A few chunks per worker, so one slow chunk doesn't idle the rest */
+    n_chunks = MIN(items->len, mr->group->max_parallel * 4);
+    mr->chunks = g_new(Chunk, MAX(n_chunks, 1));
+    for (guint c = 0; c < n_chunks; c++) {
+        mr->chunks[c].mr = mr;
+        mr->chunks[c].start = (guint)((guint64)items->len * c / n_chunks);
+        mr->chunks[c].end = (guint)((guint64)items->len * (c + 1) / n_chunks);
+        task_group_add(mr->group, &mr->chunks[c]);
+    }
+
+    task = g_task_new(NULL, cancellable, callback, callback_data);
+    g_task_set_source_tag(task, task_group_map_reduce_async);
+    g_task_set_task_data(task, mr, (GDestroyNotify)map_reduce_free);
+    task_group_run_async(mr->group, reduce_chunk, mr, cancellable, on_map_reduce_done, task);
+}
+
+gpointer task_group_map_reduce_finish(GAsyncResult *result, GError **error)
+{
+    g_return_val_if_fail(g_task_is_valid(result, NULL), NULL);
+    g_return_val_if_fail(g_task_get_source_tag(G_TASK(result)) == task_group_map_reduce_async, NULL);
+
+    return g_task_propagate_pointer(G_TASK(result), error);
+}
@@ -0,0 +1,125 @@
+/*
+ * task_group.h - Bounded parallel fan-out / fan-in over many work items
+ *
+ * parallel_async.c creates one GTask per operation, runs each in
+ * GTask's thread pool, and takes one main-loop callback per completion
+ * to count them under a mutex. That is fine for five operations. For a
+ * hundred thousand it is a GTask, a GSource and a wakeup per item, with
+ * nothing limiting how many run at once.
+ *
+ * A TaskGroup takes a list of items and a TaskGroupFunc:
+ *
+ *   - at most max_parallel items run at once, on a GThreadPool
+ *   - finished items are streamed back to the calling thread's
+ *     thread-default context in batches: whatever finished since the
+ *     last batch arrives in one callback, not one callback per item
+ *   - one GCancellable (the caller's, if given) stops every item that
+ *     hasn't started yet; the first item to fail cancels the rest too
+ *   - the group completes once, as an ordinary async operation, with
+ *     every result in submission order
+ *
+ * task_group_map_async() and task_group_map_reduce_async() wrap this
+ * for the common case of a GPtrArray in, a GPtrArray or a value out.
+ */
+
+#ifndef TASK_GROUP_H
+#define TASK_GROUP_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TaskGroup TaskGroup;
+
+/* Runs in a worker thread. Return the item's result, or NULL and set
+ * @error. Long items should check @cancellable. */
+typedef gpointer (*TaskGroupFunc)(gpointer item,
+                                  gpointer user_data,
+                                  GCancellable *cancellable,
+                                  GError **error);
+
+typedef struct {
+    guint index;               /* Position in submission order */
+    gpointer item;
+    gpointer result;           /* NULL if the item failed or was skipped */
+} TaskGroupResult;
+
+/* Runs in the context the group was started from. @results are
+ * borrowed: the results stay owned by the group until it completes. */
+typedef void (*TaskGroupBatchFunc)(TaskGroup *group,
+                                   const TaskGroupResult *results,
+                                   guint n_results,
+                                   gpointer user_data);
+
+/* Associative: fold @value into @acc and return the new accumulator.
+ * Takes ownership of both. */
+typedef gpointer (*TaskGroupReduceFunc)(gpointer acc,
+                                        gpointer value,
+                                        gpointer user_data);
+
+/* @max_parallel 0 = one per processor. @result_free, if set, frees
+ * results the caller never receives (failed or cancelled groups). */
+TaskGroup *task_group_new(guint max_parallel, GDestroyNotify result_free);
+
+/* Only while the group isn't running. Frees the results of a group
+ * that failed or was never finished. */
+void task_group_free(TaskGroup *group);
+
+/* Before starting the group */
+void task_group_add(TaskGroup *group, gpointer item);
+void task_group_set_batch_func(TaskGroup *group,
+                               TaskGroupBatchFunc func,
+                               gpointer user_data);
+
+guint task_group_get_n_items(TaskGroup *group);
+
+/* Batches observed so far, i.e. main-loop callbacks taken */
+guint task_group_get_n_batches(TaskGroup *group);
+
+void task_group_run_async(TaskGroup *group,
+                          TaskGroupFunc func,
+                          gpointer user_data,
+                          GCancellable *cancellable,
+                          GAsyncReadyCallback callback,
+                          gpointer callback_data);
+
+/* Every result in submission order, owned by the caller and freed with
+ * the group's result_free. NULL with @error set if an item failed
+ * (the first error wins) or the group was cancelled. */
+GPtrArray *task_group_run_finish(TaskGroup *group,
+                                 GAsyncResult *result,
+                                 GError **error);
+
+/* Apply @func to every element of @items, at most @max_parallel at a
+ * time. @items must stay alive until the operation completes. */
+void task_group_map_async(GPtrArray *items,
+                          TaskGroupFunc func,
+                          gpointer user_data,
+                          guint max_parallel,
+                          GDestroyNotify result_free,
+                          GCancellable *cancellable,
+                          GAsyncReadyCallback callback,
+                          gpointer callback_data);
+
+GPtrArray *task_group_map_finish(GAsyncResult *result, GError **error);
+
+/* Map every element with @map and fold the results with @reduce. Items
+ * are split into contiguous chunks, each reduced on a worker; the
+ * partial results are then folded in order in the calling context, so
+ * @reduce need not be commutative. Completes with NULL for an empty
+ * array. */
+void task_group_map_reduce_async(GPtrArray *items,
+                                 TaskGroupFunc map,
+                                 TaskGroupReduceFunc reduce,
+                                 gpointer user_data,
+                                 guint max_parallel,
+                                 GDestroyNotify value_free,
+                                 GCancellable *cancellable,
+                                 GAsyncReadyCallback callback,
+                                 gpointer callback_data);
+
+gpointer task_group_map_reduce_finish(GAsyncResult *result, GError **error);
+
+G_END_DECLS
+
+#endif /* TASK_GROUP_H */
@@ -0,0 +1,357 @@
+/*
+ * arena.c - Bump-pointer region allocator
+ *
+ * See arena.h for the API. Blocks form a list from newest to oldest;
+ * only the newest is allocated from. A mark is (block, offset, cleanup
+ * list head), so rewinding runs the newer cleanups, frees the newer
+ * blocks and restores the offset. One default-size block is kept spare
+ * so a request loop that rewinds every iteration doesn't malloc/free a
+ * block each time.
+ */
+
+#include "arena.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define ARENA_ALIGN 16
+#define ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~(gsize)(ARENA_ALIGN - 1))
+
+struct _ArenaBlock {
+    ArenaBlock *prev;
+    gsize size;                      /* Usable bytes after the header */
+    gsize used;                      /* Fill level once no longer current */
+} __attribute__((aligned(ARENA_ALIGN)));
+
+struct _ArenaCleanup {
+    ArenaCleanup *next;
+    GDestroyNotify func;
+    gpointer data;
+};
+
+struct _Arena {
+    ArenaBlock *current;
+    gsize offset;                    /* Fill level of current */
+    gsize block_size;
+    ArenaCleanup *cleanups;          /* Newest first */
+    ArenaBlock *spare;
+    gsize reserved;
+};
+
+static inline guint8 *block_data(ArenaBlock *block)
+{
+    return (guint8 *)(block + 1);
+}
+
+static void block_release(Arena *arena, ArenaBlock *block)
+{
+    if (arena->spare == NULL && block->size == arena->block_size) {
+        arena->spare = block;
+        return;
+    }
+
+    arena->reserved -= block->size;
+    g_free(block);
+}
+
+static void run_cleanups(Arena *arena, ArenaCleanup *until)
+{
+    while (arena->cleanups != until) {
+        ArenaCleanup *cleanup = arena->cleanups;
+
+        arena->cleanups = cleanup->next;
+        cleanup->func(cleanup->data);
+    }
+}
+
+static gpointer arena_alloc_slow(Arena *arena, gsize size)
+{
+    gsize needed = ALIGN_UP(size);
+    ArenaBlock *block;
+
+    if (arena->spare && arena->spare->size >= needed) {
+        block = arena->spare;
+        arena->spare = NULL;
+    } else {
+        gsize block_size = MAX(arena->block_size, needed);
+
+        block = g_malloc(sizeof(ArenaBlock) + block_size);
+        block->size = block_size;
+        arena->reserved += block_size;
+    }
+
+    if (arena->current) {
+        arena->current->used = arena->offset;
+    }
+    block->prev = arena->current;
+    arena->current = block;
+    arena->offset = size;
+
+    return block_data(block);
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+Arena *arena_new(gsize block_size)
+{
+    Arena *arena = g_new0(Arena, 1);
+
+    arena->block_size = ALIGN_UP(block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE);
+    return arena;
+}
+
+void arena_free(Arena *arena)
+{
+    run_cleanups(arena, NULL);
+
+    while (arena->current) {
+        ArenaBlock *block = arena->current;
+        arena->current = block->prev;
+        g_free(block);
+    }
+    g_free(arena->spare);
+    g_free(arena);
+}
+
+gpointer arena_alloc(Arena *arena, gsize size)
+{
+    gsize start = ALIGN_UP(arena->offset);
+
+    if (G_UNLIKELY(arena->current == NULL || size > arena->current->size - MIN(start, arena->current->size))) {
+        return arena_alloc_slow(arena, size);
+    }
+
+    arena->offset = start + size;
+    return block_data(arena->current) + start;
+}
+
+gpointer arena_alloc0(Arena *arena, gsize size)
+{
+    gpointer mem = arena_alloc(arena, size);
+    memset(mem, 0, size);
+    return mem;
+}
+
+gchar *arena_strdup(Arena *arena, const gchar *str)
+{
+    return str ? arena_strndup(arena, str, strlen(str)) : NULL;
+}
+
+gchar *arena_strndup(Arena *arena, const gchar *str, gsize n)
+{
+    gchar *copy;
+
+    if (str == NULL) {
+        return NULL;
+    }
+
+    n = strnlen(str, n);
+    copy = arena_alloc(arena, n + 1);
+    memcpy(copy, str, n);
+    copy[n] = '\0';
+    return copy;
+}
+
+gchar *arena_strdup_vprintf(Arena *arena, const gchar *format, va_list args)
+{
+    gsize start = ALIGN_UP(arena->offset);
+    va_list copy;
+    gint len;
+
+    /* Most strings fit in what's left of the current block: format
+     * straight into it and only commit the bytes actually used */
+    if (arena->current && start < arena->current->size) {
+        gchar *dest = (gchar *)block_data(arena->current) + start;
+        gsize avail = arena->current->size - start;
+
+        va_copy(copy, args);
+        len = vsnprintf(dest, avail, format, copy);
+        va_end(copy);
+
+        if (len >= 0 && (gsize)len < avail) {
+            arena->offset = start + len + 1;
+            return dest;
+        }
+    } else {
+        va_copy(copy, args);
+        len = vsnprintf(NULL, 0, format, copy);
+        va_end(copy);
+    }
+
+    g_return_val_if_fail(len >= 0, NULL);
+
+    gchar *str = arena_alloc(arena, len + 1);
+    va_copy(copy, args);
+    vsnprintf(str, len + 1, format, copy);
+    va_end(copy);
+    return str;
+}
+
+gchar *arena_strdup_printf(Arena *arena, const gchar *format, ...)
+{
+    va_list args;
+    gchar *str;
+
+    va_start(args, format);
+    str = arena_strdup_vprintf(arena, format, args);
+    va_end(args);
+    return str;
+}
+
+ArenaMark arena_mark(Arena *arena)
+{
+    ArenaMark mark = { arena->current, arena->offset, arena->cleanups };
+    return mark;
+}
+
+void arena_rewind(Arena *arena, ArenaMark mark)
+{
+    run_cleanups(arena, mark.cleanups);
+
+    while (arena->current != mark.block) {
+        ArenaBlock *block = arena->current;
+
+        g_return_if_fail(block != NULL);   /* Mark from another arena or after a reset */
+        arena->current = block->prev;
+        block_release(arena, block);
+    }
+    arena->offset = mark.offset;
+}
+
+void arena_reset(Arena *arena)
+{
+    run_cleanups(arena, NULL);
+
+    if (arena->current == NULL) {
+        return;
+    }
+
+    while (arena->current->prev) {
+        ArenaBlock *block = arena->current;
+        arena->current = block->prev;
+        block_release(arena, block);
+    }
+    arena->offset = 0;
+}
+
+void arena_add_cleanup(Arena *arena, GDestroyNotify func, gpointer data)
+{
+    ArenaCleanup *cleanup = arena_alloc_type(arena, ArenaCleanup);
+
+    cleanup->func = func;
+    cleanup->data = data;
+    cleanup->next = arena->cleanups;
+    arena->cleanups = cleanup;
+}
+
+GHashTable *arena_hash_table_new(Arena *arena, GHashFunc hash_func, GEqualFunc key_equal_func)
+{
+    GHashTable *table = g_hash_table_new(hash_func, key_equal_func);
+
+    arena_add_cleanup(arena, (GDestroyNotify)g_hash_table_unref, table);
+    return table;
+}
+
+gsize arena_get_used(Arena *arena)
+{
+    gsize used = arena->offset;
+
+    if (arena->current) {
+        for (ArenaBlock *block = arena->current->prev; block; block = block->prev) {
+            used += block->used;
+        }
+    }
+    return used;
+}
+
+gsize arena_get_reserved(Arena *arena)
+{
+    return arena->reserved;
+}
+
+/* ============================================================
+ * ArenaString
+ * ============================================================ */
+
+static void arena_string_reserve(ArenaString *string, gsize extra)
+{
+    Arena *arena = string->arena;
+    gsize needed = string->len + extra + 1;
+    gchar *end = string->str + string->allocated;
+
+    if (needed <= string->allocated) {
+        return;
+    }
+
+    /* Newest allocation with room after it: grow in place */
+    if (arena->current &&
+        end == (gchar *)block_data(arena->current) + arena->offset &&
+        arena->offset + (needed - string->allocated) <= arena->current->size) {
+        arena->offset += needed - string->allocated;
+        string->allocated = needed;
+        return;
+    }
+
+    gsize new_size = MAX(string->allocated * 2, needed);
+    gchar *str = arena_alloc(arena, new_size);
+
+    memcpy(str, string->str, string->len + 1);
+    string->str = str;
+    string->allocated = new_size;
+}
+
+ArenaString *arena_string_new(Arena *arena, const gchar *init)
+{
+    ArenaString *string = arena_alloc_type(arena, ArenaString);
+    gsize len = init ? strlen(init) : 0;
+
+    string->arena = arena;
+    string->len = 0;
+    string->allocated = MAX(len + 1, 16);
+    string->str = arena_alloc(arena, string->allocated);
+    string->str[0] = '\0';
+
+    return init ? arena_string_append_len(string, init, len) : string;
+}
+
+ArenaString *arena_string_append_len(ArenaString *string, const gchar *val, gsize len)
+{
+    arena_string_reserve(string, len);
+    memcpy(string->str + string->len, val, len);
+    string->len += len;
+    string->str[string->len] = '\0';
+    return string;
+}
+
+ArenaString *arena_string_append(ArenaString *string, const gchar *val)
+{
+    return arena_string_append_len(string, val, strlen(val));
+}
+
+ArenaString *arena_string_append_c(ArenaString *string, gchar c)
+{
+    return arena_string_append_len(string, &c, 1);
+}
+
+ArenaString *arena_string_append_printf(ArenaString *string, const gchar *format, ...)
+{
+    va_list args;
+    gint len;
+
+    va_start(args, format);
+    len = vsnprintf(string->str + string->len, string->allocated - string->len, format, args);
+    va_end(args);
+    g_return_val_if_fail(len >= 0, string);
+
+    if (string->len + len + 1 > string->allocated) {
+        arena_string_reserve(string, len);
+        va_start(args, format);
+        vsnprintf(string->str + string->len, len + 1, format, args);
+        va_end(args);
+    }
+
+    string->len += len;
+    return string;
+}
@@ -0,0 +1,94 @@
+/*
+ * arena.h - Bump-pointer region allocator
+ *
+ * An Arena hands out memory by bumping a pointer through large blocks.
+ * Nothing is freed individually: everything allocated since a mark is
+ * released in one step by arena_rewind(), and everything at all by
+ * arena_reset(). That suits data sharing one lifetime, such as the
+ * temporary strings built while handling one request; thousands of
+ * g_free() calls become a single reset.
+ *
+ * Cleanup callbacks registered with arena_add_cleanup() run (newest
+ * first) when a rewind or reset drops the allocations made before them.
+ * arena_hash_table_new() uses this for tables whose keys and values live
+ * in the arena.
+ *
+ * An Arena is not thread-safe; use one per thread or per request.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <glib.h>
+#include <stdarg.h>
+
+G_BEGIN_DECLS
+
+typedef struct _Arena Arena;
+typedef struct _ArenaBlock ArenaBlock;
+typedef struct _ArenaCleanup ArenaCleanup;
+
+/* A position to rewind to; copy it by value */
+typedef struct {
+    ArenaBlock *block;
+    gsize offset;
+    ArenaCleanup *cleanups;
+} ArenaMark;
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+/* @block_size 0 selects ARENA_DEFAULT_BLOCK_SIZE */
+Arena *arena_new(gsize block_size);
+void arena_free(Arena *arena);
+
+/* 16-byte aligned, like malloc(). Larger requests than the block size
+ * get a block of their own. */
+gpointer arena_alloc(Arena *arena, gsize size);
+gpointer arena_alloc0(Arena *arena, gsize size);
+
+#define arena_alloc_type(arena, type) ((type *)arena_alloc((arena), sizeof(type)))
+#define arena_alloc_type0(arena, type) ((type *)arena_alloc0((arena), sizeof(type)))
+
+gchar *arena_strdup(Arena *arena, const gchar *str);
+gchar *arena_strndup(Arena *arena, const gchar *str, gsize n);
+gchar *arena_strdup_printf(Arena *arena, const gchar *format, ...) G_GNUC_PRINTF(2, 3);
+gchar *arena_strdup_vprintf(Arena *arena, const gchar *format, va_list args);
+
+/* Checkpoints nest: rewinding to a mark also discards every mark taken
+ * after it. arena_reset() keeps the first block for reuse. */
+ArenaMark arena_mark(Arena *arena);
+void arena_rewind(Arena *arena, ArenaMark mark);
+void arena_reset(Arena *arena);
+
+void arena_add_cleanup(Arena *arena, GDestroyNotify func, gpointer data);
+
+/* A GHashTable with no key/value destroy functions, unreffed when the
+ * arena drops it. Use it with arena-allocated keys and values. */
+GHashTable *arena_hash_table_new(Arena *arena, GHashFunc hash_func, GEqualFunc key_equal_func);
+
+/* Bytes handed out since the last reset, and bytes held in blocks */
+gsize arena_get_used(Arena *arena);
+gsize arena_get_reserved(Arena *arena);
+
+/* ============================================================
+ * ArenaString: a GString-like builder in arena memory
+ * ============================================================ */
+
+typedef struct {
+    gchar *str;
+    gsize len;
+    gsize allocated;
+    Arena *arena;
+} ArenaString;
+
+/* The string grows in place while it is the arena's newest allocation,
+ * otherwise it is copied; the old copy is reclaimed with the arena. */
+ArenaString *arena_string_new(Arena *arena, const gchar *init);
+ArenaString *arena_string_append(ArenaString *string, const gchar *val);
+ArenaString *arena_string_append_len(ArenaString *string, const gchar *val, gsize len);
+ArenaString *arena_string_append_c(ArenaString *string, gchar c);
+ArenaString *arena_string_append_printf(ArenaString *string, const gchar *format, ...) G_GNUC_PRINTF(2, 3);
+
+G_END_DECLS
+
+#endif /* ARENA_H */
@@ -0,0 +1,705 @@
+/*
+ * async_log.c - Asynchronous structured logging backend
+ *
+ * See async_log.h for the API. Each thread's ring is a power-of-two
+ * byte buffer with a producer head and a consumer tail, both counting
+ * bytes forever; the thread is the only writer of head and the drain
+ * thread the only writer of tail. A record never wraps: when it doesn't
+ * fit before the end of the buffer, the producer fills the rest with a
+ * padding record and starts again at offset 0. So each ring's pending
+ * bytes are at most two runs of whole records, which binary mode hands
+ * to writev() as they are.
+ *
+ * Rate limits use GCRA, the token bucket expressed as one timestamp:
+ * the theoretical arrival time of the next message. A message is
+ * admitted if that time is no more than the burst allowance ahead of
+ * now, and then moves it on by one interval.
+ */
+
+#include "async_log.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CACHE_LINE 64
+#define DEFAULT_RING_SIZE (256 * 1024)
+#define MIN_RING_SIZE 4096
+#define DEFAULT_FLUSH_MS 10
+#define NOTICE_DOMAIN "async-log"
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+#define ALIGN8(n) (((n) + 7) & ~(gsize)7)
+
+typedef struct _Ring Ring;
+
+struct _Ring {
+    guint64 head __attribute__((aligned(CACHE_LINE)));   /* Next byte the thread writes */
+    guint64 tail __attribute__((aligned(CACHE_LINE)));   /* Next byte the drain thread writes out */
+    guint64 pass_head;               /* Drain thread: head seen this pass */
+    gboolean pass_orphaned;          /* Drain thread: orphaned before this pass */
+    guint64 dropped;                 /* Atomic, since the last notice */
+    gint orphaned;                   /* Atomic: the thread has exited */
+    guint32 id;
+    gsize mask;
+    guint8 *data;
+    Ring *next;                      /* Under logger.lock */
+    gchar scratch[ASYNC_LOG_MAX_MESSAGE + 1];   /* async_log_write() formats here */
+};
+
+typedef struct {
+    gchar *domain;
+    gint64 interval_us;
+    gint64 burst_us;                 /* How far ahead of now tat may be */
+    gint64 tat;                      /* Atomic: theoretical arrival time */
+    guint64 suppressed;              /* Atomic, since the last notice */
+} RateLimit;
+
+static struct {
+    AsyncLogConfig config;
+    gsize ring_size;
+    gint running;                    /* Atomic */
+    gint wake_pending;               /* Atomic: a producer has signalled */
+    gboolean writer_installed;
+    GThread *thread;
+
+    GMutex lock;
+    GCond wake;
+    GCond drained;
+    guint64 passes;                  /* Drain passes completed */
+    guint64 flush_until;             /* Don't sleep until passes reaches this */
+    gboolean stopping;
+    Ring *rings;
+    guint32 next_id;
+
+    guint64 written;                 /* Atomic, as are the rest */
+    guint64 writes;
+    guint64 dropped;
+    guint64 suppressed;
+} logger;
+
+/* Read-only while running, so lookups need no lock */
+static GHashTable *rate_limits = NULL;
+
+static void ring_orphan(gpointer data);
+static GPrivate current_ring = G_PRIVATE_INIT(ring_orphan);
+
+static gpointer aligned_alloc0(gsize size)
+{
+    gpointer mem;
+
+    if (posix_memalign(&mem, CACHE_LINE, size) != 0) {
+        g_error("posix_memalign failed for %" G_GSIZE_FORMAT " bytes", size);
+    }
+    memset(mem, 0, size);
+    return mem;
+}
+
+static const gchar *level_name(guint32 level)
+{
+    if (level & G_LOG_LEVEL_ERROR) {
+        return "ERROR";
+    }
+    if (level & G_LOG_LEVEL_CRITICAL) {
+        return "CRITICAL";
+    }
+    if (level & G_LOG_LEVEL_WARNING) {
+        return "WARNING";
+    }
+    if (level & G_LOG_LEVEL_MESSAGE) {
+        return "MESSAGE";
+    }
+    if (level & G_LOG_LEVEL_INFO) {
+        return "INFO";
+    }
+    if (level & G_LOG_LEVEL_DEBUG) {
+        return "DEBUG";
+    }
+    return "LOG";
+}
+
+/* ============================================================
+ * Producer side
+ * ============================================================ */
+
+static void ring_orphan(gpointer data)
+{
+    Ring *ring = data;
+
+    __atomic_store_n(&ring->orphaned, TRUE, __ATOMIC_RELEASE);
+}
+
+static Ring *get_ring(void)
+{
+    Ring *ring = g_private_get(&current_ring);
+
+    if (G_LIKELY(ring != NULL)) {
+        return ring;
+    }
+
+    ring = aligned_alloc0(sizeof(Ring));
+    ring->mask = logger.ring_size - 1;
+    ring->data = g_malloc0(logger.ring_size);
+
+    g_mutex_lock(&logger.lock);
+    ring->id = ++logger.next_id;
+    ring->next = logger.rings;
+    logger.rings = ring;
+    g_mutex_unlock(&logger.lock);
+
+    g_private_set(&current_ring, ring);
+    return ring;
+}
+
+/* Only the first producer since the last pass signals, under the lock:
+ * the drain thread checks the flag under the lock before it waits, so
+ * a signal sent while it is draining isn't lost */
+static void wake_drain_thread(void)
+{
+    if (!__atomic_exchange_n(&logger.wake_pending, TRUE, __ATOMIC_RELAXED)) {
+        g_mutex_lock(&logger.lock);
+        g_cond_signal(&logger.wake);
+        g_mutex_unlock(&logger.lock);
+    }
+}
+
+static void ring_push(Ring *ring, guint32 level, gint64 time_us,
+                      const gchar *domain, gsize domain_len,
+                      const gchar *message, gsize message_len)
+{
+    gsize capacity = ring->mask + 1;
+    gsize size, contiguous, pad;
+    guint64 head = ring->head;
+    guint64 tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    AsyncLogRecord *record;
+
+    domain_len = MIN(domain_len, G_MAXUINT16);
+    message_len = MIN(message_len, capacity / 8);
+    size = ALIGN8(sizeof(AsyncLogRecord) + domain_len + message_len);
+    contiguous = capacity - (head & ring->mask);
+    pad = (contiguous < size) ? contiguous : 0;
+
+    if (capacity - (head - tail) < pad + size) {
+        __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+        wake_drain_thread();
+        return;
+    }
+
+    if (pad) {
+        /* Only size and level: the gap may be as small as 8 bytes */
+        guint32 *filler = (guint32 *)(ring->data + (head & ring->mask));
+
+        filler[0] = (guint32)pad;
+        filler[1] = 0;
+        head += pad;
+    }
+
+    record = (AsyncLogRecord *)(ring->data + (head & ring->mask));
+    record->size = (guint32)size;
+    record->level = level;
+    record->time_us = time_us;
+    record->thread = ring->id;
+    record->domain_len = (guint16)domain_len;
+    record->reserved = 0;
+    record->message_len = (guint32)message_len;
+    record->reserved2 = 0;
+    memcpy(record + 1, domain, domain_len);
+    memcpy((guint8 *)(record + 1) + domain_len, message, message_len);
+
+    __atomic_store_n(&ring->head, head + size, __ATOMIC_RELEASE);
+
+    if (head + size - tail > capacity / 2) {
+        wake_drain_thread();
+    }
+}
+
+static gboolean rate_allow(RateLimit *limit, gint64 now)
+{
+    gint64 tat = __atomic_load_n(&limit->tat, __ATOMIC_RELAXED);
+
+    for (;;) {
+        gint64 base = MAX(tat, now);
+
+        if (base - now > limit->burst_us) {
+            __atomic_fetch_add(&limit->suppressed, 1, __ATOMIC_RELAXED);
+            return FALSE;
+        }
+        if (__atomic_compare_exchange_n(&limit->tat, &tat, base + limit->interval_us,
+                                        TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return TRUE;
+        }
+    }
+}
+
+static gboolean is_fatal(GLogLevelFlags level)
+{
+    return (level & (G_LOG_FLAG_FATAL | G_LOG_LEVEL_ERROR)) != 0;
+}
+
+static gboolean admit(const gchar *domain, GLogLevelFlags level, gint64 now)
+{
+    RateLimit *limit;
+
+    if (is_fatal(level)) {
+        return TRUE;
+    }
+    if (logger.config.levels && !(level & logger.config.levels)) {
+        return FALSE;
+    }
+    if (rate_limits && (limit = g_hash_table_lookup(rate_limits, domain ? domain : ""))) {
+        return rate_allow(limit, now);
+    }
+    return TRUE;
+}
+
+static void log_event(const gchar *domain, GLogLevelFlags level, gint64 now,
+                      const gchar *message, gsize message_len)
+{
+    ring_push(get_ring(), level & G_LOG_LEVEL_MASK, now,
+              domain, domain ? strlen(domain) : 0, message, message_len);
+
+    /* GLib aborts when the writer returns */
+    if (is_fatal(level)) {
+        async_log_flush();
+    }
+}
+
+static GLogWriterOutput async_log_writer(GLogLevelFlags log_level,
+                                         const GLogField *fields,
+                                         gsize n_fields,
+                                         gpointer user_data)
+{
+    const gchar *domain = NULL;
+    const gchar *message = NULL;
+    gssize message_len = -1;
+    gint64 now;
+
+    if (!__atomic_load_n(&logger.running, __ATOMIC_ACQUIRE)) {
+        return g_log_writer_default(log_level, fields, n_fields, user_data);
+    }
+
+    for (gsize i = 0; i < n_fields; i++) {
+        if (strcmp(fields[i].key, "GLIB_DOMAIN") == 0) {
+            domain = fields[i].value;
+        } else if (strcmp(fields[i].key, "MESSAGE") == 0) {
+            message = fields[i].value;
+            message_len = fields[i].length;
+        }
+    }
+    if (message == NULL) {
+        return G_LOG_WRITER_HANDLED;
+    }
+
+    now = g_get_real_time();
+    if (admit(domain, log_level, now)) {
+        log_event(domain, log_level, now, message,
+                  message_len < 0 ? strlen(message) : (gsize)message_len);
+    }
+    return G_LOG_WRITER_HANDLED;
+}
+
+void async_log_write(const gchar *domain, GLogLevelFlags level, const gchar *format, ...)
+{
+    va_list args;
+    Ring *ring;
+    gint64 now;
+    gint len;
+
+    if (!__atomic_load_n(&logger.running, __ATOMIC_ACQUIRE)) {
+        va_start(args, format);
+        g_logv(domain, level, format, args);
+        va_end(args);
+        return;
+    }
+
+    now = g_get_real_time();
+    if (!admit(domain, level, now)) {
+        return;
+    }
+
+    ring = get_ring();
+    va_start(args, format);
+    len = g_vsnprintf(ring->scratch, sizeof(ring->scratch), format, args);
+    va_end(args);
+    if (len < 0) {
+        return;
+    }
+    log_event(domain, level, now, ring->scratch, MIN((gsize)len, sizeof(ring->scratch) - 1));
+}
+
+/* ============================================================
+ * Drain thread
+ * ============================================================ */
+
+static void write_all(const gchar *data, gsize len)
+{
+    while (len > 0) {
+        gssize n = write(logger.config.fd, data, len);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;         /* Nowhere left to report it */
+        }
+        __atomic_fetch_add(&logger.writes, 1, __ATOMIC_RELAXED);
+        data += n;
+        len -= n;
+    }
+}
+
+static void writev_all(struct iovec *iov, guint n_iov)
+{
+    while (n_iov > 0) {
+        gssize n = writev(logger.config.fd, iov, MIN(n_iov, IOV_MAX));
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        __atomic_fetch_add(&logger.writes, 1, __ATOMIC_RELAXED);
+        while (n_iov > 0 && (gsize)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            n_iov--;
+        }
+        if (n_iov > 0) {
+            iov->iov_base = (guint8 *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+/* Formats (if @text isn't NULL) and counts the records in a run */
+static guint64 walk_records(const guint8 *data, gsize len, GString *text)
+{
+    guint64 n = 0;
+
+    for (gsize pos = 0; pos < len; pos += ((const guint32 *)(data + pos))[0]) {
+        const AsyncLogRecord *record = (const AsyncLogRecord *)(data + pos);
+
+        if (record->level != 0) {
+            if (text) {
+                async_log_format_record(text, record);
+            }
+            n++;
+        }
+    }
+    return n;
+}
+
+static void add_notice(GString *notices, const gchar *format, ...) G_GNUC_PRINTF(2, 3);
+
+/* Appends one of our own records, in the same encoding as the rings */
+static void add_notice(GString *notices, const gchar *format, ...)
+{
+    gchar message[256];
+    AsyncLogRecord record = { 0 };
+    va_list args;
+    gint len;
+
+    va_start(args, format);
+    len = g_vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    len = CLAMP(len, 0, (gint)sizeof(message) - 1);
+
+    record.size = ALIGN8(sizeof(record) + strlen(NOTICE_DOMAIN) + len);
+    record.level = G_LOG_LEVEL_WARNING;
+    record.time_us = g_get_real_time();
+    record.domain_len = strlen(NOTICE_DOMAIN);
+    record.message_len = len;
+
+    gsize start = notices->len;
+
+    g_string_append_len(notices, (const gchar *)&record, sizeof(record));
+    g_string_append(notices, NOTICE_DOMAIN);
+    g_string_append_len(notices, message, len);
+    while (notices->len < start + record.size) {
+        g_string_append_c(notices, '\0');
+    }
+}
+
+static void collect_notices(GPtrArray *rings, GString *notices)
+{
+    for (guint i = 0; i < rings->len; i++) {
+        Ring *ring = g_ptr_array_index(rings, i);
+        guint64 dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+
+        if (dropped) {
+            __atomic_fetch_add(&logger.dropped, dropped, __ATOMIC_RELAXED);
+            add_notice(notices, "dropped %" G_GUINT64_FORMAT " messages from thread %u: ring full",
+                       dropped, ring->id);
+        }
+    }
+
+    if (rate_limits) {
+        GHashTableIter iter;
+        gpointer value;
+
+        g_hash_table_iter_init(&iter, rate_limits);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            RateLimit *limit = value;
+            guint64 suppressed = __atomic_exchange_n(&limit->suppressed, 0, __ATOMIC_RELAXED);
+
+            if (suppressed) {
+                __atomic_fetch_add(&logger.suppressed, suppressed, __ATOMIC_RELAXED);
+                add_notice(notices, "suppressed %" G_GUINT64_FORMAT " messages in domain '%s'",
+                           suppressed, limit->domain);
+            }
+        }
+    }
+}
+
+/* Writes out everything pending, then frees rings whose thread had
+ * exited before the pass began: nothing can have been added since */
+static void drain_pass(GPtrArray *rings, GString *notices, GString *text, GArray *iov)
+{
+    gboolean binary = logger.config.format == ASYNC_LOG_FORMAT_BINARY;
+    guint64 n = 0;
+
+    g_string_truncate(notices, 0);
+    g_string_truncate(text, 0);
+    g_array_set_size(iov, 0);
+
+    collect_notices(rings, notices);
+    if (binary && notices->len) {
+        struct iovec v = { notices->str, notices->len };
+
+        g_array_append_val(iov, v);
+    }
+    n += walk_records((const guint8 *)notices->str, notices->len, binary ? NULL : text);
+
+    for (guint i = 0; i < rings->len; i++) {
+        Ring *ring = g_ptr_array_index(rings, i);
+        gsize capacity = ring->mask + 1;
+
+        ring->pass_orphaned = __atomic_load_n(&ring->orphaned, __ATOMIC_ACQUIRE);
+        ring->pass_head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+        guint64 tail = ring->tail;
+        gsize first = tail & ring->mask;
+        gsize len = ring->pass_head - tail;
+        gsize run = MIN(len, capacity - first);
+        struct iovec runs[2] = {
+            { ring->data + first, run },
+            { ring->data, len - run }
+        };
+
+        for (guint r = 0; r < 2; r++) {
+            if (runs[r].iov_len == 0) {
+                continue;
+            }
+            n += walk_records(runs[r].iov_base, runs[r].iov_len, binary ? NULL : text);
+            if (binary) {
+                g_array_append_val(iov, runs[r]);
+            }
+        }
+    }
+
+    if (binary) {
+        writev_all((struct iovec *)iov->data, iov->len);
+    } else if (text->len) {
+        write_all(text->str, text->len);
+    }
+    __atomic_fetch_add(&logger.written, n, __ATOMIC_RELAXED);
+
+    for (guint i = 0; i < rings->len; i++) {
+        Ring *ring = g_ptr_array_index(rings, i);
+
+        __atomic_store_n(&ring->tail, ring->pass_head, __ATOMIC_RELEASE);
+    }
+
+    g_mutex_lock(&logger.lock);
+    for (Ring **link = &logger.rings; *link; ) {
+        Ring *ring = *link;
+
+        /* Rings registered after the snapshot haven't been looked at */
+        if (ring->pass_orphaned) {
+            *link = ring->next;
+            g_free(ring->data);
+            free(ring);
+        } else {
+            link = &ring->next;
+        }
+    }
+    g_mutex_unlock(&logger.lock);
+}
+
+static gpointer drain_thread(gpointer data)
+{
+    GPtrArray *rings = g_ptr_array_new();
+    GString *notices = g_string_new(NULL);
+    GString *text = g_string_new(NULL);
+    GArray *iov = g_array_new(FALSE, FALSE, sizeof(struct iovec));
+    gint64 interval_us = (gint64)(logger.config.flush_interval_ms ? logger.config.flush_interval_ms
+                                                                  : DEFAULT_FLUSH_MS) * 1000;
+    gboolean stopping;
+
+    do {
+        g_mutex_lock(&logger.lock);
+        if (!logger.stopping && logger.passes >= logger.flush_until &&
+            !__atomic_load_n(&logger.wake_pending, __ATOMIC_RELAXED)) {
+            g_cond_wait_until(&logger.wake, &logger.lock, g_get_monotonic_time() + interval_us);
+        }
+        stopping = logger.stopping;
+        __atomic_store_n(&logger.wake_pending, FALSE, __ATOMIC_RELAXED);
+        g_ptr_array_set_size(rings, 0);
+        for (Ring *ring = logger.rings; ring; ring = ring->next) {
+            g_ptr_array_add(rings, ring);
+        }
+        g_mutex_unlock(&logger.lock);
+
+        drain_pass(rings, notices, text, iov);
+
+        g_mutex_lock(&logger.lock);
+        logger.passes++;
+        g_cond_broadcast(&logger.drained);
+        g_mutex_unlock(&logger.lock);
+    } while (!stopping);
+
+    g_array_unref(iov);
+    g_string_free(text, TRUE);
+    g_string_free(notices, TRUE);
+    g_ptr_array_unref(rings);
+    return NULL;
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+static void rate_limit_free(gpointer data)
+{
+    RateLimit *limit = data;
+
+    g_free(limit->domain);
+    g_free(limit);
+}
+
+void async_log_set_rate_limit(const gchar *domain, guint per_second, guint burst)
+{
+    RateLimit *limit;
+
+    g_return_if_fail(per_second > 0);
+    g_return_if_fail(!__atomic_load_n(&logger.running, __ATOMIC_ACQUIRE));
+
+    if (rate_limits == NULL) {
+        rate_limits = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, rate_limit_free);
+    }
+
+    limit = g_new0(RateLimit, 1);
+    limit->domain = g_strdup(domain ? domain : "");
+    limit->interval_us = MAX(G_USEC_PER_SEC / per_second, 1);
+    limit->burst_us = (gint64)(MAX(burst, 1) - 1) * limit->interval_us;
+    g_hash_table_replace(rate_limits, limit->domain, limit);
+}
+
+gboolean async_log_start(const AsyncLogConfig *config, GError **error)
+{
+    gsize ring_size;
+
+    g_return_val_if_fail(config != NULL, FALSE);
+    g_return_val_if_fail(config->fd >= 0, FALSE);
+    g_return_val_if_fail(!__atomic_load_n(&logger.running, __ATOMIC_ACQUIRE), FALSE);
+
+    logger.config = *config;
+    ring_size = config->ring_size ? MAX(config->ring_size, MIN_RING_SIZE) : DEFAULT_RING_SIZE;
+    logger.ring_size = 1;
+    while (logger.ring_size < ring_size) {
+        logger.ring_size <<= 1;
+    }
+
+    if (config->format == ASYNC_LOG_FORMAT_BINARY &&
+        write(config->fd, ASYNC_LOG_BINARY_MAGIC, 8) != 8) {
+        gint saved_errno = errno;
+
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                    "Failed to write log header: %s", g_strerror(saved_errno));
+        return FALSE;
+    }
+
+    logger.stopping = FALSE;
+    logger.thread = g_thread_try_new("async-log", drain_thread, NULL, error);
+    if (logger.thread == NULL) {
+        return FALSE;
+    }
+
+    if (!logger.writer_installed) {
+        g_log_set_writer_func(async_log_writer, NULL, NULL);
+        logger.writer_installed = TRUE;
+    }
+    __atomic_store_n(&logger.running, TRUE, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+void async_log_flush(void)
+{
+    if (!__atomic_load_n(&logger.running, __ATOMIC_ACQUIRE) || g_thread_self() == logger.thread) {
+        return;
+    }
+
+    /* The pass in progress may have missed our records; the next won't */
+    g_mutex_lock(&logger.lock);
+    guint64 target = logger.passes + 2;
+
+    logger.flush_until = MAX(logger.flush_until, target);
+    g_cond_signal(&logger.wake);
+    while (logger.passes < target && !logger.stopping) {
+        g_cond_wait(&logger.drained, &logger.lock);
+    }
+    g_mutex_unlock(&logger.lock);
+}
+
+void async_log_stop(void)
+{
+    if (!__atomic_exchange_n(&logger.running, FALSE, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+
+    /* The drain thread makes one last pass after seeing stopping */
+    g_mutex_lock(&logger.lock);
+    logger.stopping = TRUE;
+    g_cond_signal(&logger.wake);
+    g_cond_broadcast(&logger.drained);
+    g_mutex_unlock(&logger.lock);
+
+    g_thread_join(logger.thread);
+    logger.thread = NULL;
+}
+
+void async_log_get_stats(AsyncLogStats *stats)
+{
+    g_return_if_fail(stats != NULL);
+
+    stats->written = __atomic_load_n(&logger.written, __ATOMIC_RELAXED);
+    stats->writes = __atomic_load_n(&logger.writes, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&logger.dropped, __ATOMIC_RELAXED);
+    stats->suppressed = __atomic_load_n(&logger.suppressed, __ATOMIC_RELAXED);
+}
+
+void async_log_format_record(GString *out, const AsyncLogRecord *record)
+{
+    const gchar *domain = (const gchar *)(record + 1);
+    time_t seconds = record->time_us / G_USEC_PER_SEC;
+    gchar stamp[32];
+    struct tm tm;
+
+    g_return_if_fail(out != NULL);
+    g_return_if_fail(record != NULL);
+
+    gmtime_r(&seconds, &tm);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+    g_string_append_printf(out, "%s.%06dZ [%u] %s %.*s%s%.*s\n",
+                           stamp, (gint)(record->time_us % G_USEC_PER_SEC),
+                           record->thread, level_name(record->level),
+                           (gint)record->domain_len, domain,
+                           record->domain_len ? ": " : "",
+                           (gint)record->message_len, domain + record->domain_len);
+}
@@ -0,0 +1,142 @@
+/*
+ * async_log.h - Asynchronous structured logging backend
+ *
+ * my_log_handler() in debugging_example.c formats and prints on the
+ * thread that logged, so a burst of g_debug()/g_message() from workers
+ * turns into a burst of stdio locking and write() calls on those
+ * workers. async_log installs a g_log_set_writer_func() writer that
+ * only copies the message:
+ *
+ *   - each thread appends records to its own single-producer ring, with
+ *     no lock and no allocation; a full ring drops the record and
+ *     counts it instead of blocking
+ *   - a background thread drains every ring each flush interval (or
+ *     sooner if a ring fills past half) and writes the batch with one
+ *     write()/writev() call: as text lines, or in binary mode as the
+ *     raw records, which async_log_decode turns into text offline
+ *   - per-domain rate limits (a token bucket, updated with one CAS)
+ *     drop excess messages and report how many were suppressed
+ *   - async_log_debug() and friends format into a per-thread buffer
+ *     rather than a fresh allocation, and compile to nothing for levels
+ *     above ASYNC_LOG_MAX_LEVEL
+ *
+ * Timestamps are taken when logging; everything else about the text,
+ * including the timestamp's formatting, happens on the drain thread.
+ * Each thread's messages stay in order; messages from different
+ * threads are ordered only by their timestamps.
+ *
+ * GLib allows one writer function per process. Once installed it stays:
+ * after async_log_stop() it forwards to g_log_writer_default().
+ */
+
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Levels as log2 of their GLogLevelFlags, for the preprocessor */
+#define ASYNC_LOG_LEVEL_ERROR 2
+#define ASYNC_LOG_LEVEL_CRITICAL 3
+#define ASYNC_LOG_LEVEL_WARNING 4
+#define ASYNC_LOG_LEVEL_MESSAGE 5
+#define ASYNC_LOG_LEVEL_INFO 6
+#define ASYNC_LOG_LEVEL_DEBUG 7
+
+/* Define before including to compile out less severe levels, e.g.
+ * -DASYNC_LOG_MAX_LEVEL=ASYNC_LOG_LEVEL_MESSAGE drops debug and info.
+ * Their arguments are not evaluated. */
+#ifndef ASYNC_LOG_MAX_LEVEL
+#define ASYNC_LOG_MAX_LEVEL ASYNC_LOG_LEVEL_DEBUG
+#endif
+
+#define ASYNC_LOG_MAX_MESSAGE 1023
+#define ASYNC_LOG_BINARY_MAGIC "GLIBLOG1"      /* First 8 bytes of a binary log */
+
+typedef enum {
+    ASYNC_LOG_FORMAT_TEXT,
+    ASYNC_LOG_FORMAT_BINARY
+} AsyncLogFormat;
+
+typedef struct {
+    gint fd;                         /* Not closed by async_log_stop() */
+    AsyncLogFormat format;
+    gsize ring_size;                 /* Per thread, rounded up to a power of two; 0 = 256 KB */
+    guint flush_interval_ms;         /* 0 = 10 */
+    GLogLevelFlags levels;           /* Levels written; 0 = all */
+} AsyncLogConfig;
+
+/* The binary format: a record header, then domain_len bytes of domain
+ * and message_len bytes of message, padded to 8 bytes. Host byte order.
+ * Padding records can be as short as 8 bytes: read size and level
+ * before the rest. */
+typedef struct {
+    guint32 size;                    /* Whole record, padding included */
+    guint32 level;                   /* GLogLevelFlags; 0 = padding: skip size bytes */
+    gint64 time_us;                  /* g_get_real_time() */
+    guint32 thread;                  /* From 1, in order of first message; 0 = async_log */
+    guint16 domain_len;
+    guint16 reserved;
+    guint32 message_len;
+    guint32 reserved2;
+} AsyncLogRecord;
+
+typedef struct {
+    guint64 written;                 /* Records handed to write() */
+    guint64 dropped;                 /* Ring full */
+    guint64 suppressed;              /* Rate limited */
+    guint64 writes;                  /* write()/writev() calls */
+} AsyncLogStats;
+
+/* Limits @domain (NULL = messages without one) to @per_second, with
+ * bursts of up to @burst. Call before async_log_start(). */
+void async_log_set_rate_limit(const gchar *domain, guint per_second, guint burst);
+
+/* Installs the writer and starts the drain thread. In binary mode the
+ * magic is written first. */
+gboolean async_log_start(const AsyncLogConfig *config, GError **error);
+
+/* Blocks until everything logged before the call has been written */
+void async_log_flush(void);
+
+/* Flushes and stops the drain thread */
+void async_log_stop(void);
+
+void async_log_get_stats(AsyncLogStats *stats);
+
+/* Like g_log(), without GLib's allocation of the formatted message.
+ * Messages longer than ASYNC_LOG_MAX_MESSAGE bytes are truncated. */
+void async_log_write(const gchar *domain, GLogLevelFlags level,
+                     const gchar *format, ...) G_GNUC_PRINTF(3, 4);
+
+/* Appends @record as one line of text, as the text format writes it */
+void async_log_format_record(GString *out, const AsyncLogRecord *record);
+
+#if ASYNC_LOG_MAX_LEVEL >= ASYNC_LOG_LEVEL_DEBUG
+#define async_log_debug(...) async_log_write(G_LOG_DOMAIN, G_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define async_log_debug(...) G_STMT_START { } G_STMT_END
+#endif
+
+#if ASYNC_LOG_MAX_LEVEL >= ASYNC_LOG_LEVEL_INFO
+#define async_log_info(...) async_log_write(G_LOG_DOMAIN, G_LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define async_log_info(...) G_STMT_START { } G_STMT_END
+#endif
+
+#if ASYNC_LOG_MAX_LEVEL >= ASYNC_LOG_LEVEL_MESSAGE
+#define async_log_message(...) async_log_write(G_LOG_DOMAIN, G_LOG_LEVEL_MESSAGE, __VA_ARGS__)
+#else
+#define async_log_message(...) G_STMT_START { } G_STMT_END
+#endif
+
+#if ASYNC_LOG_MAX_LEVEL >= ASYNC_LOG_LEVEL_WARNING
+#define async_log_warning(...) async_log_write(G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, __VA_ARGS__)
+#else
+#define async_log_warning(...) G_STMT_START { } G_STMT_END
+#endif
+
+G_END_DECLS
+
+#endif /* ASYNC_LOG_H */
@@ -0,0 +1,305 @@
+/*
+ * async_log_benchmark.c - Synchronous log handler vs async_log
+ *
+ * N_THREADS threads log to a temporary file:
+ *
+ *   - sync: a g_log_set_handler() handler like debugging_example.c's,
+ *     formatting and write()ing each message on the calling thread
+ *   - g_message: plain g_log() calls going through the async_log writer
+ *     (GLib still formats and allocates the message; the write moves to
+ *     the drain thread)
+ *   - async_log_message: the same, formatted into the thread's buffer
+ *
+ * Each is a bench_run_ops() case where one iteration is one message
+ * from every thread, so the time is what the logging threads see; the
+ * drain thread's flush at async_log_stop() is timed separately. The file
+ * is opened O_APPEND and truncated at the start of each timed call, so
+ * it holds one call's worth however long calibration runs. Then a
+ * rate-limited domain, and binary mode: timed the same way, then
+ * CHECK_MESSAGES per thread written in one go, read back and counted.
+ *
+ * Usage: ./async_log_benchmark [--bench-...]
+ */
+
+#include "bench.h"
+#include "async_log.h"
+
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_DOMAIN "Bench"
+#define N_THREADS 4
+#define CHECK_MESSAGES 5000          /* Per thread: fits the ring, so none drop */
+
+typedef enum {
+    MODE_SYNC,
+    MODE_G_MESSAGE,
+    MODE_ASYNC_LOG
+} Mode;
+
+static const gchar *mode_names[] = { "sync handler", "g_message", "async_log_message" };
+
+typedef struct {
+    Mode mode;
+    guint64 messages;
+    guint id;
+} Worker;
+
+typedef struct {
+    Mode mode;
+    gint fd;
+    const gchar *path;
+} Run;
+
+static void sync_handler(const gchar *log_domain, GLogLevelFlags log_level,
+                         const gchar *message, gpointer user_data)
+{
+    gint fd = GPOINTER_TO_INT(user_data);
+    GDateTime *now = g_date_time_new_now_utc();
+    gchar *stamp = g_date_time_format(now, "%Y-%m-%d %H:%M:%S.%f");
+    gchar *line = g_strdup_printf("%sZ MESSAGE %s: %s\n", stamp, log_domain, message);
+
+    if (write(fd, line, strlen(line)) < 0) {
+        g_printerr("write failed: %s\n", g_strerror(errno));
+    }
+    g_free(line);
+    g_free(stamp);
+    g_date_time_unref(now);
+}
+
+static gpointer worker_thread(gpointer data)
+{
+    Worker *worker = data;
+
+    for (guint64 i = 0; i < worker->messages; i++) {
+        switch (worker->mode) {
+        case MODE_SYNC:
+            g_log("Sync", G_LOG_LEVEL_MESSAGE, "worker %u request %u done in %d us",
+                  worker->id, (guint)i, (gint)(i % 977));
+            break;
+        case MODE_G_MESSAGE:
+            g_log(BENCH_DOMAIN, G_LOG_LEVEL_MESSAGE, "worker %u request %u done in %d us",
+                  worker->id, (guint)i, (gint)(i % 977));
+            break;
+        case MODE_ASYNC_LOG:
+            async_log_write(BENCH_DOMAIN, G_LOG_LEVEL_MESSAGE,
+                            "worker %u request %u done in %d us", worker->id, (guint)i, (gint)(i % 977));
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void run_workers(Mode mode, guint64 messages)
+{
+    GThread *threads[N_THREADS];
+    Worker workers[N_THREADS];
+
+    for (guint t = 0; t < N_THREADS; t++) {
+        workers[t] = (Worker){ mode, messages, t };
+        threads[t] = g_thread_new("logger", worker_thread, &workers[t]);
+    }
+    for (guint t = 0; t < N_THREADS; t++) {
+        g_thread_join(threads[t]);
+    }
+}
+
+/* Appending, so that truncating it doesn't leave the writer's offset
+ * past the end */
+static gint open_temp(gchar **path)
+{
+    GError *error = NULL;
+    gint fd = g_file_open_tmp("async-log-XXXXXX", path, &error);
+
+    if (fd < 0) {
+        g_error("Failed to create a temporary file: %s", error->message);
+    }
+    if (fcntl(fd, F_SETFL, O_APPEND) < 0) {
+        g_error("Failed to set O_APPEND on %s: %s", *path, g_strerror(errno));
+    }
+    return fd;
+}
+
+static void truncate_temp(gint fd, const gchar *path)
+{
+    if (ftruncate(fd, 0) < 0) {
+        g_error("Failed to reset %s: %s", path, g_strerror(errno));
+    }
+}
+
+static off_t file_size(gint fd)
+{
+    return lseek(fd, 0, SEEK_END);
+}
+
+static void log_bench(guint64 iterations, gpointer user_data)
+{
+    Run *run = user_data;
+
+    truncate_temp(run->fd, run->path);
+    run_workers(run->mode, iterations);
+}
+
+/* Prints what the drain thread did for the messages since @before */
+static void print_drain(gdouble flush_ms, const AsyncLogStats *before)
+{
+    AsyncLogStats after;
+
+    async_log_get_stats(&after);
+    g_print("  flush %.1f ms; %" G_GUINT64_FORMAT " written in %" G_GUINT64_FORMAT
+            " write() calls, %" G_GUINT64_FORMAT " dropped (ring full)\n", flush_ms,
+            after.written - before->written, after.writes - before->writes,
+            after.dropped - before->dropped);
+}
+
+static void compare(Bench *bench)
+{
+    gchar *path;
+    gint fd = open_temp(&path);
+    guint handler = g_log_set_handler("Sync", G_LOG_LEVEL_MASK, sync_handler, GINT_TO_POINTER(fd));
+    Run run = { .mode = MODE_SYNC, .fd = fd, .path = path };
+    GError *error = NULL;
+
+    g_print("%d threads, to %s, time per message\n", N_THREADS, path);
+
+    bench_run_ops(bench, mode_names[MODE_SYNC], N_THREADS, log_bench, &run);
+    g_log_remove_handler("Sync", handler);
+
+    for (Mode mode = MODE_G_MESSAGE; mode <= MODE_ASYNC_LOG; mode++) {
+        AsyncLogConfig config = { .fd = fd, .ring_size = 1024 * 1024 };
+        AsyncLogStats before;
+
+        truncate_temp(fd, path);
+        async_log_get_stats(&before);
+        if (!async_log_start(&config, &error)) {
+            g_error("async_log_start: %s", error->message);
+        }
+
+        run.mode = mode;
+        bench_run_ops(bench, mode_names[mode], N_THREADS, log_bench, &run);
+
+        gint64 start = g_get_monotonic_time();
+
+        async_log_stop();
+        print_drain((g_get_monotonic_time() - start) / 1e3, &before);
+    }
+
+    close(fd);
+    g_unlink(path);
+    g_free(path);
+}
+
+static void rate_limited(void)
+{
+    gchar *path;
+    gint fd = open_temp(&path);
+    AsyncLogConfig config = { .fd = fd };
+    AsyncLogStats before, after;
+    GError *error = NULL;
+
+    g_print("\nRate limit: 'Noisy' at 100/s, burst 10, logging 10000 at once\n");
+    async_log_set_rate_limit("Noisy", 100, 10);
+    async_log_get_stats(&before);
+    if (!async_log_start(&config, &error)) {
+        g_error("async_log_start: %s", error->message);
+    }
+    for (guint i = 0; i < 10000; i++) {
+        g_log("Noisy", G_LOG_LEVEL_WARNING, "retrying connection (%u)", i);
+    }
+    async_log_stop();
+    async_log_get_stats(&after);
+
+    g_print("  %" G_GUINT64_FORMAT " written (including the notice), %" G_GUINT64_FORMAT
+            " suppressed\n", after.written - before.written, after.suppressed - before.suppressed);
+
+    close(fd);
+    g_unlink(path);
+    g_free(path);
+}
+
+/* Counts the records in a binary log, as async_log_decode reads them */
+static guint64 count_binary(const gchar *path)
+{
+    gchar *contents;
+    gsize len;
+    guint64 n = 0;
+
+    if (!g_file_get_contents(path, &contents, &len, NULL) ||
+        len < 8 || memcmp(contents, ASYNC_LOG_BINARY_MAGIC, 8) != 0) {
+        return 0;
+    }
+    for (gsize pos = 8; pos + 8 <= len; ) {
+        const guint32 *head = (const guint32 *)(contents + pos);
+
+        if (head[0] == 0) {
+            break;
+        }
+        n += (head[1] != 0);
+        pos += head[0];
+    }
+    g_free(contents);
+    return n;
+}
+
+static void binary(Bench *bench)
+{
+    gchar *path;
+    gint fd = open_temp(&path);
+    AsyncLogConfig config = { .fd = fd, .format = ASYNC_LOG_FORMAT_BINARY, .ring_size = 1024 * 1024 };
+    Run run = { .mode = MODE_ASYNC_LOG, .fd = fd, .path = path };
+    AsyncLogStats before, after;
+    GError *error = NULL;
+
+    g_print("\nBinary mode\n");
+    async_log_get_stats(&before);
+    if (!async_log_start(&config, &error)) {
+        g_error("async_log_start: %s", error->message);
+    }
+    bench_run_ops(bench, "async_log_message binary", N_THREADS, log_bench, &run);
+
+    gint64 start = g_get_monotonic_time();
+
+    async_log_stop();
+    print_drain((g_get_monotonic_time() - start) / 1e3, &before);
+
+    /* The timed calls truncated the magic away: a fresh file to read back */
+    truncate_temp(fd, path);
+    async_log_get_stats(&before);
+    if (!async_log_start(&config, &error)) {
+        g_error("async_log_start: %s", error->message);
+    }
+    run_workers(MODE_ASYNC_LOG, CHECK_MESSAGES);
+    async_log_stop();
+    async_log_get_stats(&after);
+
+    g_print("  %d x %d messages: %.2f MB; %" G_GUINT64_FORMAT " records read back, %"
+            G_GUINT64_FORMAT " written\n", N_THREADS, CHECK_MESSAGES, file_size(fd) / 1e6,
+            count_binary(path), after.written - before.written);
+
+    close(fd);
+    g_unlink(path);
+    g_free(path);
+}
+
+int main(int argc, char *argv[])
+{
+    Bench *bench = bench_new("async_log_benchmark", &argc, &argv);
+
+    g_print("=== Async Log Benchmark ===\n\n");
+
+    compare(bench);
+    rate_limited();
+    binary(bench);
+
+    g_print("\n=== Key Points ===\n");
+    g_print("- Logging threads only copy into their own ring: no lock, no syscall\n");
+    g_print("- One drain thread turns thousands of messages into a few write() calls\n");
+    g_print("- A full ring drops and counts rather than stalling the caller\n");
+    g_print("- Binary records skip formatting entirely; decode them offline\n");
+
+    bench_free(bench);
+    return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * async_log_decode.c - Turns a binary async_log file into text
+ *
+ * Prints each record the way the text format would have, skipping
+ * padding records. A log cut off mid-record (the process died before
+ * the drain thread finished a write) decodes up to the last whole one.
+ *
+ * Usage: ./async_log_decode FILE
+ */
+
+#include "async_log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+int main(int argc, char *argv[])
+{
+    GError *error = NULL;
+    GString *line = g_string_new(NULL);
+    gchar *contents;
+    gsize len, pos;
+    guint64 n = 0;
+
+    if (argc != 2) {
+        g_printerr("Usage: %s FILE\n", argv[0]);
+        return 2;
+    }
+    if (!g_file_get_contents(argv[1], &contents, &len, &error)) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+    if (len < 8 || memcmp(contents, ASYNC_LOG_BINARY_MAGIC, 8) != 0) {
+        g_printerr("%s: not a binary async_log file\n", argv[1]);
+        g_free(contents);
+        return 1;
+    }
+
+    /* Records are 8-byte aligned in the file as in the rings, and
+     * g_file_get_contents() returns malloc memory, so they can be read
+     * in place */
+    for (pos = 8; pos + 8 <= len; ) {
+        const guint32 *head = (const guint32 *)(contents + pos);
+        const AsyncLogRecord *record = (const AsyncLogRecord *)head;
+
+        if (head[0] < 8 || head[0] % 8 != 0 || pos + head[0] > len) {
+            break;
+        }
+        if (head[1] != 0) {
+            /* Only size and level are known to be there until the header
+             * fits, and a corrupt message_len must not wrap the sum */
+            if (head[0] < sizeof(AsyncLogRecord) ||
+                head[0] < sizeof(AsyncLogRecord) + (gsize)record->domain_len +
+                          (gsize)record->message_len) {
+                break;
+            }
+            g_string_truncate(line, 0);
+            async_log_format_record(line, record);
+            fwrite(line->str, 1, line->len, stdout);
+            n++;
+        }
+        pos += head[0];
+    }
+
+    if (pos < len) {
+        g_printerr("%s: stopped at byte %" G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT
+                   " (truncated or corrupt)\n", argv[1], pos, len);
+    }
+    g_printerr("%" G_GUINT64_FORMAT " records\n", n);
+
+    g_string_free(line, TRUE);
+    g_free(contents);
+    return pos < len;
+}
@@ -0,0 +1,676 @@
+/*
+ * btree.c - Cache-dense ordered map (B+ tree)
+ *
+ * See btree.h for the API. Invariants:
+ *   - every node but the root holds MIN_KEYS..BTREE_MAX_KEYS keys
+ *   - internal node keys[i] is the smallest key under children[i + 1].
+ *     It is the same pointer as the first key of that subtree's leftmost
+ *     leaf, so a separator never outlives its key: removing a leaf's
+ *     first key rewrites the one separator that pointed at it
+ *   - leaves are linked left to right
+ *
+ * Inserts split full nodes on the way back up. Removes borrow from a
+ * sibling, or merge with one, on the way back up. Both remember the
+ * path from the root, so nodes need no parent pointers.
+ */
+
+#include "btree.h"
+
+#include <string.h>
+
+#define MIN_KEYS (BTREE_MAX_KEYS / 2)
+#define MAX_HEIGHT 32
+#define NODE_ALIGN 64
+
+typedef struct {
+    guint32 n_keys;
+    guint32 is_leaf;
+    gpointer keys[BTREE_MAX_KEYS];   /* Header + keys = 128 bytes: two cache lines */
+} BTreeNode;
+
+struct _BTreeLeaf {
+    BTreeNode base;
+    gpointer values[BTREE_MAX_KEYS];
+    BTreeLeaf *next;
+};
+
+typedef struct {
+    BTreeNode base;
+    BTreeNode *children[BTREE_MAX_KEYS + 1];
+} BTreeInternal;
+
+struct _BTree {
+    BTreeNode *root;                 /* NULL while empty */
+    gsize size;
+    guint height;
+    GCompareDataFunc key_compare;
+    gpointer key_compare_data;
+    GDestroyNotify key_destroy_func;
+    GDestroyNotify value_destroy_func;
+};
+
+#define LEAF(node) ((BTreeLeaf *)(node))
+#define INTERNAL(node) ((BTreeInternal *)(node))
+
+static inline gint compare_keys(BTree *tree, gconstpointer a, gconstpointer b)
+{
+    if (tree->key_compare == NULL) {
+        gintptr x = (gintptr)a, y = (gintptr)b;
+        return (x > y) - (x < y);
+    }
+    return tree->key_compare(a, b, tree->key_compare_data);
+}
+
+/* First index whose key is >= @key (or > @key if @upper) */
+static inline guint node_search(BTree *tree, BTreeNode *node, gconstpointer key, gboolean upper)
+{
+    guint lo = 0, hi = node->n_keys;
+
+    while (lo < hi) {
+        guint mid = (lo + hi) / 2;
+        gint cmp = compare_keys(tree, node->keys[mid], key);
+
+        if (cmp < 0 || (upper && cmp == 0)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static BTreeNode *node_new(gboolean is_leaf)
+{
+    gsize size = is_leaf ? sizeof(BTreeLeaf) : sizeof(BTreeInternal);
+    BTreeNode *node = g_aligned_alloc0(1, size, NODE_ALIGN);
+
+    node->is_leaf = is_leaf;
+    return node;
+}
+
+static void node_free_recursive(BTree *tree, BTreeNode *node)
+{
+    if (node->is_leaf) {
+        for (guint i = 0; i < node->n_keys; i++) {
+            if (tree->key_destroy_func) {
+                tree->key_destroy_func(node->keys[i]);
+            }
+            if (tree->value_destroy_func) {
+                tree->value_destroy_func(LEAF(node)->values[i]);
+            }
+        }
+    } else {
+        for (guint i = 0; i <= node->n_keys; i++) {
+            node_free_recursive(tree, INTERNAL(node)->children[i]);
+        }
+    }
+    g_aligned_free(node);
+}
+
+static BTreeLeaf *leftmost_leaf(BTreeNode *node)
+{
+    while (!node->is_leaf) {
+        node = INTERNAL(node)->children[0];
+    }
+    return LEAF(node);
+}
+
+/* ============================================================
+ * Insert
+ * ============================================================ */
+
+/* Insert at @i into a full leaf by splitting it; returns the new right
+ * half, whose first key becomes the separator */
+static BTreeNode *leaf_split_insert(BTreeLeaf *leaf, guint i, gpointer key, gpointer value)
+{
+    gpointer keys[BTREE_MAX_KEYS + 1], values[BTREE_MAX_KEYS + 1];
+    BTreeLeaf *right = LEAF(node_new(TRUE));
+    guint total = BTREE_MAX_KEYS + 1, left_n = total / 2;
+
+    memcpy(keys, leaf->base.keys, i * sizeof(gpointer));
+    memcpy(values, leaf->values, i * sizeof(gpointer));
+    keys[i] = key;
+    values[i] = value;
+    memcpy(keys + i + 1, leaf->base.keys + i, (BTREE_MAX_KEYS - i) * sizeof(gpointer));
+    memcpy(values + i + 1, leaf->values + i, (BTREE_MAX_KEYS - i) * sizeof(gpointer));
+
+    memcpy(leaf->base.keys, keys, left_n * sizeof(gpointer));
+    memcpy(leaf->values, values, left_n * sizeof(gpointer));
+    leaf->base.n_keys = left_n;
+    memcpy(right->base.keys, keys + left_n, (total - left_n) * sizeof(gpointer));
+    memcpy(right->values, values + left_n, (total - left_n) * sizeof(gpointer));
+    right->base.n_keys = total - left_n;
+
+    right->next = leaf->next;
+    leaf->next = right;
+    return &right->base;
+}
+
+/* Insert separator @sep and its right child at @i into a full internal
+ * node by splitting it; the middle key moves up into *@sep */
+static BTreeNode *internal_split_insert(BTreeInternal *node, guint i, gpointer *sep, BTreeNode *child)
+{
+    gpointer keys[BTREE_MAX_KEYS + 1];
+    BTreeNode *children[BTREE_MAX_KEYS + 2];
+    BTreeInternal *right = INTERNAL(node_new(FALSE));
+    guint total = BTREE_MAX_KEYS + 1, left_n = total / 2, right_n = total - left_n - 1;
+
+    memcpy(keys, node->base.keys, i * sizeof(gpointer));
+    keys[i] = *sep;
+    memcpy(keys + i + 1, node->base.keys + i, (BTREE_MAX_KEYS - i) * sizeof(gpointer));
+    memcpy(children, node->children, (i + 1) * sizeof(BTreeNode *));
+    children[i + 1] = child;
+    memcpy(children + i + 2, node->children + i + 1, (BTREE_MAX_KEYS - i) * sizeof(BTreeNode *));
+
+    memcpy(node->base.keys, keys, left_n * sizeof(gpointer));
+    memcpy(node->children, children, (left_n + 1) * sizeof(BTreeNode *));
+    node->base.n_keys = left_n;
+    *sep = keys[left_n];
+    memcpy(right->base.keys, keys + left_n + 1, right_n * sizeof(gpointer));
+    memcpy(right->children, children + left_n + 1, (right_n + 1) * sizeof(BTreeNode *));
+    right->base.n_keys = right_n;
+    return &right->base;
+}
+
+static void insert_internal(BTree *tree, gpointer key, gpointer value, gboolean replace_key)
+{
+    BTreeInternal *path[MAX_HEIGHT];
+    guint path_index[MAX_HEIGHT];
+    guint depth = 0;
+    BTreeNode *node = tree->root;
+
+    if (node == NULL) {
+        node = tree->root = node_new(TRUE);
+        tree->height = 1;
+    }
+
+    while (!node->is_leaf) {
+        guint c = node_search(tree, node, key, TRUE);
+
+        path[depth] = INTERNAL(node);
+        path_index[depth++] = c;
+        node = INTERNAL(node)->children[c];
+    }
+
+    BTreeLeaf *leaf = LEAF(node);
+    guint i = node_search(tree, node, key, FALSE);
+
+    if (i < node->n_keys && compare_keys(tree, node->keys[i], key) == 0) {
+        if (replace_key) {
+            /* A separator may point at the old key: give it the new one */
+            for (guint d = 0; d < depth; d++) {
+                guint c = path_index[d];
+                if (c > 0 && path[d]->base.keys[c - 1] == node->keys[i]) {
+                    path[d]->base.keys[c - 1] = key;
+                }
+            }
+            if (tree->key_destroy_func) {
+                tree->key_destroy_func(node->keys[i]);
+            }
+            node->keys[i] = key;
+        } else if (tree->key_destroy_func) {
+            tree->key_destroy_func(key);
+        }
+        if (tree->value_destroy_func) {
+            tree->value_destroy_func(leaf->values[i]);
+        }
+        leaf->values[i] = value;
+        return;
+    }
+
+    tree->size++;
+
+    if (node->n_keys < BTREE_MAX_KEYS) {
+        memmove(node->keys + i + 1, node->keys + i, (node->n_keys - i) * sizeof(gpointer));
+        memmove(leaf->values + i + 1, leaf->values + i, (node->n_keys - i) * sizeof(gpointer));
+        node->keys[i] = key;
+        leaf->values[i] = value;
+        node->n_keys++;
+        return;
+    }
+
+    BTreeNode *split = leaf_split_insert(leaf, i, key, value);
+    gpointer sep = split->keys[0];
+
+    while (depth > 0) {
+        BTreeInternal *parent = path[--depth];
+        guint c = path_index[depth];
+
+        if (parent->base.n_keys < BTREE_MAX_KEYS) {
+            guint n = parent->base.n_keys;
+
+            memmove(parent->base.keys + c + 1, parent->base.keys + c, (n - c) * sizeof(gpointer));
+            memmove(parent->children + c + 2, parent->children + c + 1, (n - c) * sizeof(BTreeNode *));
+            parent->base.keys[c] = sep;
+            parent->children[c + 1] = split;
+            parent->base.n_keys++;
+            return;
+        }
+        split = internal_split_insert(parent, c, &sep, split);
+    }
+
+    /* The root split: grow a level */
+    BTreeInternal *root = INTERNAL(node_new(FALSE));
+
+    root->base.keys[0] = sep;
+    root->base.n_keys = 1;
+    root->children[0] = tree->root;
+    root->children[1] = split;
+    tree->root = &root->base;
+    tree->height++;
+}
+
+/* ============================================================
+ * Remove
+ * ============================================================ */
+
+/* @node (child @c of @parent) has MIN_KEYS - 1 keys: borrow a key from
+ * a sibling that can spare one, or merge with a sibling */
+static void rebalance(BTreeInternal *parent, guint c)
+{
+    BTreeNode *node = parent->children[c];
+    BTreeNode *left = (c > 0) ? parent->children[c - 1] : NULL;
+    BTreeNode *right = (c < parent->base.n_keys) ? parent->children[c + 1] : NULL;
+
+    if (left && left->n_keys > MIN_KEYS) {
+        memmove(node->keys + 1, node->keys, node->n_keys * sizeof(gpointer));
+        if (node->is_leaf) {
+            memmove(LEAF(node)->values + 1, LEAF(node)->values, node->n_keys * sizeof(gpointer));
+            node->keys[0] = left->keys[left->n_keys - 1];
+            LEAF(node)->values[0] = LEAF(left)->values[left->n_keys - 1];
+            parent->base.keys[c - 1] = node->keys[0];
+        } else {
+            memmove(INTERNAL(node)->children + 1, INTERNAL(node)->children,
+                    (node->n_keys + 1) * sizeof(BTreeNode *));
+            node->keys[0] = parent->base.keys[c - 1];
+            INTERNAL(node)->children[0] = INTERNAL(left)->children[left->n_keys];
+            parent->base.keys[c - 1] = left->keys[left->n_keys - 1];
+        }
+        left->n_keys--;
+        node->n_keys++;
+        return;
+    }
+
+    if (right && right->n_keys > MIN_KEYS) {
+        if (node->is_leaf) {
+            node->keys[node->n_keys] = right->keys[0];
+            LEAF(node)->values[node->n_keys] = LEAF(right)->values[0];
+            memmove(LEAF(right)->values, LEAF(right)->values + 1, (right->n_keys - 1) * sizeof(gpointer));
+            memmove(right->keys, right->keys + 1, (right->n_keys - 1) * sizeof(gpointer));
+            parent->base.keys[c] = right->keys[0];
+        } else {
+            node->keys[node->n_keys] = parent->base.keys[c];
+            INTERNAL(node)->children[node->n_keys + 1] = INTERNAL(right)->children[0];
+            parent->base.keys[c] = right->keys[0];
+            memmove(right->keys, right->keys + 1, (right->n_keys - 1) * sizeof(gpointer));
+            memmove(INTERNAL(right)->children, INTERNAL(right)->children + 1,
+                    right->n_keys * sizeof(BTreeNode *));
+        }
+        right->n_keys--;
+        node->n_keys++;
+        return;
+    }
+
+    /* Merge the pair (left, right) = (c - 1, c) or (c, c + 1) into left */
+    guint sep_index = left ? c - 1 : c;
+    BTreeNode *dst = left ? left : node;
+    BTreeNode *src = left ? node : right;
+
+    if (dst->is_leaf) {
+        memcpy(dst->keys + dst->n_keys, src->keys, src->n_keys * sizeof(gpointer));
+        memcpy(LEAF(dst)->values + dst->n_keys, LEAF(src)->values, src->n_keys * sizeof(gpointer));
+        dst->n_keys += src->n_keys;
+        LEAF(dst)->next = LEAF(src)->next;
+    } else {
+        dst->keys[dst->n_keys] = parent->base.keys[sep_index];
+        memcpy(dst->keys + dst->n_keys + 1, src->keys, src->n_keys * sizeof(gpointer));
+        memcpy(INTERNAL(dst)->children + dst->n_keys + 1, INTERNAL(src)->children,
+               (src->n_keys + 1) * sizeof(BTreeNode *));
+        dst->n_keys += src->n_keys + 1;
+    }
+    g_aligned_free(src);
+
+    memmove(parent->base.keys + sep_index, parent->base.keys + sep_index + 1,
+            (parent->base.n_keys - sep_index - 1) * sizeof(gpointer));
+    memmove(parent->children + sep_index + 1, parent->children + sep_index + 2,
+            (parent->base.n_keys - sep_index - 1) * sizeof(BTreeNode *));
+    parent->base.n_keys--;
+}
+
+static gboolean remove_internal(BTree *tree, gconstpointer key, gboolean notify)
+{
+    BTreeInternal *path[MAX_HEIGHT];
+    guint path_index[MAX_HEIGHT];
+    guint depth = 0;
+    BTreeNode *node = tree->root;
+    gpointer *separator = NULL;
+
+    if (node == NULL) {
+        return FALSE;
+    }
+
+    while (!node->is_leaf) {
+        guint c = node_search(tree, node, key, TRUE);
+
+        if (c > 0 && compare_keys(tree, node->keys[c - 1], key) == 0) {
+            separator = &node->keys[c - 1];
+        }
+        path[depth] = INTERNAL(node);
+        path_index[depth++] = c;
+        node = INTERNAL(node)->children[c];
+    }
+
+    BTreeLeaf *leaf = LEAF(node);
+    guint i = node_search(tree, node, key, FALSE);
+
+    if (i >= node->n_keys || compare_keys(tree, node->keys[i], key) != 0) {
+        return FALSE;
+    }
+
+    if (notify) {
+        if (tree->key_destroy_func) {
+            tree->key_destroy_func(node->keys[i]);
+        }
+        if (tree->value_destroy_func) {
+            tree->value_destroy_func(leaf->values[i]);
+        }
+    }
+
+    memmove(node->keys + i, node->keys + i + 1, (node->n_keys - i - 1) * sizeof(gpointer));
+    memmove(leaf->values + i, leaf->values + i + 1, (node->n_keys - i - 1) * sizeof(gpointer));
+    node->n_keys--;
+    tree->size--;
+
+    /* Only a non-root leaf's first key is ever a separator, and such a
+     * leaf keeps at least MIN_KEYS - 1 >= 1 keys here */
+    if (separator) {
+        *separator = node->keys[0];
+    }
+
+    while (depth > 0 && node->n_keys < MIN_KEYS) {
+        BTreeInternal *parent = path[--depth];
+
+        rebalance(parent, path_index[depth]);
+        node = &parent->base;
+    }
+
+    /* Shrink the tree when the root runs out of keys */
+    if (tree->root->n_keys == 0) {
+        BTreeNode *old_root = tree->root;
+
+        if (old_root->is_leaf) {
+            tree->root = NULL;
+            tree->height = 0;
+        } else {
+            tree->root = INTERNAL(old_root)->children[0];
+            tree->height--;
+        }
+        g_aligned_free(old_root);
+    }
+    return TRUE;
+}
+
+/* ============================================================
+ * Bulk load
+ * ============================================================ */
+
+gboolean btree_bulk_load(BTree *tree, gpointer *keys, gpointer *values, gsize n)
+{
+    g_return_val_if_fail(tree->root == NULL, FALSE);
+
+    for (gsize i = 1; i < n; i++) {
+        if (compare_keys(tree, keys[i - 1], keys[i]) >= 0) {
+            g_critical("btree_bulk_load: keys are not strictly ascending at %" G_GSIZE_FORMAT, i);
+            return FALSE;
+        }
+    }
+    if (n == 0) {
+        return TRUE;
+    }
+
+    /* Leaves: n keys spread evenly over the fewest full-ish leaves. With
+     * two or more, each gets more than BTREE_MAX_KEYS / 2. */
+    gsize n_nodes = (n + BTREE_MAX_KEYS - 1) / BTREE_MAX_KEYS;
+    BTreeNode **level = g_new(BTreeNode *, n_nodes);
+    gpointer *mins = g_new(gpointer, n_nodes);
+    BTreeLeaf *prev = NULL;
+    gsize pos = 0;
+
+    for (gsize j = 0; j < n_nodes; j++) {
+        guint count = n / n_nodes + (j < n % n_nodes);
+        BTreeLeaf *leaf = LEAF(node_new(TRUE));
+
+        memcpy(leaf->base.keys, keys + pos, count * sizeof(gpointer));
+        if (values) {
+            memcpy(leaf->values, values + pos, count * sizeof(gpointer));
+        }
+        leaf->base.n_keys = count;
+        if (prev) {
+            prev->next = leaf;
+        }
+        prev = leaf;
+        level[j] = &leaf->base;
+        mins[j] = keys[pos];
+        pos += count;
+    }
+    tree->height = 1;
+
+    /* Internal levels: group children in the same way, BTREE_MAX_KEYS + 1
+     * at most per node. The separator before each child is its minimum. */
+    while (n_nodes > 1) {
+        gsize n_parents = (n_nodes + BTREE_MAX_KEYS) / (BTREE_MAX_KEYS + 1);
+
+        pos = 0;
+        for (gsize j = 0; j < n_parents; j++) {
+            guint count = n_nodes / n_parents + (j < n_nodes % n_parents);
+            BTreeInternal *node = INTERNAL(node_new(FALSE));
+
+            for (guint k = 0; k < count; k++) {
+                node->children[k] = level[pos + k];
+                if (k > 0) {
+                    node->base.keys[k - 1] = mins[pos + k];
+                }
+            }
+            node->base.n_keys = count - 1;
+            level[j] = &node->base;
+            mins[j] = mins[pos];
+            pos += count;
+        }
+        n_nodes = n_parents;
+        tree->height++;
+    }
+
+    tree->root = level[0];
+    tree->size = n;
+    g_free(level);
+    g_free(mins);
+    return TRUE;
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+BTree *btree_new(GCompareDataFunc key_compare, gpointer key_compare_data)
+{
+    return btree_new_full(key_compare, key_compare_data, NULL, NULL);
+}
+
+BTree *btree_new_full(GCompareDataFunc key_compare,
+                      gpointer key_compare_data,
+                      GDestroyNotify key_destroy_func,
+                      GDestroyNotify value_destroy_func)
+{
+    BTree *tree = g_new0(BTree, 1);
+
+    tree->key_compare = key_compare;
+    tree->key_compare_data = key_compare_data;
+    tree->key_destroy_func = key_destroy_func;
+    tree->value_destroy_func = value_destroy_func;
+    return tree;
+}
+
+void btree_destroy(BTree *tree)
+{
+    if (tree->root) {
+        node_free_recursive(tree, tree->root);
+    }
+    g_free(tree);
+}
+
+void btree_insert(BTree *tree, gpointer key, gpointer value)
+{
+    insert_internal(tree, key, value, FALSE);
+}
+
+void btree_replace(BTree *tree, gpointer key, gpointer value)
+{
+    insert_internal(tree, key, value, TRUE);
+}
+
+gboolean btree_remove(BTree *tree, gconstpointer key)
+{
+    return remove_internal(tree, key, TRUE);
+}
+
+gboolean btree_steal(BTree *tree, gconstpointer key)
+{
+    return remove_internal(tree, key, FALSE);
+}
+
+gboolean btree_lookup_extended(BTree *tree,
+                               gconstpointer lookup_key,
+                               gpointer *orig_key,
+                               gpointer *value)
+{
+    BTreeNode *node = tree->root;
+
+    if (node == NULL) {
+        return FALSE;
+    }
+
+    while (!node->is_leaf) {
+        node = INTERNAL(node)->children[node_search(tree, node, lookup_key, TRUE)];
+    }
+
+    guint i = node_search(tree, node, lookup_key, FALSE);
+
+    if (i >= node->n_keys || compare_keys(tree, node->keys[i], lookup_key) != 0) {
+        return FALSE;
+    }
+    if (orig_key) {
+        *orig_key = node->keys[i];
+    }
+    if (value) {
+        *value = LEAF(node)->values[i];
+    }
+    return TRUE;
+}
+
+gpointer btree_lookup(BTree *tree, gconstpointer key)
+{
+    gpointer value = NULL;
+
+    btree_lookup_extended(tree, key, NULL, &value);
+    return value;
+}
+
+gsize btree_size(BTree *tree)
+{
+    return tree->size;
+}
+
+guint btree_height(BTree *tree)
+{
+    return tree->height;
+}
+
+void btree_foreach(BTree *tree, GTraverseFunc func, gpointer user_data)
+{
+    BTreeIter iter;
+
+    for (gboolean valid = btree_first(tree, &iter); valid; valid = btree_iter_next(&iter)) {
+        if (func(iter.leaf->base.keys[iter.index], iter.leaf->values[iter.index], user_data)) {
+            break;
+        }
+    }
+}
+
+void btree_foreach_range(BTree *tree, gconstpointer lo, gconstpointer hi,
+                         GTraverseFunc func, gpointer user_data)
+{
+    BTreeIter iter;
+
+    for (gboolean valid = btree_lower_bound(tree, lo, &iter); valid; valid = btree_iter_next(&iter)) {
+        gpointer key = iter.leaf->base.keys[iter.index];
+
+        if (compare_keys(tree, key, hi) >= 0 || func(key, iter.leaf->values[iter.index], user_data)) {
+            break;
+        }
+    }
+}
+
+/* Skip to the next leaf if @iter is past the end of its own */
+static gboolean iter_settle(BTreeIter *iter)
+{
+    while (iter->leaf && iter->index >= iter->leaf->base.n_keys) {
+        iter->leaf = iter->leaf->next;
+        iter->index = 0;
+    }
+    return iter->leaf != NULL;
+}
+
+gboolean btree_first(BTree *tree, BTreeIter *iter)
+{
+    iter->leaf = tree->root ? leftmost_leaf(tree->root) : NULL;
+    iter->index = 0;
+    return iter_settle(iter);
+}
+
+static gboolean bound(BTree *tree, gconstpointer key, BTreeIter *iter, gboolean upper)
+{
+    BTreeNode *node = tree->root;
+
+    if (node == NULL) {
+        iter->leaf = NULL;
+        iter->index = 0;
+        return FALSE;
+    }
+
+    while (!node->is_leaf) {
+        node = INTERNAL(node)->children[node_search(tree, node, key, TRUE)];
+    }
+    iter->leaf = LEAF(node);
+    iter->index = node_search(tree, node, key, upper);
+    return iter_settle(iter);
+}
+
+gboolean btree_lower_bound(BTree *tree, gconstpointer key, BTreeIter *iter)
+{
+    return bound(tree, key, iter, FALSE);
+}
+
+gboolean btree_upper_bound(BTree *tree, gconstpointer key, BTreeIter *iter)
+{
+    return bound(tree, key, iter, TRUE);
+}
+
+gboolean btree_iter_next(BTreeIter *iter)
+{
+    g_return_val_if_fail(iter->leaf != NULL, FALSE);
+
+    iter->index++;
+    return iter_settle(iter);
+}
+
+gpointer btree_iter_get_key(BTreeIter *iter)
+{
+    g_return_val_if_fail(iter->leaf != NULL, NULL);
+    return iter->leaf->base.keys[iter->index];
+}
+
+gpointer btree_iter_get_value(BTreeIter *iter)
+{
+    g_return_val_if_fail(iter->leaf != NULL, NULL);
+    return iter->leaf->values[iter->index];
+}
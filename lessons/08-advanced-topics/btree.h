@@ -0,0 +1,88 @@
+/*
+ * btree.h - Cache-dense ordered map (B+ tree)
+ *
+ * A BTree keeps up to 15 keys per node in one inline array: a node's
+ * header and keys fill exactly two cache lines, and a lookup in a
+ * million-entry tree touches 5 or 6 nodes instead of the ~20 scattered
+ * nodes a balanced binary tree like GTree or GSequence visits. Values
+ * live only in the leaves, which are linked in order, so iteration and
+ * range scans walk contiguous arrays instead of chasing parent pointers.
+ *
+ * Keys are gpointers compared with a GCompareDataFunc, as in GTree.
+ * With a NULL compare function keys are integers packed with
+ * GINT_TO_POINTER() and compared inline, without a function call.
+ *
+ * btree_bulk_load() builds a tree from sorted input in O(n), without a
+ * single comparison beyond checking the order.
+ *
+ * A BTree is not thread-safe. Iterators are invalidated by any insert
+ * or remove.
+ */
+
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _BTree BTree;
+typedef struct _BTreeLeaf BTreeLeaf;
+
+#define BTREE_MAX_KEYS 15
+
+/* A position in key order; leaf == NULL is the end */
+typedef struct {
+    BTreeLeaf *leaf;
+    guint index;
+} BTreeIter;
+
+/* @key_compare NULL compares keys as GINT_TO_POINTER() integers */
+BTree *btree_new(GCompareDataFunc key_compare, gpointer key_compare_data);
+BTree *btree_new_full(GCompareDataFunc key_compare,
+                      gpointer key_compare_data,
+                      GDestroyNotify key_destroy_func,
+                      GDestroyNotify value_destroy_func);
+void btree_destroy(BTree *tree);
+
+/* Fill an empty tree from @n keys in strictly ascending order (@values
+ * may be NULL). Returns FALSE, leaving the tree empty, if the tree
+ * wasn't empty or the keys aren't sorted. */
+gboolean btree_bulk_load(BTree *tree, gpointer *keys, gpointer *values, gsize n);
+
+/* Same semantics as g_tree_insert()/replace(): insert() keeps the old
+ * key and frees the new one, replace() frees the old key */
+void btree_insert(BTree *tree, gpointer key, gpointer value);
+void btree_replace(BTree *tree, gpointer key, gpointer value);
+
+gboolean btree_remove(BTree *tree, gconstpointer key);
+gboolean btree_steal(BTree *tree, gconstpointer key);
+
+gpointer btree_lookup(BTree *tree, gconstpointer key);
+gboolean btree_lookup_extended(BTree *tree,
+                               gconstpointer lookup_key,
+                               gpointer *orig_key,
+                               gpointer *value);
+
+gsize btree_size(BTree *tree);
+guint btree_height(BTree *tree);
+
+/* In key order; stops early if @func returns TRUE */
+void btree_foreach(BTree *tree, GTraverseFunc func, gpointer user_data);
+
+/* Keys in [@lo, @hi) */
+void btree_foreach_range(BTree *tree, gconstpointer lo, gconstpointer hi,
+                         GTraverseFunc func, gpointer user_data);
+
+/* Each returns FALSE (and sets the end iterator) if no key qualifies */
+gboolean btree_first(BTree *tree, BTreeIter *iter);
+gboolean btree_lower_bound(BTree *tree, gconstpointer key, BTreeIter *iter);   /* First key >= @key */
+gboolean btree_upper_bound(BTree *tree, gconstpointer key, BTreeIter *iter);   /* First key > @key */
+
+gboolean btree_iter_next(BTreeIter *iter);
+gpointer btree_iter_get_key(BTreeIter *iter);
+gpointer btree_iter_get_value(BTreeIter *iter);
+
+G_END_DECLS
+
+#endif /* BTREE_H */
@@ -0,0 +1,371 @@
+/*
+ * btree_benchmark.c - BTree vs GTree vs GSequence
+ *
+ * For 10k and 1M integer keys (and 10M with [max-entries]), times per
+ * operation:
+ *   - insert:   building the container in random key order
+ *   - sorted:   building it from keys already in order. BTree uses
+ *               btree_bulk_load(), GTree inserts in order, and GSequence
+ *               appends
+ *   - lookup:   random keys that are present
+ *   - iterate:  visiting every entry in key order
+ *   - range:    a lower-bound search plus a 100-entry scan, per entry
+ *               visited
+ *
+ * GTree and GSequence call a comparison function. BTree is run both
+ * with its inline integer comparison and with the same function
+ * ("BTree/cmp"), to separate layout from call overhead.
+ *
+ * Usage: ./btree_benchmark [max-entries] [--bench-...]   (default 1000000)
+ */
+
+#include "bench.h"
+#include "btree.h"
+
+#define RANGE_LEN 100
+
+typedef struct {
+    gsize n;
+    gpointer *sorted;            /* 0, 2, 4, ... so odd keys miss */
+    gpointer *shuffled;
+
+    /* Benchmark state, carried from one call to the next */
+    GTree *g_tree;
+    GSequence *g_seq;
+    BTree *b_tree;
+    gsize next;
+} Workload;
+
+static gint compare_ints(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    gint x = GPOINTER_TO_INT(a), y = GPOINTER_TO_INT(b);
+    return (x > y) - (x < y);
+}
+
+static inline gpointer next_key(Workload *w)
+{
+    gpointer key = w->shuffled[w->next];
+    w->next = (w->next + 1 < w->n) ? w->next + 1 : 0;
+    return key;
+}
+
+/* ============================================================
+ * Builders
+ * ============================================================ */
+
+static void gtree_build(Workload *w, gpointer *keys)
+{
+    w->g_tree = g_tree_new_full(compare_ints, NULL, NULL, NULL);
+    for (gsize i = 0; i < w->n; i++) {
+        g_tree_insert(w->g_tree, keys[i], keys[i]);
+    }
+}
+
+static void gseq_build(Workload *w, gpointer *keys)
+{
+    w->g_seq = g_sequence_new(NULL);
+    for (gsize i = 0; i < w->n; i++) {
+        g_sequence_insert_sorted(w->g_seq, keys[i], compare_ints, NULL);
+    }
+}
+
+static void btree_build(Workload *w, gpointer *keys, GCompareDataFunc compare)
+{
+    w->b_tree = btree_new(compare, NULL);
+    for (gsize i = 0; i < w->n; i++) {
+        btree_insert(w->b_tree, keys[i], keys[i]);
+    }
+}
+
+static void gtree_insert_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        gtree_build(w, w->shuffled);
+        g_tree_destroy(w->g_tree);
+    }
+}
+
+static void gseq_insert_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        gseq_build(w, w->shuffled);
+        g_sequence_free(w->g_seq);
+    }
+}
+
+static void btree_insert_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        btree_build(w, w->shuffled, NULL);
+        btree_destroy(w->b_tree);
+    }
+}
+
+static void gtree_sorted_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        gtree_build(w, w->sorted);
+        g_tree_destroy(w->g_tree);
+    }
+}
+
+static void gseq_sorted_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        GSequence *seq = g_sequence_new(NULL);
+
+        for (gsize i = 0; i < w->n; i++) {
+            g_sequence_append(seq, w->sorted[i]);
+        }
+        g_sequence_free(seq);
+    }
+}
+
+static void btree_sorted_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        BTree *tree = btree_new(NULL, NULL);
+
+        btree_bulk_load(tree, w->sorted, w->sorted, w->n);
+        btree_destroy(tree);
+    }
+}
+
+/* ============================================================
+ * Lookups, iteration and ranges on built containers
+ * ============================================================ */
+
+static void gtree_lookup_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        bench_do_not_optimize(g_tree_lookup(w->g_tree, next_key(w)));
+    }
+}
+
+static void gseq_lookup_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        bench_do_not_optimize(g_sequence_lookup(w->g_seq, next_key(w), compare_ints, NULL));
+    }
+}
+
+static void btree_lookup_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        bench_do_not_optimize(btree_lookup(w->b_tree, next_key(w)));
+    }
+}
+
+static gboolean visit(gpointer key, gpointer value, gpointer user_data)
+{
+    bench_do_not_optimize(value);
+    return FALSE;
+}
+
+static void gtree_iterate_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        g_tree_foreach(w->g_tree, visit, NULL);
+    }
+}
+
+static void gseq_iterate_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        GSequenceIter *iter = g_sequence_get_begin_iter(w->g_seq);
+
+        while (!g_sequence_iter_is_end(iter)) {
+            bench_do_not_optimize(g_sequence_get(iter));
+            iter = g_sequence_iter_next(iter);
+        }
+    }
+}
+
+static void btree_iterate_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        BTreeIter iter;
+
+        for (gboolean valid = btree_first(w->b_tree, &iter); valid; valid = btree_iter_next(&iter)) {
+            bench_do_not_optimize(btree_iter_get_value(&iter));
+        }
+    }
+}
+
+static void gtree_range_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        GTreeNode *node = g_tree_lower_bound(w->g_tree, next_key(w));
+
+        for (guint i = 0; i < RANGE_LEN && node; i++) {
+            bench_do_not_optimize(g_tree_node_value(node));
+            node = g_tree_node_next(node);
+        }
+    }
+}
+
+static void gseq_range_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        /* search() lands after equal items, so ask for key - 1 */
+        gint key = GPOINTER_TO_INT(next_key(w)) - 1;
+        GSequenceIter *iter = g_sequence_search(w->g_seq, GINT_TO_POINTER(key), compare_ints, NULL);
+
+        for (guint i = 0; i < RANGE_LEN && !g_sequence_iter_is_end(iter); i++) {
+            bench_do_not_optimize(g_sequence_get(iter));
+            iter = g_sequence_iter_next(iter);
+        }
+    }
+}
+
+static void btree_range_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        BTreeIter iter;
+        gboolean valid = btree_lower_bound(w->b_tree, next_key(w), &iter);
+
+        for (guint i = 0; i < RANGE_LEN && valid; i++) {
+            bench_do_not_optimize(btree_iter_get_value(&iter));
+            valid = btree_iter_next(&iter);
+        }
+    }
+}
+
+/* ============================================================
+ * Driver
+ * ============================================================ */
+
+static void shuffle(gpointer *array, gsize n)
+{
+    guint32 state = 2463534242u;
+
+    for (gsize i = n - 1; i > 0; i--) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        gsize j = state % (i + 1);
+        gpointer tmp = array[i];
+        array[i] = array[j];
+        array[j] = tmp;
+    }
+}
+
+static void run(Bench *bench, Workload *w, const gchar *op, guint64 ops,
+                BenchFunc gtree_func, BenchFunc gseq_func, BenchFunc btree_func,
+                gboolean with_cmp)
+{
+    gchar *name;
+
+    name = g_strdup_printf("%" G_GSIZE_FORMAT " %s GTree", w->n, op);
+    w->next = 0;
+    bench_run_ops(bench, name, ops, gtree_func, w);
+    g_free(name);
+
+    name = g_strdup_printf("%" G_GSIZE_FORMAT " %s GSequence", w->n, op);
+    w->next = 0;
+    bench_run_ops(bench, name, ops, gseq_func, w);
+    g_free(name);
+
+    name = g_strdup_printf("%" G_GSIZE_FORMAT " %s BTree", w->n, op);
+    w->next = 0;
+    bench_run_ops(bench, name, ops, btree_func, w);
+    g_free(name);
+
+    if (with_cmp) {
+        BTree *inline_tree = w->b_tree;
+
+        btree_build(w, w->sorted, compare_ints);
+        name = g_strdup_printf("%" G_GSIZE_FORMAT " %s BTree/cmp", w->n, op);
+        w->next = 0;
+        bench_run_ops(bench, name, ops, btree_func, w);
+        g_free(name);
+        btree_destroy(w->b_tree);
+        w->b_tree = inline_tree;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static const gsize sizes[] = { 10000, 1000000, 10000000 };
+    Bench *bench = bench_new("btree_benchmark", &argc, &argv);
+    gsize max_entries = (argc > 1) ? g_ascii_strtoull(argv[1], NULL, 10) : 1000000;
+
+    if (max_entries == 0) {
+        g_printerr("Usage: %s [max-entries] [--bench-...]\n", argv[0]);
+        return 1;
+    }
+
+    g_print("=== BTree vs GTree vs GSequence ===\n");
+
+    for (guint s = 0; s < G_N_ELEMENTS(sizes) && sizes[s] <= max_entries; s++) {
+        Workload w = { .n = sizes[s] };
+
+        w.sorted = g_new(gpointer, w.n);
+        w.shuffled = g_new(gpointer, w.n);
+        for (gsize i = 0; i < w.n; i++) {
+            w.sorted[i] = w.shuffled[i] = GSIZE_TO_POINTER(i * 2);
+        }
+        shuffle(w.shuffled, w.n);
+
+        g_print("\n%" G_GSIZE_FORMAT " entries:\n", w.n);
+
+        run(bench, &w, "insert", w.n, gtree_insert_bench, gseq_insert_bench, btree_insert_bench, FALSE);
+        run(bench, &w, "sorted", w.n, gtree_sorted_bench, gseq_sorted_bench, btree_sorted_bench, FALSE);
+
+        gtree_build(&w, w.sorted);
+        gseq_build(&w, w.sorted);
+        btree_build(&w, w.shuffled, NULL);
+        g_print("  (GTree height %d, BTree height %u)\n",
+                g_tree_height(w.g_tree), btree_height(w.b_tree));
+
+        run(bench, &w, "lookup", 1, gtree_lookup_bench, gseq_lookup_bench, btree_lookup_bench, TRUE);
+        run(bench, &w, "iterate", w.n, gtree_iterate_bench, gseq_iterate_bench, btree_iterate_bench, FALSE);
+        run(bench, &w, "range", RANGE_LEN, gtree_range_bench, gseq_range_bench, btree_range_bench, FALSE);
+
+        g_tree_destroy(w.g_tree);
+        g_sequence_free(w.g_seq);
+        btree_destroy(w.b_tree);
+        g_free(w.sorted);
+        g_free(w.shuffled);
+    }
+
+    g_print("\n=== Key Points ===\n");
+    g_print("1. 15 keys per node: a search touches a few cache-line pairs, not ~log2(n) nodes\n");
+    g_print("2. Linked leaves make iteration and range scans array walks\n");
+    g_print("3. Bulk loading sorted input skips every comparison and rebalance\n");
+    g_print("4. GSequence adds positional access (g_sequence_get_iter_at_pos), which BTree lacks\n");
+
+    bench_free(bench);
+    return 0;
+}
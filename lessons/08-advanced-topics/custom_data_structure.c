@@ -6,70 +6,45 @@
  */
 
 #include <glib.h>
+#include "dary_heap.h"
+#include "obj_pool.h"
 
 /* ============================================================
- * Custom Priority Queue using GLib primitives
+ * Custom Priority Queue on a d-ary heap (see dary_heap.c)
  * ============================================================ */
 
 typedef struct {
-    gchar *data;
-    gint priority;
-} PriorityItem;
-
-typedef struct {
-    GQueue *items;  /* Using GQueue as base */
+    DaryHeap *heap;  /* Array-backed: O(log n) push/pop */
 } PriorityQueue;
 
-static gint compare_priority(gconstpointer a, gconstpointer b, gpointer user_data)
-{
-    const PriorityItem *item_a = a;
-    const PriorityItem *item_b = b;
-    /* Higher priority first (descending order) */
-    return item_b->priority - item_a->priority;
-}
-
 static PriorityQueue *priority_queue_new(void)
 {
     PriorityQueue *pq = g_new(PriorityQueue, 1);
-    pq->items = g_queue_new();
+    pq->heap = dary_heap_new(0);
     return pq;
 }
 
 static void priority_queue_push(PriorityQueue *pq, const gchar *data, gint priority)
 {
-    PriorityItem *item = g_new(PriorityItem, 1);
-    item->data = g_strdup(data);
-    item->priority = priority;
-    
-    /* Insert sorted */
-    g_queue_insert_sorted(pq->items, item, compare_priority, NULL);
+    /* The heap pops the smallest key first; negate for highest priority
+     * first. Equal priorities keep insertion order. */
+    dary_heap_push(pq->heap, -(gint64)priority, g_strdup(data));
 }
 
 static gchar *priority_queue_pop(PriorityQueue *pq)
 {
-    if (g_queue_is_empty(pq->items)) {
-        return NULL;
-    }
-    
-    PriorityItem *item = g_queue_pop_head(pq->items);
-    gchar *data = item->data;  /* Transfer ownership */
-    g_free(item);
-    return data;
+    /* Transfers ownership; NULL when empty */
+    return dary_heap_pop(pq->heap, NULL);
 }
 
 static gboolean priority_queue_is_empty(PriorityQueue *pq)
 {
-    return g_queue_is_empty(pq->items);
+    return dary_heap_is_empty(pq->heap);
 }
 
 static void priority_queue_free(PriorityQueue *pq)
 {
-    while (!g_queue_is_empty(pq->items)) {
-        PriorityItem *item = g_queue_pop_head(pq->items);
-        g_free(item->data);
-        g_free(item);
-    }
-    g_queue_free(pq->items);
+    dary_heap_free(pq->heap, g_free);
     g_free(pq);
 }
 
@@ -80,6 +55,7 @@ static void priority_queue_free(PriorityQueue *pq)
 typedef struct {
     GHashTable *table;  /* Key -> CacheEntry */
     GQueue *order;      /* Access order (most recent at head) */
+    ObjPool *entries;   /* CacheEntry allocator */
     guint capacity;
     guint size;
 } LRUCache;
@@ -90,19 +66,21 @@ typedef struct {
     GList *node;  /* Pointer to position in order queue */
 } CacheEntry;
 
-static void cache_entry_free(CacheEntry *entry)
+static void cache_entry_free(LRUCache *cache, CacheEntry *entry)
 {
     g_free(entry->key);
     g_free(entry->value);
-    g_free(entry);
+    obj_pool_free(cache->entries, entry);
 }
 
 static LRUCache *lru_cache_new(guint capacity)
 {
     LRUCache *cache = g_new(LRUCache, 1);
-    cache->table = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                          NULL, (GDestroyNotify)cache_entry_free);
+    /* Entries are freed by the cache, not the table, since they come
+     * from the cache's pool */
+    cache->table = g_hash_table_new(g_str_hash, g_str_equal);
     cache->order = g_queue_new();
+    cache->entries = obj_pool_new_for_type(CacheEntry, 0);
     cache->capacity = capacity;
     cache->size = 0;
     return cache;
@@ -126,13 +104,14 @@ static void lru_cache_put(LRUCache *cache, const gchar *key, const gchar *value)
                 CacheEntry *evicted = last->data;
                 g_print("  [Cache] Evicting: %s\n", evicted->key);
                 g_hash_table_remove(cache->table, evicted->key);
+                cache_entry_free(cache, evicted);
                 g_list_free(last);
                 cache->size--;
             }
         }
         
         /* Add new entry */
-        CacheEntry *entry = g_new(CacheEntry, 1);
+        CacheEntry *entry = obj_pool_alloc_type(cache->entries, CacheEntry);
         entry->key = g_strdup(key);
         entry->value = g_strdup(value);
         
@@ -160,8 +139,14 @@ static const gchar *lru_cache_get(LRUCache *cache, const gchar *key)
 
 static void lru_cache_free(LRUCache *cache)
 {
+    CacheEntry *entry;
+    
+    while ((entry = g_queue_pop_head(cache->order)) != NULL) {
+        cache_entry_free(cache, entry);
+    }
     g_hash_table_destroy(cache->table);
     g_queue_free(cache->order);
+    obj_pool_destroy(cache->entries);
     g_free(cache);
 }
 
@@ -234,7 +219,9 @@ int main(void)
     g_print("\n=== Key Points ===\n");
     g_print("- Compose GLib types for custom structures\n");
     g_print("- Use GQueue for queue-like behavior\n");
+    g_print("- Array-backed heaps beat sorted lists for priority queues\n");
     g_print("- GHashTable for O(1) key lookup\n");
+    g_print("- Allocate many same-size entries from a pool\n");
     g_print("- Define comparison functions for sorting\n");
     g_print("- Handle memory ownership carefully\n");
     g_print("- Free all nested structures\n");
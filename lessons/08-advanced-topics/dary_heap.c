@@ -0,0 +1,318 @@
+/*
+ * dary_heap.c - Array-backed d-ary min-heap with handles
+ *
+ * See dary_heap.h for the API. Nodes are ordered by (priority, seq),
+ * where seq is a per-heap insertion counter, which gives FIFO order among
+ * equal priorities. A parallel positions[] array maps each handle to its
+ * node's current index; free handles are chained through the same array.
+ * Sifting moves a hole instead of swapping, so each level costs one
+ * node copy.
+ */
+
+#include "dary_heap.h"
+
+#define HANDLE_NONE G_MAXUINT32
+#define INITIAL_CAPACITY 16
+
+typedef struct {
+    gint64 priority;
+    guint64 seq;
+    gpointer data;
+    DaryHeapHandle handle;
+} HeapNode;
+
+struct _DaryHeap {
+    HeapNode *nodes;
+    gsize size;
+    gsize capacity;
+    guint arity;
+    guint64 next_seq;
+
+    /* handle -> node index, or the free-list link for unused handles */
+    guint32 *positions;
+    guint32 n_handles;               /* High-water mark */
+    guint32 free_handle;
+};
+
+static inline gboolean node_less(const HeapNode *a, const HeapNode *b)
+{
+    return a->priority < b->priority ||
+           (a->priority == b->priority && a->seq < b->seq);
+}
+
+static void heap_reserve(DaryHeap *heap, gsize capacity)
+{
+    if (capacity <= heap->capacity) {
+        return;
+    }
+
+    gsize new_capacity = MAX(heap->capacity, INITIAL_CAPACITY);
+    while (new_capacity < capacity) {
+        new_capacity *= 2;
+    }
+
+    heap->nodes = g_renew(HeapNode, heap->nodes, new_capacity);
+    heap->positions = g_renew(guint32, heap->positions, new_capacity);
+    heap->capacity = new_capacity;
+}
+
+static DaryHeapHandle handle_alloc(DaryHeap *heap)
+{
+    DaryHeapHandle handle;
+
+    if (heap->free_handle != HANDLE_NONE) {
+        handle = heap->free_handle;
+        heap->free_handle = heap->positions[handle];
+    } else {
+        /* Live handles never exceed size, which capacity already covers */
+        handle = heap->n_handles++;
+    }
+
+    return handle;
+}
+
+static void handle_release(DaryHeap *heap, DaryHeapHandle handle)
+{
+    heap->positions[handle] = heap->free_handle;
+    heap->free_handle = handle;
+}
+
+static inline void place(DaryHeap *heap, gsize index, const HeapNode *node)
+{
+    heap->nodes[index] = *node;
+    heap->positions[node->handle] = index;
+}
+
+static void sift_up(DaryHeap *heap, gsize index)
+{
+    HeapNode node = heap->nodes[index];
+
+    while (index > 0) {
+        gsize parent = (index - 1) / heap->arity;
+
+        if (!node_less(&node, &heap->nodes[parent])) {
+            break;
+        }
+        place(heap, index, &heap->nodes[parent]);
+        index = parent;
+    }
+
+    place(heap, index, &node);
+}
+
+static void sift_down(DaryHeap *heap, gsize index)
+{
+    HeapNode node = heap->nodes[index];
+
+    for (;;) {
+        gsize first = index * heap->arity + 1;
+        gsize last, best;
+
+        if (first >= heap->size) {
+            break;
+        }
+
+        /* Smallest child; the children are contiguous in memory */
+        last = MIN(first + heap->arity, heap->size);
+        best = first;
+        for (gsize child = first + 1; child < last; child++) {
+            if (node_less(&heap->nodes[child], &heap->nodes[best])) {
+                best = child;
+            }
+        }
+
+        if (!node_less(&heap->nodes[best], &node)) {
+            break;
+        }
+        place(heap, index, &heap->nodes[best]);
+        index = best;
+    }
+
+    place(heap, index, &node);
+}
+
+static gboolean handle_is_live(DaryHeap *heap, DaryHeapHandle handle)
+{
+    return handle < heap->n_handles &&
+           heap->positions[handle] < heap->size &&
+           heap->nodes[heap->positions[handle]].handle == handle;
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+DaryHeap *dary_heap_new(guint arity)
+{
+    DaryHeap *heap = g_new0(DaryHeap, 1);
+
+    heap->arity = (arity >= 2) ? arity : DARY_HEAP_DEFAULT_ARITY;
+    heap->free_handle = HANDLE_NONE;
+    heap_reserve(heap, INITIAL_CAPACITY);
+
+    return heap;
+}
+
+DaryHeap *dary_heap_new_from_array(guint arity,
+                                   const gint64 *priorities,
+                                   gpointer *data,
+                                   gsize n,
+                                   DaryHeapHandle *handles)
+{
+    DaryHeap *heap = dary_heap_new(arity);
+
+    g_return_val_if_fail(n < HANDLE_NONE, heap);
+
+    heap_reserve(heap, n);
+    for (gsize i = 0; i < n; i++) {
+        HeapNode *node = &heap->nodes[i];
+
+        node->priority = priorities[i];
+        node->seq = i;
+        node->data = data ? data[i] : NULL;
+        node->handle = i;
+        heap->positions[i] = i;
+        if (handles) {
+            handles[i] = i;
+        }
+    }
+    heap->size = n;
+    heap->n_handles = n;
+    heap->next_seq = n;
+
+    /* Floyd: sift down every internal node, last parent first */
+    if (n > 1) {
+        for (gsize i = (n - 2) / heap->arity + 1; i-- > 0;) {
+            sift_down(heap, i);
+        }
+    }
+
+    return heap;
+}
+
+void dary_heap_free(DaryHeap *heap, GDestroyNotify free_func)
+{
+    if (free_func) {
+        for (gsize i = 0; i < heap->size; i++) {
+            free_func(heap->nodes[i].data);
+        }
+    }
+
+    g_free(heap->nodes);
+    g_free(heap->positions);
+    g_free(heap);
+}
+
+DaryHeapHandle dary_heap_push(DaryHeap *heap, gint64 priority, gpointer data)
+{
+    DaryHeapHandle handle;
+    HeapNode *node;
+
+    g_return_val_if_fail(heap->size < HANDLE_NONE - 1, DARY_HEAP_INVALID_HANDLE);
+
+    heap_reserve(heap, heap->size + 1);
+
+    node = &heap->nodes[heap->size];
+    node->priority = priority;
+    node->seq = heap->next_seq++;
+    node->data = data;
+    node->handle = handle = handle_alloc(heap);
+    heap->positions[handle] = heap->size;
+
+    sift_up(heap, heap->size++);
+
+    return handle;
+}
+
+gpointer dary_heap_peek(DaryHeap *heap, gint64 *priority)
+{
+    if (heap->size == 0) {
+        return NULL;
+    }
+
+    if (priority) {
+        *priority = heap->nodes[0].priority;
+    }
+    return heap->nodes[0].data;
+}
+
+gpointer dary_heap_pop(DaryHeap *heap, gint64 *priority)
+{
+    HeapNode root;
+
+    if (heap->size == 0) {
+        return NULL;
+    }
+
+    root = heap->nodes[0];
+    handle_release(heap, root.handle);
+
+    if (--heap->size > 0) {
+        heap->nodes[0] = heap->nodes[heap->size];
+        sift_down(heap, 0);
+    }
+
+    if (priority) {
+        *priority = root.priority;
+    }
+    return root.data;
+}
+
+void dary_heap_update(DaryHeap *heap, DaryHeapHandle handle, gint64 priority)
+{
+    gsize index;
+    gint64 old;
+
+    g_return_if_fail(handle_is_live(heap, handle));
+
+    index = heap->positions[handle];
+    old = heap->nodes[index].priority;
+    heap->nodes[index].priority = priority;
+
+    if (priority < old) {
+        sift_up(heap, index);
+    } else if (priority > old) {
+        sift_down(heap, index);
+    }
+}
+
+gpointer dary_heap_remove(DaryHeap *heap, DaryHeapHandle handle)
+{
+    HeapNode removed;
+    gsize index;
+
+    g_return_val_if_fail(handle_is_live(heap, handle), NULL);
+
+    index = heap->positions[handle];
+    removed = heap->nodes[index];
+    handle_release(heap, handle);
+
+    if (index < --heap->size) {
+        /* Fill the hole with the last node and restore order around it */
+        heap->nodes[index] = heap->nodes[heap->size];
+        if (node_less(&heap->nodes[index], &removed)) {
+            sift_up(heap, index);
+        } else {
+            sift_down(heap, index);
+        }
+    }
+
+    return removed.data;
+}
+
+gint64 dary_heap_get_priority(DaryHeap *heap, DaryHeapHandle handle)
+{
+    g_return_val_if_fail(handle_is_live(heap, handle), 0);
+
+    return heap->nodes[heap->positions[handle]].priority;
+}
+
+gsize dary_heap_size(DaryHeap *heap)
+{
+    return heap->size;
+}
+
+gboolean dary_heap_is_empty(DaryHeap *heap)
+{
+    return heap->size == 0;
+}
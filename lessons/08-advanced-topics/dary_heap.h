@@ -0,0 +1,61 @@
+/*
+ * dary_heap.h - Array-backed d-ary min-heap with handles
+ *
+ * Items are (priority, data) pairs kept in one contiguous array; the
+ * smallest priority pops first and equal priorities pop in insertion
+ * (FIFO) order. push/pop/update are O(log_d n). A wider node (d = 4 by
+ * default) makes the tree shallower and keeps each node's children in
+ * one or two cache lines, which beats a binary heap once the array no
+ * longer fits in cache.
+ *
+ * push() returns a handle that stays valid until the item is popped or
+ * removed, so an item's priority can be changed in place.
+ */
+
+#ifndef DARY_HEAP_H
+#define DARY_HEAP_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _DaryHeap DaryHeap;
+typedef guint32 DaryHeapHandle;
+
+#define DARY_HEAP_DEFAULT_ARITY 4
+#define DARY_HEAP_INVALID_HANDLE G_MAXUINT32
+
+/* @arity 0 selects DARY_HEAP_DEFAULT_ARITY */
+DaryHeap *dary_heap_new(guint arity);
+
+/* Build a heap from @n items in O(n) (bottom-up heapify). Items with equal
+ * priorities keep their array order. If @handles is non-NULL it receives
+ * the handle of each item. */
+DaryHeap *dary_heap_new_from_array(guint arity,
+                                   const gint64 *priorities,
+                                   gpointer *data,
+                                   gsize n,
+                                   DaryHeapHandle *handles);
+
+/* @free_func, if set, is called on every item still in the heap */
+void dary_heap_free(DaryHeap *heap, GDestroyNotify free_func);
+
+DaryHeapHandle dary_heap_push(DaryHeap *heap, gint64 priority, gpointer data);
+
+/* Return the first item (and its priority), or NULL if the heap is empty */
+gpointer dary_heap_peek(DaryHeap *heap, gint64 *priority);
+gpointer dary_heap_pop(DaryHeap *heap, gint64 *priority);
+
+/* Change the priority of a queued item; it moves up or down as needed */
+void dary_heap_update(DaryHeap *heap, DaryHeapHandle handle, gint64 priority);
+
+/* Remove a queued item and return its data */
+gpointer dary_heap_remove(DaryHeap *heap, DaryHeapHandle handle);
+
+gint64 dary_heap_get_priority(DaryHeap *heap, DaryHeapHandle handle);
+gsize dary_heap_size(DaryHeap *heap);
+gboolean dary_heap_is_empty(DaryHeap *heap);
+
+G_END_DECLS
+
+#endif /* DARY_HEAP_H */
@@ -6,6 +6,18 @@
  */
 
 #include <glib.h>
+#include <glib/gstdio.h>
+
+#include "variant_bulk.h"
+
+/* Matches the GVariant tuple "(iid)": 4 + 4 bytes, then an 8-aligned double */
+typedef struct {
+    gint32 sensor;
+    gint32 reading;
+    gdouble value;
+} Sample;
+
+G_STATIC_ASSERT(sizeof(Sample) == 16);
 
 /* Print a GVariant with indentation */
 static void print_variant(GVariant *variant, gint indent)
@@ -184,12 +196,54 @@ int main(void)
     g_variant_unref(data);
     g_variant_unref(restored);
     
+    /* Example 7: Bulk arrays without a builder */
+    g_print("\n7. Bulk Arrays (zero-copy):\n\n");
+    
+    Sample *samples = g_new(Sample, 4);
+    for (gint i = 0; i < 4; i++) {
+        samples[i] = (Sample) { i, i * 100, i * 0.5 };
+    }
+    
+    /* The variant adopts the C array; no element is boxed or copied */
+    const GVariantType *sample_type = G_VARIANT_TYPE("(iid)");
+    g_print("  (iid) is %" G_GSIZE_FORMAT " bytes, Sample is %" G_GSIZE_FORMAT "\n",
+            variant_bulk_fixed_size(sample_type, NULL), sizeof(Sample));
+    
+    GVariant *bulk = g_variant_ref_sink(variant_bulk_new_array_take(sample_type, samples, 4));
+    g_print("  Array: ");
+    print_variant(bulk, 0);
+    
+    /* Saved blobs are mapped back in place */
+    GError *error = NULL;
+    gchar *path = g_build_filename(g_get_tmp_dir(), "gvariant_example.bin", NULL);
+    
+    if (variant_bulk_save(bulk, path, &error)) {
+        GVariant *loaded = variant_bulk_load(path, &error);
+        
+        if (loaded) {
+            gsize n;
+            const Sample *mapped = variant_bulk_get_array(loaded, sizeof(Sample), &n);
+            g_print("  Loaded %" G_GSIZE_FORMAT " samples from the mapping; last value %.1f\n",
+                    n, mapped[n - 1].value);
+            g_variant_unref(loaded);
+        }
+        g_unlink(path);
+    }
+    if (error) {
+        g_print("  Error: %s\n", error->message);
+        g_clear_error(&error);
+    }
+    
+    g_free(path);
+    g_variant_unref(bulk);
+    
     g_print("\n=== Key Points ===\n");
     g_print("- GVariant is type-safe serialization\n");
     g_print("- Format strings define type: 's'=string, 'i'=int, etc.\n");
     g_print("- Use builders for arrays and dicts\n");
     g_print("- g_variant_lookup() for dict access\n");
     g_print("- Serialize with g_variant_store()\n");
+    g_print("- Fixed-size arrays can wrap C memory directly, with no builder\n");
     g_print("- Great for IPC, configs, D-Bus\n");
     
     return 0;
@@ -0,0 +1,282 @@
+/*
+ * hash_map_benchmark.c - SwissTable vs GHashTable
+ *
+ * For 10k, 1M and 100M entries with integer keys (g_direct_hash) and
+ * string keys (g_str_hash), times per operation:
+ *   - insert:      building the table from empty, growth included
+ *   - lookup-hit:  keys that are present, in insertion order
+ *   - lookup-miss: keys that are absent
+ *   - iterate:     visiting every entry
+ *
+ * Sizes above [max-entries] are skipped. At 100M entries, the string
+ * keys and both tables need around 8 GB. Each insert repetition then
+ * builds a whole table, so add --bench-repetitions=3 or so.
+ *
+ * Usage: ./hash_map_benchmark [max-entries] [--bench-...]   (default 1000000)
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "swiss_table.h"
+
+#define KEY_LEN 16               /* "k" + 14 digits + NUL */
+#define MAX_MISS_KEYS 1000000
+
+typedef struct {
+    gboolean strings;
+    gsize n;
+    gchar *key_data;             /* String keys, KEY_LEN bytes apart */
+    gchar *miss_data;
+    gsize n_miss;
+    GHashFunc hash_func;
+    GEqualFunc equal_func;
+
+    /* Benchmark state, carried from one call to the next */
+    GHashTable *g_table;
+    SwissTable *s_table;
+    gsize next;
+    GHashTableIter g_iter;
+    SwissTableIter s_iter;
+    gboolean iter_valid;
+} Workload;
+
+static inline gpointer hit_key(Workload *w, gsize i)
+{
+    return w->strings ? (gpointer)(w->key_data + i * KEY_LEN) : GSIZE_TO_POINTER(i + 1);
+}
+
+static inline gpointer miss_key(Workload *w, gsize i)
+{
+    return w->strings ? (gpointer)(w->miss_data + i * KEY_LEN) : GSIZE_TO_POINTER(w->n + i + 1);
+}
+
+static inline gsize advance(gsize i, gsize n)
+{
+    return (i + 1 < n) ? i + 1 : 0;
+}
+
+/* ============================================================
+ * GHashTable
+ * ============================================================ */
+
+static void g_build(Workload *w)
+{
+    w->g_table = g_hash_table_new(w->hash_func, w->equal_func);
+    for (gsize i = 0; i < w->n; i++) {
+        g_hash_table_insert(w->g_table, hit_key(w, i), GSIZE_TO_POINTER(i));
+    }
+}
+
+static void g_insert(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        g_build(w);
+        g_hash_table_destroy(w->g_table);
+    }
+    w->g_table = NULL;
+}
+
+static void g_lookup_hit(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        bench_do_not_optimize(g_hash_table_lookup(w->g_table, hit_key(w, w->next)));
+        w->next = advance(w->next, w->n);
+    }
+}
+
+static void g_lookup_miss(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        bench_do_not_optimize(g_hash_table_lookup(w->g_table, miss_key(w, w->next)));
+        w->next = advance(w->next, w->n_miss);
+    }
+}
+
+static void g_iterate(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+    gpointer key, value;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        if (!w->iter_valid || !g_hash_table_iter_next(&w->g_iter, &key, &value)) {
+            g_hash_table_iter_init(&w->g_iter, w->g_table);
+            w->iter_valid = g_hash_table_iter_next(&w->g_iter, &key, &value);
+        }
+        bench_do_not_optimize(value);
+    }
+}
+
+/* ============================================================
+ * SwissTable
+ * ============================================================ */
+
+static void s_build(Workload *w)
+{
+    w->s_table = swiss_table_new(w->hash_func, w->equal_func);
+    for (gsize i = 0; i < w->n; i++) {
+        swiss_table_insert(w->s_table, hit_key(w, i), GSIZE_TO_POINTER(i));
+    }
+}
+
+static void s_insert(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        s_build(w);
+        swiss_table_destroy(w->s_table);
+    }
+    w->s_table = NULL;
+}
+
+static void s_lookup_hit(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        bench_do_not_optimize(swiss_table_lookup(w->s_table, hit_key(w, w->next)));
+        w->next = advance(w->next, w->n);
+    }
+}
+
+static void s_lookup_miss(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        bench_do_not_optimize(swiss_table_lookup(w->s_table, miss_key(w, w->next)));
+        w->next = advance(w->next, w->n_miss);
+    }
+}
+
+static void s_iterate(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+    gpointer key, value;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        if (!w->iter_valid || !swiss_table_iter_next(&w->s_iter, &key, &value)) {
+            swiss_table_iter_init(&w->s_iter, w->s_table);
+            w->iter_valid = swiss_table_iter_next(&w->s_iter, &key, &value);
+        }
+        bench_do_not_optimize(value);
+    }
+}
+
+/* ============================================================
+ * Driver
+ * ============================================================ */
+
+static gchar *make_keys(gchar prefix, gsize n)
+{
+    gchar *data = g_malloc(n * KEY_LEN);
+
+    for (gsize i = 0; i < n; i++) {
+        g_snprintf(data + i * KEY_LEN, KEY_LEN, "%c%014" G_GSIZE_FORMAT, prefix, i);
+    }
+    return data;
+}
+
+static const gchar *size_label(gsize n)
+{
+    static gchar label[16];
+
+    if (n >= 1000000) {
+        g_snprintf(label, sizeof(label), "%" G_GSIZE_FORMAT "M", n / 1000000);
+    } else {
+        g_snprintf(label, sizeof(label), "%" G_GSIZE_FORMAT "k", n / 1000);
+    }
+    return label;
+}
+
+/* Run one operation on both tables and return GHashTable / SwissTable */
+static gdouble compare(Bench *bench, Workload *w, const gchar *prefix, const gchar *op,
+                       guint64 ops, BenchFunc g_func, BenchFunc s_func)
+{
+    gchar *g_name = g_strdup_printf("%s %s GHashTable", prefix, op);
+    gchar *s_name = g_strdup_printf("%s %s SwissTable", prefix, op);
+    gdouble g_ns, s_ns;
+
+    w->next = 0;
+    w->iter_valid = FALSE;
+    g_ns = bench_run_ops(bench, g_name, ops, g_func, w)->median_ns;
+    w->next = 0;
+    w->iter_valid = FALSE;
+    s_ns = bench_run_ops(bench, s_name, ops, s_func, w)->median_ns;
+
+    g_free(g_name);
+    g_free(s_name);
+    return s_ns > 0 ? g_ns / s_ns : 0.0;
+}
+
+static void run_workload(Bench *bench, Workload *w)
+{
+    gchar *prefix = g_strdup_printf("%s/%s", w->strings ? "str" : "int", size_label(w->n));
+    gdouble insert, hit, miss, iterate;
+
+    g_print("\n%s keys, %s entries:\n", w->strings ? "String" : "Integer", size_label(w->n));
+
+    insert = compare(bench, w, prefix, "insert", w->n, g_insert, s_insert);
+
+    g_build(w);
+    s_build(w);
+    hit = compare(bench, w, prefix, "lookup-hit", 1, g_lookup_hit, s_lookup_hit);
+    miss = compare(bench, w, prefix, "lookup-miss", 1, g_lookup_miss, s_lookup_miss);
+    iterate = compare(bench, w, prefix, "iterate", 1, g_iterate, s_iterate);
+    g_hash_table_destroy(w->g_table);
+    swiss_table_destroy(w->s_table);
+
+    g_print("  SwissTable speedup: insert %.2fx, hit %.2fx, miss %.2fx, iterate %.2fx\n",
+            insert, hit, miss, iterate);
+    g_free(prefix);
+}
+
+int main(int argc, char *argv[])
+{
+    static const gsize sizes[] = { 10000, 1000000, 100000000 };
+    Bench *bench = bench_new("hash_map_benchmark", &argc, &argv);
+    gsize max_entries = (argc > 1) ? g_ascii_strtoull(argv[1], NULL, 10) : 1000000;
+
+    if (max_entries == 0) {
+        g_printerr("Usage: %s [max-entries] [--bench-...]\n", argv[0]);
+        return 1;
+    }
+
+    g_print("=== SwissTable vs GHashTable ===\n");
+
+    for (guint i = 0; i < G_N_ELEMENTS(sizes) && sizes[i] <= max_entries; i++) {
+        gsize n_miss = MIN(sizes[i], MAX_MISS_KEYS);
+        Workload ints = {
+            .strings = FALSE, .n = sizes[i], .n_miss = n_miss,
+            .hash_func = g_direct_hash, .equal_func = g_direct_equal
+        };
+        run_workload(bench, &ints);
+
+        Workload strings = {
+            .strings = TRUE, .n = sizes[i], .n_miss = n_miss,
+            .key_data = make_keys('k', sizes[i]), .miss_data = make_keys('m', n_miss),
+            .hash_func = g_str_hash, .equal_func = g_str_equal
+        };
+        run_workload(bench, &strings);
+        g_free(strings.key_data);
+        g_free(strings.miss_data);
+    }
+
+    g_print("\n=== Key Points ===\n");
+    g_print("1. Control bytes are probed %u at a time (%s); most misses never touch a key\n",
+            swiss_table_group_width(), swiss_table_group_impl());
+    g_print("2. Keys and values live in one flat array: no per-entry allocation\n");
+    g_print("3. GHashTable also probes open addresses, but one hash slot at a time\n");
+    g_print("4. g_str_hash dominates string lookups: hash once, use the _with_hash calls\n");
+
+    bench_free(bench);
+    return 0;
+}
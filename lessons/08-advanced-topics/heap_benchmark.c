@@ -0,0 +1,222 @@
+/*
+ * heap_benchmark.c - d-ary heap vs sorted GQueue priority queue
+ *
+ * For 1k, 100k and 1M items, times pushing every item and then popping
+ * them all with:
+ *   - the sorted-GQueue PriorityQueue that custom_data_structure.c used
+ *     to have (g_queue_insert_sorted(): O(n) per push)
+ *   - DaryHeap with arity 2 (binary heap) and 4
+ *   - DaryHeap built with dary_heap_new_from_array() (O(n) heapify)
+ *   - DaryHeap with n/10 in-place priority updates before draining
+ *
+ * Each is a bench_run_ops() case where one iteration is the whole push
+ * and drain, so ns/op is per item. The sorted GQueue is O(n) per item,
+ * so above [max-baseline] items (default 10000) it isn't run and its
+ * time is extrapolated from the largest measured size.
+ *
+ * Usage: ./heap_benchmark [max-baseline] [--bench-...]
+ */
+
+#include "bench.h"
+#include "dary_heap.h"
+
+static guint32 rng_state = 2463534242u;
+
+static inline guint32 xorshift32(void)
+{
+    guint32 x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_state = x;
+}
+
+/* ============================================================
+ * Baseline: the sorted GQueue priority queue
+ * ============================================================ */
+
+typedef struct {
+    gpointer data;
+    gint priority;
+} PriorityItem;
+
+static gint compare_priority(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    const PriorityItem *item_a = a;
+    const PriorityItem *item_b = b;
+    return item_b->priority - item_a->priority;
+}
+
+static void run_gqueue(const gint64 *priorities, gsize n)
+{
+    GQueue *queue = g_queue_new();
+
+    for (gsize i = 0; i < n; i++) {
+        PriorityItem *item = g_new(PriorityItem, 1);
+        item->data = NULL;
+        item->priority = (gint)priorities[i];
+        g_queue_insert_sorted(queue, item, compare_priority, NULL);
+    }
+    while (!g_queue_is_empty(queue)) {
+        g_free(g_queue_pop_head(queue));
+    }
+
+    g_queue_free(queue);
+}
+
+/* ============================================================
+ * DaryHeap variants
+ * ============================================================ */
+
+static void run_heap(const gint64 *priorities, gsize n, guint arity)
+{
+    DaryHeap *heap = dary_heap_new(arity);
+
+    for (gsize i = 0; i < n; i++) {
+        dary_heap_push(heap, priorities[i], NULL);
+    }
+    while (!dary_heap_is_empty(heap)) {
+        dary_heap_pop(heap, NULL);
+    }
+
+    dary_heap_free(heap, NULL);
+}
+
+static void run_heapify(const gint64 *priorities, gsize n)
+{
+    DaryHeap *heap = dary_heap_new_from_array(0, priorities, NULL, n, NULL);
+
+    while (!dary_heap_is_empty(heap)) {
+        dary_heap_pop(heap, NULL);
+    }
+
+    dary_heap_free(heap, NULL);
+}
+
+static void run_updates(const gint64 *priorities, gsize n)
+{
+    DaryHeap *heap = dary_heap_new(0);
+    DaryHeapHandle *handles = g_new(DaryHeapHandle, n);
+
+    for (gsize i = 0; i < n; i++) {
+        handles[i] = dary_heap_push(heap, priorities[i], NULL);
+    }
+    for (gsize i = 0; i < n / 10; i++) {
+        gsize victim = xorshift32() % n;
+        dary_heap_update(heap, handles[victim], xorshift32() % 1000000);
+    }
+    while (!dary_heap_is_empty(heap)) {
+        dary_heap_pop(heap, NULL);
+    }
+
+    dary_heap_free(heap, NULL);
+    g_free(handles);
+}
+
+/* ============================================================
+ * Driver
+ * ============================================================ */
+
+typedef enum {
+    VARIANT_GQUEUE,
+    VARIANT_BINARY,
+    VARIANT_QUATERNARY,
+    VARIANT_HEAPIFY,
+    VARIANT_UPDATES
+} Variant;
+
+static const gchar *variant_names[] = { "sorted GQueue", "d=2", "d=4", "heapify", "d=4+updates" };
+
+typedef struct {
+    const gint64 *priorities;
+    gsize n;
+    Variant variant;
+} Run;
+
+static void heap_bench(guint64 iterations, gpointer user_data)
+{
+    Run *run = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        switch (run->variant) {
+        case VARIANT_GQUEUE:
+            run_gqueue(run->priorities, run->n);
+            break;
+        case VARIANT_BINARY:
+            run_heap(run->priorities, run->n, 2);
+            break;
+        case VARIANT_QUATERNARY:
+            run_heap(run->priorities, run->n, 4);
+            break;
+        case VARIANT_HEAPIFY:
+            run_heapify(run->priorities, run->n);
+            break;
+        case VARIANT_UPDATES:
+            run_updates(run->priorities, run->n);
+            break;
+        }
+    }
+}
+
+/* The median ns per item */
+static gdouble run_variant(Bench *bench, Run *run, Variant variant)
+{
+    gchar *name = g_strdup_printf("%s %" G_GSIZE_FORMAT, variant_names[variant], run->n);
+    const BenchResult *result;
+
+    run->variant = variant;
+    result = bench_run_ops(bench, name, run->n, heap_bench, run);
+    g_free(name);
+    return result->median_ns;
+}
+
+int main(int argc, char *argv[])
+{
+    static const gsize sizes[] = { 1000, 100000, 1000000 };
+    Bench *bench = bench_new("heap_benchmark", &argc, &argv);
+    gsize max_baseline = (argc > 1) ? g_ascii_strtoull(argv[1], NULL, 10) : 10000;
+    gsize measured_n = 0;
+    gdouble measured_ns = 0;
+
+    g_print("=== Priority Queue Benchmark ===\n\n");
+    g_print("Push n random priorities, then pop all, per item\n");
+
+    for (guint s = 0; s < G_N_ELEMENTS(sizes); s++) {
+        Run run = { .n = sizes[s] };
+        gint64 *priorities = g_new(gint64, run.n);
+
+        for (gsize i = 0; i < run.n; i++) {
+            priorities[i] = xorshift32() % 1000000;
+        }
+        run.priorities = priorities;
+
+        g_print("\n%" G_GSIZE_FORMAT " items:\n", run.n);
+        if (run.n <= max_baseline) {
+            measured_ns = run_variant(bench, &run, VARIANT_GQUEUE);
+            measured_n = run.n;
+        } else if (measured_n > 0) {
+            /* O(n) per item: scale by the size ratio */
+            g_print("  %-28s ~%.0f ns/op (est. from %" G_GSIZE_FORMAT " items)\n",
+                    variant_names[VARIANT_GQUEUE],
+                    measured_ns * run.n / measured_n, measured_n);
+        } else {
+            g_print("  %-28s skipped\n", variant_names[VARIANT_GQUEUE]);
+        }
+
+        for (Variant v = VARIANT_BINARY; v <= VARIANT_UPDATES; v++) {
+            run_variant(bench, &run, v);
+        }
+
+        g_free(priorities);
+    }
+
+    g_print("\n=== Key Points ===\n");
+    g_print("- g_queue_insert_sorted() walks a linked list: O(n) per push, cache misses per step\n");
+    g_print("- An array heap is O(log n) per op and touches contiguous memory\n");
+    g_print("- d=4 halves the tree depth of a binary heap; children share cache lines\n");
+    g_print("- Bulk heapify builds the heap in O(n) instead of O(n log n)\n");
+    g_print("- Handles allow O(log n) priority changes without searching\n");
+
+    bench_free(bench);
+    return 0;
+}
@@ -0,0 +1,741 @@
+/*
+ * loop_monitor.c - Main-loop instrumentation: dispatch, ready delay,
+ * lag and poll histograms
+ *
+ * See loop_monitor.h for the API. Each instrumented source gets its own
+ * Wrapper: a GSourceFuncs table (what GLib calls), the original table,
+ * and the moment the source was first seen ready. GLib only reaches the
+ * source through source->source_funcs, so the wrapper finds itself from
+ * the source with one cast and needs no lookup.
+ *
+ * The probe source runs at PROBE_PRIORITY, ahead of every other source,
+ * so its prepare marks the start of the iteration. Poll itself is timed
+ * by wrapping the context's poll function, which GLib calls on the
+ * iterating thread after every prepare; the probe's prepare tells it,
+ * through a GPrivate, which monitor is polling. Timing poll from the
+ * probe's prepare to its check would add every other source's prepare
+ * and check to it. Wrapped sources reuse the timestamps for "ready": one
+ * that reports ready from prepare was ready when the iteration began,
+ * and one that reports ready from check was ready when poll returned.
+ * Sources that are woken by a ready time (timeouts, for example) were
+ * ready at that time, which GLib reports in the same clock as ours.
+ */
+
+#include "loop_monitor.h"
+
+#include <string.h>
+#include <time.h>
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define HAVE_SDT 1
+#endif
+#endif
+
+#ifdef HAVE_SDT
+#define PROBE_POLL(ns) DTRACE_PROBE1(glib_tutorial, loop_poll, ns)
+#define PROBE_LAG(ns) DTRACE_PROBE1(glib_tutorial, loop_lag, ns)
+#define PROBE_DISPATCH(name, ns, ready_ns) \
+    DTRACE_PROBE3(glib_tutorial, source_dispatch, name, ns, ready_ns)
+#else
+#define PROBE_POLL(ns) ((void)0)
+#define PROBE_LAG(ns) ((void)0)
+#define PROBE_DISPATCH(name, ns, ready_ns) ((void)0)
+#endif
+
+#define SUB_BITS LOOP_HISTOGRAM_SUB_BITS
+#define SUB_COUNT (1 << SUB_BITS)
+#define SUB_MASK (SUB_COUNT - 1)
+
+#define PROBE_PRIORITY (G_PRIORITY_HIGH - 1000)
+
+typedef struct {
+    gchar *name;
+    LoopHistogram dispatch;
+    LoopHistogram ready_delay;
+} Series;
+
+struct _LoopMonitor {
+    gint ref_count;                  /* Atomic: the owner's and one per wrapper */
+    GMainContext *context;
+    GSource *probe;
+    GSource *dump;
+    GSocketService *service;
+
+    GPollFunc poll_func;             /* The context's own, which we wrap */
+    gboolean wraps_poll;             /* FALSE if another monitor already does */
+    guint64 iteration_ns;            /* When the probe was prepared */
+    guint64 poll_end_ns;             /* When poll returned, 0 before the first */
+    LoopHistogram poll;
+    LoopHistogram lag;
+
+    GHashTable *series_by_name;
+    GPtrArray *series;               /* In creation order, for output */
+};
+
+typedef struct {
+    GSource source;
+    LoopMonitor *monitor;
+} ProbeSource;
+
+typedef struct {
+    GSourceFuncs funcs;              /* Handed to g_source_set_funcs(); first */
+    const GSourceFuncs *inner;
+    LoopMonitor *monitor;
+    Series *series;
+    guint64 ready_ns;                /* 0 = not seen ready since its last dispatch */
+} Wrapper;
+
+#define WRAPPER(source) ((Wrapper *)(source)->source_funcs)
+
+static guint64 now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (guint64)ts.tv_sec * G_GUINT64_CONSTANT(1000000000) + ts.tv_nsec;
+}
+
+/* ============================================================
+ * Histograms
+ * ============================================================ */
+
+static guint bucket_index(guint64 ns)
+{
+    guint exponent;
+
+    if (ns < SUB_COUNT) {
+        return (guint)ns;
+    }
+    exponent = 63 - __builtin_clzll(ns);
+    return ((exponent - SUB_BITS + 1) << SUB_BITS) | ((ns >> (exponent - SUB_BITS)) & SUB_MASK);
+}
+
+static guint64 bucket_lower(guint index)
+{
+    guint exponent;
+
+    if (index < SUB_COUNT) {
+        return index;
+    }
+    exponent = (index >> SUB_BITS) + SUB_BITS - 1;
+    return (guint64)(SUB_COUNT | (index & SUB_MASK)) << (exponent - SUB_BITS);
+}
+
+static guint64 bucket_upper(guint index)
+{
+    return (index + 1 < LOOP_HISTOGRAM_BUCKETS) ? bucket_lower(index + 1) - 1 : G_MAXUINT64;
+}
+
+static void record(LoopHistogram *histogram, guint64 ns)
+{
+    histogram->count++;
+    histogram->sum_ns += ns;
+    histogram->max_ns = MAX(histogram->max_ns, ns);
+    histogram->buckets[bucket_index(ns)]++;
+}
+
+guint64 loop_histogram_quantile(const LoopHistogram *histogram, gdouble fraction)
+{
+    guint64 seen = 0;
+
+    g_return_val_if_fail(histogram != NULL, 0);
+
+    if (histogram->count == 0) {
+        return 0;
+    }
+    for (guint i = 0; i < LOOP_HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= fraction * histogram->count) {
+            return MIN(bucket_upper(i), histogram->max_ns);
+        }
+    }
+    return histogram->max_ns;
+}
+
+/* ============================================================
+ * Monitor lifetime
+ * ============================================================ */
+
+static LoopMonitor *monitor_ref(LoopMonitor *monitor)
+{
+    g_atomic_int_inc(&monitor->ref_count);
+    return monitor;
+}
+
+static void series_free(gpointer data)
+{
+    Series *series = data;
+
+    g_free(series->name);
+    g_free(series);
+}
+
+static void monitor_unref(LoopMonitor *monitor)
+{
+    if (!g_atomic_int_dec_and_test(&monitor->ref_count)) {
+        return;
+    }
+    g_hash_table_unref(monitor->series_by_name);
+    g_ptr_array_unref(monitor->series);
+    g_main_context_unref(monitor->context);
+    g_free(monitor);
+}
+
+static Series *get_series(LoopMonitor *monitor, const gchar *name)
+{
+    Series *series = g_hash_table_lookup(monitor->series_by_name, name);
+
+    if (series == NULL) {
+        series = g_new0(Series, 1);
+        series->name = g_strdup(name);
+        g_hash_table_insert(monitor->series_by_name, series->name, series);
+        g_ptr_array_add(monitor->series, series);
+    }
+    return series;
+}
+
+static void drop_source(GSource **source)
+{
+    if (*source) {
+        g_source_destroy(*source);
+        g_source_unref(*source);
+        *source = NULL;
+    }
+}
+
+/* ============================================================
+ * Probe source
+ * ============================================================ */
+
+/* The monitor whose context this thread is between prepare and check in */
+static GPrivate polling_monitor;
+
+static gint monitored_poll(GPollFD *fds, guint n_fds, gint timeout)
+{
+    LoopMonitor *monitor = g_private_get(&polling_monitor);
+    guint64 start, end;
+    gint ret;
+
+    if (monitor == NULL) {
+        return g_poll(fds, n_fds, timeout);
+    }
+
+    start = now_ns();
+    if (monitor->poll_end_ns != 0) {
+        record(&monitor->lag, start - monitor->poll_end_ns);
+        PROBE_LAG(start - monitor->poll_end_ns);
+    }
+    ret = monitor->poll_func(fds, n_fds, timeout);
+    end = now_ns();
+
+    record(&monitor->poll, end - start);
+    PROBE_POLL(end - start);
+    monitor->poll_end_ns = end;
+    return ret;
+}
+
+static gboolean probe_prepare(GSource *source, gint *timeout)
+{
+    LoopMonitor *monitor = ((ProbeSource *)source)->monitor;
+
+    monitor->iteration_ns = now_ns();
+    if (monitor->wraps_poll) {
+        g_private_set(&polling_monitor, monitor);
+    }
+    *timeout = -1;
+    return FALSE;
+}
+
+static gboolean probe_check(GSource *source)
+{
+    LoopMonitor *monitor = ((ProbeSource *)source)->monitor;
+
+    if (monitor->wraps_poll) {
+        g_private_set(&polling_monitor, NULL);
+    }
+    if (monitor->poll_end_ns < monitor->iteration_ns) {
+        /* GLib skipped poll: nothing to wait for and a zero timeout */
+        monitor->poll_end_ns = now_ns();
+    }
+    return FALSE;
+}
+
+static gboolean probe_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+    return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs probe_funcs = {
+    probe_prepare,
+    probe_check,
+    probe_dispatch,
+    NULL,  /* finalize */
+    NULL,  /* closure_callback */
+    NULL   /* closure_marshal */
+};
+
+/* ============================================================
+ * Wrapped sources
+ * ============================================================ */
+
+static gboolean wrapped_prepare(GSource *source, gint *timeout)
+{
+    Wrapper *wrapper = WRAPPER(source);
+
+    if (wrapper->inner->prepare && wrapper->inner->prepare(source, timeout)) {
+        if (wrapper->ready_ns == 0) {
+            wrapper->ready_ns = wrapper->monitor->iteration_ns;
+        }
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static gboolean wrapped_check(GSource *source)
+{
+    Wrapper *wrapper = WRAPPER(source);
+
+    if (wrapper->inner->check && wrapper->inner->check(source)) {
+        if (wrapper->ready_ns == 0) {
+            wrapper->ready_ns = wrapper->monitor->poll_end_ns;
+        }
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static gboolean wrapped_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+    Wrapper *wrapper = WRAPPER(source);
+    Series *series = wrapper->series;
+    guint64 start = now_ns();
+    guint64 ready = wrapper->ready_ns;
+    gint64 ready_time = g_source_get_ready_time(source);
+    gboolean again;
+
+    /* g_get_monotonic_time() is CLOCK_MONOTONIC in microseconds */
+    if (ready_time > 0 && (guint64)ready_time * 1000 <= start &&
+        (ready == 0 || (guint64)ready_time * 1000 < ready)) {
+        ready = (guint64)ready_time * 1000;
+    }
+    if (ready == 0) {
+        ready = wrapper->monitor->poll_end_ns;   /* Ready by the end of poll, at the latest */
+    }
+    wrapper->ready_ns = 0;
+
+    again = wrapper->inner->dispatch(source, callback, user_data);
+
+    guint64 end = now_ns();
+    guint64 delay = (ready != 0 && ready <= start) ? start - ready : 0;
+
+    record(&series->dispatch, end - start);
+    record(&series->ready_delay, delay);
+    PROBE_DISPATCH(series->name, end - start, delay);
+
+    return again;
+}
+
+static void wrapped_finalize(GSource *source)
+{
+    Wrapper *wrapper = WRAPPER(source);
+
+    if (wrapper->inner->finalize) {
+        wrapper->inner->finalize(source);
+    }
+    monitor_unref(wrapper->monitor);
+    g_free(wrapper);
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+LoopMonitor *loop_monitor_new(GMainContext *context)
+{
+    LoopMonitor *monitor = g_new0(LoopMonitor, 1);
+
+    monitor->ref_count = 1;
+    monitor->context = context ? g_main_context_ref(context) : g_main_context_ref(g_main_context_default());
+    monitor->series_by_name = g_hash_table_new(g_str_hash, g_str_equal);
+    monitor->series = g_ptr_array_new_with_free_func(series_free);
+
+    monitor->probe = g_source_new(&probe_funcs, sizeof(ProbeSource));
+    ((ProbeSource *)monitor->probe)->monitor = monitor;
+    g_source_set_priority(monitor->probe, PROBE_PRIORITY);
+    g_source_set_name(monitor->probe, "loop-monitor-probe");
+    g_source_attach(monitor->probe, monitor->context);
+
+    monitor->poll_func = g_main_context_get_poll_func(monitor->context);
+    if (monitor->poll_func == monitored_poll) {
+        g_warning("LoopMonitor: context already monitored; poll and lag not recorded");
+    } else {
+        monitor->wraps_poll = TRUE;
+        g_main_context_set_poll_func(monitor->context, monitored_poll);
+    }
+
+    return monitor;
+}
+
+void loop_monitor_free(LoopMonitor *monitor)
+{
+    g_return_if_fail(monitor != NULL);
+
+    if (monitor->wraps_poll) {
+        if (g_main_context_get_poll_func(monitor->context) == monitored_poll) {
+            g_main_context_set_poll_func(monitor->context, monitor->poll_func);
+        }
+        if (g_private_get(&polling_monitor) == monitor) {
+            g_private_set(&polling_monitor, NULL);
+        }
+    }
+    drop_source(&monitor->probe);
+    drop_source(&monitor->dump);
+    if (monitor->service) {
+        g_signal_handlers_disconnect_by_data(monitor->service, monitor);
+        g_socket_service_stop(monitor->service);
+        g_socket_listener_close(G_SOCKET_LISTENER(monitor->service));
+        g_clear_object(&monitor->service);
+    }
+    monitor_unref(monitor);
+}
+
+void loop_monitor_instrument(LoopMonitor *monitor, GSource *source, const gchar *name)
+{
+    Wrapper *wrapper;
+
+    g_return_if_fail(monitor != NULL);
+    g_return_if_fail(source != NULL);
+    g_return_if_fail(g_source_get_context(source) == NULL);
+
+    if (name == NULL) {
+        name = g_source_get_name(source);
+    }
+    if (name == NULL) {
+        name = "unnamed";
+    }
+
+    wrapper = g_new0(Wrapper, 1);
+    wrapper->inner = source->source_funcs;
+    wrapper->funcs.prepare = wrapped_prepare;
+    wrapper->funcs.check = wrapped_check;
+    wrapper->funcs.dispatch = wrapped_dispatch;
+    wrapper->funcs.finalize = wrapped_finalize;
+    wrapper->funcs.closure_callback = wrapper->inner->closure_callback;
+    wrapper->funcs.closure_marshal = wrapper->inner->closure_marshal;
+    wrapper->monitor = monitor_ref(monitor);
+    wrapper->series = get_series(monitor, name);
+
+    g_source_set_funcs(source, &wrapper->funcs);
+}
+
+const LoopHistogram *loop_monitor_get_poll(LoopMonitor *monitor)
+{
+    return &monitor->poll;
+}
+
+const LoopHistogram *loop_monitor_get_lag(LoopMonitor *monitor)
+{
+    return &monitor->lag;
+}
+
+const LoopHistogram *loop_monitor_get_dispatch(LoopMonitor *monitor, const gchar *name)
+{
+    Series *series = g_hash_table_lookup(monitor->series_by_name, name);
+
+    return series ? &series->dispatch : NULL;
+}
+
+const LoopHistogram *loop_monitor_get_ready_delay(LoopMonitor *monitor, const gchar *name)
+{
+    Series *series = g_hash_table_lookup(monitor->series_by_name, name);
+
+    return series ? &series->ready_delay : NULL;
+}
+
+void loop_monitor_reset(LoopMonitor *monitor)
+{
+    memset(&monitor->poll, 0, sizeof(monitor->poll));
+    memset(&monitor->lag, 0, sizeof(monitor->lag));
+    for (guint i = 0; i < monitor->series->len; i++) {
+        Series *series = g_ptr_array_index(monitor->series, i);
+
+        memset(&series->dispatch, 0, sizeof(series->dispatch));
+        memset(&series->ready_delay, 0, sizeof(series->ready_delay));
+    }
+}
+
+/* ============================================================
+ * Text output
+ * ============================================================ */
+
+static void append_summary_row(GString *out, const gchar *what, const gchar *name,
+                               const LoopHistogram *histogram)
+{
+    gchar *label = name ? g_strdup_printf("%s %s", what, name) : g_strdup(what);
+
+    g_string_append_printf(out, "  %-32s %10" G_GUINT64_FORMAT " %9.1f %9.1f %9.1f %9.1f\n",
+                           label, histogram->count,
+                           loop_histogram_quantile(histogram, 0.50) / 1000.0,
+                           loop_histogram_quantile(histogram, 0.99) / 1000.0,
+                           loop_histogram_quantile(histogram, 0.999) / 1000.0,
+                           histogram->max_ns / 1000.0);
+    g_free(label);
+}
+
+void loop_monitor_format_summary(LoopMonitor *monitor, GString *out)
+{
+    g_return_if_fail(monitor != NULL);
+    g_return_if_fail(out != NULL);
+
+    g_string_append_printf(out, "  %-32s %10s %9s %9s %9s %9s\n",
+                           "(us)", "count", "p50", "p99", "p99.9", "max");
+    append_summary_row(out, "poll", NULL, &monitor->poll);
+    append_summary_row(out, "lag", NULL, &monitor->lag);
+    for (guint i = 0; i < monitor->series->len; i++) {
+        Series *series = g_ptr_array_index(monitor->series, i);
+
+        append_summary_row(out, "dispatch", series->name, &series->dispatch);
+        append_summary_row(out, "ready delay", series->name, &series->ready_delay);
+    }
+}
+
+/* Prometheus bucket bounds, in ns; each is rounded to the histogram's
+ * precision, which is finer than the spacing between them */
+static const guint64 prometheus_bounds_ns[] = {
+    1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 25000000, 50000000,
+    100000000, 250000000, 500000000, 1000000000, 2500000000u, 5000000000u, 10000000000u
+};
+
+/* {source="...",le="..."}; either may be NULL */
+static void append_labels(GString *out, const gchar *source, const gchar *le)
+{
+    if (source == NULL && le == NULL) {
+        return;
+    }
+    g_string_append_c(out, '{');
+    if (source) {
+        g_string_append(out, "source=\"");
+        for (const gchar *p = source; *p; p++) {
+            if (*p == '\\' || *p == '"') {
+                g_string_append_c(out, '\\');
+                g_string_append_c(out, *p);
+            } else if (*p == '\n') {
+                g_string_append(out, "\\n");
+            } else {
+                g_string_append_c(out, *p);
+            }
+        }
+        g_string_append_c(out, '"');
+    }
+    if (le) {
+        g_string_append_printf(out, "%sle=\"%s\"", source ? "," : "", le);
+    }
+    g_string_append_c(out, '}');
+}
+
+static void append_histogram(GString *out, const gchar *metric, const gchar *source,
+                             const LoopHistogram *histogram)
+{
+    gchar number[G_ASCII_DTOSTR_BUF_SIZE];
+    guint64 cumulative = 0;
+    guint bucket = 0;
+
+    for (guint b = 0; b < G_N_ELEMENTS(prometheus_bounds_ns); b++) {
+        while (bucket < LOOP_HISTOGRAM_BUCKETS && bucket_upper(bucket) <= prometheus_bounds_ns[b]) {
+            cumulative += histogram->buckets[bucket++];
+        }
+        g_string_append_printf(out, "%s_bucket", metric);
+        append_labels(out, source, g_ascii_formatd(number, sizeof(number), "%g",
+                                                   prometheus_bounds_ns[b] / 1e9));
+        g_string_append_printf(out, " %" G_GUINT64_FORMAT "\n", cumulative);
+    }
+    g_string_append_printf(out, "%s_bucket", metric);
+    append_labels(out, source, "+Inf");
+    g_string_append_printf(out, " %" G_GUINT64_FORMAT "\n", histogram->count);
+
+    g_string_append_printf(out, "%s_sum", metric);
+    append_labels(out, source, NULL);
+    g_string_append_printf(out, " %s\n", g_ascii_formatd(number, sizeof(number), "%.9g",
+                                                         histogram->sum_ns / 1e9));
+
+    g_string_append_printf(out, "%s_count", metric);
+    append_labels(out, source, NULL);
+    g_string_append_printf(out, " %" G_GUINT64_FORMAT "\n", histogram->count);
+}
+
+static void append_family(GString *out, const gchar *metric, const gchar *help)
+{
+    g_string_append_printf(out, "# HELP %s %s\n# TYPE %s histogram\n", metric, help, metric);
+}
+
+void loop_monitor_format_prometheus(LoopMonitor *monitor, GString *out)
+{
+    g_return_if_fail(monitor != NULL);
+    g_return_if_fail(out != NULL);
+
+    append_family(out, "glib_main_loop_poll_seconds", "Time spent in poll per iteration");
+    append_histogram(out, "glib_main_loop_poll_seconds", NULL, &monitor->poll);
+
+    append_family(out, "glib_main_loop_lag_seconds",
+                  "Time from poll returning to the next iteration starting");
+    append_histogram(out, "glib_main_loop_lag_seconds", NULL, &monitor->lag);
+
+    append_family(out, "glib_source_dispatch_seconds", "Time spent in a source's dispatch");
+    for (guint i = 0; i < monitor->series->len; i++) {
+        Series *series = g_ptr_array_index(monitor->series, i);
+
+        append_histogram(out, "glib_source_dispatch_seconds", series->name, &series->dispatch);
+    }
+
+    append_family(out, "glib_source_ready_delay_seconds",
+                  "Time from a source becoming ready to its dispatch");
+    for (guint i = 0; i < monitor->series->len; i++) {
+        Series *series = g_ptr_array_index(monitor->series, i);
+
+        append_histogram(out, "glib_source_ready_delay_seconds", series->name,
+                         &series->ready_delay);
+    }
+}
+
+/* ============================================================
+ * Periodic dump
+ * ============================================================ */
+
+static gboolean on_dump(gpointer user_data)
+{
+    GString *out = g_string_new("Main loop:\n");
+
+    loop_monitor_format_summary(user_data, out);
+    g_printerr("%s", out->str);
+    g_string_free(out, TRUE);
+    return G_SOURCE_CONTINUE;
+}
+
+void loop_monitor_dump_every(LoopMonitor *monitor, guint interval_s)
+{
+    g_return_if_fail(monitor != NULL);
+
+    drop_source(&monitor->dump);
+    if (interval_s == 0) {
+        return;
+    }
+    monitor->dump = g_timeout_source_new_seconds(interval_s);
+    g_source_set_name(monitor->dump, "loop-monitor-dump");
+    g_source_set_callback(monitor->dump, on_dump, monitor, NULL);
+    g_source_attach(monitor->dump, monitor->context);
+}
+
+/* ============================================================
+ * HTTP endpoint
+ * ============================================================ */
+
+/* One scrape: read the request (any request gets the metrics), write
+ * the response, close. Both steps are async, so a slow client never
+ * blocks the loop being measured. */
+typedef struct {
+    LoopMonitor *monitor;
+    GSocketConnection *connection;
+    GString *response;
+    gchar request[1024];
+} Scrape;
+
+static void scrape_free(Scrape *scrape)
+{
+    g_io_stream_close(G_IO_STREAM(scrape->connection), NULL, NULL);
+    g_object_unref(scrape->connection);
+    if (scrape->response) {
+        g_string_free(scrape->response, TRUE);
+    }
+    monitor_unref(scrape->monitor);
+    g_free(scrape);
+}
+
+static void on_response_written(GObject *stream, GAsyncResult *result, gpointer user_data)
+{
+    g_output_stream_write_all_finish(G_OUTPUT_STREAM(stream), result, NULL, NULL);
+    scrape_free(user_data);
+}
+
+static void on_request_read(GObject *stream, GAsyncResult *result, gpointer user_data)
+{
+    Scrape *scrape = user_data;
+    GString *body;
+
+    if (g_input_stream_read_finish(G_INPUT_STREAM(stream), result, NULL) <= 0) {
+        scrape_free(scrape);
+        return;
+    }
+
+    body = g_string_new(NULL);
+    loop_monitor_format_prometheus(scrape->monitor, body);
+    scrape->response = g_string_new(NULL);
+    g_string_printf(scrape->response,
+                    "HTTP/1.0 200 OK\r\n"
+                    "Content-Type: text/plain; version=0.0.4\r\n"
+                    "Content-Length: %" G_GSIZE_FORMAT "\r\n"
+                    "Connection: close\r\n\r\n%s", body->len, body->str);
+    g_string_free(body, TRUE);
+
+    g_main_context_push_thread_default(scrape->monitor->context);
+    g_output_stream_write_all_async(g_io_stream_get_output_stream(G_IO_STREAM(scrape->connection)),
+                                    scrape->response->str, scrape->response->len,
+                                    G_PRIORITY_DEFAULT, NULL, on_response_written, scrape);
+    g_main_context_pop_thread_default(scrape->monitor->context);
+}
+
+static gboolean on_incoming(GSocketService *service, GSocketConnection *connection,
+                            GObject *source_object, gpointer user_data)
+{
+    Scrape *scrape = g_new0(Scrape, 1);
+
+    scrape->monitor = monitor_ref(user_data);
+    scrape->connection = g_object_ref(connection);
+
+    g_main_context_push_thread_default(scrape->monitor->context);
+    g_input_stream_read_async(g_io_stream_get_input_stream(G_IO_STREAM(connection)),
+                              scrape->request, sizeof(scrape->request),
+                              G_PRIORITY_DEFAULT, NULL, on_request_read, scrape);
+    g_main_context_pop_thread_default(scrape->monitor->context);
+    return TRUE;
+}
+
+guint16 loop_monitor_serve(LoopMonitor *monitor, guint16 port, GError **error)
+{
+    GInetAddress *loopback;
+    GSocketAddress *address;
+    GSocketAddress *effective = NULL;
+    GSocketService *service;
+    gboolean added;
+    guint16 bound = 0;
+
+    g_return_val_if_fail(monitor != NULL, 0);
+    g_return_val_if_fail(monitor->service == NULL, 0);
+
+    /* The service accepts in the thread-default context of its creator */
+    g_main_context_push_thread_default(monitor->context);
+
+    loopback = g_inet_address_new_loopback(G_SOCKET_FAMILY_IPV4);
+    address = g_inet_socket_address_new(loopback, port);
+    service = g_socket_service_new();
+    added = g_socket_listener_add_address(G_SOCKET_LISTENER(service), address,
+                                          G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP,
+                                          NULL, &effective, error);
+    g_object_unref(address);
+    g_object_unref(loopback);
+
+    if (added) {
+        bound = g_inet_socket_address_get_port(G_INET_SOCKET_ADDRESS(effective));
+        g_object_unref(effective);
+        g_signal_connect(service, "incoming", G_CALLBACK(on_incoming), monitor);
+        g_socket_service_start(service);
+        monitor->service = service;
+    } else {
+        g_object_unref(service);
+    }
+
+    g_main_context_pop_thread_default(monitor->context);
+    return bound;
+}
@@ -0,0 +1,195 @@
+/*
+ * loop_monitor_benchmark.c - Cost of main-loop instrumentation
+ *
+ * N_SOURCES always-ready sources (like simple_source_new() in lesson 6's
+ * custom_source.c) each spin for a fixed amount of work per dispatch,
+ * on a private context. For three work sizes, a bench_run_ops() case
+ * iterates the context with and without a LoopMonitor instrumenting
+ * every source, reported per dispatch, and the difference between the
+ * medians is the overhead. Then the histograms of the last instrumented
+ * context, and the head of its Prometheus output.
+ *
+ * With an argument the benchmark then serves the metrics for that many
+ * seconds and dumps a summary every second, so the endpoint can be
+ * scraped: curl http://127.0.0.1:PORT/
+ *
+ * Usage: ./loop_monitor_benchmark [serve-seconds] [--bench-...]
+ */
+
+#include "bench.h"
+#include "loop_monitor.h"
+
+#define N_SOURCES 16
+
+typedef struct {
+    GSource parent;
+    guint spin;
+} WorkSource;
+
+static gboolean work_prepare(GSource *source, gint *timeout)
+{
+    *timeout = 0;
+    return TRUE;
+}
+
+static gboolean work_check(GSource *source)
+{
+    return TRUE;
+}
+
+static gboolean work_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+    for (volatile guint i = 0; i < ((WorkSource *)source)->spin; i++);
+    return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs work_funcs = {
+    work_prepare,
+    work_check,
+    work_dispatch,
+    NULL,  /* finalize */
+    NULL,  /* closure_callback */
+    NULL   /* closure_marshal */
+};
+
+static gboolean on_tick(gpointer user_data)
+{
+    return G_SOURCE_CONTINUE;
+}
+
+/* The monitor's summary and the head of its Prometheus output */
+static void report(LoopMonitor *monitor, GString *out)
+{
+    GString *text = g_string_new(NULL);
+    gchar **lines;
+
+    g_string_truncate(out, 0);
+    loop_monitor_format_summary(monitor, out);
+
+    loop_monitor_format_prometheus(monitor, text);
+    lines = g_strsplit(text->str, "\n", 8);
+    g_string_append(out, "\nPrometheus output (first lines):\n");
+    for (guint i = 0; lines[i] && i < 7; i++) {
+        g_string_append_printf(out, "  %s\n", lines[i]);
+    }
+    g_strfreev(lines);
+    g_string_free(text, TRUE);
+}
+
+static void loop_bench(guint64 iterations, gpointer user_data)
+{
+    GMainContext *context = user_data;
+
+    for (guint64 i = 0; i < iterations; i++) {
+        g_main_context_iteration(context, FALSE);
+    }
+}
+
+/* The median ns per dispatch, instrumented if @report_out isn't NULL,
+ * in which case it gets the report */
+static gdouble run_loop(Bench *bench, guint spin, GString *report_out)
+{
+    GMainContext *context = g_main_context_new();
+    LoopMonitor *monitor = report_out ? loop_monitor_new(context) : NULL;
+    GSource *tick = g_timeout_source_new(1);
+    gchar *name = g_strdup_printf("spin %u %s", spin, monitor ? "monitored" : "plain");
+    gdouble ns;
+
+    for (guint i = 0; i < N_SOURCES; i++) {
+        GSource *source = g_source_new(&work_funcs, sizeof(WorkSource));
+
+        ((WorkSource *)source)->spin = spin;
+        if (monitor) {
+            loop_monitor_instrument(monitor, source, (i % 2) ? "work-odd" : "work-even");
+        }
+        g_source_attach(source, context);
+        g_source_unref(source);
+    }
+    g_source_set_callback(tick, on_tick, NULL, NULL);
+    if (monitor) {
+        loop_monitor_instrument(monitor, tick, "tick-1ms");
+    }
+    g_source_attach(tick, context);
+    g_source_unref(tick);
+
+    ns = bench_run_ops(bench, name, N_SOURCES, loop_bench, context)->median_ns;
+
+    if (monitor) {
+        report(monitor, report_out);
+        loop_monitor_free(monitor);
+    }
+    g_main_context_unref(context);      /* Destroys the work sources */
+    g_free(name);
+    return ns;
+}
+
+static gboolean on_serve_done(gpointer user_data)
+{
+    g_main_loop_quit(user_data);
+    return G_SOURCE_REMOVE;
+}
+
+static void serve(guint seconds)
+{
+    GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+    LoopMonitor *monitor = loop_monitor_new(NULL);
+    GSource *tick = g_timeout_source_new(10);
+    GError *error = NULL;
+    guint16 port = loop_monitor_serve(monitor, 0, &error);
+
+    if (port == 0) {
+        g_printerr("Failed to serve metrics: %s\n", error->message);
+        g_error_free(error);
+        loop_monitor_free(monitor);
+        g_main_loop_unref(loop);
+        return;
+    }
+
+    g_source_set_callback(tick, on_tick, NULL, NULL);
+    loop_monitor_instrument(monitor, tick, "tick-10ms");
+    g_source_attach(tick, NULL);
+    loop_monitor_dump_every(monitor, 1);
+
+    g_print("\nServing on http://127.0.0.1:%u/ for %u s\n", port, seconds);
+    g_timeout_add_seconds(seconds, on_serve_done, loop);
+    g_main_loop_run(loop);
+
+    g_source_destroy(tick);
+    g_source_unref(tick);
+    loop_monitor_free(monitor);
+    g_main_loop_unref(loop);
+}
+
+int main(int argc, char *argv[])
+{
+    static const guint spins[] = { 200, 1000, 5000 };
+    Bench *bench = bench_new("loop_monitor_benchmark", &argc, &argv);
+    guint serve_seconds = (argc > 1) ? (guint)g_ascii_strtoull(argv[1], NULL, 10) : 0;
+    GString *last = g_string_new(NULL);
+
+    g_print("=== Loop Monitor Benchmark ===\n\n");
+    g_print("%d sources, time per dispatch\n", N_SOURCES);
+
+    for (guint s = 0; s < G_N_ELEMENTS(spins); s++) {
+        gdouble plain = run_loop(bench, spins[s], NULL);
+        gdouble monitored = run_loop(bench, spins[s], last);
+
+        g_print("  spin %u: %.1f%% overhead\n", spins[s], (monitored - plain) / plain * 100);
+    }
+
+    g_print("\nLast monitored context:\n%s", last->str);
+    g_string_free(last, TRUE);
+
+    if (serve_seconds > 0) {
+        serve(serve_seconds);
+    }
+
+    g_print("\n=== Key Points ===\n");
+    g_print("- g_source_set_funcs() wraps any unattached source, custom or built in\n");
+    g_print("- Wrapping the context's poll function times poll alone, every iteration\n");
+    g_print("- Log-linear histograms record in O(1) and keep quantiles within 1/16\n");
+    g_print("- Two clock reads per dispatch: overhead shrinks as dispatches grow\n");
+
+    bench_free(bench);
+    return 0;
+}
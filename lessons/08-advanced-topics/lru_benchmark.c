@@ -0,0 +1,311 @@
+/*
+ * lru_benchmark.c - Sharded LRU vs the single-lock LRUCache
+ *
+ * Runs the same mixed get/put workload (90% gets, hot-set skewed keys)
+ * on 1, 2, 4, ... threads against:
+ *   - the LRUCache from custom_data_structure.c behind one global GMutex
+ *     (g_strdup x2 + g_new + a GList node per put)
+ *   - ShardedLru in STRICT mode
+ *   - ShardedLru in CLOCK mode
+ * Each is a bench_run_ops() case where one iteration is one op on every
+ * thread, so ns/op is the inverse of total throughput. The hit rates
+ * follow each thread count.
+ *
+ * Usage: ./lru_benchmark [max-threads] [--bench-...]
+ */
+
+#include "bench.h"
+#include "sharded_lru.h"
+#include <string.h>
+
+#define N_KEYS 100000
+#define CAPACITY_ENTRIES (N_KEYS / 2)
+#define VALUE_SIZE 64
+
+static gchar *keys[N_KEYS];
+static gchar value_template[VALUE_SIZE + 1];
+
+/* ============================================================
+ * Baseline: the lesson's LRUCache plus a global lock
+ * ============================================================ */
+
+typedef struct {
+    GHashTable *table;
+    GQueue *order;
+    guint capacity;
+    guint size;
+    GMutex lock;
+} LRUCache;
+
+typedef struct {
+    gchar *key;
+    gchar *value;
+    GList *node;
+} CacheEntry;
+
+static void cache_entry_free(CacheEntry *entry)
+{
+    g_free(entry->key);
+    g_free(entry->value);
+    g_free(entry);
+}
+
+static LRUCache *lru_cache_new(guint capacity)
+{
+    LRUCache *cache = g_new(LRUCache, 1);
+    cache->table = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                          NULL, (GDestroyNotify)cache_entry_free);
+    cache->order = g_queue_new();
+    cache->capacity = capacity;
+    cache->size = 0;
+    g_mutex_init(&cache->lock);
+    return cache;
+}
+
+static void lru_cache_put(LRUCache *cache, const gchar *key, const gchar *value)
+{
+    g_mutex_lock(&cache->lock);
+
+    CacheEntry *existing = g_hash_table_lookup(cache->table, key);
+
+    if (existing) {
+        g_free(existing->value);
+        existing->value = g_strdup(value);
+        g_queue_unlink(cache->order, existing->node);
+        g_queue_push_head_link(cache->order, existing->node);
+    } else {
+        if (cache->size >= cache->capacity) {
+            GList *last = g_queue_pop_tail_link(cache->order);
+            if (last) {
+                CacheEntry *evicted = last->data;
+                g_hash_table_remove(cache->table, evicted->key);
+                g_list_free(last);
+                cache->size--;
+            }
+        }
+
+        CacheEntry *entry = g_new(CacheEntry, 1);
+        entry->key = g_strdup(key);
+        entry->value = g_strdup(value);
+
+        g_queue_push_head(cache->order, entry);
+        entry->node = cache->order->head;
+
+        g_hash_table_insert(cache->table, entry->key, entry);
+        cache->size++;
+    }
+
+    g_mutex_unlock(&cache->lock);
+}
+
+/* Copies the value out, as the pointer isn't safe once the lock drops */
+static gboolean lru_cache_get(LRUCache *cache, const gchar *key,
+                              gchar *buffer, gsize buffer_size)
+{
+    gboolean found = FALSE;
+
+    g_mutex_lock(&cache->lock);
+
+    CacheEntry *entry = g_hash_table_lookup(cache->table, key);
+    if (entry) {
+        g_queue_unlink(cache->order, entry->node);
+        g_queue_push_head_link(cache->order, entry->node);
+        g_strlcpy(buffer, entry->value, buffer_size);
+        found = TRUE;
+    }
+
+    g_mutex_unlock(&cache->lock);
+    return found;
+}
+
+static void lru_cache_free(LRUCache *cache)
+{
+    g_hash_table_destroy(cache->table);
+    g_queue_free(cache->order);
+    g_mutex_clear(&cache->lock);
+    g_free(cache);
+}
+
+/* ============================================================
+ * Workload
+ * ============================================================ */
+
+typedef struct {
+    LRUCache *baseline;
+    ShardedLru *sharded;
+    guint64 ops;
+    guint32 seed;
+    guint64 gets;
+    guint64 hits;
+} Worker;
+
+static inline guint32 xorshift32(guint32 *state)
+{
+    guint32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/* 80% of accesses go to the first 20% of keys */
+static inline const gchar *pick_key(guint32 *state, gsize *len)
+{
+    guint32 r = xorshift32(state);
+    guint index = (r % 10 < 8) ? (r >> 8) % (N_KEYS / 5) : (r >> 8) % N_KEYS;
+
+    *len = strlen(keys[index]);
+    return keys[index];
+}
+
+static gpointer worker_thread(gpointer data)
+{
+    Worker *worker = (Worker *)data;
+    gchar buffer[VALUE_SIZE + 1];
+
+    for (guint64 i = 0; i < worker->ops; i++) {
+        gsize key_len;
+        const gchar *key = pick_key(&worker->seed, &key_len);
+        gboolean is_put = (xorshift32(&worker->seed) % 10) == 0;
+
+        worker->gets += !is_put;
+        if (worker->baseline) {
+            if (is_put) {
+                lru_cache_put(worker->baseline, key, value_template);
+            } else if (lru_cache_get(worker->baseline, key, buffer, sizeof(buffer))) {
+                worker->hits++;
+            }
+        } else {
+            if (is_put) {
+                sharded_lru_put(worker->sharded, key, key_len, value_template, VALUE_SIZE);
+            } else if (sharded_lru_get(worker->sharded, key, key_len,
+                                       buffer, VALUE_SIZE) >= 0) {
+                worker->hits++;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void prefill(LRUCache *baseline, ShardedLru *sharded)
+{
+    for (guint i = 0; i < CAPACITY_ENTRIES; i++) {
+        if (baseline) {
+            lru_cache_put(baseline, keys[i], value_template);
+        } else {
+            sharded_lru_put(sharded, keys[i], strlen(keys[i]), value_template, VALUE_SIZE);
+        }
+    }
+}
+
+typedef struct {
+    LRUCache *baseline;
+    ShardedLru *sharded;
+    guint n_threads;
+    guint64 gets;                    /* Over every iteration */
+    guint64 hits;
+} Run;
+
+/* Every thread does iterations ops */
+static void lru_bench(guint64 iterations, gpointer user_data)
+{
+    Run *run = user_data;
+    GThread **threads = g_new(GThread *, run->n_threads);
+    Worker *workers = g_new0(Worker, run->n_threads);
+
+    for (guint i = 0; i < run->n_threads; i++) {
+        workers[i].baseline = run->baseline;
+        workers[i].sharded = run->sharded;
+        workers[i].ops = iterations;
+        workers[i].seed = 0x9E3779B9u * (i + 1);
+    }
+
+    for (guint i = 0; i < run->n_threads; i++) {
+        threads[i] = g_thread_new("lru-worker", worker_thread, &workers[i]);
+    }
+    for (guint i = 0; i < run->n_threads; i++) {
+        g_thread_join(threads[i]);
+        run->gets += workers[i].gets;
+        run->hits += workers[i].hits;
+    }
+
+    g_free(threads);
+    g_free(workers);
+}
+
+/* The hit rate, in percent */
+static gdouble run_threads(Bench *bench, const gchar *what,
+                           LRUCache *baseline, ShardedLru *sharded, guint n_threads)
+{
+    Run run = { .baseline = baseline, .sharded = sharded, .n_threads = n_threads };
+    gchar *name = g_strdup_printf("%s %u", what, n_threads);
+
+    bench_run_ops(bench, name, n_threads, lru_bench, &run);
+    g_free(name);
+    return 100.0 * run.hits / MAX(run.gets, 1);
+}
+
+int main(int argc, char *argv[])
+{
+    static const gchar *names[] = { "global lock", "sharded strict", "sharded CLOCK" };
+    Bench *bench = bench_new("lru_benchmark", &argc, &argv);
+    guint max_threads = (argc > 1) ? (guint)g_ascii_strtoull(argv[1], NULL, 10) :
+                                     g_get_num_processors();
+
+    if (max_threads == 0) {
+        g_printerr("Usage: %s [max-threads]\n", argv[0]);
+        bench_free(bench);
+        return 1;
+    }
+
+    for (guint i = 0; i < N_KEYS; i++) {
+        keys[i] = g_strdup_printf("key-%06u", i);
+    }
+    memset(value_template, 'v', VALUE_SIZE);
+
+    g_print("=== LRU Cache Benchmark ===\n\n");
+    g_print("%d keys, capacity %d entries, %d-byte values, 90%% gets\n",
+            N_KEYS, CAPACITY_ENTRIES, VALUE_SIZE);
+    g_print("Time per op, over all threads\n");
+
+    for (guint n = 1; n <= max_threads; n = (n < max_threads) ? MIN(n * 2, max_threads) : n + 1) {
+        gdouble hit_rates[3];
+
+        g_print("\n%u threads:\n", n);
+        LRUCache *baseline = lru_cache_new(CAPACITY_ENTRIES);
+        prefill(baseline, NULL);
+        hit_rates[0] = run_threads(bench, names[0], baseline, NULL, n);
+        lru_cache_free(baseline);
+
+        for (gint mode = 0; mode < 2; mode++) {
+            ShardedLruConfig config = {
+                .n_shards = 64,
+                /* Charged per 128-byte slab class: same entry count */
+                .capacity_bytes = (gsize)CAPACITY_ENTRIES * 128,
+                .mode = (mode == 0) ? SHARDED_LRU_MODE_STRICT : SHARDED_LRU_MODE_CLOCK,
+            };
+            ShardedLru *sharded = sharded_lru_new(&config);
+
+            prefill(NULL, sharded);
+            hit_rates[1 + mode] = run_threads(bench, names[1 + mode], NULL, sharded, n);
+            sharded_lru_free(sharded);
+        }
+
+        g_print("  Hit rate: %s %.1f%%, %s %.1f%%, %s %.1f%%\n",
+                names[0], hit_rates[0], names[1], hit_rates[1], names[2], hit_rates[2]);
+    }
+
+    for (guint i = 0; i < N_KEYS; i++) {
+        g_free(keys[i]);
+    }
+
+    g_print("\n=== Key Points ===\n");
+    g_print("- One lock serialises every op; shards let threads proceed in parallel\n");
+    g_print("- Slab entries with inline key/value remove per-put allocation\n");
+    g_print("- CLOCK hits only set a bit under a read lock, so readers don't serialise\n");
+    g_print("- CLOCK approximates LRU: hit rate stays close to strict mode\n");
+
+    bench_free(bench);
+    return 0;
+}
@@ -0,0 +1,473 @@
+/*
+ * obj_pool.c - Fixed-size object pool with per-thread magazines
+ *
+ * See obj_pool.h for the API. Each thread owning a slot has two
+ * magazines per pool, "loaded" and "previous"; alloc pops from loaded
+ * and free pushes to it, swapping with previous when loaded runs empty
+ * or full. Only when both are exhausted does the thread trade a
+ * magazine with the depot, so a thread alternating alloc and free
+ * around a boundary can't thrash it.
+ *
+ * The depot is two Treiber stacks (full and empty magazines). Magazines
+ * are never freed before the pool, and the stack heads carry a
+ * generation tag next to a 32-bit magazine id, so a plain 64-bit CAS is
+ * ABA-safe.
+ *
+ * Thread slots are process-wide: the first pool call on a thread claims
+ * a slot, and the GPrivate destructor returns it at thread exit. The
+ * slot's magazines, and the objects in them, pass to the next thread
+ * that claims it. Threads beyond MAX_THREAD_SLOTS fall back to the
+ * locked slab path.
+ */
+
+#include "obj_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_LINE 64
+#define MAGAZINE_SIZE 64
+#define SLAB_SIZE (64 * 1024)
+#define MAX_THREAD_SLOTS 256
+#define MAGAZINES_PER_CHUNK 256
+#define MAX_MAGAZINE_CHUNKS 4096
+
+#define POISON_BYTE 0xA5
+#define CANARY_LIVE G_GUINT64_CONSTANT(0x5AFEC0DE5AFEC0DE)
+#define CANARY_FREED G_GUINT64_CONSTANT(0xDEADBEEFDEADBEEF)
+
+typedef struct {
+    guint32 id;
+    guint32 next;                    /* Depot link: id + 1, 0 = end */
+    guint n;
+    gpointer objects[MAGAZINE_SIZE];
+} Magazine;
+
+typedef struct {
+    Magazine *loaded;
+    Magazine *previous;              /* Only set while loaded is */
+} __attribute__((aligned(CACHE_LINE))) ThreadCache;
+
+/* Low 32 bits: top magazine id + 1 (0 = empty); high 32 bits: tag */
+typedef struct {
+    guint64 head;
+} __attribute__((aligned(CACHE_LINE))) Depot;
+
+struct _ObjPool {
+    gsize object_size;
+    gsize stride;
+    ObjPoolFlags flags;
+
+    ThreadCache *caches;             /* Indexed by thread slot */
+    Depot full;
+    Depot empty;
+
+    Magazine **chunks;               /* MAX_MAGAZINE_CHUNKS entries */
+    guint n_magazines;               /* Protected by lock */
+
+    GMutex lock;
+    GPtrArray *slabs;
+    gsize bytes_reserved;
+    guint8 *bump;                    /* Uncarved part of the newest slab */
+    guint8 *bump_end;
+    GPtrArray *loose;                /* Objects freed by slotless threads */
+};
+
+/* g_new0() only guarantees malloc()'s alignment, and the pool embeds
+ * cache-line aligned Depots */
+static gpointer aligned_alloc0(gsize size)
+{
+    void *mem;
+
+    if (posix_memalign(&mem, CACHE_LINE, size) != 0) {
+        g_error("obj_pool: out of memory");
+    }
+    memset(mem, 0, size);
+    return mem;
+}
+
+/* ============================================================
+ * Thread slots
+ * ============================================================ */
+
+static GMutex slot_lock;
+static guint next_slot;
+static guint free_slots[MAX_THREAD_SLOTS];
+static guint n_free_slots;
+
+static void thread_slot_release(gpointer data)
+{
+    guint slot = GPOINTER_TO_UINT(data) - 1;
+
+    if (slot >= MAX_THREAD_SLOTS) {
+        return;
+    }
+
+    g_mutex_lock(&slot_lock);
+    free_slots[n_free_slots++] = slot;
+    g_mutex_unlock(&slot_lock);
+}
+
+static GPrivate thread_slot = G_PRIVATE_INIT(thread_slot_release);
+
+/* Returns MAX_THREAD_SLOTS if every slot is taken */
+static guint thread_slot_get(void)
+{
+    guint value = GPOINTER_TO_UINT(g_private_get(&thread_slot));
+    guint slot;
+
+    if (G_LIKELY(value != 0)) {
+        return value - 1;
+    }
+
+    g_mutex_lock(&slot_lock);
+    if (n_free_slots > 0) {
+        slot = free_slots[--n_free_slots];
+    } else if (next_slot < MAX_THREAD_SLOTS) {
+        slot = next_slot++;
+    } else {
+        slot = MAX_THREAD_SLOTS;
+    }
+    g_mutex_unlock(&slot_lock);
+
+    g_private_set(&thread_slot, GUINT_TO_POINTER(slot + 1));
+    return slot;
+}
+
+/* ============================================================
+ * Debug checks
+ * ============================================================ */
+
+static void debug_check_alloc(ObjPool *pool, gpointer object)
+{
+    const guint8 *bytes = object;
+    guint64 canary = CANARY_LIVE;
+
+    for (gsize i = 0; i < pool->object_size; i++) {
+        if (bytes[i] != POISON_BYTE) {
+            g_error("obj_pool: object %p was modified after being freed", object);
+        }
+    }
+
+    memcpy((guint8 *)object + pool->object_size, &canary, sizeof(canary));
+}
+
+static void debug_check_free(ObjPool *pool, gpointer object)
+{
+    guint64 canary;
+
+    memcpy(&canary, (guint8 *)object + pool->object_size, sizeof(canary));
+    if (canary == CANARY_FREED) {
+        g_error("obj_pool: double free of %p", object);
+    }
+    if (canary != CANARY_LIVE) {
+        g_error("obj_pool: canary after %p overwritten (buffer overflow)", object);
+    }
+
+    canary = CANARY_FREED;
+    memcpy((guint8 *)object + pool->object_size, &canary, sizeof(canary));
+    memset(object, POISON_BYTE, pool->object_size);
+}
+
+/* ============================================================
+ * Slabs (pool->lock held)
+ * ============================================================ */
+
+static gpointer slab_carve_locked(ObjPool *pool)
+{
+    gpointer object;
+
+    if (pool->loose->len > 0) {
+        return g_ptr_array_steal_index_fast(pool->loose, pool->loose->len - 1);
+    }
+
+    if (pool->bump + pool->stride > pool->bump_end) {
+        gsize size = MAX(SLAB_SIZE, pool->stride * MAGAZINE_SIZE);
+        void *slab;
+
+        if (posix_memalign(&slab, CACHE_LINE, size) != 0) {
+            g_error("obj_pool: out of memory");
+        }
+        g_ptr_array_add(pool->slabs, slab);
+        pool->bytes_reserved += size;
+        pool->bump = slab;
+        pool->bump_end = pool->bump + size;
+    }
+
+    object = pool->bump;
+    pool->bump += pool->stride;
+
+    if (pool->flags & OBJ_POOL_DEBUG) {
+        memset(object, POISON_BYTE, pool->object_size);
+    }
+
+    return object;
+}
+
+static gpointer slab_alloc_one(ObjPool *pool)
+{
+    gpointer object;
+
+    g_mutex_lock(&pool->lock);
+    object = slab_carve_locked(pool);
+    g_mutex_unlock(&pool->lock);
+
+    return object;
+}
+
+static void slab_free_one(ObjPool *pool, gpointer object)
+{
+    g_mutex_lock(&pool->lock);
+    g_ptr_array_add(pool->loose, object);
+    g_mutex_unlock(&pool->lock);
+}
+
+static void slab_refill(ObjPool *pool, Magazine *magazine)
+{
+    g_mutex_lock(&pool->lock);
+    while (magazine->n < MAGAZINE_SIZE) {
+        magazine->objects[magazine->n++] = slab_carve_locked(pool);
+    }
+    g_mutex_unlock(&pool->lock);
+}
+
+/* ============================================================
+ * Magazines and the depot
+ * ============================================================ */
+
+static inline Magazine *magazine_lookup(ObjPool *pool, guint32 id)
+{
+    Magazine *chunk = __atomic_load_n(&pool->chunks[id / MAGAZINES_PER_CHUNK],
+                                      __ATOMIC_ACQUIRE);
+    return &chunk[id % MAGAZINES_PER_CHUNK];
+}
+
+/* Returns NULL once MAX_MAGAZINE_CHUNKS are in use */
+static Magazine *magazine_new(ObjPool *pool)
+{
+    Magazine *magazine = NULL;
+
+    g_mutex_lock(&pool->lock);
+    if (pool->n_magazines < MAX_MAGAZINE_CHUNKS * MAGAZINES_PER_CHUNK) {
+        guint32 id = pool->n_magazines++;
+        guint chunk = id / MAGAZINES_PER_CHUNK;
+
+        if (pool->chunks[chunk] == NULL) {
+            __atomic_store_n(&pool->chunks[chunk],
+                             g_new0(Magazine, MAGAZINES_PER_CHUNK), __ATOMIC_RELEASE);
+        }
+        magazine = &pool->chunks[chunk][id % MAGAZINES_PER_CHUNK];
+        magazine->id = id;
+    }
+    g_mutex_unlock(&pool->lock);
+
+    return magazine;
+}
+
+static void depot_push(Depot *depot, Magazine *magazine)
+{
+    guint64 old = __atomic_load_n(&depot->head, __ATOMIC_RELAXED);
+    guint64 new;
+
+    do {
+        __atomic_store_n(&magazine->next, (guint32)old, __ATOMIC_RELAXED);
+        new = (((old >> 32) + 1) << 32) | (magazine->id + 1);
+    } while (!__atomic_compare_exchange_n(&depot->head, &old, new, TRUE,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static Magazine *depot_pop(ObjPool *pool, Depot *depot)
+{
+    guint64 old = __atomic_load_n(&depot->head, __ATOMIC_ACQUIRE);
+    Magazine *magazine;
+    guint64 new;
+
+    do {
+        if ((guint32)old == 0) {
+            return NULL;
+        }
+        magazine = magazine_lookup(pool, (guint32)old - 1);
+        /* May read a link that's already stale; the tag makes the CAS fail */
+        new = (((old >> 32) + 1) << 32) |
+              __atomic_load_n(&magazine->next, __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&depot->head, &old, new, TRUE,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+    return magazine;
+}
+
+static Magazine *magazine_get_empty(ObjPool *pool)
+{
+    Magazine *magazine = depot_pop(pool, &pool->empty);
+    return magazine ? magazine : magazine_new(pool);
+}
+
+/* ============================================================
+ * Per-thread fast paths
+ * ============================================================ */
+
+static gpointer cache_alloc(ObjPool *pool, ThreadCache *cache)
+{
+    Magazine *magazine = cache->loaded;
+
+    if (G_LIKELY(magazine && magazine->n > 0)) {
+        return magazine->objects[--magazine->n];
+    }
+
+    if (cache->previous && cache->previous->n > 0) {
+        cache->loaded = cache->previous;
+        cache->previous = magazine;
+    } else {
+        Magazine *full = depot_pop(pool, &pool->full);
+
+        if (full) {
+            /* Keep one empty magazine for frees, return the other */
+            if (cache->previous) {
+                depot_push(&pool->empty, cache->previous);
+            }
+            cache->previous = cache->loaded;
+            cache->loaded = full;
+        } else {
+            if (cache->loaded == NULL) {
+                cache->loaded = magazine_get_empty(pool);
+                if (cache->loaded == NULL) {
+                    return slab_alloc_one(pool);
+                }
+            }
+            slab_refill(pool, cache->loaded);
+        }
+    }
+
+    magazine = cache->loaded;
+    return magazine->objects[--magazine->n];
+}
+
+static void cache_free(ObjPool *pool, ThreadCache *cache, gpointer object)
+{
+    Magazine *magazine = cache->loaded;
+
+    if (G_LIKELY(magazine && magazine->n < MAGAZINE_SIZE)) {
+        magazine->objects[magazine->n++] = object;
+        return;
+    }
+
+    if (cache->previous && cache->previous->n < MAGAZINE_SIZE) {
+        cache->loaded = cache->previous;
+        cache->previous = magazine;
+    } else {
+        Magazine *empty = magazine_get_empty(pool);
+
+        if (empty == NULL) {
+            slab_free_one(pool, object);
+            return;
+        }
+        /* Both full: hand one to the depot for other threads to allocate from */
+        if (cache->previous) {
+            depot_push(&pool->full, cache->previous);
+        }
+        cache->previous = cache->loaded;
+        cache->loaded = empty;
+    }
+
+    magazine = cache->loaded;
+    magazine->objects[magazine->n++] = object;
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+ObjPool *obj_pool_new(gsize object_size, ObjPoolFlags flags)
+{
+    ObjPool *pool;
+    gsize align = 8;
+    gsize size;
+
+    g_return_val_if_fail(object_size > 0, NULL);
+
+    /* Natural alignment up to 16 bytes, like malloc() */
+    while (align < 16 && align < object_size) {
+        align *= 2;
+    }
+    size = object_size + ((flags & OBJ_POOL_DEBUG) ? sizeof(guint64) : 0);
+
+    pool = aligned_alloc0(sizeof(ObjPool));
+    pool->object_size = object_size;
+    pool->stride = (size + align - 1) & ~(align - 1);
+    pool->flags = flags;
+
+    pool->caches = aligned_alloc0(MAX_THREAD_SLOTS * sizeof(ThreadCache));
+    pool->chunks = g_new0(Magazine *, MAX_MAGAZINE_CHUNKS);
+
+    g_mutex_init(&pool->lock);
+    pool->slabs = g_ptr_array_new_with_free_func(free);
+    pool->loose = g_ptr_array_new();
+
+    return pool;
+}
+
+void obj_pool_destroy(ObjPool *pool)
+{
+    for (guint i = 0; i < MAX_MAGAZINE_CHUNKS && pool->chunks[i]; i++) {
+        g_free(pool->chunks[i]);
+    }
+    g_free(pool->chunks);
+    free(pool->caches);
+
+    g_ptr_array_free(pool->slabs, TRUE);
+    g_ptr_array_free(pool->loose, TRUE);
+    g_mutex_clear(&pool->lock);
+    free(pool);
+}
+
+gpointer obj_pool_alloc(ObjPool *pool)
+{
+    guint slot = thread_slot_get();
+    gpointer object;
+
+    if (G_LIKELY(slot < MAX_THREAD_SLOTS)) {
+        object = cache_alloc(pool, &pool->caches[slot]);
+    } else {
+        object = slab_alloc_one(pool);
+    }
+
+    if (pool->flags & OBJ_POOL_DEBUG) {
+        debug_check_alloc(pool, object);
+    }
+    if (pool->flags & OBJ_POOL_ZERO) {
+        memset(object, 0, pool->object_size);
+    }
+
+    return object;
+}
+
+void obj_pool_free(ObjPool *pool, gpointer object)
+{
+    guint slot;
+
+    if (object == NULL) {
+        return;
+    }
+
+    if (pool->flags & OBJ_POOL_DEBUG) {
+        debug_check_free(pool, object);
+    }
+
+    slot = thread_slot_get();
+    if (G_LIKELY(slot < MAX_THREAD_SLOTS)) {
+        cache_free(pool, &pool->caches[slot], object);
+    } else {
+        slab_free_one(pool, object);
+    }
+}
+
+void obj_pool_get_stats(ObjPool *pool, ObjPoolStats *stats)
+{
+    g_mutex_lock(&pool->lock);
+    stats->object_size = pool->object_size;
+    stats->stride = pool->stride;
+    stats->n_slabs = pool->slabs->len;
+    stats->bytes_reserved = pool->bytes_reserved;
+    stats->n_magazines = pool->n_magazines;
+    g_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,60 @@
+/*
+ * obj_pool.h - Fixed-size object pool with per-thread magazines
+ *
+ * A slab allocator for many objects of one type, in the style of
+ * Bonwick's magazine allocator. Objects are carved out of large slabs;
+ * freed objects go into the calling thread's magazine (a small stack of
+ * pointers), so the common alloc/free is a few loads and stores with no
+ * locking and no atomics. Full and empty magazines are exchanged through
+ * a lock-free depot shared by all threads, which handles objects that
+ * are allocated on one thread and freed on another. Only carving a new
+ * slab takes a lock.
+ *
+ * With OBJ_POOL_DEBUG, freed objects are poisoned and checked on reuse
+ * (use-after-free), and a canary after each object is checked on free
+ * (overflow). Either failure aborts with g_error().
+ */
+
+#ifndef OBJ_POOL_H
+#define OBJ_POOL_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ObjPool ObjPool;
+
+typedef enum {
+    OBJ_POOL_ZERO  = 1 << 0,   /* obj_pool_alloc() returns zeroed memory */
+    OBJ_POOL_DEBUG = 1 << 1    /* Poison freed objects, add canaries */
+} ObjPoolFlags;
+
+typedef struct {
+    gsize object_size;         /* Size requested at creation */
+    gsize stride;              /* Bytes per object including padding/canary */
+    guint n_slabs;
+    gsize bytes_reserved;      /* Slab memory */
+    guint n_magazines;
+} ObjPoolStats;
+
+ObjPool *obj_pool_new(gsize object_size, ObjPoolFlags flags);
+
+/* Frees every slab. Objects still allocated become invalid; no other
+ * thread may be using the pool. */
+void obj_pool_destroy(ObjPool *pool);
+
+gpointer obj_pool_alloc(ObjPool *pool);
+
+/* @object must have come from obj_pool_alloc() on this pool. Any thread
+ * may free it. NULL is ignored. */
+void obj_pool_free(ObjPool *pool, gpointer object);
+
+void obj_pool_get_stats(ObjPool *pool, ObjPoolStats *stats);
+
+/* Typed wrappers, in the style of g_slice_new() */
+#define obj_pool_new_for_type(type, flags) obj_pool_new(sizeof(type), (flags))
+#define obj_pool_alloc_type(pool, type) ((type *)obj_pool_alloc(pool))
+
+G_END_DECLS
+
+#endif /* OBJ_POOL_H */
@@ -6,21 +6,33 @@
  */
 
 #include <glib.h>
+#include "obj_pool.h"
+#include "arena.h"
+#include "bench.h"
+#include "swiss_table.h"
 
-/* Benchmark helper */
-static gdouble benchmark(const gchar *name, void (*func)(gint), gint iterations)
+static Bench *bench = NULL;
+
+typedef struct {
+    void (*func)(gint);
+    gint size;
+} BenchCall;
+
+static void bench_call(guint64 iterations, gpointer user_data)
 {
-    GTimer *timer = g_timer_new();
-    
-    g_timer_start(timer);
-    func(iterations);
-    g_timer_stop(timer);
+    BenchCall *call = user_data;
     
-    gdouble elapsed = g_timer_elapsed(timer, NULL);
-    g_print("  %s: %.4f seconds\n", name, elapsed);
+    for (guint64 i = 0; i < iterations; i++) {
+        call->func(call->size);
+    }
+}
+
+/* Benchmark helper: median seconds for one func(size) call */
+static gdouble benchmark(const gchar *name, void (*func)(gint), gint size)
+{
+    BenchCall call = { func, size };
     
-    g_timer_destroy(timer);
-    return elapsed;
+    return bench_run(bench, name, bench_call, &call)->median_ns / 1e9;
 }
 
 /* ============================================================
@@ -115,6 +127,31 @@ static void test_hash_string_key(gint iterations)
     g_hash_table_destroy(table);
 }
 
+static Arena *request_arena = NULL;
+
+/* Same work as test_hash_string_key(), but keys live in an arena: no
+ * g_free() per key, and one rewind drops the table and every key */
+static void test_hash_string_key_arena(gint iterations)
+{
+    ArenaMark start = arena_mark(request_arena);
+    GHashTable *table = arena_hash_table_new(request_arena, g_str_hash, g_str_equal);
+    
+    for (gint i = 0; i < iterations; i++) {
+        gchar *key = arena_strdup_printf(request_arena, "key_%d", i);
+        g_hash_table_insert(table, key, GINT_TO_POINTER(i));
+    }
+    
+    /* Lookup some values; each temporary key is rewound right away */
+    for (gint i = 0; i < iterations; i += 100) {
+        ArenaMark scratch = arena_mark(request_arena);
+        gchar *key = arena_strdup_printf(request_arena, "key_%d", i);
+        g_hash_table_lookup(table, key);
+        arena_rewind(request_arena, scratch);
+    }
+    
+    arena_rewind(request_arena, start);
+}
+
 static void test_hash_int_key(gint iterations)
 {
     GHashTable *table = g_hash_table_new(g_direct_hash, g_direct_equal);
@@ -131,6 +168,43 @@ static void test_hash_int_key(gint iterations)
     g_hash_table_destroy(table);
 }
 
+/* The same two tests on a SwissTable: flat slots, SIMD-probed */
+static void test_swiss_string_key(gint iterations)
+{
+    SwissTable *table = swiss_table_new_full(g_str_hash, g_str_equal,
+                                             g_free, NULL);
+    
+    for (gint i = 0; i < iterations; i++) {
+        gchar *key = g_strdup_printf("key_%d", i);
+        swiss_table_insert(table, key, GINT_TO_POINTER(i));
+    }
+    
+    /* Lookup some values */
+    for (gint i = 0; i < iterations; i += 100) {
+        gchar *key = g_strdup_printf("key_%d", i);
+        swiss_table_lookup(table, key);
+        g_free(key);
+    }
+    
+    swiss_table_destroy(table);
+}
+
+static void test_swiss_int_key(gint iterations)
+{
+    SwissTable *table = swiss_table_new(g_direct_hash, g_direct_equal);
+    
+    for (gint i = 0; i < iterations; i++) {
+        swiss_table_insert(table, GINT_TO_POINTER(i), GINT_TO_POINTER(i));
+    }
+    
+    /* Lookup some values */
+    for (gint i = 0; i < iterations; i += 100) {
+        swiss_table_lookup(table, GINT_TO_POINTER(i));
+    }
+    
+    swiss_table_destroy(table);
+}
+
 /* ============================================================
  * Memory Allocation Patterns
  * ============================================================ */
@@ -159,11 +233,108 @@ static void test_batch_alloc(gint iterations)
         array[i] = i;
     }
     
+    bench_do_not_optimize(array);   /* Otherwise the stores are dead */
     g_free(array);
 }
 
-int main(void)
+/* ============================================================
+ * Small-Object Allocators: g_new vs g_slice vs ObjPool
+ * ============================================================ */
+
+/* Same shape as lesson 5's DataStruct, with the name inline */
+typedef struct {
+    gint id;
+    gchar name[32];
+    gdouble value;
+} SmallObject;
+
+#define ALLOC_BATCH 1000
+#define ALLOC_THREADS 4
+
+static ObjPool *small_pool = NULL;
+
+static void test_gnew_objects(gint iterations)
+{
+    SmallObject *batch[ALLOC_BATCH];
+    
+    for (gint i = 0; i < iterations; i += ALLOC_BATCH) {
+        for (gint j = 0; j < ALLOC_BATCH; j++) {
+            batch[j] = g_new(SmallObject, 1);
+            batch[j]->id = j;
+        }
+        for (gint j = 0; j < ALLOC_BATCH; j++) {
+            g_free(batch[j]);
+        }
+    }
+}
+
+static void test_gslice_objects(gint iterations)
+{
+    SmallObject *batch[ALLOC_BATCH];
+    
+    for (gint i = 0; i < iterations; i += ALLOC_BATCH) {
+        for (gint j = 0; j < ALLOC_BATCH; j++) {
+            batch[j] = g_slice_new(SmallObject);
+            batch[j]->id = j;
+        }
+        for (gint j = 0; j < ALLOC_BATCH; j++) {
+            g_slice_free(SmallObject, batch[j]);
+        }
+    }
+}
+
+static void test_pool_objects(gint iterations)
 {
+    SmallObject *batch[ALLOC_BATCH];
+    
+    for (gint i = 0; i < iterations; i += ALLOC_BATCH) {
+        for (gint j = 0; j < ALLOC_BATCH; j++) {
+            batch[j] = obj_pool_alloc_type(small_pool, SmallObject);
+            batch[j]->id = j;
+        }
+        for (gint j = 0; j < ALLOC_BATCH; j++) {
+            obj_pool_free(small_pool, batch[j]);
+        }
+    }
+}
+
+typedef struct {
+    BenchCall call;
+    guint64 iterations;
+} ThreadedCall;
+
+static gpointer threaded_bench_thread(gpointer user_data)
+{
+    ThreadedCall *threaded = user_data;
+    bench_call(threaded->iterations, &threaded->call);
+    return NULL;
+}
+
+static void bench_call_threaded(guint64 iterations, gpointer user_data)
+{
+    ThreadedCall threaded = { *(BenchCall *)user_data, iterations };
+    GThread *threads[ALLOC_THREADS];
+    
+    for (gint i = 0; i < ALLOC_THREADS; i++) {
+        threads[i] = g_thread_new("alloc", threaded_bench_thread, &threaded);
+    }
+    for (gint i = 0; i < ALLOC_THREADS; i++) {
+        g_thread_join(threads[i]);
+    }
+}
+
+/* Like benchmark(), but runs @func on ALLOC_THREADS threads at once */
+static gdouble benchmark_threaded(const gchar *name, void (*func)(gint), gint size)
+{
+    BenchCall call = { func, size };
+    
+    return bench_run(bench, name, bench_call_threaded, &call)->median_ns / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    bench = bench_new("performance_tips", &argc, &argv);
+    
     g_print("=== GLib Performance Tips ===\n\n");
     
     /* Test 1: String Building */
@@ -190,12 +361,25 @@ int main(void)
     /* Test 3: Hash Table Keys */
     g_print("\n3. Hash Table Key Types (10000 entries):\n\n");
     
+    request_arena = arena_new(0);
+    
     gdouble str_key_time = benchmark("String keys", test_hash_string_key, 10000);
+    gdouble arena_key_time = benchmark("String keys (arena)", test_hash_string_key_arena, 10000);
     gdouble int_key_time = benchmark("Integer keys (direct)", test_hash_int_key, 10000);
+    gdouble swiss_str_time = benchmark("String keys (SwissTable)", test_swiss_string_key, 10000);
+    gdouble swiss_int_time = benchmark("Integer keys (SwissTable)", test_swiss_int_key, 10000);
+    
+    arena_free(request_arena);
     
     g_print("\n  Result: Integer keys are %.1fx faster\n", 
             str_key_time / int_key_time);
+    g_print("  Result: Arena string keys are %.1fx faster than g_strdup'd keys\n",
+            str_key_time / arena_key_time);
+    g_print("  Result: SwissTable is %.1fx / %.1fx faster for string / integer keys\n",
+            str_key_time / swiss_str_time, int_key_time / swiss_int_time);
     g_print("  Tip: Use g_direct_hash for integer keys\n");
+    g_print("  Tip: Put short-lived strings that die together in an arena\n");
+    g_print("  Tip: See hash_map_benchmark for SwissTable at 10k-100M entries\n");
     
     /* Test 4: Allocation Patterns */
     g_print("\n4. Allocation Patterns (10000 integers):\n\n");
@@ -207,6 +391,27 @@ int main(void)
             individual_time / batch_time);
     g_print("  Tip: Allocate in batches when possible\n");
     
+    /* Test 5: Small-object allocators */
+    g_print("\n5. Small-Object Allocators (1000000 x %" G_GSIZE_FORMAT "-byte objects):\n\n",
+            sizeof(SmallObject));
+    
+    small_pool = obj_pool_new_for_type(SmallObject, 0);
+    
+    gdouble gnew_time = benchmark("g_new/g_free", test_gnew_objects, 1000000);
+    benchmark("g_slice_new/g_slice_free", test_gslice_objects, 1000000);
+    gdouble pool_time = benchmark("ObjPool", test_pool_objects, 1000000);
+    
+    g_print("\n  %d threads, 1000000 objects each:\n", ALLOC_THREADS);
+    gdouble gnew_mt_time = benchmark_threaded("g_new/g_free", test_gnew_objects, 1000000);
+    benchmark_threaded("g_slice_new/g_slice_free", test_gslice_objects, 1000000);
+    gdouble pool_mt_time = benchmark_threaded("ObjPool", test_pool_objects, 1000000);
+    
+    obj_pool_destroy(small_pool);
+    
+    g_print("\n  Result: ObjPool is %.1fx faster than g_new (%.1fx with %d threads)\n",
+            gnew_time / pool_time, gnew_mt_time / pool_mt_time, ALLOC_THREADS);
+    g_print("  Tip: g_slice is plain malloc since GLib 2.76; use a pool for hot structs\n");
+    
     /* Summary */
     g_print("\n=== Performance Best Practices ===\n\n");
     
@@ -222,12 +427,15 @@ int main(void)
     
     g_print("Hash Tables:\n");
     g_print("  - Use g_direct_hash for integer keys\n");
-    g_print("  - Consider GTree for sorted iteration\n\n");
+    g_print("  - Consider GTree for sorted iteration, or a BTree once it's large\n");
+    g_print("  - A flat, SIMD-probed table (SwissTable) for large hot maps\n\n");
     
     g_print("Memory:\n");
     g_print("  - Batch allocations when possible\n");
     g_print("  - Use g_new0() only when zero-init needed\n");
-    g_print("  - Pool allocators for many same-size objects\n");
+    g_print("  - Pool allocators (ObjPool) for many same-size objects\n");
+    g_print("  - Arenas for per-request data: one reset instead of many frees\n");
     
+    bench_free(bench);
     return 0;
 }
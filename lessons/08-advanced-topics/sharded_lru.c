@@ -0,0 +1,539 @@
+/*
+ * sharded_lru.c - Sharded, thread-safe LRU cache
+ *
+ * See sharded_lru.h for the API. Every shard owns:
+ *   - a GRWLock (writers for put/remove and STRICT hits, readers for
+ *     CLOCK hits)
+ *   - a chained hash table whose chains run through the entries
+ *   - an intrusive LRU list (head = most recently inserted/used)
+ *   - per-size-class free lists carved out of 64 KiB slab chunks
+ *
+ * Shards are cache-line aligned so two threads locking neighbouring
+ * shards don't bounce the same line. Hits and misses aren't kept in the
+ * shard: a CLOCK hit would then do a second contended RMW on top of
+ * the reader lock. Each thread counts in one of N_COUNTER_STRIPES
+ * padded stripes instead, and the stats add them up.
+ */
+
+#include "sharded_lru.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_LINE 64
+#define MIN_CLASS_SHIFT 6                /* Smallest class is 64 bytes */
+#define N_SIZE_CLASSES 7                 /* 64 .. 4096 bytes */
+#define LARGE_CLASS 0xff
+#define SLAB_CHUNK_SIZE (64 * 1024)
+#define MIN_BUCKETS 16
+#define N_COUNTER_STRIPES 64
+
+typedef struct _LruEntry LruEntry;
+
+struct _LruEntry {
+    LruEntry *hash_next;
+    LruEntry *prev;                      /* Towards the head */
+    LruEntry *next;                      /* Towards the tail; free-list link */
+    guint32 hash;
+    guint32 key_len;
+    guint32 value_len;
+    guint8 size_class;
+    gint referenced;                     /* CLOCK bit, set under the read lock */
+    guint8 data[];                       /* Key bytes, then value bytes */
+};
+
+typedef struct {
+    GRWLock lock;
+
+    LruEntry **buckets;
+    guint n_buckets;                     /* Power of two */
+    guint n_entries;
+
+    LruEntry *head;
+    LruEntry *tail;
+    LruEntry *hand;                      /* CLOCK: next eviction candidate */
+
+    gsize used;
+    gsize capacity;
+
+    LruEntry *free_lists[N_SIZE_CLASSES];
+    GPtrArray *chunks;
+
+    guint64 inserts;
+    guint64 evictions;
+} __attribute__((aligned(CACHE_LINE))) LruShard;
+
+/* Lookup counts, for the threads that map to this stripe. Atomic. */
+typedef struct {
+    guint64 hits;
+    guint64 misses;
+} __attribute__((aligned(CACHE_LINE))) LruCounters;
+
+struct _ShardedLru {
+    LruShard *shards;
+    LruCounters *counters;               /* N_COUNTER_STRIPES */
+    guint n_shards;
+    guint shard_bits;
+    ShardedLruMode mode;
+    ShardedLruHashFunc hash_func;
+    ShardedLruEqualFunc equal_func;
+};
+
+/* Each thread's stripe + 1, handed out in turn; 0 = not yet assigned */
+static GPrivate counter_stripe;
+static gint next_stripe;
+
+static LruCounters *thread_counters(ShardedLru *lru)
+{
+    guint stripe = GPOINTER_TO_UINT(g_private_get(&counter_stripe));
+
+    if (stripe == 0) {
+        stripe = (guint)g_atomic_int_add(&next_stripe, 1) % N_COUNTER_STRIPES + 1;
+        g_private_set(&counter_stripe, GUINT_TO_POINTER(stripe));
+    }
+    return &lru->counters[stripe - 1];
+}
+
+/* ============================================================
+ * Default key functions
+ * ============================================================ */
+
+static guint32 fnv1a_hash(gconstpointer key, gsize key_len)
+{
+    const guint8 *p = key;
+    guint32 hash = 2166136261u;
+
+    for (gsize i = 0; i < key_len; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static gboolean bytes_equal(gconstpointer a, gsize a_len,
+                            gconstpointer b, gsize b_len)
+{
+    return a_len == b_len && memcmp(a, b, a_len) == 0;
+}
+
+static inline LruShard *shard_for(ShardedLru *lru, guint32 hash)
+{
+    /* Remix so shard selection and bucket selection use different bits */
+    guint32 mixed = hash * 0x9E3779B1u;
+
+    if (lru->shard_bits == 0) {
+        return &lru->shards[0];
+    }
+    return &lru->shards[mixed >> (32 - lru->shard_bits)];
+}
+
+/* ============================================================
+ * Slab allocation
+ * ============================================================ */
+
+static guint8 size_class_for(gsize total)
+{
+    guint8 class = 0;
+
+    if (total > SHARDED_LRU_MAX_ENTRY_SIZE) {
+        return LARGE_CLASS;
+    }
+
+    while (((gsize)1 << (class + MIN_CLASS_SHIFT)) < total) {
+        class++;
+    }
+    return class;
+}
+
+static inline gsize class_bytes(guint8 class, gsize total)
+{
+    return (class == LARGE_CLASS) ? total : (gsize)1 << (class + MIN_CLASS_SHIFT);
+}
+
+static LruEntry *entry_alloc(LruShard *shard, guint8 class, gsize total)
+{
+    LruEntry *entry;
+
+    if (class == LARGE_CLASS) {
+        entry = g_malloc(total);
+        entry->size_class = LARGE_CLASS;
+        return entry;
+    }
+
+    if (shard->free_lists[class] == NULL) {
+        /* Carve a fresh chunk into entries of this class */
+        gsize size = class_bytes(class, 0);
+        guint8 *chunk = g_malloc(SLAB_CHUNK_SIZE);
+
+        g_ptr_array_add(shard->chunks, chunk);
+        for (gsize off = 0; off + size <= SLAB_CHUNK_SIZE; off += size) {
+            LruEntry *e = (LruEntry *)(chunk + off);
+            e->next = shard->free_lists[class];
+            shard->free_lists[class] = e;
+        }
+    }
+
+    entry = shard->free_lists[class];
+    shard->free_lists[class] = entry->next;
+    entry->size_class = class;
+    return entry;
+}
+
+static void entry_release(LruShard *shard, LruEntry *entry)
+{
+    if (entry->size_class == LARGE_CLASS) {
+        g_free(entry);
+        return;
+    }
+
+    entry->next = shard->free_lists[entry->size_class];
+    shard->free_lists[entry->size_class] = entry;
+}
+
+static inline gsize entry_charge(LruEntry *entry)
+{
+    return class_bytes(entry->size_class,
+                       sizeof(LruEntry) + entry->key_len + entry->value_len);
+}
+
+/* ============================================================
+ * Hash chains and LRU list
+ * ============================================================ */
+
+static LruEntry *shard_lookup(ShardedLru *lru, LruShard *shard, guint32 hash,
+                              gconstpointer key, gsize key_len)
+{
+    LruEntry *entry = shard->buckets[hash & (shard->n_buckets - 1)];
+
+    for (; entry != NULL; entry = entry->hash_next) {
+        if (entry->hash == hash &&
+            lru->equal_func(entry->data, entry->key_len, key, key_len)) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static void shard_grow_buckets(LruShard *shard)
+{
+    guint new_size = shard->n_buckets * 2;
+    LruEntry **buckets = g_new0(LruEntry *, new_size);
+
+    for (guint i = 0; i < shard->n_buckets; i++) {
+        LruEntry *entry = shard->buckets[i];
+
+        while (entry) {
+            LruEntry *next = entry->hash_next;
+            guint index = entry->hash & (new_size - 1);
+
+            entry->hash_next = buckets[index];
+            buckets[index] = entry;
+            entry = next;
+        }
+    }
+
+    g_free(shard->buckets);
+    shard->buckets = buckets;
+    shard->n_buckets = new_size;
+}
+
+static void list_unlink(LruShard *shard, LruEntry *entry)
+{
+    if (shard->hand == entry) {
+        shard->hand = entry->prev;
+    }
+
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        shard->head = entry->next;
+    }
+
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        shard->tail = entry->prev;
+    }
+}
+
+static void list_push_head(LruShard *shard, LruEntry *entry)
+{
+    entry->prev = NULL;
+    entry->next = shard->head;
+
+    if (shard->head) {
+        shard->head->prev = entry;
+    } else {
+        shard->tail = entry;
+    }
+    shard->head = entry;
+}
+
+static void shard_remove(LruShard *shard, LruEntry *entry)
+{
+    LruEntry **link = &shard->buckets[entry->hash & (shard->n_buckets - 1)];
+
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+
+    list_unlink(shard, entry);
+    shard->used -= entry_charge(entry);
+    shard->n_entries--;
+    entry_release(shard, entry);
+}
+
+static void shard_evict_one(ShardedLru *lru, LruShard *shard)
+{
+    LruEntry *victim = shard->tail;
+
+    if (lru->mode == SHARDED_LRU_MODE_CLOCK) {
+        /* Sweep from the tail towards the head, clearing reference bits;
+         * terminates within two passes */
+        victim = shard->hand ? shard->hand : shard->tail;
+        while (g_atomic_int_get(&victim->referenced)) {
+            g_atomic_int_set(&victim->referenced, 0);
+            victim = victim->prev ? victim->prev : shard->tail;
+        }
+        shard->hand = victim;
+    }
+
+    shard->evictions++;
+    shard_remove(shard, victim);
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+ShardedLru *sharded_lru_new(const ShardedLruConfig *config)
+{
+    ShardedLru *lru;
+    void *mem;
+    void *counters;
+    guint n_shards = SHARDED_LRU_DEFAULT_SHARDS;
+    guint buckets;
+
+    g_return_val_if_fail(config != NULL && config->capacity_bytes > 0, NULL);
+
+    if (config->n_shards > 0) {
+        n_shards = 1;
+        while (n_shards < config->n_shards) {
+            n_shards <<= 1;
+        }
+    }
+
+    if (posix_memalign(&mem, CACHE_LINE, n_shards * sizeof(LruShard)) != 0) {
+        return NULL;
+    }
+
+    if (posix_memalign(&counters, CACHE_LINE, N_COUNTER_STRIPES * sizeof(LruCounters)) != 0) {
+        free(mem);
+        return NULL;
+    }
+    memset(counters, 0, N_COUNTER_STRIPES * sizeof(LruCounters));
+
+    lru = g_new0(ShardedLru, 1);
+    lru->shards = mem;
+    lru->counters = counters;
+    lru->n_shards = n_shards;
+    while ((1u << lru->shard_bits) < n_shards) {
+        lru->shard_bits++;
+    }
+    lru->mode = config->mode;
+    lru->hash_func = config->hash_func ? config->hash_func : fnv1a_hash;
+    lru->equal_func = config->equal_func ? config->equal_func : bytes_equal;
+
+    /* Size the tables for ~128-byte entries so they rarely grow */
+    buckets = MIN_BUCKETS;
+    while (buckets < config->capacity_bytes / n_shards / 128) {
+        buckets <<= 1;
+    }
+
+    memset(lru->shards, 0, n_shards * sizeof(LruShard));
+    for (guint i = 0; i < n_shards; i++) {
+        LruShard *shard = &lru->shards[i];
+
+        g_rw_lock_init(&shard->lock);
+        shard->buckets = g_new0(LruEntry *, buckets);
+        shard->n_buckets = buckets;
+        shard->capacity = config->capacity_bytes / n_shards;
+        shard->chunks = g_ptr_array_new_with_free_func(g_free);
+    }
+
+    return lru;
+}
+
+void sharded_lru_free(ShardedLru *lru)
+{
+    for (guint i = 0; i < lru->n_shards; i++) {
+        LruShard *shard = &lru->shards[i];
+
+        /* Slab entries go with their chunks; only large ones are separate */
+        for (LruEntry *entry = shard->head; entry != NULL;) {
+            LruEntry *next = entry->next;
+            if (entry->size_class == LARGE_CLASS) {
+                g_free(entry);
+            }
+            entry = next;
+        }
+
+        g_ptr_array_free(shard->chunks, TRUE);
+        g_free(shard->buckets);
+        g_rw_lock_clear(&shard->lock);
+    }
+
+    free(lru->counters);
+    free(lru->shards);
+    g_free(lru);
+}
+
+gboolean sharded_lru_put(ShardedLru *lru,
+                         gconstpointer key, gsize key_len,
+                         gconstpointer value, gsize value_len)
+{
+    guint32 hash = lru->hash_func(key, key_len);
+    LruShard *shard = shard_for(lru, hash);
+    gsize total = sizeof(LruEntry) + key_len + value_len;
+    guint8 class = size_class_for(total);
+    gsize charge = class_bytes(class, total);
+    LruEntry *entry;
+
+    if (charge > shard->capacity) {
+        return FALSE;
+    }
+
+    g_rw_lock_writer_lock(&shard->lock);
+
+    entry = shard_lookup(lru, shard, hash, key, key_len);
+    if (entry && entry->size_class == class && class != LARGE_CLASS) {
+        /* Same size class: overwrite in place */
+        memcpy(entry->data + key_len, value, value_len);
+        entry->value_len = value_len;
+        if (lru->mode == SHARDED_LRU_MODE_STRICT) {
+            list_unlink(shard, entry);
+            list_push_head(shard, entry);
+        } else {
+            g_atomic_int_set(&entry->referenced, 1);
+        }
+        g_rw_lock_writer_unlock(&shard->lock);
+        return TRUE;
+    }
+
+    if (entry) {
+        shard_remove(shard, entry);
+    }
+
+    while (shard->used + charge > shard->capacity) {
+        shard_evict_one(lru, shard);
+    }
+
+    entry = entry_alloc(shard, class, total);
+    entry->hash = hash;
+    entry->key_len = key_len;
+    entry->value_len = value_len;
+    entry->referenced = 0;
+    memcpy(entry->data, key, key_len);
+    memcpy(entry->data + key_len, value, value_len);
+
+    if (shard->n_entries >= shard->n_buckets) {
+        shard_grow_buckets(shard);
+    }
+
+    guint index = hash & (shard->n_buckets - 1);
+    entry->hash_next = shard->buckets[index];
+    shard->buckets[index] = entry;
+    list_push_head(shard, entry);
+
+    shard->used += charge;
+    shard->n_entries++;
+    shard->inserts++;
+
+    g_rw_lock_writer_unlock(&shard->lock);
+    return TRUE;
+}
+
+gssize sharded_lru_get(ShardedLru *lru,
+                       gconstpointer key, gsize key_len,
+                       gpointer buffer, gsize buffer_size)
+{
+    guint32 hash = lru->hash_func(key, key_len);
+    LruShard *shard = shard_for(lru, hash);
+    gboolean clock = (lru->mode == SHARDED_LRU_MODE_CLOCK);
+    LruEntry *entry;
+    gssize result = -1;
+
+    if (clock) {
+        g_rw_lock_reader_lock(&shard->lock);
+    } else {
+        g_rw_lock_writer_lock(&shard->lock);
+    }
+
+    entry = shard_lookup(lru, shard, hash, key, key_len);
+    if (entry) {
+        if (clock) {
+            /* Only write the bit when it changes to keep the line shared */
+            if (!g_atomic_int_get(&entry->referenced)) {
+                g_atomic_int_set(&entry->referenced, 1);
+            }
+        } else if (shard->head != entry) {
+            list_unlink(shard, entry);
+            list_push_head(shard, entry);
+        }
+
+        memcpy(buffer, entry->data + entry->key_len, MIN(buffer_size, entry->value_len));
+        result = entry->value_len;
+        __atomic_fetch_add(&thread_counters(lru)->hits, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&thread_counters(lru)->misses, 1, __ATOMIC_RELAXED);
+    }
+
+    if (clock) {
+        g_rw_lock_reader_unlock(&shard->lock);
+    } else {
+        g_rw_lock_writer_unlock(&shard->lock);
+    }
+
+    return result;
+}
+
+gboolean sharded_lru_remove(ShardedLru *lru, gconstpointer key, gsize key_len)
+{
+    guint32 hash = lru->hash_func(key, key_len);
+    LruShard *shard = shard_for(lru, hash);
+    LruEntry *entry;
+
+    g_rw_lock_writer_lock(&shard->lock);
+
+    entry = shard_lookup(lru, shard, hash, key, key_len);
+    if (entry) {
+        shard_remove(shard, entry);
+    }
+
+    g_rw_lock_writer_unlock(&shard->lock);
+    return entry != NULL;
+}
+
+void sharded_lru_get_stats(ShardedLru *lru, ShardedLruStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    for (guint i = 0; i < lru->n_shards; i++) {
+        LruShard *shard = &lru->shards[i];
+
+        g_rw_lock_writer_lock(&shard->lock);
+        stats->inserts += shard->inserts;
+        stats->evictions += shard->evictions;
+        stats->bytes_used += shard->used;
+        stats->n_entries += shard->n_entries;
+        g_rw_lock_writer_unlock(&shard->lock);
+    }
+
+    for (guint i = 0; i < N_COUNTER_STRIPES; i++) {
+        stats->hits += __atomic_load_n(&lru->counters[i].hits, __ATOMIC_RELAXED);
+        stats->misses += __atomic_load_n(&lru->counters[i].misses, __ATOMIC_RELAXED);
+    }
+}
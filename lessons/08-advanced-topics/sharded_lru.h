@@ -0,0 +1,81 @@
+/*
+ * sharded_lru.h - Sharded, thread-safe LRU cache
+ *
+ * Keys hash to one of N independently locked shards, so threads working
+ * on different keys rarely contend. Each entry is a single slab-allocated
+ * block holding the list/hash links plus the key and value bytes inline:
+ * steady-state put/get does no heap allocation, and the LRU list is
+ * intrusive rather than a separate GList node per entry.
+ *
+ * Capacity is in bytes (key + value + entry overhead, rounded up to the
+ * slab size class) and split evenly across shards.
+ *
+ * In CLOCK mode a hit only sets a reference bit under the shard's read
+ * lock, so concurrent readers never serialise; eviction gives referenced
+ * entries a second chance. STRICT mode keeps exact LRU order and takes
+ * the write lock on every hit.
+ */
+
+#ifndef SHARDED_LRU_H
+#define SHARDED_LRU_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ShardedLru ShardedLru;
+
+typedef guint32 (*ShardedLruHashFunc)(gconstpointer key, gsize key_len);
+typedef gboolean (*ShardedLruEqualFunc)(gconstpointer a, gsize a_len,
+                                        gconstpointer b, gsize b_len);
+
+typedef enum {
+    SHARDED_LRU_MODE_STRICT,   /* Exact LRU, hits take the write lock */
+    SHARDED_LRU_MODE_CLOCK     /* Approximate LRU, hits take the read lock */
+} ShardedLruMode;
+
+#define SHARDED_LRU_DEFAULT_SHARDS 16
+#define SHARDED_LRU_MAX_ENTRY_SIZE 4096   /* Larger entries fall back to g_malloc */
+
+typedef struct {
+    guint n_shards;                 /* Rounded up to a power of two, 0 = default */
+    gsize capacity_bytes;           /* Total across all shards */
+    ShardedLruMode mode;
+    ShardedLruHashFunc hash_func;   /* NULL = FNV-1a over the key bytes */
+    ShardedLruEqualFunc equal_func; /* NULL = length + memcmp */
+} ShardedLruConfig;
+
+typedef struct {
+    guint64 hits;
+    guint64 misses;
+    guint64 inserts;
+    guint64 evictions;
+    gsize bytes_used;
+    guint n_entries;
+} ShardedLruStats;
+
+ShardedLru *sharded_lru_new(const ShardedLruConfig *config);
+void sharded_lru_free(ShardedLru *lru);
+
+/* Copy @key and @value into the cache, replacing any existing value.
+ * Returns FALSE if the entry is larger than a shard's capacity. */
+gboolean sharded_lru_put(ShardedLru *lru,
+                         gconstpointer key, gsize key_len,
+                         gconstpointer value, gsize value_len);
+
+/* Copy up to @buffer_size bytes of the value into @buffer. Returns the
+ * full value length, or -1 if @key isn't cached. The copy happens under
+ * the shard lock, so the result is never torn by a concurrent put. */
+gssize sharded_lru_get(ShardedLru *lru,
+                       gconstpointer key, gsize key_len,
+                       gpointer buffer, gsize buffer_size);
+
+gboolean sharded_lru_remove(ShardedLru *lru, gconstpointer key, gsize key_len);
+
+/* Totals across shards; each shard is read under its own lock, so the
+ * result is not a single atomic snapshot */
+void sharded_lru_get_stats(ShardedLru *lru, ShardedLruStats *stats);
+
+G_END_DECLS
+
+#endif /* SHARDED_LRU_H */
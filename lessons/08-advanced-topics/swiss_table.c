@@ -0,0 +1,567 @@
+/*
+ * swiss_table.c - Open-addressing hash table with SIMD group probing
+ *
+ * See swiss_table.h for the API. The layout follows Abseil's
+ * flat_hash_map:
+ *   - capacity is a power of two and at least one group wide
+ *   - ctrl[] has capacity + GROUP_WIDTH bytes. The last GROUP_WIDTH
+ *     mirror the first, so a group can be loaded at any slot without
+ *     wrapping
+ *   - the mixed hash splits into H1 (the probe start) and H2 (the 7
+ *     bits kept in the control byte)
+ *   - groups are probed triangularly (+1, +2, +3 ... groups), which
+ *     visits every group once because capacity / GROUP_WIDTH is a power
+ *     of two
+ *   - the load factor is kept at or below 7/8, so every probe
+ *     eventually meets an empty byte and stops
+ */
+
+#include "swiss_table.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define GROUP_WIDTH 16
+#define GROUP_IMPL "SSE2"
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define GROUP_WIDTH 8
+#define GROUP_IMPL "NEON"
+#else
+#define GROUP_WIDTH 8   /* SWAR over a guint64 */
+#define GROUP_IMPL "SWAR"
+#endif
+
+#define CTRL_EMPTY ((gint8)-128)     /* 0b10000000 */
+#define CTRL_DELETED ((gint8)-2)     /* 0b11111110 */
+                                     /* Full: 0b0hhhhhhh */
+#define MIN_CAPACITY MAX(GROUP_WIDTH, 16)
+
+typedef struct {
+    gpointer key;
+    gpointer value;
+} Slot;
+
+struct _SwissTable {
+    gint8 *ctrl;                     /* capacity + GROUP_WIDTH bytes */
+    Slot *slots;
+    gsize capacity;                  /* 0 until the first insert */
+    gsize size;
+    gsize growth_left;               /* Inserts into empty slots before a rehash */
+    GHashFunc hash_func;
+    GEqualFunc key_equal_func;
+    GDestroyNotify key_destroy_func;
+    GDestroyNotify value_destroy_func;
+};
+
+/* ============================================================
+ * Groups: match 8 or 16 control bytes at once
+ * ============================================================ */
+
+/* A bitmask with one set bit (SSE2) or one set byte top bit (NEON,
+ * SWAR) per matching slot of the group */
+#if defined(__SSE2__)
+
+typedef guint32 BitMask;
+#define BITMASK_SHIFT 0
+
+static inline BitMask group_match(const gint8 *ctrl, gint8 h2)
+{
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (BitMask)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(h2)));
+}
+
+static inline BitMask group_match_empty(const gint8 *ctrl)
+{
+    return group_match(ctrl, CTRL_EMPTY);
+}
+
+/* Empty and deleted are the only control bytes with the sign bit set */
+static inline BitMask group_match_empty_or_deleted(const gint8 *ctrl)
+{
+    return (BitMask)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+}
+
+static inline guint bitmask_leading_zeros(BitMask mask)
+{
+    return __builtin_clz(mask) - (32 - GROUP_WIDTH);
+}
+
+#elif defined(__ARM_NEON)
+
+typedef guint64 BitMask;
+#define BITMASK_SHIFT 3
+#define MSBS G_GUINT64_CONSTANT(0x8080808080808080)
+
+static inline BitMask group_match(const gint8 *ctrl, gint8 h2)
+{
+    uint8x8_t eq = vceq_s8(vld1_s8(ctrl), vdup_n_s8(h2));
+    return vget_lane_u64(vreinterpret_u64_u8(eq), 0) & MSBS;
+}
+
+static inline BitMask group_match_empty(const gint8 *ctrl)
+{
+    return group_match(ctrl, CTRL_EMPTY);
+}
+
+static inline BitMask group_match_empty_or_deleted(const gint8 *ctrl)
+{
+    uint8x8_t neg = vclt_s8(vld1_s8(ctrl), vdup_n_s8(0));
+    return vget_lane_u64(vreinterpret_u64_u8(neg), 0) & MSBS;
+}
+
+static inline guint bitmask_leading_zeros(BitMask mask)
+{
+    return __builtin_clzll(mask) >> BITMASK_SHIFT;
+}
+
+#else
+
+typedef guint64 BitMask;
+#define BITMASK_SHIFT 3
+#define LSBS G_GUINT64_CONSTANT(0x0101010101010101)
+#define MSBS G_GUINT64_CONSTANT(0x8080808080808080)
+
+static inline guint64 group_load(const gint8 *ctrl)
+{
+    guint64 group;
+    memcpy(&group, ctrl, sizeof(group));
+    return GUINT64_FROM_LE(group);
+}
+
+/* The classic "has zero byte" trick. It can report a false positive
+ * next to a real match; callers compare keys, so that is harmless. */
+static inline BitMask group_match(const gint8 *ctrl, gint8 h2)
+{
+    guint64 x = group_load(ctrl) ^ (LSBS * (guint8)h2);
+    return (x - LSBS) & ~x & MSBS;
+}
+
+/* Exact: top bit set and bit 1 clear is only true for CTRL_EMPTY */
+static inline BitMask group_match_empty(const gint8 *ctrl)
+{
+    guint64 group = group_load(ctrl);
+    return group & ~(group << 6) & MSBS;
+}
+
+static inline BitMask group_match_empty_or_deleted(const gint8 *ctrl)
+{
+    return group_load(ctrl) & MSBS;
+}
+
+static inline guint bitmask_leading_zeros(BitMask mask)
+{
+    return __builtin_clzll(mask) >> BITMASK_SHIFT;
+}
+
+#endif
+
+static inline guint bitmask_lowest(BitMask mask)
+{
+    return __builtin_ctzll(mask) >> BITMASK_SHIFT;
+}
+
+#define bitmask_clear_lowest(mask) ((mask) &= (mask) - 1)
+
+/* ============================================================
+ * Hashing and slots
+ * ============================================================ */
+
+/* Spread the user's 32-bit hash over 64 bits (g_direct_hash is the
+ * identity) and fold the high half back so H2 gets well-mixed bits */
+static inline guint64 mix_hash(guint hash)
+{
+    guint64 mixed = (guint64)hash * G_GUINT64_CONSTANT(0x9E3779B97F4A7C15);
+    return mixed ^ (mixed >> 32);
+}
+
+#define H1(mixed) ((gsize)((mixed) >> 7))
+#define H2(mixed) ((gint8)((mixed) & 0x7f))
+
+static inline gsize capacity_to_growth(gsize capacity)
+{
+    return capacity - capacity / 8;
+}
+
+static inline void set_ctrl(SwissTable *table, gsize i, gint8 h)
+{
+    table->ctrl[i] = h;
+    if (i < GROUP_WIDTH) {
+        table->ctrl[table->capacity + i] = h;
+    }
+}
+
+/* Index of the slot holding @key, or -1 */
+static inline gssize find(SwissTable *table, gconstpointer key, guint hash)
+{
+    guint64 mixed = mix_hash(hash);
+    gsize mask = table->capacity - 1;
+    gsize pos = H1(mixed) & mask;
+    gsize step = 0;
+
+    if (G_UNLIKELY(table->capacity == 0)) {
+        return -1;
+    }
+
+    for (;;) {
+        const gint8 *group = table->ctrl + pos;
+        BitMask match = group_match(group, H2(mixed));
+
+        while (match) {
+            gsize i = (pos + bitmask_lowest(match)) & mask;
+            gpointer slot_key = table->slots[i].key;
+
+            if (slot_key == key ||
+                (table->key_equal_func && table->key_equal_func(slot_key, key))) {
+                return (gssize)i;
+            }
+            bitmask_clear_lowest(match);
+        }
+
+        if (G_LIKELY(group_match_empty(group))) {
+            return -1;
+        }
+        step += GROUP_WIDTH;
+        pos = (pos + step) & mask;
+    }
+}
+
+static gsize find_first_non_full(SwissTable *table, guint64 mixed)
+{
+    gsize mask = table->capacity - 1;
+    gsize pos = H1(mixed) & mask;
+    gsize step = 0;
+
+    for (;;) {
+        BitMask free_slots = group_match_empty_or_deleted(table->ctrl + pos);
+
+        if (free_slots) {
+            return (pos + bitmask_lowest(free_slots)) & mask;
+        }
+        step += GROUP_WIDTH;
+        pos = (pos + step) & mask;
+    }
+}
+
+/* Rebuild into @new_capacity slots; also drops all tombstones */
+static void resize(SwissTable *table, gsize new_capacity)
+{
+    gint8 *old_ctrl = table->ctrl;
+    Slot *old_slots = table->slots;
+    gsize old_capacity = table->capacity;
+    gsize ctrl_bytes = (new_capacity + GROUP_WIDTH + 15) & ~(gsize)15;
+
+    table->ctrl = g_malloc(ctrl_bytes + new_capacity * sizeof(Slot));
+    table->slots = (Slot *)(table->ctrl + ctrl_bytes);
+    table->capacity = new_capacity;
+    table->growth_left = capacity_to_growth(new_capacity) - table->size;
+    memset(table->ctrl, (guint8)CTRL_EMPTY, new_capacity + GROUP_WIDTH);
+
+    for (gsize i = 0; i < old_capacity; i++) {
+        if (old_ctrl[i] >= 0) {
+            guint64 mixed = mix_hash(table->hash_func(old_slots[i].key));
+            gsize target = find_first_non_full(table, mixed);
+
+            set_ctrl(table, target, H2(mixed));
+            table->slots[target] = old_slots[i];
+        }
+    }
+
+    g_free(old_ctrl);
+}
+
+static void grow_for_insert(SwissTable *table)
+{
+    if (table->capacity == 0) {
+        resize(table, MIN_CAPACITY);
+    } else if (table->size <= capacity_to_growth(table->capacity) / 2) {
+        /* Mostly tombstones: clean up in place rather than doubling */
+        resize(table, table->capacity);
+    } else {
+        resize(table, table->capacity * 2);
+    }
+}
+
+static gboolean insert_internal(SwissTable *table, gpointer key, guint hash,
+                                gpointer value, gboolean keep_new_key)
+{
+    gssize found = find(table, key, hash);
+
+    if (found >= 0) {
+        Slot *slot = &table->slots[found];
+
+        if (keep_new_key) {
+            if (table->key_destroy_func) {
+                table->key_destroy_func(slot->key);
+            }
+            slot->key = key;
+        } else if (table->key_destroy_func) {
+            table->key_destroy_func(key);
+        }
+        if (table->value_destroy_func) {
+            table->value_destroy_func(slot->value);
+        }
+        slot->value = value;
+        return FALSE;
+    }
+
+    guint64 mixed = mix_hash(hash);
+    gsize target = 0;
+
+    if (table->capacity) {
+        target = find_first_non_full(table, mixed);
+    }
+    /* Reusing a tombstone doesn't use up growth */
+    if (table->capacity == 0 ||
+        (table->growth_left == 0 && table->ctrl[target] != CTRL_DELETED)) {
+        grow_for_insert(table);
+        target = find_first_non_full(table, mixed);
+    }
+
+    if (table->ctrl[target] == CTRL_EMPTY) {
+        table->growth_left--;
+    }
+    set_ctrl(table, target, H2(mixed));
+    table->slots[target].key = key;
+    table->slots[target].value = value;
+    table->size++;
+    return TRUE;
+}
+
+/* A slot can go back to empty, rather than deleted, if no probe ever
+ * found its group full. That holds if fewer than GROUP_WIDTH slots in a
+ * row around it, including itself, are occupied. */
+static void erase_slot(SwissTable *table, gsize i, gboolean notify)
+{
+    gsize before = (i - GROUP_WIDTH) & (table->capacity - 1);
+    BitMask empty_after = group_match_empty(table->ctrl + i);
+    BitMask empty_before = group_match_empty(table->ctrl + before);
+    gboolean was_never_full = empty_before && empty_after &&
+        bitmask_lowest(empty_after) + bitmask_leading_zeros(empty_before) < GROUP_WIDTH;
+
+    if (notify) {
+        if (table->key_destroy_func) {
+            table->key_destroy_func(table->slots[i].key);
+        }
+        if (table->value_destroy_func) {
+            table->value_destroy_func(table->slots[i].value);
+        }
+    }
+
+    set_ctrl(table, i, was_never_full ? CTRL_EMPTY : CTRL_DELETED);
+    table->growth_left += was_never_full;
+    table->size--;
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+SwissTable *swiss_table_new(GHashFunc hash_func, GEqualFunc key_equal_func)
+{
+    return swiss_table_new_full(hash_func, key_equal_func, NULL, NULL);
+}
+
+SwissTable *swiss_table_new_full(GHashFunc hash_func,
+                                 GEqualFunc key_equal_func,
+                                 GDestroyNotify key_destroy_func,
+                                 GDestroyNotify value_destroy_func)
+{
+    SwissTable *table = g_new0(SwissTable, 1);
+
+    table->hash_func = hash_func ? hash_func : g_direct_hash;
+    table->key_equal_func = key_equal_func;
+    table->key_destroy_func = key_destroy_func;
+    table->value_destroy_func = value_destroy_func;
+    return table;
+}
+
+void swiss_table_destroy(SwissTable *table)
+{
+    swiss_table_remove_all(table);
+    g_free(table->ctrl);
+    g_free(table);
+}
+
+void swiss_table_reserve(SwissTable *table, gsize n)
+{
+    gsize capacity = MIN_CAPACITY;
+
+    while (capacity_to_growth(capacity) < n) {
+        capacity *= 2;
+    }
+    if (capacity > table->capacity) {
+        resize(table, capacity);
+    }
+}
+
+gboolean swiss_table_insert(SwissTable *table, gpointer key, gpointer value)
+{
+    return insert_internal(table, key, table->hash_func(key), value, FALSE);
+}
+
+gboolean swiss_table_replace(SwissTable *table, gpointer key, gpointer value)
+{
+    return insert_internal(table, key, table->hash_func(key), value, TRUE);
+}
+
+gpointer swiss_table_lookup(SwissTable *table, gconstpointer key)
+{
+    gssize i = find(table, key, table->hash_func(key));
+    return (i >= 0) ? table->slots[i].value : NULL;
+}
+
+gboolean swiss_table_lookup_extended(SwissTable *table,
+                                     gconstpointer lookup_key,
+                                     gpointer *orig_key,
+                                     gpointer *value)
+{
+    gssize i = find(table, lookup_key, table->hash_func(lookup_key));
+
+    if (i < 0) {
+        return FALSE;
+    }
+    if (orig_key) {
+        *orig_key = table->slots[i].key;
+    }
+    if (value) {
+        *value = table->slots[i].value;
+    }
+    return TRUE;
+}
+
+gboolean swiss_table_contains(SwissTable *table, gconstpointer key)
+{
+    return find(table, key, table->hash_func(key)) >= 0;
+}
+
+gboolean swiss_table_remove(SwissTable *table, gconstpointer key)
+{
+    gssize i = find(table, key, table->hash_func(key));
+
+    if (i < 0) {
+        return FALSE;
+    }
+    erase_slot(table, i, TRUE);
+    return TRUE;
+}
+
+gboolean swiss_table_steal(SwissTable *table, gconstpointer key)
+{
+    gssize i = find(table, key, table->hash_func(key));
+
+    if (i < 0) {
+        return FALSE;
+    }
+    erase_slot(table, i, FALSE);
+    return TRUE;
+}
+
+void swiss_table_remove_all(SwissTable *table)
+{
+    if (table->capacity == 0) {
+        return;
+    }
+
+    if (table->key_destroy_func || table->value_destroy_func) {
+        for (gsize i = 0; i < table->capacity; i++) {
+            if (table->ctrl[i] >= 0) {
+                if (table->key_destroy_func) {
+                    table->key_destroy_func(table->slots[i].key);
+                }
+                if (table->value_destroy_func) {
+                    table->value_destroy_func(table->slots[i].value);
+                }
+            }
+        }
+    }
+
+    memset(table->ctrl, (guint8)CTRL_EMPTY, table->capacity + GROUP_WIDTH);
+    table->size = 0;
+    table->growth_left = capacity_to_growth(table->capacity);
+}
+
+guint swiss_table_size(SwissTable *table)
+{
+    return (guint)table->size;
+}
+
+void swiss_table_foreach(SwissTable *table, GHFunc func, gpointer user_data)
+{
+    for (gsize i = 0; i < table->capacity; i++) {
+        if (table->ctrl[i] >= 0) {
+            func(table->slots[i].key, table->slots[i].value, user_data);
+        }
+    }
+}
+
+guint swiss_table_foreach_remove(SwissTable *table, GHRFunc func, gpointer user_data)
+{
+    guint removed = 0;
+
+    for (gsize i = 0; i < table->capacity; i++) {
+        if (table->ctrl[i] >= 0 &&
+            func(table->slots[i].key, table->slots[i].value, user_data)) {
+            erase_slot(table, i, TRUE);
+            removed++;
+        }
+    }
+    return removed;
+}
+
+void swiss_table_iter_init(SwissTableIter *iter, SwissTable *table)
+{
+    iter->table = table;
+    iter->index = G_MAXSIZE;   /* Wraps to 0 on the first next() */
+}
+
+gboolean swiss_table_iter_next(SwissTableIter *iter, gpointer *key, gpointer *value)
+{
+    SwissTable *table = iter->table;
+
+    while (++iter->index < table->capacity) {
+        if (table->ctrl[iter->index] >= 0) {
+            if (key) {
+                *key = table->slots[iter->index].key;
+            }
+            if (value) {
+                *value = table->slots[iter->index].value;
+            }
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+void swiss_table_iter_remove(SwissTableIter *iter)
+{
+    g_return_if_fail(iter->index < iter->table->capacity);
+    erase_slot(iter->table, iter->index, TRUE);
+}
+
+guint swiss_table_hash(SwissTable *table, gconstpointer key)
+{
+    return table->hash_func(key);
+}
+
+gpointer swiss_table_lookup_with_hash(SwissTable *table, gconstpointer key, guint hash)
+{
+    gssize i = find(table, key, hash);
+    return (i >= 0) ? table->slots[i].value : NULL;
+}
+
+gboolean swiss_table_insert_with_hash(SwissTable *table, gpointer key, guint hash, gpointer value)
+{
+    return insert_internal(table, key, hash, value, FALSE);
+}
+
+guint swiss_table_group_width(void)
+{
+    return GROUP_WIDTH;
+}
+
+const gchar *swiss_table_group_impl(void)
+{
+    return GROUP_IMPL;
+}
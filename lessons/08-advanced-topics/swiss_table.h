@@ -0,0 +1,88 @@
+/*
+ * swiss_table.h - Open-addressing hash table with SIMD group probing
+ *
+ * A SwissTable keeps one control byte per slot: empty, deleted, or the
+ * low 7 bits of the entry's hash. A lookup loads a group of 16 control
+ * bytes (8 on NEON and the portable fallback) and compares them all with
+ * one SIMD instruction; only slots whose 7 bits match have their keys
+ * compared, so a miss usually touches one cache line of control bytes
+ * and no keys at all.
+ *
+ * Keys and values are stored inline in a flat slot array: there are no
+ * per-entry nodes, and integer keys/values packed with GINT_TO_POINTER()
+ * never leave the table. The hash function's result is remixed, so
+ * g_direct_hash works without clustering.
+ *
+ * The API follows GHashTable's, so code written against it switches over
+ * by renaming calls. The _with_hash variants take a hash computed earlier
+ * with swiss_table_hash(), for code that probes several tables with one
+ * key or already has the hash at hand.
+ *
+ * A SwissTable is not thread-safe and has no reference count.
+ */
+
+#ifndef SWISS_TABLE_H
+#define SWISS_TABLE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _SwissTable SwissTable;
+
+/* Stack-allocated, like GHashTableIter. The table must not be changed
+ * while iterating except through swiss_table_iter_remove(). */
+typedef struct {
+    SwissTable *table;
+    gsize index;
+} SwissTableIter;
+
+SwissTable *swiss_table_new(GHashFunc hash_func, GEqualFunc key_equal_func);
+SwissTable *swiss_table_new_full(GHashFunc hash_func,
+                                 GEqualFunc key_equal_func,
+                                 GDestroyNotify key_destroy_func,
+                                 GDestroyNotify value_destroy_func);
+void swiss_table_destroy(SwissTable *table);
+
+/* Grow once so that @n entries fit without rehashing */
+void swiss_table_reserve(SwissTable *table, gsize n);
+
+/* Same semantics as g_hash_table_insert()/replace(): TRUE if the key
+ * did not exist yet. insert() keeps the old key and frees the new one,
+ * replace() frees the old key. */
+gboolean swiss_table_insert(SwissTable *table, gpointer key, gpointer value);
+gboolean swiss_table_replace(SwissTable *table, gpointer key, gpointer value);
+
+gpointer swiss_table_lookup(SwissTable *table, gconstpointer key);
+gboolean swiss_table_lookup_extended(SwissTable *table,
+                                     gconstpointer lookup_key,
+                                     gpointer *orig_key,
+                                     gpointer *value);
+gboolean swiss_table_contains(SwissTable *table, gconstpointer key);
+
+gboolean swiss_table_remove(SwissTable *table, gconstpointer key);
+gboolean swiss_table_steal(SwissTable *table, gconstpointer key);
+void swiss_table_remove_all(SwissTable *table);
+
+guint swiss_table_size(SwissTable *table);
+
+void swiss_table_foreach(SwissTable *table, GHFunc func, gpointer user_data);
+guint swiss_table_foreach_remove(SwissTable *table, GHRFunc func, gpointer user_data);
+
+void swiss_table_iter_init(SwissTableIter *iter, SwissTable *table);
+gboolean swiss_table_iter_next(SwissTableIter *iter, gpointer *key, gpointer *value);
+void swiss_table_iter_remove(SwissTableIter *iter);
+
+/* Precomputed-hash variants: @hash must be swiss_table_hash(table, key) */
+guint swiss_table_hash(SwissTable *table, gconstpointer key);
+gpointer swiss_table_lookup_with_hash(SwissTable *table, gconstpointer key, guint hash);
+gboolean swiss_table_insert_with_hash(SwissTable *table, gpointer key, guint hash, gpointer value);
+
+/* The probing this build selected: control bytes per group, and "SSE2",
+ * "NEON" or "SWAR" */
+guint swiss_table_group_width(void);
+const gchar *swiss_table_group_impl(void);
+
+G_END_DECLS
+
+#endif /* SWISS_TABLE_H */
@@ -0,0 +1,240 @@
+/*
+ * variant_bulk.c - Zero-copy GVariant arrays for bulk records
+ *
+ * See variant_bulk.h for the API. A blob is:
+ *
+ *   "GVBULK1"  byte order ('l' or 'B')  serialised 'v' value
+ *
+ * where the 'v' carries the value's type string after its data, so
+ * the reader needs no schema. The 8-byte header keeps the payload
+ * 8-byte aligned in a mapping, which GVariant needs to use it in place.
+ */
+
+#include "variant_bulk.h"
+
+#include <string.h>
+
+#define MAGIC "GVBULK1"
+#define HEADER_SIZE 8
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define HOST_ORDER 'l'
+#else
+#define HOST_ORDER 'B'
+#endif
+
+G_DEFINE_QUARK(variant-bulk-error-quark, variant_bulk_error)
+
+/* ============================================================
+ * Layout
+ * ============================================================ */
+
+/* Parse one complete type at *@type, advancing past it */
+static gsize fixed_size_of(const gchar **type, gsize *alignment)
+{
+    gchar c = *(*type)++;
+
+    switch (c) {
+    case 'y': case 'b':
+        *alignment = 1;
+        return 1;
+    case 'n': case 'q':
+        *alignment = 2;
+        return 2;
+    case 'i': case 'u': case 'h':
+        *alignment = 4;
+        return 4;
+    case 'x': case 't': case 'd':
+        *alignment = 8;
+        return 8;
+    case '(': case '{': {
+        gchar end = (c == '(') ? ')' : '}';
+        gsize offset = 0, max_align = 1;
+
+        /* Members are laid out like a C struct, then padded to the
+         * largest alignment; the empty tuple takes one byte */
+        while (**type != end) {
+            gsize member_align;
+            gsize size = fixed_size_of(type, &member_align);
+
+            if (size == 0) {
+                return 0;
+            }
+            offset = (offset + member_align - 1) & ~(member_align - 1);
+            offset += size;
+            max_align = MAX(max_align, member_align);
+        }
+        (*type)++;
+        *alignment = max_align;
+        return offset ? (offset + max_align - 1) & ~(max_align - 1) : 1;
+    }
+    default:
+        /* s, o, g, v, a, m: variable size */
+        return 0;
+    }
+}
+
+gsize variant_bulk_fixed_size(const GVariantType *type, gsize *alignment)
+{
+    /* Not NUL-terminated, but the parser stops at the end of the type */
+    const gchar *p = g_variant_type_peek_string(type);
+    gsize align = 0;
+    gsize size = fixed_size_of(&p, &align);
+
+    if (alignment) {
+        *alignment = size ? align : 0;
+    }
+    return size;
+}
+
+/* ============================================================
+ * Arrays
+ * ============================================================ */
+
+static GVariant *new_array_from_bytes(const GVariantType *element_type, GBytes *bytes)
+{
+    GVariantType *array_type = g_variant_type_new_array(element_type);
+    GVariant *array = g_variant_new_from_bytes(array_type, bytes, TRUE);
+
+    g_variant_type_free(array_type);
+    g_bytes_unref(bytes);
+    return array;
+}
+
+GVariant *variant_bulk_new_array(const GVariantType *element_type,
+                                 gconstpointer data,
+                                 gsize n_elements,
+                                 GDestroyNotify notify,
+                                 gpointer user_data)
+{
+    gsize element_size = variant_bulk_fixed_size(element_type, NULL);
+    GBytes *bytes;
+
+    g_return_val_if_fail(element_size > 0, NULL);
+    g_return_val_if_fail(n_elements <= G_MAXSIZE / element_size, NULL);
+
+    if (notify) {
+        bytes = g_bytes_new_with_free_func(data, n_elements * element_size, notify, user_data);
+    } else {
+        bytes = g_bytes_new_static(data, n_elements * element_size);
+    }
+    return new_array_from_bytes(element_type, bytes);
+}
+
+GVariant *variant_bulk_new_array_take(const GVariantType *element_type,
+                                      gpointer data,
+                                      gsize n_elements)
+{
+    gsize element_size = variant_bulk_fixed_size(element_type, NULL);
+
+    g_return_val_if_fail(element_size > 0, NULL);
+    g_return_val_if_fail(n_elements <= G_MAXSIZE / element_size, NULL);
+
+    return new_array_from_bytes(element_type, g_bytes_new_take(data, n_elements * element_size));
+}
+
+gconstpointer variant_bulk_get_array(GVariant *array, gsize element_size, gsize *n_elements)
+{
+    *n_elements = 0;
+    g_return_val_if_fail(g_variant_is_of_type(array, G_VARIANT_TYPE_ARRAY), NULL);
+
+    if (variant_bulk_fixed_size(g_variant_type_element(g_variant_get_type(array)), NULL) != element_size) {
+        return NULL;
+    }
+    return g_variant_get_fixed_array(array, n_elements, element_size);
+}
+
+/* ============================================================
+ * Blobs
+ * ============================================================ */
+
+GBytes *variant_bulk_serialize(GVariant *value)
+{
+    GVariant *boxed = g_variant_ref_sink(g_variant_new_variant(value));
+    gsize size = g_variant_get_size(boxed);
+    guint8 *blob = g_malloc(HEADER_SIZE + size);
+
+    memcpy(blob, MAGIC, HEADER_SIZE - 1);
+    blob[HEADER_SIZE - 1] = HOST_ORDER;
+    g_variant_store(boxed, blob + HEADER_SIZE);
+
+    g_variant_unref(boxed);
+    return g_bytes_new_take(blob, HEADER_SIZE + size);
+}
+
+/* A 'v' ends with "\0<type string>". GVariant silently substitutes "()"
+ * for a bad type string, so check it here to report corrupt input. */
+static gboolean has_valid_type(const guint8 *data, gsize size)
+{
+    gsize nul = size;
+
+    while (nul > 0 && data[nul - 1] != '\0') {
+        nul--;
+    }
+    if (nul == 0) {
+        return FALSE;
+    }
+
+    gchar *type_string = g_strndup((const gchar *)data + nul, size - nul);
+    gboolean valid = g_variant_type_string_is_valid(type_string);
+
+    g_free(type_string);
+    return valid;
+}
+
+GVariant *variant_bulk_deserialize(GBytes *bytes, GError **error)
+{
+    gsize size;
+    const guint8 *data = g_bytes_get_data(bytes, &size);
+
+    if (size <= HEADER_SIZE || memcmp(data, MAGIC, HEADER_SIZE - 1) != 0 ||
+        (data[HEADER_SIZE - 1] != 'l' && data[HEADER_SIZE - 1] != 'B') ||
+        !has_valid_type(data + HEADER_SIZE, size - HEADER_SIZE)) {
+        g_set_error(error, VARIANT_BULK_ERROR, VARIANT_BULK_ERROR_INVALID,
+                    "Not a variant_bulk blob");
+        return NULL;
+    }
+
+    /* Untrusted: GVariant checks each access, but still reads in place */
+    GBytes *payload = g_bytes_new_from_bytes(bytes, HEADER_SIZE, size - HEADER_SIZE);
+    GVariant *boxed = g_variant_ref_sink(g_variant_new_from_bytes(G_VARIANT_TYPE_VARIANT, payload, FALSE));
+    GVariant *value = g_variant_get_variant(boxed);
+
+    g_variant_unref(boxed);
+    g_bytes_unref(payload);
+
+    if (data[HEADER_SIZE - 1] != HOST_ORDER) {
+        GVariant *swapped = g_variant_byteswap(value);
+        g_variant_unref(value);
+        value = swapped;
+    }
+    return value;
+}
+
+gboolean variant_bulk_save(GVariant *value, const gchar *path, GError **error)
+{
+    GBytes *blob = variant_bulk_serialize(value);
+    gsize size;
+    const gchar *data = g_bytes_get_data(blob, &size);
+    gboolean ok = g_file_set_contents(path, data, size, error);
+
+    g_bytes_unref(blob);
+    return ok;
+}
+
+GVariant *variant_bulk_load(const gchar *path, GError **error)
+{
+    GMappedFile *file = g_mapped_file_new(path, FALSE, error);
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    /* The GBytes keeps the mapping alive after the file is unreffed */
+    GBytes *bytes = g_mapped_file_get_bytes(file);
+    GVariant *value = variant_bulk_deserialize(bytes, error);
+
+    g_bytes_unref(bytes);
+    g_mapped_file_unref(file);
+    return value;
+}
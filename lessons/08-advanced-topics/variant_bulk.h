@@ -0,0 +1,80 @@
+/*
+ * variant_bulk.h - Zero-copy GVariant arrays for bulk records
+ *
+ * g_variant_builder_add() boxes every element: building an array of a
+ * million records allocates millions of GVariants and then serialises
+ * them one by one. For arrays of fixed-size elements (ai, ad, a(iid),
+ * ...) the serialised form is just the elements back to back in host
+ * byte order, which is how a C array already looks. These helpers wrap
+ * such memory as a GVariant without copying, read it back the same
+ * way, and store or load whole values through a GBytes, so a file can
+ * be mapped and used in place.
+ *
+ * A C struct can stand in for a GVariant tuple when its fields have the
+ * same sizes and offsets. That holds for naturally aligned structs of
+ * gint16/32/64, guint*, gdouble and guchar fields, but not for
+ * gboolean, which is 4 bytes in C and 1 in GVariant ('b').
+ * variant_bulk_fixed_size() gives the GVariant size to check against.
+ *
+ * Stored blobs start with an 8-byte header (magic and byte order);
+ * a blob written on a machine of the other endianness is byteswapped,
+ * and so copied, when loaded.
+ */
+
+#ifndef VARIANT_BULK_H
+#define VARIANT_BULK_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define VARIANT_BULK_ERROR (variant_bulk_error_quark())
+
+typedef enum {
+    VARIANT_BULK_ERROR_INVALID           /* Not a variant_bulk blob, or corrupt */
+} VariantBulkError;
+
+GQuark variant_bulk_error_quark(void);
+
+/* Serialised size of one @type value, or 0 if @type is not fixed-size.
+ * @alignment (may be NULL) receives its alignment. */
+gsize variant_bulk_fixed_size(const GVariantType *type, gsize *alignment);
+
+/* An array of @n_elements @element_type values read straight from
+ * @data, which must hold them in GVariant layout and stay valid until
+ * @notify(@user_data) is called. With a NULL @notify @data must outlive
+ * the variant. @data should be aligned for the element type, or GLib
+ * copies it. Returns a floating reference, like g_variant_new_*(), or
+ * NULL if @element_type is not fixed-size. */
+GVariant *variant_bulk_new_array(const GVariantType *element_type,
+                                 gconstpointer data,
+                                 gsize n_elements,
+                                 GDestroyNotify notify,
+                                 gpointer user_data);
+
+/* Same, taking ownership of g_malloc()ed @data */
+GVariant *variant_bulk_new_array_take(const GVariantType *element_type,
+                                      gpointer data,
+                                      gsize n_elements);
+
+/* The elements of a fixed-size array, in place. @element_size must
+ * match the element type; returns NULL (and *@n_elements 0) otherwise. */
+gconstpointer variant_bulk_get_array(GVariant *array, gsize element_size, gsize *n_elements);
+
+/* Header + serialised @value, with its type included. Like
+ * g_variant_new_variant(), this consumes a floating @value. */
+GBytes *variant_bulk_serialize(GVariant *value);
+
+/* The inverse, returning a full reference. The result shares @bytes
+ * unless it had to be byteswapped. */
+GVariant *variant_bulk_deserialize(GBytes *bytes, GError **error);
+
+gboolean variant_bulk_save(GVariant *value, const gchar *path, GError **error);
+
+/* Maps @path with GMappedFile and deserialises the mapping in place. The
+ * mapping stays alive as long as the returned value. */
+GVariant *variant_bulk_load(const gchar *path, GError **error);
+
+G_END_DECLS
+
+#endif /* VARIANT_BULK_H */
@@ -0,0 +1,277 @@
+/*
+ * variant_bulk_benchmark.c - GVariantBuilder vs bulk arrays vs mmap
+ *
+ * Records per second for telemetry samples of type (iid):
+ *   - build:  GVariantBuilder adding one "(iid)" per record, an a{sv}
+ *             per record with every field boxed, g_variant_new_fixed_array()
+ *             (one copy) and variant_bulk_new_array() (no copy). Each
+ *             build ends with g_variant_get_data(), which forces GLib to
+ *             serialise builder output
+ *   - save:   variant_bulk_serialize() into one blob
+ *   - load:   reading the blob back and summing every value, three ways:
+ *             g_file_get_contents() + GVariantIter, g_file_get_contents()
+ *             + variant_bulk_get_array(), and variant_bulk_load() (mmap)
+ *             + variant_bulk_get_array()
+ *
+ * The load rows include the page cache read, not the disk.
+ *
+ * Usage: ./variant_bulk_benchmark [records] [--bench-...]   (default 1000000)
+ */
+
+#include "bench.h"
+#include "variant_bulk.h"
+
+#include <glib/gstdio.h>
+
+/* The a{sv} row is ~100x slower; time it on fewer records */
+#define MAX_DICT_RECORDS 100000
+
+typedef struct {
+    gint32 sensor;
+    gint32 reading;
+    gdouble value;
+} Sample;
+
+G_STATIC_ASSERT(sizeof(Sample) == 16);
+
+typedef struct {
+    Sample *samples;
+    gsize n;
+    gsize n_dicts;
+    gchar *path;
+} Workload;
+
+#define SAMPLE_TYPE G_VARIANT_TYPE("(iid)")
+#define SAMPLE_ARRAY_TYPE G_VARIANT_TYPE("a(iid)")
+
+/* ============================================================
+ * Build
+ * ============================================================ */
+
+static void builder_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        GVariantBuilder builder;
+
+        g_variant_builder_init(&builder, SAMPLE_ARRAY_TYPE);
+        for (gsize i = 0; i < w->n; i++) {
+            g_variant_builder_add(&builder, "(iid)", w->samples[i].sensor,
+                                  w->samples[i].reading, w->samples[i].value);
+        }
+
+        GVariant *array = g_variant_ref_sink(g_variant_builder_end(&builder));
+        bench_do_not_optimize(g_variant_get_data(array));
+        g_variant_unref(array);
+    }
+}
+
+static void dict_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        GVariantBuilder builder;
+
+        g_variant_builder_init(&builder, G_VARIANT_TYPE("aa{sv}"));
+        for (gsize i = 0; i < w->n_dicts; i++) {
+            g_variant_builder_open(&builder, G_VARIANT_TYPE("a{sv}"));
+            g_variant_builder_add(&builder, "{sv}", "sensor", g_variant_new_int32(w->samples[i].sensor));
+            g_variant_builder_add(&builder, "{sv}", "reading", g_variant_new_int32(w->samples[i].reading));
+            g_variant_builder_add(&builder, "{sv}", "value", g_variant_new_double(w->samples[i].value));
+            g_variant_builder_close(&builder);
+        }
+
+        GVariant *array = g_variant_ref_sink(g_variant_builder_end(&builder));
+        bench_do_not_optimize(g_variant_get_data(array));
+        g_variant_unref(array);
+    }
+}
+
+static void fixed_array_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        GVariant *array = g_variant_ref_sink(
+            g_variant_new_fixed_array(SAMPLE_TYPE, w->samples, w->n, sizeof(Sample)));
+        bench_do_not_optimize(g_variant_get_data(array));
+        g_variant_unref(array);
+    }
+}
+
+static void bulk_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        GVariant *array = g_variant_ref_sink(
+            variant_bulk_new_array(SAMPLE_TYPE, w->samples, w->n, NULL, NULL));
+        bench_do_not_optimize(g_variant_get_data(array));
+        g_variant_unref(array);
+    }
+}
+
+static void serialize_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+    GVariant *array = g_variant_ref_sink(variant_bulk_new_array(SAMPLE_TYPE, w->samples, w->n, NULL, NULL));
+
+    for (guint64 it = 0; it < iterations; it++) {
+        g_bytes_unref(variant_bulk_serialize(array));
+    }
+    g_variant_unref(array);
+}
+
+/* ============================================================
+ * Load
+ * ============================================================ */
+
+static gdouble sum_samples(GVariant *array)
+{
+    gsize n;
+    const Sample *samples = variant_bulk_get_array(array, sizeof(Sample), &n);
+    gdouble sum = 0;
+
+    for (gsize i = 0; i < n; i++) {
+        sum += samples[i].value;
+    }
+    return sum;
+}
+
+static void load_iter_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        gchar *contents;
+        gsize size;
+
+        if (!g_file_get_contents(w->path, &contents, &size, NULL)) {
+            return;
+        }
+
+        GBytes *bytes = g_bytes_new_take(contents, size);
+        GVariant *array = variant_bulk_deserialize(bytes, NULL);
+        GVariantIter iter;
+        gint32 sensor, reading;
+        gdouble value, sum = 0;
+
+        g_variant_iter_init(&iter, array);
+        while (g_variant_iter_next(&iter, "(iid)", &sensor, &reading, &value)) {
+            sum += value;
+        }
+        bench_do_not_optimize(sum);
+
+        g_variant_unref(array);
+        g_bytes_unref(bytes);
+    }
+}
+
+static void load_read_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        gchar *contents;
+        gsize size;
+
+        if (!g_file_get_contents(w->path, &contents, &size, NULL)) {
+            return;
+        }
+
+        GBytes *bytes = g_bytes_new_take(contents, size);
+        GVariant *array = variant_bulk_deserialize(bytes, NULL);
+
+        bench_do_not_optimize(sum_samples(array));
+        g_variant_unref(array);
+        g_bytes_unref(bytes);
+    }
+}
+
+static void load_mmap_bench(guint64 iterations, gpointer user_data)
+{
+    Workload *w = user_data;
+
+    for (guint64 it = 0; it < iterations; it++) {
+        GVariant *array = variant_bulk_load(w->path, NULL);
+
+        if (array == NULL) {
+            return;
+        }
+        bench_do_not_optimize(sum_samples(array));
+        g_variant_unref(array);
+    }
+}
+
+/* ============================================================
+ * Driver
+ * ============================================================ */
+
+static void report(Bench *bench, Workload *w, const gchar *name, gsize records, BenchFunc func)
+{
+    const BenchResult *result = bench_run_ops(bench, name, records, func, w);
+
+    g_print("  %-28s %12.2f M records/s\n", "", 1e3 / result->median_ns);
+}
+
+int main(int argc, char *argv[])
+{
+    Bench *bench = bench_new("variant_bulk_benchmark", &argc, &argv);
+    gsize n = (argc > 1) ? g_ascii_strtoull(argv[1], NULL, 10) : 1000000;
+    GError *error = NULL;
+    Workload w = { 0 };
+
+    if (n == 0) {
+        g_printerr("Usage: %s [records] [--bench-...]\n", argv[0]);
+        return 1;
+    }
+
+    w.n = n;
+    w.n_dicts = MIN(n, MAX_DICT_RECORDS);
+    w.samples = g_new(Sample, n);
+    for (gsize i = 0; i < n; i++) {
+        w.samples[i] = (Sample) { i % 64, (gint32)i, i * 0.25 };
+    }
+
+    g_print("=== GVariant bulk records (%" G_GSIZE_FORMAT " x (iid)) ===\n\n", n);
+
+    report(bench, &w, "build builder a(iid)", w.n, builder_bench);
+    report(bench, &w, "build builder aa{sv}", w.n_dicts, dict_bench);
+    report(bench, &w, "build fixed_array (copy)", w.n, fixed_array_bench);
+    report(bench, &w, "build bulk (no copy)", w.n, bulk_bench);
+    report(bench, &w, "save serialize", w.n, serialize_bench);
+
+    /* Write the blob once for the load rows */
+    GVariant *array = g_variant_ref_sink(variant_bulk_new_array(SAMPLE_TYPE, w.samples, w.n, NULL, NULL));
+    gint fd = g_file_open_tmp("variant_bulk_XXXXXX.bin", &w.path, &error);
+
+    if (fd >= 0) {
+        g_close(fd, NULL);
+    }
+    if (fd >= 0 && variant_bulk_save(array, w.path, &error)) {
+        report(bench, &w, "load read + GVariantIter", w.n, load_iter_bench);
+        report(bench, &w, "load read + bulk", w.n, load_read_bench);
+        report(bench, &w, "load mmap + bulk", w.n, load_mmap_bench);
+    } else {
+        g_printerr("Skipping load benchmarks: %s\n", error->message);
+        g_clear_error(&error);
+    }
+    g_variant_unref(array);
+
+    if (w.path) {
+        g_unlink(w.path);
+        g_free(w.path);
+    }
+    g_free(w.samples);
+
+    g_print("\n=== Key Points ===\n");
+    g_print("1. The builder boxes every element; a{sv} boxes every field too\n");
+    g_print("2. A fixed-size array's serialised form is the C array itself\n");
+    g_print("3. variant_bulk_new_array() only wraps memory; the cost is per array, not per record\n");
+    g_print("4. A mapped blob is read in place: no read() copy and no parse\n");
+
+    bench_free(bench);
+    return 0;
+}
@@ -0,0 +1,254 @@
+/*
+ * echo_load.c - Load generator for the echo servers
+ *
+ * Runs two phases against an echo server (io_uring_echo_server.c or
+ * gsocket_echo_server.c, or the io_uring proxy in front of either):
+ *   1. Connection rate: every client thread repeatedly connects, does one
+ *      1-byte round trip and closes
+ *   2. Request rate: every client thread keeps one connection and does
+ *      closed-loop request/response round trips, timing each one
+ *
+ * Clients use plain blocking sockets on their own threads so the load
+ * generator's own overhead stays out of the server's event loop.
+ *
+ * Usage: ./echo_load [port] [clients] [requests-per-client] [payload-bytes]
+ */
+
+#include <glib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define CONNECT_ROUNDS 200
+
+typedef struct {
+    guint16 port;
+    guint requests;
+    gsize payload;
+    guint64 *latencies;      /* One per request, in nanoseconds */
+    guint completed;
+    guint connections;
+    guint errors;
+} Client;
+
+static guint64 now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (guint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static gint connect_to(guint16 port)
+{
+    struct sockaddr_in addr = { 0 };
+    gint one = 1;
+    gint fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+/* Send @len bytes and read them all back */
+static gboolean round_trip(gint fd, guint8 *send_buf, guint8 *recv_buf, gsize len)
+{
+    gsize done = 0;
+
+    while (done < len) {
+        gssize n = send(fd, send_buf + done, len - done, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return FALSE;
+        }
+        done += n;
+    }
+
+    done = 0;
+    while (done < len) {
+        gssize n = recv(fd, recv_buf + done, len - done, 0);
+        if (n <= 0) {
+            return FALSE;
+        }
+        done += n;
+    }
+
+    return memcmp(send_buf, recv_buf, len) == 0;
+}
+
+static gpointer connect_worker(gpointer data)
+{
+    Client *client = (Client *)data;
+    guint8 send_byte = 'x';
+    guint8 recv_byte;
+
+    for (guint i = 0; i < CONNECT_ROUNDS; i++) {
+        gint fd = connect_to(client->port);
+
+        if (fd < 0) {
+            client->errors++;
+            continue;
+        }
+
+        if (round_trip(fd, &send_byte, &recv_byte, 1)) {
+            client->connections++;
+        } else {
+            client->errors++;
+        }
+        close(fd);
+    }
+
+    return NULL;
+}
+
+static gpointer request_worker(gpointer data)
+{
+    Client *client = (Client *)data;
+    guint8 *send_buf = g_malloc(client->payload);
+    guint8 *recv_buf = g_malloc(client->payload);
+    gint fd = connect_to(client->port);
+
+    if (fd < 0) {
+        client->errors++;
+        goto out;
+    }
+
+    for (gsize i = 0; i < client->payload; i++) {
+        send_buf[i] = (guint8)('a' + (i % 26));
+    }
+
+    for (guint i = 0; i < client->requests; i++) {
+        guint64 start = now_ns();
+
+        if (!round_trip(fd, send_buf, recv_buf, client->payload)) {
+            client->errors++;
+            break;
+        }
+
+        client->latencies[client->completed++] = now_ns() - start;
+    }
+
+    close(fd);
+
+out:
+    g_free(send_buf);
+    g_free(recv_buf);
+    return NULL;
+}
+
+static void run_workers(Client *clients, guint n_clients, GThreadFunc func)
+{
+    GThread **threads = g_new(GThread *, n_clients);
+
+    for (guint i = 0; i < n_clients; i++) {
+        threads[i] = g_thread_new("echo-client", func, &clients[i]);
+    }
+    for (guint i = 0; i < n_clients; i++) {
+        g_thread_join(threads[i]);
+    }
+
+    g_free(threads);
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    guint64 x = *(const guint64 *)a;
+    guint64 y = *(const guint64 *)b;
+
+    return (x > y) - (x < y);
+}
+
+static gdouble percentile_us(const guint64 *sorted, guint n, gdouble p)
+{
+    if (n == 0) {
+        return 0;
+    }
+    return sorted[(guint)(p * (n - 1))] / 1000.0;
+}
+
+int main(int argc, char *argv[])
+{
+    guint16 port = (argc > 1) ? (guint16)g_ascii_strtoull(argv[1], NULL, 10) : 9000;
+    guint n_clients = (argc > 2) ? (guint)g_ascii_strtoull(argv[2], NULL, 10) : 32;
+    guint requests = (argc > 3) ? (guint)g_ascii_strtoull(argv[3], NULL, 10) : 10000;
+    gsize payload = (argc > 4) ? (gsize)g_ascii_strtoull(argv[4], NULL, 10) : 64;
+    Client *clients;
+    guint64 *all;
+    guint total = 0, errors = 0, connections = 0;
+
+    if (n_clients == 0 || requests == 0 || payload == 0) {
+        g_printerr("Usage: %s [port] [clients] [requests-per-client] [payload-bytes]\n",
+                   argv[0]);
+        return 1;
+    }
+
+    g_print("=== Echo Load Generator ===\n\n");
+    g_print("Port %u, %u clients, %u requests each, %" G_GSIZE_FORMAT "-byte payload\n\n",
+            port, n_clients, requests, payload);
+
+    clients = g_new0(Client, n_clients);
+    for (guint i = 0; i < n_clients; i++) {
+        clients[i].port = port;
+        clients[i].requests = requests;
+        clients[i].payload = payload;
+        clients[i].latencies = g_new(guint64, requests);
+    }
+
+    /* Phase 1: connection rate */
+    gint64 start = g_get_monotonic_time();
+    run_workers(clients, n_clients, connect_worker);
+    gdouble seconds = (g_get_monotonic_time() - start) / (gdouble)G_TIME_SPAN_SECOND;
+
+    for (guint i = 0; i < n_clients; i++) {
+        connections += clients[i].connections;
+        errors += clients[i].errors;
+        clients[i].errors = 0;
+    }
+    g_print("Connections: %u in %.2f s = %.0f conn/s (%u errors)\n",
+            connections, seconds, connections / seconds, errors);
+
+    /* Phase 2: request/response */
+    errors = 0;
+    start = g_get_monotonic_time();
+    run_workers(clients, n_clients, request_worker);
+    seconds = (g_get_monotonic_time() - start) / (gdouble)G_TIME_SPAN_SECOND;
+
+    all = g_new(guint64, (gsize)n_clients * requests);
+    for (guint i = 0; i < n_clients; i++) {
+        memcpy(all + total, clients[i].latencies, clients[i].completed * sizeof(guint64));
+        total += clients[i].completed;
+        errors += clients[i].errors;
+    }
+    qsort(all, total, sizeof(guint64), compare_u64);
+
+    g_print("Requests:    %u in %.2f s = %.0f req/s (%u errors)\n",
+            total, seconds, total / seconds, errors);
+    g_print("Latency:     p50 %.1f us, p99 %.1f us, p999 %.1f us\n",
+            percentile_us(all, total, 0.50),
+            percentile_us(all, total, 0.99),
+            percentile_us(all, total, 0.999));
+
+    for (guint i = 0; i < n_clients; i++) {
+        g_free(clients[i].latencies);
+    }
+    g_free(clients);
+    g_free(all);
+
+    return errors > 0 ? 1 : 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * gsocket_echo_server.c - Plain GSocketService echo server
+ *
+ * The baseline for io_uring_echo_server.c: GSocketService accepts
+ * connections and each one runs a read_async()/write_all_async() loop on
+ * its GIO streams. Every connection allocates its own state and buffer,
+ * and every read and write goes through poll() + a syscall.
+ *
+ * Usage: ./gsocket_echo_server [port]
+ */
+
+#include <gio/gio.h>
+#include <glib-unix.h>
+#include <signal.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define DEFAULT_PORT 9001
+#define BUFFER_SIZE 4096
+
+typedef struct {
+    GSocketConnection *connection;
+    GInputStream *in;
+    GOutputStream *out;
+    guint8 buffer[BUFFER_SIZE];
+} EchoConnection;
+
+static guint64 accepted = 0;
+static guint64 active = 0;
+static guint64 bytes = 0;
+static guint64 last_bytes = 0;
+
+static void echo_read_next(EchoConnection *echo);
+
+static void echo_connection_free(EchoConnection *echo)
+{
+    g_object_unref(echo->connection);
+    g_free(echo);
+    active--;
+}
+
+static void on_written(GObject *source,
+                       GAsyncResult *result,
+                       gpointer user_data)
+{
+    EchoConnection *echo = (EchoConnection *)user_data;
+    gsize written = 0;
+
+    if (!g_output_stream_write_all_finish(echo->out, result, &written, NULL)) {
+        echo_connection_free(echo);
+        return;
+    }
+
+    bytes += written;
+    echo_read_next(echo);
+}
+
+static void on_read(GObject *source,
+                    GAsyncResult *result,
+                    gpointer user_data)
+{
+    EchoConnection *echo = (EchoConnection *)user_data;
+    gssize n = g_input_stream_read_finish(echo->in, result, NULL);
+
+    if (n <= 0) {
+        /* EOF or error */
+        echo_connection_free(echo);
+        return;
+    }
+
+    g_output_stream_write_all_async(echo->out, echo->buffer, n,
+                                    G_PRIORITY_DEFAULT, NULL,
+                                    on_written, echo);
+}
+
+static void echo_read_next(EchoConnection *echo)
+{
+    g_input_stream_read_async(echo->in, echo->buffer, sizeof(echo->buffer),
+                              G_PRIORITY_DEFAULT, NULL, on_read, echo);
+}
+
+static gboolean on_incoming(GSocketService *service,
+                            GSocketConnection *connection,
+                            GObject *source_object,
+                            gpointer user_data)
+{
+    EchoConnection *echo = g_new(EchoConnection, 1);
+
+    echo->connection = g_object_ref(connection);
+    echo->in = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+    echo->out = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+    g_socket_set_option(g_socket_connection_get_socket(connection),
+                        IPPROTO_TCP, TCP_NODELAY, 1, NULL);
+
+    accepted++;
+    active++;
+    echo_read_next(echo);
+
+    return TRUE;
+}
+
+static gboolean print_stats(gpointer user_data)
+{
+    guint64 delta = bytes - last_bytes;
+
+    last_bytes = bytes;
+    g_print("[Stats] accepted %" G_GUINT64_FORMAT ", active %" G_GUINT64_FORMAT
+            ", %.1f MiB/s\n",
+            accepted, active, delta / (5.0 * 1024 * 1024));
+
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean on_sigint(gpointer user_data)
+{
+    g_main_loop_quit((GMainLoop *)user_data);
+    return G_SOURCE_REMOVE;
+}
+
+int main(int argc, char *argv[])
+{
+    guint16 port = (argc > 1) ? (guint16)g_ascii_strtoull(argv[1], NULL, 10) : DEFAULT_PORT;
+    GSocketService *service;
+    GMainLoop *loop;
+    GError *error = NULL;
+
+    service = g_socket_service_new();
+    if (!g_socket_listener_add_inet_port(G_SOCKET_LISTENER(service), port, NULL, &error)) {
+        g_printerr("[Error] Failed to listen on port %u: %s\n", port, error->message);
+        g_error_free(error);
+        g_object_unref(service);
+        return 1;
+    }
+
+    g_signal_connect(service, "incoming", G_CALLBACK(on_incoming), NULL);
+    g_socket_service_start(service);
+
+    loop = g_main_loop_new(NULL, FALSE);
+    g_timeout_add_seconds(5, print_stats, NULL);
+    g_unix_signal_add(SIGINT, on_sigint, loop);
+
+    g_print("GSocketService echo server on port %u\n", port);
+    g_print("Press Ctrl+C to stop\n\n");
+
+    g_main_loop_run(loop);
+
+    g_print("\nAccepted %" G_GUINT64_FORMAT " connections, moved %" G_GUINT64_FORMAT " bytes\n",
+            accepted, bytes);
+
+    g_socket_service_stop(service);
+    g_object_unref(service);
+    g_main_loop_unref(loop);
+
+    return 0;
+}
@@ -0,0 +1,739 @@
+/*
+ * io_uring_echo_server.c - TCP echo/proxy server on IoUringSource
+ *
+ * Echo mode: one multishot accept on the listening socket and one
+ * multishot recv per connection that draws from a provided buffer ring.
+ * Each received buffer is sent straight back with IORING_OP_SEND_ZC and
+ * returned to the ring once the zero-copy notification arrives, so the
+ * payload is never copied in user space. A connection has one send in
+ * flight at a time, the rest queued behind it: io_uring doesn't order
+ * unlinked sends on one socket, and a short send's remainder must go
+ * out before the next buffer.
+ *
+ * Proxy mode: every client is paired with a connection to the upstream
+ * port and bytes are moved in both directions with splice() through a
+ * pipe, so the payload never enters user space at all.
+ *
+ * Connections and per-send state live in tables sized at startup; the
+ * hot path does no heap allocation.
+ *
+ * Usage: ./io_uring_echo_server [port] [upstream-port]
+ */
+
+#define _GNU_SOURCE  /* splice flags, pipe2() */
+
+#include "io_uring_source.h"
+#include <glib-unix.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define DEFAULT_PORT 9000
+#define MAX_CONNECTIONS 1024
+#define BUF_RING_ENTRIES 4096
+#define BUF_SIZE 4096
+#define BUF_GROUP 0
+#define SPLICE_CHUNK (64 * 1024)   /* Default pipe capacity */
+
+typedef struct _Connection Connection;
+typedef struct _SendSlot SendSlot;
+
+/* One direction of a proxied connection */
+typedef struct {
+    Connection *conn;
+    gint from_fd;
+    gint to_fd;
+    gint pipe_fds[2];            /* Kept across connections that reuse the slot */
+    gsize in_pipe;               /* Spliced in, not yet spliced out */
+} SpliceDir;
+
+struct _Connection {
+    gint fd;
+    gint upstream_fd;
+    gint next_free;
+    gboolean closing;
+    gboolean recv_armed;
+    gboolean recv_stalled;       /* Multishot recv ended with -ENOBUFS */
+    gboolean in_stalled_list;
+    guint sends_in_flight;       /* Slots queued or sending, or awaiting a notification */
+    SendSlot *sending;           /* The one send submitted */
+    SendSlot *send_queue;        /* Waiting behind it, oldest first */
+    SendSlot *send_queue_tail;
+    guint pending_ops;           /* Proxy connect/splice ops */
+    SpliceDir dirs[2];           /* client -> upstream, upstream -> client */
+};
+
+/* One per provided buffer: a buffer is in at most one send at a time */
+struct _SendSlot {
+    Connection *conn;
+    SendSlot *next;              /* In the connection's send queue */
+    guint8 *data;
+    guint16 buf_id;
+    guint32 len;
+    guint32 sent;
+    guint notifs;                /* Zero-copy notifications still to come */
+};
+
+typedef struct {
+    IoUringSource *uring_source;
+    IoUringBufRing *buf_ring;
+    gint listen_fd;
+    gboolean proxy;
+    gboolean use_zc;
+    struct sockaddr_in upstream_addr;
+
+    Connection conns[MAX_CONNECTIONS];
+    gint free_conn;
+    SendSlot sends[BUF_RING_ENTRIES];
+
+    /* Connections waiting for buffers to come back to the ring */
+    gint stalled[MAX_CONNECTIONS];
+    guint n_stalled;
+
+    guint64 accepted;
+    guint64 active;
+    guint64 bytes;
+    guint64 last_bytes;
+} Server;
+
+static Server server;
+
+static gboolean arm_recv(Connection *conn);
+static void conn_begin_close(Connection *conn);
+
+/* ============================================================
+ * Connection table
+ * ============================================================ */
+
+static void conn_table_init(void)
+{
+    for (gint i = 0; i < MAX_CONNECTIONS; i++) {
+        Connection *conn = &server.conns[i];
+
+        conn->next_free = (i + 1 < MAX_CONNECTIONS) ? i + 1 : -1;
+        for (guint d = 0; d < 2; d++) {
+            conn->dirs[d].conn = conn;
+            conn->dirs[d].pipe_fds[0] = conn->dirs[d].pipe_fds[1] = -1;
+        }
+    }
+    server.free_conn = 0;
+}
+
+static Connection *conn_alloc(gint fd)
+{
+    Connection *conn;
+
+    if (server.free_conn < 0) {
+        return NULL;
+    }
+
+    conn = &server.conns[server.free_conn];
+    server.free_conn = conn->next_free;
+
+    conn->fd = fd;
+    conn->upstream_fd = -1;
+    conn->closing = FALSE;
+    conn->recv_armed = FALSE;
+    conn->recv_stalled = FALSE;
+    conn->sends_in_flight = 0;
+    conn->sending = NULL;
+    conn->send_queue = conn->send_queue_tail = NULL;
+    conn->pending_ops = 0;
+    server.active++;
+
+    return conn;
+}
+
+/* Return the slot once nothing can complete against it any more */
+static void conn_maybe_free(Connection *conn)
+{
+    if (!conn->closing || conn->recv_armed ||
+        conn->sends_in_flight > 0 || conn->pending_ops > 0) {
+        return;
+    }
+
+    close(conn->fd);
+    if (conn->upstream_fd >= 0) {
+        close(conn->upstream_fd);
+    }
+
+    /* A pipe with data left in it can't be reused */
+    for (guint d = 0; d < 2; d++) {
+        SpliceDir *dir = &conn->dirs[d];
+
+        if (dir->in_pipe > 0) {
+            close(dir->pipe_fds[0]);
+            close(dir->pipe_fds[1]);
+            dir->pipe_fds[0] = dir->pipe_fds[1] = -1;
+            dir->in_pipe = 0;
+        }
+    }
+
+    conn->fd = -1;
+    conn->upstream_fd = -1;
+    conn->recv_stalled = FALSE;
+    conn->next_free = server.free_conn;
+    server.free_conn = conn - server.conns;
+    server.active--;
+}
+
+static void conn_begin_close(Connection *conn)
+{
+    if (conn->closing) {
+        return;
+    }
+
+    conn->closing = TRUE;
+
+    /* Pending recvs and splices complete with 0 or an error */
+    shutdown(conn->fd, SHUT_RDWR);
+    if (conn->upstream_fd >= 0) {
+        shutdown(conn->upstream_fd, SHUT_RDWR);
+    }
+
+    conn_maybe_free(conn);
+}
+
+/* ============================================================
+ * Echo: multishot recv + zero-copy send
+ * ============================================================ */
+
+static void submit_send(SendSlot *slot);
+
+static void retry_stalled(void)
+{
+    while (server.n_stalled > 0) {
+        Connection *conn = &server.conns[server.stalled[--server.n_stalled]];
+
+        conn->in_stalled_list = FALSE;
+        if (conn->recv_stalled && !conn->closing) {
+            conn->recv_stalled = FALSE;
+            if (!arm_recv(conn)) {
+                conn_begin_close(conn);
+            }
+        }
+    }
+}
+
+static void send_maybe_done(SendSlot *slot)
+{
+    Connection *conn = slot->conn;
+
+    if (slot->sent < slot->len || slot->notifs > 0) {
+        return;
+    }
+
+    /* The kernel no longer references the buffer */
+    io_uring_buf_ring_recycle(server.buf_ring, slot->buf_id);
+    conn->sends_in_flight--;
+
+    retry_stalled();
+    conn_maybe_free(conn);
+}
+
+/* @slot, the connection's current send, has sent all it will: submit
+ * the next one queued. A closing connection drops the queue unsent. */
+static void send_finished(SendSlot *slot)
+{
+    Connection *conn = slot->conn;
+
+    conn->sending = NULL;
+    while (conn->send_queue && conn->sending == NULL) {
+        SendSlot *next = conn->send_queue;
+
+        conn->send_queue = next->next;
+        if (conn->send_queue == NULL) {
+            conn->send_queue_tail = NULL;
+        }
+
+        if (conn->closing) {
+            next->sent = next->len;
+            send_maybe_done(next);   /* @slot still holds the connection */
+        } else {
+            conn->sending = next;
+            submit_send(next);
+        }
+    }
+
+    send_maybe_done(slot);
+}
+
+static void send_enqueue(SendSlot *slot)
+{
+    Connection *conn = slot->conn;
+
+    conn->sends_in_flight++;
+    slot->next = NULL;
+    if (conn->sending == NULL) {
+        conn->sending = slot;
+        submit_send(slot);
+    } else if (conn->send_queue_tail) {
+        conn->send_queue_tail->next = slot;
+        conn->send_queue_tail = slot;
+    } else {
+        conn->send_queue = conn->send_queue_tail = slot;
+    }
+}
+
+static void on_send(IoUringSource *uring_source,
+                    gint res,
+                    guint32 flags,
+                    gpointer user_data)
+{
+    SendSlot *slot = (SendSlot *)user_data;
+
+    if (flags & IORING_CQE_F_NOTIF) {
+        slot->notifs--;
+        send_maybe_done(slot);
+        return;
+    }
+
+    /* F_MORE on the result CQE means a notification CQE follows */
+    if (flags & IORING_CQE_F_MORE) {
+        slot->notifs++;
+    }
+
+    if (res == -EINVAL && server.use_zc && slot->sent == 0) {
+        /* Kernel without IORING_OP_SEND_ZC (< 6.0) */
+        g_print("[Info] SEND_ZC unsupported, falling back to send\n");
+        server.use_zc = FALSE;
+        submit_send(slot);
+        return;
+    }
+
+    if (res < 0) {
+        slot->sent = slot->len;
+        conn_begin_close(slot->conn);
+    } else {
+        slot->sent += res;
+        server.bytes += res;
+        if (slot->sent < slot->len) {
+            if (slot->conn->closing) {
+                slot->sent = slot->len;
+            } else {
+                submit_send(slot);
+                return;
+            }
+        }
+    }
+
+    send_finished(slot);
+}
+
+static void submit_send(SendSlot *slot)
+{
+    struct io_uring_sqe *sqe = io_uring_source_get_sqe(server.uring_source);
+    Connection *conn = slot->conn;
+
+    if (sqe == NULL) {
+        slot->sent = slot->len;
+        conn_begin_close(conn);
+        send_finished(slot);
+        return;
+    }
+
+    if (server.use_zc) {
+        io_uring_prep_send_zc(sqe, conn->fd, slot->data + slot->sent,
+                              slot->len - slot->sent, MSG_NOSIGNAL, 0);
+    } else {
+        io_uring_prep_send(sqe, conn->fd, slot->data + slot->sent,
+                           slot->len - slot->sent, MSG_NOSIGNAL);
+    }
+    io_uring_source_sqe_set_callback(server.uring_source, sqe, on_send, slot);
+}
+
+static void on_recv(IoUringSource *uring_source,
+                    gint res,
+                    guint32 flags,
+                    gpointer user_data)
+{
+    Connection *conn = (Connection *)user_data;
+    guint16 buf_id;
+    guint8 *data;
+
+    if (!(flags & IORING_CQE_F_MORE)) {
+        conn->recv_armed = FALSE;
+    }
+
+    if (res > 0) {
+        data = io_uring_buf_ring_get_buffer(server.buf_ring, flags, &buf_id);
+        if (data == NULL) {
+            conn_begin_close(conn);
+            conn_maybe_free(conn);
+            return;
+        }
+
+        if (conn->closing) {
+            io_uring_buf_ring_recycle(server.buf_ring, buf_id);
+            conn_maybe_free(conn);
+            return;
+        }
+
+        SendSlot *slot = &server.sends[buf_id];
+        slot->conn = conn;
+        slot->data = data;
+        slot->buf_id = buf_id;
+        slot->len = res;
+        slot->sent = 0;
+        slot->notifs = 0;
+        send_enqueue(slot);
+
+        /* Multishot can end early, e.g. on CQ overflow */
+        if (!conn->recv_armed && !conn->closing && !arm_recv(conn)) {
+            conn_begin_close(conn);
+        }
+        return;
+    }
+
+    if (res == -ENOBUFS && !conn->closing) {
+        /* Every buffer is waiting on a send; re-arm when one comes back */
+        conn->recv_stalled = TRUE;
+        if (!conn->in_stalled_list) {
+            conn->in_stalled_list = TRUE;
+            server.stalled[server.n_stalled++] = conn - server.conns;
+        }
+        return;
+    }
+
+    /* EOF or error */
+    conn_begin_close(conn);
+    conn_maybe_free(conn);
+}
+
+static gboolean arm_recv(Connection *conn)
+{
+    struct io_uring_sqe *sqe = io_uring_source_get_sqe(server.uring_source);
+
+    if (sqe == NULL) {
+        return FALSE;
+    }
+
+    /* No buffer: the kernel picks one from the group per completion */
+    io_uring_prep_recv_multishot(sqe, conn->fd, NULL, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUF_GROUP;
+    io_uring_source_sqe_set_callback(server.uring_source, sqe, on_recv, conn);
+    conn->recv_armed = TRUE;
+
+    return TRUE;
+}
+
+/* ============================================================
+ * Proxy: splice through a pipe in each direction
+ * ============================================================ */
+
+static gboolean splice_in(SpliceDir *dir);
+static gboolean splice_out(SpliceDir *dir);
+
+static void on_splice_out(IoUringSource *uring_source,
+                          gint res,
+                          guint32 flags,
+                          gpointer user_data)
+{
+    SpliceDir *dir = (SpliceDir *)user_data;
+    Connection *conn = dir->conn;
+
+    conn->pending_ops--;
+
+    if (res <= 0) {
+        conn_begin_close(conn);
+    } else {
+        dir->in_pipe -= res;
+        server.bytes += res;
+
+        if (!conn->closing) {
+            gboolean ok = (dir->in_pipe > 0) ? splice_out(dir) : splice_in(dir);
+            if (!ok) {
+                conn_begin_close(conn);
+            }
+        }
+    }
+
+    conn_maybe_free(conn);
+}
+
+static void on_splice_in(IoUringSource *uring_source,
+                         gint res,
+                         guint32 flags,
+                         gpointer user_data)
+{
+    SpliceDir *dir = (SpliceDir *)user_data;
+    Connection *conn = dir->conn;
+
+    conn->pending_ops--;
+
+    if (res <= 0) {
+        conn_begin_close(conn);
+    } else {
+        dir->in_pipe = res;
+        if (conn->closing || !splice_out(dir)) {
+            conn_begin_close(conn);
+        }
+    }
+
+    conn_maybe_free(conn);
+}
+
+static gboolean splice_in(SpliceDir *dir)
+{
+    struct io_uring_sqe *sqe = io_uring_source_get_sqe(server.uring_source);
+
+    if (sqe == NULL) {
+        return FALSE;
+    }
+
+    io_uring_prep_splice(sqe, dir->from_fd, -1, dir->pipe_fds[1], -1,
+                         SPLICE_CHUNK, SPLICE_F_MOVE);
+    io_uring_source_sqe_set_callback(server.uring_source, sqe, on_splice_in, dir);
+    dir->conn->pending_ops++;
+
+    return TRUE;
+}
+
+static gboolean splice_out(SpliceDir *dir)
+{
+    struct io_uring_sqe *sqe = io_uring_source_get_sqe(server.uring_source);
+
+    if (sqe == NULL) {
+        return FALSE;
+    }
+
+    io_uring_prep_splice(sqe, dir->pipe_fds[0], -1, dir->to_fd, -1,
+                         dir->in_pipe, SPLICE_F_MOVE);
+    io_uring_source_sqe_set_callback(server.uring_source, sqe, on_splice_out, dir);
+    dir->conn->pending_ops++;
+
+    return TRUE;
+}
+
+static void on_upstream_connect(IoUringSource *uring_source,
+                                gint res,
+                                guint32 flags,
+                                gpointer user_data)
+{
+    Connection *conn = (Connection *)user_data;
+    gint one = 1;
+
+    conn->pending_ops--;
+
+    if (res < 0) {
+        g_printerr("[Error] Upstream connect failed: %s\n", g_strerror(-res));
+        conn_begin_close(conn);
+        return;
+    }
+
+    setsockopt(conn->upstream_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    conn->dirs[0].from_fd = conn->fd;
+    conn->dirs[0].to_fd = conn->upstream_fd;
+    conn->dirs[1].from_fd = conn->upstream_fd;
+    conn->dirs[1].to_fd = conn->fd;
+
+    if (conn->closing || !splice_in(&conn->dirs[0]) || !splice_in(&conn->dirs[1])) {
+        conn_begin_close(conn);
+    }
+    conn_maybe_free(conn);
+}
+
+static gboolean start_proxy(Connection *conn)
+{
+    struct io_uring_sqe *sqe;
+
+    for (guint d = 0; d < 2; d++) {
+        if (conn->dirs[d].pipe_fds[0] < 0 &&
+            pipe2(conn->dirs[d].pipe_fds, O_CLOEXEC) < 0) {
+            return FALSE;
+        }
+    }
+
+    conn->upstream_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (conn->upstream_fd < 0) {
+        return FALSE;
+    }
+
+    sqe = io_uring_source_get_sqe(server.uring_source);
+    if (sqe == NULL) {
+        return FALSE;
+    }
+
+    io_uring_prep_connect(sqe, conn->upstream_fd,
+                          (struct sockaddr *)&server.upstream_addr,
+                          sizeof(server.upstream_addr));
+    io_uring_source_sqe_set_callback(server.uring_source, sqe,
+                                     on_upstream_connect, conn);
+    conn->pending_ops++;
+
+    return TRUE;
+}
+
+/* ============================================================
+ * Accept
+ * ============================================================ */
+
+static void arm_accept(void);
+
+static void on_accept(IoUringSource *uring_source,
+                      gint res,
+                      guint32 flags,
+                      gpointer user_data)
+{
+    if (!(flags & IORING_CQE_F_MORE)) {
+        arm_accept();
+    }
+
+    if (res < 0) {
+        g_printerr("[Error] Accept failed: %s\n", g_strerror(-res));
+        return;
+    }
+
+    Connection *conn = conn_alloc(res);
+    gint one = 1;
+
+    if (conn == NULL) {
+        /* Table full: shed the connection */
+        close(res);
+        return;
+    }
+
+    server.accepted++;
+    setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (!(server.proxy ? start_proxy(conn) : arm_recv(conn))) {
+        conn_begin_close(conn);
+    }
+}
+
+static void arm_accept(void)
+{
+    struct io_uring_sqe *sqe = io_uring_source_get_sqe(server.uring_source);
+
+    if (sqe == NULL) {
+        g_printerr("[Error] Failed to get SQE for accept\n");
+        return;
+    }
+
+    io_uring_prep_multishot_accept(sqe, server.listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    io_uring_source_sqe_set_callback(server.uring_source, sqe, on_accept, NULL);
+}
+
+/* ============================================================
+ * Main
+ * ============================================================ */
+
+static gint create_listener(guint16 port)
+{
+    struct sockaddr_in addr = { 0 };
+    gint one = 1;
+    gint fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static gboolean print_stats(gpointer user_data)
+{
+    guint64 delta = server.bytes - server.last_bytes;
+
+    server.last_bytes = server.bytes;
+    g_print("[Stats] accepted %" G_GUINT64_FORMAT ", active %" G_GUINT64_FORMAT
+            ", %.1f MiB/s\n",
+            server.accepted, server.active, delta / (5.0 * 1024 * 1024));
+
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean on_sigint(gpointer user_data)
+{
+    g_main_loop_quit((GMainLoop *)user_data);
+    return G_SOURCE_REMOVE;
+}
+
+int main(int argc, char *argv[])
+{
+    guint16 port = (argc > 1) ? (guint16)g_ascii_strtoull(argv[1], NULL, 10) : DEFAULT_PORT;
+    guint16 upstream_port = (argc > 2) ? (guint16)g_ascii_strtoull(argv[2], NULL, 10) : 0;
+    IoUringSourceConfig config = {
+        .ring_depth = 1024,
+        .mode = IO_URING_SOURCE_MODE_EVENTFD,
+    };
+    GError *error = NULL;
+    GMainLoop *loop;
+
+    server.uring_source = io_uring_source_new(&config, &error);
+    if (!server.uring_source) {
+        g_printerr("[Error] %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    server.buf_ring = io_uring_source_add_buf_ring(server.uring_source, BUF_GROUP,
+                                                   BUF_RING_ENTRIES, BUF_SIZE, &error);
+    if (!server.buf_ring) {
+        g_printerr("[Error] %s\n", error->message);
+        g_error_free(error);
+        g_source_unref((GSource *)server.uring_source);
+        return 1;
+    }
+
+    server.listen_fd = create_listener(port);
+    if (server.listen_fd < 0) {
+        g_printerr("[Error] Failed to listen on port %u: %s\n", port, g_strerror(errno));
+        g_source_unref((GSource *)server.uring_source);
+        return 1;
+    }
+
+    server.use_zc = TRUE;
+    if (upstream_port > 0) {
+        server.proxy = TRUE;
+        server.upstream_addr.sin_family = AF_INET;
+        server.upstream_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        server.upstream_addr.sin_port = htons(upstream_port);
+    }
+
+    conn_table_init();
+
+    loop = g_main_loop_new(NULL, FALSE);
+    g_source_attach((GSource *)server.uring_source, NULL);
+    arm_accept();
+
+    g_timeout_add_seconds(5, print_stats, NULL);
+    g_unix_signal_add(SIGINT, on_sigint, loop);
+
+    if (server.proxy) {
+        g_print("Proxying port %u -> 127.0.0.1:%u (splice)\n", port, upstream_port);
+    } else {
+        g_print("Echo server on port %u (multishot recv + SEND_ZC)\n", port);
+    }
+    g_print("Press Ctrl+C to stop\n\n");
+
+    g_main_loop_run(loop);
+
+    g_print("\nAccepted %" G_GUINT64_FORMAT " connections, moved %" G_GUINT64_FORMAT " bytes\n",
+            server.accepted, server.bytes);
+
+    /* Exiting the ring tears down whatever is still in flight */
+    close(server.listen_fd);
+    g_main_loop_unref(loop);
+
+    return 0;
+}
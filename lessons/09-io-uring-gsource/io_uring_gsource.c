@@ -3,306 +3,243 @@
  * 
  * Demonstrates how to integrate io_uring with the GLib main loop
  * by creating a custom GSource that monitors io_uring completion events.
- * This example writes buffer contents to a file using io_uring.
+ * This example writes buffer contents to a file using a batch of
+ * fixed-buffer writes on a registered file.
  */
 
-#include <glib.h>
-#include <liburing.h>
+#include "io_uring_source.h"
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
 
-/* Structure to hold io_uring and GSource together */
-typedef struct {
-    GSource source;
-    struct io_uring ring;
-    GPollFD poll_fd;
-} IoUringSource;
-
 /* Global main loop */
 static GMainLoop *main_loop = NULL;
 
-/* Callback when io_uring has completions ready */
-static gboolean io_uring_source_prepare(GSource *source, gint *timeout)
-{
-    /* Never timeout, we rely on poll */
-    *timeout = -1;
-    return FALSE;
-}
-
-static gboolean io_uring_source_check(GSource *source)
-{
-    IoUringSource *uring_source = (IoUringSource *)source;
-    
-    /* Check if there are completions ready */
-    return (uring_source->poll_fd.revents & G_IO_IN) != 0;
-}
-
-static gboolean io_uring_source_dispatch(GSource *source,
-                                          GSourceFunc callback,
-                                          gpointer user_data)
-{
-    IoUringSource *uring_source = (IoUringSource *)source;
-    struct io_uring_cqe *cqe;
-    unsigned head;
-    unsigned count = 0;
-    
-    /* Process all available completions */
-    io_uring_for_each_cqe(&uring_source->ring, head, cqe) {
-        count++;
-        
-        if (cqe->res < 0) {
-            g_print("[io_uring] Operation failed: %s\n", strerror(-cqe->res));
-        } else {
-            g_print("[io_uring] Operation completed: %d bytes\n", cqe->res);
-        }
-        
-        /* Get user_data to identify the operation type */
-        gpointer op_data = io_uring_cqe_get_data(cqe);
-        
-        /* Free buffer only if user_data is a heap-allocated buffer.
-         * We distinguish between buffer pointers and fd values by checking
-         * if the value looks like a small integer (fd) or a heap pointer.
-         * This is a simplified check for this example.
-         */
-        if (op_data && GPOINTER_TO_INT(op_data) > 1024) {
-            /* Likely a heap pointer (buffer), free it */
-            g_free(op_data);
-        }
-        /* If op_data is small (< 1024), it's likely an fd value, don't free */
-    }
-    
-    /* Mark all CQEs as seen */
-    io_uring_cq_advance(&uring_source->ring, count);
-    
-    /* Call the user callback if set */
-    if (callback) {
-        return callback(user_data);
-    }
-    
-    return G_SOURCE_CONTINUE;
-}
+/* Structure to track completion state */
+typedef struct {
+    IoUringSource *uring_source;
+    gint fd;
+    gint file_slot;
+    gint expected_completions;
+    gint completed_count;
+    GMainLoop *main_loop;
+} CompletionState;
 
-static void io_uring_source_finalize(GSource *source)
-{
-    IoUringSource *uring_source = (IoUringSource *)source;
-    
-    g_print("[Cleanup] Finalizing io_uring source\n");
-    io_uring_queue_exit(&uring_source->ring);
-}
+/* One chunk of the file; lives on main()'s stack, no per-op allocation */
+typedef struct {
+    CompletionState *state;
+    guint buf_index;
+} WriteChunk;
 
-static GSourceFuncs io_uring_source_funcs = {
-    io_uring_source_prepare,
-    io_uring_source_check,
-    io_uring_source_dispatch,
-    io_uring_source_finalize,
-    NULL, /* closure_callback */
-    NULL  /* closure_marshal */
-};
-
-/* Create a new io_uring GSource */
-static IoUringSource *io_uring_source_new(void)
+/* Per-op completion: the op table hands back exactly the pointer we
+ * registered, so there's no guessing what user_data is */
+static void on_write_complete(IoUringSource *uring_source,
+                              gint res,
+                              guint32 flags,
+                              gpointer user_data)
 {
-    IoUringSource *uring_source;
-    struct io_uring_params params;
-    int ret;
-    
-    /* Create the GSource */
-    uring_source = (IoUringSource *)g_source_new(&io_uring_source_funcs,
-                                                  sizeof(IoUringSource));
-    
-    /* Initialize io_uring with 8 queue entries */
-    memset(&params, 0, sizeof(params));
-    ret = io_uring_queue_init_params(8, &uring_source->ring, &params);
-    if (ret < 0) {
-        g_printerr("[Error] Failed to initialize io_uring: %s\n", strerror(-ret));
-        g_source_unref((GSource *)uring_source);
-        return NULL;
-    }
-    
-    g_print("[Init] io_uring initialized successfully\n");
-    
-    /* Get the ring file descriptor for polling */
-    int ring_fd = uring_source->ring.ring_fd;
-    
-    /* Set up the poll FD to monitor io_uring completions */
-    uring_source->poll_fd.fd = ring_fd;
-    uring_source->poll_fd.events = G_IO_IN;
-    uring_source->poll_fd.revents = 0;
-    
-    g_source_add_poll((GSource *)uring_source, &uring_source->poll_fd);
-    
-    return uring_source;
-}
+    WriteChunk *chunk = (WriteChunk *)user_data;
+    CompletionState *state = chunk->state;
 
-/* Submit a write operation using io_uring */
-static gboolean submit_write_operation(IoUringSource *uring_source,
-                                        const char *filename,
-                                        const char *data,
-                                        size_t length)
-{
-    struct io_uring_sqe *sqe;
-    int fd;
-    gchar *buffer;
-    
-    /* Open the file */
-    fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-    if (fd < 0) {
-        g_printerr("[Error] Failed to open file: %s\n", strerror(errno));
-        return FALSE;
-    }
-    
-    g_print("[Submit] Opening file: %s (fd=%d)\n", filename, fd);
-    
-    /* Copy data to a buffer that will persist until completion */
-    buffer = g_strdup(data);
-    
-    /* Get a submission queue entry */
-    sqe = io_uring_get_sqe(&uring_source->ring);
-    if (!sqe) {
-        g_printerr("[Error] Failed to get SQE\n");
-        close(fd);
-        g_free(buffer);
-        return FALSE;
-    }
-    
-    /* Prepare the write operation
-     * The offset parameter (0) specifies where in the file to write.
-     * For sequential writes, use the current file position or track offset.
-     */
-    io_uring_prep_write(sqe, fd, buffer, length, 0);
-    
-    /* Set user data to track this operation and the buffer to free */
-    io_uring_sqe_set_data(sqe, buffer);
-    
-    /* Link this write with a close operation so close executes after write.
-     * Note: IOSQE_IO_LINK means the next operation only executes if this succeeds.
-     * For this simple example, this is acceptable behavior.
-     */
-    sqe->flags |= IOSQE_IO_LINK;
-    
-    /* Get another SQE for close operation to clean up the file descriptor */
-    sqe = io_uring_get_sqe(&uring_source->ring);
-    if (sqe) {
-        io_uring_prep_close(sqe, fd);
-        /* Mark close with special user_data (cast fd to pointer) to distinguish it */
-        io_uring_sqe_set_data(sqe, GINT_TO_POINTER(fd));
+    if (res < 0) {
+        g_print("[io_uring] Write failed: %s\n", strerror(-res));
     } else {
-        /* Fallback: if we can't queue the close, do it synchronously */
-        g_print("[Warning] Could not queue close operation, closing synchronously\n");
-        close(fd);
-    }
-    
-    g_print("[Submit] Write operation prepared (%zu bytes)\n", length);
-    
-    /* Submit the operation */
-    int submitted = io_uring_submit(&uring_source->ring);
-    if (submitted < 0) {
-        g_printerr("[Error] Failed to submit: %s\n", strerror(-submitted));
-        close(fd);
-        g_free(buffer);
-        return FALSE;
+        g_print("[io_uring] Write completed: %d bytes (buffer %u)\n",
+                res, chunk->buf_index);
     }
-    
-    g_print("[Submit] Submitted %d operation(s)\n", submitted);
-    
-    return TRUE;
-}
 
-/* Structure to track completion state */
-typedef struct {
-    int expected_completions;
-    int completed_count;
-    GMainLoop *main_loop;
-} CompletionState;
+    /* Fixed buffer can be reused as soon as the write is done */
+    io_uring_source_release_buffer(uring_source, chunk->buf_index);
+    state->completed_count++;
+}
 
-/* Callback for when operations complete */
-static gboolean on_operation_complete(gpointer user_data)
+/* Called once per dispatched batch of completions */
+static gboolean on_batch_complete(gpointer user_data)
 {
     CompletionState *state = (CompletionState *)user_data;
-    state->completed_count++;
-    
-    g_print("[Callback] Operation %d/%d completed\n",
+
+    g_print("[Callback] %d/%d operations completed\n",
             state->completed_count, state->expected_completions);
-    
+
     /* Quit after all expected operations are done */
     if (state->completed_count >= state->expected_completions) {
         g_print("[Callback] All operations completed, quitting main loop\n");
+        io_uring_source_unregister_file(state->uring_source, state->file_slot);
+        close(state->fd);
         g_main_loop_quit(state->main_loop);
         return G_SOURCE_REMOVE;
     }
-    
+
     return G_SOURCE_CONTINUE;
 }
 
+/* Queue one write per line. Nothing is submitted here: all SQEs go to
+ * the kernel together when the source's prepare() flushes the batch. */
+static gint queue_write_operations(IoUringSource *uring_source,
+                                   gint file_slot,
+                                   gchar **lines,
+                                   WriteChunk *chunks,
+                                   CompletionState *state)
+{
+    guint64 offset = 0;
+    gint queued = 0;
+
+    for (gint i = 0; lines[i] != NULL && lines[i][0] != '\0'; i++) {
+        gsize length = strlen(lines[i]);
+        guint buf_index;
+        gchar *buffer;
+
+        buffer = io_uring_source_acquire_buffer(uring_source, &buf_index);
+        if (buffer == NULL) {
+            g_printerr("[Error] Out of fixed buffers\n");
+            break;
+        }
+
+        /* Copy into the registered buffer, restoring the newline */
+        memcpy(buffer, lines[i], length);
+        buffer[length] = '\n';
+
+        chunks[i].state = state;
+        chunks[i].buf_index = buf_index;
+
+        if (!io_uring_source_write_fixed(uring_source, file_slot, buf_index,
+                                         length + 1, offset,
+                                         on_write_complete, &chunks[i])) {
+            g_printerr("[Error] Failed to get SQE\n");
+            io_uring_source_release_buffer(uring_source, buf_index);
+            break;
+        }
+
+        g_print("[Submit] Queued write of %zu bytes at offset %" G_GUINT64_FORMAT "\n",
+                length + 1, offset);
+        offset += length + 1;
+        queued++;
+    }
+
+    return queued;
+}
+
 int main(int argc, char *argv[])
 {
     IoUringSource *uring_source;
     GSource *source;
+    GError *error = NULL;
     const gchar *test_content;
     const gchar *filename = "/tmp/io_uring_test.txt";
     CompletionState completion_state;
-    
+    IoUringSourceStats stats;
+    WriteChunk chunks[8];
+    gchar **lines;
+    gint fd;
+
     g_print("=== io_uring GLib GSource Integration ===\n\n");
-    
+
     /* Create the main loop */
     main_loop = g_main_loop_new(NULL, FALSE);
-    
-    /* Initialize completion state - expecting 2 operations: write + close */
-    completion_state.expected_completions = 2;
-    completion_state.completed_count = 0;
-    completion_state.main_loop = main_loop;
-    
-    /* Create the io_uring source */
-    uring_source = io_uring_source_new();
+
+    /* Create the io_uring source with a small pool of registered
+     * buffers and a couple of registered file slots */
+    IoUringSourceConfig config = {
+        .ring_depth = 64,
+        .n_fixed_buffers = G_N_ELEMENTS(chunks),
+        .fixed_buffer_size = 4096,
+        .n_fixed_files = 4,
+    };
+
+    uring_source = io_uring_source_new(&config, &error);
     if (!uring_source) {
-        g_printerr("Failed to create io_uring source\n");
+        g_printerr("Failed to create io_uring source: %s\n", error->message);
+        g_error_free(error);
         g_main_loop_unref(main_loop);
         return 1;
     }
-    
+
+    g_print("[Init] io_uring initialized (depth %u, %u fixed buffers)\n",
+            config.ring_depth, config.n_fixed_buffers);
+
     source = (GSource *)uring_source;
-    
-    /* Set the callback for completions, passing our state */
-    g_source_set_callback(source, on_operation_complete, &completion_state, NULL);
-    
+
+    /* Open the file and register it so SQEs can use IOSQE_FIXED_FILE */
+    fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        g_printerr("[Error] Failed to open file: %s\n", strerror(errno));
+        g_source_unref(source);
+        g_main_loop_unref(main_loop);
+        return 1;
+    }
+
+    completion_state.uring_source = uring_source;
+    completion_state.fd = fd;
+    completion_state.file_slot = io_uring_source_register_file(uring_source, fd);
+    completion_state.completed_count = 0;
+    completion_state.main_loop = main_loop;
+
+    if (completion_state.file_slot < 0) {
+        g_printerr("[Error] Failed to register file\n");
+        close(fd);
+        g_source_unref(source);
+        g_main_loop_unref(main_loop);
+        return 1;
+    }
+
+    g_print("[Submit] Opened file: %s (fd=%d, fixed slot=%d)\n",
+            filename, fd, completion_state.file_slot);
+
+    /* Set the batch callback, passing our state */
+    g_source_set_callback(source, on_batch_complete, &completion_state, NULL);
+
     /* Attach to the default main context */
     g_source_attach(source, NULL);
-    
+
     /* Prepare test content */
     test_content = "Hello from io_uring integrated with GLib!\n"
                    "This demonstrates using io_uring for async I/O\n"
                    "while maintaining compatibility with the GLib main loop.\n"
                    "io_uring provides high-performance async I/O capabilities.\n";
-    
-    g_print("[Main] Submitting write operation...\n");
-    
-    /* Submit a write operation */
-    if (!submit_write_operation(uring_source, filename,
-                                 test_content, strlen(test_content))) {
-        g_printerr("Failed to submit write operation\n");
+
+    g_print("[Main] Queueing write operations...\n");
+
+    lines = g_strsplit(test_content, "\n", G_N_ELEMENTS(chunks));
+    completion_state.expected_completions =
+        queue_write_operations(uring_source, completion_state.file_slot,
+                               lines, chunks, &completion_state);
+    g_strfreev(lines);
+
+    if (completion_state.expected_completions == 0) {
+        g_printerr("Failed to queue write operations\n");
+        io_uring_source_unregister_file(uring_source, completion_state.file_slot);
+        close(fd);
+        g_source_destroy(source);
         g_source_unref(source);
         g_main_loop_unref(main_loop);
         return 1;
     }
-    
+
     g_print("[Main] Running main loop, waiting for completions...\n\n");
-    
-    /* Run the main loop */
+
+    /* Run the main loop; the first prepare() submits the whole batch */
     g_main_loop_run(main_loop);
-    
+
+    io_uring_source_get_stats(uring_source, &stats);
+
     /* Cleanup */
     g_source_unref(source);
     g_main_loop_unref(main_loop);
-    
+
+    g_print("\n=== Statistics ===\n");
+    g_print("- io_uring_submit() calls: %" G_GUINT64_FORMAT "\n", stats.submit_calls);
+    g_print("- SQEs submitted: %" G_GUINT64_FORMAT "\n", stats.sqes_submitted);
+    g_print("- Completions: %" G_GUINT64_FORMAT " in %" G_GUINT64_FORMAT " dispatch(es)\n",
+            stats.completions, stats.dispatches);
+
     g_print("\n=== Key Points ===\n");
     g_print("- io_uring provides high-performance async I/O\n");
     g_print("- Custom GSource integrates io_uring with GLib main loop\n");
-    g_print("- GSource polls io_uring's ring_fd for completions\n");
-    g_print("- Operations are submitted via submission queue (SQE)\n");
-    g_print("- Completions are retrieved via completion queue (CQE)\n");
+    g_print("- SQEs are batched and submitted once per loop iteration\n");
+    g_print("- An op table keyed by a cookie in user_data tracks each operation\n");
+    g_print("- Fixed buffers and registered files avoid per-op kernel setup\n");
     g_print("- File written to: %s\n", filename);
-    
+
     return 0;
 }
@@ -0,0 +1,798 @@
+/*
+ * io_uring_source.c - Batched io_uring GSource
+ *
+ * See io_uring_source.h for the API. Completions are matched to ops via
+ * a cookie in user_data: the low 32 bits index the op table and the high
+ * 32 bits hold the slot's generation, so a stale or duplicated CQE can
+ * never be mistaken for a newer op reusing the same slot.
+ *
+ * In the eventfd and SQPOLL modes the loop polls an eventfd that the
+ * kernel signals on every CQE post. In all modes prepare() peeks at the
+ * CQ tail first, so when completions are already waiting the iteration
+ * only does a zero-timeout poll instead of sleeping in poll().
+ */
+
+#include "io_uring_source.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
+
+#define OP_NONE   G_MAXUINT32
+#define OP_IN_USE (G_MAXUINT32 - 1)
+
+typedef struct {
+    IoUringCompletionFunc func;
+    gpointer user_data;
+    guint32 generation;
+    guint32 next_free;   /* Free-list link, OP_IN_USE while in flight */
+} IoUringOp;
+
+struct _IoUringBufRing {
+    struct io_uring_buf_ring *br;
+    guint16 group_id;
+    guint n_entries;
+    gsize buf_size;
+    guint8 *mem;
+    guint pending;       /* Recycled since the last flush */
+};
+
+struct _IoUringSource {
+    GSource source;
+    struct io_uring ring;
+    gboolean ring_initialized;
+    IoUringSourceMode mode;
+    gint event_fd;
+    GPollFD poll_fd;
+
+    /* Op table */
+    IoUringOp *ops;
+    guint32 n_ops;
+    guint32 free_op;
+    guint in_flight;
+
+    /* SQEs prepared since the last submit */
+    guint pending_sqes;
+
+    /* Fixed buffers, carved out of one page-aligned block */
+    guint8 *buffer_mem;
+    gsize buffer_size;
+    guint n_buffers;
+    guint *free_buffers;
+    guint n_free_buffers;
+
+    /* Registered files, -1 marks a free slot */
+    gint *files;
+    guint n_files;
+
+    /* Provided buffer rings, NULL until one is added */
+    GPtrArray *buf_rings;
+
+    IoUringSourceStats stats;
+};
+
+/* ============================================================
+ * Op table
+ * ============================================================ */
+
+static void op_table_init(IoUringSource *uring_source, guint32 size)
+{
+    uring_source->ops = g_new(IoUringOp, size);
+    uring_source->n_ops = size;
+    uring_source->free_op = 0;
+
+    for (guint32 i = 0; i < size; i++) {
+        uring_source->ops[i].func = NULL;
+        uring_source->ops[i].user_data = NULL;
+        uring_source->ops[i].generation = 0;
+        uring_source->ops[i].next_free = (i + 1 < size) ? i + 1 : OP_NONE;
+    }
+}
+
+static guint32 op_alloc(IoUringSource *uring_source,
+                        IoUringCompletionFunc func,
+                        gpointer user_data)
+{
+    if (uring_source->free_op == OP_NONE) {
+        /* More ops in flight than CQ entries (e.g. multishot): grow */
+        guint32 old_size = uring_source->n_ops;
+        guint32 new_size = old_size * 2;
+
+        uring_source->ops = g_renew(IoUringOp, uring_source->ops, new_size);
+        for (guint32 i = old_size; i < new_size; i++) {
+            uring_source->ops[i].func = NULL;
+            uring_source->ops[i].user_data = NULL;
+            uring_source->ops[i].generation = 0;
+            uring_source->ops[i].next_free = (i + 1 < new_size) ? i + 1 : OP_NONE;
+        }
+        uring_source->free_op = old_size;
+        uring_source->n_ops = new_size;
+    }
+
+    guint32 index = uring_source->free_op;
+    IoUringOp *op = &uring_source->ops[index];
+
+    uring_source->free_op = op->next_free;
+    op->next_free = OP_IN_USE;
+    op->func = func;
+    op->user_data = user_data;
+    uring_source->in_flight++;
+
+    return index;
+}
+
+static void op_release(IoUringSource *uring_source, guint32 index)
+{
+    IoUringOp *op = &uring_source->ops[index];
+
+    op->func = NULL;
+    op->user_data = NULL;
+    op->generation++;
+    op->next_free = uring_source->free_op;
+    uring_source->free_op = index;
+    uring_source->in_flight--;
+}
+
+static inline guint64 op_cookie(IoUringSource *uring_source, guint32 index)
+{
+    return ((guint64)uring_source->ops[index].generation << 32) | index;
+}
+
+/* Returns the op for @cookie, or NULL if it doesn't name a live op */
+static IoUringOp *op_lookup(IoUringSource *uring_source,
+                            guint64 cookie,
+                            guint32 *index)
+{
+    guint32 i = (guint32)(cookie & G_MAXUINT32);
+    guint32 generation = (guint32)(cookie >> 32);
+
+    if (i >= uring_source->n_ops) {
+        return NULL;
+    }
+
+    IoUringOp *op = &uring_source->ops[i];
+    if (op->next_free != OP_IN_USE || op->generation != generation) {
+        return NULL;
+    }
+
+    *index = i;
+    return op;
+}
+
+/* ============================================================
+ * GSource implementation
+ * ============================================================ */
+
+/* Reset the eventfd counter once poll() has reported it readable */
+static void drain_eventfd(IoUringSource *uring_source)
+{
+    eventfd_t value;
+
+    if (uring_source->event_fd < 0 ||
+        !(uring_source->poll_fd.revents & G_IO_IN)) {
+        return;
+    }
+
+    eventfd_read(uring_source->event_fd, &value);
+    uring_source->poll_fd.revents = 0;
+    uring_source->stats.eventfd_reads++;
+}
+
+static gboolean io_uring_source_prepare(GSource *source, gint *timeout)
+{
+    IoUringSource *uring_source = (IoUringSource *)source;
+
+    /* Flush everything queued since the last iteration in one syscall */
+    io_uring_source_flush(uring_source);
+
+    /* Cheap peek at the shared CQ ring: if completions are already
+     * waiting, don't block in poll() at all */
+    if (io_uring_cq_ready(&uring_source->ring) > 0) {
+        uring_source->stats.prepare_ready++;
+        *timeout = 0;
+        return TRUE;
+    }
+
+    /* Never timeout, we rely on poll */
+    *timeout = -1;
+    return FALSE;
+}
+
+static gboolean io_uring_source_check(GSource *source)
+{
+    IoUringSource *uring_source = (IoUringSource *)source;
+
+    drain_eventfd(uring_source);
+
+    /* The eventfd can fire for CQEs an earlier dispatch already reaped,
+     * so the CQ ring is the source of truth */
+    return io_uring_cq_ready(&uring_source->ring) > 0;
+}
+
+static gboolean io_uring_source_dispatch(GSource *source,
+                                         GSourceFunc callback,
+                                         gpointer user_data)
+{
+    IoUringSource *uring_source = (IoUringSource *)source;
+    struct io_uring_cqe *cqe;
+    unsigned head;
+    unsigned count = 0;
+    /* Bound the batch so one busy ring can't starve the rest of the loop */
+    unsigned limit = uring_source->ring.cq.ring_entries;
+
+    uring_source->stats.dispatches++;
+
+    /* check() is skipped when prepare() already reported ready */
+    drain_eventfd(uring_source);
+
+    io_uring_for_each_cqe(&uring_source->ring, head, cqe) {
+        guint64 cookie = io_uring_cqe_get_data64(cqe);
+        gint res = cqe->res;
+        guint32 flags = cqe->flags;
+        guint32 index;
+        IoUringOp *op;
+
+        count++;
+
+        op = op_lookup(uring_source, cookie, &index);
+        if (op == NULL) {
+            g_warning("io_uring: completion for unknown op 0x%" G_GINT64_MODIFIER "x",
+                      cookie);
+        } else {
+            IoUringCompletionFunc func = op->func;
+            gpointer op_data = op->user_data;
+
+            /* Release before calling out so the callback can queue a
+             * follow-up op into the same slot */
+            if (!(flags & IORING_CQE_F_MORE)) {
+                op_release(uring_source, index);
+            }
+
+            if (func) {
+                func(uring_source, res, flags, op_data);
+            }
+        }
+
+        if (count >= limit) {
+            break;
+        }
+    }
+
+    /* Mark all CQEs as seen */
+    io_uring_cq_advance(&uring_source->ring, count);
+    uring_source->stats.completions += count;
+
+    /* Call the user callback if set */
+    if (callback) {
+        return callback(user_data);
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void io_uring_source_finalize(GSource *source)
+{
+    IoUringSource *uring_source = (IoUringSource *)source;
+
+    if (uring_source->in_flight > 0) {
+        g_warning("io_uring: finalizing with %u op(s) in flight",
+                  uring_source->in_flight);
+    }
+
+    if (uring_source->buf_rings) {
+        for (guint i = 0; i < uring_source->buf_rings->len; i++) {
+            IoUringBufRing *buf_ring = g_ptr_array_index(uring_source->buf_rings, i);
+
+            io_uring_free_buf_ring(&uring_source->ring, buf_ring->br,
+                                   buf_ring->n_entries, buf_ring->group_id);
+            free(buf_ring->mem);
+            g_free(buf_ring);
+        }
+        g_ptr_array_free(uring_source->buf_rings, TRUE);
+    }
+
+    /* Tears down registered buffers and files as well */
+    if (uring_source->ring_initialized) {
+        io_uring_queue_exit(&uring_source->ring);
+    }
+
+    if (uring_source->event_fd >= 0) {
+        close(uring_source->event_fd);
+    }
+
+    free(uring_source->buffer_mem);
+    g_free(uring_source->free_buffers);
+    g_free(uring_source->files);
+    g_free(uring_source->ops);
+}
+
+static GSourceFuncs io_uring_source_funcs = {
+    io_uring_source_prepare,
+    io_uring_source_check,
+    io_uring_source_dispatch,
+    io_uring_source_finalize,
+    NULL, /* closure_callback */
+    NULL  /* closure_marshal */
+};
+
+/* ============================================================
+ * Registration helpers
+ * ============================================================ */
+
+static gboolean setup_fixed_buffers(IoUringSource *uring_source,
+                                    guint n_buffers,
+                                    gsize buffer_size,
+                                    GError **error)
+{
+    struct iovec *iovecs;
+    void *mem;
+    int ret;
+
+    ret = posix_memalign(&mem, 4096, n_buffers * buffer_size);
+    if (ret != 0) {
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(ret),
+                    "Failed to allocate fixed buffers: %s", g_strerror(ret));
+        return FALSE;
+    }
+
+    uring_source->buffer_mem = mem;
+    uring_source->buffer_size = buffer_size;
+    uring_source->n_buffers = n_buffers;
+    uring_source->free_buffers = g_new(guint, n_buffers);
+    uring_source->n_free_buffers = n_buffers;
+
+    /* The kernel copies the iovec array, so it can be temporary */
+    iovecs = g_new(struct iovec, n_buffers);
+    for (guint i = 0; i < n_buffers; i++) {
+        iovecs[i].iov_base = uring_source->buffer_mem + i * buffer_size;
+        iovecs[i].iov_len = buffer_size;
+        /* Hand out low indices first */
+        uring_source->free_buffers[i] = n_buffers - 1 - i;
+    }
+
+    ret = io_uring_register_buffers(&uring_source->ring, iovecs, n_buffers);
+    g_free(iovecs);
+
+    if (ret < 0) {
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(-ret),
+                    "Failed to register buffers: %s", g_strerror(-ret));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean setup_fixed_files(IoUringSource *uring_source,
+                                  guint n_files,
+                                  GError **error)
+{
+    int ret;
+
+    uring_source->files = g_new(gint, n_files);
+    uring_source->n_files = n_files;
+    for (guint i = 0; i < n_files; i++) {
+        uring_source->files[i] = -1;
+    }
+
+    /* Register a sparse table; slots are filled in by register_file() */
+    ret = io_uring_register_files(&uring_source->ring,
+                                  uring_source->files, n_files);
+    if (ret < 0) {
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(-ret),
+                    "Failed to register files: %s", g_strerror(-ret));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+IoUringSource *io_uring_source_new(const IoUringSourceConfig *config,
+                                   GError **error)
+{
+    IoUringSource *uring_source;
+    struct io_uring_params params;
+    guint depth = IO_URING_SOURCE_DEFAULT_DEPTH;
+    int ret;
+
+    if (config && config->ring_depth > 0) {
+        depth = config->ring_depth;
+    }
+
+    /* Create the GSource */
+    uring_source = (IoUringSource *)g_source_new(&io_uring_source_funcs,
+                                                 sizeof(IoUringSource));
+    g_source_set_name((GSource *)uring_source, "IoUringSource");
+    uring_source->mode = config ? config->mode : IO_URING_SOURCE_MODE_RING_FD;
+    uring_source->event_fd = -1;
+
+    memset(&params, 0, sizeof(params));
+    if (uring_source->mode == IO_URING_SOURCE_MODE_SQPOLL) {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = (config->sqpoll_idle_ms > 0) ?
+            config->sqpoll_idle_ms : IO_URING_SOURCE_DEFAULT_SQPOLL_IDLE_MS;
+    }
+
+    ret = io_uring_queue_init_params(depth, &uring_source->ring, &params);
+    if (ret < 0) {
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(-ret),
+                    "Failed to initialize io_uring: %s", g_strerror(-ret));
+        g_source_unref((GSource *)uring_source);
+        return NULL;
+    }
+
+    uring_source->ring_initialized = TRUE;
+
+    /* One op slot per CQ entry covers the common case without growing */
+    op_table_init(uring_source, params.cq_entries);
+
+    if (config && config->n_fixed_buffers > 0 &&
+        !setup_fixed_buffers(uring_source, config->n_fixed_buffers,
+                             config->fixed_buffer_size, error)) {
+        g_source_unref((GSource *)uring_source);
+        return NULL;
+    }
+
+    if (config && config->n_fixed_files > 0 &&
+        !setup_fixed_files(uring_source, config->n_fixed_files, error)) {
+        g_source_unref((GSource *)uring_source);
+        return NULL;
+    }
+
+    if (uring_source->mode != IO_URING_SOURCE_MODE_RING_FD) {
+        uring_source->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (uring_source->event_fd < 0) {
+            int saved_errno = errno;
+            g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                        "Failed to create eventfd: %s", g_strerror(saved_errno));
+            g_source_unref((GSource *)uring_source);
+            return NULL;
+        }
+
+        ret = io_uring_register_eventfd(&uring_source->ring,
+                                        uring_source->event_fd);
+        if (ret < 0) {
+            g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(-ret),
+                        "Failed to register eventfd: %s", g_strerror(-ret));
+            g_source_unref((GSource *)uring_source);
+            return NULL;
+        }
+    }
+
+    /* Set up the poll FD to monitor io_uring completions */
+    uring_source->poll_fd.fd = (uring_source->event_fd >= 0) ?
+        uring_source->event_fd : uring_source->ring.ring_fd;
+    uring_source->poll_fd.events = G_IO_IN;
+    uring_source->poll_fd.revents = 0;
+
+    g_source_add_poll((GSource *)uring_source, &uring_source->poll_fd);
+
+    return uring_source;
+}
+
+struct io_uring *io_uring_source_get_ring(IoUringSource *source)
+{
+    return &source->ring;
+}
+
+IoUringSourceMode io_uring_source_get_mode(IoUringSource *source)
+{
+    return source->mode;
+}
+
+struct io_uring_sqe *io_uring_source_get_sqe(IoUringSource *source)
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&source->ring);
+
+    if (sqe == NULL) {
+        /* SQ full: submit the batch early and retry once */
+        io_uring_source_flush(source);
+        sqe = io_uring_get_sqe(&source->ring);
+        if (sqe == NULL) {
+            return NULL;
+        }
+    }
+
+    source->pending_sqes++;
+    return sqe;
+}
+
+guint64 io_uring_source_sqe_set_callback(IoUringSource *source,
+                                         struct io_uring_sqe *sqe,
+                                         IoUringCompletionFunc func,
+                                         gpointer user_data)
+{
+    guint32 index = op_alloc(source, func, user_data);
+    guint64 cookie = op_cookie(source, index);
+
+    io_uring_sqe_set_data64(sqe, cookie);
+    return cookie;
+}
+
+gint io_uring_source_flush(IoUringSource *source)
+{
+    gboolean needs_enter = TRUE;
+    int ret;
+
+    /* Publish recycled provided buffers before anything that might
+     * need them is submitted */
+    if (source->buf_rings) {
+        for (guint i = 0; i < source->buf_rings->len; i++) {
+            IoUringBufRing *buf_ring = g_ptr_array_index(source->buf_rings, i);
+
+            if (buf_ring->pending > 0) {
+                io_uring_buf_ring_advance(buf_ring->br, buf_ring->pending);
+                buf_ring->pending = 0;
+            }
+        }
+    }
+
+    if (source->pending_sqes == 0) {
+        return 0;
+    }
+
+    /* With SQPOLL, liburing only enters the kernel to wake an idle
+     * poller thread */
+    if (source->mode == IO_URING_SOURCE_MODE_SQPOLL) {
+        needs_enter = (__atomic_load_n(source->ring.sq.kflags, __ATOMIC_ACQUIRE) &
+                       IORING_SQ_NEED_WAKEUP) != 0;
+    }
+
+    ret = io_uring_submit(&source->ring);
+    source->stats.submit_calls++;
+    if (needs_enter) {
+        source->stats.enter_syscalls++;
+    }
+
+    if (ret < 0) {
+        /* -EBUSY/-EAGAIN: CQ is backed up, retry on the next iteration */
+        if (ret != -EBUSY && ret != -EAGAIN) {
+            g_warning("io_uring: submit failed: %s", g_strerror(-ret));
+        }
+        return ret;
+    }
+
+    if (source->mode == IO_URING_SOURCE_MODE_SQPOLL) {
+        /* The tail is published; the kernel thread consumes it */
+        source->stats.sqes_submitted += source->pending_sqes;
+        source->pending_sqes = 0;
+    } else {
+        source->stats.sqes_submitted += ret;
+        source->pending_sqes = io_uring_sq_ready(&source->ring);
+    }
+    return ret;
+}
+
+gboolean io_uring_source_cancel(IoUringSource *source, guint64 cookie)
+{
+    struct io_uring_sqe *sqe = io_uring_source_get_sqe(source);
+
+    if (sqe == NULL) {
+        return FALSE;
+    }
+
+    io_uring_prep_cancel64(sqe, cookie, 0);
+    io_uring_source_sqe_set_callback(source, sqe, NULL, NULL);
+    return TRUE;
+}
+
+gint io_uring_source_register_file(IoUringSource *source, gint fd)
+{
+    for (guint slot = 0; slot < source->n_files; slot++) {
+        if (source->files[slot] != -1) {
+            continue;
+        }
+
+        int ret = io_uring_register_files_update(&source->ring, slot, &fd, 1);
+        if (ret < 0) {
+            g_warning("io_uring: failed to register fd %d: %s",
+                      fd, g_strerror(-ret));
+            return -1;
+        }
+
+        source->files[slot] = fd;
+        return (gint)slot;
+    }
+
+    return -1;
+}
+
+void io_uring_source_unregister_file(IoUringSource *source, gint slot)
+{
+    gint unused = -1;
+
+    g_return_if_fail(slot >= 0 && (guint)slot < source->n_files);
+
+    io_uring_register_files_update(&source->ring, slot, &unused, 1);
+    source->files[slot] = -1;
+}
+
+gpointer io_uring_source_acquire_buffer(IoUringSource *source,
+                                        guint *buf_index)
+{
+    if (source->n_free_buffers == 0) {
+        return NULL;
+    }
+
+    guint index = source->free_buffers[--source->n_free_buffers];
+    *buf_index = index;
+    return source->buffer_mem + index * source->buffer_size;
+}
+
+void io_uring_source_release_buffer(IoUringSource *source, guint buf_index)
+{
+    g_return_if_fail(buf_index < source->n_buffers);
+    g_return_if_fail(source->n_free_buffers < source->n_buffers);
+
+    source->free_buffers[source->n_free_buffers++] = buf_index;
+}
+
+gpointer io_uring_source_get_buffer(IoUringSource *source, guint buf_index)
+{
+    g_return_val_if_fail(buf_index < source->n_buffers, NULL);
+
+    return source->buffer_mem + buf_index * source->buffer_size;
+}
+
+gsize io_uring_source_get_buffer_size(IoUringSource *source)
+{
+    return source->buffer_size;
+}
+
+gboolean io_uring_source_write_fixed(IoUringSource *source,
+                                     gint file_slot,
+                                     guint buf_index,
+                                     gsize length,
+                                     guint64 offset,
+                                     IoUringCompletionFunc func,
+                                     gpointer user_data)
+{
+    struct io_uring_sqe *sqe;
+
+    g_return_val_if_fail(length <= source->buffer_size, FALSE);
+
+    sqe = io_uring_source_get_sqe(source);
+    if (sqe == NULL) {
+        return FALSE;
+    }
+
+    io_uring_prep_write_fixed(sqe, file_slot,
+                              io_uring_source_get_buffer(source, buf_index),
+                              length, offset, buf_index);
+    sqe->flags |= IOSQE_FIXED_FILE;
+    io_uring_source_sqe_set_callback(source, sqe, func, user_data);
+
+    return TRUE;
+}
+
+gboolean io_uring_source_read_fixed(IoUringSource *source,
+                                    gint file_slot,
+                                    guint buf_index,
+                                    gsize length,
+                                    guint64 offset,
+                                    IoUringCompletionFunc func,
+                                    gpointer user_data)
+{
+    struct io_uring_sqe *sqe;
+
+    g_return_val_if_fail(length <= source->buffer_size, FALSE);
+
+    sqe = io_uring_source_get_sqe(source);
+    if (sqe == NULL) {
+        return FALSE;
+    }
+
+    io_uring_prep_read_fixed(sqe, file_slot,
+                             io_uring_source_get_buffer(source, buf_index),
+                             length, offset, buf_index);
+    sqe->flags |= IOSQE_FIXED_FILE;
+    io_uring_source_sqe_set_callback(source, sqe, func, user_data);
+
+    return TRUE;
+}
+
+IoUringBufRing *io_uring_source_add_buf_ring(IoUringSource *source,
+                                             guint16 group_id,
+                                             guint n_entries,
+                                             gsize buf_size,
+                                             GError **error)
+{
+    IoUringBufRing *buf_ring;
+    void *mem;
+    int ret;
+
+    g_return_val_if_fail(n_entries > 0 && (n_entries & (n_entries - 1)) == 0, NULL);
+    g_return_val_if_fail(n_entries <= 32768, NULL);
+
+    ret = posix_memalign(&mem, 4096, n_entries * buf_size);
+    if (ret != 0) {
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(ret),
+                    "Failed to allocate buffer ring: %s", g_strerror(ret));
+        return NULL;
+    }
+
+    buf_ring = g_new0(IoUringBufRing, 1);
+    buf_ring->br = io_uring_setup_buf_ring(&source->ring, n_entries,
+                                           group_id, 0, &ret);
+    if (buf_ring->br == NULL) {
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(-ret),
+                    "Failed to set up buffer ring: %s", g_strerror(-ret));
+        free(mem);
+        g_free(buf_ring);
+        return NULL;
+    }
+
+    buf_ring->group_id = group_id;
+    buf_ring->n_entries = n_entries;
+    buf_ring->buf_size = buf_size;
+    buf_ring->mem = mem;
+
+    /* Start with every buffer owned by the kernel */
+    for (guint i = 0; i < n_entries; i++) {
+        io_uring_buf_ring_add(buf_ring->br, buf_ring->mem + i * buf_size,
+                              buf_size, i, io_uring_buf_ring_mask(n_entries), i);
+    }
+    io_uring_buf_ring_advance(buf_ring->br, n_entries);
+
+    if (source->buf_rings == NULL) {
+        source->buf_rings = g_ptr_array_new();
+    }
+    g_ptr_array_add(source->buf_rings, buf_ring);
+
+    return buf_ring;
+}
+
+guint16 io_uring_buf_ring_get_group(IoUringBufRing *buf_ring)
+{
+    return buf_ring->group_id;
+}
+
+gsize io_uring_buf_ring_get_buffer_size(IoUringBufRing *buf_ring)
+{
+    return buf_ring->buf_size;
+}
+
+gpointer io_uring_buf_ring_get_buffer(IoUringBufRing *buf_ring,
+                                      guint32 cqe_flags,
+                                      guint16 *buf_id)
+{
+    guint16 id;
+
+    if (!(cqe_flags & IORING_CQE_F_BUFFER)) {
+        return NULL;
+    }
+
+    id = cqe_flags >> IORING_CQE_BUFFER_SHIFT;
+    g_return_val_if_fail(id < buf_ring->n_entries, NULL);
+
+    *buf_id = id;
+    return buf_ring->mem + id * buf_ring->buf_size;
+}
+
+void io_uring_buf_ring_recycle(IoUringBufRing *buf_ring, guint16 buf_id)
+{
+    g_return_if_fail(buf_id < buf_ring->n_entries);
+
+    io_uring_buf_ring_add(buf_ring->br, buf_ring->mem + buf_id * buf_ring->buf_size,
+                          buf_ring->buf_size, buf_id,
+                          io_uring_buf_ring_mask(buf_ring->n_entries),
+                          buf_ring->pending);
+    buf_ring->pending++;
+}
+
+guint io_uring_source_get_in_flight(IoUringSource *source)
+{
+    return source->in_flight;
+}
+
+void io_uring_source_get_stats(IoUringSource *source,
+                               IoUringSourceStats *stats)
+{
+    *stats = source->stats;
+}
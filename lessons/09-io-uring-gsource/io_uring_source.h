@@ -0,0 +1,152 @@
+/*
+ * io_uring_source.h - Batched io_uring GSource
+ *
+ * A GSource that owns an io_uring instance and dispatches completions
+ * from the GLib main loop. Every operation is tracked in an op table;
+ * the SQE's user_data carries a cookie (slot index + generation) that
+ * identifies the op, so completions never have to guess what their
+ * user_data points to. SQEs are batched and flushed once per main-loop
+ * iteration from prepare(), and fixed buffers / registered files can be
+ * used so the kernel doesn't pin pages or look up fds on every op.
+ */
+
+#ifndef IO_URING_SOURCE_H
+#define IO_URING_SOURCE_H
+
+#include <glib.h>
+#include <liburing.h>
+
+G_BEGIN_DECLS
+
+typedef struct _IoUringSource IoUringSource;
+typedef struct _IoUringBufRing IoUringBufRing;
+
+/* Called once per CQE. For multishot operations @flags contains
+ * IORING_CQE_F_MORE while further completions are still to come; the
+ * op stays registered until a CQE without that flag arrives. */
+typedef void (*IoUringCompletionFunc)(IoUringSource *source,
+                                      gint res,
+                                      guint32 flags,
+                                      gpointer user_data);
+
+#define IO_URING_SOURCE_DEFAULT_DEPTH 256
+#define IO_URING_SOURCE_DEFAULT_SQPOLL_IDLE_MS 1000
+
+/* How submissions reach the kernel and how completions wake the loop */
+typedef enum {
+    /* Poll the ring fd; every submit is an io_uring_enter() syscall */
+    IO_URING_SOURCE_MODE_RING_FD,
+    /* Poll an eventfd registered with io_uring_register_eventfd() */
+    IO_URING_SOURCE_MODE_EVENTFD,
+    /* Eventfd notification plus an IORING_SETUP_SQPOLL kernel thread
+     * that picks up submissions without a syscall while it is awake */
+    IO_URING_SOURCE_MODE_SQPOLL
+} IoUringSourceMode;
+
+typedef struct {
+    guint ring_depth;          /* SQ entries, 0 = IO_URING_SOURCE_DEFAULT_DEPTH */
+    guint n_fixed_buffers;     /* Registered buffers, 0 = none */
+    gsize fixed_buffer_size;   /* Size of each registered buffer */
+    guint n_fixed_files;       /* Registered file slots, 0 = none */
+    IoUringSourceMode mode;
+    guint sqpoll_idle_ms;      /* SQPOLL thread idle time, 0 = default */
+} IoUringSourceConfig;
+
+typedef struct {
+    guint64 submit_calls;      /* io_uring_submit() calls */
+    guint64 enter_syscalls;    /* io_uring_enter() syscalls those needed */
+    guint64 sqes_submitted;    /* SQEs handed to the kernel */
+    guint64 completions;       /* CQEs reaped */
+    guint64 dispatches;        /* dispatch() invocations */
+    guint64 prepare_ready;     /* Iterations where prepare() found CQEs */
+    guint64 eventfd_reads;     /* read() calls to clear the eventfd */
+} IoUringSourceStats;
+
+/* Create a source; @config may be NULL for defaults. The GSource
+ * callback, if set, is invoked once per dispatched batch. SQPOLL mode may
+ * need CAP_SYS_NICE on kernels older than 5.11. */
+IoUringSource *io_uring_source_new(const IoUringSourceConfig *config,
+                                   GError **error);
+
+struct io_uring *io_uring_source_get_ring(IoUringSource *source);
+IoUringSourceMode io_uring_source_get_mode(IoUringSource *source);
+
+/* Get an SQE for a new operation. If the submission queue is full the
+ * pending batch is flushed early. Prepare the SQE with io_uring_prep_*()
+ * (which resets sqe->flags), then call io_uring_source_sqe_set_callback().
+ * Returns NULL if no SQE is available even after flushing. */
+struct io_uring_sqe *io_uring_source_get_sqe(IoUringSource *source);
+
+/* Register @func for a prepared SQE and return its cookie, which can be
+ * passed to io_uring_source_cancel(). @func may be NULL. */
+guint64 io_uring_source_sqe_set_callback(IoUringSource *source,
+                                         struct io_uring_sqe *sqe,
+                                         IoUringCompletionFunc func,
+                                         gpointer user_data);
+
+/* Submit all pending SQEs now instead of waiting for prepare() */
+gint io_uring_source_flush(IoUringSource *source);
+
+/* Queue an async cancel for the op identified by @cookie */
+gboolean io_uring_source_cancel(IoUringSource *source, guint64 cookie);
+
+/* Registered files: returns the fixed-file slot or -1 if none is free.
+ * Use the slot as the fd together with IOSQE_FIXED_FILE. */
+gint io_uring_source_register_file(IoUringSource *source, gint fd);
+void io_uring_source_unregister_file(IoUringSource *source, gint slot);
+
+/* Fixed buffers: returns NULL if none is free */
+gpointer io_uring_source_acquire_buffer(IoUringSource *source,
+                                        guint *buf_index);
+void io_uring_source_release_buffer(IoUringSource *source, guint buf_index);
+gpointer io_uring_source_get_buffer(IoUringSource *source, guint buf_index);
+gsize io_uring_source_get_buffer_size(IoUringSource *source);
+
+/* Convenience wrappers for fixed-buffer I/O on a registered file */
+gboolean io_uring_source_write_fixed(IoUringSource *source,
+                                     gint file_slot,
+                                     guint buf_index,
+                                     gsize length,
+                                     guint64 offset,
+                                     IoUringCompletionFunc func,
+                                     gpointer user_data);
+gboolean io_uring_source_read_fixed(IoUringSource *source,
+                                    gint file_slot,
+                                    guint buf_index,
+                                    gsize length,
+                                    guint64 offset,
+                                    IoUringCompletionFunc func,
+                                    gpointer user_data);
+
+/* Provided buffer rings (Linux 5.19+): prep a recv with a NULL buffer,
+ * set IOSQE_BUFFER_SELECT and sqe->buf_group to the ring's group, and the
+ * kernel picks a buffer when data arrives instead of one being pinned per
+ * pending recv. @n_entries must be a power of two. The ring belongs to
+ * the source and is freed with it. */
+IoUringBufRing *io_uring_source_add_buf_ring(IoUringSource *source,
+                                             guint16 group_id,
+                                             guint n_entries,
+                                             gsize buf_size,
+                                             GError **error);
+guint16 io_uring_buf_ring_get_group(IoUringBufRing *buf_ring);
+gsize io_uring_buf_ring_get_buffer_size(IoUringBufRing *buf_ring);
+
+/* Returns the buffer the kernel selected for a CQE (IORING_CQE_F_BUFFER
+ * in @cqe_flags) and stores its id in @buf_id, or NULL if there is none */
+gpointer io_uring_buf_ring_get_buffer(IoUringBufRing *buf_ring,
+                                      guint32 cqe_flags,
+                                      guint16 *buf_id);
+
+/* Hand a buffer back to the kernel. Returns are batched and published
+ * with the next flush. */
+void io_uring_buf_ring_recycle(IoUringBufRing *buf_ring, guint16 buf_id);
+
+/* Number of operations submitted or queued but not yet completed */
+guint io_uring_source_get_in_flight(IoUringSource *source);
+
+void io_uring_source_get_stats(IoUringSource *source,
+                               IoUringSourceStats *stats);
+
+G_END_DECLS
+
+#endif /* IO_URING_SOURCE_H */
@@ -0,0 +1,859 @@
+/*
+ * io_uring_stream.c - Read-ahead / write-behind streams on IoUringSource
+ *
+ * Each stream owns window * chunk_size bytes of buffer space allocated
+ * once at construction. Every in-flight chunk holds a reference on its
+ * stream, so buffers stay valid until the kernel is done with them even
+ * if the caller drops the stream early.
+ */
+
+#include "io_uring_stream.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+/* Buffers are page aligned so the fd may also be opened O_DIRECT */
+static guint8 *alloc_window(gsize chunk_size, guint window)
+{
+    void *mem = NULL;
+
+    if (posix_memalign(&mem, 4096, chunk_size * window) != 0) {
+        g_error("Failed to allocate %zu byte stream window", chunk_size * window);
+    }
+
+    return mem;
+}
+
+static guint64 initial_offset(gint fd)
+{
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    return (offset < 0) ? 0 : (guint64)offset;
+}
+
+/* Sync fallbacks: run one iteration of the source's context. Only valid
+ * on the thread that owns (or can acquire) that context. */
+static gboolean iterate_source_context(IoUringSource *source,
+                                       GCancellable *cancellable,
+                                       GError **error)
+{
+    GMainContext *context = g_source_get_context((GSource *)source);
+
+    if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+        return FALSE;
+    }
+
+    if (context == NULL || !g_main_context_acquire(context)) {
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                            "Synchronous I/O must run on the thread that "
+                            "owns the IoUringSource's context");
+        return FALSE;
+    }
+
+    g_main_context_iteration(context, TRUE);
+    g_main_context_release(context);
+    return TRUE;
+}
+
+static void set_errno_error(GError **error, gint neg_errno, const gchar *what)
+{
+    g_set_error(error, G_IO_ERROR, g_io_error_from_errno(-neg_errno),
+                "%s failed: %s", what, g_strerror(-neg_errno));
+}
+
+/* ============================================================
+ * IoUringInputStream - read-ahead
+ * ============================================================ */
+
+typedef enum {
+    CHUNK_IDLE,
+    CHUNK_IN_FLIGHT,
+    CHUNK_READY
+} ChunkState;
+
+typedef struct {
+    IoUringInputStream *stream;
+    guint8 *data;
+    guint64 offset;    /* File offset of data[0] */
+    gsize filled;
+    gsize consumed;
+    gint error;        /* -errno, 0 on success */
+    gboolean eof;
+    ChunkState state;
+    guint64 cookie;
+} ReadChunk;
+
+struct _IoUringInputStream {
+    GInputStream parent_instance;
+
+    IoUringSource *source;
+    gint fd;
+    gboolean close_fd;
+
+    gsize chunk_size;
+    guint window;
+    guint8 *buffer_mem;
+    ReadChunk *chunks;
+
+    /* Chunks head .. head + n_issued - 1 (mod window) are in use, in
+     * file order; head is the next one handed to the reader */
+    guint head;
+    guint n_issued;
+    guint64 next_offset;
+    gboolean eof_seen;
+    gboolean closed;
+
+    /* Async read waiting for the head chunk */
+    GTask *pending;
+    gpointer pending_buffer;
+    gsize pending_count;
+};
+
+G_DEFINE_TYPE(IoUringInputStream, io_uring_input_stream, G_TYPE_INPUT_STREAM)
+
+static void on_chunk_read(IoUringSource *source,
+                          gint res,
+                          guint32 flags,
+                          gpointer user_data);
+
+static void submit_chunk_read(IoUringInputStream *self, ReadChunk *chunk)
+{
+    struct io_uring_sqe *sqe = io_uring_source_get_sqe(self->source);
+
+    if (sqe == NULL) {
+        chunk->error = -EBUSY;
+        chunk->state = CHUNK_READY;
+        return;
+    }
+
+    io_uring_prep_read(sqe, self->fd,
+                       chunk->data + chunk->filled,
+                       self->chunk_size - chunk->filled,
+                       chunk->offset + chunk->filled);
+    chunk->state = CHUNK_IN_FLIGHT;
+
+    /* Keeps the buffers alive until the kernel is done with them */
+    g_object_ref(self);
+    chunk->cookie = io_uring_source_sqe_set_callback(self->source, sqe,
+                                                     on_chunk_read, chunk);
+}
+
+/* Issue reads until the whole window is in use */
+static void fill_window(IoUringInputStream *self)
+{
+    while (!self->eof_seen && !self->closed && self->n_issued < self->window) {
+        ReadChunk *chunk = &self->chunks[(self->head + self->n_issued) % self->window];
+
+        chunk->offset = self->next_offset;
+        chunk->filled = 0;
+        chunk->consumed = 0;
+        chunk->error = 0;
+        chunk->eof = FALSE;
+
+        self->next_offset += self->chunk_size;
+        self->n_issued++;
+        submit_chunk_read(self, chunk);
+    }
+}
+
+static gboolean head_ready(IoUringInputStream *self)
+{
+    return self->n_issued > 0 && self->chunks[self->head].state == CHUNK_READY;
+}
+
+/* Copy out of ready chunks starting at head. Returns the byte count
+ * (0 at EOF) or -1 with @error set. */
+static gssize consume_ready(IoUringInputStream *self,
+                            guint8 *buffer,
+                            gsize count,
+                            GError **error)
+{
+    gsize copied = 0;
+
+    while (copied < count && head_ready(self)) {
+        ReadChunk *chunk = &self->chunks[self->head];
+
+        if (chunk->error < 0) {
+            if (copied > 0) {
+                break;  /* Report it on the next read */
+            }
+            set_errno_error(error, chunk->error, "Read");
+            return -1;
+        }
+
+        gsize n = MIN(count - copied, chunk->filled - chunk->consumed);
+        memcpy(buffer + copied, chunk->data + chunk->consumed, n);
+        chunk->consumed += n;
+        copied += n;
+
+        if (chunk->consumed == chunk->filled) {
+            if (chunk->eof) {
+                break;  /* Stays at head so later reads return 0 */
+            }
+            chunk->state = CHUNK_IDLE;
+            self->head = (self->head + 1) % self->window;
+            self->n_issued--;
+        }
+    }
+
+    /* Recycle consumed chunks into new read-ahead */
+    fill_window(self);
+    return copied;
+}
+
+static void complete_read(IoUringInputStream *self,
+                          GTask *task,
+                          gpointer buffer,
+                          gsize count)
+{
+    GError *error = NULL;
+    gssize n;
+
+    if (g_task_return_error_if_cancelled(task)) {
+        g_object_unref(task);
+        return;
+    }
+
+    n = consume_ready(self, buffer, count, &error);
+    if (n < 0) {
+        g_task_return_error(task, error);
+    } else {
+        g_task_return_int(task, n);
+    }
+    g_object_unref(task);
+}
+
+static void on_chunk_read(IoUringSource *source,
+                          gint res,
+                          guint32 flags,
+                          gpointer user_data)
+{
+    ReadChunk *chunk = (ReadChunk *)user_data;
+    IoUringInputStream *self = chunk->stream;
+
+    if (res > 0) {
+        chunk->filled += res;
+        if (chunk->filled < self->chunk_size && !self->closed) {
+            /* Short read: fetch the rest so chunks stay contiguous.
+             * At end of file this comes back as 0 and sets eof. */
+            submit_chunk_read(self, chunk);
+            if (chunk->state == CHUNK_IN_FLIGHT) {
+                g_object_unref(self);
+                return;
+            }
+        }
+    } else if (res == 0) {
+        chunk->eof = TRUE;
+        self->eof_seen = TRUE;
+    } else {
+        chunk->error = res;
+    }
+
+    /* A failed resubmit above has already recorded its error */
+    chunk->state = CHUNK_READY;
+
+    if (self->pending && head_ready(self)) {
+        GTask *task = g_steal_pointer(&self->pending);
+        complete_read(self, task, self->pending_buffer, self->pending_count);
+    }
+
+    g_object_unref(self);
+}
+
+static gssize io_uring_input_stream_read(GInputStream *stream,
+                                         void *buffer,
+                                         gsize count,
+                                         GCancellable *cancellable,
+                                         GError **error)
+{
+    IoUringInputStream *self = IO_URING_INPUT_STREAM(stream);
+
+    fill_window(self);
+    while (!head_ready(self)) {
+        if (!iterate_source_context(self->source, cancellable, error)) {
+            return -1;
+        }
+    }
+
+    return consume_ready(self, buffer, count, error);
+}
+
+static void io_uring_input_stream_read_async(GInputStream *stream,
+                                             void *buffer,
+                                             gsize count,
+                                             int io_priority,
+                                             GCancellable *cancellable,
+                                             GAsyncReadyCallback callback,
+                                             gpointer user_data)
+{
+    IoUringInputStream *self = IO_URING_INPUT_STREAM(stream);
+    GTask *task = g_task_new(stream, cancellable, callback, user_data);
+
+    g_task_set_source_tag(task, io_uring_input_stream_read_async);
+
+    fill_window(self);
+    if (head_ready(self)) {
+        complete_read(self, task, buffer, count);
+        return;
+    }
+
+    /* GInputStream allows one outstanding op, so one slot is enough.
+     * Cancellation is checked when the head chunk lands. */
+    self->pending = task;
+    self->pending_buffer = buffer;
+    self->pending_count = count;
+}
+
+static gssize io_uring_input_stream_read_finish(GInputStream *stream,
+                                                GAsyncResult *result,
+                                                GError **error)
+{
+    return g_task_propagate_int(G_TASK(result), error);
+}
+
+static gboolean io_uring_input_stream_close(GInputStream *stream,
+                                            GCancellable *cancellable,
+                                            GError **error)
+{
+    IoUringInputStream *self = IO_URING_INPUT_STREAM(stream);
+
+    self->closed = TRUE;
+
+    /* Outstanding read-ahead is no longer wanted */
+    for (guint i = 0; i < self->window; i++) {
+        if (self->chunks[i].state == CHUNK_IN_FLIGHT) {
+            io_uring_source_cancel(self->source, self->chunks[i].cookie);
+        }
+    }
+
+    /* Submitted ops hold their own file reference in the kernel, but
+     * read-ahead still in the SQ would only look the fd up at the next
+     * submit: after close() it could read from a file that reused the
+     * number. Submit it, and the cancels, first. */
+    io_uring_source_flush(self->source);
+
+    if (self->close_fd && self->fd >= 0) {
+        if (close(self->fd) < 0) {
+            set_errno_error(error, -errno, "Close");
+            self->fd = -1;
+            return FALSE;
+        }
+        self->fd = -1;
+    }
+
+    return TRUE;
+}
+
+static void io_uring_input_stream_close_async(GInputStream *stream,
+                                              int io_priority,
+                                              GCancellable *cancellable,
+                                              GAsyncReadyCallback callback,
+                                              gpointer user_data)
+{
+    GTask *task = g_task_new(stream, cancellable, callback, user_data);
+    GError *error = NULL;
+
+    /* Closing never blocks, so no need for the default thread hop */
+    if (io_uring_input_stream_close(stream, cancellable, &error)) {
+        g_task_return_boolean(task, TRUE);
+    } else {
+        g_task_return_error(task, error);
+    }
+    g_object_unref(task);
+}
+
+static gboolean io_uring_input_stream_close_finish(GInputStream *stream,
+                                                   GAsyncResult *result,
+                                                   GError **error)
+{
+    return g_task_propagate_boolean(G_TASK(result), error);
+}
+
+static void io_uring_input_stream_finalize(GObject *object)
+{
+    IoUringInputStream *self = IO_URING_INPUT_STREAM(object);
+
+    if (self->close_fd && self->fd >= 0) {
+        close(self->fd);
+    }
+
+    free(self->buffer_mem);
+    g_free(self->chunks);
+    g_source_unref((GSource *)self->source);
+
+    G_OBJECT_CLASS(io_uring_input_stream_parent_class)->finalize(object);
+}
+
+static void io_uring_input_stream_class_init(IoUringInputStreamClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+    GInputStreamClass *stream_class = G_INPUT_STREAM_CLASS(klass);
+
+    object_class->finalize = io_uring_input_stream_finalize;
+
+    stream_class->read_fn = io_uring_input_stream_read;
+    stream_class->read_async = io_uring_input_stream_read_async;
+    stream_class->read_finish = io_uring_input_stream_read_finish;
+    stream_class->close_fn = io_uring_input_stream_close;
+    stream_class->close_async = io_uring_input_stream_close_async;
+    stream_class->close_finish = io_uring_input_stream_close_finish;
+}
+
+static void io_uring_input_stream_init(IoUringInputStream *self)
+{
+    self->fd = -1;
+}
+
+GInputStream *io_uring_input_stream_new(IoUringSource *source,
+                                        gint fd,
+                                        gsize chunk_size,
+                                        guint window,
+                                        gboolean close_fd)
+{
+    IoUringInputStream *self;
+
+    g_return_val_if_fail(source != NULL, NULL);
+    g_return_val_if_fail(fd >= 0, NULL);
+
+    self = g_object_new(IO_URING_TYPE_INPUT_STREAM, NULL);
+    self->source = (IoUringSource *)g_source_ref((GSource *)source);
+    self->fd = fd;
+    self->close_fd = close_fd;
+    self->chunk_size = chunk_size ? chunk_size : IO_URING_STREAM_DEFAULT_CHUNK_SIZE;
+    self->window = window ? window : IO_URING_STREAM_DEFAULT_WINDOW;
+    self->next_offset = initial_offset(fd);
+
+    self->buffer_mem = alloc_window(self->chunk_size, self->window);
+    self->chunks = g_new0(ReadChunk, self->window);
+    for (guint i = 0; i < self->window; i++) {
+        self->chunks[i].stream = self;
+        self->chunks[i].data = self->buffer_mem + i * self->chunk_size;
+    }
+
+    return G_INPUT_STREAM(self);
+}
+
+/* ============================================================
+ * IoUringOutputStream - write-behind
+ * ============================================================ */
+
+typedef struct {
+    IoUringOutputStream *stream;
+    guint8 *data;
+    guint64 offset;    /* File offset of data[0] */
+    gsize length;      /* Bytes copied in */
+    gsize written;     /* Bytes the kernel has confirmed */
+} WriteChunk;
+
+struct _IoUringOutputStream {
+    GOutputStream parent_instance;
+
+    IoUringSource *source;
+    gint fd;
+    gboolean close_fd;
+
+    gsize chunk_size;
+    guint window;
+    guint8 *buffer_mem;
+    WriteChunk *chunks;
+
+    /* Free chunks (stack) and the one currently being filled */
+    WriteChunk **free_chunks;
+    guint n_free;
+    WriteChunk *current;
+    guint n_in_flight;
+
+    guint64 next_offset;
+    gint error;       /* First write error, -errno; sticky */
+
+    /* Write waiting for a free chunk */
+    GTask *pending_write;
+    const guint8 *pending_buffer;
+    gsize pending_count;
+
+    /* Flush or close waiting for in-flight writes to drain */
+    GTask *pending_drain;
+    gboolean close_after_drain;
+};
+
+G_DEFINE_TYPE(IoUringOutputStream, io_uring_output_stream, G_TYPE_OUTPUT_STREAM)
+
+static void on_chunk_written(IoUringSource *source,
+                             gint res,
+                             guint32 flags,
+                             gpointer user_data);
+
+static gboolean submit_chunk_write(IoUringOutputStream *self, WriteChunk *chunk)
+{
+    struct io_uring_sqe *sqe = io_uring_source_get_sqe(self->source);
+
+    if (sqe == NULL) {
+        if (self->error == 0) {
+            self->error = -EBUSY;
+        }
+        return FALSE;
+    }
+
+    io_uring_prep_write(sqe, self->fd,
+                        chunk->data + chunk->written,
+                        chunk->length - chunk->written,
+                        chunk->offset + chunk->written);
+
+    g_object_ref(self);
+    io_uring_source_sqe_set_callback(self->source, sqe, on_chunk_written, chunk);
+    return TRUE;
+}
+
+/* Hand the chunk being filled to the kernel */
+static void submit_current(IoUringOutputStream *self)
+{
+    WriteChunk *chunk = self->current;
+
+    if (chunk == NULL || chunk->length == 0) {
+        return;
+    }
+
+    self->current = NULL;
+    self->next_offset += chunk->length;
+
+    if (submit_chunk_write(self, chunk)) {
+        self->n_in_flight++;
+    } else {
+        /* Data is lost; the sticky error reports it */
+        self->free_chunks[self->n_free++] = chunk;
+    }
+}
+
+/* Copy as much of @buffer as fits into free chunks. Full chunks are
+ * submitted straight away. Returns the number of bytes accepted. */
+static gsize accept_data(IoUringOutputStream *self,
+                         const guint8 *buffer,
+                         gsize count)
+{
+    gsize accepted = 0;
+
+    while (accepted < count) {
+        if (self->current == NULL) {
+            if (self->n_free == 0) {
+                break;
+            }
+            self->current = self->free_chunks[--self->n_free];
+            self->current->offset = self->next_offset;
+            self->current->length = 0;
+            self->current->written = 0;
+        }
+
+        WriteChunk *chunk = self->current;
+        gsize n = MIN(count - accepted, self->chunk_size - chunk->length);
+
+        memcpy(chunk->data + chunk->length, buffer + accepted, n);
+        chunk->length += n;
+        accepted += n;
+
+        if (chunk->length == self->chunk_size) {
+            submit_current(self);
+        }
+    }
+
+    return accepted;
+}
+
+static gboolean take_error(IoUringOutputStream *self, GError **error)
+{
+    if (self->error == 0) {
+        return FALSE;
+    }
+
+    set_errno_error(error, self->error, "Write");
+    return TRUE;
+}
+
+static gboolean finish_close(IoUringOutputStream *self, GError **error)
+{
+    if (self->close_fd && self->fd >= 0) {
+        gint fd = self->fd;
+
+        self->fd = -1;
+        if (close(fd) < 0) {
+            set_errno_error(error, -errno, "Close");
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static void complete_drain(IoUringOutputStream *self)
+{
+    GTask *task = g_steal_pointer(&self->pending_drain);
+    GError *error = NULL;
+
+    if (take_error(self, &error) ||
+        (self->close_after_drain && !finish_close(self, &error))) {
+        g_task_return_error(task, error);
+    } else {
+        g_task_return_boolean(task, TRUE);
+    }
+    g_object_unref(task);
+}
+
+static void on_chunk_written(IoUringSource *source,
+                             gint res,
+                             guint32 flags,
+                             gpointer user_data)
+{
+    WriteChunk *chunk = (WriteChunk *)user_data;
+    IoUringOutputStream *self = chunk->stream;
+
+    if (res > 0) {
+        chunk->written += res;
+        if (chunk->written < chunk->length &&
+            submit_chunk_write(self, chunk)) {
+            /* Short write: pushed the remainder, chunk stays in flight */
+            g_object_unref(self);
+            return;
+        }
+    } else if (self->error == 0) {
+        self->error = (res < 0) ? res : -EIO;
+    }
+
+    self->n_in_flight--;
+    self->free_chunks[self->n_free++] = chunk;
+
+    if (self->pending_write) {
+        GTask *task = g_steal_pointer(&self->pending_write);
+        GError *error = NULL;
+
+        if (take_error(self, &error)) {
+            g_task_return_error(task, error);
+        } else {
+            g_task_return_int(task, accept_data(self, self->pending_buffer,
+                                                self->pending_count));
+        }
+        g_object_unref(task);
+    }
+
+    if (self->pending_drain && self->n_in_flight == 0) {
+        complete_drain(self);
+    }
+
+    g_object_unref(self);
+}
+
+static gssize io_uring_output_stream_write(GOutputStream *stream,
+                                           const void *buffer,
+                                           gsize count,
+                                           GCancellable *cancellable,
+                                           GError **error)
+{
+    IoUringOutputStream *self = IO_URING_OUTPUT_STREAM(stream);
+    gsize accepted;
+
+    while ((accepted = accept_data(self, buffer, count)) == 0 && count > 0) {
+        if (take_error(self, error) ||
+            !iterate_source_context(self->source, cancellable, error)) {
+            return -1;
+        }
+    }
+
+    if (take_error(self, error)) {
+        return -1;
+    }
+
+    return accepted;
+}
+
+static void io_uring_output_stream_write_async(GOutputStream *stream,
+                                               const void *buffer,
+                                               gsize count,
+                                               int io_priority,
+                                               GCancellable *cancellable,
+                                               GAsyncReadyCallback callback,
+                                               gpointer user_data)
+{
+    IoUringOutputStream *self = IO_URING_OUTPUT_STREAM(stream);
+    GTask *task = g_task_new(stream, cancellable, callback, user_data);
+    GError *error = NULL;
+    gsize accepted;
+
+    g_task_set_source_tag(task, io_uring_output_stream_write_async);
+
+    if (take_error(self, &error)) {
+        g_task_return_error(task, error);
+        g_object_unref(task);
+        return;
+    }
+
+    /* Completes as soon as the data is copied; the kernel write
+     * finishes in the background */
+    accepted = accept_data(self, buffer, count);
+    if (accepted > 0 || count == 0) {
+        g_task_return_int(task, accepted);
+        g_object_unref(task);
+        return;
+    }
+
+    /* Whole window is in flight: wait for a chunk to come back */
+    self->pending_write = task;
+    self->pending_buffer = buffer;
+    self->pending_count = count;
+}
+
+static gssize io_uring_output_stream_write_finish(GOutputStream *stream,
+                                                  GAsyncResult *result,
+                                                  GError **error)
+{
+    return g_task_propagate_int(G_TASK(result), error);
+}
+
+static gboolean io_uring_output_stream_flush(GOutputStream *stream,
+                                             GCancellable *cancellable,
+                                             GError **error)
+{
+    IoUringOutputStream *self = IO_URING_OUTPUT_STREAM(stream);
+
+    submit_current(self);
+    while (self->n_in_flight > 0) {
+        if (!iterate_source_context(self->source, cancellable, error)) {
+            return FALSE;
+        }
+    }
+
+    return !take_error(self, error);
+}
+
+static void start_drain(IoUringOutputStream *self,
+                        GTask *task,
+                        gboolean close_after)
+{
+    submit_current(self);
+
+    self->pending_drain = task;
+    self->close_after_drain = close_after;
+
+    if (self->n_in_flight == 0) {
+        complete_drain(self);
+    }
+}
+
+static void io_uring_output_stream_flush_async(GOutputStream *stream,
+                                               int io_priority,
+                                               GCancellable *cancellable,
+                                               GAsyncReadyCallback callback,
+                                               gpointer user_data)
+{
+    GTask *task = g_task_new(stream, cancellable, callback, user_data);
+
+    g_task_set_source_tag(task, io_uring_output_stream_flush_async);
+    start_drain(IO_URING_OUTPUT_STREAM(stream), task, FALSE);
+}
+
+static gboolean io_uring_output_stream_flush_finish(GOutputStream *stream,
+                                                    GAsyncResult *result,
+                                                    GError **error)
+{
+    return g_task_propagate_boolean(G_TASK(result), error);
+}
+
+static gboolean io_uring_output_stream_close(GOutputStream *stream,
+                                             GCancellable *cancellable,
+                                             GError **error)
+{
+    IoUringOutputStream *self = IO_URING_OUTPUT_STREAM(stream);
+
+    /* GOutputStream has already called flush(); this only closes */
+    return finish_close(self, error);
+}
+
+static void io_uring_output_stream_close_async(GOutputStream *stream,
+                                               int io_priority,
+                                               GCancellable *cancellable,
+                                               GAsyncReadyCallback callback,
+                                               gpointer user_data)
+{
+    GTask *task = g_task_new(stream, cancellable, callback, user_data);
+
+    /* Normally already flushed via flush_async, but drain anyway so the
+     * fd never closes under an in-flight write */
+    g_task_set_source_tag(task, io_uring_output_stream_close_async);
+    start_drain(IO_URING_OUTPUT_STREAM(stream), task, TRUE);
+}
+
+static gboolean io_uring_output_stream_close_finish(GOutputStream *stream,
+                                                    GAsyncResult *result,
+                                                    GError **error)
+{
+    return g_task_propagate_boolean(G_TASK(result), error);
+}
+
+static void io_uring_output_stream_finalize(GObject *object)
+{
+    IoUringOutputStream *self = IO_URING_OUTPUT_STREAM(object);
+
+    if (self->close_fd && self->fd >= 0) {
+        close(self->fd);
+    }
+
+    free(self->buffer_mem);
+    g_free(self->chunks);
+    g_free(self->free_chunks);
+    g_source_unref((GSource *)self->source);
+
+    G_OBJECT_CLASS(io_uring_output_stream_parent_class)->finalize(object);
+}
+
+static void io_uring_output_stream_class_init(IoUringOutputStreamClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS(klass);
+    GOutputStreamClass *stream_class = G_OUTPUT_STREAM_CLASS(klass);
+
+    object_class->finalize = io_uring_output_stream_finalize;
+
+    stream_class->write_fn = io_uring_output_stream_write;
+    stream_class->write_async = io_uring_output_stream_write_async;
+    stream_class->write_finish = io_uring_output_stream_write_finish;
+    stream_class->flush = io_uring_output_stream_flush;
+    stream_class->flush_async = io_uring_output_stream_flush_async;
+    stream_class->flush_finish = io_uring_output_stream_flush_finish;
+    stream_class->close_fn = io_uring_output_stream_close;
+    stream_class->close_async = io_uring_output_stream_close_async;
+    stream_class->close_finish = io_uring_output_stream_close_finish;
+}
+
+static void io_uring_output_stream_init(IoUringOutputStream *self)
+{
+    self->fd = -1;
+}
+
+GOutputStream *io_uring_output_stream_new(IoUringSource *source,
+                                          gint fd,
+                                          gsize chunk_size,
+                                          guint window,
+                                          gboolean close_fd)
+{
+    IoUringOutputStream *self;
+
+    g_return_val_if_fail(source != NULL, NULL);
+    g_return_val_if_fail(fd >= 0, NULL);
+
+    self = g_object_new(IO_URING_TYPE_OUTPUT_STREAM, NULL);
+    self->source = (IoUringSource *)g_source_ref((GSource *)source);
+    self->fd = fd;
+    self->close_fd = close_fd;
+    self->chunk_size = chunk_size ? chunk_size : IO_URING_STREAM_DEFAULT_CHUNK_SIZE;
+    self->window = window ? window : IO_URING_STREAM_DEFAULT_WINDOW;
+    self->next_offset = initial_offset(fd);
+
+    self->buffer_mem = alloc_window(self->chunk_size, self->window);
+    self->chunks = g_new0(WriteChunk, self->window);
+    self->free_chunks = g_new(WriteChunk *, self->window);
+    for (guint i = 0; i < self->window; i++) {
+        self->chunks[i].stream = self;
+        self->chunks[i].data = self->buffer_mem + i * self->chunk_size;
+        self->free_chunks[i] = &self->chunks[self->window - 1 - i];
+    }
+    self->n_free = self->window;
+
+    return G_OUTPUT_STREAM(self);
+}
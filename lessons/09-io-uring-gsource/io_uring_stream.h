@@ -0,0 +1,53 @@
+/*
+ * io_uring_stream.h - Streaming file I/O on top of IoUringSource
+ *
+ * IoUringInputStream keeps a fixed window of chunked reads in flight
+ * ahead of the consumer (read-ahead); IoUringOutputStream copies writes
+ * into a fixed window of chunks and lets them complete in the background
+ * (write-behind). Memory use is bounded by chunk_size * window for each
+ * stream regardless of file size, and all I/O completes on the thread
+ * that runs the IoUringSource's GMainContext - no GIO thread pool hops.
+ *
+ * The async stream API (g_input_stream_read_async() etc.) is the fast
+ * path. The sync API works only on the thread that owns the source's
+ * context, where it iterates that context until data is available.
+ */
+
+#ifndef IO_URING_STREAM_H
+#define IO_URING_STREAM_H
+
+#include <gio/gio.h>
+#include "io_uring_source.h"
+
+G_BEGIN_DECLS
+
+#define IO_URING_STREAM_DEFAULT_CHUNK_SIZE (128 * 1024)
+#define IO_URING_STREAM_DEFAULT_WINDOW 4
+
+#define IO_URING_TYPE_INPUT_STREAM (io_uring_input_stream_get_type())
+G_DECLARE_FINAL_TYPE(IoUringInputStream, io_uring_input_stream,
+                     IO_URING, INPUT_STREAM, GInputStream)
+
+#define IO_URING_TYPE_OUTPUT_STREAM (io_uring_output_stream_get_type())
+G_DECLARE_FINAL_TYPE(IoUringOutputStream, io_uring_output_stream,
+                     IO_URING, OUTPUT_STREAM, GOutputStream)
+
+/* Read @fd from its current offset. @source must be attached to a
+ * context. 0 for @chunk_size / @window selects the defaults. If
+ * @close_fd is TRUE the fd is closed with the stream. */
+GInputStream *io_uring_input_stream_new(IoUringSource *source,
+                                        gint fd,
+                                        gsize chunk_size,
+                                        guint window,
+                                        gboolean close_fd);
+
+/* Write @fd from its current offset; same parameters as above */
+GOutputStream *io_uring_output_stream_new(IoUringSource *source,
+                                          gint fd,
+                                          gsize chunk_size,
+                                          guint window,
+                                          gboolean close_fd);
+
+G_END_DECLS
+
+#endif /* IO_URING_STREAM_H */
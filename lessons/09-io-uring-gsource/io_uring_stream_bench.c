@@ -0,0 +1,381 @@
+/*
+ * io_uring_stream_bench.c - Streaming copy: GIO vs io_uring streams
+ *
+ * Copies a generated file three ways and reports throughput and peak
+ * RSS for each:
+ *   1. g_file_load_contents_async() + g_file_replace_contents_async()
+ *      (what lesson 7's async_file_io.c does - the whole file in memory)
+ *   2. GFileInputStream/GFileOutputStream async reads and writes
+ *      (streaming, but every op hops through GIO's thread pool)
+ *   3. IoUringInputStream/IoUringOutputStream with read-ahead and
+ *      write-behind on an IoUringSource
+ *
+ * Each path first copies once in a forked child, so ru_maxrss measures
+ * that path alone, and the copy's size is checked. Then the parent times
+ * each with bench_run_ops(), one copy per iteration and one op per MiB.
+ *
+ * Usage: ./io_uring_stream_bench [size-MiB] [--bench-...]   (default 64)
+ */
+
+#include "bench.h"
+#include "io_uring_stream.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define SRC_PATH "/tmp/io_uring_stream_src.dat"
+#define DST_PATH "/tmp/io_uring_stream_dst.dat"
+#define COPY_BUFFER_SIZE (128 * 1024)
+
+static GMainLoop *main_loop = NULL;
+
+static gboolean create_source_file(guint64 size)
+{
+    guint8 *block = g_malloc(1024 * 1024);
+    gint fd = open(SRC_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        g_printerr("[Error] Failed to create %s: %s\n", SRC_PATH, strerror(errno));
+        g_free(block);
+        return FALSE;
+    }
+
+    for (gsize i = 0; i < 1024 * 1024; i++) {
+        block[i] = (guint8)(i * 31);
+    }
+
+    for (guint64 done = 0; done < size; done += 1024 * 1024) {
+        if (write(fd, block, MIN(size - done, 1024 * 1024)) < 0) {
+            g_printerr("[Error] Write failed: %s\n", strerror(errno));
+            close(fd);
+            g_free(block);
+            return FALSE;
+        }
+    }
+
+    close(fd);
+    g_free(block);
+    return TRUE;
+}
+
+/* ============================================================
+ * 1. Whole-file load + replace
+ * ============================================================ */
+
+static void on_replace_complete(GObject *source,
+                                GAsyncResult *result,
+                                gpointer user_data)
+{
+    GError *error = NULL;
+
+    if (!g_file_replace_contents_finish(G_FILE(source), result, NULL, &error)) {
+        g_printerr("[Error] Replace failed: %s\n", error->message);
+        g_error_free(error);
+    }
+
+    g_free(user_data);  /* The loaded contents */
+    g_main_loop_quit(main_loop);
+}
+
+static void on_load_complete(GObject *source,
+                             GAsyncResult *result,
+                             gpointer user_data)
+{
+    GFile *dst = G_FILE(user_data);
+    GError *error = NULL;
+    gchar *contents = NULL;
+    gsize length = 0;
+
+    if (!g_file_load_contents_finish(G_FILE(source), result,
+                                     &contents, &length, NULL, &error)) {
+        g_printerr("[Error] Load failed: %s\n", error->message);
+        g_error_free(error);
+        g_main_loop_quit(main_loop);
+        return;
+    }
+
+    g_file_replace_contents_async(dst, contents, length, NULL, FALSE,
+                                  G_FILE_CREATE_NONE, NULL,
+                                  on_replace_complete, contents);
+}
+
+static void run_gio_contents(void)
+{
+    GFile *src = g_file_new_for_path(SRC_PATH);
+    GFile *dst = g_file_new_for_path(DST_PATH);
+
+    g_file_load_contents_async(src, NULL, on_load_complete, dst);
+    g_main_loop_run(main_loop);
+
+    g_object_unref(src);
+    g_object_unref(dst);
+}
+
+/* ============================================================
+ * 2 & 3. Streaming copy over any GInputStream/GOutputStream
+ * ============================================================ */
+
+typedef struct {
+    GInputStream *in;
+    GOutputStream *out;
+    guint8 buffer[COPY_BUFFER_SIZE];
+} CopyJob;
+
+static void copy_read_next(CopyJob *job);
+
+static void on_copy_closed(GObject *source,
+                           GAsyncResult *result,
+                           gpointer user_data)
+{
+    GError *error = NULL;
+
+    if (!g_output_stream_close_finish(G_OUTPUT_STREAM(source), result, &error)) {
+        g_printerr("[Error] Close failed: %s\n", error->message);
+        g_error_free(error);
+    }
+
+    g_main_loop_quit(main_loop);
+}
+
+static void on_copy_written(GObject *source,
+                            GAsyncResult *result,
+                            gpointer user_data)
+{
+    CopyJob *job = (CopyJob *)user_data;
+    GError *error = NULL;
+
+    if (!g_output_stream_write_all_finish(job->out, result, NULL, &error)) {
+        g_printerr("[Error] Write failed: %s\n", error->message);
+        g_error_free(error);
+        g_main_loop_quit(main_loop);
+        return;
+    }
+
+    copy_read_next(job);
+}
+
+static void on_copy_read(GObject *source,
+                         GAsyncResult *result,
+                         gpointer user_data)
+{
+    CopyJob *job = (CopyJob *)user_data;
+    GError *error = NULL;
+    gssize n = g_input_stream_read_finish(job->in, result, &error);
+
+    if (n < 0) {
+        g_printerr("[Error] Read failed: %s\n", error->message);
+        g_error_free(error);
+        g_main_loop_quit(main_loop);
+        return;
+    }
+
+    if (n == 0) {
+        g_output_stream_close_async(job->out, G_PRIORITY_DEFAULT, NULL,
+                                    on_copy_closed, job);
+        return;
+    }
+
+    g_output_stream_write_all_async(job->out, job->buffer, n,
+                                    G_PRIORITY_DEFAULT, NULL,
+                                    on_copy_written, job);
+}
+
+static void copy_read_next(CopyJob *job)
+{
+    g_input_stream_read_async(job->in, job->buffer, sizeof(job->buffer),
+                              G_PRIORITY_DEFAULT, NULL, on_copy_read, job);
+}
+
+static void run_copy(GInputStream *in, GOutputStream *out)
+{
+    CopyJob *job = g_new(CopyJob, 1);
+
+    job->in = in;
+    job->out = out;
+    copy_read_next(job);
+    g_main_loop_run(main_loop);
+
+    g_free(job);
+}
+
+static void run_gio_streams(void)
+{
+    GFile *src = g_file_new_for_path(SRC_PATH);
+    GFile *dst = g_file_new_for_path(DST_PATH);
+    GError *error = NULL;
+    GFileInputStream *in;
+    GFileOutputStream *out;
+
+    in = g_file_read(src, NULL, &error);
+    out = in ? g_file_replace(dst, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &error) : NULL;
+
+    if (out) {
+        run_copy(G_INPUT_STREAM(in), G_OUTPUT_STREAM(out));
+    } else {
+        g_printerr("[Error] %s\n", error->message);
+        g_error_free(error);
+    }
+
+    g_clear_object(&in);
+    g_clear_object(&out);
+    g_object_unref(src);
+    g_object_unref(dst);
+}
+
+static void run_io_uring_streams(void)
+{
+    IoUringSourceConfig config = {
+        .ring_depth = 64,
+        .mode = IO_URING_SOURCE_MODE_EVENTFD,
+    };
+    IoUringSource *uring_source;
+    GError *error = NULL;
+    GInputStream *in;
+    GOutputStream *out;
+    gint in_fd, out_fd;
+
+    uring_source = io_uring_source_new(&config, &error);
+    if (!uring_source) {
+        g_printerr("[Error] %s\n", error->message);
+        g_error_free(error);
+        return;
+    }
+    g_source_attach((GSource *)uring_source, NULL);
+
+    in_fd = open(SRC_PATH, O_RDONLY);
+    out_fd = open(DST_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (in_fd < 0 || out_fd < 0) {
+        g_printerr("[Error] Failed to open files: %s\n", strerror(errno));
+    } else {
+        /* 8 x 128 KiB in flight each way: 2 MiB total, whatever the file size */
+        in = io_uring_input_stream_new(uring_source, in_fd, 128 * 1024, 8, TRUE);
+        out = io_uring_output_stream_new(uring_source, out_fd, 128 * 1024, 8, TRUE);
+        in_fd = out_fd = -1;
+
+        run_copy(in, out);
+
+        g_object_unref(in);
+        g_object_unref(out);
+    }
+
+    if (in_fd >= 0) {
+        close(in_fd);
+    }
+    if (out_fd >= 0) {
+        close(out_fd);
+    }
+
+    g_source_destroy((GSource *)uring_source);
+    g_source_unref((GSource *)uring_source);
+}
+
+/* ============================================================
+ * Driver
+ * ============================================================ */
+
+typedef void (*CopyFunc)(void);
+
+static void run_in_child(const gchar *name, CopyFunc func, guint64 size)
+{
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        g_printerr("[Error] fork failed: %s\n", strerror(errno));
+        return;
+    }
+
+    if (pid == 0) {
+        struct rusage usage;
+        struct stat st;
+
+        main_loop = g_main_loop_new(NULL, FALSE);
+        func();
+
+        getrusage(RUSAGE_SELF, &usage);
+        gboolean size_ok = (stat(DST_PATH, &st) == 0 && (guint64)st.st_size == size);
+
+        g_print("  %-26s peak RSS %7.1f MiB   %s\n",
+                name, usage.ru_maxrss / 1024.0, size_ok ? "ok" : "SIZE MISMATCH");
+
+        g_main_loop_unref(main_loop);
+        unlink(DST_PATH);
+        _exit(0);
+    }
+
+    waitpid(pid, NULL, 0);
+}
+
+static void copy_bench(guint64 iterations, gpointer user_data)
+{
+    CopyFunc func = (CopyFunc)user_data;
+
+    for (guint64 i = 0; i < iterations; i++) {
+        func();
+    }
+}
+
+/* Per MiB, which is also printed as a rate */
+static void run_timed(Bench *bench, const gchar *name, CopyFunc func, guint64 size_mb)
+{
+    const BenchResult *result = bench_run_ops(bench, name, size_mb, copy_bench, (gpointer)func);
+
+    g_print("  %-28s %12.1f MiB/s\n", "", 1e9 / result->median_ns);
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct {
+        const gchar *name;
+        CopyFunc func;
+    } paths[] = {
+        { "GIO load/replace contents", run_gio_contents },
+        { "GIO file streams", run_gio_streams },
+        { "io_uring streams", run_io_uring_streams },
+    };
+    Bench *bench = bench_new("io_uring_stream_bench", &argc, &argv);
+    guint64 size_mb = (argc > 1) ? g_ascii_strtoull(argv[1], NULL, 10) : 64;
+    guint64 size = size_mb * 1024 * 1024;
+
+    if (size == 0) {
+        g_printerr("Usage: %s [size-MiB]\n", argv[0]);
+        bench_free(bench);
+        return 1;
+    }
+
+    g_print("=== Streaming Copy Benchmark (%" G_GUINT64_FORMAT " MiB) ===\n\n", size_mb);
+
+    if (!create_source_file(size)) {
+        bench_free(bench);
+        return 1;
+    }
+
+    /* The first run warms the page cache for the others */
+    g_print("One copy each, in a child:\n");
+    for (guint i = 0; i < G_N_ELEMENTS(paths); i++) {
+        run_in_child(paths[i].name, paths[i].func, size);
+    }
+
+    /* Only now, so the children never inherit a used main context */
+    g_print("\nTime per MiB copied:\n");
+    main_loop = g_main_loop_new(NULL, FALSE);
+    for (guint i = 0; i < G_N_ELEMENTS(paths); i++) {
+        run_timed(bench, paths[i].name, paths[i].func, size_mb);
+    }
+    g_main_loop_unref(main_loop);
+
+    unlink(DST_PATH);
+    unlink(SRC_PATH);
+
+    g_print("\n=== Key Points ===\n");
+    g_print("- load/replace_contents holds the whole file: RSS grows with file size\n");
+    g_print("- GIO file streams are bounded but hop through the thread pool per op\n");
+    g_print("- io_uring streams keep a fixed window of reads/writes in flight\n");
+    g_print("- Peak RSS of the io_uring path is chunk_size * window per stream\n");
+
+    bench_free(bench);
+    return 0;
+}
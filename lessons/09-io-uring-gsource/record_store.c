@@ -0,0 +1,841 @@
+/*
+ * record_store.c - Append-only GVariant record file with mmap'd indexes
+ *
+ * See record_store.h for the API. The record file is:
+ *
+ *   "GVRECS1"  byte order ('l' or 'B')
+ *   record*    { guint32 value_size; guint32 key_len; }
+ *              key, NUL, padding to 8
+ *              serialised 'v' value (value_size bytes), padding to 8
+ *
+ * Every record starts 8-byte aligned, so a value can be used in place
+ * inside the mapping. The sidecar index is:
+ *
+ *   "GVRIDX1"  byte order
+ *   { guint64 data_size; guint64 n_records; guint64 n_buckets; }
+ *   guint64 offsets[n_records]
+ *   { guint32 hash; guint32 used; guint64 offset; } buckets[n_buckets]
+ *
+ * data_size is how much of the record file the index covers; records
+ * past it are scanned on open. The bucket table is open-addressed with
+ * linear probing and at most half full.
+ */
+
+#include "record_store.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#define DATA_MAGIC "GVRECS1"
+#define INDEX_MAGIC "GVRIDX1"
+#define MAGIC_SIZE 8
+#define INDEX_SUFFIX ".idx"
+#define MIN_BUCKETS 16
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define HOST_ORDER 'l'
+#else
+#define HOST_ORDER 'B'
+#endif
+
+#define ALIGN8(n) (((gsize)(n) + 7) & ~(gsize)7)
+
+typedef struct {
+    guint32 value_size;
+    guint32 key_len;
+} RecordHeader;
+
+typedef struct {
+    gchar magic[MAGIC_SIZE];
+    guint64 data_size;
+    guint64 n_records;
+    guint64 n_buckets;
+} IndexHeader;
+
+typedef struct {
+    guint32 hash;
+    guint32 used;
+    guint64 offset;
+} IndexBucket;
+
+G_STATIC_ASSERT(sizeof(RecordHeader) == 8);
+G_STATIC_ASSERT(sizeof(IndexHeader) == 32);
+G_STATIC_ASSERT(sizeof(IndexBucket) == 16);
+
+G_DEFINE_QUARK(record-store-error-quark, record_store_error)
+
+/* ============================================================
+ * Layout
+ * ============================================================ */
+
+/* FNV-1a: the index outlives the process, so the hash must not be
+ * seeded or change between GLib versions */
+static guint32 key_hash(const gchar *key, gsize len)
+{
+    guint32 hash = 2166136261u;
+
+    for (gsize i = 0; i < len; i++) {
+        hash = (hash ^ (guint8)key[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static gsize record_size(gsize key_len, gsize value_size)
+{
+    return sizeof(RecordHeader) + ALIGN8(key_len + 1) + ALIGN8(value_size);
+}
+
+/* The record at @offset if it lies wholly below @limit, else NULL.
+ * Offsets come from files, so everything is checked. */
+static const RecordHeader *record_at(const guint8 *base, gsize limit, guint64 offset)
+{
+    if (offset < MAGIC_SIZE || offset % 8 != 0 || offset > limit ||
+        limit - offset < sizeof(RecordHeader)) {
+        return NULL;
+    }
+
+    const RecordHeader *header = (const RecordHeader *)(base + offset);
+    gsize avail = limit - offset - sizeof(RecordHeader);
+
+    /* A serialised 'v' is never empty, so a zero-filled tail stops here */
+    if (header->value_size == 0 || header->key_len >= avail ||
+        ALIGN8(header->key_len + 1) > avail ||
+        ALIGN8(header->value_size) > avail - ALIGN8(header->key_len + 1)) {
+        return NULL;
+    }
+    if (((const gchar *)(header + 1))[header->key_len] != '\0') {
+        return NULL;
+    }
+    return header;
+}
+
+/* A 'v' ends with "\0<type string>". GVariant silently substitutes "()"
+ * for a bad type string, so check it to keep corrupt records out. */
+static gboolean has_valid_type(const gchar *data, gsize size)
+{
+    gsize nul = size;
+    const gchar *end;
+
+    while (nul > 0 && data[nul - 1] != '\0') {
+        nul--;
+    }
+    return nul > 0 && g_variant_type_string_scan(data + nul, data + size, &end) &&
+           end == data + size;
+}
+
+/* ============================================================
+ * Reader
+ * ============================================================ */
+
+struct _RecordStore {
+    GBytes *data;               /* The mapped record file */
+    const guint8 *base;
+    gsize size;                 /* End of the last complete record */
+    GBytes *index;              /* The mapped sidecar, or NULL */
+    const guint64 *offsets;     /* Indexed records' offsets */
+    guint64 n_indexed;
+    const IndexBucket *buckets;
+    guint64 n_buckets;
+    GArray *tail;               /* guint64 offsets of unindexed records */
+    GHashTable *tail_keys;      /* Key (in the mapping) -> tail index + 1 */
+};
+
+static GBytes *map_file(const gchar *path, GError **error)
+{
+    GMappedFile *file = g_mapped_file_new(path, FALSE, error);
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    /* The GBytes keeps the mapping alive after the file is unreffed */
+    GBytes *bytes = g_mapped_file_get_bytes(file);
+    g_mapped_file_unref(file);
+    return bytes;
+}
+
+/* Map PATH.idx if it is intact and describes a prefix of @mapped bytes
+ * of this record file; anything else is treated as no index */
+static void load_index(RecordStore *store, const gchar *path, gsize mapped)
+{
+    gchar *index_path = g_strconcat(path, INDEX_SUFFIX, NULL);
+    GBytes *bytes = map_file(index_path, NULL);
+    gsize size;
+
+    g_free(index_path);
+    if (bytes == NULL) {
+        return;
+    }
+
+    const guint8 *data = g_bytes_get_data(bytes, &size);
+    const IndexHeader *header = (const IndexHeader *)data;
+    gsize body = size - sizeof(IndexHeader);
+
+    if (size < sizeof(IndexHeader) ||
+        memcmp(header->magic, INDEX_MAGIC, MAGIC_SIZE - 1) != 0 ||
+        header->magic[MAGIC_SIZE - 1] != HOST_ORDER ||
+        header->data_size < MAGIC_SIZE || header->data_size > mapped ||
+        header->n_buckets == 0 || (header->n_buckets & (header->n_buckets - 1)) != 0 ||
+        header->n_records > body / sizeof(guint64) ||
+        header->n_buckets != (body - header->n_records * sizeof(guint64)) / sizeof(IndexBucket) ||
+        body != header->n_records * sizeof(guint64) + header->n_buckets * sizeof(IndexBucket)) {
+        g_bytes_unref(bytes);
+        return;
+    }
+
+    const guint64 *offsets = (const guint64 *)(header + 1);
+
+    /* O(1) staleness check: the last indexed record must end exactly
+     * where the index says its coverage ends */
+    if (header->n_records == 0) {
+        if (header->data_size != MAGIC_SIZE) {
+            g_bytes_unref(bytes);
+            return;
+        }
+    } else {
+        guint64 last = offsets[header->n_records - 1];
+        const RecordHeader *record = record_at(store->base, header->data_size, last);
+
+        if (record == NULL ||
+            last + record_size(record->key_len, record->value_size) != header->data_size) {
+            g_bytes_unref(bytes);
+            return;
+        }
+    }
+
+    store->index = bytes;
+    store->offsets = offsets;
+    store->n_indexed = header->n_records;
+    store->buckets = (const IndexBucket *)(offsets + header->n_records);
+    store->n_buckets = header->n_buckets;
+    store->size = header->data_size;
+}
+
+/* Walk the records from store->size to the first incomplete one */
+static void scan_tail(RecordStore *store, gsize mapped)
+{
+    guint64 offset = store->size;
+    const RecordHeader *header;
+
+    while ((header = record_at(store->base, mapped, offset)) != NULL) {
+        g_array_append_val(store->tail, offset);
+        g_hash_table_insert(store->tail_keys, (gpointer)(header + 1),
+                            GSIZE_TO_POINTER(store->tail->len));
+        offset += record_size(header->key_len, header->value_size);
+    }
+    store->size = offset;
+}
+
+RecordStore *record_store_open(const gchar *path, GError **error)
+{
+    GBytes *data = map_file(path, error);
+    gsize mapped;
+
+    if (data == NULL) {
+        return NULL;
+    }
+
+    RecordStore *store = g_new0(RecordStore, 1);
+
+    store->data = data;
+    store->base = g_bytes_get_data(data, &mapped);
+    store->tail = g_array_new(FALSE, FALSE, sizeof(guint64));
+    store->tail_keys = g_hash_table_new(g_str_hash, g_str_equal);
+
+    /* An empty file is a store whose first commit hasn't landed */
+    if (mapped == 0) {
+        return store;
+    }
+
+    if (mapped < MAGIC_SIZE || memcmp(store->base, DATA_MAGIC, MAGIC_SIZE - 1) != 0) {
+        g_set_error(error, RECORD_STORE_ERROR, RECORD_STORE_ERROR_INVALID,
+                    "%s is not a record store", path);
+        record_store_free(store);
+        return NULL;
+    }
+    if (store->base[MAGIC_SIZE - 1] != HOST_ORDER) {
+        g_set_error(error, RECORD_STORE_ERROR, RECORD_STORE_ERROR_INVALID,
+                    "%s was written with the other byte order", path);
+        record_store_free(store);
+        return NULL;
+    }
+
+    store->size = MAGIC_SIZE;
+    load_index(store, path, mapped);
+    scan_tail(store, mapped);
+    return store;
+}
+
+void record_store_free(RecordStore *store)
+{
+    if (store == NULL) {
+        return;
+    }
+
+    g_hash_table_unref(store->tail_keys);
+    g_array_unref(store->tail);
+    if (store->index) {
+        g_bytes_unref(store->index);
+    }
+    g_bytes_unref(store->data);
+    g_free(store);
+}
+
+guint64 record_store_get_n_records(RecordStore *store)
+{
+    return store->n_indexed + store->tail->len;
+}
+
+guint64 record_store_get_n_unindexed(RecordStore *store)
+{
+    return store->tail->len;
+}
+
+static guint64 record_offset(RecordStore *store, guint64 index)
+{
+    if (index < store->n_indexed) {
+        return store->offsets[index];
+    }
+    return g_array_index(store->tail, guint64, index - store->n_indexed);
+}
+
+static GVariant *record_value(RecordStore *store, guint64 offset)
+{
+    const RecordHeader *header = record_at(store->base, store->size, offset);
+
+    if (header == NULL) {
+        return NULL;
+    }
+
+    gsize start = offset + sizeof(RecordHeader) + ALIGN8(header->key_len + 1);
+
+    if (!has_valid_type((const gchar *)store->base + start, header->value_size)) {
+        return NULL;
+    }
+
+    /* Untrusted: GVariant checks each access, but still reads in place */
+    GBytes *slice = g_bytes_new_from_bytes(store->data, start, header->value_size);
+    GVariant *boxed = g_variant_ref_sink(g_variant_new_from_bytes(G_VARIANT_TYPE_VARIANT, slice, FALSE));
+    GVariant *value = g_variant_get_variant(boxed);
+
+    g_variant_unref(boxed);
+    g_bytes_unref(slice);
+    return value;
+}
+
+const gchar *record_store_get_key(RecordStore *store, guint64 index)
+{
+    g_return_val_if_fail(index < record_store_get_n_records(store), NULL);
+
+    const RecordHeader *header = record_at(store->base, store->size, record_offset(store, index));
+    return header ? (const gchar *)(header + 1) : NULL;
+}
+
+GVariant *record_store_get_value(RecordStore *store, guint64 index)
+{
+    g_return_val_if_fail(index < record_store_get_n_records(store), NULL);
+
+    return record_value(store, record_offset(store, index));
+}
+
+GVariant *record_store_lookup(RecordStore *store, const gchar *key)
+{
+    g_return_val_if_fail(key != NULL, NULL);
+
+    /* Unindexed records are newer, so they shadow the index */
+    gpointer found = g_hash_table_lookup(store->tail_keys, key);
+
+    if (found) {
+        return record_value(store, g_array_index(store->tail, guint64, GPOINTER_TO_SIZE(found) - 1));
+    }
+
+    gsize len = strlen(key);
+    guint32 hash = key_hash(key, len);
+    guint64 mask = store->n_buckets - 1;
+
+    for (guint64 probe = 0, i = hash & mask; probe < store->n_buckets; probe++, i = (i + 1) & mask) {
+        const IndexBucket *bucket = &store->buckets[i];
+
+        if (!bucket->used) {
+            break;
+        }
+        if (bucket->hash == hash) {
+            const RecordHeader *header = record_at(store->base, store->size, bucket->offset);
+
+            if (header && header->key_len == len && memcmp(header + 1, key, len) == 0) {
+                return record_value(store, bucket->offset);
+            }
+        }
+    }
+    return NULL;
+}
+
+/* ============================================================
+ * Writer
+ * ============================================================ */
+
+typedef struct {
+    gchar *key;
+    guint64 offset;
+} PendingRecord;
+
+typedef struct {
+    RecordStoreWriter *writer;
+    guint64 offset;             /* File offset of data->data[0] */
+    GByteArray *data;
+    gsize written;
+    GArray *records;            /* PendingRecord */
+    GPtrArray *tasks;           /* Commits waiting on this group */
+    guint pending;              /* CQEs still to come */
+    gint error;                 /* First negative errno */
+    gboolean synced;
+} CommitGroup;
+
+struct _RecordStoreWriter {
+    IoUringSource *source;
+    gchar *path;
+    gint fd;
+    CommitGroup *filling;       /* Records appended since the last commit */
+    CommitGroup *in_flight;     /* The group being written, or NULL */
+    gint error;                 /* Sticky: set by the first failed group */
+    guint64 n_records;          /* Including buffered records */
+    guint64 durable_size;
+    GArray *offsets;            /* guint64 per durable record */
+    GHashTable *keys;           /* Key -> durable record index + 1 */
+    RecordStoreWriterStats stats;
+};
+
+static void pending_record_clear(gpointer data)
+{
+    g_free(((PendingRecord *)data)->key);
+}
+
+static CommitGroup *group_new(RecordStoreWriter *writer, guint64 offset)
+{
+    CommitGroup *group = g_new0(CommitGroup, 1);
+
+    group->writer = writer;
+    group->offset = offset;
+    group->data = g_byte_array_new();
+    group->records = g_array_new(FALSE, FALSE, sizeof(PendingRecord));
+    g_array_set_clear_func(group->records, pending_record_clear);
+    group->tasks = g_ptr_array_new();
+    return group;
+}
+
+static void group_free(CommitGroup *group)
+{
+    g_ptr_array_unref(group->tasks);
+    g_array_unref(group->records);
+    g_byte_array_unref(group->data);
+    g_free(group);
+}
+
+static void group_return(CommitGroup *group, gint error)
+{
+    for (guint i = 0; i < group->tasks->len; i++) {
+        GTask *task = group->tasks->pdata[i];
+
+        if (error) {
+            g_task_return_new_error(task, RECORD_STORE_ERROR, RECORD_STORE_ERROR_IO,
+                                    "Failed to commit records: %s", g_strerror(-error));
+        } else {
+            g_task_return_boolean(task, TRUE);
+        }
+        g_object_unref(task);
+    }
+    group->writer->stats.commits += group->tasks->len;
+    g_ptr_array_set_size(group->tasks, 0);
+}
+
+static void group_io(CommitGroup *group);
+static void submit_filling(RecordStoreWriter *writer);
+
+/* Every CQE for the group's current attempt has arrived */
+static void group_done(CommitGroup *group)
+{
+    RecordStoreWriter *writer = group->writer;
+
+    if (group->error == 0 && (group->written < group->data->len || !group->synced)) {
+        /* Short write (the linked fsync was cancelled) or the fsync
+         * couldn't be linked: carry on from where it stopped */
+        group_io(group);
+        return;
+    }
+
+    writer->in_flight = NULL;
+    if (group->error) {
+        writer->error = group->error;
+    } else {
+        writer->durable_size = group->offset + group->data->len;
+        for (guint i = 0; i < group->records->len; i++) {
+            PendingRecord *record = &g_array_index(group->records, PendingRecord, i);
+
+            g_array_append_val(writer->offsets, record->offset);
+            g_hash_table_insert(writer->keys, g_steal_pointer(&record->key),
+                                GSIZE_TO_POINTER(writer->offsets->len));
+        }
+        writer->stats.records += group->records->len;
+    }
+    group_return(group, group->error);
+    group_free(group);
+
+    /* Commits that arrived meanwhile form the next group */
+    submit_filling(writer);
+}
+
+static void on_write(IoUringSource *source, gint res, guint32 flags, gpointer user_data)
+{
+    CommitGroup *group = user_data;
+
+    group->pending--;
+    if (res <= 0) {
+        if (group->error == 0) {
+            group->error = (res == 0) ? -EIO : res;
+        }
+    } else {
+        group->written += res;
+        group->writer->stats.bytes += res;
+    }
+
+    if (group->pending == 0) {
+        group_done(group);
+    }
+}
+
+static void on_fsync(IoUringSource *source, gint res, guint32 flags, gpointer user_data)
+{
+    CommitGroup *group = user_data;
+
+    group->pending--;
+    if (res == 0) {
+        group->synced = TRUE;
+    } else if (res != -ECANCELED && group->error == 0) {
+        /* -ECANCELED means the linked write came up short */
+        group->error = res;
+    }
+
+    if (group->pending == 0) {
+        group_done(group);
+    }
+}
+
+static gboolean group_io_retry(gpointer user_data)
+{
+    group_io(user_data);
+    return G_SOURCE_REMOVE;
+}
+
+/* Write what's left of the group, linked to an fdatasync */
+static void group_io(CommitGroup *group)
+{
+    RecordStoreWriter *writer = group->writer;
+    struct io_uring *ring = io_uring_source_get_ring(writer->source);
+    struct io_uring_sqe *sqe;
+
+    /* A linked pair must reach the kernel in one submit, or the fsync
+     * could run before the write. Without room for both, the fsync
+     * follows once the write completes. */
+    if (io_uring_sq_space_left(ring) < 2) {
+        io_uring_source_flush(writer->source);
+    }
+    gboolean link = io_uring_sq_space_left(ring) >= 2;
+
+    if (group->written < group->data->len) {
+        sqe = io_uring_source_get_sqe(writer->source);
+        if (sqe == NULL) {
+            link = FALSE;
+        } else {
+            io_uring_prep_write(sqe, writer->fd,
+                                group->data->data + group->written,
+                                group->data->len - group->written,
+                                group->offset + group->written);
+            if (link) {
+                sqe->flags |= IOSQE_IO_LINK;
+            }
+            io_uring_source_sqe_set_callback(writer->source, sqe, on_write, group);
+            group->pending++;
+        }
+    } else {
+        link = TRUE;
+    }
+
+    if (link && (sqe = io_uring_source_get_sqe(writer->source)) != NULL) {
+        io_uring_prep_fsync(sqe, writer->fd, IORING_FSYNC_DATASYNC);
+        io_uring_source_sqe_set_callback(writer->source, sqe, on_fsync, group);
+        group->pending++;
+    }
+
+    if (group->pending == 0) {
+        /* SQ still full after a flush: the ring drains as the kernel
+         * consumes SQEs, so try again on the next iteration */
+        GSource *retry = g_idle_source_new();
+
+        g_source_set_priority(retry, g_source_get_priority((GSource *)writer->source));
+        g_source_set_callback(retry, group_io_retry, group, NULL);
+        g_source_attach(retry, g_source_get_context((GSource *)writer->source));
+        g_source_unref(retry);
+    }
+}
+
+/* Start a group with everything appended so far, if anyone is waiting */
+static void submit_filling(RecordStoreWriter *writer)
+{
+    CommitGroup *group = writer->filling;
+
+    if (group->tasks->len == 0) {
+        return;
+    }
+    if (writer->error) {
+        group_return(group, writer->error);
+        return;
+    }
+
+    writer->filling = group_new(writer, group->offset + group->data->len);
+
+    /* Nothing new: everything appended earlier is already durable */
+    if (group->data->len == 0) {
+        group_return(group, 0);
+        group_free(group);
+        return;
+    }
+
+    writer->in_flight = group;
+    writer->stats.groups++;
+    group_io(group);
+}
+
+RecordStoreWriter *record_store_writer_new(IoUringSource *source,
+                                           const gchar *path,
+                                           GError **error)
+{
+    g_return_val_if_fail(source != NULL, NULL);
+    g_return_val_if_fail(path != NULL, NULL);
+
+    /* Readable too, to check a torn header before truncating it */
+    gint fd = g_open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+    if (fd < 0) {
+        gint saved_errno = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                    "Failed to open %s: %s", path, g_strerror(saved_errno));
+        return NULL;
+    }
+
+    RecordStoreWriter *writer = g_new0(RecordStoreWriter, 1);
+    off_t size = lseek(fd, 0, SEEK_END);
+    guint8 header[MAGIC_SIZE];
+    gboolean torn_header = FALSE;
+
+    memcpy(header, DATA_MAGIC, MAGIC_SIZE - 1);
+    header[MAGIC_SIZE - 1] = HOST_ORDER;
+
+    /* A crash during the first commit can leave part of the header:
+     * like a torn record, it is truncated away and written again */
+    if (size > 0 && size < MAGIC_SIZE) {
+        guint8 head[MAGIC_SIZE];
+
+        torn_header = pread(fd, head, size, 0) == size && memcmp(head, header, size) == 0;
+    }
+
+    writer->source = source;
+    writer->path = g_strdup(path);
+    writer->fd = fd;
+    writer->offsets = g_array_new(FALSE, FALSE, sizeof(guint64));
+    writer->keys = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    if (size > 0 && !torn_header) {
+        RecordStore *store = record_store_open(path, error);
+
+        if (store == NULL) {
+            record_store_writer_free(writer);
+            return NULL;
+        }
+
+        guint64 n = record_store_get_n_records(store);
+
+        for (guint64 i = 0; i < n; i++) {
+            guint64 offset = record_offset(store, i);
+
+            g_array_append_val(writer->offsets, offset);
+            g_hash_table_insert(writer->keys, g_strdup(record_store_get_key(store, i)),
+                                GSIZE_TO_POINTER(writer->offsets->len));
+        }
+        writer->durable_size = store->size;
+        record_store_free(store);
+    }
+
+    /* Drop a record, or a header, a crash left half written */
+    if (size > 0 && (guint64)size > writer->durable_size && ftruncate(fd, writer->durable_size) != 0) {
+        gint saved_errno = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                    "Failed to truncate %s: %s", path, g_strerror(saved_errno));
+        record_store_writer_free(writer);
+        return NULL;
+    }
+
+    writer->n_records = writer->offsets->len;
+    writer->filling = group_new(writer, writer->durable_size);
+
+    /* A new file gets its header with the first commit */
+    if (writer->durable_size == 0) {
+        g_byte_array_append(writer->filling->data, header, MAGIC_SIZE);
+    }
+    return writer;
+}
+
+void record_store_writer_free(RecordStoreWriter *writer)
+{
+    if (writer == NULL) {
+        return;
+    }
+
+    /* The kernel still owns the in-flight group's buffer */
+    g_return_if_fail(writer->in_flight == NULL);
+
+    if (writer->filling) {
+        group_free(writer->filling);
+    }
+    g_hash_table_unref(writer->keys);
+    g_array_unref(writer->offsets);
+    g_close(writer->fd, NULL);
+    g_free(writer->path);
+    g_free(writer);
+}
+
+guint64 record_store_writer_append(RecordStoreWriter *writer,
+                                   const gchar *key,
+                                   GVariant *value)
+{
+    g_return_val_if_fail(writer != NULL, G_MAXUINT64);
+    g_return_val_if_fail(key != NULL, G_MAXUINT64);
+    g_return_val_if_fail(value != NULL, G_MAXUINT64);
+
+    GVariant *boxed = g_variant_ref_sink(g_variant_new_variant(value));
+    gsize key_len = strlen(key);
+    gsize value_size = g_variant_get_size(boxed);
+
+    if (key_len > G_MAXUINT32 - 8 || value_size > G_MAXUINT32 - 8) {
+        g_variant_unref(boxed);
+        g_return_val_if_reached(G_MAXUINT64);
+    }
+
+    CommitGroup *group = writer->filling;
+    gsize start = group->data->len;
+    gsize size = record_size(key_len, value_size);
+    RecordHeader header = { value_size, key_len };
+
+    g_byte_array_set_size(group->data, start + size);
+
+    guint8 *record = group->data->data + start;
+
+    memset(record, 0, size);
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), key, key_len);
+    g_variant_store(boxed, record + sizeof(header) + ALIGN8(key_len + 1));
+    g_variant_unref(boxed);
+
+    PendingRecord pending = { g_strdup(key), group->offset + start };
+    g_array_append_val(group->records, pending);
+
+    return writer->n_records++;
+}
+
+void record_store_writer_commit_async(RecordStoreWriter *writer,
+                                      GCancellable *cancellable,
+                                      GAsyncReadyCallback callback,
+                                      gpointer user_data)
+{
+    g_return_if_fail(writer != NULL);
+
+    GTask *task = g_task_new(NULL, cancellable, callback, user_data);
+
+    g_task_set_source_tag(task, record_store_writer_commit_async);
+
+    /* Cancelling later still fails the task (GTask checks the
+     * cancellable when it returns), but the group is written anyway */
+    if (g_task_return_error_if_cancelled(task)) {
+        g_object_unref(task);
+        return;
+    }
+    if (writer->error) {
+        g_task_return_new_error(task, RECORD_STORE_ERROR, RECORD_STORE_ERROR_IO,
+                                "An earlier commit failed: %s", g_strerror(-writer->error));
+        g_object_unref(task);
+        return;
+    }
+
+    /* Joins the group being filled; it goes out as soon as the
+     * in-flight group (if any) is durable */
+    g_ptr_array_add(writer->filling->tasks, task);
+    if (writer->in_flight == NULL) {
+        submit_filling(writer);
+    }
+}
+
+gboolean record_store_writer_commit_finish(RecordStoreWriter *writer,
+                                           GAsyncResult *result,
+                                           GError **error)
+{
+    g_return_val_if_fail(g_task_is_valid(result, NULL), FALSE);
+
+    return g_task_propagate_boolean(G_TASK(result), error);
+}
+
+gboolean record_store_writer_write_index(RecordStoreWriter *writer, GError **error)
+{
+    guint64 n_records = writer->offsets->len;
+    guint64 n_buckets = MIN_BUCKETS;
+
+    while (n_buckets < 2 * (guint64)g_hash_table_size(writer->keys)) {
+        n_buckets *= 2;
+    }
+
+    gsize size = sizeof(IndexHeader) + n_records * sizeof(guint64) + n_buckets * sizeof(IndexBucket);
+    guint8 *blob = g_malloc0(size);
+    IndexHeader *header = (IndexHeader *)blob;
+    guint64 *offsets = (guint64 *)(header + 1);
+    IndexBucket *buckets = (IndexBucket *)(offsets + n_records);
+    GHashTableIter iter;
+    gpointer key, value;
+
+    memcpy(header->magic, INDEX_MAGIC, MAGIC_SIZE - 1);
+    header->magic[MAGIC_SIZE - 1] = HOST_ORDER;
+    header->data_size = writer->durable_size;
+    header->n_records = n_records;
+    header->n_buckets = n_buckets;
+    if (n_records > 0) {
+        memcpy(offsets, writer->offsets->data, n_records * sizeof(guint64));
+    }
+
+    g_hash_table_iter_init(&iter, writer->keys);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        guint32 hash = key_hash(key, strlen(key));
+        guint64 i = hash & (n_buckets - 1);
+
+        while (buckets[i].used) {
+            i = (i + 1) & (n_buckets - 1);
+        }
+        buckets[i].hash = hash;
+        buckets[i].used = 1;
+        buckets[i].offset = offsets[GPOINTER_TO_SIZE(value) - 1];
+    }
+
+    /* g_file_set_contents() writes a temporary file and renames it, so
+     * readers see the old index or the new one, never half of each */
+    gchar *index_path = g_strconcat(writer->path, INDEX_SUFFIX, NULL);
+    gboolean ok = g_file_set_contents(index_path, (const gchar *)blob, size, error);
+
+    g_free(index_path);
+    g_free(blob);
+    return ok;
+}
+
+void record_store_writer_get_stats(RecordStoreWriter *writer,
+                                   RecordStoreWriterStats *stats)
+{
+    *stats = writer->stats;
+}
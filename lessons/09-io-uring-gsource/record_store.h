@@ -0,0 +1,131 @@
+/*
+ * record_store.h - Append-only GVariant record file with mmap'd indexes
+ *
+ * A store is two files:
+ *
+ *   PATH      the records: key + serialised GVariant, length-prefixed
+ *             and 8-byte aligned, appended and never rewritten
+ *   PATH.idx  a sidecar index: every record's offset, plus an
+ *             open-addressed key -> offset hash table
+ *
+ * Readers map both files. Opening a store validates two headers and
+ * builds nothing; record_store_lookup() hashes the key, probes the
+ * mapped table and returns a GVariant that points straight into the
+ * mapped record file via g_variant_new_from_bytes(), so startup and a
+ * random lookup are O(1) no matter how many records there are. Records
+ * appended after the index was written are found by scanning the tail
+ * of the record file, so a stale or missing index costs time, never
+ * correctness. When the same key is appended twice the later record
+ * wins.
+ *
+ * The writer appends through an IoUringSource. Records are buffered
+ * until a commit; each commit group is one write SQE linked to an
+ * fdatasync SQE, and commits requested while a group is in flight all
+ * ride on the next group's fsync (group commit), so N concurrent
+ * committers cost about one fsync per round trip instead of N.
+ *
+ * Both files are in host byte order; a store written on a machine of
+ * the other endianness is rejected.
+ */
+
+#ifndef RECORD_STORE_H
+#define RECORD_STORE_H
+
+#include <gio/gio.h>
+#include "io_uring_source.h"
+
+G_BEGIN_DECLS
+
+#define RECORD_STORE_ERROR (record_store_error_quark())
+
+typedef enum {
+    RECORD_STORE_ERROR_INVALID,          /* Not a record store, or corrupt */
+    RECORD_STORE_ERROR_IO                /* A write or fsync failed */
+} RecordStoreError;
+
+GQuark record_store_error_quark(void);
+
+/* ============================================================
+ * Reader
+ * ============================================================ */
+
+typedef struct _RecordStore RecordStore;
+
+/* Map @path and, if it matches, @path.idx. A missing or stale index is
+ * not an error; the records it doesn't cover are scanned instead. */
+RecordStore *record_store_open(const gchar *path, GError **error);
+void record_store_free(RecordStore *store);
+
+guint64 record_store_get_n_records(RecordStore *store);
+
+/* Records the index did not cover and open had to scan */
+guint64 record_store_get_n_unindexed(RecordStore *store);
+
+/* The key of record @index; points into the mapping, so it is valid
+ * until the store is freed */
+const gchar *record_store_get_key(RecordStore *store, guint64 index);
+
+/* The value of record @index, or NULL if it is corrupt. Returns a full
+ * reference that keeps the mapping alive, even after the store is
+ * freed. */
+GVariant *record_store_get_value(RecordStore *store, guint64 index);
+
+/* The value last appended under @key, or NULL */
+GVariant *record_store_lookup(RecordStore *store, const gchar *key);
+
+/* ============================================================
+ * Writer
+ * ============================================================ */
+
+typedef struct _RecordStoreWriter RecordStoreWriter;
+
+typedef struct {
+    guint64 records;           /* Records made durable */
+    guint64 commits;           /* commit_async() calls completed */
+    guint64 groups;            /* Write + fsync groups submitted */
+    guint64 bytes;             /* Bytes written */
+} RecordStoreWriterStats;
+
+/* Open @path for appending, creating it if needed. An existing store is
+ * scanned once to rebuild the in-memory index that
+ * record_store_writer_write_index() saves, and a torn final record or
+ * header left by a crash is truncated away. @source must be attached to
+ * a context; commits complete on the thread that runs it. */
+RecordStoreWriter *record_store_writer_new(IoUringSource *source,
+                                           const gchar *path,
+                                           GError **error);
+
+/* Must not be called while a commit is in flight. Records appended
+ * since the last commit are dropped. */
+void record_store_writer_free(RecordStoreWriter *writer);
+
+/* Buffer a record and return its index. Nothing reaches the file until
+ * the next commit. Consumes a floating @value. */
+guint64 record_store_writer_append(RecordStoreWriter *writer,
+                                   const gchar *key,
+                                   GVariant *value);
+
+/* Complete once every record appended before this call is written and
+ * fdatasync()ed. After a failed write every later commit fails too.
+ * Cancelling @cancellable fails the commit with G_IO_ERROR_CANCELLED,
+ * but records already handed to the kernel may still become durable. */
+void record_store_writer_commit_async(RecordStoreWriter *writer,
+                                      GCancellable *cancellable,
+                                      GAsyncReadyCallback callback,
+                                      gpointer user_data);
+gboolean record_store_writer_commit_finish(RecordStoreWriter *writer,
+                                           GAsyncResult *result,
+                                           GError **error);
+
+/* Atomically replace @path.idx with an index of every durable record.
+ * Synchronous; call it after a batch of commits or before exit, not
+ * per commit. */
+gboolean record_store_writer_write_index(RecordStoreWriter *writer,
+                                         GError **error);
+
+void record_store_writer_get_stats(RecordStoreWriter *writer,
+                                   RecordStoreWriterStats *stats);
+
+G_END_DECLS
+
+#endif /* RECORD_STORE_H */
@@ -0,0 +1,447 @@
+/*
+ * bench.c - Shared micro-benchmark harness for the lesson benchmarks
+ *
+ * See bench.h for the API and options.
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define DEFAULT_MIN_TIME_MS 200
+#define DEFAULT_REPETITIONS 15
+#define MAX_CALIBRATION_ITERATIONS (G_GUINT64_CONSTANT(1) << 40)
+
+typedef enum {
+    FORMAT_TEXT,
+    FORMAT_JSON,
+    FORMAT_CSV
+} BenchFormat;
+
+enum {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_CACHE_MISSES,
+    N_COUNTERS
+};
+
+struct _Bench {
+    gchar *suite;
+    BenchFormat format;
+    gchar *output;
+    gchar *output_dir;
+    gdouble min_time_ns;
+    guint repetitions;
+    GPtrArray *results;              /* BenchResult * */
+    gint counter_fds[N_COUNTERS];    /* -1 if unavailable */
+};
+
+static gint64 now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (gint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* ============================================================
+ * Hardware counters
+ * ============================================================ */
+
+#ifdef __linux__
+static gint open_counter(guint64 config, gint group_fd)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = (group_fd == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    return (gint)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+static void counters_open(Bench *bench)
+{
+    for (gint i = 0; i < N_COUNTERS; i++) {
+        bench->counter_fds[i] = -1;
+    }
+
+#ifdef __linux__
+    static const guint64 configs[N_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES
+    };
+
+    /* Counted as one group so the values cover exactly the same span */
+    bench->counter_fds[0] = open_counter(configs[0], -1);
+    if (bench->counter_fds[0] < 0) {
+        return;   /* No PMU, or perf_event_paranoid forbids it */
+    }
+    for (gint i = 1; i < N_COUNTERS; i++) {
+        bench->counter_fds[i] = open_counter(configs[i], bench->counter_fds[0]);
+        if (bench->counter_fds[i] < 0) {
+            for (gint j = 0; j < i; j++) {
+                close(bench->counter_fds[j]);
+                bench->counter_fds[j] = -1;
+            }
+            return;
+        }
+    }
+#endif
+}
+
+static void counters_close(Bench *bench)
+{
+#ifdef __linux__
+    for (gint i = 0; i < N_COUNTERS; i++) {
+        if (bench->counter_fds[i] >= 0) {
+            close(bench->counter_fds[i]);
+        }
+    }
+#endif
+}
+
+static void counters_start(Bench *bench)
+{
+#ifdef __linux__
+    if (bench->counter_fds[0] >= 0) {
+        ioctl(bench->counter_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(bench->counter_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+static gboolean counters_stop(Bench *bench, guint64 values[N_COUNTERS])
+{
+#ifdef __linux__
+    struct {
+        guint64 nr;
+        guint64 values[N_COUNTERS];
+    } data;
+
+    if (bench->counter_fds[0] < 0) {
+        return FALSE;
+    }
+
+    ioctl(bench->counter_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    if (read(bench->counter_fds[0], &data, sizeof(data)) != sizeof(data) ||
+        data.nr != N_COUNTERS) {
+        return FALSE;
+    }
+    memcpy(values, data.values, sizeof(data.values));
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+/* ============================================================
+ * Statistics
+ * ============================================================ */
+
+static gint compare_double(gconstpointer a, gconstpointer b)
+{
+    gdouble x = *(const gdouble *)a;
+    gdouble y = *(const gdouble *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of a sorted array */
+static gdouble percentile(const gdouble *sorted, guint n, gdouble p)
+{
+    guint rank = (guint)(p / 100.0 * n + 0.5);
+    return sorted[CLAMP(rank, 1, n) - 1];
+}
+
+static gdouble median(gdouble *values, guint n)
+{
+    qsort(values, n, sizeof(gdouble), compare_double);
+    return (n % 2) ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+/* ============================================================
+ * Options
+ * ============================================================ */
+
+static void apply_option(Bench *bench, const gchar *key, const gchar *value)
+{
+    if (value == NULL || *value == '\0') {
+        return;
+    }
+
+    if (g_str_equal(key, "format")) {
+        if (g_str_equal(value, "json")) {
+            bench->format = FORMAT_JSON;
+        } else if (g_str_equal(value, "csv")) {
+            bench->format = FORMAT_CSV;
+        } else {
+            bench->format = FORMAT_TEXT;
+        }
+    } else if (g_str_equal(key, "output")) {
+        g_free(bench->output);
+        bench->output = g_strdup(value);
+    } else if (g_str_equal(key, "output-dir")) {
+        g_free(bench->output_dir);
+        bench->output_dir = g_strdup(value);
+    } else if (g_str_equal(key, "min-time")) {
+        bench->min_time_ns = g_ascii_strtod(value, NULL) * 1e6;
+    } else if (g_str_equal(key, "repetitions")) {
+        bench->repetitions = (guint)g_ascii_strtoull(value, NULL, 10);
+    }
+}
+
+static void parse_args(Bench *bench, gint *argc, gchar ***argv)
+{
+    gint kept = 1;
+
+    if (argc == NULL || argv == NULL) {
+        return;
+    }
+
+    for (gint i = 1; i < *argc; i++) {
+        gchar *arg = (*argv)[i];
+
+        if (g_str_has_prefix(arg, "--bench-")) {
+            gchar **kv = g_strsplit(arg + strlen("--bench-"), "=", 2);
+            apply_option(bench, kv[0], kv[1]);
+            g_strfreev(kv);
+        } else {
+            (*argv)[kept++] = arg;
+        }
+    }
+
+    (*argv)[kept] = NULL;
+    *argc = kept;
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+Bench *bench_new(const gchar *suite, gint *argc, gchar ***argv)
+{
+    Bench *bench = g_new0(Bench, 1);
+
+    bench->suite = g_strdup(suite);
+    bench->min_time_ns = DEFAULT_MIN_TIME_MS * 1e6;
+    bench->repetitions = DEFAULT_REPETITIONS;
+    bench->results = g_ptr_array_new_with_free_func(g_free);
+
+    /* Flags are applied after the environment so they win */
+    apply_option(bench, "format", g_getenv("BENCH_FORMAT"));
+    apply_option(bench, "output", g_getenv("BENCH_OUTPUT"));
+    apply_option(bench, "output-dir", g_getenv("BENCH_OUTPUT_DIR"));
+    apply_option(bench, "min-time", g_getenv("BENCH_MIN_TIME"));
+    apply_option(bench, "repetitions", g_getenv("BENCH_REPETITIONS"));
+    parse_args(bench, argc, argv);
+
+    bench->repetitions = MAX(bench->repetitions, 1);
+    if (bench->min_time_ns <= 0) {
+        bench->min_time_ns = DEFAULT_MIN_TIME_MS * 1e6;
+    }
+
+    /* A report directory implies a report: JSON unless CSV was asked for */
+    if (bench->output == NULL && bench->output_dir != NULL) {
+        gchar *file;
+
+        if (bench->format == FORMAT_TEXT) {
+            bench->format = FORMAT_JSON;
+        }
+        file = g_strdup_printf("%s.%s", suite, bench->format == FORMAT_CSV ? "csv" : "json");
+        bench->output = g_build_filename(bench->output_dir, file, NULL);
+        g_free(file);
+    }
+
+    counters_open(bench);
+    return bench;
+}
+
+const BenchResult *bench_run(Bench *bench, const gchar *name, BenchFunc func, gpointer user_data)
+{
+    return bench_run_ops(bench, name, 1, func, user_data);
+}
+
+const BenchResult *bench_run_ops(Bench *bench, const gchar *name, guint64 ops_per_iteration,
+                                 BenchFunc func, gpointer user_data)
+{
+    BenchResult *result = g_new0(BenchResult, 1);
+    gdouble target_ns = bench->min_time_ns / bench->repetitions;
+    guint n = bench->repetitions;
+    gdouble *times = g_new(gdouble, n);
+    gdouble *deviations = g_new(gdouble, n);
+    gdouble *counts[N_COUNTERS];
+    guint64 iterations = 1;
+
+    ops_per_iteration = MAX(ops_per_iteration, 1);
+    guint n_counted = 0;
+
+    for (gint c = 0; c < N_COUNTERS; c++) {
+        counts[c] = g_new(gdouble, n);
+    }
+
+    /* Calibrate (and warm caches, branch predictors and the allocator) */
+    for (;;) {
+        gint64 start = now_ns();
+        func(iterations, user_data);
+        gdouble elapsed = now_ns() - start;
+
+        if (elapsed >= target_ns || iterations >= MAX_CALIBRATION_ITERATIONS) {
+            break;
+        }
+        /* Jump close to the target, but at most 10x per step */
+        gdouble factor = (elapsed > 0) ? target_ns * 1.2 / elapsed : 10.0;
+        iterations = (guint64)(iterations * CLAMP(factor, 2.0, 10.0));
+    }
+
+    for (guint r = 0; r < n; r++) {
+        guint64 values[N_COUNTERS];
+
+        counters_start(bench);
+        gint64 start = now_ns();
+        func(iterations, user_data);
+        gint64 elapsed = now_ns() - start;
+
+        if (counters_stop(bench, values)) {
+            for (gint c = 0; c < N_COUNTERS; c++) {
+                counts[c][n_counted] = (gdouble)values[c] / (iterations * ops_per_iteration);
+            }
+            n_counted++;
+        }
+        times[r] = (gdouble)elapsed / (iterations * ops_per_iteration);
+    }
+
+    result->name = g_intern_string(name);
+    result->iterations = iterations;
+    result->repetitions = n;
+    result->median_ns = median(times, n);   /* Sorts times */
+    result->min_ns = times[0];
+    result->p90_ns = percentile(times, n, 90);
+    result->p99_ns = percentile(times, n, 99);
+    for (guint r = 0; r < n; r++) {
+        deviations[r] = ABS(times[r] - result->median_ns);
+    }
+    result->mad_ns = median(deviations, n);
+
+    if (n_counted == n) {
+        result->have_counters = TRUE;
+        result->cycles = median(counts[COUNTER_CYCLES], n);
+        result->instructions = median(counts[COUNTER_INSTRUCTIONS], n);
+        result->cache_misses = median(counts[COUNTER_CACHE_MISSES], n);
+    }
+
+    g_print("  %-28s %12.1f ns/op  +/- %5.1f%%  p99 %10.1f", name,
+            result->median_ns,
+            result->median_ns > 0 ? 100.0 * result->mad_ns / result->median_ns : 0.0,
+            result->p99_ns);
+    if (result->have_counters) {
+        g_print("  %8.1f cyc  IPC %.2f  %6.2f miss",
+                result->cycles,
+                result->cycles > 0 ? result->instructions / result->cycles : 0.0,
+                result->cache_misses);
+    }
+    g_print("\n");
+
+    for (gint c = 0; c < N_COUNTERS; c++) {
+        g_free(counts[c]);
+    }
+    g_free(deviations);
+    g_free(times);
+
+    g_ptr_array_add(bench->results, result);
+    return result;
+}
+
+static void write_json(Bench *bench, GString *out)
+{
+    g_string_append_printf(out, "{\n  \"suite\": \"%s\",\n  \"host\": \"%s\",\n"
+                           "  \"processors\": %u,\n  \"benchmarks\": [\n",
+                           bench->suite, g_get_host_name(), g_get_num_processors());
+
+    for (guint i = 0; i < bench->results->len; i++) {
+        BenchResult *result = g_ptr_array_index(bench->results, i);
+        gchar *name = g_strescape(result->name, NULL);
+
+        g_string_append_printf(out,
+            "    {\"name\": \"%s\", \"iterations\": %" G_GUINT64_FORMAT
+            ", \"repetitions\": %u, \"median_ns\": %.3f, \"mad_ns\": %.3f"
+            ", \"min_ns\": %.3f, \"p90_ns\": %.3f, \"p99_ns\": %.3f",
+            name, result->iterations, result->repetitions, result->median_ns,
+            result->mad_ns, result->min_ns, result->p90_ns, result->p99_ns);
+        if (result->have_counters) {
+            g_string_append_printf(out,
+                ", \"cycles\": %.3f, \"instructions\": %.3f, \"cache_misses\": %.3f",
+                result->cycles, result->instructions, result->cache_misses);
+        }
+        g_string_append_printf(out, "}%s\n", (i + 1 < bench->results->len) ? "," : "");
+        g_free(name);
+    }
+
+    g_string_append(out, "  ]\n}\n");
+}
+
+static void write_csv(Bench *bench, GString *out)
+{
+    g_string_append(out, "suite,name,iterations,repetitions,median_ns,mad_ns,min_ns,"
+                         "p90_ns,p99_ns,cycles,instructions,cache_misses\n");
+
+    for (guint i = 0; i < bench->results->len; i++) {
+        BenchResult *result = g_ptr_array_index(bench->results, i);
+
+        g_string_append_printf(out, "%s,\"%s\",%" G_GUINT64_FORMAT ",%u,%.3f,%.3f,%.3f,%.3f,%.3f",
+                               bench->suite, result->name, result->iterations,
+                               result->repetitions, result->median_ns, result->mad_ns,
+                               result->min_ns, result->p90_ns, result->p99_ns);
+        if (result->have_counters) {
+            g_string_append_printf(out, ",%.3f,%.3f,%.3f\n", result->cycles,
+                                   result->instructions, result->cache_misses);
+        } else {
+            g_string_append(out, ",,,\n");
+        }
+    }
+}
+
+void bench_free(Bench *bench)
+{
+    if (bench->format != FORMAT_TEXT) {
+        GString *out = g_string_new(NULL);
+        GError *error = NULL;
+
+        if (bench->format == FORMAT_JSON) {
+            write_json(bench, out);
+        } else {
+            write_csv(bench, out);
+        }
+
+        if (bench->output == NULL) {
+            g_print("\n%s", out->str);
+        } else if (!g_file_set_contents(bench->output, out->str, out->len, &error)) {
+            g_printerr("[Error] Writing %s: %s\n", bench->output, error->message);
+            g_error_free(error);
+        }
+        g_string_free(out, TRUE);
+    }
+
+    counters_close(bench);
+    g_ptr_array_free(bench->results, TRUE);
+    g_free(bench->output_dir);
+    g_free(bench->output);
+    g_free(bench->suite);
+    g_free(bench);
+}
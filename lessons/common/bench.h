@@ -0,0 +1,75 @@
+/*
+ * bench.h - Shared micro-benchmark harness for the lesson benchmarks
+ *
+ * bench_run() times a function the way a careful person would by hand:
+ *   - calibrates the iteration count until one repetition takes at
+ *     least min_time / repetitions, which doubles as warmup
+ *   - runs a fixed number of timed repetitions
+ *   - reports the median time per operation with the median absolute
+ *     deviation (MAD) and the 90th/99th percentiles
+ *   - on Linux, reads cycles, instructions and cache misses for the
+ *     calling thread with perf_event_open() when the kernel allows it
+ *
+ * Results can also be written as JSON or CSV, to compare runs or
+ * machines. Settings come from the command line or the environment
+ * (the flag wins):
+ *
+ *   --bench-format=text|json|csv      BENCH_FORMAT
+ *   --bench-output=FILE               BENCH_OUTPUT
+ *                                     BENCH_OUTPUT_DIR (writes DIR/<suite>.<fmt>)
+ *   --bench-min-time=MS               BENCH_MIN_TIME   (default 200 ms)
+ *   --bench-repetitions=N             BENCH_REPETITIONS (default 15)
+ *
+ * Human-readable lines always go to stdout; JSON/CSV go to the output
+ * file, or to stdout after the text when no file is given.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _Bench Bench;
+
+/* Run the measured work @iterations times */
+typedef void (*BenchFunc)(guint64 iterations, gpointer user_data);
+
+typedef struct {
+    const gchar *name;
+    guint64 iterations;          /* Per repetition, after calibration */
+    guint repetitions;
+    gdouble median_ns;           /* All times are per operation */
+    gdouble mad_ns;
+    gdouble min_ns;
+    gdouble p90_ns;
+    gdouble p99_ns;
+    gboolean have_counters;      /* FALSE if perf_event_open() is unavailable */
+    gdouble cycles;              /* Medians per operation */
+    gdouble instructions;
+    gdouble cache_misses;
+} BenchResult;
+
+/* Consumes the --bench-* options from @argv (either may be NULL) */
+Bench *bench_new(const gchar *suite, gint *argc, gchar ***argv);
+
+/* Writes the JSON/CSV report, if any, and frees the suite */
+void bench_free(Bench *bench);
+
+/* The returned result belongs to @bench. One iteration is one operation. */
+const BenchResult *bench_run(Bench *bench, const gchar *name, BenchFunc func, gpointer user_data);
+
+/* For work that only makes sense in bulk, such as building a whole table:
+ * each iteration performs @ops_per_iteration operations and the results
+ * are divided accordingly */
+const BenchResult *bench_run_ops(Bench *bench, const gchar *name, guint64 ops_per_iteration,
+                                 BenchFunc func, gpointer user_data);
+
+/* Make the compiler assume @value is read, or that all memory may be */
+#define bench_do_not_optimize(value) __asm__ volatile("" : : "g"(value) : "memory")
+#define bench_clobber() __asm__ volatile("" : : : "memory")
+
+G_END_DECLS
+
+#endif /* BENCH_H */
@@ -0,0 +1,61 @@
+/*
+ * glibperf.h - Every reusable component of the lessons, as one library
+ *
+ * The sources stay in their lessons; libglibperf builds them into
+ * libglibperf.a and libglibperf.so and installs their headers side by
+ * side, so a program can include just this file:
+ *
+ *   - bench.h: the micro-benchmark harness (common)
+ *   - rope.h, simd_text.h, column_table.h (lesson 02)
+ *   - timer_wheel.h, idle_scheduler.h (lesson 03)
+ *   - mpmc_ring.h, ws_pool.h, reactor_pool.h, par_sort.h,
+ *     invoke_batch.h (lesson 04)
+ *   - executor.h, signalled_source.h (lesson 06)
+ *   - deadline.h, task_group.h (lesson 07)
+ *   - arena.h, obj_pool.h, dary_heap.h, sharded_lru.h, swiss_table.h,
+ *     btree.h, variant_bulk.h, loop_monitor.h, async_log.h (lesson 08)
+ *   - io_uring_source.h, io_uring_stream.h, record_store.h (lesson 09)
+ *
+ * par_sort_template.h is installed too but not included here: it
+ * generates code, and is meant to be included once per element type.
+ */
+
+#ifndef GLIBPERF_H
+#define GLIBPERF_H
+
+#include "bench.h"
+
+#include "rope.h"
+#include "simd_text.h"
+#include "column_table.h"
+
+#include "timer_wheel.h"
+#include "idle_scheduler.h"
+
+#include "mpmc_ring.h"
+#include "ws_pool.h"
+#include "reactor_pool.h"
+#include "par_sort.h"
+#include "invoke_batch.h"
+
+#include "executor.h"
+#include "signalled_source.h"
+
+#include "deadline.h"
+#include "task_group.h"
+
+#include "arena.h"
+#include "obj_pool.h"
+#include "dary_heap.h"
+#include "sharded_lru.h"
+#include "swiss_table.h"
+#include "btree.h"
+#include "variant_bulk.h"
+#include "loop_monitor.h"
+#include "async_log.h"
+
+#include "io_uring_source.h"
+#include "io_uring_stream.h"
+#include "record_store.h"
+
+#endif /* GLIBPERF_H */
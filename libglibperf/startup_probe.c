@@ -0,0 +1,30 @@
+/*
+ * startup_probe.c - The smallest useful program linked with libglibperf
+ *
+ * Built twice, against libglibperf.a and against libglibperf.so, for
+ * startup_time to run over and over: what it measures is the loader,
+ * relocations and GLib's own initialisation, plus one trip round a
+ * main loop. The work is kept tiny on purpose.
+ */
+
+#include "glibperf.h"
+
+static gboolean on_idle(gpointer data)
+{
+    g_main_loop_quit(data);
+    return G_SOURCE_REMOVE;
+}
+
+int main(void)
+{
+    DaryHeap *heap = dary_heap_new(4);
+    GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+
+    dary_heap_push(heap, 1, NULL);
+    g_idle_add(on_idle, loop);
+    g_main_loop_run(loop);
+
+    g_main_loop_unref(loop);
+    dary_heap_free(heap, NULL);
+    return 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * startup_time.c - Wall time to start and finish a program, via bench.h
+ *
+ * Each iteration spawns the program and waits for it to exit, so
+ * bench_run() reports the median time per run, and its spread, as for
+ * any other benchmark. That includes fork/exec, the dynamic loader,
+ * relocations and whatever the program does before it returns, which
+ * for startup_probe is next to nothing. The results go into the
+ * "startup" suite, so BENCH_OUTPUT_DIR collects them with the rest.
+ *
+ * Usage: ./startup_time PROGRAM... [--bench-...]
+ */
+
+#include "bench.h"
+
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+static void spawn_and_wait(guint64 iterations, gpointer user_data)
+{
+    gchar **child_argv = user_data;
+
+    for (guint64 i = 0; i < iterations; i++) {
+        pid_t pid;
+        gint status;
+        gint err = posix_spawn(&pid, child_argv[0], NULL, NULL, child_argv, environ);
+
+        if (err != 0) {
+            g_error("%s: %s", child_argv[0], g_strerror(err));
+        }
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            g_error("%s did not exit cleanly", child_argv[0]);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Bench *bench = bench_new("startup", &argc, &argv);
+
+    if (argc < 2) {
+        g_printerr("Usage: %s PROGRAM... [--bench-...]\n", argv[0]);
+        return 1;
+    }
+
+    g_print("=== Startup Time ===\n\n");
+
+    for (gint i = 1; i < argc; i++) {
+        gchar *child_argv[] = { argv[i], NULL };
+        gchar *name = g_path_get_basename(argv[i]);
+
+        bench_run(bench, name, spawn_and_wait, child_argv);
+        g_free(name);
+    }
+
+    bench_free(bench);
+    return 0;
+}
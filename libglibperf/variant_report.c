@@ -0,0 +1,282 @@
+/*
+ * variant_report.c - Compare benchmark results across build variants
+ *
+ * Each argument is a variant's build directory (build/debug,
+ * build/release, ...) whose results/ holds the CSV reports bench.h
+ * wrote. For every benchmark the median time per operation is printed
+ * per variant, then each variant's speedup over the one before it, and
+ * the geometric mean of those speedups. Last, the size of the library
+ * and of startup_probe in each variant.
+ *
+ * Usage: ./variant_report VARIANT-DIR...
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <math.h>
+#include <string.h>
+
+typedef struct {
+    gchar *key;                      /* suite/name */
+    gdouble *median_ns;              /* One per variant, NAN if missing */
+} Row;
+
+typedef struct {
+    guint n_variants;
+    gchar **labels;
+    GHashTable *rows;                /* key -> Row * */
+} Report;
+
+static void row_free(gpointer data)
+{
+    Row *row = data;
+
+    g_free(row->key);
+    g_free(row->median_ns);
+    g_free(row);
+}
+
+static Row *report_row(Report *report, const gchar *key)
+{
+    Row *row = g_hash_table_lookup(report->rows, key);
+
+    if (row == NULL) {
+        row = g_new0(Row, 1);
+        row->key = g_strdup(key);
+        row->median_ns = g_new(gdouble, report->n_variants);
+        for (guint v = 0; v < report->n_variants; v++) {
+            row->median_ns[v] = NAN;
+        }
+        g_hash_table_insert(report->rows, row->key, row);
+    }
+    return row;
+}
+
+/* One bench.h CSV line: suite,"name",iterations,repetitions,median_ns,...
+ * The header line, and anything else, is rejected. */
+static gboolean parse_line(const gchar *line, gchar **key, gdouble *median_ns)
+{
+    const gchar *comma = strchr(line, ',');
+    const gchar *name, *end;
+    gchar **fields;
+    gboolean ok;
+
+    if (comma == NULL || comma[1] != '"') {
+        return FALSE;
+    }
+    name = comma + 2;
+    end = strstr(name, "\",");
+    if (end == NULL) {
+        return FALSE;
+    }
+
+    fields = g_strsplit(end + 2, ",", 4);
+    ok = g_strv_length(fields) >= 3;
+    if (ok) {
+        *median_ns = g_ascii_strtod(fields[2], NULL);
+        *key = g_strdup_printf("%.*s/%.*s", (gint)(comma - line), line, (gint)(end - name), name);
+    }
+    g_strfreev(fields);
+    return ok;
+}
+
+static void load_csv(Report *report, guint variant, const gchar *path)
+{
+    gchar *contents;
+    gchar **lines;
+    GError *error = NULL;
+
+    if (!g_file_get_contents(path, &contents, NULL, &error)) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+        return;
+    }
+
+    lines = g_strsplit(contents, "\n", 0);
+    for (gchar **line = lines; *line; line++) {
+        gchar *key;
+        gdouble median_ns;
+
+        if (parse_line(*line, &key, &median_ns)) {
+            report_row(report, key)->median_ns[variant] = median_ns;
+            g_free(key);
+        }
+    }
+    g_strfreev(lines);
+    g_free(contents);
+}
+
+static void load_variant(Report *report, guint variant, const gchar *dir)
+{
+    gchar *results = g_build_filename(dir, "results", NULL);
+    GDir *listing = g_dir_open(results, 0, NULL);
+    const gchar *file;
+
+    if (listing == NULL) {
+        g_printerr("%s: no results\n", results);
+        g_free(results);
+        return;
+    }
+
+    while ((file = g_dir_read_name(listing)) != NULL) {
+        if (g_str_has_suffix(file, ".csv")) {
+            gchar *path = g_build_filename(results, file, NULL);
+
+            load_csv(report, variant, path);
+            g_free(path);
+        }
+    }
+    g_dir_close(listing);
+    g_free(results);
+}
+
+static void format_ns(gdouble ns, gchar *buf, gsize size)
+{
+    if (isnan(ns)) {
+        g_strlcpy(buf, "-", size);
+    } else if (ns < 1e3) {
+        g_snprintf(buf, size, "%.1f ns", ns);
+    } else if (ns < 1e6) {
+        g_snprintf(buf, size, "%.2f us", ns / 1e3);
+    } else if (ns < 1e9) {
+        g_snprintf(buf, size, "%.2f ms", ns / 1e6);
+    } else {
+        g_snprintf(buf, size, "%.2f s", ns / 1e9);
+    }
+}
+
+static gint compare_rows(gconstpointer a, gconstpointer b)
+{
+    const Row *x = *(Row *const *)a, *y = *(Row *const *)b;
+
+    return strcmp(x->key, y->key);
+}
+
+static void print_times(Report *report)
+{
+    GPtrArray *rows = g_ptr_array_new();
+    gdouble *log_sum = g_new0(gdouble, report->n_variants);
+    guint *counted = g_new0(guint, report->n_variants);
+    GHashTableIter iter;
+    gpointer value;
+    gchar buf[32];
+
+    g_hash_table_iter_init(&iter, report->rows);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        g_ptr_array_add(rows, value);
+    }
+    g_ptr_array_sort(rows, compare_rows);
+
+    g_print("%-44s", "benchmark (median per op)");
+    for (guint v = 0; v < report->n_variants; v++) {
+        g_print(" %11s", report->labels[v]);
+    }
+    for (guint v = 1; v < report->n_variants; v++) {
+        g_snprintf(buf, sizeof(buf), "%s/%s", report->labels[v], report->labels[v - 1]);
+        g_print(" %15s", buf);
+    }
+    g_print("\n");
+
+    for (guint i = 0; i < rows->len; i++) {
+        Row *row = g_ptr_array_index(rows, i);
+
+        g_print("%-44s", row->key);
+        for (guint v = 0; v < report->n_variants; v++) {
+            format_ns(row->median_ns[v], buf, sizeof(buf));
+            g_print(" %11s", buf);
+        }
+        for (guint v = 1; v < report->n_variants; v++) {
+            gdouble before = row->median_ns[v - 1], after = row->median_ns[v];
+
+            if (isnan(before) || isnan(after) || before <= 0 || after <= 0) {
+                g_print(" %15s", "-");
+                continue;
+            }
+            g_print(" %14.2fx", before / after);
+            log_sum[v] += log(before / after);
+            counted[v]++;
+        }
+        g_print("\n");
+    }
+
+    g_print("%-44s", "geometric mean speedup");
+    for (guint v = 0; v < report->n_variants; v++) {
+        g_print(" %11s", "");
+    }
+    for (guint v = 1; v < report->n_variants; v++) {
+        if (counted[v] == 0) {
+            g_print(" %15s", "-");
+        } else {
+            g_print(" %14.2fx", exp(log_sum[v] / counted[v]));
+        }
+    }
+    g_print("\n");
+
+    g_free(counted);
+    g_free(log_sum);
+    g_ptr_array_unref(rows);
+}
+
+static void print_sizes(gchar **dirs, guint n_variants, gchar **labels)
+{
+    static const gchar *files[] = {
+        "lib/static/libglibperf.a", "lib/libglibperf.so", "bin/startup_probe", "bin/startup_probe_shared"
+    };
+
+    g_print("\n%-44s", "size (KiB)");
+    for (guint v = 0; v < n_variants; v++) {
+        g_print(" %11s", labels[v]);
+    }
+    g_print("\n");
+
+    for (guint f = 0; f < G_N_ELEMENTS(files); f++) {
+        g_print("%-44s", files[f]);
+        for (guint v = 0; v < n_variants; v++) {
+            gchar *path = g_build_filename(dirs[v], files[f], NULL);
+            GStatBuf st;
+
+            if (g_stat(path, &st) == 0) {
+                g_print(" %11.1f", st.st_size / 1024.0);
+            } else {
+                g_print(" %11s", "-");
+            }
+            g_free(path);
+        }
+        g_print("\n");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Report report = { 0 };
+
+    if (argc < 2) {
+        g_printerr("Usage: %s VARIANT-DIR...\n", argv[0]);
+        return 1;
+    }
+
+    report.n_variants = argc - 1;
+    report.labels = g_new0(gchar *, report.n_variants + 1);
+    report.rows = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, row_free);
+
+    for (guint v = 0; v < report.n_variants; v++) {
+        report.labels[v] = g_path_get_basename(argv[v + 1]);
+        load_variant(&report, v, argv[v + 1]);
+    }
+
+    g_print("=== Build Variant Report ===\n\n");
+    print_times(&report);
+    print_sizes(argv + 1, report.n_variants, report.labels);
+
+    g_print("\n=== Key Points ===\n");
+    g_print("- -O0 is what every lesson Makefile builds: no optimisation at all\n");
+    g_print("- -O3 with LTO inlines across the component boundaries, e.g. into bench loops\n");
+    g_print("- PGO lays out hot paths and inlines by measured, not guessed, frequency\n");
+    g_print("- Startup is dominated by the loader: static linking skips a library's relocations\n");
+    g_print("- Speedups under a few percent are within the benchmarks' own MAD\n");
+
+    g_hash_table_destroy(report.rows);
+    g_strfreev(report.labels);
+    return 0;
+}